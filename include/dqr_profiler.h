@@ -13,9 +13,12 @@
 #include <cstdint>
 #include <cassert>
 #include <unordered_map>
+#include <vector>
 #include <mutex>
 #include <functional>
 #include <atomic>
+#include <memory>
+#include <thread>
 
 #define DQR_PROFILER_MAXCORES	16
 
@@ -543,7 +546,7 @@ public:
     	} trapInfo;
 	};
 	uint32_t size_message = 0;
-	uint32_t offset = 0;
+	uint64_t offset = 0;
 	uint8_t  rawData[32];
 
 	int getI_Cnt();
@@ -781,9 +784,175 @@ private:
 	class Disassembler* disassembler;
 };
 
+// class ProfilerHistogram: Execution count for each instruction address. Addresses in the code sections of the
+// elf file are counted in a dense array per section indexed by halfword, allocated the first time the section is
+// hit. Anything else goes in a small open addressing table. The histogram callback gets a const reference; iterate
+// it for the (address, count) pairs, dense sections first in address order, then the other addresses in no order.
+// With trackChanges() on, the addresses counted since the last takeChanges() are remembered, so callers can be
+// sent just the increments
+
+class ProfilerHistogram {
+public:
+	typedef std::pair<uint64_t, uint64_t> Entry;	// address, count
+
+	class const_iterator {
+	public:
+		const_iterator(const ProfilerHistogram* hist, size_t region, size_t slot);
+		Entry operator*() const;
+		const_iterator& operator++();
+		bool operator==(const const_iterator& other) const { return (region == other.region) && (slot == other.slot); }
+		bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+	private:
+		const ProfilerHistogram* hist;
+		size_t region;	// hist->regions.size() for the outlier table
+		size_t slot;
+
+		void skipEmpty();
+	};
+
+	ProfilerHistogram();
+
+	void addRegion(uint64_t startAddr, uint64_t endAddr);	// endAddr is inclusive
+	size_t getNumRegions() const { return regions.size(); }
+
+	// n must not be 0
+	void add(uint64_t addr, uint64_t n = 1)
+	{
+		if (lastRegion < regions.size()) {
+			Region& r = regions[lastRegion];
+			if ((addr >= r.startAddr) && (addr <= r.endAddr) && (((addr - r.startAddr) & 1) == 0) && !r.counts.empty()) {
+				size_t slot = (size_t)((addr - r.startAddr) >> 1);
+				uint64_t& c = r.counts[slot];
+				if (tracking && ((r.changed[slot >> 6] & (1ULL << (slot & 0x3f))) == 0)) {
+					r.changed[slot >> 6] |= 1ULL << (slot & 0x3f);
+					changes.push_back(Entry(addr, c));
+				}
+				if (c == 0) {
+					numAddrs += 1;
+				}
+				c += n;
+				return;
+			}
+		}
+
+		addSlow(addr, n);
+	}
+
+	uint64_t getCount(uint64_t addr) const;
+	size_t size() const { return numAddrs; }
+	bool empty() const { return numAddrs == 0; }
+	void clear();	// counts only. Regions are kept
+
+	void trackChanges(bool enable);
+	void takeChanges(std::vector<Entry>& deltas);	// (address, count increment) pairs since the last call
+	void toMap(std::unordered_map<uint64_t, uint64_t>& map) const;
+
+	const_iterator begin() const { return const_iterator(this, 0, 0); }
+	const_iterator end() const { return const_iterator(this, regions.size(), outlierAddrs.size()); }
+
+private:
+	struct Region {
+		uint64_t startAddr;
+		uint64_t endAddr;
+		std::vector<uint64_t> counts;	// one per halfword, empty until first hit
+		std::vector<uint64_t> changed;	// bit per halfword, set if in changes. Empty unless tracking
+	};
+
+	std::vector<Region> regions;	// sorted by startAddr, not overlapping
+	size_t lastRegion;
+
+	// open addressing with linear probing. A count of 0 marks an empty slot
+
+	std::vector<uint64_t> outlierAddrs;
+	std::vector<uint64_t> outlierCounts;
+	std::vector<uint8_t> outlierChanged;
+	size_t outlierUsed;
+
+	size_t numAddrs;
+
+	bool tracking;
+	std::vector<Entry> changes;	// address and its count before it was first changed since the last takeChanges()
+
+	void addSlow(uint64_t addr, uint64_t n);
+	size_t findRegion(uint64_t addr) const;
+	size_t outlierSlot(uint64_t addr) const;
+	void growOutliers();
+	void allocRegion(Region& r);
+};
+
+// class ProfilerHistogramSummary: Histogram counts added up by function, by source file and line, and by basic
+// block. Counts are instructions executed. A basic block runs up to and including the next control flow
+// instruction or up to the next function start or direct branch target; entries is the count for its first
+// instruction. Instructions with no function or no line information are counted under a null function or file
+
+class ProfilerHistogramSummary {
+public:
+	enum {
+		sumNone = 0,
+		sumFunction = 1 << 0,
+		sumLine = 1 << 1,
+		sumBlock = 1 << 2
+	};
+
+	struct FuncCount {
+		const char* function;
+		TraceDqrProfiler::ADDRESS address;
+		uint64_t count;
+	};
+
+	struct LineCount {
+		const char* file;
+		uint32_t line;
+		uint64_t count;
+	};
+
+	struct BlockCount {
+		TraceDqrProfiler::ADDRESS startAddr;
+		TraceDqrProfiler::ADDRESS endAddr;	// inclusive
+		uint64_t count;
+		uint64_t entries;
+	};
+
+	std::vector<FuncCount> functions;
+	std::vector<LineCount> lines;
+	std::vector<BlockCount> blocks;	// in address order
+	uint64_t outsideCode;	// instructions not in a code section of the elf file, so in no block
+
+	void clear() { functions.clear(); lines.clear(); blocks.clear(); outsideCode = 0; }
+};
+
+// class ProfilerCallGraph: Caller to callee edges between functions, from the calls and returns seen while
+// generating the histogram. Functions are identified by their start address, or by the target address where
+// there is no symbol; caller 0 is for functions entered before the trace started or after it resynced.
+// Exceptions and interrupts are counted as calls. Exclusive counts are instructions (and timestamp ticks when the
+// trace has timestamps) while the callee is running on behalf of that caller; inclusive counts also take in
+// everything the callee calls, and are only counted once for recursive calls. Calls still active when the graph
+// is sent are included up to that point
+
+class ProfilerCallGraph {
+public:
+	struct Edge {
+		TraceDqrProfiler::ADDRESS caller;
+		TraceDqrProfiler::ADDRESS callee;
+		const char* callerName;	// null if no symbol
+		const char* calleeName;
+		uint64_t calls;
+		uint64_t inclusiveInsts;
+		uint64_t exclusiveInsts;
+		uint64_t inclusiveTime;
+		uint64_t exclusiveTime;
+	};
+
+	std::vector<Edge> edges;
+	bool haveTime;
+
+	void clear() { edges.clear(); haveTime = false; }
+};
+
 class TraceProfiler {
 public:
-	TraceProfiler(char* tf_name, char* ef_name, int numAddrBits, uint32_t addrDispFlags, int srcBits, const char* odExe, uint32_t freq = 0);
+	TraceProfiler(char* tf_name, char* ef_name, int numAddrBits, uint32_t addrDispFlags, int srcBits, const char* odExe, uint32_t freq = 0, std::shared_ptr<class ElfReader> elfImage = nullptr);
 	TraceProfiler(char* mf_ame);
 	~TraceProfiler();
 	void cleanUp();
@@ -811,7 +980,7 @@ public:
 	TraceDqrProfiler::DQErr NextInstruction(ProfilerInstruction* instInfo, ProfilerNexusMessage* msgInfo, ProfilerSource* srcInfo, int* flags);
 	TraceDqrProfiler::DQErr NextInstruction(ProfilerInstruction** instInfo, ProfilerNexusMessage **nm_out, uint64_t &address_out);
 
-	TraceDqrProfiler::DQErr getTraceFileOffset(int& size, int& offset);
+	TraceDqrProfiler::DQErr getTraceFileOffset(uint64_t& size, uint64_t& offset);
 
 	TraceDqrProfiler::DQErr haveITCPrintData(int numMsgs[DQR_PROFILER_MAXCORES], bool havePrintData[DQR_PROFILER_MAXCORES]);
 	bool        getITCPrintMsg(int core, char* dst, int dstLen, TraceDqrProfiler::TIMESTAMP& startTime, TraceDqrProfiler::TIMESTAMP& endTime);
@@ -824,6 +993,15 @@ public:
 
 	//	const char *getSymbolByAddress(TraceDqrProfiler::ADDRESS addr);
 	TraceDqrProfiler::DQErr Disassemble(TraceDqrProfiler::ADDRESS addr);
+
+	// NextInstruction() fills in instructionText, addressLabel and the ProfilerSource fields. With
+	// setLazyInstructionText(true) it leaves them empty instead (the address and instruction are always filled in),
+	// and resolveInstructionText()/resolveSourceInfo() look them up for an instruction it returned, only when they
+	// are wanted
+	void setLazyInstructionText(bool lazy) { lazyInstText = lazy; }
+	TraceDqrProfiler::DQErr resolveInstructionText(ProfilerInstruction* instInfo);
+	TraceDqrProfiler::DQErr resolveSourceInfo(TraceDqrProfiler::ADDRESS addr, ProfilerSource* srcInfo);
+
 	int         getArchSize();
 	int         getAddressSize();
 	void        analyticsToText(char* dst, int dst_len, int detailLevel) { analytics.toText(dst, dst_len, detailLevel); }
@@ -835,18 +1013,64 @@ public:
 
 	TraceDqrProfiler::DQErr getNumBytesInSWTQ(int& numBytes);
 	TraceDqrProfiler::DQErr GenerateHistogram();
-	void SetHistogramCallback(std::function<void(uint32_t src_id, std::unordered_map<uint64_t, uint64_t>& hist_map, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
+	void SetHistogramCallback(std::function<void(uint32_t src_id, const ProfilerHistogram& hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
 	{
 		m_fp_hist_callback = fp_callback;
 	}
-	void AddFlushDataOffset(const uint64_t offset)
+	// The Set*Callback() functions below and SetProfileOutput() can be called while GenerateHistogram() runs on
+	// another thread. The change is then queued, and made by the decode loop before it reads the next message
+
+	// delta gets the (address, count increment) pairs since the previous call. hist is only passed, with the
+	// complete histogram, on the last call before GenerateHistogram() returns
+	void SetHistogramDeltaCallback(std::function<void(uint32_t src_id, const ProfilerHistogram::Entry* delta, size_t delta_count, const ProfilerHistogram* hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
 	{
-		m_flush_data_offset = offset;
+		applySetting([this, fp_callback]() {
+			m_fp_hist_delta_callback = fp_callback;
+			updateTracking();
+		});
+	}
+	// summary gets the whole histogram added up at each of the levels asked for (ProfilerHistogramSummary::sumFunction
+	// and so on), instead of by address
+	void SetHistogramSummaryCallback(uint32_t levels, std::function<void(uint32_t src_id, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
+	{
+		applySetting([this, levels, fp_callback]() {
+			m_hist_summary_levels = levels;
+			m_fp_hist_summary_callback = fp_callback;
+			updateTracking();
+		});
 	}
-	void ClearHistogram()
+	// ticks gets, for each address, the timestamp ticks between consecutive timestamps shared out over the
+	// instructions retired in between, and summary the same added up at levels (ProfilerHistogramSummary::sumFunction
+	// and so on, or sumNone). Instructions after the last timestamp, or after sync was lost, are not counted
+	void SetTimeProfileCallback(uint32_t levels, std::function<void(uint32_t src_id, const ProfilerHistogram& ticks, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
 	{
-		m_hist_map.clear();
+		applySetting([this, levels, fp_callback]() {
+			m_time_summary_levels = levels;
+			m_fp_time_profile_callback = fp_callback;
+			updateTracking();
+		});
 	}
+	// graph gets the call graph built from the calls and returns GenerateHistogram() decodes
+	void SetCallGraphCallback(std::function<void(uint32_t src_id, const ProfilerCallGraph& graph, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
+	{
+		applySetting([this, fp_callback]() {
+			m_fp_call_graph_callback = fp_callback;
+		});
+	}
+	enum ProfileFormat {
+		PROFILE_PPROF = 0,		// gzip'd pprof profile.proto
+		PROFILE_PERF_SCRIPT = 1,	// text as printed by 'perf script'
+		PROFILE_NUM_FORMATS = 2
+	};
+	// adds up the histogram counts while GenerateHistogram() runs, and writes them to path in format with the call
+	// graph when it finishes, or when the output is set again. Counts from before the output is set are not
+	// written. A null path stops writing that format
+	TraceDqrProfiler::DQErr SetProfileOutput(ProfileFormat format, const char* path);
+	void AddFlushDataOffset(const uint64_t offset)
+	{
+		m_flush_data_offset = offset;
+	}
+	void ClearHistogram();
 	void AbortHistogramThread()
 	{
 		{
@@ -870,13 +1094,40 @@ private:
 		TRACE_STATE_ERROR
 	};
 	std::atomic<uint64_t> m_flush_data_offset;
-	std::unordered_map<uint64_t, uint64_t> m_hist_map;
-	std::function<void(uint32_t src_id, std::unordered_map<uint64_t, uint64_t>& hist_map, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_hist_callback = nullptr;
+	ProfilerHistogram m_hist;
+	std::function<void(uint32_t src_id, const ProfilerHistogram& hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_hist_callback = nullptr;
+	std::function<void(uint32_t src_id, const ProfilerHistogram::Entry* delta, size_t delta_count, const ProfilerHistogram* hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_hist_delta_callback = nullptr;
+	std::vector<ProfilerHistogram::Entry> m_hist_delta;
+	std::function<void(uint32_t src_id, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_hist_summary_callback = nullptr;
+	uint32_t m_hist_summary_levels = ProfilerHistogramSummary::sumNone;
+	class HistogramSummarizer* m_hist_summarizer = nullptr;	// totals of m_hist, kept up to date from m_hist_delta
+	ProfilerHistogramSummary m_hist_summary;
+	std::function<void(uint32_t src_id, const ProfilerCallGraph& graph, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_call_graph_callback = nullptr;
+	class CallGraphBuilder* m_call_graph = nullptr;
+	ProfilerCallGraph m_call_graph_out;
+	std::function<void(uint32_t src_id, const ProfilerHistogram& ticks, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_time_profile_callback = nullptr;
+	uint32_t m_time_summary_levels = ProfilerHistogramSummary::sumNone;
+	ProfilerHistogram m_time_hist;	// timestamp ticks per address
+	std::vector<ProfilerHistogram> m_time_window;	// per core, instructions since that core's last timestamp
+	std::vector<TraceDqrProfiler::TIMESTAMP> m_time_last;	// per core, timestamp m_time_window starts at
+	std::vector<ProfilerHistogram::Entry> m_time_delta;
+	std::vector<ProfilerHistogram::Entry> m_time_hist_delta;
+	class HistogramSummarizer* m_time_summarizer = nullptr;	// totals of m_time_hist, kept up to date from m_time_hist_delta
+	ProfilerHistogramSummary m_time_summary;
+	class ProfileWriter* m_profile_writers[PROFILE_NUM_FORMATS] = {};
+	bool haveProfileWriters()
+	{
+		return (m_profile_writers[PROFILE_PPROF] != nullptr) || (m_profile_writers[PROFILE_PERF_SCRIPT] != nullptr);
+	}
+	void closeProfileWriters();
+	void updateTracking();
 	TraceDqrProfiler::DQErr        status;
 	TraceDqrProfiler::TraceType	   traceType;
 	class SliceFileParser* sfp;
+	std::shared_ptr<class ElfReader> m_elf_image;	// owns elfReader. Shared with other decoders of the same elf file
 	class ElfReader* elfReader;
 	class Disassembler* disassembler;
+	bool lazyInstText;
 	class CTFConverter* ctf;
 	class EventConverter* eventConverter;
 	class PerfConverter* perfConverter;
@@ -928,9 +1179,16 @@ private:
 
 	std::mutex m_abort_histogram_mutex;
 	bool m_abort_histogram = false;
+	bool m_histogram_running = false;	// these two are guarded by m_abort_histogram_mutex
+	std::vector<std::function<void()>> m_pending_settings;
 	uint32_t m_src_id = 0;
 
 	TraceDqrProfiler::DQErr configure(class TraceSettings& settings);
+	TraceDqrProfiler::DQErr runHistogram();
+	void applySetting(std::function<void()> apply);
+	void applyPendingSettings();
+	void reportHistogram(uint64_t total_ins, bool final);
+	void chargeTime(int core);
 
 	int decodeInstructionSize(uint32_t inst, int& inst_size);
 	int decodeInstruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch);
@@ -945,6 +1203,45 @@ public:
     // Function to add data to the message queue
     TraceDqrProfiler::DQErr PushTraceData(uint8_t *p_buff, const uint64_t size);
     void SetEndOfData();
+    // Function to drop any further trace data once the decoding thread has exited
+    void CloseTraceInput();
+    // Function to read trace data from a store shared with other decoders
+    void AttachTraceStore(std::shared_ptr<class TraceChunkStore>& store);
+    // Function to parse the trace file given to the constructor from a memory mapping of it. Without this the
+    // file name is ignored and trace data has to be pushed with PushTraceData() or a shared store
+    TraceDqrProfiler::DQErr MapTraceFile();
+    // Function to parse trace messages on a separate thread, ahead of the decoder
+    TraceDqrProfiler::DQErr StartMessagePipeline();
+    // Function to decode a trace file on worker threads, split at sync messages at least segmentSize bytes apart
+    // (0 for PARALLEL_DECODE_SEGMENT_SIZE)
+    TraceDqrProfiler::DQErr StartParallelDecode(uint32_t numWorkers, uint64_t segmentSize = 0);
+    // Function to decode each core of a multi-core trace on its own thread. With this or StartParallelDecode(),
+    // NextInstruction() only returns the message offset and the address, and GenerateHistogram() still decodes serially
+    TraceDqrProfiler::DQErr StartCoreDecode();
+private:
+    class TraceMsgQueue* m_msg_queue = nullptr;
+    std::thread m_msg_parser_thread;
+
+    void MessageParserThread();
+    void StopMessagePipeline();
+    TraceDqrProfiler::DQErr readNextTraceMsg(ProfilerNexusMessage& msg, bool& haveMsg);
+
+    friend class ParallelTraceDecoder;
+
+    class ParallelTraceDecoder* m_parallel_decoder = nullptr;
+    bool m_address_out_set = false;
+
+    void StopParallelDecode();
+    TraceDqrProfiler::DQErr resetDecoder(uint64_t begin, uint64_t end);
+    TraceDqrProfiler::DQErr DecodeSegment(class TraceDecodeSegment& segment);
+
+    friend class CoreTraceDecoder;
+
+    class CoreTraceDecoder* m_core_decoder = nullptr;   // owned, per-core decode mode
+    class CoreTraceDecoder* m_core_source = nullptr;    // decoder this per-core worker reads its messages from
+    class TraceCoreBatch* m_core_batch = nullptr;       // batch for the message this per-core worker is decoding
+
+    void StopCoreDecode();
 };
 
 #endif /* DQR_HPP_ */
@@ -17,6 +17,7 @@
 #include <functional>
 #include <mutex>
 #include <atomic>
+#include <memory>
 
 #include "SocketIntf.h"
 #include "dqr_profiler.h"
@@ -123,6 +124,14 @@ struct TProfilerConfig
     uint16_t portno = 6000;
     uint64_t ui_file_split_size_bytes = 8 * 1024;
 	uint32_t src_id = 0;
+	bool enable_trace_file_input = false;  // Decode trace_filepath from a memory mapping of it instead of PushTraceData() data
+	bool enable_decode_pipeline = false;   // Parse trace messages on a separate thread ahead of the decoder
+	uint32_t parallel_decode_workers = 0;  // Profile and address search trace_filepath on this many threads, split at sync messages (0 = serial). Needs enable_trace_file_input
+	bool enable_per_core_decode = false;   // Profile and address search each core of a multi-core trace (src_field_size_bits > 0) on its own thread.
+	                                       // The histogram and timestamp search need more than these decoders give back and always decode serially
+	char* elf_cache_dir = nullptr;         // Keep parsed elf images in this directory for later sessions (nullptr = no cache)
+	char* pprof_filepath = nullptr;        // Write the histogram and call graph here as gzip'd pprof profile.proto (nullptr = off)
+	char* perf_script_filepath = nullptr;  // Write the histogram and call graph here as 'perf script' text (nullptr = off)
 };
 
 // Structure to represent the parameters needed for searching
@@ -179,6 +188,9 @@ typedef enum
 
 // Interface Class that provides access to the decoder related
 // functionality
+class TraceChunkStore;
+class ElfReader;
+
 class SifiveProfilerInterface
 {
 private:
@@ -211,6 +223,12 @@ private:
 	uint16_t m_port_no = 6000;                                          // Default port
 	uint64_t m_ui_file_split_size_bytes = 8 * 1024;                     // Default UI file size 8KB
 	uint32_t m_src_id = 0;
+	bool m_enable_trace_file_input = false;                             // Map tf_name instead of using pushed data
+	bool m_enable_decode_pipeline = false;                              // Parse messages on a separate thread
+	uint32_t m_parallel_decode_workers = 0;                             // Worker threads for profiling a trace file
+	bool m_enable_per_core_decode = false;                              // Decode each core on its own thread
+	const char* m_pprof_filepath = nullptr;                             // Histogram output as pprof profile
+	const char* m_perf_script_filepath = nullptr;                       // Histogram output as perf script text
 
 	// ITC Print Settings
 	int itcPrintOpts = TraceDqrProfiler::ITC_OPT_NLS; // ITC Print Options
@@ -232,6 +250,8 @@ private:
 	TraceProfiler* m_addr_search_trace = nullptr;
 	TraceProfiler* m_hist_trace = nullptr;
 	TraceProfiler* m_ts_search_trace = nullptr;
+	std::shared_ptr<TraceChunkStore> m_trace_store;                   // Trace data shared by profiling and search decoders
+	std::shared_ptr<ElfReader> m_elf_image;                            // ELF file loaded by Configure, shared by all decoders
 	SocketIntf* m_client = nullptr;
 	std::thread m_profiling_thread;
 	std::thread m_addr_search_thread;
@@ -262,7 +282,13 @@ private:
 	std::atomic<bool> m_abort_search{false};
 
 
-	std::function<void(uint32_t src_id, std::unordered_map<uint64_t, uint64_t>& hist_map, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_hist_callback = nullptr;
+	std::function<void(uint32_t src_id, const ProfilerHistogram& hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_hist_callback = nullptr;
+	std::function<void(uint32_t src_id, const ProfilerHistogram::Entry* delta, size_t delta_count, const ProfilerHistogram* hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_hist_delta_callback = nullptr;
+	std::function<void(uint32_t src_id, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_hist_summary_callback = nullptr;
+	uint32_t m_hist_summary_levels = ProfilerHistogramSummary::sumNone;
+	std::function<void(uint32_t src_id, const ProfilerCallGraph& graph, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_call_graph_callback = nullptr;
+	std::function<void(uint32_t src_id, const ProfilerHistogram& ticks, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> m_fp_time_profile_callback = nullptr;
+	uint32_t m_time_summary_levels = ProfilerHistogramSummary::sumNone;
 
 	virtual TySifiveTraceProfileError ProfilingThread();
 	virtual void CleanUpProfiling();
@@ -272,6 +298,7 @@ private:
 	virtual bool WaitforACK();
 	virtual TySifiveTraceProfileError FlushDataOverSocket();
 public:
+	SifiveProfilerInterface();
 	virtual TySifiveTraceProfileError Configure(const TProfilerConfig& config);
 	virtual ~SifiveProfilerInterface();
 	virtual TySifiveTraceProfileError StartProfilingThread(uint32_t thread_idx);
@@ -291,7 +318,12 @@ public:
 	virtual void WaitForHistogramCompletion();
 	virtual TySifiveTraceProfileError PushTraceDataToHistGenerator(uint8_t* p_buff, const uint64_t& size);
 	virtual void SetEndOfDataHistGenerator();
-	virtual void SetHistogramCallback(std::function<void(uint32_t src_id, std::unordered_map<uint64_t, uint64_t>& hist_map, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback);
+	virtual void SetHistogramCallback(std::function<void(uint32_t src_id, const ProfilerHistogram& hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback);
+	virtual void SetHistogramDeltaCallback(std::function<void(uint32_t src_id, const ProfilerHistogram::Entry* delta, size_t delta_count, const ProfilerHistogram* hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback);
+	virtual void SetHistogramSummaryCallback(uint32_t levels, std::function<void(uint32_t src_id, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback);
+	virtual void SetCallGraphCallback(std::function<void(uint32_t src_id, const ProfilerCallGraph& graph, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback);
+	virtual void SetTimeProfileCallback(uint32_t levels, std::function<void(uint32_t src_id, const ProfilerHistogram& ticks, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback);
+	virtual void SetProfileOutput(const char* pprof_filepath, const char* perf_script_filepath);
 	virtual void ClearHistogram();
 	virtual void SetTraceStartIdx(const uint64_t trace_start_idx);
 	virtual void SetTraceStopIdx(const uint64_t trace_stop_idx);
@@ -16,7 +16,17 @@
 #include <cctype>    // std::tolower
 #include <algorithm> // std::equal
 #include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <unordered_map>
 #ifdef WINDOWS
 #include<windows.h>
 #endif
@@ -40,49 +50,61 @@ private:
 
 void sanePath(TraceDqrProfiler::pathType pt, const char* src, char* dst);
 
-class cachedInstInfo {
-public:
-	cachedInstInfo(const char* file, int cutPathIndex, const char* func, int linenum, const char* lineTxt, const char* instText, TraceDqrProfiler::RV_INST inst, int instSize, const char* addresslabel, int addresslabeloffset);
-	~cachedInstInfo();
-
-	void dump();
-
-	const char* filename;
-	int         cutPathIndex;
-	const char* functionname;
-	int         linenumber;
-	const char* lineptr;
-
-	TraceDqrProfiler::RV_INST instruction;
-	int               instsize;
+// struct DecodedInst: Predecoded form of the instruction starting at one halfword of a code section
 
-	char* instructionText;
-
-	const char* addressLabel;
-	int               addressLabelOffset;
+struct DecodedInst {
+	int32_t  immediate;
+	uint8_t  instType;	// TraceDqrProfiler::InstType
+	uint8_t  rs1;		// TraceDqrProfiler::Reg
+	uint8_t  rd;		// TraceDqrProfiler::Reg
+	uint8_t  instSize : 6;	// in bits
+	uint8_t  isBranch : 1;
+	uint8_t  valid : 1;	// instruction fits in the section and decodes
 };
 
 // class Section: work with elf file sections
 
-class SrcFile {
-public:
-	SrcFile(char* fName, SrcFile* nxt);
-	~SrcFile();
-
-	class SrcFile* next;
-	char* file;
-};
+// class StringPool: One copy of each distinct string (source file names, symbol names, disassembly text), packed
+// into large blocks. Strings are never moved or freed until the pool is deleted, so anything loaded from the
+// same elf image can point into the pool. Adding strings is not thread safe; the elf image only adds them while
+// it is being constructed
 
-class SrcFileRoot {
+class StringPool {
 public:
-	SrcFileRoot();
-	~SrcFileRoot();
+	StringPool();
+	~StringPool();
 
-	char* addFile(char* fName);
+	char* intern(const char* str);
+	char* find(const char* str);
+	uint32_t getCount() { return (uint32_t)strings.size(); }
 	void dump();
 
 private:
-	SrcFile* fileRoot;
+	enum {
+		blockSize = 64 * 1024
+	};
+
+	struct StrHash {
+		size_t operator()(const char* str) const;
+	};
+
+	struct StrEqual {
+		bool operator()(const char* a, const char* b) const { return strcmp(a, b) == 0; }
+	};
+
+	std::vector<char*> blocks;
+	char* blockNext;
+	size_t blockLeft;
+	std::unordered_set<const char*, StrHash, StrEqual> strings;
+};
+
+// struct LineRange: Source file and line for the halfwords of a code section from index up to the start of the
+// next range. file is null where there is no line information
+
+struct LineRange {
+	uint32_t index;
+	uint32_t line;
+	char* file;	// in the elf image's StringPool
 };
 
 class Section {
@@ -106,8 +128,22 @@ public:
 	Section* getSectionByAddress(TraceDqrProfiler::ADDRESS addr);
 	Section* getSectionByName(char* secName);
 
-	cachedInstInfo* setCachedInfo(TraceDqrProfiler::ADDRESS addr, const char* file, int cutPathIndex, const char* func, int linenum, const char* lineTxt, const char* instTxt, TraceDqrProfiler::RV_INST inst, int instSize, const char* addresslabel, int addresslabeloffset);
-	cachedInstInfo* getCachedInfo(TraceDqrProfiler::ADDRESS addr);
+	// the loaders add source lines and disassembly text by halfword index, then buildIndexes() packs them into
+	// lines[] and the per-instruction tables. Later calls for the same halfwords replace earlier ones, except
+	// fillSrcLines() only fills halfwords that have no source file yet
+
+	void setSrcLines(uint32_t first, uint32_t end, char* file, uint32_t line);
+	void fillSrcLines(uint32_t first, uint32_t end, char* file, uint32_t line);
+	void setDiss(uint32_t index, const char* text); // text must already be in the elf image's StringPool
+	void getLineRanges(std::vector<LineRange>& ranges);
+	void getDissList(std::vector<std::pair<uint32_t, const char*>>& dissList);
+	TraceDqrProfiler::DQErr buildIndexes();
+
+	const LineRange* getSrcLine(uint32_t index);
+	const char* getDiss(uint32_t index);
+	int getInstNumber(uint32_t index);
+
+	TraceDqrProfiler::DQErr predecode(int archSize);
 
 	void dump();
 
@@ -120,14 +156,56 @@ public:
 	uint32_t     offset; // offset of section in elf file
 	uint32_t     align;
 	uint16_t* code;
-	char** fName; // file name - array of pointers
-	uint32_t* line;  // line number
-	char** diss;  // disassembly text - array of pointers
+	std::vector<LineRange> lines; // sorted by index, starting at halfword 0 when not empty
+
+	std::vector<uint64_t> instStart; // one bit per halfword, set where an instruction starts
+	std::vector<uint32_t> instRank; // instructions starting before each word of instStart
+	uint32_t numInsts;
+	std::vector<const char*> diss; // per instruction, disassembly text in the elf image's StringPool. Empty if there is none
+
+	uint16_t* plainRun; // halfwords of straight line code from each halfword up to the next control flow instruction
+	DecodedInst* decoded; // predecoded instruction at each halfword
+
+private:
+	struct PendingInfo {
+		std::map<uint32_t, LineRange> lines; // each range runs up to the next key
+		std::vector<std::pair<uint32_t, const char*>> diss; // halfword index, text
+	};
 
-	cachedInstInfo** cachedInfo; // array of pointers
+	PendingInfo* pending; // only while loading
+
+	PendingInfo* getPending();
 };
 
-// class fileReader: Helper class to handler list of source code files
+// class SectionIndex: Sorted, non-overlapping address ranges over a section list, to find the section holding an
+// address by binary search. Where sections overlap, the range goes to the section that comes first in the list,
+// as with Section::getSectionByAddress(). The last range found is checked first
+
+class SectionIndex {
+public:
+	SectionIndex();
+	~SectionIndex();
+
+	TraceDqrProfiler::DQErr build(Section* sections);
+	Section* getSectionByAddress(TraceDqrProfiler::ADDRESS addr);
+
+private:
+	struct Range {
+		TraceDqrProfiler::ADDRESS startAddr;
+		TraceDqrProfiler::ADDRESS endAddr;	// inclusive, as Section::endAddr
+		Section* section;
+	};
+
+	std::vector<Range> ranges;
+	std::atomic<uint32_t> lastRange;
+};
+
+// class fileReader: Helper class to handler list of source code files. Source files are memory mapped the first
+// time one of their lines is needed, and the newline index is built at the same time. Mapped files are kept on an
+// LRU list and the least recently used ones are unmapped once the cache budget is exceeded; they are mapped again
+// if needed. Line text handed out is copied into a StringPool, so it stays valid after the file is unmapped. That
+// copy is outside the cache budget and is only freed with the fileReader: it grows with the number of different
+// lines asked for, up to the size of the source files
 
 class fileReader {
 public:
@@ -140,8 +218,16 @@ public:
 		char* name;
 		int           cutPathIndex;
 		funcList* funcs;
+		char* path;			// file that was found for name, or null if the source file could not be found
+		bool          indexed;		// data, lineStarts and lineCount are valid
 		unsigned int  lineCount;
-		char** lines;
+		const char* data;		// mapped file contents while indexed
+		size_t        length;
+		size_t        cost;		// bytes counted against the cache budget while indexed
+		std::vector<uint32_t> lineStarts;	// offset in data of the start of each line
+		std::vector<const char*> lineText;	// nul terminated line text in textPool, null until first asked for
+		fileList* lruPrev;
+		fileList* lruNext;
 	};
 
 	fileReader(/*paths?*/);
@@ -149,15 +235,33 @@ public:
 
 	TraceDqrProfiler::DQErr subSrcPath(const char* cutPath, const char* newRoot);
 	fileList* findFile(const char* file);
+	const char* getLine(fileList* fl, unsigned int line);
+	void setCacheBudget(size_t bytes);
+	size_t getCacheUsed() { return cacheUsed; }	// mapped files and their indexes, not the pooled line text
 
 private:
+	enum {
+		defaultCacheBudget = 256 * 1024 * 1024
+	};
+
 	char* cutPath;
 	char* newRoot;
 
 	fileList* readFile(const char* file);
+	TraceDqrProfiler::DQErr indexFile(fileList* fl);
+	void unindexFile(fileList* fl);
+	void lruUnlink(fileList* fl);
+	void lruPushFront(fileList* fl);
+	void trimCache(fileList* keep);
 
 	fileList* lastFile;
 	fileList* files;
+
+	fileList* lruHead;		// most recently used indexed file
+	fileList* lruTail;
+	size_t    cacheBudget;
+	size_t    cacheUsed;
+	StringPool textPool;
 };
 
 // class Symtab: Interface class between bfd symbols and what is needed for dqr
@@ -179,7 +283,7 @@ struct Sym {
 	};
 
 	struct Sym* next;
-	char* name;
+	char* name;	// in the elf image's StringPool
 	uint32_t flags;
 	class Section* section;
 	uint64_t address;
@@ -197,24 +301,31 @@ public:
 	TraceDqrProfiler::DQErr getStatus() { return status; }
 
 private:
-	TraceDqrProfiler::DQErr status;
+	// address range where the first symbol in symPtrArray covering it is symPtrArray[index]
+	struct SymRange {
+		TraceDqrProfiler::ADDRESS startAddr;
+		TraceDqrProfiler::ADDRESS endAddr;	// exclusive
+		int index;
+	};
 
-	TraceDqrProfiler::ADDRESS cachedSymAddr;
-	int cachedSymSize;
-	int cachedSymIndex;
+	TraceDqrProfiler::DQErr status;
 
 	long      numSyms;
 	Sym* symLst = nullptr;
 	Sym** symPtrArray = nullptr;
 
+	std::vector<SymRange> symRanges;	// sorted, non-overlapping
+	std::atomic<uint32_t> cachedRange;
+
 	TraceDqrProfiler::DQErr fixupFunctionSizes();
+	TraceDqrProfiler::DQErr buildAddressIndex();
 };
 
 // find : Interface class between dqr and bfd
 
 class ObjDump {
 public:
-	ObjDump(const char* elfName, const char* objDumpPath, int& archSize, Section*& codeSectionLst, Sym*& syms, SrcFileRoot& srcFileRoot);
+	ObjDump(const char* elfName, const char* objDumpPath, int& archSize, Section*& codeSectionLst, Sym*& syms, StringPool& stringPool);
 	~ObjDump();
 
 	TraceDqrProfiler::DQErr getStatus() { return status; }
@@ -276,24 +387,176 @@ private:
 	TraceDqrProfiler::DQErr parseFuncName();
 	TraceDqrProfiler::DQErr parseFileOrLabelOrDisassembly(line_t& lineType, char* text, int& length, uint32_t& value);
 	TraceDqrProfiler::DQErr parseDisassembly(bool& isLabel, int& instSize, uint32_t& inst, char* disassembly);
-	TraceDqrProfiler::DQErr parseDisassemblyList(objDumpTokenType& nextType, char* nextLex, Section* codeSectionLst, SrcFileRoot& srcFileRoot);
+	TraceDqrProfiler::DQErr parseDisassemblyList(objDumpTokenType& nextType, char* nextLex, Section* codeSectionLst, StringPool& stringPool);
 	TraceDqrProfiler::DQErr parseFixedField(uint32_t& flags);
 	TraceDqrProfiler::DQErr parseSymbol(bool& haveSym, char* secName, char* symName, uint32_t& symFlags, uint64_t& symSize);
-	TraceDqrProfiler::DQErr parseSymbolTable(objDumpTokenType& nextType, char* nextLex, Sym*& syms, Section*& codeSectionLst);
+	TraceDqrProfiler::DQErr parseSymbolTable(objDumpTokenType& nextType, char* nextLex, Sym*& syms, Section*& codeSectionLst, StringPool& stringPool);
 	TraceDqrProfiler::DQErr parseElfName(char* elfName, enum elfType& et);
-	TraceDqrProfiler::DQErr parseObjdump(int& archSize, Section*& codeSectionLst, Sym*& syms, SrcFileRoot& srcFileRoot);
+	TraceDqrProfiler::DQErr parseObjdump(int& archSize, Section*& codeSectionLst, Sym*& syms, StringPool& stringPool);
+};
+
+// class ElfLoader: Reads section headers, code, the symbol table and DWARF .debug_line straight from a little
+// endian RISC-V ELF32/ELF64 file into the same Section/Sym/line structures ObjDump builds from objdump output.
+// There is no disassembler, so no disassembly text is set
+
+class ElfLoader {
+public:
+	ElfLoader(const char* elfName, int& archSize, Section*& codeSectionLst, Sym*& syms, StringPool& stringPool);
+	~ElfLoader();
+
+	TraceDqrProfiler::DQErr getStatus() { return status; }
+
+private:
+	struct SectHdr {
+		uint32_t name;
+		uint32_t type;
+		uint64_t flags;
+		uint64_t addr;
+		uint64_t offset;
+		uint64_t size;
+		uint32_t link;
+		uint64_t align;
+		uint64_t entsize;
+	};
+
+	// one file entry of a line number program header, with its directory already joined in
+
+	struct LineFile {
+		const char* name;
+		uint64_t dir;
+		char* path;
+	};
+
+	TraceDqrProfiler::DQErr status;
+
+	FILE* fp;
+	uint64_t fileSize;
+	bool is64;
+
+	std::vector<SectHdr> sects;
+	std::vector<uint8_t> shstrtab;
+	std::vector<uint8_t> debugStr;
+	std::vector<uint8_t> debugLineStr;
+
+	TraceDqrProfiler::DQErr readAt(uint64_t offset, uint64_t size, void* buf);
+	TraceDqrProfiler::DQErr readSection(int index, std::vector<uint8_t>& data);
+	const char* sectionName(int index);
+	int findSection(const char* name);
+
+	TraceDqrProfiler::DQErr parseElfHeader(int& archSize);
+	TraceDqrProfiler::DQErr parseSectionList(Section*& codeSectionLst);
+	TraceDqrProfiler::DQErr parseSymbolTable(Sym*& syms, Section* codeSectionLst, StringPool& stringPool);
+	TraceDqrProfiler::DQErr parseCompDirs(std::vector<std::pair<uint64_t, const char*>>& compDirs, std::vector<uint8_t>& info);
+	TraceDqrProfiler::DQErr parseLineTable(Section* codeSectionLst, StringPool& stringPool);
+	TraceDqrProfiler::DQErr setLines(Section* codeSectionLst, TraceDqrProfiler::ADDRESS start, TraceDqrProfiler::ADDRESS end, char* file, uint32_t line);
 };
 
+// Bump whenever the layout of the elf image cache file or what the loaders put in it changes
+
+#define ELF_IMAGE_CACHE_VERSION 3
+
+// class ElfImageCache: Keeps what the elf loaders produce for an elf file (sections with their code and line
+// tables, symbols, source file names) in a binary file in a cache directory, so later sessions can map it in
+// instead of loading the elf file again. The cache file is named from the elf file's path, and holds the
+// path, size, modification time and a hash of the contents of the elf file it was made from. The elf file is
+// only read to hash it when the size matches but the time does not (the file was copied or touched), and if the
+// hash matches the new time is written to the cache file. A cache file that does not match the elf file, or was
+// written by a different version, is ignored and replaced
+
+class ElfImageCache {
+public:
+	ElfImageCache(const char* cacheDir, const char* elfName);
+	~ElfImageCache();
+
+	TraceDqrProfiler::DQErr load(int& archSize, Section*& codeSectionLst, Sym*& syms, StringPool& stringPool);
+	TraceDqrProfiler::DQErr save(int archSize, Section* codeSectionLst, Sym* syms);
+
+private:
+	struct Header {
+		char     magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t cacheSize;	// whole cache file, to catch a truncated file
+		uint64_t elfSize;
+		uint64_t elfTime;
+		uint64_t elfHash;
+		uint32_t archSize;
+		uint32_t numSections;
+		uint32_t numSyms;
+		uint32_t elfPath;	// offset in the string table
+		uint64_t stringsOffset;
+		uint64_t stringsSize;
+		uint64_t sectionsOffset;
+		uint64_t symsOffset;
+	};
+
+	struct SectionRec {
+		uint64_t startAddr;
+		uint64_t endAddr;
+		uint32_t name;
+		uint32_t flags;
+		uint32_t size;
+		uint32_t offset;
+		uint32_t align;
+		uint32_t hasCode;
+		uint32_t numLines;
+		uint32_t numDiss;
+		uint64_t dataOffset;	// code[], then LineRecs, then DissRecs
+	};
+
+	struct LineRec {
+		uint32_t index;
+		uint32_t line;
+		uint32_t file;	// offset in the string table
+	};
+
+	struct DissRec {
+		uint32_t index;
+		uint32_t text;	// offset in the string table
+	};
+
+	struct SymRec {
+		uint64_t address;
+		uint64_t size;
+		uint32_t name;
+		uint32_t flags;
+		int32_t  section;	// index in the section list, or -1
+		int32_t  srcFile;	// index in the symbol list, or -1
+	};
+
+	TraceDqrProfiler::DQErr status;
+
+	char* cacheName;
+	char* elfPath;
+	uint64_t elfSize;
+	uint64_t elfTime;	// modification time, in the file system's own units
+	uint64_t elfHash;
+	bool     haveHash;
+
+	TraceDqrProfiler::DQErr statElfFile();
+	TraceDqrProfiler::DQErr hashElfFile();
+};
+
+// class ElfReader: The sections, symbols and line information of an elf file. Nothing changes once it has been
+// constructed, so one ElfReader can be shared by any number of decoders on any threads. The elf file is read
+// directly, and objdump (odExe) only run if that fails or useObjDump is set
+
 class ElfReader {
 public:
-	ElfReader(const char* elfname, const char* odExe);
+	ElfReader(const char* elfname, const char* odExe, const char* cacheDir = nullptr, bool useObjDump = false);
 	~ElfReader();
 	TraceDqrProfiler::DQErr getStatus() { return status; }
 	TraceDqrProfiler::DQErr getInstructionByAddress(TraceDqrProfiler::ADDRESS addr, TraceDqrProfiler::RV_INST& inst);
+	TraceDqrProfiler::DQErr getInstructionByAddress(TraceDqrProfiler::ADDRESS addr, TraceDqrProfiler::RV_INST& inst, int& plainRun, const DecodedInst*& decoded);
 	Symtab* getSymtab();
 	Section* getSections() { return codeSectionLst; }
+	Section* getCodeSections() { return nextCodeSection(codeSectionLst); }
+	static Section* nextCodeSection(Section* sp);
+	Section* getSectionByAddress(TraceDqrProfiler::ADDRESS addr) { return sectionIndex.getSectionByAddress(addr); }
+	SectionIndex* getSectionIndex() { return &sectionIndex; }
 	int        getArchSize() { return archSize; }
 	int        getBitsPerAddress() { return bitsPerAddress; }
+	const char* getElfName() { return elfName; }
 
 	TraceDqrProfiler::DQErr parseNLSStrings(TraceDqrProfiler::nlStrings* nlsStrings);
 
@@ -305,10 +568,248 @@ private:
 	int         archSize;
 	int         bitsPerAddress;
 	Section* codeSectionLst;
+	SectionIndex sectionIndex;
 	Symtab* symtab;
-	SrcFileRoot srcFileRoot;
+	StringPool stringPool;
 
 	TraceDqrProfiler::DQErr fixupSourceFiles(Section* sections, Sym* syms);
+	static void freeLists(Section*& sections, Sym*& syms);
+};
+
+// class HistogramSummarizer: Running totals of histogram counts by function, source line and basic block, kept up
+// to date from the (address, count increment) pairs ProfilerHistogram::takeChanges() returns, so each report only
+// costs the addresses that changed since the last one. Functions come from the symbol table's address ranges and
+// lines from each section's line ranges. A basic block starts at the start of a function, at the target of a
+// direct jump or branch, and after any control flow instruction; the starts and a dense key for each distinct file
+// and line are worked out per section the first time an address in it is counted. Jumps through a register into
+// the middle of a block, as jump tables do, do not split it
+
+class HistogramSummarizer {
+public:
+	HistogramSummarizer(class ElfReader* elfReader, uint32_t levels);
+
+	uint32_t getLevels() { return levels; }
+	void add(const ProfilerHistogram::Entry* delta, size_t count);
+	void add(const ProfilerHistogram& hist);	// all of hist's counts
+	void clear();	// totals only
+	void getSummary(ProfilerHistogramSummary& summary);
+
+private:
+	struct SectionInfo {
+		bool haveBlocks;
+		bool haveLineKeys;
+		uint32_t firstBlock;	// index in blockCounts of this section's first block
+		std::vector<uint32_t> blockStarts;	// halfword index of the first instruction of each block
+		std::vector<uint32_t> lineKeys;		// key in lineCounts for each of section->lines
+	};
+
+	class ElfReader* elfReader;
+	class Symtab* symtab;
+	uint32_t levels;
+
+	std::unordered_map<Section*, SectionInfo> sections;
+	uint32_t numBlocks;
+
+	// the section and function of the last address added, as consecutive addresses are mostly in the same ones
+
+	Section* lastSection;
+	SectionInfo* lastSectionInfo;
+	const Sym* lastSym;
+	uint32_t lastFuncKey;
+
+	std::map<std::pair<const char*, uint32_t>, uint32_t> lineKeyMap;	// file and line to key
+	std::vector<ProfilerHistogramSummary::LineCount> lineCounts;
+	std::unordered_map<const Sym*, uint32_t> funcKeys;
+	std::vector<ProfilerHistogramSummary::FuncCount> funcCounts;
+	std::vector<ProfilerHistogramSummary::BlockCount> blockCounts;
+	uint64_t outsideCode;
+
+	// keys whose count is not 0, so a summary does not have to look at every function, line and block
+
+	std::vector<uint32_t> usedFuncs;
+	std::vector<uint32_t> usedLines;
+	std::vector<uint32_t> usedBlocks;
+
+	void addCount(TraceDqrProfiler::ADDRESS addr, uint64_t n);
+	SectionInfo& getSectionInfo(Section* sp);
+	void findBlocks(Section* sp, SectionInfo& si);
+	void findLineKeys(Section* sp, SectionInfo& si);
+};
+
+// class CallGraphBuilder: Shadow call stack per core, fed each instruction (or run of straight line instructions)
+// GenerateHistogram() retires. The callee of a call is not known until the first instruction after it, which
+// also covers indirect calls whose target comes from a later trace message. Returning from the bottom frame, as
+// happens when the trace starts part way down the call stack, starts a new bottom frame with no caller
+
+class CallGraphBuilder {
+public:
+	CallGraphBuilder(class ElfReader* elfReader);
+
+	void instructions(int core, TraceDqrProfiler::ADDRESS addr, uint64_t n, TraceDqrProfiler::TIMESTAMP ts);
+	void retire(int core, TraceDqrProfiler::ADDRESS addr, int crFlag, TraceDqrProfiler::TIMESTAMP ts);
+	void interrupt(int core);	// the next instruction is the first of an interrupt handler
+	void resetCore(int core);	// decoder lost sync, so the call stack is unknown
+
+	void snapshot(ProfilerCallGraph& graph);
+
+private:
+	enum {
+		maxDepth = 4096
+	};
+
+	struct Frame {
+		TraceDqrProfiler::ADDRESS caller;	// function making the call
+		int edge;			// index in edges, -1 until the callee is known
+		bool outermost;			// no frame below this one on the core's stack has the same edge
+		uint64_t startInsts;
+		TraceDqrProfiler::TIMESTAMP startTime;
+	};
+
+	struct CoreStack {
+		std::vector<Frame> frames;
+		uint32_t overflow;		// calls not pushed because the stack was at maxDepth
+		uint64_t insts;			// instructions retired on this core
+		TraceDqrProfiler::TIMESTAMP lastTime;
+		std::unordered_map<int, uint32_t> active;	// edge to number of frames with it on this core's stack
+	};
+
+	class Symtab* symtab;
+	bool haveTime;
+
+	std::vector<ProfilerCallGraph::Edge> edges;
+	std::map<std::pair<TraceDqrProfiler::ADDRESS, TraceDqrProfiler::ADDRESS>, int> edgeMap;
+	CoreStack cores[DQR_PROFILER_MAXCORES];
+
+	TraceDqrProfiler::ADDRESS functionOf(TraceDqrProfiler::ADDRESS addr, const char*& name);
+	void enter(CoreStack& cs, TraceDqrProfiler::ADDRESS addr);
+	void advance(CoreStack& cs, uint64_t n, TraceDqrProfiler::TIMESTAMP ts);
+	void push(CoreStack& cs, TraceDqrProfiler::ADDRESS caller);
+	void pop(CoreStack& cs);
+};
+
+// class GzipFile: Writes a gzip file a block at a time. The data goes in stored (uncompressed) deflate blocks, so
+// there is no dependency on zlib; gunzip, pprof and anything else that reads gzip read it as usual
+
+class GzipFile {
+public:
+	GzipFile();
+	~GzipFile();
+
+	TraceDqrProfiler::DQErr open(const char* path);
+	TraceDqrProfiler::DQErr write(const void* data, size_t len);
+	TraceDqrProfiler::DQErr close();
+
+private:
+	enum {
+		blockSize = 0xffff	// largest stored block
+	};
+
+	FILE* fp;
+	std::vector<uint8_t> block;
+	uint32_t crc;
+	uint32_t totalLen;	// modulo 2^32, as the gzip trailer wants it
+	uint32_t crcTable[256];
+
+	TraceDqrProfiler::DQErr writeBlock(bool last);
+};
+
+// class ProfileWriter: Writes what GenerateHistogram() counts to a file. addCounts() gets each batch of (address,
+// count increment) pairs and adds them to a total per address, addCallGraph() gets the call graph once it is
+// complete, and finish() writes one sample per address and per call graph edge and ends the file. Memory use and
+// the size of the file grow with the number of distinct addresses the trace reaches, up to the size of the
+// program's code, not with the number of batches
+
+class ProfileWriter {
+public:
+	ProfileWriter(class ElfReader* elfReader);
+	virtual ~ProfileWriter() {}
+
+	virtual TraceDqrProfiler::DQErr open(const char* path) = 0;
+	void addCounts(const ProfilerHistogram::Entry* delta, size_t count);
+	void addCallGraph(const ProfilerCallGraph& graph) { edges = graph.edges; }
+	virtual TraceDqrProfiler::DQErr finish() = 0;
+
+	TraceDqrProfiler::DQErr getStatus() { return status; }
+
+protected:
+	TraceDqrProfiler::DQErr status;
+	class ElfReader* elfReader;
+	class Symtab* symtab;
+	const char* elfName;
+	std::map<TraceDqrProfiler::ADDRESS, uint64_t> totals;	// instructions per address, in address order
+	std::vector<ProfilerCallGraph::Edge> edges;
+
+	const Sym* lookupFunction(TraceDqrProfiler::ADDRESS addr);
+	const LineRange* lookupLine(TraceDqrProfiler::ADDRESS addr);
+};
+
+// class PprofWriter: Writes a gzip'd pprof profile.proto. Strings, functions and locations are written the first
+// time a sample needs them, which protobuf allows since repeated fields may be split up and interleaved. Sample
+// values are instructions (one location per sample, from the histogram) and calls (callee and caller locations,
+// from the call graph)
+
+class PprofWriter : public ProfileWriter {
+public:
+	PprofWriter(class ElfReader* elfReader);
+	~PprofWriter();
+
+	TraceDqrProfiler::DQErr open(const char* path);
+	TraceDqrProfiler::DQErr finish();
+
+private:
+	// profile.proto field numbers
+
+	enum {
+		profSampleType = 1,
+		profSample = 2,
+		profMapping = 3,
+		profLocation = 4,
+		profFunction = 5,
+		profStringTable = 6,
+		profDefaultSampleType = 14
+	};
+
+	GzipFile out;
+	bool opened;
+	bool haveMapping;
+	std::string msg;	// message being encoded
+	std::string sub;	// nested message or packed field being encoded
+
+	// strings are all from the elf image's StringPool, so one pointer per distinct string
+
+	std::unordered_map<const char*, uint64_t> strings;
+	uint64_t numStrings;
+	std::map<std::pair<const Sym*, const char*>, uint64_t> functions;	// symbol and source file to function id
+	std::unordered_map<TraceDqrProfiler::ADDRESS, uint64_t> locations;	// address to location id
+
+	static void putVarint(std::string& buf, uint64_t v);
+	static void putUint(std::string& buf, int field, uint64_t v);
+	static void putBytes(std::string& buf, int field, const void* data, size_t len);
+
+	TraceDqrProfiler::DQErr writeMessage(int field, const std::string& m);
+	TraceDqrProfiler::DQErr getString(const char* str, uint64_t& index);
+	TraceDqrProfiler::DQErr getFunction(const Sym* sym, const char* file, uint64_t& id);
+	TraceDqrProfiler::DQErr getLocation(TraceDqrProfiler::ADDRESS addr, uint64_t& id);
+	TraceDqrProfiler::DQErr writeSample(const uint64_t* locs, int numLocs, uint64_t insts, uint64_t calls);
+};
+
+// class PerfScriptWriter: Writes the text 'perf script' prints for an instructions event with call chains, so
+// stackcollapse-perf.pl, speedscope and the like can read it. Each address is an instructions event with its
+// count as the period, and each call graph edge is a calls event with the callee and caller as its call chain
+
+class PerfScriptWriter : public ProfileWriter {
+public:
+	PerfScriptWriter(class ElfReader* elfReader);
+	~PerfScriptWriter();
+
+	TraceDqrProfiler::DQErr open(const char* path);
+	TraceDqrProfiler::DQErr finish();
+
+private:
+	FILE* fp;
+
+	void writeFrame(TraceDqrProfiler::ADDRESS addr);
+	TraceDqrProfiler::DQErr writeEvent(const char* event, uint64_t period, TraceDqrProfiler::ADDRESS addr, TraceDqrProfiler::ADDRESS caller, bool haveCaller);
 };
 
 class TsList {
@@ -357,13 +858,287 @@ private:
 	class TsList* freeList;
 };
 
+// Size of the ring used to hand trace data from PushTraceData() to the parser. Must be a power of 2
+#define TRACE_RING_BUFFER_SIZE (4 * 1024 * 1024)
+
+// class TraceRingBuffer: Bounded single producer/single consumer byte queue between PushTraceData()
+// and SliceFileParser. head is only written by the producer and tail only by the consumer, so data
+// moves without locking; the mutex and condition variables are only used when one side has to sleep
+// because the ring is empty or full.
+class TraceRingBuffer {
+public:
+	TraceRingBuffer(uint64_t size);
+	~TraceRingBuffer();
+	TraceDqrProfiler::DQErr getErr() { return status; };
+
+	// producer side
+	TraceDqrProfiler::DQErr push(const uint8_t* p_buff, uint64_t size);
+	void setEndOfData();
+
+	// consumer side
+	TraceDqrProfiler::DQErr getSpan(const uint8_t*& span, uint64_t& len);
+	void release(uint64_t len);
+	void close();
+
+private:
+	TraceDqrProfiler::DQErr status;
+	uint8_t* buffer;
+	uint64_t bufferSize;
+	uint64_t bufferMask;
+
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+
+	std::atomic<bool> endOfData;
+	std::atomic<bool> closed;
+	std::atomic<bool> consumerWaiting;
+	std::atomic<bool> producerWaiting;
+	std::mutex waitMutex;
+	std::condition_variable dataAvailable;
+	std::condition_variable spaceAvailable;
+};
+
+// Trace data a TraceChunkStore may hold before TraceChunkStore::append() waits for the slowest decoder to catch
+// up, and the most freed chunk buffers it keeps to reuse for later pushes
+#define TRACE_CHUNK_STORE_HIGH_WATER (64 * 1024 * 1024)
+#define TRACE_CHUNK_STORE_FREE_BUFFERS 16
+
+// class TraceChunk: One immutable block of trace data in a TraceChunkStore. Chunks are linked in push
+// order, so a chunk stays alive while any cursor is on it or on a chunk before it. The buffer goes back to
+// the store when the chunk is freed
+class TraceChunk {
+public:
+	TraceChunk(class TraceChunkStore* owner, uint8_t* data, uint64_t size, uint64_t capacity);
+	~TraceChunk();
+
+	uint8_t* data;
+	uint64_t size;
+	uint64_t capacity;
+	std::shared_ptr<TraceChunk> next;	// written under TraceChunkStore::storeMutex
+
+private:
+	class TraceChunkStore* owner;
+};
+
+// class TraceChunkStore: Append only store of trace data shared by the decoders of one SifiveProfilerInterface.
+// Each push is copied once and every decoder reads it through its own TraceChunkCursor. Once highWater bytes are
+// waiting for the slowest cursor, append() blocks until it moves on, the same as pushing to a full TraceRingBuffer
+class TraceChunkStore {
+public:
+	TraceChunkStore(uint64_t highWater = TRACE_CHUNK_STORE_HIGH_WATER);
+	~TraceChunkStore();
+	TraceDqrProfiler::DQErr append(const uint8_t* p_buff, uint64_t size);
+
+private:
+	friend class TraceChunkCursor;
+	friend class TraceChunk;
+
+	// buffer accounting has its own lock so chunks can be freed while storeMutex is held
+
+	std::mutex poolMutex;
+	std::condition_variable spaceAvailable;
+	std::vector<std::pair<uint8_t*, uint64_t>> freeBuffers;	// buffer, capacity
+	uint64_t freeBytes;
+	uint64_t liveBytes;	// capacity of the buffers in chunks that are still reachable
+	uint64_t highWater;
+
+	std::mutex storeMutex;
+	std::condition_variable dataAvailable;
+	std::shared_ptr<TraceChunk> tail;
+
+	void recycle(uint8_t* data, uint64_t capacity);
+};
+
+// class TraceChunkCursor: Read position of one decoder in a TraceChunkStore. getSpan() and release() are only
+// called by the thread parsing the trace. close() may be called from any thread, but the span getSpan() returned
+// last is only valid until then, so the parsing thread must be finished with it (or stopped) first
+class TraceChunkCursor {
+public:
+	TraceChunkCursor();
+	void attach(std::shared_ptr<TraceChunkStore>& traceStore);
+	bool isAttached() { return store != nullptr; };
+	void setEndOfData();
+	void close();
+
+	TraceDqrProfiler::DQErr getSpan(const uint8_t*& span, uint64_t& len);
+	void release(uint64_t len) { offset += len; };
+
+private:
+	std::shared_ptr<TraceChunkStore> store;
+	std::shared_ptr<TraceChunk> chunk;
+	uint64_t offset;
+	bool endOfData;	// guarded by store->storeMutex
+	bool closed;	// guarded by store->storeMutex
+};
+
+// Number of parsed messages the parser thread may get ahead of the decoder in pipeline mode. Must be a power of 2
+#define TRACE_MSG_QUEUE_SIZE 4096
+
+// class TraceMsgRecord: One result of SliceFileParser::readNextTraceMsg() passed from the parser thread to the decoder
+class TraceMsgRecord {
+public:
+	ProfilerNexusMessage    nm;
+	TraceDqrProfiler::DQErr rc;
+	bool                    haveMsg;
+	class TraceCoreBatch*   batch;	// where the decoder puts its results for this message in per-core decode mode
+};
+
+// class TraceMsgQueue: Bounded single producer/single consumer queue of parsed messages used in pipeline mode.
+// Slots are filled and drained in place; the producer sleeps when the queue is full and the consumer when it is empty
+class TraceMsgQueue {
+public:
+	TraceMsgQueue(uint32_t size);
+	~TraceMsgQueue();
+	TraceDqrProfiler::DQErr getErr() { return status; };
+
+	// producer side
+	TraceMsgRecord* getWriteSlot();
+	void publish();
+
+	// consumer side
+	TraceMsgRecord* getReadSlot();
+	void release();
+	void close();
+
+private:
+	TraceDqrProfiler::DQErr status;
+	TraceMsgRecord* slots;
+	uint32_t queueSize;
+	uint32_t queueMask;
+
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+
+	std::atomic<bool> closed;
+	std::atomic<bool> consumerWaiting;
+	std::atomic<bool> producerWaiting;
+	std::mutex waitMutex;
+	std::condition_variable msgAvailable;
+	std::condition_variable slotAvailable;
+};
+
+// class TraceSyncPoint: A sync type message (TCODE_SYNC or one of the *_WS tcodes) in a mapped trace file. The
+// decoder can start over from TRACE_STATE_GETFIRSTSYNCMSG at any of these
+class TraceSyncPoint {
+public:
+	uint64_t offset;	// offset the parser reports for the message (just past the end of the previous message)
+	uint64_t endOffset;	// offset just past the end of the message
+};
+
+// Smallest span of trace data decoded as one segment in parallel decode mode. Sync points closer together than
+// this are merged into one segment
+#define PARALLEL_DECODE_SEGMENT_SIZE (256 * 1024)
+
+// Number of decoded segments per worker that may be waiting to be read in parallel decode mode
+#define PARALLEL_DECODE_SEGMENTS_AHEAD 2
+
+// class TraceDecodeSegment: One part of a trace file decoded by a parallel decode worker. The window ends just past
+// the sync message that starts the next segment so the instructions counted by that message are decoded here
+class TraceDecodeSegment {
+public:
+	uint64_t begin;
+	uint64_t end;
+	bool     skipFirst;	// first NextInstruction() result is the start sync, already returned by the previous segment
+
+	// one entry per NextInstruction() result: the message offset, with bit 63 set if an address was returned
+	std::vector<uint64_t> offsets;
+	std::vector<uint64_t> addresses;
+
+	TraceDqrProfiler::DQErr rc;	// DQERR_EOF if the whole window was decoded
+	bool     lostSync;	// decoder gave up on the sync message at the end of the window
+	bool     ready;
+};
+
+// class ParallelTraceDecoder: Splits a mapped trace file at sync points, decodes the segments on a pool of
+// TraceProfiler workers and hands the results back in trace order
+class ParallelTraceDecoder {
+public:
+	ParallelTraceDecoder();
+	~ParallelTraceDecoder();
+
+	TraceDqrProfiler::DQErr start(std::vector<TraceProfiler*>& decoders, std::vector<TraceSyncPoint>& syncPoints, uint64_t traceSize, uint64_t segmentSize);
+	TraceDqrProfiler::DQErr next(uint64_t& offset, uint64_t& address, bool& haveAddress);
+	void stop();
+
+private:
+	std::vector<TraceProfiler*> workers;
+	std::vector<std::thread> workerThreads;
+	std::vector<TraceDecodeSegment> segments;
+
+	std::mutex segmentMutex;
+	std::condition_variable workAvailable;
+	std::condition_variable segmentDone;
+	std::deque<uint32_t> redoSegments;	// segments that have to be decoded again, ahead of everything else
+	uint32_t nextSegment;
+	uint32_t readSegment;
+	uint64_t readIndex;
+	uint64_t readAddress;
+	bool     stopping;
+
+	void workerThread(TraceProfiler* worker);
+};
+
+// Number of messages the demultiplexer may route ahead of the merged results in per-core decode mode. Must be a power of 2
+#define CORE_DECODE_QUEUE_SIZE 4096
+
+// class TraceCoreBatch: One message routed to a per-core decoder, and the NextInstruction() results the decoder
+// produced while that was its current message
+class TraceCoreBatch {
+public:
+	uint64_t offset;
+	TraceDqrProfiler::DQErr rc;	// not DQERR_OK if decoding stopped at this message
+	bool     done;	// guarded by CoreTraceDecoder::batchMutex
+
+	std::vector<uint8_t>  haveAddress;	// one entry per NextInstruction() result
+	std::vector<uint64_t> addresses;
+};
+
+// class CoreTraceDecoder: Routes the messages of a multi-core trace by coreId to one TraceProfiler per core, decodes
+// the cores on their own threads and hands the results back in the order the serial decoder produces them
+class CoreTraceDecoder {
+public:
+	CoreTraceDecoder();
+	~CoreTraceDecoder();
+
+	TraceDqrProfiler::DQErr start(TraceProfiler* source, std::vector<TraceProfiler*>& decoders);
+	TraceDqrProfiler::DQErr next(uint64_t& offset, uint64_t& address, bool& haveAddress);
+	void batchDone(TraceCoreBatch* batch);
+	void stop();
+
+private:
+	TraceProfiler* source;
+	std::vector<TraceProfiler*> workers;
+	std::vector<std::thread> workerThreads;
+	std::thread demuxThread;
+
+	// batches are used in message order. head is advanced by the demultiplexer and tail by next()
+	TraceCoreBatch* batches;
+	uint64_t batchMask;
+	uint64_t head;
+	uint64_t tail;
+	uint64_t readIndex;
+	uint64_t readAddress;
+	bool     stopping;
+
+	std::mutex batchMutex;
+	std::condition_variable batchFree;
+	std::condition_variable batchReady;
+
+	void demultiplexThread();
+	void workerThread(TraceProfiler* worker);
+};
+
+// Bytes scanned per pass of the bulk MSEO message end scan, and the most message ends kept from one pass
+#define MSEO_SCAN_BLOCK_SIZE 4096
+#define MSEO_SCAN_MAX_ENDS   256
+
 // class SliceFileParser: Class to parse binary or ascii nexus messages into a ProfilerNexusMessage object
 class SliceFileParser {
 public:
 	SliceFileParser(char* filename, int srcBits);
 	~SliceFileParser();
 	TraceDqrProfiler::DQErr readNextTraceMsg(ProfilerNexusMessage& nm, class ProfilerAnalytics& analytics, bool& haveMsg);
-	TraceDqrProfiler::DQErr getFileOffset(int& size, int& offset);
+	TraceDqrProfiler::DQErr getFileOffset(uint64_t& size, uint64_t& offset);
 
 	TraceDqrProfiler::DQErr getErr() { return status; };
 	void       dump();
@@ -372,19 +1147,38 @@ public:
     // Function to add data to the message queue
     TraceDqrProfiler::DQErr PushTraceData(uint8_t *p_buff, const uint64_t size)
     {
-        if (!p_buff)
+        if (m_file_input || m_trace_cursor.isAttached())
         {
+            // Data for this parser comes from the mapped trace file or the shared trace store
             return TraceDqrProfiler::DQERR_ERR;
         }
-        std::lock_guard<std::mutex> msg_queue_guard(m_msg_queue_mutex);
-        m_msg_queue.insert(m_msg_queue.end(), p_buff, p_buff + size);
-        return TraceDqrProfiler::DQERR_OK;
+        return m_trace_ring.push(p_buff, size);
     }
     // Function to set end of data
     void SetEndOfData()
     {
-        std::lock_guard<std::mutex> msg_eod_guard(m_end_of_data_mutex);
-        m_end_of_data = true;
+        m_trace_ring.setEndOfData();
+        m_trace_cursor.setEndOfData();
+    }
+    // Function to stop accepting trace data once the consumer is done with it
+    void CloseTraceInput()
+    {
+        m_trace_ring.close();
+        m_trace_cursor.close();
+    }
+    // Function to parse a trace file straight out of a memory mapping of it instead of pushed data
+    TraceDqrProfiler::DQErr mapTraceFile(char* filename);
+    // Functions used to decode parts of a mapped trace file in parallel
+    bool isFileInput() { return m_file_input; }
+    uint64_t getFileSize() { return m_map_size; }
+    TraceDqrProfiler::DQErr indexSyncPoints(std::vector<TraceSyncPoint>& syncPoints);
+    TraceDqrProfiler::DQErr setInputWindow(uint64_t begin, uint64_t end);
+    // Function to read trace data from a store shared with other decoders instead of PushTraceData()
+    void AttachTraceStore(std::shared_ptr<TraceChunkStore>& store)
+    {
+        // A parser reading a mapped trace file ignores pushed data
+        if (!m_file_input)
+            m_trace_cursor.attach(store);
     }
 private:
 	TraceDqrProfiler::DQErr status;
@@ -396,7 +1190,7 @@ private:
 	uint8_t* m_string;
 	uint64_t m_size;
 	uint64_t m_idx;
-	int           tfSize;
+	uint64_t      tfSize;
 	int           SWTsock;
 	int           bitIndex;
 	int           msgSlices;
@@ -409,12 +1203,69 @@ private:
 	int           bufferOutIndex;
 	uint8_t       sockBuffer[2048];
     uint64_t      prev_offset = 0;
-    // Mutex to sync m_msg_queue 
-    std::mutex m_msg_queue_mutex;
-    // Mutex to sync m_end_of_data 
-    std::mutex m_end_of_data_mutex;
-    std::deque<uint8_t> m_msg_queue;
-    bool m_end_of_data;
+    // Trace data pushed by PushTraceData() or read from a shared store, and the span of it currently being parsed
+    TraceRingBuffer m_trace_ring;
+    TraceChunkCursor m_trace_cursor;
+
+    // Memory mapped trace file, used instead of pushed data once mapTraceFile() is called
+    bool m_file_input;
+    uint8_t* m_map_base;
+    uint64_t m_map_size;
+#ifdef WINDOWS
+    HANDLE m_map_file;
+    HANDLE m_map_handle;
+#endif // WINDOWS
+
+    void unmapTraceFile();
+
+    // Message end slices in the current span found by the bulk MSEO scan, and where the scan stopped
+    const uint8_t* m_msg_ends[MSEO_SCAN_MAX_ENDS];
+    int m_msg_ends_count;
+    int m_msg_ends_next;
+    const uint8_t* m_msg_scan_ptr;
+
+    const uint8_t* findMsgEnd(const uint8_t* cur);
+    bool copyQueuedMsgBytes(bool& done);
+
+    // Payload bits of msg[] with the MSEO bits stripped, packed lsb first (64 slices * 6 bits, plus a
+    // word so a field read can always take two words), and masks of the slices that end a field and
+    // that end the message
+    uint64_t m_msg_bits[7];
+    uint64_t m_field_end_slices;
+    uint64_t m_msg_end_slices;
+    bool m_msg_packed;
+
+    void packMsg();
+    uint64_t getMsgBits(int pos, int width)
+    {
+        int w = pos >> 6;
+        int sh = pos & 0x3f;
+        uint64_t v = m_msg_bits[w] >> sh;
+
+        if ((sh != 0) && ((sh + width) > 64))
+            v |= m_msg_bits[w + 1] << (64 - sh);
+        if (width < 64)
+            v &= (((uint64_t)1) << width) - 1;
+        return v;
+    }
+    const uint8_t* m_span;
+    uint64_t m_span_len;
+    uint64_t m_span_idx;
+
+    TraceDqrProfiler::DQErr fetchQueuedSpan();
+    TraceDqrProfiler::DQErr readQueuedByte(uint8_t& byte)
+    {
+        if (m_span_idx >= m_span_len)
+        {
+            TraceDqrProfiler::DQErr rc = fetchQueuedSpan();
+            if (rc != TraceDqrProfiler::DQERR_OK)
+                return rc;
+        }
+        byte = m_span[m_span_idx++];
+        prev_offset++;
+        return TraceDqrProfiler::DQERR_OK;
+    }
+    void releaseQueuedBytes();
 
 	TraceDqrProfiler::DQErr readBinaryMsg(bool& haveMsg);
 	TraceDqrProfiler::DQErr bufferSWT();
@@ -529,6 +1380,8 @@ public:
 	int itcPerfChannel;
 	uint32_t itcPerfMarkerValue;
 
+	std::shared_ptr<ElfReader> elfImage;	// efName already loaded, to use instead of loading it again
+
 private:
 	TraceDqrProfiler::DQErr propertyToBool(const char* src, bool& value);
 };
@@ -537,11 +1390,17 @@ private:
 
 class Disassembler {
 public:
-	Disassembler(Symtab* stp, Section* sp, int archsize);
+	Disassembler(Symtab* stp, Section* sp, int archsize, SectionIndex* sip = nullptr);
 	~Disassembler();
 
 	TraceDqrProfiler::DQErr disassemble(TraceDqrProfiler::ADDRESS addr);
 
+	// disassemble() only fills in the address, instruction and size. Instruction text, address labels and source
+	// information are looked up when asked for with these, and kept per address after that
+
+	TraceDqrProfiler::DQErr getInstructionText(TraceDqrProfiler::ADDRESS addr, const char*& instText, const char*& addressLabel, int& addressLabelOffset);
+	TraceDqrProfiler::DQErr getSourceInfo(TraceDqrProfiler::ADDRESS addr, ProfilerSource& src);
+
 	TraceDqrProfiler::DQErr getSrcLines(TraceDqrProfiler::ADDRESS addr, const char** filename, int* cutPathIndex, const char** functionname, unsigned int* linenumber, const char** lineptr);
 
 	TraceDqrProfiler::DQErr getFunctionName(TraceDqrProfiler::ADDRESS addr, const char*& function, int& offset);
@@ -563,6 +1422,7 @@ private:
 	int               archSize;
 
 	Section* sectionLst;		// owned by elfReader - don't delete
+	SectionIndex* sectionIndex;	// owned by elfReader - don't delete
 	Symtab* symtab;			// owned by elfReader - don't delete
 
 	// cached section information
@@ -574,17 +1434,44 @@ private:
 	ProfilerInstruction instruction;
 	ProfilerSource      source;
 
+	struct ResolvedInfo {
+		bool         haveInstText;
+		bool         haveSource;
+		const char*  instructionText;
+		const char*  addressLabel;
+		int          addressLabelOffset;
+		const char*  sourceFile;
+		int          cutPathIndex;
+		const char*  sourceFunction;
+		const char*  sourceLine;
+		unsigned int sourceLineNum;
+	};
+
+	// per decoder rather than in the shared Section, because source line text comes from this decoder's
+	// fileReader
+
+	std::unordered_map<TraceDqrProfiler::ADDRESS, ResolvedInfo> resolved;
+
 	class fileReader* fileReader;
 
+	// instruction text made by getDissasembly() for images that were not loaded with objdump
+
+	StringPool textPool;
+
 	TraceDqrProfiler::pathType pType;
 
 	TraceDqrProfiler::DQErr getDissasembly(TraceDqrProfiler::ADDRESS addr, char*& dissText);
+	void formatInstruction16(uint32_t inst, TraceDqrProfiler::ADDRESS addr, char* dst, size_t len);
+	void formatInstruction32(uint32_t inst, TraceDqrProfiler::ADDRESS addr, char* dst, size_t len);
+	void formatTarget(TraceDqrProfiler::ADDRESS addr, int32_t offset, char* dst, size_t len);
 	TraceDqrProfiler::DQErr cacheSrcInfo(TraceDqrProfiler::ADDRESS addr);
 
 	TraceDqrProfiler::DQErr lookupInstructionByAddress(TraceDqrProfiler::ADDRESS addr, uint32_t& ins, int& insSize);
 	TraceDqrProfiler::DQErr findNearestLine(TraceDqrProfiler::ADDRESS addr, const char*& file, int& line);
 
 	TraceDqrProfiler::DQErr getInstruction(TraceDqrProfiler::ADDRESS addr, ProfilerInstruction& instruction);
+	Section* findSection(TraceDqrProfiler::ADDRESS addr);
+	ResolvedInfo& getResolved(TraceDqrProfiler::ADDRESS addr);
 
 	// need to make all the decode function static. Might need to move them to public?
 
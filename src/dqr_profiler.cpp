@@ -6,6 +6,9 @@
 #include <fstream>
 #include <cstring>
 #include <cstdint>
+#include <queue>
+#include <string>
+#include <unordered_map>
 #include "unistd_profiler.h"
 //#include <unistd.h>
 #include <fcntl.h>
@@ -18,9 +21,20 @@
 #include <errno.h>
 #include <sys/types.h>
  #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 //#include <sys/wait.h>
 #endif // WINDOWS
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <emmintrin.h>
+#include <immintrin.h>
+#define MSEO_SCAN_SSE2
+#if defined(__GNUC__)
+#define MSEO_SCAN_AVX2
+#endif // __GNUC__
+#endif
+
 #include "dqr_profiler.h"
 #include "dqr_trace_profiler.h"
 
@@ -50,62 +64,6 @@ static int atoh(char a)
 	return -1;
 }
 
-// Section Class Methods
-cachedInstInfo::cachedInstInfo(const char* file, int cutPathIndex, const char* func, int linenum, const char* lineTxt, const char* instText, TraceDqrProfiler::RV_INST inst, int instSize, const char* addresslabel, int addresslabeloffset)
-{
-	// Don't need to allocate and copy file and function. They will remain until trace object is deleted
-
-	filename = file;
-	this->cutPathIndex = cutPathIndex;
-	functionname = func;
-	linenumber = linenum;
-	lineptr = lineTxt;
-
-	instruction = inst;
-	instsize = instSize;
-
-	addressLabel = addresslabel;
-	addressLabelOffset = addresslabeloffset;
-
-	// Need to allocate and copy instruction. src changes every time an instruction is disassembled, so we need to save it
-
-	if (instText != nullptr) {
-		int	s = strlen(instText) + 1;
-		instructionText = new char[s];
-		strcpy(instructionText, instText);
-	}
-	else {
-		instructionText = nullptr;
-	}
-}
-
-cachedInstInfo::~cachedInstInfo()
-{
-	filename = nullptr;
-	functionname = nullptr;
-	lineptr = nullptr;
-	addressLabel = nullptr;
-
-	if (instructionText != nullptr) {
-		delete[] instructionText;
-		instructionText = nullptr;
-	}
-}
-
-void cachedInstInfo::dump()
-{
-	printf("cachedInstInfo()\n");
-	printf("filename: '%s'\n", filename);
-	printf("fucntion: '%s'\n", functionname);
-	printf("linenumber: %d\n", linenumber);
-	printf("lineptr: '%s'\n", lineptr);
-	printf("instructin: 0x%08x\n", instruction);
-	printf("instruction size: %d\n", instsize);
-	printf("instruction text: '%s'\n", instructionText);
-	printf("addressLabel: '%s'\n", addressLabel);
-	printf("addressLabelOffset: %d\n", addressLabelOffset);
-}
-
 // work with elf file sections
 
 Section::Section()
@@ -118,10 +76,10 @@ Section::Section()
 	startAddr = (TraceDqrProfiler::ADDRESS)0;
 	endAddr = (TraceDqrProfiler::ADDRESS)0;
 	code = nullptr;
-	fName = nullptr;
-	line = nullptr;
-	diss = nullptr;
-	cachedInfo = nullptr;
+	numInsts = 0;
+	plainRun = nullptr;
+	decoded = nullptr;
+	pending = nullptr;
 }
 
 Section::~Section()
@@ -131,38 +89,20 @@ Section::~Section()
 		code = nullptr;
 	}
 
-	if (fName != nullptr) {
-		// what fNameo[] points to will be deleted when deleting srcFileRoot object
-		delete[] fName;
-		fName = nullptr;
-	}
+	// what lines[] and diss[] point to will be deleted with the elf image's StringPool
 
-	if (line != nullptr) {
-		delete[] line;
-		line = nullptr;
+	if (pending != nullptr) {
+		delete pending;
+		pending = nullptr;
 	}
 
-	if (diss != nullptr) {
-		for (unsigned int i = 0; i < size / 2; i++) {
-			if (diss[i] != nullptr) {
-				delete[] diss[i];
-				diss[i] = nullptr;
-			}
-		}
-		delete[] diss;
-		diss = nullptr;
+	if (plainRun != nullptr) {
+		delete[] plainRun;
+		plainRun = nullptr;
 	}
-
-	if (cachedInfo != nullptr) {
-		for (unsigned int i = 0; i < size / 2; i++) {
-			if (cachedInfo[i] != nullptr) {
-				delete cachedInfo[i];
-				cachedInfo[i] = nullptr;
-			}
-		}
-
-		delete[] cachedInfo;
-		cachedInfo = nullptr;
+	if (decoded != nullptr) {
+		delete[] decoded;
+		decoded = nullptr;
 	}
 }
 
@@ -170,9 +110,9 @@ void Section::dump()
 {
 	printf("section: %s 0x%08x - 0x%08x, size: %u, flags: 0x%08x\n", name, startAddr, endAddr, size, flags);
 
-	if ((flags & Section::sect_CODE) && (fName != nullptr) && (line != nullptr)) {
-		for (uint32_t i = 0; i < size / 2; i++) {
-			printf("[%u]: addr: 0x%08llx, %s:%d\n", i, startAddr + i * 2, fName[i], line[i]);
+	if (flags & Section::sect_CODE) {
+		for (size_t i = 0; i < lines.size(); i++) {
+			printf("[%u]: addr: 0x%08llx, %s:%d\n", lines[i].index, startAddr + lines[i].index * 2, lines[i].file, lines[i].line);
 		}
 	}
 }
@@ -192,6 +132,111 @@ Section* Section::getSectionByAddress(TraceDqrProfiler::ADDRESS addr)
 	return nullptr;
 }
 
+SectionIndex::SectionIndex()
+{
+	lastRange = 0;
+}
+
+SectionIndex::~SectionIndex()
+{
+	// sections are owned by whoever owns the section list
+}
+
+TraceDqrProfiler::DQErr SectionIndex::build(Section* sections)
+{
+	ranges.clear();
+	lastRange = 0;
+
+	// split the address space at every section boundary, then give each piece to the first section in
+	// the list that covers it. There are only ever a few dozen sections, so this does not need to be clever
+
+	std::vector<TraceDqrProfiler::ADDRESS> bounds;
+
+	for (Section* sp = sections; sp != nullptr; sp = sp->next) {
+		if (sp->endAddr < sp->startAddr) {
+			continue;
+		}
+
+		bounds.push_back(sp->startAddr);
+		if (sp->endAddr != (TraceDqrProfiler::ADDRESS)-1) {
+			bounds.push_back(sp->endAddr + 1);
+		}
+	}
+
+	std::sort(bounds.begin(), bounds.end());
+	bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+	for (size_t i = 0; i < bounds.size(); i++) {
+		TraceDqrProfiler::ADDRESS start = bounds[i];
+		TraceDqrProfiler::ADDRESS end = (i + 1 < bounds.size()) ? bounds[i + 1] - 1 : (TraceDqrProfiler::ADDRESS)-1;
+
+		Section* owner = nullptr;
+
+		for (Section* sp = sections; (sp != nullptr) && (owner == nullptr); sp = sp->next) {
+			if ((start >= sp->startAddr) && (start <= sp->endAddr)) {
+				owner = sp;
+			}
+		}
+
+		if (owner == nullptr) {
+			continue;
+		}
+
+		if (end > owner->endAddr) {
+			end = owner->endAddr;
+		}
+
+		if (!ranges.empty() && (ranges.back().section == owner) && (ranges.back().endAddr + 1 == start)) {
+			ranges.back().endAddr = end;
+		}
+		else {
+			Range r;
+
+			r.startAddr = start;
+			r.endAddr = end;
+			r.section = owner;
+
+			ranges.push_back(r);
+		}
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+Section* SectionIndex::getSectionByAddress(TraceDqrProfiler::ADDRESS addr)
+{
+	uint32_t n = (uint32_t)ranges.size();
+	uint32_t last = lastRange.load(std::memory_order_relaxed);
+
+	if ((last < n) && (addr >= ranges[last].startAddr) && (addr <= ranges[last].endAddr)) {
+		return ranges[last].section;
+	}
+
+	// find the last range starting at or below addr
+
+	uint32_t lo = 0;
+	uint32_t hi = n;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (ranges[mid].startAddr <= addr) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+
+	if ((lo == 0) || (addr > ranges[lo - 1].endAddr)) {
+		return nullptr;
+	}
+
+	lastRange.store(lo - 1, std::memory_order_relaxed);
+
+	return ranges[lo - 1].section;
+}
+
 Section* Section::getSectionByName(char* secName)
 {
 	Section* sp = this;
@@ -207,39 +252,398 @@ Section* Section::getSectionByName(char* secName)
 	return nullptr;
 }
 
-cachedInstInfo* Section::setCachedInfo(TraceDqrProfiler::ADDRESS addr, const char* file, int cutPathIndex, const char* func, int linenum, const char* lineTxt, const char* instTxt, TraceDqrProfiler::RV_INST inst, int instSize, const char* addresslabel, int addresslabeloffset)
+static inline int sectionPopCount(uint64_t bits)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt64(bits);
+#else // _MSC_VER
+	return __builtin_popcountll(bits);
+#endif // _MSC_VER
+}
+
+Section::PendingInfo* Section::getPending()
+{
+	if (pending == nullptr) {
+		pending = new PendingInfo;
+	}
+
+	return pending;
+}
+
+void Section::setSrcLines(uint32_t first, uint32_t end, char* file, uint32_t line)
+{
+	if (first >= end) {
+		return;
+	}
+
+	std::map<uint32_t, LineRange>& m = getPending()->lines;
+
+	// whatever covered end carries on from there
+
+	if (m.find(end) == m.end()) {
+		std::map<uint32_t, LineRange>::iterator it = m.upper_bound(end);
+		LineRange r;
+
+		r.index = end;
+		r.file = nullptr;
+		r.line = 0;
+
+		if (it != m.begin()) {
+			--it;
+			r.file = it->second.file;
+			r.line = it->second.line;
+		}
+
+		m[end] = r;
+	}
+
+	m.erase(m.lower_bound(first), m.lower_bound(end));
+
+	LineRange r;
+
+	r.index = first;
+	r.file = file;
+	r.line = line;
+
+	m[first] = r;
+}
+
+void Section::fillSrcLines(uint32_t first, uint32_t end, char* file, uint32_t line)
+{
+	if (first >= end) {
+		return;
+	}
+
+	std::map<uint32_t, LineRange>& m = getPending()->lines;
+	std::vector<std::pair<uint32_t, uint32_t>> gaps;
+	std::map<uint32_t, LineRange>::iterator it = m.upper_bound(first);
+	uint32_t pos = first;
+	char* cur = nullptr;
+
+	if (it != m.begin()) {
+		std::map<uint32_t, LineRange>::iterator prev = it;
+		--prev;
+		cur = prev->second.file;
+	}
+
+	for (;;) {
+		uint32_t segEnd = ((it == m.end()) || (it->first > end)) ? end : it->first;
+
+		if ((cur == nullptr) && (segEnd > pos)) {
+			gaps.push_back(std::make_pair(pos, segEnd));
+		}
+
+		if ((it == m.end()) || (it->first >= end)) {
+			break;
+		}
+
+		pos = it->first;
+		cur = it->second.file;
+		++it;
+	}
+
+	for (size_t i = 0; i < gaps.size(); i++) {
+		setSrcLines(gaps[i].first, gaps[i].second, file, line);
+	}
+}
+
+void Section::setDiss(uint32_t index, const char* text)
+{
+	getPending()->diss.push_back(std::make_pair(index, text));
+}
+
+void Section::getLineRanges(std::vector<LineRange>& ranges)
+{
+	ranges.clear();
+
+	if (pending == nullptr) {
+		ranges = lines;
+		return;
+	}
+
+	uint32_t numSlots = (size + 1) / 2;
+
+	for (std::map<uint32_t, LineRange>::iterator it = pending->lines.begin(); it != pending->lines.end(); ++it) {
+		if (it->first >= numSlots) {
+			break;
+		}
+
+		if (!ranges.empty() && (ranges.back().file == it->second.file) && (ranges.back().line == it->second.line)) {
+			continue;
+		}
+
+		if (ranges.empty() && (it->first > 0)) {
+			LineRange r;
+
+			r.index = 0;
+			r.file = nullptr;
+			r.line = 0;
+
+			ranges.push_back(r);
+		}
+
+		ranges.push_back(it->second);
+	}
+}
+
+void Section::getDissList(std::vector<std::pair<uint32_t, const char*>>& dissList)
+{
+	dissList.clear();
+
+	if (pending != nullptr) {
+		dissList = pending->diss;
+		return;
+	}
+
+	if (diss.empty()) {
+		return;
+	}
+
+	for (uint32_t w = 0; w < instStart.size(); w++) {
+		for (uint64_t bits = instStart[w]; bits != 0; bits &= bits - 1) {
+			uint32_t index = w * 64 + sectionPopCount((bits & (~bits + 1)) - 1);
+			const char* text = diss[getInstNumber(index)];
+
+			if (text != nullptr) {
+				dissList.push_back(std::make_pair(index, text));
+			}
+		}
+	}
+}
+
+TraceDqrProfiler::DQErr Section::buildIndexes()
 {
-	if ((addr >= startAddr) && (addr <= endAddr)) {
-		if (cachedInfo != nullptr) {
+	// source lines become a sorted list of ranges. Instruction starts are found by walking the code from the
+	// start of the section, the same way objdump does, plus anywhere disassembly text was given. A bit per
+	// halfword and a count every 64 halfwords give the instruction number of any halfword in constant time,
+	// which indexes diss[]
+
+	if (pending != nullptr) {
+		getLineRanges(lines);
+	}
+
+	if (code != nullptr) {
+		uint32_t numSlots = (size + 1) / 2;
+		uint32_t numWords = (numSlots + 63) / 64;
+
+		instStart.assign(numWords, 0);
+		instRank.assign(numWords, 0);
+
+		uint32_t i = 0;
+
+		while (i < numSlots) {
+			uint16_t hw = code[i];
+
+			instStart[i / 64] |= (uint64_t)1 << (i % 64);
+
+			if ((hw & 0x0003) != 0x0003) {
+				i += 1;
+			}
+			else if ((hw & 0x001f) != 0x001f) {
+				i += 2;
+			}
+			else if ((hw & 0x003f) == 0x001f) {
+				i += 3;
+			}
+			else if ((hw & 0x007f) == 0x003f) {
+				i += 4;
+			}
+			else {
+				i += 1;
+			}
+		}
 
-			int index = (addr - startAddr) >> 1;
+		if (pending != nullptr) {
+			for (size_t j = 0; j < pending->diss.size(); j++) {
+				uint32_t index = pending->diss[j].first;
 
-			if (cachedInfo[index] != nullptr) {
-				printf("Error: Section::setCachedInfo(): cachedInfo[%d] not null\n", index);
-				return nullptr;
+				if (index < numSlots) {
+					instStart[index / 64] |= (uint64_t)1 << (index % 64);
+				}
 			}
+		}
+
+		numInsts = 0;
 
-			cachedInstInfo* cci;
-			cci = new cachedInstInfo(file, cutPathIndex, func, linenum, lineTxt, instTxt, inst, instSize, addresslabel, addresslabeloffset);
+		for (uint32_t w = 0; w < numWords; w++) {
+			instRank[w] = numInsts;
+			numInsts += sectionPopCount(instStart[w]);
+		}
+
+		if ((pending != nullptr) && !pending->diss.empty()) {
+			diss.assign(numInsts, nullptr);
 
-			cachedInfo[index] = cci;
+			for (size_t j = 0; j < pending->diss.size(); j++) {
+				int n = getInstNumber(pending->diss[j].first);
 
-			return cci;
+				if (n >= 0) {
+					diss[n] = pending->diss[j].second;
+				}
+			}
 		}
 	}
 
-	return nullptr;
+	if (pending != nullptr) {
+		delete pending;
+		pending = nullptr;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-cachedInstInfo* Section::getCachedInfo(TraceDqrProfiler::ADDRESS addr)
+const LineRange* Section::getSrcLine(uint32_t index)
 {
-	if ((addr >= startAddr) && (addr <= endAddr)) {
-		if (cachedInfo != nullptr) {
-			return cachedInfo[(addr - startAddr) >> 1];
+	// find the last range starting at or below index
+
+	uint32_t lo = 0;
+	uint32_t hi = (uint32_t)lines.size();
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (lines[mid].index <= index) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
 		}
 	}
 
-	return nullptr;
+	if ((lo == 0) || (lines[lo - 1].file == nullptr)) {
+		return nullptr;
+	}
+
+	return &lines[lo - 1];
+}
+
+const char* Section::getDiss(uint32_t index)
+{
+	if (diss.empty()) {
+		return nullptr;
+	}
+
+	int n = getInstNumber(index);
+	if (n < 0) {
+		return nullptr;
+	}
+
+	return diss[n];
+}
+
+int Section::getInstNumber(uint32_t index)
+{
+	uint32_t w = index / 64;
+
+	if (w >= instStart.size()) {
+		return -1;
+	}
+
+	uint64_t bit = (uint64_t)1 << (index % 64);
+
+	if ((instStart[w] & bit) == 0) {
+		return -1;
+	}
+
+	return (int)(instRank[w] + sectionPopCount(instStart[w] & (bit - 1)));
+}
+
+TraceDqrProfiler::DQErr Section::predecode(int archSize)
+{
+	// decode the instruction at every halfword once, so nextAddr() can look it up instead of decoding it
+	// each time it is executed. Runs of straight line code are found working back from the end of the
+	// section. Anything TraceProfiler::nextAddr() does more with than step over (jumps, branches, calls,
+	// returns, exceptions) ends a run, as does an instruction that does not decode or does not fit in the
+	// section. Runs never reach past the end of the section
+
+	if (code == nullptr) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
+	uint32_t numSlots = size / 2;
+
+	plainRun = new (std::nothrow) uint16_t[numSlots];
+	decoded = new (std::nothrow) DecodedInst[numSlots];
+	if ((plainRun == nullptr) || (decoded == nullptr)) {
+		printf("Error: Section::predecode(): could not allocate predecoded instruction tables\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	for (uint32_t i = numSlots; i > 0; i--) {
+		uint32_t index = i - 1;
+		uint32_t inst = code[index];
+		uint32_t run = 0;
+
+		decoded[index] = DecodedInst();
+
+		if ((inst & 0x0003) != 0x0003) {
+			run = 1;
+		}
+		else if (((inst & 0x1f) != 0x1f) && (index + 1 < numSlots)) {
+			inst |= ((uint32_t)code[index + 1]) << 16;
+			run = 2;
+		}
+
+		if (run != 0) {
+			int inst_size;
+			TraceDqrProfiler::InstType inst_type;
+			TraceDqrProfiler::Reg rs1;
+			TraceDqrProfiler::Reg rd;
+			int32_t immediate;
+			bool is_branch;
+
+			if (Disassembler::decodeInstruction(inst, archSize, inst_size, inst_type, rs1, rd, immediate, is_branch) != 0) {
+				run = 0;
+			}
+			else {
+				decoded[index].immediate = immediate;
+				decoded[index].instType = (uint8_t)inst_type;
+				decoded[index].rs1 = (uint8_t)rs1;
+				decoded[index].rd = (uint8_t)rd;
+				decoded[index].instSize = inst_size;
+				decoded[index].isBranch = is_branch;
+				decoded[index].valid = 1;
+
+				switch (inst_type) {
+				case TraceDqrProfiler::INST_JAL:
+				case TraceDqrProfiler::INST_JALR:
+				case TraceDqrProfiler::INST_BEQ:
+				case TraceDqrProfiler::INST_BNE:
+				case TraceDqrProfiler::INST_BLT:
+				case TraceDqrProfiler::INST_BGE:
+				case TraceDqrProfiler::INST_BLTU:
+				case TraceDqrProfiler::INST_BGEU:
+				case TraceDqrProfiler::INST_C_BEQZ:
+				case TraceDqrProfiler::INST_C_BNEZ:
+				case TraceDqrProfiler::INST_C_J:
+				case TraceDqrProfiler::INST_C_JAL:
+				case TraceDqrProfiler::INST_C_JR:
+				case TraceDqrProfiler::INST_C_JALR:
+				case TraceDqrProfiler::INST_EBREAK:
+				case TraceDqrProfiler::INST_ECALL:
+				case TraceDqrProfiler::INST_MRET:
+				case TraceDqrProfiler::INST_SRET:
+				case TraceDqrProfiler::INST_URET:
+					run = 0;
+					break;
+				default:
+					if (index + run < numSlots) {
+						run += plainRun[index + run];
+					}
+					break;
+				}
+			}
+		}
+
+		if (run > 0xffff) {
+			// only the start of a very long run is cut short. It is picked up again further on
+
+			run = 0xffff;
+		}
+
+		plainRun[index] = (uint16_t)run;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
 }
 
 int        ProfilerInstruction::addrSize;
@@ -309,11 +713,13 @@ void ProfilerInstruction::instructionToText(char* dst, size_t len, int labelLeve
 
 	//	should cache this (as part of other instruction stuff cached)!!
 
+	const char* text = (instructionText != nullptr) ? instructionText : "";
+
 	if (instSize == 32) {
-		snprintf(dst, len, "%08x    %s", instruction, instructionText);
+		snprintf(dst, len, "%08x    %s", instruction, text);
 	}
 	else {
-		snprintf(dst, len, "%04x        %s", instruction, instructionText);
+		snprintf(dst, len, "%04x        %s", instruction, text);
 	}
 }
 
@@ -497,12 +903,30 @@ std::string ProfilerSource::sourceFunctionToString()
 	return std::string("");
 }
 
-fileReader::fileReader(/*paths*/)
+static bool srcFileReadable(const char* name)
+{
+	FILE* fp = fopen(name, "rb");
+	if (fp == nullptr) {
+		return false;
+	}
+
+	fclose(fp);
+	fp = nullptr;
+
+	return true;
+}
+
+fileReader::fileReader(/*paths*/)
 {
 	lastFile = nullptr;
 	files = nullptr;
 	cutPath = nullptr;
 	newRoot = nullptr;
+
+	lruHead = nullptr;
+	lruTail = nullptr;
+	cacheBudget = defaultCacheBudget;
+	cacheUsed = 0;
 }
 
 fileReader::~fileReader()
@@ -530,23 +954,25 @@ fileReader::~fileReader()
 			func = nextFunc;
 		}
 
+		unindexFile(fl);
+
 		if (fl->name != nullptr) {
 			delete[] fl->name;
 			fl->name = nullptr;
 		}
 
-		if (fl->lines != nullptr) {
-			if (fl->lines[0] != nullptr) {
-				delete[] fl->lines[0];
-			}
-			delete fl->lines;
-			fl->lines = nullptr;
+		if (fl->path != nullptr) {
+			delete[] fl->path;
+			fl->path = nullptr;
 		}
 
+		delete fl;
+
 		fl = nextFl;
 	}
 
 	files = nullptr;
+	lastFile = nullptr;
 }
 
 fileReader::fileList* fileReader::readFile(const char* file)
@@ -556,8 +982,9 @@ fileReader::fileList* fileReader::readFile(const char* file)
 		return nullptr;
 	}
 
-	std::ifstream  f;
 	const char* original_file_name = file;
+	const char* foundName = nullptr;
+	char* newName = nullptr;
 	int fi = 0; // file name inmdex
 
 	if ((cutPath != nullptr) && (cutPath[0] != 0)) {
@@ -659,7 +1086,6 @@ fileReader::fileList* fileReader::readFile(const char* file)
 		if ((match == true) && (newRoot != nullptr)) {
 			int fl = strlen(&file[fi]);
 			int rl = strlen(newRoot);
-			char* newName;
 			newName = new char[fl + rl + 1];
 
 			strcpy(newName, newRoot);
@@ -667,19 +1093,19 @@ fileReader::fileList* fileReader::readFile(const char* file)
 
 			//			printf("newName: %s\n",newName);
 
-			f.open(newName, std::ifstream::binary);
-
-			delete[] newName;
-			newName = nullptr;
+			if (srcFileReadable(newName)) {
+				foundName = newName;
+			}
 		}
-		else {
-			f.open(&file[fi], std::ifstream::binary);
+		else if (srcFileReadable(&file[fi])) {
+			foundName = &file[fi];
 		}
 	}
 	else {
-		f.open(file, std::ifstream::binary);
-
-		if (!f) {
+		if (srcFileReadable(file)) {
+			foundName = file;
+		}
+		else {
 			//		printf("Error: readFile(): could not open file %s for input\n",file);
 
 					// try again after stripping off path
@@ -692,9 +1118,8 @@ fileReader::fileList* fileReader::readFile(const char* file)
 				}
 			}
 
-			if (l != -1) {
-				file = &file[l + 1];
-				f.open(file, std::ifstream::binary);
+			if ((l != -1) && srcFileReadable(&file[l + 1])) {
+				foundName = &file[l + 1];
 			}
 		}
 	}
@@ -712,96 +1137,268 @@ fileReader::fileList* fileReader::readFile(const char* file)
 	fl->name = name;
 	fl->cutPathIndex = fi;
 
-	if (!f) {
-		// always return a file list pointer, even if a file isn't found. If file not
-		// found, lines will be null
+	// always return a file list pointer, even if a file isn't found. If file not
+	// found, path will be null and there will be no lines. The file is not mapped
+	// until one of its lines is needed
 
-		fl->lineCount = 0;
-		fl->lines = nullptr;
+	if (foundName != nullptr) {
+		fl->path = new char[strlen(foundName) + 1];
+		strcpy(fl->path, foundName);
+	}
+	else {
+		fl->path = nullptr;
+	}
 
-		return fl;
+	if (newName != nullptr) {
+		delete[] newName;
+		newName = nullptr;
 	}
 
-	// get length of file:
+	fl->indexed = false;
+	fl->lineCount = 0;
+	fl->data = nullptr;
+	fl->length = 0;
+	fl->cost = 0;
+	fl->lruPrev = nullptr;
+	fl->lruNext = nullptr;
+
+	return fl;
+}
 
-	f.seekg(0, f.end);
-	int length = f.tellg();
-	f.seekg(0, f.beg);
+TraceDqrProfiler::DQErr fileReader::indexFile(fileList* fl)
+{
+	if (fl == nullptr) {
+		printf("Error: fileReader::indexFile(): Null fl argument\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	// allocate memory:
+	if (fl->indexed) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-	char* buffer = new char[length + 1]; // allocate an extra byte in case the file does not end with \n
+	if (fl->path == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	// read file into buffer
+	const char* data = nullptr;
+	size_t length = 0;
 
-	f.read(buffer, length);
+#ifdef WINDOWS
+	HANDLE mapFile = CreateFileA(fl->path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (mapFile == INVALID_HANDLE_VALUE) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	f.close();
+	LARGE_INTEGER fileSize;
+	bool ok = GetFileSizeEx(mapFile, &fileSize) != 0;
 
-	// count lines
+	if (ok && (fileSize.QuadPart > 0)) {
+		length = (size_t)fileSize.QuadPart;
 
-	int lc = 1;
+		HANDLE mapHandle = CreateFileMapping(mapFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapHandle != nullptr) {
+			// the view keeps the mapping alive after the handles are closed
 
-	for (int i = 0; i < length; i++) {
-		if (buffer[i] == '\n') {
-			lc += 1;
+			data = (const char*)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapHandle);
 		}
-		else if (i == length - 1) {
-			// last line does not have a \n
-			lc += 1;
+
+		ok = data != nullptr;
+	}
+
+	CloseHandle(mapFile);
+#else // WINDOWS
+	int fd = open(fl->path, O_RDONLY);
+	if (fd < 0) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	struct stat sb;
+	bool ok = fstat(fd, &sb) == 0;
+
+	if (ok && (sb.st_size > 0)) {
+		length = (size_t)sb.st_size;
+
+		void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			data = (const char*)p;
 		}
+
+		ok = data != nullptr;
 	}
 
-	// create array of line pointers
+	close(fd);
+#endif // WINDOWS
+
+	if (!ok) {
+		printf("Error: fileReader::indexFile(): Could not map file %s\n", fl->path);
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	char** lines = new char* [lc];
+	// lines end at \n. A last line without a \n still counts, but a trailing \n does not start another line.
+	// Offsets are 32 bits; nobody has a source file that big
 
-	// initialize arry of ptrs
+	if (length > UINT32_MAX) {
+		length = UINT32_MAX;
+	}
 
-	int l;
-	int s;
+	fl->lineStarts.clear();
 
-	l = 0;
-	s = 1;
+	if (length > 0) {
+		fl->lineStarts.push_back(0);
 
-	for (int i = 0; i < length; i++) {
-		if (s != 0) {
-			lines[l] = &buffer[i];
-			l += 1;
-			s = 0;
-		}
+		for (const char* cp = (const char*)memchr(data, '\n', length); cp != nullptr;) {
+			size_t next = (size_t)(cp - data) + 1;
 
-		// strip out CRs and LFs
+			if (next >= length) {
+				break;
+			}
 
-		if (buffer[i] == '\r') {
-			buffer[i] = 0;
-		}
-		else if (buffer[i] == '\n') {
-			buffer[i] = 0;
-			s = 1;
+			fl->lineStarts.push_back((uint32_t)next);
+			cp = (const char*)memchr(data + next, '\n', length - next);
 		}
 	}
 
-	buffer[length] = 0;	// make sure last line is nul terminated
+	fl->data = data;
+	fl->length = length;
+	fl->lineCount = (unsigned int)fl->lineStarts.size();
+	fl->lineText.assign(fl->lineCount, nullptr);
+	fl->cost = length + fl->lineStarts.capacity() * sizeof(uint32_t) + fl->lineText.capacity() * sizeof(const char*);
+	fl->indexed = true;
 
-	if (l >= lc) {
-		delete[] lines;
-		delete[] buffer;
+	cacheUsed += fl->cost;
+	lruPushFront(fl);
+
+	trimCache(fl);
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+void fileReader::unindexFile(fileList* fl)
+{
+	if ((fl == nullptr) || (fl->indexed == false)) {
+		return;
+	}
+
+	lruUnlink(fl);
+
+	if (fl->data != nullptr) {
+#ifdef WINDOWS
+		UnmapViewOfFile(fl->data);
+#else // WINDOWS
+		munmap((void*)fl->data, fl->length);
+#endif // WINDOWS
+		fl->data = nullptr;
+	}
+
+	// lines already handed out live in textPool, so they stay valid. lineCount is kept for anyone still looking
+
+	std::vector<uint32_t>().swap(fl->lineStarts);
+	std::vector<const char*>().swap(fl->lineText);
+
+	cacheUsed -= fl->cost;
+	fl->cost = 0;
+	fl->length = 0;
+	fl->indexed = false;
+}
+
+void fileReader::lruUnlink(fileList* fl)
+{
+	if (fl->lruPrev != nullptr) {
+		fl->lruPrev->lruNext = fl->lruNext;
+	}
+	else if (lruHead == fl) {
+		lruHead = fl->lruNext;
+	}
+
+	if (fl->lruNext != nullptr) {
+		fl->lruNext->lruPrev = fl->lruPrev;
+	}
+	else if (lruTail == fl) {
+		lruTail = fl->lruPrev;
+	}
+
+	fl->lruPrev = nullptr;
+	fl->lruNext = nullptr;
+}
+
+void fileReader::lruPushFront(fileList* fl)
+{
+	fl->lruPrev = nullptr;
+	fl->lruNext = lruHead;
+
+	if (lruHead != nullptr) {
+		lruHead->lruPrev = fl;
+	}
+	else {
+		lruTail = fl;
+	}
+
+	lruHead = fl;
+}
+
+void fileReader::trimCache(fileList* keep)
+{
+	// never unmap the file being used, even if it alone is over budget
+
+	while ((cacheUsed > cacheBudget) && (lruTail != nullptr) && (lruTail != keep)) {
+		unindexFile(lruTail);
+	}
+}
+
+void fileReader::setCacheBudget(size_t bytes)
+{
+	cacheBudget = bytes;
 
-		fl->lineCount = 0;
-		fl->lines = nullptr;
+	trimCache(lruHead);
+}
 
-		printf("Error: readFile(): Error computing line count for file %s, l:%d, lc: %d\n", file, l, lc);
+const char* fileReader::getLine(fileList* fl, unsigned int line)
+{
+	if (fl == nullptr) {
+		printf("Error: fileReader::getLine(): Null fl argument\n");
+		return nullptr;
+	}
 
+	if (fl->path == nullptr) {
 		return nullptr;
 	}
 
-	lines[l] = nullptr;
+	if (fl->indexed == false) {
+		if (indexFile(fl) != TraceDqrProfiler::DQERR_OK) {
+			return nullptr;
+		}
+	}
+	else if (lruHead != fl) {
+		lruUnlink(fl);
+		lruPushFront(fl);
+	}
 
-	fl->lineCount = l;
-	fl->lines = lines;
+	// line numbers start at 1
 
-	return fl;
+	if ((line < 1) || (line > fl->lineCount)) {
+		return nullptr;
+	}
+
+	const char*& text = fl->lineText[line - 1];
+
+	if (text == nullptr) {
+		// a line ends at the first \r or \n, or at the end of the file
+
+		size_t start = fl->lineStarts[line - 1];
+		size_t end = (line < fl->lineCount) ? fl->lineStarts[line] : fl->length;
+		size_t len;
+
+		for (len = 0; (start + len < end) && (fl->data[start + len] != '\r') && (fl->data[start + len] != '\n'); len++) {
+			// empty
+		}
+
+		std::string s(&fl->data[start], len);
+
+		text = textPool.intern(s.c_str());
+	}
+
+	return text;
 }
 
 fileReader::fileList* fileReader::findFile(const char* file)
@@ -956,6 +1553,7 @@ Symtab::Symtab(Sym* syms)
 	status = TraceDqrProfiler::DQERR_OK;
 
 	numSyms = 0;
+	cachedRange = 0;
 
 	if (syms == nullptr) {
 		printf("Info: No symbol information\n");
@@ -966,10 +1564,6 @@ Symtab::Symtab(Sym* syms)
 		return;
 	}
 
-	cachedSymAddr = 0;
-	cachedSymSize = 0;
-	cachedSymIndex = -1;
-
 	symLst = syms;
 
 	Sym* symPtr;
@@ -997,6 +1591,12 @@ Symtab::Symtab(Sym* syms)
 	TraceDqrProfiler::DQErr rc;
 
 	rc = fixupFunctionSizes();
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = rc;
+		return;
+	}
+
+	rc = buildAddressIndex();
 	if (rc != TraceDqrProfiler::DQERR_OK) {
 		status = rc;
 	}
@@ -1013,10 +1613,9 @@ Symtab::~Symtab()
 
 			nextSym->srcFile = nullptr;
 
-			if (nextSym->name != nullptr) {
-				delete[] nextSym->name;
-				nextSym->name = nullptr;
-			}
+			// the name belongs to the elf image's StringPool
+
+			nextSym->name = nullptr;
 
 			delete nextSym;
 			nextSym = tmpSymPtr;
@@ -1078,38 +1677,109 @@ TraceDqrProfiler::DQErr Symtab::fixupFunctionSizes()
 	return TraceDqrProfiler::DQERR_OK;
 }
 
+TraceDqrProfiler::DQErr Symtab::buildAddressIndex()
+{
+	// symbols can overlap (section and file symbols, aliases), and a lookup has to return the first symbol in
+	// symPtrArray that covers the address. Sweep the symbol boundaries in address order, keeping the symbols
+	// covering the current address in a heap ordered by their index in symPtrArray
+
+	symRanges.clear();
+
+	std::vector<std::pair<TraceDqrProfiler::ADDRESS, int>> starts;
+	std::vector<TraceDqrProfiler::ADDRESS> bounds;
+
+	for (int i = 0; i < numSyms; i++) {
+		Sym* sp = symPtrArray[i];
+
+		if ((sp == nullptr) || (sp->size == 0) || (sp->address + sp->size < sp->address)) {
+			continue;
+		}
+
+		starts.push_back(std::make_pair(sp->address, i));
+		bounds.push_back(sp->address);
+		bounds.push_back(sp->address + sp->size);
+	}
+
+	std::sort(starts.begin(), starts.end());
+	std::sort(bounds.begin(), bounds.end());
+	bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+	std::priority_queue<int, std::vector<int>, std::greater<int>> active;
+	size_t nextStart = 0;
+
+	for (size_t b = 0; b + 1 < bounds.size(); b++) {
+		TraceDqrProfiler::ADDRESS start = bounds[b];
+		TraceDqrProfiler::ADDRESS end = bounds[b + 1];
+
+		while ((nextStart < starts.size()) && (starts[nextStart].first == start)) {
+			active.push(starts[nextStart].second);
+			nextStart += 1;
+		}
+
+		// drop symbols that ended at or before this range. Only the top matters, the rest go when they surface
+
+		while (!active.empty() && (symPtrArray[active.top()]->address + symPtrArray[active.top()]->size <= start)) {
+			active.pop();
+		}
+
+		if (active.empty()) {
+			continue;
+		}
+
+		int index = active.top();
+
+		if (!symRanges.empty() && (symRanges.back().index == index) && (symRanges.back().endAddr == start)) {
+			symRanges.back().endAddr = end;
+		}
+		else {
+			SymRange r;
+
+			r.startAddr = start;
+			r.endAddr = end;
+			r.index = index;
+
+			symRanges.push_back(r);
+		}
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
 TraceDqrProfiler::DQErr Symtab::lookupSymbolByAddress(TraceDqrProfiler::ADDRESS addr, Sym*& sym) {
 	if (addr == 0) {
 		sym = nullptr;
 		return TraceDqrProfiler::DQERR_ERR;
 	}
 
+	uint32_t n = (uint32_t)symRanges.size();
+
 	// check for a cache hit
-	if ((addr >= cachedSymAddr) && (addr < (cachedSymAddr + cachedSymSize))) {
-		if (cachedSymIndex < 0 || cachedSymIndex >= numSyms) {
-			sym = nullptr;
-			return TraceDqrProfiler::DQERR_ERR;
-		}
-		sym = symPtrArray[cachedSymIndex];
+	uint32_t cached = cachedRange.load(std::memory_order_relaxed);
+	if ((cached < n) && (addr >= symRanges[cached].startAddr) && (addr < symRanges[cached].endAddr)) {
+		sym = symPtrArray[symRanges[cached].index];
 		return TraceDqrProfiler::DQERR_OK;
 	}
 
-	// not in cache, go look for it
-	int found = -1;
-	for (int i = 0; (found == -1) && (i < numSyms); i++) {
-		if (symPtrArray[i] == nullptr) {
-			continue;
+	// not in cache, find the last range starting at or below addr
+
+	uint32_t lo = 0;
+	uint32_t hi = n;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (symRanges[mid].startAddr <= addr) {
+			lo = mid + 1;
 		}
-		if ((addr >= symPtrArray[i]->address) && (addr < (symPtrArray[i]->address + symPtrArray[i]->size))) {
-			found = i;
+		else {
+			hi = mid;
 		}
 	}
 
-	if (found >= 0) {
+	if ((lo > 0) && (addr < symRanges[lo - 1].endAddr)) {
 		// found - cache it
-		cachedSymIndex = found;
-		cachedSymAddr = symPtrArray[found]->address;
-		sym = symPtrArray[found];
+		cachedRange.store(lo - 1, std::memory_order_relaxed);
+		sym = symPtrArray[symRanges[lo - 1].index];
 	}
 	else {
 		sym = nullptr;
@@ -1202,7 +1872,7 @@ void Symtab::dump()
 	}
 }
 
-ObjDump::ObjDump(const char* elfName, const char* objdumpPath, int& archSize, Section*& codeSectionLst, Sym*& syms, SrcFileRoot& srcFileRoot)
+ObjDump::ObjDump(const char* elfName, const char* objdumpPath, int& archSize, Section*& codeSectionLst, Sym*& syms, StringPool& stringPool)
 {
 	TraceDqrProfiler::DQErr rc;
 
@@ -1224,14 +1894,14 @@ ObjDump::ObjDump(const char* elfName, const char* objdumpPath, int& archSize, Se
 		return;
 	}
 
-	rc = parseObjdump(archSize, codeSectionLst, syms, srcFileRoot);
+	rc = parseObjdump(archSize, codeSectionLst, syms, stringPool);
 
 #ifndef WINDOWS
 
-	int status;
-	status = 0;
+	int exitStatus;
+	exitStatus = 0;
 
-	waitpid(objdumpPid, &status, 0);
+	waitpid(objdumpPid, &exitStatus, 0);
 
 #endif	// WINDOWS
 
@@ -2718,7 +3388,7 @@ TraceDqrProfiler::DQErr ObjDump::parseFuncName()
 	return TraceDqrProfiler::DQERR_OK;
 }
 
-TraceDqrProfiler::DQErr ObjDump::parseDisassemblyList(objDumpTokenType& nextType, char* nextLex, Section* codeSectionLst, SrcFileRoot& srcFileRoot)
+TraceDqrProfiler::DQErr ObjDump::parseDisassemblyList(objDumpTokenType& nextType, char* nextLex, Section* codeSectionLst, StringPool& stringPool)
 {
 	objDumpTokenType type;
 	char lex[1024];
@@ -2754,27 +3424,6 @@ TraceDqrProfiler::DQErr ObjDump::parseDisassemblyList(objDumpTokenType& nextType
 		sp->code = new uint16_t[(sp->size + 1) / 2]; // don't need to init to 0's
 	}
 
-	if (sp->diss == nullptr) {
-		sp->diss = new char* [(sp->size + 1) / 2];
-		for (int i = 0; i < (int)(sp->size + 1) / 2; i++) {
-			sp->diss[i] = nullptr;
-		}
-	}
-
-	if (sp->line == nullptr) {
-		sp->line = new uint32_t[(sp->size + 1) / 2];
-		for (int i = 0; i < (int)(sp->size + 1) / 2; i++) {
-			sp->line[i] = 0;
-		}
-	}
-
-	if (sp->fName == nullptr) {
-		sp->fName = new char* [(sp->size + 1) / 2];
-		for (int i = 0; i < (int)(sp->size + 1) / 2; i++) {
-			sp->fName[i] = nullptr;
-		}
-	}
-
 	type = getNextLex(lex);
 	if (type != odtt_colon) {
 		printf("Error: parseDisassemblyList(): Expected ':'\n");
@@ -2916,20 +3565,15 @@ TraceDqrProfiler::DQErr ObjDump::parseDisassemblyList(objDumpTokenType& nextType
 					sp->code[index + 1] = (uint16_t)(value >> 16);
 				}
 
-				int len;
-				len = strlen(lex) + 1;
-
-				sp->diss[index] = new char[len];
-				strcpy(sp->diss[index], lex);
+				sp->setDiss(index, stringPool.intern(lex));
 
 				// save file and line here. They are set below and remain valid until they are updated
 
-				sp->fName[index] = fName;
-				sp->line[index] = line;
+				sp->setSrcLines(index, index + ((length == 32) ? 2 : 1), fName, line);
 				break;
 			case line_t_path:
 				sprintf(lex2, "%X:%s", (uint32_t)addr, lex);
-				fName = srcFileRoot.addFile(lex2);
+				fName = stringPool.intern(lex2);
 				line = value;
 				break;
 			case line_t_func:
@@ -2952,7 +3596,7 @@ TraceDqrProfiler::DQErr ObjDump::parseDisassemblyList(objDumpTokenType& nextType
 				return TraceDqrProfiler::DQERR_ERR;
 			}
 
-			fName = srcFileRoot.addFile(lex);
+			fName = stringPool.intern(lex);
 		}
 		else {	// case 5, reset of case 4
 			// have a string. look ahead and see if it is a '(', ':' (case 5, rest of case 4)
@@ -2973,7 +3617,7 @@ TraceDqrProfiler::DQErr ObjDump::parseDisassemblyList(objDumpTokenType& nextType
 			case line_t_path: // case 4
 				strcat(lex, ":");
 				strcat(lex, lex2);
-				fName = srcFileRoot.addFile(lex2);
+				fName = stringPool.intern(lex2);
 				line = value;
 				break;
 			case line_t_func: // case 5
@@ -3243,7 +3887,7 @@ TraceDqrProfiler::DQErr ObjDump::parseSymbol(bool& haveSym, char* secName, char*
 	return TraceDqrProfiler::DQERR_OK;
 }
 
-TraceDqrProfiler::DQErr ObjDump::parseSymbolTable(objDumpTokenType& nextType, char* nextLex, Sym*& syms, Section*& codeSectionLst)
+TraceDqrProfiler::DQErr ObjDump::parseSymbolTable(objDumpTokenType& nextType, char* nextLex, Sym*& syms, Section*& codeSectionLst, StringPool& stringPool)
 {
 	objDumpTokenType type;
 	char lex[256];
@@ -3319,8 +3963,7 @@ TraceDqrProfiler::DQErr ObjDump::parseSymbolTable(objDumpTokenType& nextType, ch
 			sp = new Sym();
 
 			sp->next = syms;
-			sp->name = new char[strlen(symName) + 1];
-			strcpy(sp->name, symName);
+			sp->name = stringPool.intern(symName);
 			sp->flags = symFlags;
 			sp->address = addr;
 			sp->size = symSize;
@@ -3353,7 +3996,7 @@ TraceDqrProfiler::DQErr ObjDump::parseSymbolTable(objDumpTokenType& nextType, ch
 	return TraceDqrProfiler::DQERR_ERR;
 }
 
-TraceDqrProfiler::DQErr ObjDump::parseObjdump(int& archSize, Section*& codeSectionLst, Sym*& symLst, SrcFileRoot& srcFileRoot)
+TraceDqrProfiler::DQErr ObjDump::parseObjdump(int& archSize, Section*& codeSectionLst, Sym*& symLst, StringPool& stringPool)
 {
 	TraceDqrProfiler::DQErr rc;
 	objDumpTokenType type;
@@ -3395,13 +4038,13 @@ TraceDqrProfiler::DQErr ObjDump::parseObjdump(int& archSize, Section*& codeSecti
 
 	while (type == odtt_string) {
 		if (strcasecmp("disassembly", lex) == 0) {
-			rc = parseDisassemblyList(type, lex, codeSectionLst, srcFileRoot);
+			rc = parseDisassemblyList(type, lex, codeSectionLst, stringPool);
 			if (rc != TraceDqrProfiler::DQERR_OK) {
 				return TraceDqrProfiler::DQERR_ERR;
 			}
 		}
 		else if (strcasecmp("symbol", lex) == 0) {
-			rc = parseSymbolTable(type, lex, symLst, codeSectionLst);
+			rc = parseSymbolTable(type, lex, symLst, codeSectionLst, stringPool);
 			if (rc != TraceDqrProfiler::DQERR_OK) {
 				return TraceDqrProfiler::DQERR_ERR;
 			}
@@ -3420,5489 +4063,8289 @@ TraceDqrProfiler::DQErr ObjDump::parseObjdump(int& archSize, Section*& codeSecti
 	return TraceDqrProfiler::DQERR_OK;
 }
 
-SrcFile::SrcFile(char* fName, SrcFile* nxt)
-{
-	int len;
-	len = strlen(fName) + 1;
+// native elf/dwarf loader. Fills in the same section, symbol and line structures as ObjDump, without running
+// objdump and parsing its output
+
+enum {
+	ELF_CLASS32 = 1,
+	ELF_CLASS64 = 2,
+	ELF_DATA2LSB = 1,
+	ELF_EM_RISCV = 243,
+
+	ELF_SHT_NULL = 0,
+	ELF_SHT_PROGBITS = 1,
+	ELF_SHT_SYMTAB = 2,
+	ELF_SHT_NOBITS = 8,
+
+	ELF_SHF_WRITE = 0x1,
+	ELF_SHF_ALLOC = 0x2,
+	ELF_SHF_EXECINSTR = 0x4,
+	ELF_SHF_TLS = 0x400,
+
+	ELF_SHN_UNDEF = 0,
+	ELF_SHN_LORESERVE = 0xff00,
+	ELF_SHN_COMMON = 0xfff2,
+	ELF_SHN_XINDEX = 0xffff,
+
+	ELF_STB_LOCAL = 0,
+	ELF_STB_GLOBAL = 1,
+	ELF_STB_WEAK = 2,
+	ELF_STB_GNU_UNIQUE = 10,
+
+	ELF_STT_OBJECT = 1,
+	ELF_STT_FUNC = 2,
+	ELF_STT_SECTION = 3,
+	ELF_STT_FILE = 4,
+	ELF_STT_GNU_IFUNC = 10,
+};
+
+enum {
+	DW_AT_stmt_list = 0x10,
+	DW_AT_comp_dir = 0x1b,
+
+	DW_FORM_addr = 0x01,
+	DW_FORM_block2 = 0x03,
+	DW_FORM_block4 = 0x04,
+	DW_FORM_data2 = 0x05,
+	DW_FORM_data4 = 0x06,
+	DW_FORM_data8 = 0x07,
+	DW_FORM_string = 0x08,
+	DW_FORM_block = 0x09,
+	DW_FORM_block1 = 0x0a,
+	DW_FORM_data1 = 0x0b,
+	DW_FORM_flag = 0x0c,
+	DW_FORM_sdata = 0x0d,
+	DW_FORM_strp = 0x0e,
+	DW_FORM_udata = 0x0f,
+	DW_FORM_ref_addr = 0x10,
+	DW_FORM_ref1 = 0x11,
+	DW_FORM_ref2 = 0x12,
+	DW_FORM_ref4 = 0x13,
+	DW_FORM_ref8 = 0x14,
+	DW_FORM_ref_udata = 0x15,
+	DW_FORM_indirect = 0x16,
+	DW_FORM_sec_offset = 0x17,
+	DW_FORM_exprloc = 0x18,
+	DW_FORM_flag_present = 0x19,
+	DW_FORM_strx = 0x1a,
+	DW_FORM_addrx = 0x1b,
+	DW_FORM_ref_sup4 = 0x1c,
+	DW_FORM_strp_sup = 0x1d,
+	DW_FORM_data16 = 0x1e,
+	DW_FORM_line_strp = 0x1f,
+	DW_FORM_ref_sig8 = 0x20,
+	DW_FORM_implicit_const = 0x21,
+	DW_FORM_loclistx = 0x22,
+	DW_FORM_rnglistx = 0x23,
+	DW_FORM_ref_sup8 = 0x24,
+	DW_FORM_strx1 = 0x25,
+	DW_FORM_strx2 = 0x26,
+	DW_FORM_strx3 = 0x27,
+	DW_FORM_strx4 = 0x28,
+	DW_FORM_addrx1 = 0x29,
+	DW_FORM_addrx2 = 0x2a,
+	DW_FORM_addrx3 = 0x2b,
+	DW_FORM_addrx4 = 0x2c,
+
+	DW_UT_type = 0x02,
+	DW_UT_skeleton = 0x04,
+	DW_UT_split_compile = 0x05,
+	DW_UT_split_type = 0x06,
+
+	DW_LNS_copy = 1,
+	DW_LNS_advance_pc = 2,
+	DW_LNS_advance_line = 3,
+	DW_LNS_set_file = 4,
+	DW_LNS_const_add_pc = 8,
+	DW_LNS_fixed_advance_pc = 9,
+
+	DW_LNE_end_sequence = 1,
+	DW_LNE_set_address = 2,
+	DW_LNE_define_file = 3,
+
+	DW_LNCT_path = 1,
+	DW_LNCT_directory_index = 2,
+};
+
+// little endian cursor over a section image. Reading past the end sets err and returns 0 instead of
+// running off the buffer
+
+struct DwarfCursor {
+	const uint8_t* p;
+	const uint8_t* end;
+	bool err;
+
+	DwarfCursor(const uint8_t* start, const uint8_t* stop) { p = start; end = stop; err = false; }
+
+	bool have(uint64_t n)
+	{
+		if (err || ((uint64_t)(end - p) < n)) {
+			err = true;
+			return false;
+		}
 
-	file = new char[len];
-	strcpy(file, fName);
+		return true;
+	}
 
-	next = nxt;
-}
+	uint64_t fixed(int n)
+	{
+		uint64_t v = 0;
 
-SrcFile::~SrcFile()
-{
-	if (file != nullptr) {
-		delete[] file;
-		file = nullptr;
+		if (have(n)) {
+			for (int i = 0; i < n; i++) {
+				v |= ((uint64_t)p[i]) << (i * 8);
+			}
+			p += n;
+		}
+
+		return v;
 	}
 
-	next = nullptr;
-}
+	uint64_t uleb()
+	{
+		uint64_t v = 0;
+		int shift = 0;
 
-SrcFileRoot::SrcFileRoot()
-{
-	fileRoot = nullptr;
-}
+		while (have(1)) {
+			uint8_t b = *p++;
 
-SrcFileRoot::~SrcFileRoot()
-{
-	SrcFile* srcFile;
+			if (shift < 64) {
+				v |= ((uint64_t)(b & 0x7f)) << shift;
+			}
+			shift += 7;
 
-	srcFile = fileRoot;
+			if ((b & 0x80) == 0) {
+				break;
+			}
+		}
 
-	while (srcFile != nullptr) {
-		SrcFile* next;
-		next = srcFile->next;
-		delete srcFile;
-		srcFile = next;
+		return v;
 	}
 
-	fileRoot = nullptr;
-}
+	int64_t sleb()
+	{
+		int64_t v = 0;
+		int shift = 0;
+		uint8_t b = 0;
 
-char* SrcFileRoot::addFile(char* fName)
-{
-	if (fName == nullptr) {
-		printf("Error: SrcFile::AddFile(): Null fName argument\n");
-		return nullptr;
-	}
+		while (have(1)) {
+			b = *p++;
 
-	SrcFile* srcFile = fileRoot;
+			if (shift < 64) {
+				v |= ((int64_t)(b & 0x7f)) << shift;
+			}
+			shift += 7;
 
-	for (bool found = false; (srcFile != nullptr) && (found == false);) {
-		if (strcmp(srcFile->file,fName) == 0) {
-			found = true;
+			if ((b & 0x80) == 0) {
+				break;
+			}
 		}
-		else {
-			srcFile = srcFile->next;
+
+		if ((shift < 64) && (b & 0x40)) {
+			v |= -(((int64_t)1) << shift);
 		}
-	}
 
-	if (srcFile == nullptr) {
-		srcFile = new SrcFile(fName, fileRoot);
-		fileRoot = srcFile;
+		return v;
 	}
 
-	return srcFile->file;
-}
+	const char* str()
+	{
+		const uint8_t* s = p;
 
-void SrcFileRoot::dump()
-{
-	for (SrcFile* sfp = fileRoot; sfp != nullptr; sfp = sfp->next) {
-		printf("sfp: 0x%08llx, file: 0x%08llx %s, next: 0x%08llx\n", sfp, sfp->file, sfp->file, sfp->next);
-	}
-}
+		while ((p < end) && (*p != 0)) {
+			p += 1;
+		}
 
-ElfReader::ElfReader(const char* elfname, const char* odExe)
-{
-	status = TraceDqrProfiler::DQERR_OK;
-	symtab = nullptr;
-	codeSectionLst = nullptr;
-	elfName = nullptr;
+		if (p >= end) {
+			err = true;
+			return nullptr;
+		}
 
-	if (elfname == nullptr) {
-		printf("Error: ElfReader::ElfReader(): No elf file name specified\n");
-		status = TraceDqrProfiler::DQERR_ERR;
-		return;
+		p += 1;
+
+		return (const char*)s;
 	}
 
-	int len = strlen(elfname) + 1;
-	elfName = new char[len];
-	strcpy(elfName, elfname);
+	void skip(uint64_t n)
+	{
+		if (have(n)) {
+			p += n;
+		}
+	}
+};
 
-	Sym* symLst = nullptr;
+static const char* dwarfString(const std::vector<uint8_t>& strSect, uint64_t offset)
+{
+	if ((offset >= strSect.size()) || (memchr(&strSect[offset], 0, strSect.size() - offset) == nullptr)) {
+		return nullptr;
+	}
 
-	ObjDump* objdump = new ObjDump(elfname, odExe, archSize, codeSectionLst, symLst, srcFileRoot);
-	if (objdump->getStatus() != TraceDqrProfiler::DQERR_OK) {
-		delete objdump;
-		objdump = nullptr;
+	return (const char*)&strSect[offset];
+}
 
-		status = TraceDqrProfiler::DQERR_ERR;
-		return;
-	}
+// read one attribute value. Strings that can be found without .debug_str_offsets come back in str, everything
+// else that fits comes back in value. Returns false for forms that can't be skipped
 
-	delete objdump;
-	objdump = nullptr;
+static bool dwarfReadForm(DwarfCursor& c, uint64_t form, int version, int offsetSize, int addrSize, int64_t implicitConst,
+                          const std::vector<uint8_t>& debugStr, const std::vector<uint8_t>& debugLineStr, uint64_t& value, const char*& str)
+{
+	value = 0;
+	str = nullptr;
 
-	switch (archSize) {
-	case 32:
-		bitsPerAddress = 32;
+	switch (form) {
+	case DW_FORM_addr:
+		value = c.fixed(addrSize);
 		break;
-	case 64:
-		bitsPerAddress = 64;
+	case DW_FORM_block1:
+		c.skip(c.fixed(1));
 		break;
-	}
-
-	symtab = new Symtab(symLst);
+	case DW_FORM_block2:
+		c.skip(c.fixed(2));
+		break;
+	case DW_FORM_block4:
+		c.skip(c.fixed(4));
+		break;
+	case DW_FORM_block:
+	case DW_FORM_exprloc:
+		c.skip(c.uleb());
+		break;
+	case DW_FORM_data1:
+	case DW_FORM_ref1:
+	case DW_FORM_flag:
+	case DW_FORM_strx1:
+	case DW_FORM_addrx1:
+		value = c.fixed(1);
+		break;
+	case DW_FORM_data2:
+	case DW_FORM_ref2:
+	case DW_FORM_strx2:
+	case DW_FORM_addrx2:
+		value = c.fixed(2);
+		break;
+	case DW_FORM_strx3:
+	case DW_FORM_addrx3:
+		value = c.fixed(3);
+		break;
+	case DW_FORM_data4:
+	case DW_FORM_ref4:
+	case DW_FORM_ref_sup4:
+	case DW_FORM_strx4:
+	case DW_FORM_addrx4:
+		value = c.fixed(4);
+		break;
+	case DW_FORM_data8:
+	case DW_FORM_ref8:
+	case DW_FORM_ref_sig8:
+	case DW_FORM_ref_sup8:
+		value = c.fixed(8);
+		break;
+	case DW_FORM_data16:
+		c.skip(16);
+		break;
+	case DW_FORM_sdata:
+		value = (uint64_t)c.sleb();
+		break;
+	case DW_FORM_udata:
+	case DW_FORM_ref_udata:
+	case DW_FORM_strx:
+	case DW_FORM_addrx:
+	case DW_FORM_loclistx:
+	case DW_FORM_rnglistx:
+		value = c.uleb();
+		break;
+	case DW_FORM_string:
+		str = c.str();
+		break;
+	case DW_FORM_strp:
+		value = c.fixed(offsetSize);
+		str = dwarfString(debugStr, value);
+		break;
+	case DW_FORM_line_strp:
+		value = c.fixed(offsetSize);
+		str = dwarfString(debugLineStr, value);
+		break;
+	case DW_FORM_sec_offset:
+	case DW_FORM_strp_sup:
+		value = c.fixed(offsetSize);
+		break;
+	case DW_FORM_ref_addr:
+		value = c.fixed((version <= 2) ? addrSize : offsetSize);
+		break;
+	case DW_FORM_flag_present:
+		value = 1;
+		break;
+	case DW_FORM_implicit_const:
+		value = (uint64_t)implicitConst;
+		break;
+	case DW_FORM_indirect:
+		return dwarfReadForm(c, c.uleb(), version, offsetSize, addrSize, implicitConst, debugStr, debugLineStr, value, str);
+	default:
+		return false;
+	}
+
+	return !c.err;
+}
+
+static bool isAbsolutePath(const char* path)
+{
+	if ((path[0] == '/') || (path[0] == '\\')) {
+		return true;
+	}
+
+	// drive letter
 
+	return isalpha((unsigned char)path[0]) && (path[1] == ':');
+}
+
+ElfLoader::ElfLoader(const char* elfName, int& archSize, Section*& codeSectionLst, Sym*& syms, StringPool& stringPool)
+{
 	TraceDqrProfiler::DQErr rc;
 
-	rc = fixupSourceFiles(codeSectionLst, symLst);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
+	status = TraceDqrProfiler::DQERR_OK;
+
+	fileSize = 0;
+	is64 = false;
+
+	fp = fopen(elfName, "rb");
+	if (fp == nullptr) {
+		printf("Error: ElfLoader::ElfLoader(): Could not open file %s for input\n", elfName);
 		status = TraceDqrProfiler::DQERR_ERR;
 		return;
 	}
 
-	status = TraceDqrProfiler::DQERR_OK;
-}
+#ifdef WINDOWS
+	_fseeki64(fp, 0, SEEK_END);
+	fileSize = (uint64_t)_ftelli64(fp);
+#else // WINDOWS
+	fseeko(fp, 0, SEEK_END);
+	fileSize = (uint64_t)ftello(fp);
+#endif // WINDOWS
 
-ElfReader::~ElfReader()
-{
-	if (elfName != nullptr) {
-		delete[] elfName;
-		elfName = nullptr;
+	rc = parseElfHeader(archSize);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
 	}
 
-	if (symtab != nullptr) {
-		// elfReader is the only objet that really owns the Symtab, and is the only object that should
-		// delete it!
+	rc = parseSectionList(codeSectionLst);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
+	}
 
-		delete symtab;
-		symtab = nullptr;
+	rc = parseSymbolTable(syms, codeSectionLst, stringPool);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
 	}
 
-	while (codeSectionLst != nullptr) {
-		Section* nextSection = codeSectionLst->next;
-		delete codeSectionLst;
-		codeSectionLst = nextSection;
+	rc = parseLineTable(codeSectionLst, stringPool);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
 	}
 }
 
-TraceDqrProfiler::DQErr ElfReader::fixupSourceFiles(Section* sections, Sym* syms)
+ElfLoader::~ElfLoader()
 {
-	// iterate through the symbols looking for non-null srcFile field and add it to fName[index].
-
-	for (Sym* sym = syms; sym != nullptr; sym = sym->next) {
-		if (sym->srcFile != nullptr) {
-			Section* sp = sym->section;
-			if ((sp != nullptr) && (sp->flags & Section::sect_CODE)) {
-				int index;
-				TraceDqrProfiler::ADDRESS addr;
+	if (fp != nullptr) {
+		fclose(fp);
+		fp = nullptr;
+	}
+}
 
-				addr = sym->address;
-				index = (addr - sp->startAddr) / 2;
+TraceDqrProfiler::DQErr ElfLoader::readAt(uint64_t offset, uint64_t size, void* buf)
+{
+	if ((offset > fileSize) || (size > fileSize - offset)) {
+		printf("Error: ElfLoader::readAt(): Read past end of file\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-				uint32_t i;
+	if (size == 0) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-				i = 0;
+#ifdef WINDOWS
+	if (_fseeki64(fp, (__int64)offset, SEEK_SET) != 0) {
+#else // WINDOWS
+	if (fseeko(fp, (off_t)offset, SEEK_SET) != 0) {
+#endif // WINDOWS
+		printf("Error: ElfLoader::readAt(): Seek failed\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-				do { // do at least one
-					if (sp->fName[index + i] == nullptr) {
-						sp->fName[index + i] = sym->srcFile->name;
-						sp->line[index + i] = 0;
-					}
-					i += 1;
-				} while (i < (uint32_t)sym->size / 2);
-			}
-		}
+	if (fread(buf, 1, (size_t)size, fp) != (size_t)size) {
+		printf("Error: ElfLoader::readAt(): Read failed\n");
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
 	return TraceDqrProfiler::DQERR_OK;
 }
 
-TraceDqrProfiler::DQErr ElfReader::getInstructionByAddress(TraceDqrProfiler::ADDRESS addr, TraceDqrProfiler::RV_INST& inst)
+TraceDqrProfiler::DQErr ElfLoader::readSection(int index, std::vector<uint8_t>& data)
 {
-	// get instruction at addr
+	data.clear();
 
-	// Address for code[0] is text->vma
+	if ((index <= 0) || (index >= (int)sects.size()) || (sects[index].type == ELF_SHT_NOBITS)) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-	//don't forget base!!'
+	data.resize((size_t)sects[index].size);
 
-	// hmmm.. probably should cache section pointer, and not address/instruction! Or maybe not cache anything?
+	return readAt(sects[index].offset, sects[index].size, data.data());
+}
 
-	Section* sp;
-	if (codeSectionLst == nullptr) {
-		status = TraceDqrProfiler::DQERR_ERR;
-		return status;
+const char* ElfLoader::sectionName(int index)
+{
+	if ((index < 0) || (index >= (int)sects.size()) || (sects[index].name >= shstrtab.size())) {
+		return "";
 	}
 
-	sp = codeSectionLst->getSectionByAddress(addr);
-	if (sp == nullptr) {
-		status = TraceDqrProfiler::DQERR_ERR;
-		return status;
-	}
+	return (const char*)&shstrtab[sects[index].name];
+}
 
-	if ((addr < sp->startAddr) || (addr > sp->endAddr)) {
-		status = TraceDqrProfiler::DQERR_ERR;
-		return status;
+int ElfLoader::findSection(const char* name)
+{
+	for (int i = 1; i < (int)sects.size(); i++) {
+		if ((sects[i].type != ELF_SHT_NULL) && (strcmp(sectionName(i), name) == 0)) {
+			return i;
+		}
 	}
 
-	if (sp->code == NULL)
-	{
-		status = TraceDqrProfiler::DQERR_ERR;
-		return status;
-	}
+	return -1;
+}
 
-	//	if ((addr < text->vma) || (addr >= text->vma + text->size)) {
-	////			don't know instruction - not part of text segment. need to handle for os
-	////			if we can't get the instruciton, get the next trace message and try again. or do
-	////			we need the next sync message and the next trace message and try again?
-	//
-	//		// for now, just return an error
-	//
-	//		status = dqr::DQERR_ERR;
-	//		return status;
-	//	}
+TraceDqrProfiler::DQErr ElfLoader::parseElfHeader(int& archSize)
+{
+	TraceDqrProfiler::DQErr rc;
+	uint8_t hdr[64];
 
-	int index;
+	if (fileSize < 52) {
+		printf("Error: ElfLoader::parseElfHeader(): File too short to be an elf file\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	index = (addr - sp->startAddr) / 2;
+	rc = readAt(0, 52, hdr);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	inst = sp->code[index];
+	if ((hdr[0] != 0x7f) || (hdr[1] != 'E') || (hdr[2] != 'L') || (hdr[3] != 'F')) {
+		printf("Error: ElfLoader::parseElfHeader(): Not an elf file\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	// if 32 bit instruction, get the second half
+	if (hdr[5] != ELF_DATA2LSB) {
+		printf("Error: ElfLoader::parseElfHeader(): Only little endian elf files are supported\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	switch (inst & 0x0003) {
-	case 0x0000:	// quadrant 0, compressed
-	case 0x0001:	// quadrant 1, compressed
-	case 0x0002:	// quadrant 2, compressed
-		status = TraceDqrProfiler::DQERR_OK;
+	switch (hdr[4]) {
+	case ELF_CLASS32:
+		is64 = false;
+		archSize = 32;
 		break;
-	case 0x0003:	// not compressed. Assume RV32 for now
-		if ((inst & 0x1f) == 0x1f) {
-			fprintf(stderr, "Error: getInstructionByAddress(): cann't decode instructions longer than 32 bits\n");
-			status = TraceDqrProfiler::DQERR_ERR;
-			break;
-		}
-
-		inst = inst | (((uint32_t)sp->code[index + 1]) << 16);
+	case ELF_CLASS64:
+		is64 = true;
+		archSize = 64;
 
-		status = TraceDqrProfiler::DQERR_OK;
+		rc = readAt(0, 64, hdr);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return TraceDqrProfiler::DQERR_ERR;
+		}
 		break;
+	default:
+		printf("Error: ElfLoader::parseElfHeader(): Invalid elf class %d\n", hdr[4]);
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	return status;
-}
+	DwarfCursor c(hdr, hdr + (is64 ? 64 : 52));
 
-TraceDqrProfiler::DQErr ElfReader::parseNLSStrings(TraceDqrProfiler::nlStrings* nlsStrings)
-{
-	Section* sp;
-	bool found = false;
-	int rc;
+	c.skip(18);
 
-	for (sp = codeSectionLst; (sp != NULL) && !found;) {
-		if (strcmp(sp->name,".comment") == 0) {
-			found = true;
-		}
-		else {
-			sp = sp->next;
-		}
+	if (c.fixed(2) != ELF_EM_RISCV) {
+		printf("Error: ElfLoader::parseElfHeader(): Not a RISC-V elf file\n");
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	if (!found) {
+	uint64_t shoff;
+	uint32_t shentsize;
+	uint32_t shnum;
+	uint32_t shstrndx;
+
+	if (is64) {
+		c.skip(4 + 8 + 8);	// e_version, e_entry, e_phoff
+		shoff = c.fixed(8);
+	}
+	else {
+		c.skip(4 + 4 + 4);
+		shoff = c.fixed(4);
+	}
+
+	c.skip(4 + 2 + 2 + 2);	// e_flags, e_ehsize, e_phentsize, e_phnum
+	shentsize = (uint32_t)c.fixed(2);
+	shnum = (uint32_t)c.fixed(2);
+	shstrndx = (uint32_t)c.fixed(2);
+
+	if (shoff == 0) {
+		printf("Error: ElfLoader::parseElfHeader(): No section headers\n");
 		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	int size = sp->size;
-	char* data;
+	if (shentsize < (uint32_t)(is64 ? 64 : 40)) {
+		printf("Error: ElfLoader::parseElfHeader(): Invalid section header size %u\n", shentsize);
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	data = new (std::nothrow) char[size];
+	std::vector<uint8_t> shdr(shentsize);
 
-	if (data == nullptr) {
-		printf("Error: elfReader::parseNLSStrings(): Could not allocate data array\n");
+	// more than SHN_LORESERVE sections: the real count and string table index are in section header 0
 
+	rc = readAt(shoff, shentsize, shdr.data());
+	if (rc != TraceDqrProfiler::DQERR_OK) {
 		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	int fd;
-	fd = _open(elfName, O_RDONLY);
-	if (fd < 0) {
-		printf("Error: elfReader::parseNLSStrings(): Could not open file %s for input\n", elfName);
-		return TraceDqrProfiler::DQERR_ERR;
+	if (shnum == 0) {
+		shnum = (uint32_t)(is64 ? DwarfCursor(&shdr[32], &shdr[40]).fixed(8) : DwarfCursor(&shdr[20], &shdr[24]).fixed(4));
 	}
 
-	rc = lseek(fd, sp->offset, SEEK_SET);
-	if (rc < 0) {
-		printf("Error: ElfReder::parseNLSStrings(): Error seeking to .comment section");
-		_close(fd);
-		fd = -1;
-		delete[] data;
-		data = nullptr;
+	if (shstrndx == ELF_SHN_XINDEX) {
+		shstrndx = (uint32_t)DwarfCursor(&shdr[is64 ? 40 : 24], &shdr[is64 ? 44 : 28]).fixed(4);
+	}
 
+	if ((uint64_t)shnum * shentsize > fileSize) {
+		printf("Error: ElfLoader::parseElfHeader(): Invalid section header count %u\n", shnum);
 		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	rc = _read(fd, data, size);
-	if (rc != size) {
-		printf("Error: ElfReader::parseNLSStrings(): Error reading .comment section\n");
-		_close(fd);
-		fd = -1;
-		delete[] data;
-		data = nullptr;
+	std::vector<uint8_t> shdrs((size_t)shnum * shentsize);
 
+	rc = readAt(shoff, (uint64_t)shnum * shentsize, shdrs.data());
+	if (rc != TraceDqrProfiler::DQERR_OK) {
 		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	_close(fd);
-	fd = -1;
+	sects.resize(shnum);
 
-	int index;
+	for (uint32_t i = 0; i < shnum; i++) {
+		DwarfCursor s(&shdrs[(size_t)i * shentsize], &shdrs[(size_t)i * shentsize] + shentsize);
+		int n = is64 ? 8 : 4;
 
-	for (int i = 0; i < 32; i++) {
-		nlsStrings[i].nf = 0;
-		nlsStrings[i].signedMask = 0;
-		nlsStrings[i].format = nullptr;
+		sects[i].name = (uint32_t)s.fixed(4);
+		sects[i].type = (uint32_t)s.fixed(4);
+		sects[i].flags = s.fixed(n);
+		sects[i].addr = s.fixed(n);
+		sects[i].offset = s.fixed(n);
+		sects[i].size = s.fixed(n);
+		sects[i].link = (uint32_t)s.fixed(4);
+		s.skip(4);	// sh_info
+		sects[i].align = s.fixed(n);
+		sects[i].entsize = s.fixed(n);
 	}
 
-	for (int i = 0; i < size;) {
-		char* end;
+	rc = readSection((int)shstrndx, shstrtab);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		index = strtol(&data[i], &end, 0);
+	shstrtab.push_back(0);
 
-		if (end != &data[i]) {
-			// found an index
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-			i = end - data;
+TraceDqrProfiler::DQErr ElfLoader::parseSectionList(Section*& codeSectionLst)
+{
+	// section flags are worked out the same way bfd does for objdump -h. As with ObjDump, only code sections
+	// and .comment (for the nls strings) are kept
 
-			if ((index >= 32) || (index < 0) || (data[i] != ':')) {
-				// invalid format string - skip
-				while ((i < size) && (data[i] != 0)) {
-					i += 1;
-				}
-				i += 1;
-			}
-			else {
-				// found a format string
+	for (int i = 1; i < (int)sects.size(); i++) {
+		const SectHdr& sh = sects[i];
+		const char* name = sectionName(i);
+		uint32_t flags = 0;
 
-				// need to find end of string
-				int e;
-				int nf = 0;
-				int state = 0;
+		if (sh.type == ELF_SHT_NULL) {
+			continue;
+		}
 
-				for (e = i + 1; (data[e] != 0) && (e < size); e++) {
-					// need to figure out if %s are signed or unsigned
+		if (sh.type != ELF_SHT_NOBITS) {
+			flags |= Section::sect_CONTENTS;
+		}
 
-					switch (state) {
-					case 0:
-						if (data[e] == '%') {
-							state = 1;
-						}
-						break;
-					case 1: // found a %, figure out format
-						switch (data[e]) {
-						case '%':
-							state = 0;
-							break;
-							// signed cases
-						case 'd':
-						case 'i':
-							nlsStrings[index].signedMask |= (1 << nf);
-							nf += 1;
-							state = 0;
-							break;
-							// unsigned cases
-						case 'o':
-						case 'u':
-						case 'x':
-						case 'X':
-						case 'e':
-						case 'E':
-						case 'f':
-						case 'F':
-						case 'g':
-						case 'G':
-						case 'a':
-						case 'A':
-						case 'c':
-						case 's':
-						case 'p':
-						case 'n':
-						case 'M':
-							state = 0;
-							nf += 1;
-							break;
-						default:
-							break;
-						}
-					}
-				}
+		if (sh.flags & ELF_SHF_ALLOC) {
+			flags |= Section::sect_ALLOC;
+			if (sh.type != ELF_SHT_NOBITS) {
+				flags |= Section::sect_LOAD;
+			}
+		}
 
-				if (data[e] != 0) {
-					// invalid format string - not null terminated
+		if ((sh.flags & ELF_SHF_WRITE) == 0) {
+			flags |= Section::sect_READONLY;
+		}
 
-					//should we delete here?
+		if (sh.flags & ELF_SHF_EXECINSTR) {
+			flags |= Section::sect_CODE;
+		}
+		else if (flags & Section::sect_LOAD) {
+			flags |= Section::sect_DATA;
+		}
 
-					for (int i = 0; i < 32; i++) {
-						if (nlsStrings[i].format != nullptr) {
-							delete[] nlsStrings[i].format;
-							nlsStrings[i].format = nullptr;
-						}
-					}
+		if (sh.flags & ELF_SHF_TLS) {
+			flags |= Section::sect_THREADLOCAL;
+		}
 
-					// don't delete nlsStrings here! We didn't allocate it!
+		if (((sh.flags & ELF_SHF_ALLOC) == 0) && (strncmp(name, ".debug", 6) == 0)) {
+			flags |= Section::sect_DEBUGGING;
+		}
 
-					delete[] data;
-					data = nullptr;
+		if (((flags & Section::sect_CODE) == 0) && (strcmp(".comment", name) != 0)) {
+			continue;
+		}
 
-					return TraceDqrProfiler::DQERR_ERR;
-				}
+		Section* sp = new Section();
 
-				nlsStrings[index].nf = nf;
-				nlsStrings[index].format = new char[e - i + 1];
+		if (strlen(name) >= sizeof sp->name) {
+			printf("Error: ElfLoader::parseSectionList(): Section name too long: %s\n", name);
+			delete sp;
+			return TraceDqrProfiler::DQERR_ERR;
+		}
 
-				strcpy(nlsStrings[index].format, &data[i + 1]);
+		strcpy(sp->name, name);
+		sp->flags = flags;
+		sp->size = (uint32_t)sh.size;
+		sp->offset = (uint32_t)sh.offset;
+		sp->align = (sh.align == 0) ? 1 : (uint32_t)sh.align;
+		sp->startAddr = sh.addr;
+		sp->endAddr = sh.addr + (uint32_t)sh.size - 1;
 
-				i = e + 1;
-			}
+		sp->next = codeSectionLst;
+		codeSectionLst = sp;
+
+		if (((flags & Section::sect_CODE) == 0) || ((flags & Section::sect_CONTENTS) == 0) || (sp->size == 0)) {
+			continue;
 		}
-		else {
-			// skip string, look for another
-			while ((i < size) && (data[i] != 0)) {
-				i += 1;
-			}
-			i += 1;
+
+		std::vector<uint8_t> data;
+		TraceDqrProfiler::DQErr rc;
+
+		rc = readSection(i, data);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			printf("Error: ElfLoader::parseSectionList(): Could not read section %s\n", name);
+			return TraceDqrProfiler::DQERR_ERR;
 		}
-	}
 
-	//	for (int i = 0; i < 32; i++) {
-	//		printf("nlsStrings[%d]: %d  %02x %s\n",i,nlsStrings[i].nf,nlsStrings[i].signedMask,nlsStrings[i].format);
-	//	}
+		int numSlots = (sp->size + 1) / 2;
 
-	delete[] data;
-	data = nullptr;
+		sp->code = new uint16_t[numSlots];
 
-	return TraceDqrProfiler::DQERR_OK;
-}
+		for (int j = 0; j < numSlots; j++) {
+			uint16_t hw = data[j * 2];
 
-Symtab* ElfReader::getSymtab()
-{
-	return symtab;
-}
+			if ((uint32_t)(j * 2 + 1) < sp->size) {
+				hw |= ((uint16_t)data[j * 2 + 1]) << 8;
+			}
 
-TraceDqrProfiler::DQErr ElfReader::dumpSyms()
-{
-	if (symtab == nullptr) {
-		symtab = getSymtab();
+			sp->code[j] = hw;
+		}
 	}
 
-	symtab->dump();
-
 	return TraceDqrProfiler::DQERR_OK;
 }
 
-TsList::TsList()
+TraceDqrProfiler::DQErr ElfLoader::parseSymbolTable(Sym*& syms, Section* codeSectionLst, StringPool& stringPool)
 {
-	prev = nullptr;
-	next = nullptr;
-	message = nullptr;
-	terminated = false;
+	TraceDqrProfiler::DQErr rc;
+	int symtabIndex = -1;
 
-	startTime = (TraceDqrProfiler::TIMESTAMP)0;
-	endTime = (TraceDqrProfiler::TIMESTAMP)0;
-}
+	for (int i = 1; (i < (int)sects.size()) && (symtabIndex < 0); i++) {
+		if (sects[i].type == ELF_SHT_SYMTAB) {
+			symtabIndex = i;
+		}
+	}
 
-TsList::~TsList()
-{
-}
+	if (symtabIndex < 0) {
+		// stripped
 
-ITCPrint::ITCPrint(int itcPrintOpts, int numCores, int buffSize, int channel, TraceDqrProfiler::nlStrings* nlsStrings)
-{
-	if ((numCores <= 0) || (buffSize <= 0)) {
-		printf("Error: ITCPrint::ITCPrint(): Bad numCores or bufSize argument\n");
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-		// just make some defaults and fly from there
+	std::vector<uint8_t> symData;
+	std::vector<uint8_t> strData;
 
-		numCores = 1;
-		buffSize = 1024;
+	rc = readSection(symtabIndex, symData);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	this->numCores = numCores;
-	this->buffSize = buffSize;
-	this->printChannel = channel;
-	this->nlsStrings = nlsStrings;
+	rc = readSection((int)sects[symtabIndex].link, strData);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	itcOptFlags = itcPrintOpts;
+	uint32_t entSize = is64 ? 24 : 16;
+	uint32_t numSyms = (uint32_t)(symData.size() / entSize);
 
-	pbuff = new char* [numCores];
+	// objdump -t lists symbols in symbol table order and ObjDump::parseSymbolTable() pushes each on the front
+	// of the list, so do the same. The local symbols following a file symbol belong to that file
 
-	for (int i = 0; i < numCores; i++) {
-		pbuff[i] = new char[buffSize];
-	}
+	Sym* file = nullptr;
 
-	numMsgs = new int[numCores];
+	for (uint32_t i = 1; i < numSyms; i++) {
+		DwarfCursor c(&symData[(size_t)i * entSize], &symData[(size_t)i * entSize] + entSize);
 
-	for (int i = 0; i < numCores; i++) {
-		numMsgs[i] = 0;
-	}
+		uint32_t nameOff;
+		uint8_t info;
+		uint32_t shndx;
+		uint64_t value;
+		uint64_t size;
 
-	pbi = new int[numCores];
+		nameOff = (uint32_t)c.fixed(4);
 
-	for (int i = 0; i < numCores; i++) {
-		pbi[i] = 0;
-	}
+		if (is64) {
+			info = (uint8_t)c.fixed(1);
+			c.skip(1);	// st_other
+			shndx = (uint32_t)c.fixed(2);
+			value = c.fixed(8);
+			size = c.fixed(8);
+		}
+		else {
+			value = c.fixed(4);
+			size = c.fixed(4);
+			info = (uint8_t)c.fixed(1);
+			c.skip(1);
+			shndx = (uint32_t)c.fixed(2);
+		}
 
-	pbo = new int[numCores];
+		uint32_t symFlags = 0;
 
-	for (int i = 0; i < numCores; i++) {
-		pbo[i] = 0;
-	}
+		switch (info >> 4) {
+		case ELF_STB_LOCAL:
+			symFlags |= Sym::symLocal;
+			break;
+		case ELF_STB_GLOBAL:
+			if ((shndx != ELF_SHN_UNDEF) && (shndx != ELF_SHN_COMMON)) {
+				symFlags |= Sym::symGlobal;
+			}
+			break;
+		case ELF_STB_WEAK:
+			symFlags |= Sym::symWeak;
+			break;
+		case ELF_STB_GNU_UNIQUE:
+			symFlags |= Sym::symGlobal;
+			break;
+		}
 
-	freeList = nullptr;
+		switch (info & 0xf) {
+		case ELF_STT_OBJECT:
+			symFlags |= Sym::symObj;
+			break;
+		case ELF_STT_FUNC:
+			symFlags |= Sym::symFunc;
+			break;
+		case ELF_STT_SECTION:
+			symFlags |= Sym::symDebug;
+			break;
+		case ELF_STT_FILE:
+			symFlags |= Sym::symFile | Sym::symDebug;
+			break;
+		case ELF_STT_GNU_IFUNC:
+			symFlags |= Sym::symIndirectFunc;
+			break;
+		}
 
-	tsList = new TsList * [numCores];
+		const char* secName = nullptr;
 
-	for (int i = 0; i < numCores; i++) {
-		tsList[i] = nullptr;
-	}
-}
+		if ((shndx != ELF_SHN_UNDEF) && (shndx < ELF_SHN_LORESERVE)) {
+			secName = sectionName((int)shndx);
+		}
 
-ITCPrint::~ITCPrint()
-{
-	nlsStrings = nullptr; // don't delete this here - it is part of the trace object
+		const char* symName = "";
 
-	if (pbuff != nullptr) {
-		for (int i = 0; i < numCores; i++) {
-			if (pbuff[i] != nullptr) {
-				delete[] pbuff[i];
-				pbuff[i] = nullptr;
+		if (nameOff < strData.size()) {
+			symName = dwarfString(strData, nameOff);
+			if (symName == nullptr) {
+				symName = "";
 			}
 		}
 
-		delete[] pbuff;
-		pbuff = nullptr;
-	}
+		if ((symName[0] == 0) && ((info & 0xf) == ELF_STT_SECTION) && (secName != nullptr)) {
+			symName = secName;
+		}
 
-	if (numMsgs != nullptr) {
-		delete[] numMsgs;
-		numMsgs = nullptr;
-	}
+		if (symName[0] == 0) {
+			if (symFlags & Sym::symFile) {
+				file = nullptr;
+			}
 
-	if (pbi != nullptr) {
-		delete[] pbi;
-		pbi = nullptr;
-	}
+			continue;
+		}
 
-	if (pbo != nullptr) {
-		delete[] pbo;
-		pbo = nullptr;
-	}
+		Sym* sp;
+		sp = new Sym();
 
-	if (freeList != nullptr) {
-		TsList* tl = freeList;
-		while (tl != nullptr) {
-			TsList* tln = tl->next;
-			delete tl;
-			tl = tln;
+		sp->next = syms;
+		sp->name = stringPool.intern(symName);
+		sp->flags = symFlags;
+		sp->address = value;
+		sp->size = size;
+		sp->srcFile = nullptr;
+
+		if (symFlags & Sym::symFile) {
+			file = sp;
+		}
+		else if ((symFlags != Sym::symLocal) && (symFlags != (Sym::symLocal | Sym::symFunc))) {
+			// if not local flag, turn off srcFile setting
+			file = nullptr;
+		}
+		else {
+			sp->srcFile = file;
 		}
-		freeList = nullptr;
-	}
 
-	if (tsList != nullptr) {
-		for (int i = 0; i < numCores; i++) {
-			TsList* tl = tsList[i];
-			if (tl != nullptr) {
-				do {
-					TsList* tln = tl->next;
-					delete tl;
-					tl = tln;
-				} while ((tl != tsList[i]) && (tl != nullptr));
-			}
+		if ((secName != nullptr) && (codeSectionLst != nullptr)) {
+			sp->section = codeSectionLst->getSectionByName((char*)secName);
 		}
-		delete[] tsList;
-		tsList = nullptr;
+		else {
+			sp->section = nullptr;
+		}
+
+		syms = sp;
 	}
+
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-int ITCPrint::roomInITCPrintQ(uint8_t core)
+TraceDqrProfiler::DQErr ElfLoader::parseCompDirs(std::vector<std::pair<uint64_t, const char*>>& compDirs, std::vector<uint8_t>& info)
 {
-	if (core >= numCores) {
-		return 0;
-	}
+	TraceDqrProfiler::DQErr rc;
+	std::vector<uint8_t> abbrev;
 
-	if (pbi[core] > pbo[core]) {
-		return buffSize - pbi[core] + pbo[core] - 1;
-	}
+	// DWARF 2-4 line tables name files relative to the compilation directory, which is only given in the
+	// compile unit DIE. Only the first DIE of each unit is looked at, for DW_AT_stmt_list and DW_AT_comp_dir
 
-	if (pbi[core] < pbo[core]) {
-		return pbo[core] - pbi[core] - 1;
-	}
+	int infoIndex = findSection(".debug_info");
+	int abbrevIndex = findSection(".debug_abbrev");
 
-	return buffSize - 1;
-}
+	if ((infoIndex < 0) || (abbrevIndex < 0)) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-bool ITCPrint::print(uint8_t core, uint32_t addr, uint32_t data, TraceDqrProfiler::TIMESTAMP tstamp)
-{
-	if (core >= numCores) {
-		return false;
+	rc = readSection(infoIndex, info);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	//	here we want to process nls!!!
-	//	check is addr has an itc print format string (in nlsStrings)
+	rc = readSection(abbrevIndex, abbrev);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	TsList* tlp;
-	tlp = tsList[core];
-	TsList* workingtlp;
-	int channel;
+	const uint8_t* end = info.data() + info.size();
+	const uint8_t* unit = info.data();
 
-	channel = addr / 4;
+	while (unit < end) {
+		DwarfCursor c(unit, end);
+		int offsetSize = 4;
+		uint64_t length;
 
-	if (itcOptFlags & TraceDqrProfiler::ITC_OPT_NLS) {
-		if (((addr & 0x03) == 0) && (nlsStrings != nullptr) && (nlsStrings[channel].format != nullptr)) {
-			int args[4];
-			char dst[256];
-			int dstLen = 0;
+		length = c.fixed(4);
+		if (length == 0xffffffff) {
+			length = c.fixed(8);
+			offsetSize = 8;
+		}
 
-			// have a no-load-string print
+		if (c.err || (length > (uint64_t)(end - c.p))) {
+			break;
+		}
 
-			// need to get args for print
+		const uint8_t* unitEnd = c.p + length;
+		c.end = unitEnd;
+		unit = unitEnd;
 
-			switch (nlsStrings[channel].nf) {
-			case 0:
-				dstLen = sprintf(dst, nlsStrings[channel].format);
-				break;
-			case 1:
-				dstLen = sprintf(dst, nlsStrings[channel].format, data);
-				break;
-			case 2:
-				for (int i = 0; i < 2; i++) {
-					if (nlsStrings[channel].signedMask & (1 << i)) {
-						// signed
-						args[i] = (int16_t)(data >> ((1 - i) * 16));
-					}
-					else {
-						// unsigned
-						args[i] = (uint16_t)(data >> ((1 - i) * 16));
-					}
-				}
-				dstLen = sprintf(dst, nlsStrings[channel].format, args[0], args[1]);
-				break;
-			case 3:
-				args[0] = (data >> (32 - 11)) & 0x7ff; // 10 bit
-				args[1] = (data >> (32 - 22)) & 0x7ff; // 11 bit
-				args[2] = (data >> (32 - 32)) & 0x3ff; // 11 bit
+		int version = (int)c.fixed(2);
+		int addrSize;
+		uint64_t abbrevOffset;
 
-				if (nlsStrings[channel].signedMask & (1 << 0)) {
-					if (args[0] & 0x400) {
-						args[0] |= 0xfffff800;
-					}
-				}
+		if ((version < 2) || (version > 5)) {
+			continue;
+		}
 
-				if (nlsStrings[channel].signedMask & (1 << 1)) {
-					if (args[1] & 0x400) {
-						args[1] |= 0xfffff800;
-					}
-				}
+		if (version >= 5) {
+			int unitType = (int)c.fixed(1);
 
-				if (nlsStrings[channel].signedMask & (1 << 2)) {
-					if (args[2] & 0x200) {
-						args[2] |= 0xfffffc00;
-					}
-				}
+			addrSize = (int)c.fixed(1);
+			abbrevOffset = c.fixed(offsetSize);
 
-				dstLen = sprintf(dst, nlsStrings[channel].format, args[0], args[1], args[2]);
-				break;
-			case 4:
-				for (int i = 0; i < 4; i++) {
-					if (nlsStrings[channel].signedMask & (1 << i)) {
-						// signed
-						args[i] = (int8_t)(data >> ((3 - i) * 8));
-					}
-					else {
-						// unsigned
-						args[i] = (uint8_t)(data >> ((3 - i) * 8));
-					}
-				}
-				dstLen = sprintf(dst, nlsStrings[channel].format, args[0], args[1], args[2], args[3]);
-				break;
-			default:
-				dstLen = sprintf(dst, "Error: invalid number of args for format string %d, %s", channel, nlsStrings[channel].format);
-				break;
+			if ((unitType == DW_UT_skeleton) || (unitType == DW_UT_split_compile)) {
+				c.skip(8);
 			}
+			else if ((unitType == DW_UT_type) || (unitType == DW_UT_split_type)) {
+				c.skip(8 + offsetSize);
+			}
+		}
+		else {
+			abbrevOffset = c.fixed(offsetSize);
+			addrSize = (int)c.fixed(1);
+		}
 
-			if ((tsList[core] != nullptr) && (tsList[core]->terminated == false)) {
-				// terminate the current message
+		if (c.err || (abbrevOffset >= abbrev.size())) {
+			continue;
+		}
 
-				pbuff[core][pbi[core]] = 0;	// add a null termination after the eol
-				pbi[core] += 1;
+		uint64_t dieCode = c.uleb();
 
-				if (pbi[core] >= buffSize) {
-					pbi[core] = 0;
-				}
+		// find the abbreviation for the unit DIE
 
-				numMsgs[core] += 1;
+		DwarfCursor a(abbrev.data() + abbrevOffset, abbrev.data() + abbrev.size());
+		bool found = false;
 
-				tsList[core]->terminated = true;
+		while (!found && !a.err) {
+			uint64_t code = a.uleb();
+			if (code == 0) {
+				break;
 			}
 
-			// check free list for available struct
-
-			if (freeList != nullptr) {
-				workingtlp = freeList;
-				freeList = workingtlp->next;
-
-				workingtlp->terminated = false;
-				workingtlp->message = nullptr;
-			}
-			else {
-				workingtlp = new TsList();
-			}
+			a.uleb();	// tag
+			a.skip(1);	// children
 
-			if (tlp == nullptr) {
-				workingtlp->next = workingtlp;
-				workingtlp->prev = workingtlp;
+			if (code == dieCode) {
+				found = true;
 			}
 			else {
-				workingtlp->next = tlp;
-				workingtlp->prev = tlp->prev;
-
-				tlp->prev = workingtlp;
-				workingtlp->prev->next = workingtlp;
-			}
-
-			workingtlp->startTime = tstamp;
-			workingtlp->endTime = tstamp;
-			workingtlp->message = &pbuff[core][pbi[core]];
-
-			tsList[core] = workingtlp;
-
-			// workingtlp now points to unterminated TSList object
+				for (;;) {
+					uint64_t attr = a.uleb();
+					uint64_t form = a.uleb();
 
-			int room = roomInITCPrintQ(core);
+					if (a.err || ((attr == 0) && (form == 0))) {
+						break;
+					}
 
-			for (int i = 0; i < dstLen; i++) {
-				if (room >= 2) { // 2 because we need to make sure there is room for the nul termination
-					pbuff[core][pbi[core]] = dst[i];
-					pbi[core] += 1;
-					if (pbi[core] >= buffSize) {
-						pbi[core] = 0;
+					if (form == DW_FORM_implicit_const) {
+						a.sleb();
 					}
-					room -= 1;
 				}
 			}
-
-			pbuff[core][pbi[core]] = 0;
-			pbi[core] += 1;
-			if (pbi[core] >= buffSize) {
-				pbi[core] = 0;
-			}
-
-			workingtlp->terminated = true;
-			numMsgs[core] += 1;
-
-			return true;
 		}
-	}
-
-	if (itcOptFlags & TraceDqrProfiler::ITC_OPT_PRINT) {
-		if ((addr < (uint32_t)printChannel * 4) || (addr >= (((uint32_t)printChannel + 1) * 4))) {
-			// not writing to this itc channel
 
-			return false;
+		if (!found) {
+			continue;
 		}
 
-		if ((tlp == nullptr) || tlp->terminated == true) {
-			// see if there is one on the free list before making a new one
+		bool haveStmtList = false;
+		uint64_t stmtList = 0;
+		const char* compDir = nullptr;
 
-			if (freeList != nullptr) {
-				workingtlp = freeList;
-				freeList = workingtlp->next;
+		for (;;) {
+			uint64_t attr = a.uleb();
+			uint64_t form = a.uleb();
+			int64_t implicitConst = 0;
 
-				workingtlp->terminated = false;
-				workingtlp->message = nullptr;
-			}
-			else {
-				workingtlp = new TsList();
+			if (a.err || ((attr == 0) && (form == 0))) {
+				break;
 			}
 
-			if (tlp == nullptr) {
-				workingtlp->next = workingtlp;
-				workingtlp->prev = workingtlp;
+			if (form == DW_FORM_implicit_const) {
+				implicitConst = a.sleb();
 			}
-			else {
-				workingtlp->next = tlp;
-				workingtlp->prev = tlp->prev;
 
-				tlp->prev = workingtlp;
-				workingtlp->prev->next = workingtlp;
-			}
+			uint64_t value;
+			const char* str;
 
-			workingtlp->terminated = false;
-			workingtlp->startTime = tstamp;
-			workingtlp->message = &pbuff[core][pbi[core]];
+			if (dwarfReadForm(c, form, version, offsetSize, addrSize, implicitConst, debugStr, debugLineStr, value, str) == false) {
+				break;
+			}
 
-			tsList[core] = workingtlp;
-		}
-		else {
-			workingtlp = tlp;
+			if (attr == DW_AT_stmt_list) {
+				haveStmtList = true;
+				stmtList = value;
+			}
+			else if (attr == DW_AT_comp_dir) {
+				compDir = str;
+			}
 		}
 
-		// workingtlp now points to unterminated TSList object (in progress)
+		if (haveStmtList) {
+			compDirs.push_back(std::make_pair(stmtList, compDir));
+		}
+	}
 
-		workingtlp->endTime = tstamp;
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-		char* p = (char*)&data;
-		int room = roomInITCPrintQ(core);
+TraceDqrProfiler::DQErr ElfLoader::setLines(Section* codeSectionLst, TraceDqrProfiler::ADDRESS start, TraceDqrProfiler::ADDRESS end, char* file, uint32_t line)
+{
+	while (start < end) {
+		Section* sp = codeSectionLst->getSectionByAddress(start);
 
-		for (int i = 0; ((size_t)i < ((sizeof data) - (addr & 0x03))); i++) {
-			if (room >= 2) {
-				pbuff[core][pbi[core]] = p[i];
-				pbi[core] += 1;
-				if (pbi[core] >= buffSize) {
-					pbi[core] = 0;
-				}
-				room -= 1;
+		if ((sp == nullptr) || ((sp->flags & Section::sect_CODE) == 0) || (sp->code == nullptr)) {
+			// not in a code section we keep
 
-				switch (p[i]) {
-				case 0:
-					numMsgs[core] += 1;
+			return TraceDqrProfiler::DQERR_OK;
+		}
 
-					workingtlp->terminated = true;
-					break;
-				case '\n':
-				case '\r':
-					pbuff[core][pbi[core]] = 0;	// add a null termination after the eol
-					pbi[core] += 1;
-					if (pbi[core] >= buffSize) {
-						pbi[core] = 0;
-					}
-					room -= 1;
-					numMsgs[core] += 1;
+		TraceDqrProfiler::ADDRESS last = end - 1;
 
-					workingtlp->terminated = true;
-					break;
-				default:
-					break;
-				}
-			}
+		if (last > sp->endAddr) {
+			last = sp->endAddr;
 		}
 
-		pbuff[core][pbi[core]] = 0; // make sure always null terminated. This may be a temporary null termination
+		uint32_t first = (uint32_t)((start - sp->startAddr) / 2);
+		uint32_t final = (uint32_t)((last - sp->startAddr) / 2);
 
-		// returning true means it was an itc print msg and has been processed
-		// false means it was not, and should be handled normally
+		sp->setSrcLines(first, final + 1, file, line);
 
-		return true;
+		if (last == end - 1) {
+			return TraceDqrProfiler::DQERR_OK;
+		}
+
+		start = sp->endAddr + 1;
 	}
 
-	return false;
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-bool ITCPrint::haveITCPrintMsgs()
+TraceDqrProfiler::DQErr ElfLoader::parseLineTable(Section* codeSectionLst, StringPool& stringPool)
 {
-	for (int core = 0; core < numCores; core++) {
-		if (numMsgs[core] != 0) {
-			return true;
-		}
+	TraceDqrProfiler::DQErr rc;
+	std::vector<uint8_t> lineData;
+	std::vector<uint8_t> info;
+	std::vector<std::pair<uint64_t, const char*>> compDirs;
+
+	if (codeSectionLst == nullptr) {
+		return TraceDqrProfiler::DQERR_OK;
 	}
 
-	return false;
-}
+	int lineIndex = findSection(".debug_line");
+	if (lineIndex < 0) {
+		// no line information
 
-int ITCPrint::getITCPrintMask()
-{
-	int mask = 0;
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-	for (int core = 0; core < numCores; core++) {
-		if (numMsgs[core] != 0) {
-			mask |= 1 << core;
-		}
+	rc = readSection(lineIndex, lineData);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	return mask;
-}
+	rc = readSection(findSection(".debug_str"), debugStr);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-int ITCPrint::getITCFlushMask()
-{
-	int mask = 0;
+	rc = readSection(findSection(".debug_line_str"), debugLineStr);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	for (int core = 0; core < numCores; core++) {
-		if (numMsgs[core] > 0) {
-			mask |= 1 << core;
+	rc = parseCompDirs(compDirs, info);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	std::sort(compDirs.begin(), compDirs.end());
+
+	const uint8_t* base = lineData.data();
+	const uint8_t* end = base + lineData.size();
+	const uint8_t* unit = base;
+
+	while (unit < end) {
+		uint64_t unitOffset = (uint64_t)(unit - base);
+		DwarfCursor c(unit, end);
+		int offsetSize = 4;
+		uint64_t length;
+
+		length = c.fixed(4);
+		if (length == 0xffffffff) {
+			length = c.fixed(8);
+			offsetSize = 8;
 		}
-		else if (pbo[core] != pbi[core]) {
-			mask |= 1 << core;
+
+		if (c.err || (length > (uint64_t)(end - c.p))) {
+			printf("Error: ElfLoader::parseLineTable(): Bad line table length at offset 0x%llx\n", (unsigned long long)unitOffset);
+			return TraceDqrProfiler::DQERR_ERR;
 		}
-	}
 
-	return mask;
-}
+		const uint8_t* unitEnd = c.p + length;
+		c.end = unitEnd;
+		unit = unitEnd;
 
-void ITCPrint::haveITCPrintData(int numMsgs[], bool havePrintData[])
-{
-	if (numMsgs != nullptr) {
-		for (int i = 0; i < numCores; i++) {
-			numMsgs[i] = this->numMsgs[i];
+		int version = (int)c.fixed(2);
+		int addrSize = is64 ? 8 : 4;
+
+		if ((version < 2) || (version > 5)) {
+			printf("Error: ElfLoader::parseLineTable(): Unsupported line table version %d\n", version);
+			continue;
 		}
-	}
 
-	if (havePrintData != nullptr) {
-		for (int i = 0; i < numCores; i++) {
-			havePrintData[i] = pbi[i] != pbo[i];
+		if (version >= 5) {
+			addrSize = (int)c.fixed(1);
+			c.skip(1);	// segment selector size
 		}
-	}
-}
 
-TsList* ITCPrint::consumeTerminatedTsList(int core)
-{
-	TsList* rv = nullptr;
+		uint64_t headerLength = c.fixed(offsetSize);
+		const uint8_t* program = c.p + headerLength;
 
-	if (numMsgs[core] > 0) { // have stuff in the Q
-		TsList* tsl = tsList[core];
+		uint32_t minInstLength = (uint32_t)c.fixed(1);
+		if (version >= 4) {
+			c.skip(1);	// maximum operations per instruction. Always 1 for RISC-V
+		}
+		c.skip(1);	// default is_stmt
+		int lineBase = (int8_t)c.fixed(1);
+		uint32_t lineRange = (uint32_t)c.fixed(1);
+		uint32_t opcodeBase = (uint32_t)c.fixed(1);
 
-		// tsl now points to the newest tslist object. We want the oldest, which will be tsl->prev
+		if (c.err || (lineRange == 0) || (opcodeBase == 0) || (program > unitEnd)) {
+			printf("Error: ElfLoader::parseLineTable(): Bad line table header at offset 0x%llx\n", (unsigned long long)unitOffset);
+			continue;
+		}
 
-		if (tsl != nullptr) {
-			tsl = tsl->prev;
+		std::vector<uint8_t> opcodeLengths(opcodeBase, 0);
 
-			if (tsl->terminated == true) {
-				rv = tsl;
+		for (uint32_t i = 1; i < opcodeBase; i++) {
+			opcodeLengths[i] = (uint8_t)c.fixed(1);
+		}
 
-				// unlink tsl (consume it)
+		const char* compDir = nullptr;
 
-				if (tsl->next == tsl) {
-					// was the only one in list
+		std::vector<std::pair<uint64_t, const char*>>::iterator cd;
+		cd = std::lower_bound(compDirs.begin(), compDirs.end(), std::make_pair(unitOffset, (const char*)nullptr));
+		if ((cd != compDirs.end()) && (cd->first == unitOffset)) {
+			compDir = cd->second;
+		}
 
-					tsList[core] = nullptr;
+		std::vector<const char*> dirs;
+		std::vector<LineFile> files;
+
+		if (version < 5) {
+			// directory 0 and file 0 are implied; directory 0 is the compilation directory
+
+			dirs.push_back(compDir);
+
+			for (const char* dir = c.str(); (dir != nullptr) && (dir[0] != 0); dir = c.str()) {
+				dirs.push_back(dir);
+			}
+
+			LineFile lf = { nullptr, 0, nullptr };
+
+			files.push_back(lf);
+
+			for (const char* name = c.str(); (name != nullptr) && (name[0] != 0); name = c.str()) {
+				lf.name = name;
+				lf.dir = c.uleb();
+				c.uleb();	// modification time
+				c.uleb();	// length
+
+				files.push_back(lf);
+			}
+		}
+		else {
+			for (int table = 0; (table < 2) && !c.err; table++) {
+				std::vector<std::pair<uint64_t, uint64_t>> format;
+
+				int formatCount = (int)c.fixed(1);
+				for (int i = 0; i < formatCount; i++) {
+					uint64_t type = c.uleb();
+					uint64_t form = c.uleb();
+
+					format.push_back(std::make_pair(type, form));
 				}
-				else {
-					tsList[core]->prev = tsl->prev;
 
-					if (tsList[core]->next == tsl) {
-						tsList[core]->next = tsl->next;
+				uint64_t count = c.uleb();
+				for (uint64_t i = 0; (i < count) && !c.err; i++) {
+					LineFile lf = { nullptr, 0, nullptr };
+
+					for (size_t f = 0; f < format.size(); f++) {
+						uint64_t value;
+						const char* str;
+
+						if (dwarfReadForm(c, format[f].second, version, offsetSize, addrSize, 0, debugStr, debugLineStr, value, str) == false) {
+							c.err = true;
+							break;
+						}
+
+						if (format[f].first == DW_LNCT_path) {
+							lf.name = str;
+						}
+						else if (format[f].first == DW_LNCT_directory_index) {
+							lf.dir = value;
+						}
 					}
-				}
 
-				tsl->next = freeList;
-				tsl->prev = nullptr;
-				freeList = tsl;
+					if (table == 0) {
+						dirs.push_back(lf.name);
+					}
+					else {
+						files.push_back(lf);
+					}
+				}
 			}
 		}
-	}
 
-	return rv;
-}
+		if (c.err) {
+			printf("Error: ElfLoader::parseLineTable(): Bad line table header at offset 0x%llx\n", (unsigned long long)unitOffset);
+			continue;
+		}
 
-TsList* ITCPrint::consumeOldestTsList(int core)
-{
-	TsList* rv;
+		// run the line number program. Each row covers the addresses up to the next row in the sequence
 
-	rv = consumeTerminatedTsList(core);
-	if (rv == nullptr) {
-		// no terminated itc prints. Look for one in progress
+		c.p = program;
 
-		TsList* tsl = tsList[core];
+		TraceDqrProfiler::ADDRESS address = 0;
+		uint64_t fileIndex = 1;
+		int64_t line = 1;
 
-		if (tsl != nullptr) {
-			// this must be an unterminated tsl. unlink tsl (consume it)
+		bool haveRow = false;
+		TraceDqrProfiler::ADDRESS rowAddress = 0;
+		uint64_t rowFile = 0;
+		uint32_t rowLine = 0;
 
-			rv = tsl;
+		while ((c.p < unitEnd) && !c.err) {
+			uint32_t opcode = (uint32_t)c.fixed(1);
+			bool emitRow = false;
+			bool endSequence = false;
 
-			if (tsl->next == tsl) {
-				// was the only one in the list!
+			if (opcode >= opcodeBase) {
+				uint32_t adjusted = opcode - opcodeBase;
 
-				tsList[core] = nullptr;
+				address += (adjusted / lineRange) * minInstLength;
+				line += lineBase + (int)(adjusted % lineRange);
+				emitRow = true;
+			}
+			else if (opcode == 0) {
+				uint64_t len = c.uleb();
+				const uint8_t* next = c.p + len;
+
+				if (len == 0 || !c.have(len)) {
+					break;
+				}
+
+				switch (c.fixed(1)) {
+				case DW_LNE_end_sequence:
+					emitRow = true;
+					endSequence = true;
+					break;
+				case DW_LNE_set_address:
+					if (len - 1 <= 8) {
+						address = c.fixed((int)len - 1);
+					}
+					break;
+				case DW_LNE_define_file:
+					{
+						LineFile lf = { nullptr, 0, nullptr };
+
+						lf.name = c.str();
+						lf.dir = c.uleb();
+
+						files.push_back(lf);
+					}
+					break;
+				}
+
+				c.p = next;
 			}
 			else {
-				tsList[core]->prev = tsl->prev;
+				switch (opcode) {
+				case DW_LNS_copy:
+					emitRow = true;
+					break;
+				case DW_LNS_advance_pc:
+					address += c.uleb() * minInstLength;
+					break;
+				case DW_LNS_advance_line:
+					line += c.sleb();
+					break;
+				case DW_LNS_set_file:
+					fileIndex = c.uleb();
+					break;
+				case DW_LNS_const_add_pc:
+					address += ((255 - opcodeBase) / lineRange) * minInstLength;
+					break;
+				case DW_LNS_fixed_advance_pc:
+					address += c.fixed(2);
+					break;
+				default:
+					// includes the opcodes that only change state we don't keep
 
-				if (tsList[core]->next == tsl) {
-					tsList[core]->next = tsl->next;
+					for (uint32_t i = 0; i < opcodeLengths[opcode]; i++) {
+						c.uleb();
+					}
+					break;
 				}
 			}
 
-			tsl->next = freeList;
-			tsl->prev = nullptr;
-			freeList = tsl;
-		}
-	}
+			if (!emitRow) {
+				continue;
+			}
 
-	return rv;
-}
+			if (haveRow && (address > rowAddress)) {
+				char* fName = nullptr;
 
-bool ITCPrint::getITCPrintMsg(uint8_t core, char* dst, int dstLen, TraceDqrProfiler::TIMESTAMP& startTime, TraceDqrProfiler::TIMESTAMP& endTime)
-{
-	bool rc = false;
+				if (rowFile < files.size()) {
+					LineFile& lf = files[rowFile];
 
-	if (core >= numCores) {
-		return false;
-	}
+					if ((lf.path == nullptr) && (lf.name != nullptr)) {
+						std::string path;
+						const char* dir = (lf.dir < dirs.size()) ? dirs[lf.dir] : nullptr;
 
-	if ((dst == nullptr) || (dstLen <= 0)) {
-		printf("Error: ITCPrint::getITCPrintMsg(): Bad dst argument or size\n");
+						// same rules as bfd uses for objdump -l: a relative directory is under the compilation directory
 
-		return false;
-	}
+						if (!isAbsolutePath(lf.name)) {
+							if (((dir == nullptr) || !isAbsolutePath(dir)) && (compDir != nullptr) && (dir != compDir)) {
+								path = compDir;
+								path += "/";
+							}
 
-	if (numMsgs[core] > 0) {
-		TsList* tsl = consumeTerminatedTsList(core);
+							if (dir != nullptr) {
+								path += dir;
+								path += "/";
+							}
+						}
 
-		if (tsl != nullptr) {
-			startTime = tsl->startTime;
-			endTime = tsl->endTime;
-		}
-		else if (tsl == nullptr) {
-			printf("Error: ITCPrint::getITCPrintMsg(): tsl is null\n");
-			return false;
-		}
+						path += lf.name;
 
-		rc = true;
-		numMsgs[core] -= 1;
+						lf.path = stringPool.intern(path.c_str());
+					}
 
-		while (pbuff[core][pbo[core]] && (dstLen > 1)) {
-			*dst++ = pbuff[core][pbo[core]];
-			dstLen -= 1;
+					fName = lf.path;
+				}
 
-			pbo[core] += 1;
-			if (pbo[core] >= buffSize) {
-				pbo[core] = 0;
+				setLines(codeSectionLst, rowAddress, address, fName, rowLine);
 			}
-		}
 
-		*dst = 0;
-
-		// skip past null terminted end of message
+			if (endSequence) {
+				haveRow = false;
 
-		pbo[core] += 1;
-		if (pbo[core] >= buffSize) {
-			pbo[core] = 0;
+				address = 0;
+				fileIndex = 1;
+				line = 1;
+			}
+			else {
+				haveRow = true;
+				rowAddress = address;
+				rowFile = fileIndex;
+				rowLine = (uint32_t)line;
+			}
 		}
 	}
 
-	return rc;
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-bool ITCPrint::flushITCPrintMsg(uint8_t core, char* dst, int dstLen, TraceDqrProfiler::TIMESTAMP& startTime, TraceDqrProfiler::TIMESTAMP& endTime)
+// elf image cache
+
+static uint64_t elfCacheMix(uint64_t h, uint64_t w)
 {
-	if (core >= numCores) {
-		printf("Error: ITCPrint::flushITCPringMsg(): Core out of range (%d)\n", core);
-		return false;
+	h ^= w;
+	h *= 0x9e3779b97f4a7c15ULL;
+	h ^= h >> 29;
+
+	return h;
+}
+
+ElfImageCache::ElfImageCache(const char* cacheDir, const char* elfName)
+{
+	status = TraceDqrProfiler::DQERR_OK;
+
+	cacheName = nullptr;
+	elfPath = nullptr;
+	elfSize = 0;
+	elfTime = 0;
+	elfHash = 0;
+	haveHash = false;
+
+	if ((cacheDir == nullptr) || (elfName == nullptr)) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
 	}
 
-	if ((dst == nullptr) || (dstLen <= 0)) {
-		printf("Error: ITCPrint::flushITCPrintMsg(): Bad dst argument\n");
-		return false;
+	// the same elf file reached by different relative paths should find the same cache file
+
+#ifdef WINDOWS
+	char fullPath[_MAX_PATH];
+
+	if (_fullpath(fullPath, elfName, sizeof fullPath) == nullptr) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
 	}
+#else // WINDOWS
+	char* fullPath = realpath(elfName, nullptr);
 
-	if (numMsgs[core] > 0) {
-		return getITCPrintMsg(core, dst, dstLen, startTime, endTime);
+	if (fullPath == nullptr) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
 	}
+#endif // WINDOWS
 
-	if (pbo[core] != pbi[core]) {
-		TsList* tsl = consumeOldestTsList(core);
+	elfPath = new char[strlen(fullPath) + 1];
+	strcpy(elfPath, fullPath);
 
-		if ((tsl == nullptr) || (tsl->terminated != false)) {
-			printf("Error: ITCPrint::flushITCPrintMsg(): bad tsl object\n");
-			return false;
-		}
+#ifndef WINDOWS
+	free(fullPath);
+	fullPath = nullptr;
+#endif // WINDOWS
 
-		startTime = tsl->startTime;
-		endTime = tsl->endTime;
+	// name the cache file with a hash of the path
 
-		while (pbuff[core][pbo[core]] && (dstLen > 1)) {
-			*dst++ = pbuff[core][pbo[core]];
-			dstLen -= 1;
+	uint64_t pathHash = 0xcbf29ce484222325ULL;
 
-			pbo[core] += 1;
-			if (pbo[core] >= buffSize) {
-				pbo[core] = 0;
-			}
-		}
-		return true;
+	for (const char* cp = elfPath; *cp != 0; cp++) {
+		pathHash ^= (uint8_t)*cp;
+		pathHash *= 0x100000001b3ULL;
 	}
 
-	return false;
+	int len = strlen(cacheDir) + 32;
+
+	cacheName = new char[len];
+	snprintf(cacheName, len, "%s/%016llx.elfcache", cacheDir, (unsigned long long)pathHash);
+
+	status = statElfFile();
 }
 
-bool ITCPrint::getITCPrintStr(uint8_t core, std::string& s, TraceDqrProfiler::TIMESTAMP& startTime, TraceDqrProfiler::TIMESTAMP& endTime)
+ElfImageCache::~ElfImageCache()
 {
-	if (core >= numCores) {
-		return false;
+	if (cacheName != nullptr) {
+		delete[] cacheName;
+		cacheName = nullptr;
 	}
 
-	bool rc = false;
+	if (elfPath != nullptr) {
+		delete[] elfPath;
+		elfPath = nullptr;
+	}
+}
 
-	if (numMsgs[core] > 0) { // stuff in the Q
-		rc = true;
+TraceDqrProfiler::DQErr ElfImageCache::statElfFile()
+{
+#ifdef WINDOWS
+	WIN32_FILE_ATTRIBUTE_DATA fad;
 
-		TsList* tsl = consumeTerminatedTsList(core);
+	if (GetFileAttributesExA(elfPath, GetFileExInfoStandard, &fad) == 0) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		if (tsl == nullptr) {
-			printf("Error: ITCPrint::getITCPrintStr(): Bad tsl pointer\n");
-			return false;
-		}
+	elfSize = ((uint64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+	elfTime = ((uint64_t)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+#else // WINDOWS
+	struct stat sb;
 
-		startTime = tsl->startTime;
-		endTime = tsl->endTime;
+	if (stat(elfPath, &sb) != 0) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		numMsgs[core] -= 1;
+	elfSize = (uint64_t)sb.st_size;
+	elfTime = (uint64_t)sb.st_mtim.tv_sec * 1000000000ULL + (uint64_t)sb.st_mtim.tv_nsec;
+#endif // WINDOWS
 
-		while (pbuff[core][pbo[core]]) {
-			s += pbuff[core][pbo[core]];
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-			pbo[core] += 1;
-			if (pbo[core] >= buffSize) {
-				pbo[core] = 0;
-			}
+TraceDqrProfiler::DQErr ElfImageCache::hashElfFile()
+{
+	if (haveHash) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
+	FILE* fp = fopen(elfPath, "rb");
+	if (fp == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	// reading the whole elf file is still much less work than loading it. Chunks are a multiple of 8 bytes, so
+	// only the last one can end part way through a word
+
+	std::vector<uint8_t> buff(1024 * 1024);
+	uint64_t h = 0x6a09e667f3bcc908ULL;
+	uint64_t total = 0;
+	size_t n;
+
+	while ((n = fread(buff.data(), 1, buff.size(), fp)) > 0) {
+		size_t i;
+
+		for (i = 0; i + 8 <= n; i += 8) {
+			uint64_t w;
+
+			memcpy(&w, &buff[i], 8);
+			h = elfCacheMix(h, w);
 		}
 
-		pbo[core] += 1;
-		if (pbo[core] >= buffSize) {
-			pbo[core] = 0;
+		if (i < n) {
+			uint64_t w = 0;
+
+			memcpy(&w, &buff[i], n - i);
+			h = elfCacheMix(h, w);
 		}
+
+		total += n;
 	}
 
-	return rc;
+	bool readErr = ferror(fp) != 0;
+
+	fclose(fp);
+	fp = nullptr;
+
+	// a file that changed since it was stat'd is not cached
+
+	if (readErr || (total != elfSize)) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	elfHash = elfCacheMix(h, total);
+	haveHash = true;
+
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-bool ITCPrint::flushITCPrintStr(uint8_t core, std::string& s, TraceDqrProfiler::TIMESTAMP& startTime, TraceDqrProfiler::TIMESTAMP& endTime)
+TraceDqrProfiler::DQErr ElfImageCache::load(int& archSize, Section*& codeSectionLst, Sym*& syms, StringPool& stringPool)
 {
-	if (core >= numCores) {
-		return false;
+	if (status != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	if (numMsgs[core] > 0) {
-		return getITCPrintStr(core, s, startTime, endTime);
+	const uint8_t* base = nullptr;
+	uint64_t mapSize = 0;
+
+#ifdef WINDOWS
+	HANDLE mapFile = CreateFileA(cacheName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (mapFile == INVALID_HANDLE_VALUE) {
+		// nothing cached yet
+
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	if (pbo[core] != pbi[core]) {
-		TsList* tsl = consumeOldestTsList(core);
+	LARGE_INTEGER fileSize;
+	HANDLE mapHandle = nullptr;
 
-		if ((tsl == nullptr) || (tsl->terminated != false)) {
-			printf("Error: ITCPrint::flushITCPrintStr(): Bad tsl pointer\n");
-			return false;
+	if ((GetFileSizeEx(mapFile, &fileSize) != 0) && (fileSize.QuadPart >= (LONGLONG)sizeof(Header))) {
+		mapSize = (uint64_t)fileSize.QuadPart;
+
+		mapHandle = CreateFileMapping(mapFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapHandle != nullptr) {
+			base = (const uint8_t*)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
 		}
+	}
 
-		startTime = tsl->startTime;
-		endTime = tsl->endTime;
+	if (base == nullptr) {
+		if (mapHandle != nullptr) {
+			CloseHandle(mapHandle);
+		}
+		CloseHandle(mapFile);
 
-		s = "";
-		while (pbuff[core][pbo[core]]) {
-			s += pbuff[core][pbo[core]];
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+#else // WINDOWS
+	int fd = open(cacheName, O_RDONLY);
+	if (fd < 0) {
+		// nothing cached yet
 
-			pbo[core] += 1;
-			if (pbo[core] >= buffSize) {
-				pbo[core] = 0;
-			}
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	struct stat sb;
+
+	if ((fstat(fd, &sb) == 0) && ((uint64_t)sb.st_size >= sizeof(Header))) {
+		mapSize = (uint64_t)sb.st_size;
+
+		void* p = mmap(nullptr, (size_t)mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			base = (const uint8_t*)p;
 		}
-		return true;
 	}
 
-	return false;
-}
+	close(fd);
 
-ProfilerAnalytics::ProfilerAnalytics()
-{
-	cores = 0;
-	num_trace_msgs_all_cores = 0;
-	num_trace_bits_all_cores = 0;
-	num_trace_bits_all_cores_max = 0;
-	num_trace_bits_all_cores_min = 0;
-	num_trace_mseo_bits_all_cores = 0;
+	if (base == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+#endif // WINDOWS
 
-	num_inst_all_cores = 0;
-	num_inst16_all_cores = 0;
-	num_inst32_all_cores = 0;
+	TraceDqrProfiler::DQErr rc = TraceDqrProfiler::DQERR_ERR;
+	Header hdr;
 
-	num_branches_all_cores = 0;
+	memcpy(&hdr, base, sizeof hdr);
 
-	for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-		core[i].num_inst16 = 0;
-		core[i].num_inst32 = 0;
-		core[i].num_inst = 0;
+	const char* strings = (const char*)base + hdr.stringsOffset;
 
-		core[i].num_trace_msgs = 0;
-		core[i].num_trace_syncs = 0;
-		core[i].num_trace_dbranch = 0;
-		core[i].num_trace_ibranch = 0;
-		core[i].num_trace_ihistory = 0;
-		core[i].num_trace_ihistoryws = 0;
-		core[i].num_trace_resourcefull = 0;
-		core[i].num_trace_incircuittraceWS = 0;
-		core[i].num_trace_incircuittrace = 0;
+	// anything that does not match means the cache is stale or was not written completely
 
-		core[i].num_trace_dataacq = 0;
-		core[i].num_trace_dbranchws = 0;
-		core[i].num_trace_ibranchws = 0;
-		core[i].num_trace_correlation = 0;
-		core[i].num_trace_auxaccesswrite = 0;
-		core[i].num_trace_ownership = 0;
-		core[i].num_trace_error = 0;
+	bool valid = (memcmp(hdr.magic, "DQRELFC", 8) == 0) &&
+		(hdr.version == ELF_IMAGE_CACHE_VERSION) &&
+		(hdr.byteOrder == 0x01020304) &&
+		(hdr.cacheSize == mapSize) &&
+		(hdr.elfSize == elfSize) &&
+		(hdr.stringsOffset <= mapSize) && (hdr.stringsSize > 0) && (hdr.stringsSize <= mapSize - hdr.stringsOffset) &&
+		(strings[hdr.stringsSize - 1] == 0) &&
+		(hdr.sectionsOffset <= mapSize) && ((uint64_t)hdr.numSections * sizeof(SectionRec) <= mapSize - hdr.sectionsOffset) &&
+		(hdr.symsOffset <= mapSize) && ((uint64_t)hdr.numSyms * sizeof(SymRec) <= mapSize - hdr.symsOffset) &&
+		(hdr.elfPath < hdr.stringsSize) && (strcmp(&strings[hdr.elfPath], elfPath) == 0);
 
-		core[i].num_trace_ts = 0;
-		core[i].num_trace_uaddr = 0;
-		core[i].num_trace_faddr = 0;
-		core[i].num_trace_ihistory_taken_branches = 0;
-		core[i].num_trace_ihistory_nottaken_branches = 0;
-		core[i].num_trace_resourcefull_i_cnt = 0;
-		core[i].num_trace_resourcefull_hist = 0;
-		core[i].num_trace_resourcefull_takenCount = 0;
-		core[i].num_trace_resourcefull_notTakenCount = 0;
-		core[i].num_trace_resourcefull_taken_branches = 0;
-		core[i].num_trace_resourcefull_nottaken_branches = 0;
+	// only read the elf file when it looks to have changed
 
-		core[i].trace_bits = 0;
-		core[i].trace_bits_max = 0;
-		core[i].trace_bits_min = 0;
-		core[i].trace_bits_mseo = 0;
+	bool touched = false;
 
-		core[i].max_hist_bits = 0;
-		core[i].min_hist_bits = 0;
-		core[i].max_notTakenCount = 0;
-		core[i].min_notTakenCount = 0;
-		core[i].max_takenCount = 0;
-		core[i].min_takenCount = 0;
+	if (valid && (hdr.elfTime != elfTime)) {
+		valid = (hashElfFile() == TraceDqrProfiler::DQERR_OK) && (hdr.elfHash == elfHash);
+		touched = valid;
+	}
 
-		core[i].trace_bits_sync = 0;
-		core[i].trace_bits_dbranch = 0;
-		core[i].trace_bits_ibranch = 0;
-		core[i].trace_bits_dataacq = 0;
-		core[i].trace_bits_dbranchws = 0;
-		core[i].trace_bits_ibranchws = 0;
-		core[i].trace_bits_ihistory = 0;
-		core[i].trace_bits_ihistoryws = 0;
-		core[i].trace_bits_resourcefull = 0;
-		core[i].trace_bits_correlation = 0;
-		core[i].trace_bits_auxaccesswrite = 0;
-		core[i].trace_bits_ownership = 0;
-		core[i].trace_bits_error = 0;
-		core[i].trace_bits_incircuittrace = 0;
-		core[i].trace_bits_incircuittraceWS = 0;
+	if (valid) {
+		std::vector<Section*> sectionVec;
+		std::vector<Sym*> symVec;
+		std::unordered_map<uint32_t, char*> pooled; // string table offset to the same string in stringPool
+		Section* lastSection = nullptr;
+		Sym* lastSym = nullptr;
 
-		core[i].trace_bits_ts = 0;
-		core[i].trace_bits_ts_max = 0;
-		core[i].trace_bits_ts_min = 0;
+		// everything points into stringPool, as it would have from the loaders
 
-		core[i].trace_bits_uaddr = 0;
-		core[i].trace_bits_uaddr_max = 0;
-		core[i].trace_bits_uaddr_min = 0;
+		auto poolString = [&](uint32_t offset) -> char* {
+			std::unordered_map<uint32_t, char*>::iterator it = pooled.find(offset);
 
-		core[i].trace_bits_faddr = 0;
-		core[i].trace_bits_faddr_max = 0;
-		core[i].trace_bits_faddr_min = 0;
+			if (it == pooled.end()) {
+				it = pooled.insert(std::make_pair(offset, stringPool.intern(&strings[offset]))).first;
+			}
 
-		core[i].trace_bits_hist = 0;
+			return it->second;
+		};
 
-		core[i].num_taken_branches = 0;
-		core[i].num_notTaken_branches = 0;
-		core[i].num_calls = 0;
-		core[i].num_returns = 0;
-		core[i].num_swaps = 0;
-		core[i].num_exceptions = 0;
-		core[i].num_exception_returns = 0;
-		core[i].num_interrupts = 0;
-	}
+		archSize = (int)hdr.archSize;
 
-#ifdef DO_TIMES
-	etimer = new Timer();
-#endif // DO_TIMES
+		for (uint32_t i = 0; (i < hdr.numSections) && valid; i++) {
+			SectionRec sr;
 
-	status = TraceDqrProfiler::DQERR_OK;
-}
+			memcpy(&sr, base + hdr.sectionsOffset + i * sizeof(SectionRec), sizeof sr);
 
-ProfilerAnalytics::~ProfilerAnalytics()
-{
-#ifdef DO_TIMES
-	if (etimer != nullptr) {
-		delete etimer;
-		etimer = nullptr;
-	}
-#endif // DO_TIMES
-}
+			Section* sp = new Section();
 
-TraceDqrProfiler::DQErr ProfilerAnalytics::updateTraceInfo(ProfilerNexusMessage& nm, uint32_t bits, uint32_t mseo_bits, uint32_t ts_bits, uint32_t addr_bits)
-{
-	bool have_uaddr = false;
-	bool have_faddr = false;
+			if (lastSection == nullptr) {
+				codeSectionLst = sp;
+			}
+			else {
+				lastSection->next = sp;
+			}
+			lastSection = sp;
+			sectionVec.push_back(sp);
 
-	num_trace_msgs_all_cores += 1;
-	num_trace_bits_all_cores += bits;
-	num_trace_mseo_bits_all_cores += mseo_bits;
+			if ((sr.name >= hdr.stringsSize) || (strlen(&strings[sr.name]) >= sizeof sp->name)) {
+				valid = false;
+				break;
+			}
 
-	core[nm.coreId].num_trace_msgs += 1;
+			strcpy(sp->name, &strings[sr.name]);
+			sp->startAddr = sr.startAddr;
+			sp->endAddr = sr.endAddr;
+			sp->flags = sr.flags;
+			sp->size = sr.size;
+			sp->offset = sr.offset;
+			sp->align = sr.align;
 
-	if (bits > num_trace_bits_all_cores_max) {
-		num_trace_bits_all_cores_max = bits;
-	}
+			if (sr.hasCode == 0) {
+				continue;
+			}
 
-	if ((num_trace_bits_all_cores_min == 0) || (bits < num_trace_bits_all_cores_min)) {
-		num_trace_bits_all_cores_min = bits;
-	}
+			uint64_t numSlots = (sp->size + 1) / 2;
+			uint64_t dataSize = numSlots * 2 + (uint64_t)sr.numLines * sizeof(LineRec) + (uint64_t)sr.numDiss * sizeof(DissRec);
 
-	core[nm.coreId].trace_bits_mseo += mseo_bits;
-	core[nm.coreId].trace_bits += bits;
+			if ((sr.dataOffset > mapSize) || (dataSize > mapSize - sr.dataOffset)) {
+				valid = false;
+				break;
+			}
 
-	if (bits > core[nm.coreId].trace_bits_max) {
-		core[nm.coreId].trace_bits_max = bits;
-	}
+			const uint8_t* data = base + sr.dataOffset;
+			const uint8_t* lineData = data + numSlots * 2;
+			const uint8_t* dissData = lineData + (uint64_t)sr.numLines * sizeof(LineRec);
 
-	if ((core[nm.coreId].trace_bits_min == 0) || (bits < core[nm.coreId].trace_bits_min)) {
-		core[nm.coreId].trace_bits_min = bits;
-	}
+			sp->code = new uint16_t[numSlots];
 
-	cores |= (1 << nm.coreId);
+			memcpy(sp->code, data, numSlots * 2);
 
-	if (ts_bits > 0) {
-		core[nm.coreId].num_trace_ts += 1;
-		core[nm.coreId].trace_bits_ts += ts_bits;
+			for (uint32_t j = 0; j < sr.numLines; j++) {
+				LineRec lr;
+				uint32_t end = (uint32_t)numSlots;
+				char* file = nullptr;
 
-		if (ts_bits > core[nm.coreId].trace_bits_ts_max) {
-			core[nm.coreId].trace_bits_ts_max = ts_bits;
-		}
+				memcpy(&lr, lineData + j * sizeof(LineRec), sizeof lr);
 
-		if ((core[nm.coreId].trace_bits_ts_min == 0) || (ts_bits < core[nm.coreId].trace_bits_ts_min)) {
-			core[nm.coreId].trace_bits_ts_min = ts_bits;
+				if (j + 1 < sr.numLines) {
+					memcpy(&end, lineData + (j + 1) * sizeof(LineRec), sizeof end);
+				}
+
+				if (lr.file < hdr.stringsSize) {
+					file = poolString(lr.file);
+				}
+
+				sp->setSrcLines(lr.index, end, file, lr.line);
+			}
+
+			for (uint32_t j = 0; j < sr.numDiss; j++) {
+				DissRec dr;
+
+				memcpy(&dr, dissData + j * sizeof(DissRec), sizeof dr);
+
+				if (dr.text >= hdr.stringsSize) {
+					valid = false;
+					break;
+				}
+
+				sp->setDiss(dr.index, poolString(dr.text));
+			}
 		}
-	}
 
-	int msb;
-	uint64_t mask;
-	int taken;
-	int nottaken;
+		for (uint32_t i = 0; (i < hdr.numSyms) && valid; i++) {
+			SymRec sr;
 
-	switch (nm.tcode) {
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-		core[nm.coreId].num_trace_ownership += 1;
-		core[nm.coreId].trace_bits_ownership += bits;
-		break;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-		core[nm.coreId].num_trace_dbranch += 1;
-		core[nm.coreId].trace_bits_dbranch += bits;
-		num_branches_all_cores += 1;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-		core[nm.coreId].num_trace_ibranch += 1;
-		core[nm.coreId].trace_bits_ibranch += bits;
-		num_branches_all_cores += 1;
-
-		have_uaddr = true;
-		break;
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-		core[nm.coreId].num_trace_dataacq += 1;
-		core[nm.coreId].trace_bits_dataacq += bits;
-		break;
-	case TraceDqrProfiler::TCODE_ERROR:
-		core[nm.coreId].num_trace_error += 1;
-		core[nm.coreId].trace_bits_error += bits;
-		break;
-	case TraceDqrProfiler::TCODE_SYNC:
-		core[nm.coreId].num_trace_syncs += 1;
-		core[nm.coreId].trace_bits_sync += bits;
-
-		have_faddr = true;
-		break;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-		core[nm.coreId].num_trace_dbranchws += 1;
-		core[nm.coreId].trace_bits_dbranchws += bits;
-		num_branches_all_cores += 1;
-
-		have_faddr = true;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-		core[nm.coreId].num_trace_ibranchws += 1;
-		core[nm.coreId].trace_bits_ibranchws += bits;
-		num_branches_all_cores += 1;
+			memcpy(&sr, base + hdr.symsOffset + i * sizeof(SymRec), sizeof sr);
 
-		have_faddr = true;
-		break;
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-		core[nm.coreId].num_trace_rbranch += 1;
-		core[nm.coreId].trace_bits_rbranch += bits;
-		num_branches_all_cores += nm.repeatBranch.b_cnt;
-		break;
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-		core[nm.coreId].num_trace_auxaccesswrite += 1;
-		core[nm.coreId].trace_bits_auxaccesswrite += bits;
-		break;
-	case TraceDqrProfiler::TCODE_CORRELATION:
-		core[nm.coreId].num_trace_correlation += 1;
-		core[nm.coreId].trace_bits_ibranchws += bits;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-		core[nm.coreId].num_trace_ihistory += 1;
-		core[nm.coreId].trace_bits_ihistory += bits;
+			if ((sr.name >= hdr.stringsSize) || (sr.section < -1) || (sr.section >= (int32_t)sectionVec.size()) || (sr.srcFile < -1) || (sr.srcFile >= (int32_t)hdr.numSyms)) {
+				valid = false;
+				break;
+			}
 
-		// need to find msb = 1
+			Sym* sym = new Sym();
 
-		msb = -1;
-		mask = nm.indirectHistory.history;
-		taken = -1;	// start at -1 to account for stop bit, which isn't a branch
-		nottaken = 0;
+			sym->next = nullptr;
+			sym->name = poolString(sr.name);
+			sym->flags = sr.flags;
+			sym->address = sr.address;
+			sym->size = sr.size;
+			sym->section = (sr.section >= 0) ? sectionVec[sr.section] : nullptr;
+			sym->srcFile = nullptr;
 
-		while (mask > 1) { // use > 1 because the most significant 1 is a stop bit which we don't want to count!
-			msb += 1;
-			if (mask & 1) {
-				taken += 1;
+			if (lastSym == nullptr) {
+				syms = sym;
 			}
 			else {
-				nottaken += 1;
+				lastSym->next = sym;
 			}
-			mask >>= 1;
+			lastSym = sym;
+			symVec.push_back(sym);
 		}
 
-		core[nm.coreId].num_trace_ihistory_taken_branches += taken;
-		core[nm.coreId].num_trace_ihistory_nottaken_branches += nottaken;
+		for (uint32_t i = 0; (i < hdr.numSyms) && valid; i++) {
+			SymRec sr;
 
-		if (msb >= 0) {
-			core[nm.coreId].trace_bits_hist += msb + 1;
+			memcpy(&sr, base + hdr.symsOffset + i * sizeof(SymRec), sizeof sr);
 
-			if (msb >= (int32_t)core[nm.coreId].max_hist_bits) {
-				core[nm.coreId].max_hist_bits = msb + 1;
+			if (sr.srcFile >= 0) {
+				symVec[i]->srcFile = symVec[sr.srcFile];
 			}
 		}
 
-		if ((msb + 1) < (int32_t)core[nm.coreId].min_hist_bits) {
-			core[nm.coreId].min_hist_bits = msb + 1;
+		if (valid) {
+			rc = TraceDqrProfiler::DQERR_OK;
 		}
+	}
 
-		num_branches_all_cores += 1 + taken + nottaken;
-
-		have_uaddr = true;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-		core[nm.coreId].num_trace_ihistoryws += 1;
-		core[nm.coreId].trace_bits_ihistoryws += bits;
+#ifdef WINDOWS
+	UnmapViewOfFile(base);
+	CloseHandle(mapHandle);
+	CloseHandle(mapFile);
+#else // WINDOWS
+	munmap((void*)base, (size_t)mapSize);
+#endif // WINDOWS
 
-		// need to find msb = 1
+	// same contents with a new time. Record the time so the next session does not hash the elf file again
 
-		msb = -1;
-		mask = nm.indirectHistoryWS.history;
-		taken = -1;	// start at -1 to account for stop bit, which isn't a branch
-		nottaken = 0;
+	if ((rc == TraceDqrProfiler::DQERR_OK) && touched) {
+		FILE* fp = fopen(cacheName, "r+b");
 
-		while (mask > 1) {
-			msb += 1;
-			if (mask & 1) {
-				taken += 1;
-			}
-			else {
-				nottaken += 1;
-			}
-			mask >>= 1;
+		if (fp != nullptr) {
+			hdr.elfTime = elfTime;
+			fwrite(&hdr, 1, sizeof hdr, fp);
+			fclose(fp);
+			fp = nullptr;
 		}
+	}
 
-		core[nm.coreId].num_trace_ihistory_taken_branches += taken;
-		core[nm.coreId].num_trace_ihistory_nottaken_branches += nottaken;
+	return rc;
+}
 
-		if (msb >= 0) {
-			core[nm.coreId].trace_bits_hist += msb + 1;
+TraceDqrProfiler::DQErr ElfImageCache::save(int archSize, Section* codeSectionLst, Sym* syms)
+{
+	if ((status != TraceDqrProfiler::DQERR_OK) || (hashElfFile() != TraceDqrProfiler::DQERR_OK)) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-			if (msb >= (int32_t)core[nm.coreId].max_hist_bits) {
-				core[nm.coreId].max_hist_bits = msb + 1;
-			}
+	std::string strings;
+	std::unordered_map<std::string, uint32_t> stringOffsets;
+	std::unordered_map<const char*, uint32_t> fileOffsets;
+	std::unordered_map<Section*, int32_t> sectionIndexes;
+	std::unordered_map<Sym*, int32_t> symIndexes;
+	uint32_t numSections = 0;
+	uint32_t numSyms = 0;
+
+	for (Section* sp = codeSectionLst; sp != nullptr; sp = sp->next) {
+		sectionIndexes[sp] = (int32_t)numSections;
+		numSections += 1;
+	}
+
+	for (Sym* sym = syms; sym != nullptr; sym = sym->next) {
+		symIndexes[sym] = (int32_t)numSyms;
+		numSyms += 1;
+	}
+
+	// offset of s in the string table, adding it if it is not there yet
+
+	auto addString = [&](const char* s) -> uint32_t {
+		if (s == nullptr) {
+			return 0xffffffff;
 		}
 
-		if ((msb + 1) < (int32_t)core[nm.coreId].min_hist_bits) {
-			core[nm.coreId].min_hist_bits = msb + 1;
+		std::unordered_map<std::string, uint32_t>::iterator it = stringOffsets.find(s);
+		if (it != stringOffsets.end()) {
+			return it->second;
 		}
 
-		num_branches_all_cores += 1 + taken + nottaken;
+		uint32_t offset = (uint32_t)strings.size();
 
-		have_faddr = true;
-		break;
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-		core[nm.coreId].num_trace_resourcefull += 1;
-		core[nm.coreId].trace_bits_resourcefull += bits;
+		strings.append(s);
+		strings.push_back(0);
+		stringOffsets[s] = offset;
 
-		switch (nm.resourceFull.rCode) {
-		case 0:
-			core[nm.coreId].num_trace_resourcefull_i_cnt += 1;
-			break;
-		case 1:
-			core[nm.coreId].num_trace_resourcefull_hist += 1;
+		return offset;
+	};
 
-			// need to find msb = 1
+	std::vector<uint8_t> out;
+	Header hdr;
 
-			msb = -1;
-			mask = nm.resourceFull.history;
-			taken = -1;	// start at -1 to account for stop bit, which isn't a branch
-			nottaken = 0;
+	memset(&hdr, 0, sizeof hdr);
 
-			while (mask > 1) {
-				msb += 1;
-				if (mask & 1) {
-					taken += 1;
-				}
-				else {
-					nottaken += 1;
-				}
-				mask >>= 1;
-			}
+	out.resize(sizeof(Header));
 
-			core[nm.coreId].num_trace_ihistory_taken_branches += taken;
-			core[nm.coreId].num_trace_ihistory_nottaken_branches += nottaken;
+	hdr.sectionsOffset = out.size();
+	out.resize(out.size() + numSections * sizeof(SectionRec));
 
-			if (msb >= 0) {
-				core[nm.coreId].trace_bits_hist += msb + 1;
+	hdr.symsOffset = out.size();
+	out.resize(out.size() + numSyms * sizeof(SymRec));
 
-				if (msb >= (int32_t)core[nm.coreId].max_hist_bits) {
-					core[nm.coreId].max_hist_bits = msb + 1;
-				}
-			}
+	int index = 0;
 
-			if ((msb + 1) < (int32_t)core[nm.coreId].min_hist_bits) {
-				core[nm.coreId].min_hist_bits = msb + 1;
-			}
+	for (Section* sp = codeSectionLst; sp != nullptr; sp = sp->next, index++) {
+		SectionRec sr;
 
-			num_branches_all_cores += taken + nottaken;
-			break;
-		case 8:
-			core[nm.coreId].num_trace_resourcefull_notTakenCount += 1;
-			core[nm.coreId].num_trace_resourcefull_nottaken_branches += nm.resourceFull.notTakenCount;
+		memset(&sr, 0, sizeof sr);
 
-			// compute avg/max/min not taken count
+		sr.startAddr = sp->startAddr;
+		sr.endAddr = sp->endAddr;
+		sr.name = addString(sp->name);
+		sr.flags = sp->flags;
+		sr.size = sp->size;
+		sr.offset = sp->offset;
+		sr.align = sp->align;
 
-			if (nm.resourceFull.notTakenCount > (uint32_t)core[nm.coreId].max_notTakenCount) {
-				core[nm.coreId].max_notTakenCount = nm.resourceFull.notTakenCount;
-			}
+		if (sp->code != nullptr) {
+			uint32_t numSlots = (sp->size + 1) / 2;
+			std::vector<LineRange> ranges;
+			std::vector<std::pair<uint32_t, const char*>> dissList;
 
-			if ((core[nm.coreId].min_notTakenCount == 0) || (nm.resourceFull.notTakenCount < (uint32_t)core[nm.coreId].min_notTakenCount)) {
-				core[nm.coreId].min_notTakenCount = nm.resourceFull.notTakenCount;
-			}
-			break;
-		case 9:
-			core[nm.coreId].num_trace_resourcefull_takenCount += 1;
-			core[nm.coreId].num_trace_resourcefull_taken_branches += nm.resourceFull.takenCount;
+			sp->getLineRanges(ranges);
+			sp->getDissList(dissList);
 
-			// compute avg/max/min taken count
+			out.resize((out.size() + 7) & ~(size_t)7);
 
-			if (nm.resourceFull.takenCount > (uint32_t)core[nm.coreId].max_takenCount) {
-				core[nm.coreId].max_takenCount = nm.resourceFull.takenCount;
+			sr.hasCode = 1;
+			sr.numLines = (uint32_t)ranges.size();
+			sr.numDiss = (uint32_t)dissList.size();
+			sr.dataOffset = out.size();
+
+			out.resize(out.size() + (size_t)numSlots * 2 + ranges.size() * sizeof(LineRec) + dissList.size() * sizeof(DissRec));
+
+			uint8_t* data = &out[sr.dataOffset];
+			uint8_t* lineData = data + (size_t)numSlots * 2;
+			uint8_t* dissData = lineData + ranges.size() * sizeof(LineRec);
+
+			memcpy(data, sp->code, numSlots * 2);
+
+			for (size_t j = 0; j < ranges.size(); j++) {
+				LineRec lr;
+
+				lr.index = ranges[j].index;
+				lr.line = ranges[j].line;
+				lr.file = 0xffffffff;
+
+				if (ranges[j].file != nullptr) {
+					std::unordered_map<const char*, uint32_t>::iterator it = fileOffsets.find(ranges[j].file);
+
+					if (it == fileOffsets.end()) {
+						it = fileOffsets.insert(std::make_pair((const char*)ranges[j].file, addString(ranges[j].file))).first;
+					}
+
+					lr.file = it->second;
+				}
+
+				memcpy(lineData + j * sizeof(LineRec), &lr, sizeof lr);
 			}
 
-			if ((core[nm.coreId].min_takenCount == 0) || (nm.resourceFull.takenCount < (uint32_t)core[nm.coreId].min_takenCount)) {
-				core[nm.coreId].min_takenCount = nm.resourceFull.takenCount;
+			for (size_t j = 0; j < dissList.size(); j++) {
+				DissRec dr;
+
+				dr.index = dissList[j].first;
+				dr.text = addString(dissList[j].second);
+
+				memcpy(dissData + j * sizeof(DissRec), &dr, sizeof dr);
 			}
-			break;
-		default:
-			printf("Error: ProfilerAnalytics::updateTraceInfo(): ResoureFull: unknown RDode: %d\n", nm.resourceFull.rCode);
-			status = TraceDqrProfiler::DQERR_ERR;
-			return status;
 		}
-		break;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		core[nm.coreId].num_trace_incircuittrace += 1;
-		core[nm.coreId].trace_bits_incircuittrace += bits;
-		have_uaddr = true;
-		break;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-		core[nm.coreId].num_trace_incircuittraceWS += 1;
-		core[nm.coreId].trace_bits_incircuittraceWS += bits;
-		have_faddr = true;
-		break;
-	case TraceDqrProfiler::TCODE_TRAP_INFO:
-		core[nm.coreId].num_trace_trapinfo += 1;
-		core[nm.coreId].trace_bits_trapinfo += bits;
-		break;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	default:
-		status = TraceDqrProfiler::DQERR_ERR;
-		return status;
+
+		memcpy(&out[hdr.sectionsOffset + index * sizeof(SectionRec)], &sr, sizeof sr);
 	}
 
-	if (have_uaddr) {
-		core[nm.coreId].num_trace_uaddr += 1;
-		core[nm.coreId].trace_bits_uaddr += addr_bits;
+	index = 0;
 
-		if (addr_bits > core[nm.coreId].trace_bits_uaddr_max) {
-			core[nm.coreId].trace_bits_uaddr_max = addr_bits;
+	for (Sym* sym = syms; sym != nullptr; sym = sym->next, index++) {
+		SymRec sr;
+
+		memset(&sr, 0, sizeof sr);
+
+		sr.address = sym->address;
+		sr.size = sym->size;
+		sr.name = addString(sym->name);
+		sr.flags = sym->flags;
+		sr.section = -1;
+		sr.srcFile = -1;
+
+		if (sym->section != nullptr) {
+			std::unordered_map<Section*, int32_t>::iterator it = sectionIndexes.find(sym->section);
+			if (it != sectionIndexes.end()) {
+				sr.section = it->second;
+			}
 		}
 
-		if ((core[nm.coreId].trace_bits_uaddr_min == 0) || (addr_bits < core[nm.coreId].trace_bits_uaddr_min)) {
-			core[nm.coreId].trace_bits_uaddr_min = addr_bits;
+		if (sym->srcFile != nullptr) {
+			std::unordered_map<Sym*, int32_t>::iterator it = symIndexes.find(sym->srcFile);
+			if (it != symIndexes.end()) {
+				sr.srcFile = it->second;
+			}
 		}
+
+		memcpy(&out[hdr.symsOffset + index * sizeof(SymRec)], &sr, sizeof sr);
 	}
-	else if (have_faddr) {
-		core[nm.coreId].num_trace_faddr += 1;
-		core[nm.coreId].trace_bits_faddr += addr_bits;
 
-		if (addr_bits > core[nm.coreId].trace_bits_faddr_max) {
-			core[nm.coreId].trace_bits_faddr_max = addr_bits;
-		}
+	hdr.elfPath = addString(elfPath);
 
-		if ((core[nm.coreId].trace_bits_faddr_min == 0) || (addr_bits < core[nm.coreId].trace_bits_faddr_min)) {
-			core[nm.coreId].trace_bits_faddr_min = addr_bits;
-		}
-	}
+	out.resize((out.size() + 7) & ~(size_t)7);
 
-	return status;
-}
+	hdr.stringsOffset = out.size();
+	hdr.stringsSize = strings.size();
 
-TraceDqrProfiler::DQErr ProfilerAnalytics::updateInstructionInfo(uint32_t core_id, uint32_t inst, int instSize, int crFlags, TraceDqrProfiler::BranchFlags brFlags)
-{
-	num_inst_all_cores += 1;
-	core[core_id].num_inst += 1;
+	out.insert(out.end(), strings.begin(), strings.end());
 
-	switch (instSize) {
-	case 16:
-		num_inst16_all_cores += 1;
-		core[core_id].num_inst16 += 1;
-		break;
-	case 32:
-		num_inst32_all_cores += 1;
-		core[core_id].num_inst32 += 1;
-		break;
-	default:
-		status = TraceDqrProfiler::DQERR_ERR;
-	}
+	memcpy(hdr.magic, "DQRELFC", 8);
+	hdr.version = ELF_IMAGE_CACHE_VERSION;
+	hdr.byteOrder = 0x01020304;
+	hdr.cacheSize = out.size();
+	hdr.elfSize = elfSize;
+	hdr.elfTime = elfTime;
+	hdr.elfHash = elfHash;
+	hdr.archSize = (uint32_t)archSize;
+	hdr.numSections = numSections;
+	hdr.numSyms = numSyms;
 
-	switch (brFlags) {
-	case TraceDqrProfiler::BRFLAG_none:
-	case TraceDqrProfiler::BRFLAG_unknown:
-		break;
-	case TraceDqrProfiler::BRFLAG_taken:
-		core[core_id].num_taken_branches += 1;
-		break;
-	case TraceDqrProfiler::BRFLAG_notTaken:
-		core[core_id].num_notTaken_branches += 1;
-		break;
-	}
+	memcpy(&out[0], &hdr, sizeof hdr);
 
-	if (crFlags & TraceDqrProfiler::isCall) {
-		core[core_id].num_calls += 1;
-	}
-	if (crFlags & TraceDqrProfiler::isReturn) {
-		core[core_id].num_returns += 1;
-	}
-	if (crFlags & TraceDqrProfiler::isSwap) {
-		core[core_id].num_swaps += 1;
+	// write a temporary file and rename it into place, so a session starting at the same time never maps a
+	// partly written cache file
+
+	char* dirEnd = strrchr(cacheName, '/');
+
+	*dirEnd = 0;
+#ifdef WINDOWS
+	_mkdir(cacheName);
+#else // WINDOWS
+	mkdir(cacheName, 0755);
+#endif // WINDOWS
+	*dirEnd = '/';
+
+	std::string tmpName = std::string(cacheName) + "." + std::to_string((long long)getpid()) + ".tmp";
+
+	FILE* fp = fopen(tmpName.c_str(), "wb");
+	if (fp == nullptr) {
+		printf("Error: ElfImageCache::save(): Could not create cache file %s\n", tmpName.c_str());
+		return TraceDqrProfiler::DQERR_ERR;
 	}
-	if (crFlags & TraceDqrProfiler::isInterrupt) {
-		core[core_id].num_interrupts += 1;
+
+	bool writeErr = fwrite(out.data(), 1, out.size(), fp) != out.size();
+
+	if (fclose(fp) != 0) {
+		writeErr = true;
 	}
-	if (crFlags & TraceDqrProfiler::isException) {
-		core[core_id].num_exceptions += 1;
+	fp = nullptr;
+
+	if (!writeErr && (rename(tmpName.c_str(), cacheName) != 0)) {
+		// windows will not rename over an existing file
+
+		remove(cacheName);
+		writeErr = rename(tmpName.c_str(), cacheName) != 0;
 	}
-	if (crFlags & TraceDqrProfiler::isExceptionReturn) {
-		core[core_id].num_exception_returns += 1;
+
+	if (writeErr) {
+		printf("Error: ElfImageCache::save(): Could not write cache file %s\n", cacheName);
+		remove(tmpName.c_str());
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	return status;
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-static void updateDst(int n, char*& dst, int& dst_len)
+size_t StringPool::StrHash::operator()(const char* str) const
 {
-	if (n >= dst_len) {
-		dst += dst_len;
-		dst_len = 0;
-	}
-	else {
-		dst += n;
-		dst_len -= n;
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (const char* cp = str; *cp != 0; cp++) {
+		h ^= (uint8_t)*cp;
+		h *= 0x100000001b3ULL;
 	}
+
+	return (size_t)h;
 }
 
-void ProfilerAnalytics::toText(char* dst, int dst_len, int detailLevel)
+StringPool::StringPool()
 {
-	char tmp_dst[512];
-	int n;
-#ifdef DO_TIMES
-	double etime = etimer->etime();
-#endif // DO_TIMES
+	blockNext = nullptr;
+	blockLeft = 0;
+}
 
-	if ((dst == nullptr) || (dst_len < 0)) {
-		printf("Error: Anaylics::toText(): Bad dst pointer\n");
-		return;
+StringPool::~StringPool()
+{
+	strings.clear();
+
+	for (size_t i = 0; i < blocks.size(); i++) {
+		delete[] blocks[i];
 	}
 
-	dst[0] = 0;
+	blocks.clear();
+	blockNext = nullptr;
+	blockLeft = 0;
+}
 
-	if (detailLevel <= 0) {
-		return;
+char* StringPool::intern(const char* str)
+{
+	if (str == nullptr) {
+		printf("Error: StringPool::intern(): Null str argument\n");
+		return nullptr;
 	}
 
-	uint32_t have_ts = 0;
-
-	for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-		if (cores & (1 << i)) {
-			if (core[i].num_trace_ts > 0) {
-				have_ts |= (1 << i);
-			}
-		}
+	std::unordered_set<const char*, StrHash, StrEqual>::iterator it = strings.find(str);
+	if (it != strings.end()) {
+		return (char*)*it;
 	}
 
-	if (srcBits == 0) {
-		n = snprintf(dst, dst_len, "TraceProfiler ProfilerAnalytics: Single core");
-		updateDst(n, dst, dst_len);
+	size_t len = strlen(str) + 1;
+	char* dst;
+
+	if (len > blockSize / 4) {
+		// a long string gets a block of its own, so it doesn't waste the rest of the current block
+
+		dst = new char[len];
+		blocks.push_back(dst);
 	}
 	else {
-		n = snprintf(dst, dst_len, "TraceProfiler ProfilerAnalytics: Multi core (src field %d bits)", srcBits);
-		updateDst(n, dst, dst_len);
-	}
+		if (len > blockLeft) {
+			blockNext = new char[blockSize];
+			blockLeft = blockSize;
+			blocks.push_back(blockNext);
+		}
 
-	if (have_ts == 0) {
-		n = snprintf(dst, dst_len, "; TraceProfiler messages do not have timestamps\n");
-		updateDst(n, dst, dst_len);
+		dst = blockNext;
+		blockNext += len;
+		blockLeft -= len;
 	}
-	else if (have_ts == cores) {
-		n = snprintf(dst, dst_len, "; TraceProfiler messages have timestamps\n");
-		updateDst(n, dst, dst_len);
+
+	memcpy(dst, str, len);
+	strings.insert(dst);
+
+	return dst;
+}
+
+char* StringPool::find(const char* str)
+{
+	if (str == nullptr) {
+		return nullptr;
 	}
-	else {
-		n = snprintf(dst, dst_len, "; Some trace messages have timestamps\n");
-		updateDst(n, dst, dst_len);
+
+	std::unordered_set<const char*, StrHash, StrEqual>::iterator it = strings.find(str);
+	if (it == strings.end()) {
+		return nullptr;
 	}
 
-	if (detailLevel == 1) {
-		n = snprintf(dst, dst_len, "\n");
-		updateDst(n, dst, dst_len);
+	return (char*)*it;
+}
 
-		n = snprintf(dst, dst_len, "Instructions             Compressed                   RV32\n");
-		updateDst(n, dst, dst_len);
+void StringPool::dump()
+{
+	printf("StringPool: %u strings in %u blocks\n", (uint32_t)strings.size(), (uint32_t)blocks.size());
 
-		if (num_inst_all_cores > 0) {
-			n = snprintf(dst, dst_len, "  %10u    %10u (%0.2f%%)    %10u (%0.2f%%)\n", num_inst_all_cores, num_inst16_all_cores, ((float)num_inst16_all_cores) / num_inst_all_cores * 100.0, num_inst32_all_cores, ((float)num_inst32_all_cores) / num_inst_all_cores * 100.0);
-		}
-		else {
-			n = snprintf(dst, dst_len, "          -");
-		}
-		updateDst(n, dst, dst_len);
+	for (std::unordered_set<const char*, StrHash, StrEqual>::iterator it = strings.begin(); it != strings.end(); ++it) {
+		printf("0x%08llx %s\n", (unsigned long long)(uintptr_t)*it, *it);
+	}
+}
 
-		n = snprintf(dst, dst_len, "\n");
-		updateDst(n, dst, dst_len);
+ElfReader::ElfReader(const char* elfname, const char* odExe, const char* cacheDir, bool useObjDump)
+{
+	status = TraceDqrProfiler::DQERR_OK;
+	symtab = nullptr;
+	codeSectionLst = nullptr;
+	elfName = nullptr;
 
-		n = snprintf(dst, dst_len, "Number of TraceProfiler Msgs      Avg Length    Min Length    Max Length    Total Length\n");
-		updateDst(n, dst, dst_len);
+	if (elfname == nullptr) {
+		printf("Error: ElfReader::ElfReader(): No elf file name specified\n");
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
+	}
 
-		n = snprintf(dst, dst_len, "          %10u          %6.2f    %10u    %10u      %10u\n", num_trace_msgs_all_cores, ((float)num_trace_bits_all_cores) / num_trace_msgs_all_cores, num_trace_bits_all_cores_min, num_trace_bits_all_cores_max, num_trace_bits_all_cores);
-		updateDst(n, dst, dst_len);
+	int len = strlen(elfname) + 1;
+	elfName = new char[len];
+	strcpy(elfName, elfname);
 
-		n = snprintf(dst, dst_len, "\n");
-		updateDst(n, dst, dst_len);
+	Sym* symLst = nullptr;
+	TraceDqrProfiler::DQErr rc;
+	ElfImageCache* cache = nullptr;
+	bool cached = false;
 
-		if (num_inst_all_cores > 0) {
-			n = snprintf(dst, dst_len, "TraceProfiler bits per instruction:     %5.2f\n", ((float)num_trace_bits_all_cores) / num_inst_all_cores);
-		}
-		else {
-			n = snprintf(dst, dst_len, "  --\n");
-		}
-		updateDst(n, dst, dst_len);
+	// an image cached by an earlier session saves loading the elf file. Unless its time has changed, the elf file
+	// is not even read
 
-		n = snprintf(dst, dst_len, "Instructions per trace message: %5.2f\n", ((float)num_inst_all_cores) / num_trace_msgs_all_cores);
-		updateDst(n, dst, dst_len);
+	if (cacheDir != nullptr) {
+		cache = new ElfImageCache(cacheDir, elfname);
 
-		if (num_branches_all_cores > 0) {
-			n = snprintf(dst, dst_len, "Instructions per taken branch:  %5.2f\n", ((float)num_inst_all_cores) / num_branches_all_cores);
+		if (cache->load(archSize, codeSectionLst, symLst, stringPool) == TraceDqrProfiler::DQERR_OK) {
+			cached = true;
 		}
 		else {
-			n = snprintf(dst, dst_len, "--\n");
+			freeLists(codeSectionLst, symLst);
 		}
-		updateDst(n, dst, dst_len);
+	}
 
-		if (srcBits > 0) {
-			n = snprintf(dst, dst_len, "Src bits %% of message:          %5.2f%%\n", ((float)srcBits * num_trace_msgs_all_cores) / num_trace_bits_all_cores * 100.0);
-			updateDst(n, dst, dst_len);
+	if (cached == false) {
+		// read the elf file directly. objdump is only run if that fails or the caller asks for it
+
+		rc = TraceDqrProfiler::DQERR_ERR;
+
+		if (useObjDump == false) {
+			ElfLoader* elfLoader = new ElfLoader(elfname, archSize, codeSectionLst, symLst, stringPool);
+			rc = elfLoader->getStatus();
+
+			delete elfLoader;
+			elfLoader = nullptr;
 		}
 
-		if (have_ts != 0 || 1) {
-			int bits_ts = 0;
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			freeLists(codeSectionLst, symLst);
 
-			for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-				if (cores & (1 << i)) {
-					bits_ts += core[i].trace_bits_ts;
+			ObjDump* objdump = new ObjDump(elfname, odExe, archSize, codeSectionLst, symLst, stringPool);
+			if (objdump->getStatus() != TraceDqrProfiler::DQERR_OK) {
+				delete objdump;
+				objdump = nullptr;
+
+				if (cache != nullptr) {
+					delete cache;
+					cache = nullptr;
 				}
+
+				status = TraceDqrProfiler::DQERR_ERR;
+				return;
 			}
-			n = snprintf(dst, dst_len, "Timestamp bits %% of message:    %5.2f%%\n", ((float)bits_ts) / num_trace_bits_all_cores * 100.0);
-			updateDst(n, dst, dst_len);
+
+			delete objdump;
+			objdump = nullptr;
 		}
-	}
-	else if (detailLevel > 1) {
-		int position;
-		int tabs[] = { 19 + 21 * 0,19 + 21 * 1,19 + 21 * 2,19 + 21 * 3,19 + 21 * 4,19 + 21 * 5,19 + 21 * 6,19 + 21 * 7,19 + 21 * 8 };
-		uint32_t t1, t2;
-		int ts;
 
-		n = sprintf(tmp_dst, "\n");
-		n += sprintf(tmp_dst + n, "                 ");
+		// save before Symtab and fixupSourceFiles() change the lists. Not being able to save is not an error
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				n += sprintf(tmp_dst + n, "          Core %d", i);
-			}
+		if (cache != nullptr) {
+			cache->save(archSize, codeSectionLst, symLst);
 		}
+	}
 
-		if (srcBits > 0) {
-			n += sprintf(tmp_dst + n, "               Total");
-		}
+	if (cache != nullptr) {
+		delete cache;
+		cache = nullptr;
+	}
 
-		n += sprintf(tmp_dst + n, "\n");
+	switch (archSize) {
+	case 32:
+		bitsPerAddress = 32;
+		break;
+	case 64:
+		bitsPerAddress = 64;
+		break;
+	}
 
-		n = snprintf(dst, dst_len, "%s", tmp_dst);
-		updateDst(n, dst, dst_len);
+	symtab = new Symtab(symLst);
 
-		position = sprintf(tmp_dst, "Instructions");
+	rc = fixupSourceFiles(codeSectionLst, symLst);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
+	}
 
-		t1 = 0;
-		ts = 0;
+	for (Section* sp = codeSectionLst; sp != nullptr; sp = sp->next) {
+		rc = sp->buildIndexes();
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			status = TraceDqrProfiler::DQERR_ERR;
+			return;
+		}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_inst);
-				t1 += core[i].num_inst;
-				ts += 1;
+		if (sp->flags & Section::sect_CODE) {
+			rc = sp->predecode(archSize);
+			if (rc != TraceDqrProfiler::DQERR_OK) {
+				status = TraceDqrProfiler::DQERR_ERR;
+				return;
 			}
 		}
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+	rc = sectionIndex.build(codeSectionLst);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	status = TraceDqrProfiler::DQERR_OK;
+}
 
-		position = sprintf(tmp_dst, "  Compressed");
+ElfReader::~ElfReader()
+{
+	if (elfName != nullptr) {
+		delete[] elfName;
+		elfName = nullptr;
+	}
 
-		t2 = 0;
-		ts = 0;
+	if (symtab != nullptr) {
+		// elfReader is the only objet that really owns the Symtab, and is the only object that should
+		// delete it!
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_inst > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_inst16, ((float)core[i].num_inst16) / core[i].num_inst * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_inst16;
-				ts += 1;
-			}
-		}
+		delete symtab;
+		symtab = nullptr;
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+	while (codeSectionLst != nullptr) {
+		Section* nextSection = codeSectionLst->next;
+		delete codeSectionLst;
+		codeSectionLst = nextSection;
+	}
+}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+void ElfReader::freeLists(Section*& sections, Sym*& syms)
+{
+	while (sections != nullptr) {
+		Section* nextSection = sections->next;
+		delete sections;
+		sections = nextSection;
+	}
 
-		position = sprintf(tmp_dst, "  RV32");
+	// symbol names belong to stringPool
 
-		t2 = 0;
-		ts = 0;
+	while (syms != nullptr) {
+		Sym* nextSym = syms->next;
+		delete syms;
+		syms = nextSym;
+	}
+}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_inst > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_inst32, ((float)core[i].num_inst32) / core[i].num_inst * 100.0);
+TraceDqrProfiler::DQErr ElfReader::fixupSourceFiles(Section* sections, Sym* syms)
+{
+	// iterate through the symbols looking for non-null srcFile field and use it where there is no line information
+
+	for (Sym* sym = syms; sym != nullptr; sym = sym->next) {
+		if (sym->srcFile != nullptr) {
+			Section* sp = sym->section;
+			if ((sp != nullptr) && (sp->flags & Section::sect_CODE) && (sp->code != nullptr)) {
+				uint32_t index;
+				uint32_t count;
+				TraceDqrProfiler::ADDRESS addr;
+
+				addr = sym->address;
+				index = (addr - sp->startAddr) / 2;
+
+				count = (uint32_t)sym->size / 2;
+				if (count == 0) { // do at least one
+					count = 1;
 				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
+
+				if (index + count > (sp->size + 1) / 2) {
+					count = (index < (sp->size + 1) / 2) ? (sp->size + 1) / 2 - index : 0;
 				}
-				t2 += core[i].num_inst32;
-				ts += 1;
-			}
-		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
+				sp->fillSrcLines(index, index + count, sym->srcFile->name, 0);
 			}
 		}
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-		position = sprintf(tmp_dst, "TraceProfiler Msgs");
+TraceDqrProfiler::DQErr ElfReader::getInstructionByAddress(TraceDqrProfiler::ADDRESS addr, TraceDqrProfiler::RV_INST& inst)
+{
+	int plainRun;
+	const DecodedInst* decoded;
 
-		t1 = 0;
-		ts = 0;
+	return getInstructionByAddress(addr, inst, plainRun, decoded);
+}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_trace_msgs);
-				t1 += core[i].num_trace_msgs;
-				ts += 1;
-			}
-		}
+TraceDqrProfiler::DQErr ElfReader::getInstructionByAddress(TraceDqrProfiler::ADDRESS addr, TraceDqrProfiler::RV_INST& inst, int& plainRun, const DecodedInst*& decoded)
+{
+	TraceDqrProfiler::DQErr rc;
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += printf(" "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+	plainRun = 0;
+	decoded = nullptr;
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	// get instruction at addr
 
-		position = sprintf(tmp_dst, "  Sync");
+	// Address for code[0] is text->vma
 
-		t2 = 0;
-		ts = 0;
+	//don't forget base!!'
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_syncs, ((float)core[i].num_trace_syncs) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_syncs;
-				ts += 1;
-			}
-		}
+	// hmmm.. probably should cache section pointer, and not address/instruction! Or maybe not cache anything?
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+	Section* sp;
+	if (codeSectionLst == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	sp = sectionIndex.getSectionByAddress(addr);
+	if (sp == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		position = sprintf(tmp_dst, "  DBranch");
+	if ((addr < sp->startAddr) || (addr > sp->endAddr)) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		t2 = 0;
-		ts = 0;
+	if (sp->code == NULL)
+	{
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_dbranch, ((float)core[i].num_trace_dbranch) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_dbranch;
-				ts += 1;
-			}
-		}
+	//	if ((addr < text->vma) || (addr >= text->vma + text->size)) {
+	////			don't know instruction - not part of text segment. need to handle for os
+	////			if we can't get the instruciton, get the next trace message and try again. or do
+	////			we need the next sync message and the next trace message and try again?
+	//
+	//		// for now, just return an error
+	//
+	//		status = dqr::DQERR_ERR;
+	//		return status;
+	//	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+	int index;
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	index = (addr - sp->startAddr) / 2;
 
-		position = sprintf(tmp_dst, "  IBranch");
+	inst = sp->code[index];
 
-		ts = 0;
-		t2 = 0;
+	if (sp->plainRun != nullptr) {
+		plainRun = sp->plainRun[index];
+	}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ibranch, ((float)core[i].num_trace_ibranch) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_ibranch;
-				ts += 1;
-			}
-		}
+	if ((sp->decoded != nullptr) && sp->decoded[index].valid) {
+		decoded = &sp->decoded[index];
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
+	// if 32 bit instruction, get the second half
+
+	switch (inst & 0x0003) {
+	case 0x0000:	// quadrant 0, compressed
+	case 0x0001:	// quadrant 1, compressed
+	case 0x0002:	// quadrant 2, compressed
+		rc = TraceDqrProfiler::DQERR_OK;
+		break;
+	case 0x0003:	// not compressed. Assume RV32 for now
+		if ((inst & 0x1f) == 0x1f) {
+			fprintf(stderr, "Error: getInstructionByAddress(): cann't decode instructions longer than 32 bits\n");
+			rc = TraceDqrProfiler::DQERR_ERR;
+			break;
 		}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		inst = inst | (((uint32_t)sp->code[index + 1]) << 16);
 
-		position = sprintf(tmp_dst, "  DBranch WS");
+		rc = TraceDqrProfiler::DQERR_OK;
+		break;
+	}
 
-		ts = 0;
-		t2 = 0;
+	return rc;
+}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_dbranchws, ((float)core[i].num_trace_dbranchws) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_dbranchws;
-				ts += 1;
-			}
-		}
+TraceDqrProfiler::DQErr ElfReader::parseNLSStrings(TraceDqrProfiler::nlStrings* nlsStrings)
+{
+	Section* sp;
+	bool found = false;
+	int rc;
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
+	for (sp = codeSectionLst; (sp != NULL) && !found;) {
+		if (strcmp(sp->name,".comment") == 0) {
+			found = true;
 		}
+		else {
+			sp = sp->next;
+		}
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
-
-		position = sprintf(tmp_dst, "  IBranch WS");
+	if (!found) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		ts = 0;
-		t2 = 0;
+	int size = sp->size;
+	char* data;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ibranchws, ((float)core[i].num_trace_ibranchws) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_ibranchws;
-				ts += 1;
-			}
-		}
+	data = new (std::nothrow) char[size];
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+	if (data == nullptr) {
+		printf("Error: elfReader::parseNLSStrings(): Could not allocate data array\n");
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		position = sprintf(tmp_dst, "  Data Acq");
+	int fd;
+	fd = _open(elfName, O_RDONLY);
+	if (fd < 0) {
+		printf("Error: elfReader::parseNLSStrings(): Could not open file %s for input\n", elfName);
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		ts = 0;
-		t2 = 0;
+	rc = lseek(fd, sp->offset, SEEK_SET);
+	if (rc < 0) {
+		printf("Error: ElfReder::parseNLSStrings(): Error seeking to .comment section");
+		_close(fd);
+		fd = -1;
+		delete[] data;
+		data = nullptr;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_dataacq, ((float)core[i].num_trace_dataacq) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_dataacq;
-				ts += 1;
-			}
-		}
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+	rc = _read(fd, data, size);
+	if (rc != size) {
+		printf("Error: ElfReader::parseNLSStrings(): Error reading .comment section\n");
+		_close(fd);
+		fd = -1;
+		delete[] data;
+		data = nullptr;
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		position = sprintf(tmp_dst, "  Correlation");
+	_close(fd);
+	fd = -1;
 
-		ts = 0;
-		t2 = 0;
+	int index;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_correlation, ((float)core[i].num_trace_correlation) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_correlation;
-				ts += 1;
-			}
-		}
+	for (int i = 0; i < 32; i++) {
+		nlsStrings[i].nf = 0;
+		nlsStrings[i].signedMask = 0;
+		nlsStrings[i].format = nullptr;
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+	for (int i = 0; i < size;) {
+		char* end;
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		index = strtol(&data[i], &end, 0);
 
-		position = sprintf(tmp_dst, "  Aux Acc Write");
+		if (end != &data[i]) {
+			// found an index
 
-		ts = 0;
-		t2 = 0;
+			i = end - data;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_auxaccesswrite, ((float)core[i].num_trace_auxaccesswrite) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
+			if ((index >= 32) || (index < 0) || (data[i] != ':')) {
+				// invalid format string - skip
+				while ((i < size) && (data[i] != 0)) {
+					i += 1;
 				}
-				t2 += core[i].num_trace_auxaccesswrite;
-				ts += 1;
-			}
-		}
-
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+				i += 1;
 			}
 			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
-
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+				// found a format string
 
-		position = sprintf(tmp_dst, "  Ownership");
+				// need to find end of string
+				int e;
+				int nf = 0;
+				int state = 0;
 
-		ts = 0;
-		t2 = 0;
+				for (e = i + 1; (data[e] != 0) && (e < size); e++) {
+					// need to figure out if %s are signed or unsigned
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ownership, ((float)core[i].num_trace_ownership) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
+					switch (state) {
+					case 0:
+						if (data[e] == '%') {
+							state = 1;
+						}
+						break;
+					case 1: // found a %, figure out format
+						switch (data[e]) {
+						case '%':
+							state = 0;
+							break;
+							// signed cases
+						case 'd':
+						case 'i':
+							nlsStrings[index].signedMask |= (1 << nf);
+							nf += 1;
+							state = 0;
+							break;
+							// unsigned cases
+						case 'o':
+						case 'u':
+						case 'x':
+						case 'X':
+						case 'e':
+						case 'E':
+						case 'f':
+						case 'F':
+						case 'g':
+						case 'G':
+						case 'a':
+						case 'A':
+						case 'c':
+						case 's':
+						case 'p':
+						case 'n':
+						case 'M':
+							state = 0;
+							nf += 1;
+							break;
+						default:
+							break;
+						}
+					}
 				}
-				t2 += core[i].num_trace_ownership;
-				ts += 1;
-			}
-		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
-
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+				if (data[e] != 0) {
+					// invalid format string - not null terminated
 
-		position = sprintf(tmp_dst, "  Error");
+					//should we delete here?
 
-		ts = 0;
-		t2 = 0;
+					for (int i = 0; i < 32; i++) {
+						if (nlsStrings[i].format != nullptr) {
+							delete[] nlsStrings[i].format;
+							nlsStrings[i].format = nullptr;
+						}
+					}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_error, ((float)core[i].num_trace_error) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_error;
-				ts += 1;
-			}
-		}
+					// don't delete nlsStrings here! We didn't allocate it!
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+					delete[] data;
+					data = nullptr;
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+					return TraceDqrProfiler::DQERR_ERR;
+				}
 
-		position = sprintf(tmp_dst, "  IHistory");
+				nlsStrings[index].nf = nf;
+				nlsStrings[index].format = new char[e - i + 1];
 
-		ts = 0;
-		t2 = 0;
+				strcpy(nlsStrings[index].format, &data[i + 1]);
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ihistory, ((float)core[i].num_trace_ihistory) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_ihistory;
-				ts += 1;
+				i = e + 1;
 			}
 		}
-
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
+		else {
+			// skip string, look for another
+			while ((i < size) && (data[i] != 0)) {
+				i += 1;
 			}
+			i += 1;
 		}
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	//	for (int i = 0; i < 32; i++) {
+	//		printf("nlsStrings[%d]: %d  %02x %s\n",i,nlsStrings[i].nf,nlsStrings[i].signedMask,nlsStrings[i].format);
+	//	}
 
-		position = sprintf(tmp_dst, "  IHistory WS");
+	delete[] data;
+	data = nullptr;
 
-		ts = 0;
-		t2 = 0;
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ihistoryws, ((float)core[i].num_trace_ihistoryws) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_ihistoryws;
-				ts += 1;
-			}
-		}
+Symtab* ElfReader::getSymtab()
+{
+	return symtab;
+}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+// sp, or the first section after it, that holds code. The section list also has sections such as .comment (at
+// address 0) that are not loaded. Walk the code with
+// for (sp = getCodeSections(); sp != nullptr; sp = nextCodeSection(sp->next))
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+Section* ElfReader::nextCodeSection(Section* sp)
+{
+	while ((sp != nullptr) && (((sp->flags & Section::sect_CODE) == 0) || (sp->size == 0))) {
+		sp = sp->next;
+	}
 
-		position = sprintf(tmp_dst, "  RFull ICNT");
+	return sp;
+}
 
-		ts = 0;
-		t2 = 0;
+TraceDqrProfiler::DQErr ElfReader::dumpSyms()
+{
+	if (symtab == nullptr) {
+		symtab = getSymtab();
+	}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_resourcefull_i_cnt, ((float)core[i].num_trace_resourcefull_i_cnt) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_resourcefull_i_cnt;
-				ts += 1;
-			}
-		}
+	symtab->dump();
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+TsList::TsList()
+{
+	prev = nullptr;
+	next = nullptr;
+	message = nullptr;
+	terminated = false;
 
-		position = sprintf(tmp_dst, "  RFull HIST");
+	startTime = (TraceDqrProfiler::TIMESTAMP)0;
+	endTime = (TraceDqrProfiler::TIMESTAMP)0;
+}
 
-		ts = 0;
-		t2 = 0;
+TsList::~TsList()
+{
+}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_resourcefull_hist, ((float)core[i].num_trace_resourcefull_hist) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_resourcefull_hist;
-				ts += 1;
-			}
-		}
+ITCPrint::ITCPrint(int itcPrintOpts, int numCores, int buffSize, int channel, TraceDqrProfiler::nlStrings* nlsStrings)
+{
+	if ((numCores <= 0) || (buffSize <= 0)) {
+		printf("Error: ITCPrint::ITCPrint(): Bad numCores or bufSize argument\n");
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+		// just make some defaults and fly from there
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		numCores = 1;
+		buffSize = 1024;
+	}
 
-		position = sprintf(tmp_dst, "  RFull Taken");
+	this->numCores = numCores;
+	this->buffSize = buffSize;
+	this->printChannel = channel;
+	this->nlsStrings = nlsStrings;
 
-		ts = 0;
-		t2 = 0;
+	itcOptFlags = itcPrintOpts;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_resourcefull_takenCount, ((float)core[i].num_trace_resourcefull_takenCount) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_resourcefull_takenCount;
-				ts += 1;
-			}
-		}
+	pbuff = new char* [numCores];
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+	for (int i = 0; i < numCores; i++) {
+		pbuff[i] = new char[buffSize];
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	numMsgs = new int[numCores];
 
-		position = sprintf(tmp_dst, "  RFull NTaken");
+	for (int i = 0; i < numCores; i++) {
+		numMsgs[i] = 0;
+	}
 
-		ts = 0;
-		t2 = 0;
+	pbi = new int[numCores];
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_resourcefull_notTakenCount, ((float)core[i].num_trace_resourcefull_notTakenCount) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_resourcefull_notTakenCount;
-				ts += 1;
-			}
-		}
+	for (int i = 0; i < numCores; i++) {
+		pbi[i] = 0;
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+	pbo = new int[numCores];
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	for (int i = 0; i < numCores; i++) {
+		pbo[i] = 0;
+	}
 
-		position = sprintf(tmp_dst, "  ICT WS");
+	freeList = nullptr;
 
-		ts = 0;
-		t2 = 0;
+	tsList = new TsList * [numCores];
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_incircuittraceWS, ((float)core[i].num_trace_incircuittraceWS) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_ihistoryws;
-				ts += 1;
-			}
-		}
+	for (int i = 0; i < numCores; i++) {
+		tsList[i] = nullptr;
+	}
+}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
+ITCPrint::~ITCPrint()
+{
+	nlsStrings = nullptr; // don't delete this here - it is part of the trace object
+
+	if (pbuff != nullptr) {
+		for (int i = 0; i < numCores; i++) {
+			if (pbuff[i] != nullptr) {
+				delete[] pbuff[i];
+				pbuff[i] = nullptr;
 			}
 		}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		delete[] pbuff;
+		pbuff = nullptr;
+	}
 
-		position = sprintf(tmp_dst, "  ICT");
+	if (numMsgs != nullptr) {
+		delete[] numMsgs;
+		numMsgs = nullptr;
+	}
 
-		ts = 0;
-		t2 = 0;
+	if (pbi != nullptr) {
+		delete[] pbi;
+		pbi = nullptr;
+	}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_incircuittrace, ((float)core[i].num_trace_incircuittrace) / core[i].num_trace_msgs * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t2 += core[i].num_trace_ihistoryws;
-				ts += 1;
-			}
+	if (pbo != nullptr) {
+		delete[] pbo;
+		pbo = nullptr;
+	}
+
+	if (freeList != nullptr) {
+		TsList* tl = freeList;
+		while (tl != nullptr) {
+			TsList* tln = tl->next;
+			delete tl;
+			tl = tln;
 		}
+		freeList = nullptr;
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
+	if (tsList != nullptr) {
+		for (int i = 0; i < numCores; i++) {
+			TsList* tl = tsList[i];
+			if (tl != nullptr) {
+				do {
+					TsList* tln = tl->next;
+					delete tl;
+					tl = tln;
+				} while ((tl != tsList[i]) && (tl != nullptr));
 			}
 		}
+		delete[] tsList;
+		tsList = nullptr;
+	}
+}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+int ITCPrint::roomInITCPrintQ(uint8_t core)
+{
+	if (core >= numCores) {
+		return 0;
+	}
 
-		position = sprintf(tmp_dst, "TraceProfiler Bits Total");
+	if (pbi[core] > pbo[core]) {
+		return buffSize - pbi[core] + pbo[core] - 1;
+	}
 
-		ts = 0;
-		t1 = 0;
+	if (pbi[core] < pbo[core]) {
+		return pbo[core] - pbi[core] - 1;
+	}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits);
-				t1 += core[i].trace_bits;
-				ts += 1;
-			}
-		}
+	return buffSize - 1;
+}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+bool ITCPrint::print(uint8_t core, uint32_t addr, uint32_t data, TraceDqrProfiler::TIMESTAMP tstamp)
+{
+	if (core >= numCores) {
+		return false;
+	}
 
-		//		printf("\n");
-		//		position = printf("TraceProfiler Bits MSEO");
-		//
-		//		ts = 0;
-		//		t1 = 0;
-		//
-		//		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-		//			if (cores & (1<<i)) {
-		//				while (position < tabs[ts]) { position += printf(" "); }
-		//				position += printf("%10u",core[i].trace_bits_mseo);
-		//				t1 += core[i].trace_bits_mseo;
-		//				ts += 1;
-		//			}
-		//		}
-		//
-		//		if (srcBits > 0) {
-		//			while (position < tabs[ts]) { position += printf(" "); }
-		//			printf("%10u",t1);
-		//		}
+	//	here we want to process nls!!!
+	//	check is addr has an itc print format string (in nlsStrings)
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	TsList* tlp;
+	tlp = tsList[core];
+	TsList* workingtlp;
+	int channel;
 
-		position = sprintf(tmp_dst, "TraceProfiler Bits/Inst");
+	channel = addr / 4;
 
-		ts = 0;
-		t1 = 0;
-		t2 = 0;
+	if (itcOptFlags & TraceDqrProfiler::ITC_OPT_NLS) {
+		if (((addr & 0x03) == 0) && (nlsStrings != nullptr) && (nlsStrings[channel].format != nullptr)) {
+			int args[4];
+			char dst[256];
+			int dstLen = 0;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_inst > 0) {
-					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits) / core[i].num_inst);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t1 += core[i].trace_bits;
-				t2 += core[i].num_inst;
-				ts += 1;
-			}
-		}
+			// have a no-load-string print
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t2 > 0) {
-				position += sprintf(tmp_dst + position, "%13.2f", ((float)t1) / t2);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+			// need to get args for print
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+			switch (nlsStrings[channel].nf) {
+			case 0:
+				dstLen = sprintf(dst, nlsStrings[channel].format);
+				break;
+			case 1:
+				dstLen = sprintf(dst, nlsStrings[channel].format, data);
+				break;
+			case 2:
+				for (int i = 0; i < 2; i++) {
+					if (nlsStrings[channel].signedMask & (1 << i)) {
+						// signed
+						args[i] = (int16_t)(data >> ((1 - i) * 16));
+					}
+					else {
+						// unsigned
+						args[i] = (uint16_t)(data >> ((1 - i) * 16));
+					}
+				}
+				dstLen = sprintf(dst, nlsStrings[channel].format, args[0], args[1]);
+				break;
+			case 3:
+				args[0] = (data >> (32 - 11)) & 0x7ff; // 10 bit
+				args[1] = (data >> (32 - 22)) & 0x7ff; // 11 bit
+				args[2] = (data >> (32 - 32)) & 0x3ff; // 11 bit
 
-		position = sprintf(tmp_dst, "Inst/TraceProfiler Msg");
+				if (nlsStrings[channel].signedMask & (1 << 0)) {
+					if (args[0] & 0x400) {
+						args[0] |= 0xfffff800;
+					}
+				}
 
-		ts = 0;
-		t1 = 0;
-
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].num_inst) / core[i].num_trace_msgs);
+				if (nlsStrings[channel].signedMask & (1 << 1)) {
+					if (args[1] & 0x400) {
+						args[1] |= 0xfffff800;
+					}
 				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
+
+				if (nlsStrings[channel].signedMask & (1 << 2)) {
+					if (args[2] & 0x200) {
+						args[2] |= 0xfffffc00;
+					}
 				}
-				t1 += core[i].num_trace_msgs;
-				ts += 1;
-			}
-		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
+				dstLen = sprintf(dst, nlsStrings[channel].format, args[0], args[1], args[2]);
+				break;
+			case 4:
+				for (int i = 0; i < 4; i++) {
+					if (nlsStrings[channel].signedMask & (1 << i)) {
+						// signed
+						args[i] = (int8_t)(data >> ((3 - i) * 8));
+					}
+					else {
+						// unsigned
+						args[i] = (uint8_t)(data >> ((3 - i) * 8));
+					}
+				}
+				dstLen = sprintf(dst, nlsStrings[channel].format, args[0], args[1], args[2], args[3]);
+				break;
+			default:
+				dstLen = sprintf(dst, "Error: invalid number of args for format string %d, %s", channel, nlsStrings[channel].format);
+				break;
 			}
-		}
-
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
 
-		position = sprintf(tmp_dst, "Inst/Taken Branch");
+			if ((tsList[core] != nullptr) && (tsList[core]->terminated == false)) {
+				// terminate the current message
 
-		ts = 0;
-		t1 = 0;
+				pbuff[core][pbi[core]] = 0;	// add a null termination after the eol
+				pbi[core] += 1;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if ((core[i].num_trace_dbranch + core[i].num_trace_ibranch + core[i].num_trace_dbranchws + core[i].num_trace_ibranchws + core[i].num_trace_ihistory_taken_branches + core[i].num_trace_resourcefull_taken_branches) > 0) {
-					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].num_inst) / (core[i].num_trace_dbranch + core[i].num_trace_ibranch + core[i].num_trace_dbranchws + core[i].num_trace_ibranchws + core[i].num_trace_ihistory_taken_branches + core[i].num_trace_resourcefull_taken_branches));
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
+				if (pbi[core] >= buffSize) {
+					pbi[core] = 0;
 				}
-				t1 += core[i].num_trace_dbranch + core[i].num_trace_ibranch + core[i].num_trace_dbranchws + core[i].num_trace_ibranchws;
-				ts += 1;
-			}
-		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
-		}
+				numMsgs[core] += 1;
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+				tsList[core]->terminated = true;
+			}
 
-		position = sprintf(tmp_dst, "Avg Msg Length");
+			// check free list for available struct
 
-		ts = 0;
-		t1 = 0;
-		t2 = 0;
+			if (freeList != nullptr) {
+				workingtlp = freeList;
+				freeList = workingtlp->next;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_msgs > 0) {
-					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits) / core[i].num_trace_msgs);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t1 += core[i].trace_bits;
-				t2 += core[i].num_trace_msgs;
-				ts += 1;
+				workingtlp->terminated = false;
+				workingtlp->message = nullptr;
+			}
+			else {
+				workingtlp = new TsList();
 			}
-		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t2 > 0) {
-				position += sprintf(tmp_dst + position, "%13.2f", ((float)t1) / t2);
+			if (tlp == nullptr) {
+				workingtlp->next = workingtlp;
+				workingtlp->prev = workingtlp;
 			}
 			else {
-				position += sprintf(tmp_dst + position, "          -");
+				workingtlp->next = tlp;
+				workingtlp->prev = tlp->prev;
+
+				tlp->prev = workingtlp;
+				workingtlp->prev->next = workingtlp;
 			}
-		}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+			workingtlp->startTime = tstamp;
+			workingtlp->endTime = tstamp;
+			workingtlp->message = &pbuff[core][pbi[core]];
 
-		position = sprintf(tmp_dst, "Min Msg Length");
+			tsList[core] = workingtlp;
 
-		ts = 0;
-		t1 = 0;
+			// workingtlp now points to unterminated TSList object
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_min);
-				if ((t1 == 0) || (core[i].trace_bits_min < t1)) {
-					t1 = core[i].trace_bits_min;
+			int room = roomInITCPrintQ(core);
+
+			for (int i = 0; i < dstLen; i++) {
+				if (room >= 2) { // 2 because we need to make sure there is room for the nul termination
+					pbuff[core][pbi[core]] = dst[i];
+					pbi[core] += 1;
+					if (pbi[core] >= buffSize) {
+						pbi[core] = 0;
+					}
+					room -= 1;
 				}
-				ts += 1;
 			}
-		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+			pbuff[core][pbi[core]] = 0;
+			pbi[core] += 1;
+			if (pbi[core] >= buffSize) {
+				pbi[core] = 0;
+			}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+			workingtlp->terminated = true;
+			numMsgs[core] += 1;
 
-		position = sprintf(tmp_dst, "Max Msg Length");
+			return true;
+		}
+	}
 
-		ts = 0;
-		t1 = 0;
+	if (itcOptFlags & TraceDqrProfiler::ITC_OPT_PRINT) {
+		if ((addr < (uint32_t)printChannel * 4) || (addr >= (((uint32_t)printChannel + 1) * 4))) {
+			// not writing to this itc channel
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_max);
-				if (core[i].trace_bits_max > t1) {
-					t1 = core[i].trace_bits_max;
-				}
-				ts += 1;
-			}
+			return false;
 		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+		if ((tlp == nullptr) || tlp->terminated == true) {
+			// see if there is one on the free list before making a new one
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+			if (freeList != nullptr) {
+				workingtlp = freeList;
+				freeList = workingtlp->next;
 
-		position = sprintf(tmp_dst, "Timestamp Counts");
+				workingtlp->terminated = false;
+				workingtlp->message = nullptr;
+			}
+			else {
+				workingtlp = new TsList();
+			}
 
-		ts = 0;
-		t1 = 0;
+			if (tlp == nullptr) {
+				workingtlp->next = workingtlp;
+				workingtlp->prev = workingtlp;
+			}
+			else {
+				workingtlp->next = tlp;
+				workingtlp->prev = tlp->prev;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_trace_ts);
-				t1 += core[i].num_trace_ts;
-				ts += 1;
+				tlp->prev = workingtlp;
+				workingtlp->prev->next = workingtlp;
 			}
-		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
+			workingtlp->terminated = false;
+			workingtlp->startTime = tstamp;
+			workingtlp->message = &pbuff[core][pbi[core]];
+
+			tsList[core] = workingtlp;
+		}
+		else {
+			workingtlp = tlp;
 		}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		// workingtlp now points to unterminated TSList object (in progress)
 
-		position = sprintf(tmp_dst, "  TStamp Size Avg");
+		workingtlp->endTime = tstamp;
 
-		ts = 0;
-		t2 = 0;
+		char* p = (char*)&data;
+		int room = roomInITCPrintQ(core);
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_ts > 0) {
-					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits_ts) / core[i].num_trace_ts);
-					t2 += core[i].trace_bits_ts;
-				}
-				else {
-					position += sprintf(tmp_dst + position, "         0");
+		for (int i = 0; ((size_t)i < ((sizeof data) - (addr & 0x03))); i++) {
+			if (room >= 2) {
+				pbuff[core][pbi[core]] = p[i];
+				pbi[core] += 1;
+				if (pbi[core] >= buffSize) {
+					pbi[core] = 0;
 				}
-				ts += 1;
-			}
-		}
-
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "         0");
-			}
-		}
-
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+				room -= 1;
 
-		position = sprintf(tmp_dst, "  TStamp Size Min");
+				switch (p[i]) {
+				case 0:
+					numMsgs[core] += 1;
 
-		ts = 0;
-		t1 = 0;
+					workingtlp->terminated = true;
+					break;
+				case '\n':
+				case '\r':
+					pbuff[core][pbi[core]] = 0;	// add a null termination after the eol
+					pbi[core] += 1;
+					if (pbi[core] >= buffSize) {
+						pbi[core] = 0;
+					}
+					room -= 1;
+					numMsgs[core] += 1;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_ts_min);
-				if ((t1 == 0) || (t1 > core[i].trace_bits_ts_min)) {
-					t1 = core[i].trace_bits_ts_min;
+					workingtlp->terminated = true;
+					break;
+				default:
+					break;
 				}
-				ts += 1;
 			}
 		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+		pbuff[core][pbi[core]] = 0; // make sure always null terminated. This may be a temporary null termination
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		// returning true means it was an itc print msg and has been processed
+		// false means it was not, and should be handled normally
 
-		position = sprintf(tmp_dst, "  TStamp Size Max");
+		return true;
+	}
 
-		ts = 0;
-		t1 = 0;
+	return false;
+}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_ts_max);
-				if (core[i].trace_bits_ts_max > t1) {
-					t1 = core[i].trace_bits_ts_max;
-				}
-				ts += 1;
-			}
+bool ITCPrint::haveITCPrintMsgs()
+{
+	for (int core = 0; core < numCores; core++) {
+		if (numMsgs[core] != 0) {
+			return true;
 		}
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+	return false;
+}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+int ITCPrint::getITCPrintMask()
+{
+	int mask = 0;
 
-		position = sprintf(tmp_dst, "Timestamp %% of Msg");
+	for (int core = 0; core < numCores; core++) {
+		if (numMsgs[core] != 0) {
+			mask |= 1 << core;
+		}
+	}
 
-		ts = 0;
-		t1 = 0;
+	return mask;
+}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].trace_bits > 0) {
-					position += sprintf(tmp_dst + position, "%13.2f%%", ((float)core[i].trace_bits_ts) / core[i].trace_bits * 100.0);
-				}
-				else {
-					position += sprintf(tmp_dst + position, "          -");
-				}
-				t1 += core[i].trace_bits;
-				ts += 1;
-			}
+int ITCPrint::getITCFlushMask()
+{
+	int mask = 0;
+
+	for (int core = 0; core < numCores; core++) {
+		if (numMsgs[core] > 0) {
+			mask |= 1 << core;
 		}
+		else if (pbo[core] != pbi[core]) {
+			mask |= 1 << core;
+		}
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%13.2f%%", ((float)t2) / t1 * 100.0);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "          -");
-			}
+	return mask;
+}
+
+void ITCPrint::haveITCPrintData(int numMsgs[], bool havePrintData[])
+{
+	if (numMsgs != nullptr) {
+		for (int i = 0; i < numCores; i++) {
+			numMsgs[i] = this->numMsgs[i];
 		}
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	if (havePrintData != nullptr) {
+		for (int i = 0; i < numCores; i++) {
+			havePrintData[i] = pbi[i] != pbo[i];
+		}
+	}
+}
 
-		position = sprintf(tmp_dst, "UADDR Counts");
+TsList* ITCPrint::consumeTerminatedTsList(int core)
+{
+	TsList* rv = nullptr;
 
-		ts = 0;
-		t1 = 0;
+	if (numMsgs[core] > 0) { // have stuff in the Q
+		TsList* tsl = tsList[core];
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_trace_uaddr);
-				t1 += core[i].num_trace_uaddr;
-				ts += 1;
-			}
-		}
+		// tsl now points to the newest tslist object. We want the oldest, which will be tsl->prev
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+		if (tsl != nullptr) {
+			tsl = tsl->prev;
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+			if (tsl->terminated == true) {
+				rv = tsl;
 
-		position = sprintf(tmp_dst, "  UADDR Size Avg");
+				// unlink tsl (consume it)
 
-		ts = 0;
-		t2 = 0;
+				if (tsl->next == tsl) {
+					// was the only one in list
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_uaddr > 0) {
-					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits_uaddr) / core[i].num_trace_uaddr);
-					t2 += core[i].trace_bits_uaddr;
+					tsList[core] = nullptr;
 				}
 				else {
-					position += sprintf(tmp_dst + position, "        0");
+					tsList[core]->prev = tsl->prev;
+
+					if (tsList[core]->next == tsl) {
+						tsList[core]->next = tsl->next;
+					}
 				}
-				ts += 1;
-			}
-		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "        0");
+				tsl->next = freeList;
+				tsl->prev = nullptr;
+				freeList = tsl;
 			}
 		}
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	return rv;
+}
 
-		position = sprintf(tmp_dst, "  UADDR Size Min");
+TsList* ITCPrint::consumeOldestTsList(int core)
+{
+	TsList* rv;
 
-		ts = 0;
-		t1 = 0;
+	rv = consumeTerminatedTsList(core);
+	if (rv == nullptr) {
+		// no terminated itc prints. Look for one in progress
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_uaddr_min);
-				if ((t1 == 0) || (core[i].trace_bits_uaddr_min < t1)) {
-					t1 = core[i].trace_bits_uaddr_min;
-				}
-				ts += 1;
-			}
-		}
+		TsList* tsl = tsList[core];
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+		if (tsl != nullptr) {
+			// this must be an unterminated tsl. unlink tsl (consume it)
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+			rv = tsl;
 
-		position = sprintf(tmp_dst, "  UADDR Size Max");
+			if (tsl->next == tsl) {
+				// was the only one in the list!
 
-		ts = 0;
-		t1 = 0;
+				tsList[core] = nullptr;
+			}
+			else {
+				tsList[core]->prev = tsl->prev;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_uaddr_max);
-				if (t1 < core[i].trace_bits_uaddr_max) {
-					t1 = core[i].trace_bits_uaddr_max;
+				if (tsList[core]->next == tsl) {
+					tsList[core]->next = tsl->next;
 				}
-				ts += 1;
 			}
-		}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
+			tsl->next = freeList;
+			tsl->prev = nullptr;
+			freeList = tsl;
 		}
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	return rv;
+}
 
-		position = sprintf(tmp_dst, "FADDR Counts");
+bool ITCPrint::getITCPrintMsg(uint8_t core, char* dst, int dstLen, TraceDqrProfiler::TIMESTAMP& startTime, TraceDqrProfiler::TIMESTAMP& endTime)
+{
+	bool rc = false;
 
-		ts = 0;
-		t1 = 0;
+	if (core >= numCores) {
+		return false;
+	}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_trace_faddr);
-				t1 += core[i].num_trace_faddr;
-				ts += 1;
-			}
-		}
+	if ((dst == nullptr) || (dstLen <= 0)) {
+		printf("Error: ITCPrint::getITCPrintMsg(): Bad dst argument or size\n");
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t1);
-		}
+		return false;
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	if (numMsgs[core] > 0) {
+		TsList* tsl = consumeTerminatedTsList(core);
 
-		position = sprintf(tmp_dst, "  FADDR Size Avg");
+		if (tsl != nullptr) {
+			startTime = tsl->startTime;
+			endTime = tsl->endTime;
+		}
+		else if (tsl == nullptr) {
+			printf("Error: ITCPrint::getITCPrintMsg(): tsl is null\n");
+			return false;
+		}
 
-		ts = 0;
-		t2 = 0;
+		rc = true;
+		numMsgs[core] -= 1;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				if (core[i].num_trace_faddr > 0) {
-					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits_faddr) / core[i].num_trace_faddr);
-					t2 = core[i].trace_bits_faddr;
-				}
-				else {
-					position += sprintf(tmp_dst + position, "        0");
-				}
-				ts += 1;
-			}
-		}
+		while (pbuff[core][pbo[core]] && (dstLen > 1)) {
+			*dst++ = pbuff[core][pbo[core]];
+			dstLen -= 1;
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			if (t1 > 0) {
-				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
-			}
-			else {
-				position += sprintf(tmp_dst + position, "        0");
+			pbo[core] += 1;
+			if (pbo[core] >= buffSize) {
+				pbo[core] = 0;
 			}
 		}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
-
-		position = sprintf(tmp_dst, "  FADDR Size Min");
+		*dst = 0;
 
-		ts = 0;
-		t2 = 0;
+		// skip past null terminted end of message
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_faddr_min);
-				if ((t2 == 0) || (core[i].trace_bits_faddr_min < t2)) {
-					t2 = core[i].trace_bits_faddr_min;
-				}
-				ts += 1;
-			}
+		pbo[core] += 1;
+		if (pbo[core] >= buffSize) {
+			pbo[core] = 0;
 		}
+	}
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t2);
-		}
+	return rc;
+}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+bool ITCPrint::flushITCPrintMsg(uint8_t core, char* dst, int dstLen, TraceDqrProfiler::TIMESTAMP& startTime, TraceDqrProfiler::TIMESTAMP& endTime)
+{
+	if (core >= numCores) {
+		printf("Error: ITCPrint::flushITCPringMsg(): Core out of range (%d)\n", core);
+		return false;
+	}
 
-		position = sprintf(tmp_dst, "  FADDR Size Max");
+	if ((dst == nullptr) || (dstLen <= 0)) {
+		printf("Error: ITCPrint::flushITCPrintMsg(): Bad dst argument\n");
+		return false;
+	}
 
-		ts = 0;
-		t2 = 0;
+	if (numMsgs[core] > 0) {
+		return getITCPrintMsg(core, dst, dstLen, startTime, endTime);
+	}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_faddr_max);
-				if (core[i].trace_bits_faddr_max > t2) {
-					t2 = core[i].trace_bits_faddr_max;
-				}
-				ts += 1;
-			}
-		}
+	if (pbo[core] != pbi[core]) {
+		TsList* tsl = consumeOldestTsList(core);
 
-		if (srcBits > 0) {
-			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-			position += sprintf(tmp_dst + position, "%10u", t2);
+		if ((tsl == nullptr) || (tsl->terminated != false)) {
+			printf("Error: ITCPrint::flushITCPrintMsg(): bad tsl object\n");
+			return false;
 		}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
-
-		position = sprintf(tmp_dst, "Taken Branches");
+		startTime = tsl->startTime;
+		endTime = tsl->endTime;
 
-		ts = 0;
-		t2 = 0;
+		while (pbuff[core][pbo[core]] && (dstLen > 1)) {
+			*dst++ = pbuff[core][pbo[core]];
+			dstLen -= 1;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_taken_branches);
-				ts += 1;
+			pbo[core] += 1;
+			if (pbo[core] >= buffSize) {
+				pbo[core] = 0;
 			}
 		}
+		return true;
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
-
-		position = sprintf(tmp_dst, "Not Taken Branches");
-
-		ts = 0;
-		t2 = 0;
+	return false;
+}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_notTaken_branches);
-				ts += 1;
-			}
-		}
+bool ITCPrint::getITCPrintStr(uint8_t core, std::string& s, TraceDqrProfiler::TIMESTAMP& startTime, TraceDqrProfiler::TIMESTAMP& endTime)
+{
+	if (core >= numCores) {
+		return false;
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	bool rc = false;
 
-		position = sprintf(tmp_dst, "Calls");
+	if (numMsgs[core] > 0) { // stuff in the Q
+		rc = true;
 
-		ts = 0;
-		t2 = 0;
+		TsList* tsl = consumeTerminatedTsList(core);
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_calls);
-				ts += 1;
-			}
+		if (tsl == nullptr) {
+			printf("Error: ITCPrint::getITCPrintStr(): Bad tsl pointer\n");
+			return false;
 		}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		startTime = tsl->startTime;
+		endTime = tsl->endTime;
 
-		position = sprintf(tmp_dst, "Returns");
+		numMsgs[core] -= 1;
 
-		ts = 0;
-		t2 = 0;
+		while (pbuff[core][pbo[core]]) {
+			s += pbuff[core][pbo[core]];
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_returns);
-				ts += 1;
+			pbo[core] += 1;
+			if (pbo[core] >= buffSize) {
+				pbo[core] = 0;
 			}
 		}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
-
-		position = sprintf(tmp_dst, "Swaps");
-
-		ts = 0;
-		t2 = 0;
-
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_swaps);
-				ts += 1;
-			}
+		pbo[core] += 1;
+		if (pbo[core] >= buffSize) {
+			pbo[core] = 0;
 		}
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	return rc;
+}
 
-		position = sprintf(tmp_dst, "Exceptions");
+bool ITCPrint::flushITCPrintStr(uint8_t core, std::string& s, TraceDqrProfiler::TIMESTAMP& startTime, TraceDqrProfiler::TIMESTAMP& endTime)
+{
+	if (core >= numCores) {
+		return false;
+	}
 
-		ts = 0;
-		t2 = 0;
+	if (numMsgs[core] > 0) {
+		return getITCPrintStr(core, s, startTime, endTime);
+	}
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_exceptions);
-				ts += 1;
-			}
-		}
+	if (pbo[core] != pbi[core]) {
+		TsList* tsl = consumeOldestTsList(core);
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+		if ((tsl == nullptr) || (tsl->terminated != false)) {
+			printf("Error: ITCPrint::flushITCPrintStr(): Bad tsl pointer\n");
+			return false;
+		}
 
-		position = sprintf(tmp_dst, "Exception Returns");
+		startTime = tsl->startTime;
+		endTime = tsl->endTime;
 
-		ts = 0;
-		t2 = 0;
+		s = "";
+		while (pbuff[core][pbo[core]]) {
+			s += pbuff[core][pbo[core]];
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_exception_returns);
-				ts += 1;
+			pbo[core] += 1;
+			if (pbo[core] >= buffSize) {
+				pbo[core] = 0;
 			}
 		}
+		return true;
+	}
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	return false;
+}
 
-		position = sprintf(tmp_dst, "Interrupts");
+ProfilerAnalytics::ProfilerAnalytics()
+{
+	cores = 0;
+	num_trace_msgs_all_cores = 0;
+	num_trace_bits_all_cores = 0;
+	num_trace_bits_all_cores_max = 0;
+	num_trace_bits_all_cores_min = 0;
+	num_trace_mseo_bits_all_cores = 0;
 
-		ts = 0;
-		t2 = 0;
+	num_inst_all_cores = 0;
+	num_inst16_all_cores = 0;
+	num_inst32_all_cores = 0;
 
-		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
-			if (cores & (1 << i)) {
-				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
-				position += sprintf(tmp_dst + position, "%10u", core[i].num_interrupts);
-				ts += 1;
-			}
-		}
+	num_branches_all_cores = 0;
 
-		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
-		updateDst(n, dst, dst_len);
+	for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+		core[i].num_inst16 = 0;
+		core[i].num_inst32 = 0;
+		core[i].num_inst = 0;
+
+		core[i].num_trace_msgs = 0;
+		core[i].num_trace_syncs = 0;
+		core[i].num_trace_dbranch = 0;
+		core[i].num_trace_ibranch = 0;
+		core[i].num_trace_ihistory = 0;
+		core[i].num_trace_ihistoryws = 0;
+		core[i].num_trace_resourcefull = 0;
+		core[i].num_trace_incircuittraceWS = 0;
+		core[i].num_trace_incircuittrace = 0;
+
+		core[i].num_trace_dataacq = 0;
+		core[i].num_trace_dbranchws = 0;
+		core[i].num_trace_ibranchws = 0;
+		core[i].num_trace_correlation = 0;
+		core[i].num_trace_auxaccesswrite = 0;
+		core[i].num_trace_ownership = 0;
+		core[i].num_trace_error = 0;
+
+		core[i].num_trace_ts = 0;
+		core[i].num_trace_uaddr = 0;
+		core[i].num_trace_faddr = 0;
+		core[i].num_trace_ihistory_taken_branches = 0;
+		core[i].num_trace_ihistory_nottaken_branches = 0;
+		core[i].num_trace_resourcefull_i_cnt = 0;
+		core[i].num_trace_resourcefull_hist = 0;
+		core[i].num_trace_resourcefull_takenCount = 0;
+		core[i].num_trace_resourcefull_notTakenCount = 0;
+		core[i].num_trace_resourcefull_taken_branches = 0;
+		core[i].num_trace_resourcefull_nottaken_branches = 0;
+
+		core[i].trace_bits = 0;
+		core[i].trace_bits_max = 0;
+		core[i].trace_bits_min = 0;
+		core[i].trace_bits_mseo = 0;
+
+		core[i].max_hist_bits = 0;
+		core[i].min_hist_bits = 0;
+		core[i].max_notTakenCount = 0;
+		core[i].min_notTakenCount = 0;
+		core[i].max_takenCount = 0;
+		core[i].min_takenCount = 0;
+
+		core[i].trace_bits_sync = 0;
+		core[i].trace_bits_dbranch = 0;
+		core[i].trace_bits_ibranch = 0;
+		core[i].trace_bits_dataacq = 0;
+		core[i].trace_bits_dbranchws = 0;
+		core[i].trace_bits_ibranchws = 0;
+		core[i].trace_bits_ihistory = 0;
+		core[i].trace_bits_ihistoryws = 0;
+		core[i].trace_bits_resourcefull = 0;
+		core[i].trace_bits_correlation = 0;
+		core[i].trace_bits_auxaccesswrite = 0;
+		core[i].trace_bits_ownership = 0;
+		core[i].trace_bits_error = 0;
+		core[i].trace_bits_incircuittrace = 0;
+		core[i].trace_bits_incircuittraceWS = 0;
+
+		core[i].trace_bits_ts = 0;
+		core[i].trace_bits_ts_max = 0;
+		core[i].trace_bits_ts_min = 0;
+
+		core[i].trace_bits_uaddr = 0;
+		core[i].trace_bits_uaddr_max = 0;
+		core[i].trace_bits_uaddr_min = 0;
+
+		core[i].trace_bits_faddr = 0;
+		core[i].trace_bits_faddr_max = 0;
+		core[i].trace_bits_faddr_min = 0;
+
+		core[i].trace_bits_hist = 0;
+
+		core[i].num_taken_branches = 0;
+		core[i].num_notTaken_branches = 0;
+		core[i].num_calls = 0;
+		core[i].num_returns = 0;
+		core[i].num_swaps = 0;
+		core[i].num_exceptions = 0;
+		core[i].num_exception_returns = 0;
+		core[i].num_interrupts = 0;
 	}
 
 #ifdef DO_TIMES
-	n = snprintf(dst, dst_len, "\nTime %f seconds\n", etime);
-	updateDst(n, dst, dst_len);
-	n = snprintf(dst, dst_len, "Instructions decoded per second: %0.2f\n", num_inst_all_cores / etime);
-	updateDst(n, dst, dst_len);
-	n = snprintf(dst, dst_len, "TraceProfiler messages decoded per second: %0.2f\n", num_trace_msgs_all_cores / etime);
-	updateDst(n, dst, dst_len);
+	etimer = new Timer();
 #endif // DO_TIMES
+
+	status = TraceDqrProfiler::DQERR_OK;
 }
 
-std::string ProfilerAnalytics::toString(int detailLevel)
+ProfilerAnalytics::~ProfilerAnalytics()
 {
-	char dst[4096];
+#ifdef DO_TIMES
+	if (etimer != nullptr) {
+		delete etimer;
+		etimer = nullptr;
+	}
+#endif // DO_TIMES
+}
 
-	dst[0] = 0;
+TraceDqrProfiler::DQErr ProfilerAnalytics::updateTraceInfo(ProfilerNexusMessage& nm, uint32_t bits, uint32_t mseo_bits, uint32_t ts_bits, uint32_t addr_bits)
+{
+	bool have_uaddr = false;
+	bool have_faddr = false;
 
-	toText(dst, sizeof dst, detailLevel);
+	num_trace_msgs_all_cores += 1;
+	num_trace_bits_all_cores += bits;
+	num_trace_mseo_bits_all_cores += mseo_bits;
 
-	return std::string(dst);
-}
+	core[nm.coreId].num_trace_msgs += 1;
 
-uint32_t ProfilerNexusMessage::targetFrequency = 0;
+	if (bits > num_trace_bits_all_cores_max) {
+		num_trace_bits_all_cores_max = bits;
+	}
 
-ProfilerNexusMessage::ProfilerNexusMessage()
-{
-	msgNum = 0;
-	tcode = TraceDqrProfiler::TCODE_UNDEFINED;
-	coreId = 0;
-	haveTimestamp = false;
-	timestamp = 0;
-	currentAddress = 0;
-	time = 0;
-	offset = 0;
-	for (int i = 0; (size_t)i < sizeof rawData / sizeof rawData[0]; i++) {
-		rawData[i] = 0xff;
+	if ((num_trace_bits_all_cores_min == 0) || (bits < num_trace_bits_all_cores_min)) {
+		num_trace_bits_all_cores_min = bits;
 	}
-}
 
-int ProfilerNexusMessage::getI_Cnt()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-		return directBranch.i_cnt;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-		return indirectBranch.i_cnt;
-	case TraceDqrProfiler::TCODE_SYNC:
-		return sync.i_cnt;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-		return directBranchWS.i_cnt;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-		return indirectBranchWS.i_cnt;
-	case TraceDqrProfiler::TCODE_CORRELATION:
-		return correlation.i_cnt;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-		return indirectHistory.i_cnt;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-		return indirectHistoryWS.i_cnt;
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-		return repeatBranch.i_cnt;//return (repeatBranch.b_cnt * repeatBranch.i_cnt);
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-		if (resourceFull.rCode == 0) {
-			return resourceFull.i_cnt;
-		}
-		break;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
+	core[nm.coreId].trace_bits_mseo += mseo_bits;
+	core[nm.coreId].trace_bits += bits;
+
+	if (bits > core[nm.coreId].trace_bits_max) {
+		core[nm.coreId].trace_bits_max = bits;
 	}
 
-	return 0;
-}
+	if ((core[nm.coreId].trace_bits_min == 0) || (bits < core[nm.coreId].trace_bits_min)) {
+		core[nm.coreId].trace_bits_min = bits;
+	}
 
-TraceDqrProfiler::ADDRESS ProfilerNexusMessage::getU_Addr()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-		return indirectBranch.u_addr;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-		return indirectHistory.u_addr;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		switch (ict.cksrc) {
-		case TraceDqrProfiler::ICT_EXT_TRIG:
-			// ckdata0 is the address of the instruciton that retired before generating the exception
-			return ict.ckdata[0];
-		case TraceDqrProfiler::ICT_CONTROL:
-			if (ict.ckdf == 1) {
-				return ict.ckdata[0];
-			}
-			break;
-		case TraceDqrProfiler::ICT_INFERABLECALL:
-			if (ict.ckdf == 0) { // inferrable call
-				// ckdata[0] is the address of the call instruction. destination determined form program image
-				return ict.ckdata[0];
-			}
-			else if (ict.ckdf == 1) { // call/return
-				// ckdata[0] is the address of the call instruction. destination is computed from ckdata[1]
-				return ict.ckdata[0];
-			}
-			break;
-		case TraceDqrProfiler::ICT_EXCEPTION:
-			// ckdata0 the address of the next mainline instruction to execute (will execute after the return from except)
-			return ict.ckdata[0];
-		case TraceDqrProfiler::ICT_INTERRUPT:
-			// ckdata0 is the address of the next instruction to execute in mainline code (will execute after the return from interrupt)
-			return ict.ckdata[0];
-		case TraceDqrProfiler::ICT_CONTEXT:
-			// ckdata[0] is the address of the instruction prior to doing the context switch
-			return ict.ckdata[0];
-		case TraceDqrProfiler::ICT_WATCHPOINT:
-			// ckdata0 is the address of the last instruction to retire??
-			return ict.ckdata[0];
-		case TraceDqrProfiler::ICT_PC_SAMPLE:
-			// periodic pc sample. Address of last instruciton to retire??
-			return ict.ckdata[0];
-		case TraceDqrProfiler::ICT_NONE:
-		default:
-			break;
+	cores |= (1 << nm.coreId);
+
+	if (ts_bits > 0) {
+		core[nm.coreId].num_trace_ts += 1;
+		core[nm.coreId].trace_bits_ts += ts_bits;
+
+		if (ts_bits > core[nm.coreId].trace_bits_ts_max) {
+			core[nm.coreId].trace_bits_ts_max = ts_bits;
 		}
-		break;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
+
+		if ((core[nm.coreId].trace_bits_ts_min == 0) || (ts_bits < core[nm.coreId].trace_bits_ts_min)) {
+			core[nm.coreId].trace_bits_ts_min = ts_bits;
+		}
+	}
+
+	int msb;
+	uint64_t mask;
+	int taken;
+	int nottaken;
+
+	switch (nm.tcode) {
 	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+		core[nm.coreId].num_trace_ownership += 1;
+		core[nm.coreId].trace_bits_ownership += bits;
+		break;
 	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
+		core[nm.coreId].num_trace_dbranch += 1;
+		core[nm.coreId].trace_bits_dbranch += bits;
+		num_branches_all_cores += 1;
+		break;
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+		core[nm.coreId].num_trace_ibranch += 1;
+		core[nm.coreId].trace_bits_ibranch += bits;
+		num_branches_all_cores += 1;
+
+		have_uaddr = true;
+		break;
 	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+		core[nm.coreId].num_trace_dataacq += 1;
+		core[nm.coreId].trace_bits_dataacq += bits;
+		break;
 	case TraceDqrProfiler::TCODE_ERROR:
+		core[nm.coreId].num_trace_error += 1;
+		core[nm.coreId].trace_bits_error += bits;
+		break;
 	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
+		core[nm.coreId].num_trace_syncs += 1;
+		core[nm.coreId].trace_bits_sync += bits;
+
+		have_faddr = true;
+		break;
 	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+		core[nm.coreId].num_trace_dbranchws += 1;
+		core[nm.coreId].trace_bits_dbranchws += bits;
+		num_branches_all_cores += 1;
+
+		have_faddr = true;
+		break;
 	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		core[nm.coreId].num_trace_ibranchws += 1;
+		core[nm.coreId].trace_bits_ibranchws += bits;
+		num_branches_all_cores += 1;
+
+		have_faddr = true;
+		break;
 	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+		core[nm.coreId].num_trace_rbranch += 1;
+		core[nm.coreId].trace_bits_rbranch += bits;
+		num_branches_all_cores += nm.repeatBranch.b_cnt;
+		break;
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+		core[nm.coreId].num_trace_auxaccesswrite += 1;
+		core[nm.coreId].trace_bits_auxaccesswrite += bits;
+		break;
 	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-	default:
+		core[nm.coreId].num_trace_correlation += 1;
+		core[nm.coreId].trace_bits_ibranchws += bits;
 		break;
-	}
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+		core[nm.coreId].num_trace_ihistory += 1;
+		core[nm.coreId].trace_bits_ihistory += bits;
 
-	return -1;
-}
+		// need to find msb = 1
 
-TraceDqrProfiler::ADDRESS ProfilerNexusMessage::getF_Addr()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-		return directBranchWS.f_addr;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-		return indirectBranchWS.f_addr;
-	case TraceDqrProfiler::TCODE_SYNC:
-		return sync.f_addr;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-		return indirectHistoryWS.f_addr;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-		switch (ictWS.cksrc) {
-		case TraceDqrProfiler::ICT_EXT_TRIG:
-			// ckdata0 is the address of the instruciton that retired before generating the exception
-			return ictWS.ckdata[0];
-		case TraceDqrProfiler::ICT_CONTROL:
-			if (ictWS.ckdf == 1) {
-				return ictWS.ckdata[0];
-			}
-			break;
-		case TraceDqrProfiler::ICT_INFERABLECALL:
-			if (ictWS.ckdf == 0) { // inferrable call
-				// ckdata[0] is the address of the call instruction. destination determined form program image
-				return ictWS.ckdata[0];
+		msb = -1;
+		mask = nm.indirectHistory.history;
+		taken = -1;	// start at -1 to account for stop bit, which isn't a branch
+		nottaken = 0;
+
+		while (mask > 1) { // use > 1 because the most significant 1 is a stop bit which we don't want to count!
+			msb += 1;
+			if (mask & 1) {
+				taken += 1;
 			}
-			else if (ictWS.ckdf == 1) { // call/return
-				// ckdata[0] is the address of the call instruction. destination is computed from ckdata[1]
-				// for now, just return the faddr
-				return ictWS.ckdata[0];
+			else {
+				nottaken += 1;
 			}
-			break;
-		case TraceDqrProfiler::ICT_EXCEPTION:
-			// ckdata0 the address of the next mainline instruction to execute (will execute after the return from except)
-			return ictWS.ckdata[0];
-		case TraceDqrProfiler::ICT_INTERRUPT:
-			// ckdata0 is the address of the next instruction to execute in mainline code (will execute after the return from interrupt)
-			return ictWS.ckdata[0];
-		case TraceDqrProfiler::ICT_CONTEXT:
-			// ckdata[0] is the address of the instruction prior to doing the context switch
-			return ictWS.ckdata[0];
-		case TraceDqrProfiler::ICT_WATCHPOINT:
-			// ckdata0 is the address of the last instruction to retire??
-			return ictWS.ckdata[0];
-		case TraceDqrProfiler::ICT_PC_SAMPLE:
-			// periodic pc sample. Address of last instruciton to retire??
-			return ictWS.ckdata[0];
-		case TraceDqrProfiler::ICT_NONE:
-		default:
-			break;
+			mask >>= 1;
 		}
-		break;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
-	}
-
-	return -1;
-}
 
-//TraceDqrProfiler::ADDRESS ProfilerNexusMessage::getNextAddr()
-//{
-//	TraceDqrProfiler::ADDRESS addr;
-//
-//	addr = getF_Addr();
-//	if (addr != (TraceDqrProfiler::ADDRESS)-1) {
-//		addr = addr << 1;
-//	}
-//
-//	return addr;
-//}
+		core[nm.coreId].num_trace_ihistory_taken_branches += taken;
+		core[nm.coreId].num_trace_ihistory_nottaken_branches += nottaken;
 
-// Note: for this function to return the correct target address, processTraceMessage() must have already
-// been called for this messages if it is a TCODE_INCIRCUITTRACE message. If it is a TCODE_INCIRCUIRCIUTTRACE_WS,
-// it will work either way
+		if (msb >= 0) {
+			core[nm.coreId].trace_bits_hist += msb + 1;
 
-TraceDqrProfiler::ADDRESS    ProfilerNexusMessage::getICTCallReturnTarget()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		if (ict.cksrc == TraceDqrProfiler::ICT_INFERABLECALL) {
-			if (ict.ckdf == 0) {
-				return ict.ckdata[1];
+			if (msb >= (int32_t)core[nm.coreId].max_hist_bits) {
+				core[nm.coreId].max_hist_bits = msb + 1;
+			}
+		}
+
+		if ((msb + 1) < (int32_t)core[nm.coreId].min_hist_bits) {
+			core[nm.coreId].min_hist_bits = msb + 1;
+		}
+
+		num_branches_all_cores += 1 + taken + nottaken;
+
+		have_uaddr = true;
+		break;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		core[nm.coreId].num_trace_ihistoryws += 1;
+		core[nm.coreId].trace_bits_ihistoryws += bits;
+
+		// need to find msb = 1
+
+		msb = -1;
+		mask = nm.indirectHistoryWS.history;
+		taken = -1;	// start at -1 to account for stop bit, which isn't a branch
+		nottaken = 0;
+
+		while (mask > 1) {
+			msb += 1;
+			if (mask & 1) {
+				taken += 1;
 			}
 			else {
-				return currentAddress ^ (ict.ckdata[1] << 1);
+				nottaken += 1;
+			}
+			mask >>= 1;
+		}
+
+		core[nm.coreId].num_trace_ihistory_taken_branches += taken;
+		core[nm.coreId].num_trace_ihistory_nottaken_branches += nottaken;
+
+		if (msb >= 0) {
+			core[nm.coreId].trace_bits_hist += msb + 1;
+
+			if (msb >= (int32_t)core[nm.coreId].max_hist_bits) {
+				core[nm.coreId].max_hist_bits = msb + 1;
 			}
 		}
+
+		if ((msb + 1) < (int32_t)core[nm.coreId].min_hist_bits) {
+			core[nm.coreId].min_hist_bits = msb + 1;
+		}
+
+		num_branches_all_cores += 1 + taken + nottaken;
+
+		have_faddr = true;
 		break;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-		if (ictWS.cksrc == TraceDqrProfiler::ICT_INFERABLECALL) {
-			if (ictWS.ckdf == 0) {
-				return ictWS.ckdata[1];
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+		core[nm.coreId].num_trace_resourcefull += 1;
+		core[nm.coreId].trace_bits_resourcefull += bits;
+
+		switch (nm.resourceFull.rCode) {
+		case 0:
+			core[nm.coreId].num_trace_resourcefull_i_cnt += 1;
+			break;
+		case 1:
+			core[nm.coreId].num_trace_resourcefull_hist += 1;
+
+			// need to find msb = 1
+
+			msb = -1;
+			mask = nm.resourceFull.history;
+			taken = -1;	// start at -1 to account for stop bit, which isn't a branch
+			nottaken = 0;
+
+			while (mask > 1) {
+				msb += 1;
+				if (mask & 1) {
+					taken += 1;
+				}
+				else {
+					nottaken += 1;
+				}
+				mask >>= 1;
 			}
-			else {
-				return currentAddress ^ (ict.ckdata[1] << 1);
+
+			core[nm.coreId].num_trace_ihistory_taken_branches += taken;
+			core[nm.coreId].num_trace_ihistory_nottaken_branches += nottaken;
+
+			if (msb >= 0) {
+				core[nm.coreId].trace_bits_hist += msb + 1;
+
+				if (msb >= (int32_t)core[nm.coreId].max_hist_bits) {
+					core[nm.coreId].max_hist_bits = msb + 1;
+				}
+			}
+
+			if ((msb + 1) < (int32_t)core[nm.coreId].min_hist_bits) {
+				core[nm.coreId].min_hist_bits = msb + 1;
+			}
+
+			num_branches_all_cores += taken + nottaken;
+			break;
+		case 8:
+			core[nm.coreId].num_trace_resourcefull_notTakenCount += 1;
+			core[nm.coreId].num_trace_resourcefull_nottaken_branches += nm.resourceFull.notTakenCount;
+
+			// compute avg/max/min not taken count
+
+			if (nm.resourceFull.notTakenCount > (uint32_t)core[nm.coreId].max_notTakenCount) {
+				core[nm.coreId].max_notTakenCount = nm.resourceFull.notTakenCount;
+			}
+
+			if ((core[nm.coreId].min_notTakenCount == 0) || (nm.resourceFull.notTakenCount < (uint32_t)core[nm.coreId].min_notTakenCount)) {
+				core[nm.coreId].min_notTakenCount = nm.resourceFull.notTakenCount;
+			}
+			break;
+		case 9:
+			core[nm.coreId].num_trace_resourcefull_takenCount += 1;
+			core[nm.coreId].num_trace_resourcefull_taken_branches += nm.resourceFull.takenCount;
+
+			// compute avg/max/min taken count
+
+			if (nm.resourceFull.takenCount > (uint32_t)core[nm.coreId].max_takenCount) {
+				core[nm.coreId].max_takenCount = nm.resourceFull.takenCount;
+			}
+
+			if ((core[nm.coreId].min_takenCount == 0) || (nm.resourceFull.takenCount < (uint32_t)core[nm.coreId].min_takenCount)) {
+				core[nm.coreId].min_takenCount = nm.resourceFull.takenCount;
 			}
+			break;
+		default:
+			printf("Error: ProfilerAnalytics::updateTraceInfo(): ResoureFull: unknown RDode: %d\n", nm.resourceFull.rCode);
+			status = TraceDqrProfiler::DQERR_ERR;
+			return status;
 		}
 		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+		core[nm.coreId].num_trace_incircuittrace += 1;
+		core[nm.coreId].trace_bits_incircuittrace += bits;
+		have_uaddr = true;
+		break;
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+		core[nm.coreId].num_trace_incircuittraceWS += 1;
+		core[nm.coreId].trace_bits_incircuittraceWS += bits;
+		have_faddr = true;
+		break;
+	case TraceDqrProfiler::TCODE_TRAP_INFO:
+		core[nm.coreId].num_trace_trapinfo += 1;
+		core[nm.coreId].trace_bits_trapinfo += bits;
+		break;
 	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
 	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
 	case TraceDqrProfiler::TCODE_DATA_WRITE:
 	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
 	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
 	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
 	case TraceDqrProfiler::TCODE_DATA_READ_WS:
 	case TraceDqrProfiler::TCODE_WATCHPOINT:
 	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
 	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
 	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
 	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
 	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
 	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
 	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
 	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
 	default:
-		break;
+		status = TraceDqrProfiler::DQERR_ERR;
+		return status;
 	}
 
-	return -1;
+	if (have_uaddr) {
+		core[nm.coreId].num_trace_uaddr += 1;
+		core[nm.coreId].trace_bits_uaddr += addr_bits;
+
+		if (addr_bits > core[nm.coreId].trace_bits_uaddr_max) {
+			core[nm.coreId].trace_bits_uaddr_max = addr_bits;
+		}
+
+		if ((core[nm.coreId].trace_bits_uaddr_min == 0) || (addr_bits < core[nm.coreId].trace_bits_uaddr_min)) {
+			core[nm.coreId].trace_bits_uaddr_min = addr_bits;
+		}
+	}
+	else if (have_faddr) {
+		core[nm.coreId].num_trace_faddr += 1;
+		core[nm.coreId].trace_bits_faddr += addr_bits;
+
+		if (addr_bits > core[nm.coreId].trace_bits_faddr_max) {
+			core[nm.coreId].trace_bits_faddr_max = addr_bits;
+		}
+
+		if ((core[nm.coreId].trace_bits_faddr_min == 0) || (addr_bits < core[nm.coreId].trace_bits_faddr_min)) {
+			core[nm.coreId].trace_bits_faddr_min = addr_bits;
+		}
+	}
+
+	return status;
 }
 
-TraceDqrProfiler::BType ProfilerNexusMessage::getB_Type()
+TraceDqrProfiler::DQErr ProfilerAnalytics::updateInstructionInfo(uint32_t core_id, uint32_t inst, int instSize, int crFlags, TraceDqrProfiler::BranchFlags brFlags)
 {
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-		return indirectBranch.b_type;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-		return indirectBranchWS.b_type;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-		return indirectHistory.b_type;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-		return indirectHistoryWS.b_type;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
+	num_inst_all_cores += 1;
+	core[core_id].num_inst += 1;
+
+	switch (instSize) {
+	case 16:
+		num_inst16_all_cores += 1;
+		core[core_id].num_inst16 += 1;
 		break;
-	default:
+	case 32:
+		num_inst32_all_cores += 1;
+		core[core_id].num_inst32 += 1;
 		break;
+	default:
+		status = TraceDqrProfiler::DQERR_ERR;
 	}
 
-	return TraceDqrProfiler::BTYPE_UNDEFINED;
-}
-
-TraceDqrProfiler::SyncReason ProfilerNexusMessage::getSyncReason()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_SYNC:
-		return sync.sync;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-		return directBranchWS.sync;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-		return indirectBranchWS.sync;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-		return indirectHistoryWS.sync;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
+	switch (brFlags) {
+	case TraceDqrProfiler::BRFLAG_none:
+	case TraceDqrProfiler::BRFLAG_unknown:
 		break;
-	default:
+	case TraceDqrProfiler::BRFLAG_taken:
+		core[core_id].num_taken_branches += 1;
+		break;
+	case TraceDqrProfiler::BRFLAG_notTaken:
+		core[core_id].num_notTaken_branches += 1;
 		break;
 	}
 
-	return TraceDqrProfiler::SYNC_NONE;
-}
-
-uint8_t ProfilerNexusMessage::getEType()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_ERROR:
-		return error.etype;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
+	if (crFlags & TraceDqrProfiler::isCall) {
+		core[core_id].num_calls += 1;
+	}
+	if (crFlags & TraceDqrProfiler::isReturn) {
+		core[core_id].num_returns += 1;
+	}
+	if (crFlags & TraceDqrProfiler::isSwap) {
+		core[core_id].num_swaps += 1;
+	}
+	if (crFlags & TraceDqrProfiler::isInterrupt) {
+		core[core_id].num_interrupts += 1;
+	}
+	if (crFlags & TraceDqrProfiler::isException) {
+		core[core_id].num_exceptions += 1;
+	}
+	if (crFlags & TraceDqrProfiler::isExceptionReturn) {
+		core[core_id].num_exception_returns += 1;
 	}
 
-	return 0;
+	return status;
 }
 
-uint8_t ProfilerNexusMessage::getCKDF()
+static void updateDst(int n, char*& dst, int& dst_len)
 {
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		return ict.ckdf;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-		return ictWS.ckdf;
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
+	if (n >= dst_len) {
+		dst += dst_len;
+		dst_len = 0;
+	}
+	else {
+		dst += n;
+		dst_len -= n;
 	}
-
-	return 0;
 }
 
-TraceDqrProfiler::ICTReason ProfilerNexusMessage::getCKSRC()
+void ProfilerAnalytics::toText(char* dst, int dst_len, int detailLevel)
 {
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		return ict.cksrc;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-		return ictWS.cksrc;
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
+	char tmp_dst[512];
+	int n;
+#ifdef DO_TIMES
+	double etime = etimer->etime();
+#endif // DO_TIMES
+
+	if ((dst == nullptr) || (dst_len < 0)) {
+		printf("Error: Anaylics::toText(): Bad dst pointer\n");
+		return;
 	}
 
-	return TraceDqrProfiler::ICT_NONE;
-}
+	dst[0] = 0;
 
-TraceDqrProfiler::ADDRESS ProfilerNexusMessage::getCKData(int i)
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		return ict.ckdata[i];
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-		return ictWS.ckdata[i];
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
+	if (detailLevel <= 0) {
+		return;
 	}
 
-	return 0;
-}
+	uint32_t have_ts = 0;
 
-uint8_t ProfilerNexusMessage::getCDF()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_CORRELATION:
-		return correlation.cdf;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
+	for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+		if (cores & (1 << i)) {
+			if (core[i].num_trace_ts > 0) {
+				have_ts |= (1 << i);
+			}
+		}
 	}
 
-	return 0;
-}
+	if (srcBits == 0) {
+		n = snprintf(dst, dst_len, "TraceProfiler ProfilerAnalytics: Single core");
+		updateDst(n, dst, dst_len);
+	}
+	else {
+		n = snprintf(dst, dst_len, "TraceProfiler ProfilerAnalytics: Multi core (src field %d bits)", srcBits);
+		updateDst(n, dst, dst_len);
+	}
 
-uint8_t ProfilerNexusMessage::getEVCode()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_CORRELATION:
-		return correlation.evcode;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		break;
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
+	if (have_ts == 0) {
+		n = snprintf(dst, dst_len, "; TraceProfiler messages do not have timestamps\n");
+		updateDst(n, dst, dst_len);
+	}
+	else if (have_ts == cores) {
+		n = snprintf(dst, dst_len, "; TraceProfiler messages have timestamps\n");
+		updateDst(n, dst, dst_len);
+	}
+	else {
+		n = snprintf(dst, dst_len, "; Some trace messages have timestamps\n");
+		updateDst(n, dst, dst_len);
 	}
 
-	return 0;
-}
+	if (detailLevel == 1) {
+		n = snprintf(dst, dst_len, "\n");
+		updateDst(n, dst, dst_len);
 
-uint32_t ProfilerNexusMessage::getData()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-		return dataAcquisition.data;
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-		return auxAccessWrite.data;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
-	}
+		n = snprintf(dst, dst_len, "Instructions             Compressed                   RV32\n");
+		updateDst(n, dst, dst_len);
 
-	return 0;
-}
+		if (num_inst_all_cores > 0) {
+			n = snprintf(dst, dst_len, "  %10u    %10u (%0.2f%%)    %10u (%0.2f%%)\n", num_inst_all_cores, num_inst16_all_cores, ((float)num_inst16_all_cores) / num_inst_all_cores * 100.0, num_inst32_all_cores, ((float)num_inst32_all_cores) / num_inst_all_cores * 100.0);
+		}
+		else {
+			n = snprintf(dst, dst_len, "          -");
+		}
+		updateDst(n, dst, dst_len);
 
-uint32_t ProfilerNexusMessage::getAddr()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-		return auxAccessWrite.data;
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
-	}
+		n = snprintf(dst, dst_len, "\n");
+		updateDst(n, dst, dst_len);
 
-	return 0;
-}
+		n = snprintf(dst, dst_len, "Number of TraceProfiler Msgs      Avg Length    Min Length    Max Length    Total Length\n");
+		updateDst(n, dst, dst_len);
 
-uint32_t ProfilerNexusMessage::getIdTag()
-{
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-		return dataAcquisition.idTag;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
-	}
+		n = snprintf(dst, dst_len, "          %10u          %6.2f    %10u    %10u      %10u\n", num_trace_msgs_all_cores, ((float)num_trace_bits_all_cores) / num_trace_msgs_all_cores, num_trace_bits_all_cores_min, num_trace_bits_all_cores_max, num_trace_bits_all_cores);
+		updateDst(n, dst, dst_len);
 
-	return 0;
-}
+		n = snprintf(dst, dst_len, "\n");
+		updateDst(n, dst, dst_len);
+
+		if (num_inst_all_cores > 0) {
+			n = snprintf(dst, dst_len, "TraceProfiler bits per instruction:     %5.2f\n", ((float)num_trace_bits_all_cores) / num_inst_all_cores);
+		}
+		else {
+			n = snprintf(dst, dst_len, "  --\n");
+		}
+		updateDst(n, dst, dst_len);
+
+		n = snprintf(dst, dst_len, "Instructions per trace message: %5.2f\n", ((float)num_inst_all_cores) / num_trace_msgs_all_cores);
+		updateDst(n, dst, dst_len);
+
+		if (num_branches_all_cores > 0) {
+			n = snprintf(dst, dst_len, "Instructions per taken branch:  %5.2f\n", ((float)num_inst_all_cores) / num_branches_all_cores);
+		}
+		else {
+			n = snprintf(dst, dst_len, "--\n");
+		}
+		updateDst(n, dst, dst_len);
+
+		if (srcBits > 0) {
+			n = snprintf(dst, dst_len, "Src bits %% of message:          %5.2f%%\n", ((float)srcBits * num_trace_msgs_all_cores) / num_trace_bits_all_cores * 100.0);
+			updateDst(n, dst, dst_len);
+		}
+
+		if (have_ts != 0 || 1) {
+			int bits_ts = 0;
+
+			for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+				if (cores & (1 << i)) {
+					bits_ts += core[i].trace_bits_ts;
+				}
+			}
+			n = snprintf(dst, dst_len, "Timestamp bits %% of message:    %5.2f%%\n", ((float)bits_ts) / num_trace_bits_all_cores * 100.0);
+			updateDst(n, dst, dst_len);
+		}
+	}
+	else if (detailLevel > 1) {
+		int position;
+		int tabs[] = { 19 + 21 * 0,19 + 21 * 1,19 + 21 * 2,19 + 21 * 3,19 + 21 * 4,19 + 21 * 5,19 + 21 * 6,19 + 21 * 7,19 + 21 * 8 };
+		uint32_t t1, t2;
+		int ts;
+
+		n = sprintf(tmp_dst, "\n");
+		n += sprintf(tmp_dst + n, "                 ");
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				n += sprintf(tmp_dst + n, "          Core %d", i);
+			}
+		}
+
+		if (srcBits > 0) {
+			n += sprintf(tmp_dst + n, "               Total");
+		}
+
+		n += sprintf(tmp_dst + n, "\n");
+
+		n = snprintf(dst, dst_len, "%s", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Instructions");
+
+		t1 = 0;
+		ts = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_inst);
+				t1 += core[i].num_inst;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  Compressed");
+
+		t2 = 0;
+		ts = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_inst > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_inst16, ((float)core[i].num_inst16) / core[i].num_inst * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_inst16;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  RV32");
+
+		t2 = 0;
+		ts = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_inst > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_inst32, ((float)core[i].num_inst32) / core[i].num_inst * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_inst32;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "TraceProfiler Msgs");
+
+		t1 = 0;
+		ts = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_trace_msgs);
+				t1 += core[i].num_trace_msgs;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += printf(" "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  Sync");
+
+		t2 = 0;
+		ts = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_syncs, ((float)core[i].num_trace_syncs) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_syncs;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  DBranch");
+
+		t2 = 0;
+		ts = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_dbranch, ((float)core[i].num_trace_dbranch) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_dbranch;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  IBranch");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ibranch, ((float)core[i].num_trace_ibranch) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_ibranch;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  DBranch WS");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_dbranchws, ((float)core[i].num_trace_dbranchws) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_dbranchws;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  IBranch WS");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ibranchws, ((float)core[i].num_trace_ibranchws) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_ibranchws;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  Data Acq");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_dataacq, ((float)core[i].num_trace_dataacq) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_dataacq;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  Correlation");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_correlation, ((float)core[i].num_trace_correlation) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_correlation;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  Aux Acc Write");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_auxaccesswrite, ((float)core[i].num_trace_auxaccesswrite) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_auxaccesswrite;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  Ownership");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ownership, ((float)core[i].num_trace_ownership) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_ownership;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  Error");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_error, ((float)core[i].num_trace_error) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_error;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  IHistory");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ihistory, ((float)core[i].num_trace_ihistory) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_ihistory;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  IHistory WS");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_ihistoryws, ((float)core[i].num_trace_ihistoryws) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_ihistoryws;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  RFull ICNT");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_resourcefull_i_cnt, ((float)core[i].num_trace_resourcefull_i_cnt) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_resourcefull_i_cnt;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  RFull HIST");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_resourcefull_hist, ((float)core[i].num_trace_resourcefull_hist) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_resourcefull_hist;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  RFull Taken");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_resourcefull_takenCount, ((float)core[i].num_trace_resourcefull_takenCount) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_resourcefull_takenCount;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  RFull NTaken");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_resourcefull_notTakenCount, ((float)core[i].num_trace_resourcefull_notTakenCount) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_resourcefull_notTakenCount;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  ICT WS");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_incircuittraceWS, ((float)core[i].num_trace_incircuittraceWS) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_ihistoryws;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  ICT");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", core[i].num_trace_incircuittrace, ((float)core[i].num_trace_incircuittrace) / core[i].num_trace_msgs * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t2 += core[i].num_trace_ihistoryws;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%10u (%0.2f%%)", t2, ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "TraceProfiler Bits Total");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits);
+				t1 += core[i].trace_bits;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		//		printf("\n");
+		//		position = printf("TraceProfiler Bits MSEO");
+		//
+		//		ts = 0;
+		//		t1 = 0;
+		//
+		//		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+		//			if (cores & (1<<i)) {
+		//				while (position < tabs[ts]) { position += printf(" "); }
+		//				position += printf("%10u",core[i].trace_bits_mseo);
+		//				t1 += core[i].trace_bits_mseo;
+		//				ts += 1;
+		//			}
+		//		}
+		//
+		//		if (srcBits > 0) {
+		//			while (position < tabs[ts]) { position += printf(" "); }
+		//			printf("%10u",t1);
+		//		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "TraceProfiler Bits/Inst");
+
+		ts = 0;
+		t1 = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_inst > 0) {
+					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits) / core[i].num_inst);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t1 += core[i].trace_bits;
+				t2 += core[i].num_inst;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t2 > 0) {
+				position += sprintf(tmp_dst + position, "%13.2f", ((float)t1) / t2);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Inst/TraceProfiler Msg");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].num_inst) / core[i].num_trace_msgs);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t1 += core[i].num_trace_msgs;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Inst/Taken Branch");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if ((core[i].num_trace_dbranch + core[i].num_trace_ibranch + core[i].num_trace_dbranchws + core[i].num_trace_ibranchws + core[i].num_trace_ihistory_taken_branches + core[i].num_trace_resourcefull_taken_branches) > 0) {
+					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].num_inst) / (core[i].num_trace_dbranch + core[i].num_trace_ibranch + core[i].num_trace_dbranchws + core[i].num_trace_ibranchws + core[i].num_trace_ihistory_taken_branches + core[i].num_trace_resourcefull_taken_branches));
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t1 += core[i].num_trace_dbranch + core[i].num_trace_ibranch + core[i].num_trace_dbranchws + core[i].num_trace_ibranchws;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Avg Msg Length");
+
+		ts = 0;
+		t1 = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_msgs > 0) {
+					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits) / core[i].num_trace_msgs);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t1 += core[i].trace_bits;
+				t2 += core[i].num_trace_msgs;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t2 > 0) {
+				position += sprintf(tmp_dst + position, "%13.2f", ((float)t1) / t2);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Min Msg Length");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_min);
+				if ((t1 == 0) || (core[i].trace_bits_min < t1)) {
+					t1 = core[i].trace_bits_min;
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Max Msg Length");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_max);
+				if (core[i].trace_bits_max > t1) {
+					t1 = core[i].trace_bits_max;
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Timestamp Counts");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_trace_ts);
+				t1 += core[i].num_trace_ts;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  TStamp Size Avg");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_ts > 0) {
+					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits_ts) / core[i].num_trace_ts);
+					t2 += core[i].trace_bits_ts;
+				}
+				else {
+					position += sprintf(tmp_dst + position, "         0");
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "         0");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  TStamp Size Min");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_ts_min);
+				if ((t1 == 0) || (t1 > core[i].trace_bits_ts_min)) {
+					t1 = core[i].trace_bits_ts_min;
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  TStamp Size Max");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_ts_max);
+				if (core[i].trace_bits_ts_max > t1) {
+					t1 = core[i].trace_bits_ts_max;
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Timestamp %% of Msg");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].trace_bits > 0) {
+					position += sprintf(tmp_dst + position, "%13.2f%%", ((float)core[i].trace_bits_ts) / core[i].trace_bits * 100.0);
+				}
+				else {
+					position += sprintf(tmp_dst + position, "          -");
+				}
+				t1 += core[i].trace_bits;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%13.2f%%", ((float)t2) / t1 * 100.0);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "          -");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "UADDR Counts");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_trace_uaddr);
+				t1 += core[i].num_trace_uaddr;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  UADDR Size Avg");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_uaddr > 0) {
+					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits_uaddr) / core[i].num_trace_uaddr);
+					t2 += core[i].trace_bits_uaddr;
+				}
+				else {
+					position += sprintf(tmp_dst + position, "        0");
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "        0");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  UADDR Size Min");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_uaddr_min);
+				if ((t1 == 0) || (core[i].trace_bits_uaddr_min < t1)) {
+					t1 = core[i].trace_bits_uaddr_min;
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  UADDR Size Max");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_uaddr_max);
+				if (t1 < core[i].trace_bits_uaddr_max) {
+					t1 = core[i].trace_bits_uaddr_max;
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "FADDR Counts");
+
+		ts = 0;
+		t1 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_trace_faddr);
+				t1 += core[i].num_trace_faddr;
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t1);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  FADDR Size Avg");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				if (core[i].num_trace_faddr > 0) {
+					position += sprintf(tmp_dst + position, "%13.2f", ((float)core[i].trace_bits_faddr) / core[i].num_trace_faddr);
+					t2 = core[i].trace_bits_faddr;
+				}
+				else {
+					position += sprintf(tmp_dst + position, "        0");
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			if (t1 > 0) {
+				position += sprintf(tmp_dst + position, "%13.2f", ((float)t2) / t1);
+			}
+			else {
+				position += sprintf(tmp_dst + position, "        0");
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  FADDR Size Min");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_faddr_min);
+				if ((t2 == 0) || (core[i].trace_bits_faddr_min < t2)) {
+					t2 = core[i].trace_bits_faddr_min;
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t2);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "  FADDR Size Max");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].trace_bits_faddr_max);
+				if (core[i].trace_bits_faddr_max > t2) {
+					t2 = core[i].trace_bits_faddr_max;
+				}
+				ts += 1;
+			}
+		}
+
+		if (srcBits > 0) {
+			while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+			position += sprintf(tmp_dst + position, "%10u", t2);
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Taken Branches");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_taken_branches);
+				ts += 1;
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Not Taken Branches");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_notTaken_branches);
+				ts += 1;
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Calls");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_calls);
+				ts += 1;
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Returns");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_returns);
+				ts += 1;
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Swaps");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_swaps);
+				ts += 1;
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Exceptions");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_exceptions);
+				ts += 1;
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Exception Returns");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_exception_returns);
+				ts += 1;
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+
+		position = sprintf(tmp_dst, "Interrupts");
+
+		ts = 0;
+		t2 = 0;
+
+		for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+			if (cores & (1 << i)) {
+				while (position < tabs[ts]) { position += sprintf(tmp_dst + position, " "); }
+				position += sprintf(tmp_dst + position, "%10u", core[i].num_interrupts);
+				ts += 1;
+			}
+		}
+
+		n = snprintf(dst, dst_len, "%s\n", tmp_dst);
+		updateDst(n, dst, dst_len);
+	}
+
+#ifdef DO_TIMES
+	n = snprintf(dst, dst_len, "\nTime %f seconds\n", etime);
+	updateDst(n, dst, dst_len);
+	n = snprintf(dst, dst_len, "Instructions decoded per second: %0.2f\n", num_inst_all_cores / etime);
+	updateDst(n, dst, dst_len);
+	n = snprintf(dst, dst_len, "TraceProfiler messages decoded per second: %0.2f\n", num_trace_msgs_all_cores / etime);
+	updateDst(n, dst, dst_len);
+#endif // DO_TIMES
+}
+
+std::string ProfilerAnalytics::toString(int detailLevel)
+{
+	char dst[4096];
+
+	dst[0] = 0;
+
+	toText(dst, sizeof dst, detailLevel);
+
+	return std::string(dst);
+}
+
+uint32_t ProfilerNexusMessage::targetFrequency = 0;
+
+ProfilerNexusMessage::ProfilerNexusMessage()
+{
+	msgNum = 0;
+	tcode = TraceDqrProfiler::TCODE_UNDEFINED;
+	coreId = 0;
+	haveTimestamp = false;
+	timestamp = 0;
+	currentAddress = 0;
+	time = 0;
+	offset = 0;
+	for (int i = 0; (size_t)i < sizeof rawData / sizeof rawData[0]; i++) {
+		rawData[i] = 0xff;
+	}
+}
+
+int ProfilerNexusMessage::getI_Cnt()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+		return directBranch.i_cnt;
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+		return indirectBranch.i_cnt;
+	case TraceDqrProfiler::TCODE_SYNC:
+		return sync.i_cnt;
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+		return directBranchWS.i_cnt;
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+		return indirectBranchWS.i_cnt;
+	case TraceDqrProfiler::TCODE_CORRELATION:
+		return correlation.i_cnt;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+		return indirectHistory.i_cnt;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		return indirectHistoryWS.i_cnt;
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+		return repeatBranch.i_cnt;//return (repeatBranch.b_cnt * repeatBranch.i_cnt);
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+		if (resourceFull.rCode == 0) {
+			return resourceFull.i_cnt;
+		}
+		break;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+TraceDqrProfiler::ADDRESS ProfilerNexusMessage::getU_Addr()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+		return indirectBranch.u_addr;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+		return indirectHistory.u_addr;
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+		switch (ict.cksrc) {
+		case TraceDqrProfiler::ICT_EXT_TRIG:
+			// ckdata0 is the address of the instruciton that retired before generating the exception
+			return ict.ckdata[0];
+		case TraceDqrProfiler::ICT_CONTROL:
+			if (ict.ckdf == 1) {
+				return ict.ckdata[0];
+			}
+			break;
+		case TraceDqrProfiler::ICT_INFERABLECALL:
+			if (ict.ckdf == 0) { // inferrable call
+				// ckdata[0] is the address of the call instruction. destination determined form program image
+				return ict.ckdata[0];
+			}
+			else if (ict.ckdf == 1) { // call/return
+				// ckdata[0] is the address of the call instruction. destination is computed from ckdata[1]
+				return ict.ckdata[0];
+			}
+			break;
+		case TraceDqrProfiler::ICT_EXCEPTION:
+			// ckdata0 the address of the next mainline instruction to execute (will execute after the return from except)
+			return ict.ckdata[0];
+		case TraceDqrProfiler::ICT_INTERRUPT:
+			// ckdata0 is the address of the next instruction to execute in mainline code (will execute after the return from interrupt)
+			return ict.ckdata[0];
+		case TraceDqrProfiler::ICT_CONTEXT:
+			// ckdata[0] is the address of the instruction prior to doing the context switch
+			return ict.ckdata[0];
+		case TraceDqrProfiler::ICT_WATCHPOINT:
+			// ckdata0 is the address of the last instruction to retire??
+			return ict.ckdata[0];
+		case TraceDqrProfiler::ICT_PC_SAMPLE:
+			// periodic pc sample. Address of last instruciton to retire??
+			return ict.ckdata[0];
+		case TraceDqrProfiler::ICT_NONE:
+		default:
+			break;
+		}
+		break;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+	default:
+		break;
+	}
+
+	return -1;
+}
+
+TraceDqrProfiler::ADDRESS ProfilerNexusMessage::getF_Addr()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+		return directBranchWS.f_addr;
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+		return indirectBranchWS.f_addr;
+	case TraceDqrProfiler::TCODE_SYNC:
+		return sync.f_addr;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		return indirectHistoryWS.f_addr;
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+		switch (ictWS.cksrc) {
+		case TraceDqrProfiler::ICT_EXT_TRIG:
+			// ckdata0 is the address of the instruciton that retired before generating the exception
+			return ictWS.ckdata[0];
+		case TraceDqrProfiler::ICT_CONTROL:
+			if (ictWS.ckdf == 1) {
+				return ictWS.ckdata[0];
+			}
+			break;
+		case TraceDqrProfiler::ICT_INFERABLECALL:
+			if (ictWS.ckdf == 0) { // inferrable call
+				// ckdata[0] is the address of the call instruction. destination determined form program image
+				return ictWS.ckdata[0];
+			}
+			else if (ictWS.ckdf == 1) { // call/return
+				// ckdata[0] is the address of the call instruction. destination is computed from ckdata[1]
+				// for now, just return the faddr
+				return ictWS.ckdata[0];
+			}
+			break;
+		case TraceDqrProfiler::ICT_EXCEPTION:
+			// ckdata0 the address of the next mainline instruction to execute (will execute after the return from except)
+			return ictWS.ckdata[0];
+		case TraceDqrProfiler::ICT_INTERRUPT:
+			// ckdata0 is the address of the next instruction to execute in mainline code (will execute after the return from interrupt)
+			return ictWS.ckdata[0];
+		case TraceDqrProfiler::ICT_CONTEXT:
+			// ckdata[0] is the address of the instruction prior to doing the context switch
+			return ictWS.ckdata[0];
+		case TraceDqrProfiler::ICT_WATCHPOINT:
+			// ckdata0 is the address of the last instruction to retire??
+			return ictWS.ckdata[0];
+		case TraceDqrProfiler::ICT_PC_SAMPLE:
+			// periodic pc sample. Address of last instruciton to retire??
+			return ictWS.ckdata[0];
+		case TraceDqrProfiler::ICT_NONE:
+		default:
+			break;
+		}
+		break;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return -1;
+}
+
+//TraceDqrProfiler::ADDRESS ProfilerNexusMessage::getNextAddr()
+//{
+//	TraceDqrProfiler::ADDRESS addr;
+//
+//	addr = getF_Addr();
+//	if (addr != (TraceDqrProfiler::ADDRESS)-1) {
+//		addr = addr << 1;
+//	}
+//
+//	return addr;
+//}
+
+// Note: for this function to return the correct target address, processTraceMessage() must have already
+// been called for this messages if it is a TCODE_INCIRCUITTRACE message. If it is a TCODE_INCIRCUIRCIUTTRACE_WS,
+// it will work either way
+
+TraceDqrProfiler::ADDRESS    ProfilerNexusMessage::getICTCallReturnTarget()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+		if (ict.cksrc == TraceDqrProfiler::ICT_INFERABLECALL) {
+			if (ict.ckdf == 0) {
+				return ict.ckdata[1];
+			}
+			else {
+				return currentAddress ^ (ict.ckdata[1] << 1);
+			}
+		}
+		break;
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+		if (ictWS.cksrc == TraceDqrProfiler::ICT_INFERABLECALL) {
+			if (ictWS.ckdf == 0) {
+				return ictWS.ckdata[1];
+			}
+			else {
+				return currentAddress ^ (ict.ckdata[1] << 1);
+			}
+		}
+		break;
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return -1;
+}
+
+TraceDqrProfiler::BType ProfilerNexusMessage::getB_Type()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+		return indirectBranch.b_type;
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+		return indirectBranchWS.b_type;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+		return indirectHistory.b_type;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		return indirectHistoryWS.b_type;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return TraceDqrProfiler::BTYPE_UNDEFINED;
+}
+
+TraceDqrProfiler::SyncReason ProfilerNexusMessage::getSyncReason()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_SYNC:
+		return sync.sync;
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+		return directBranchWS.sync;
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+		return indirectBranchWS.sync;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		return indirectHistoryWS.sync;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return TraceDqrProfiler::SYNC_NONE;
+}
+
+uint8_t ProfilerNexusMessage::getEType()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_ERROR:
+		return error.etype;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+uint8_t ProfilerNexusMessage::getCKDF()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+		return ict.ckdf;
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+		return ictWS.ckdf;
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+TraceDqrProfiler::ICTReason ProfilerNexusMessage::getCKSRC()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+		return ict.cksrc;
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+		return ictWS.cksrc;
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return TraceDqrProfiler::ICT_NONE;
+}
+
+TraceDqrProfiler::ADDRESS ProfilerNexusMessage::getCKData(int i)
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+		return ict.ckdata[i];
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+		return ictWS.ckdata[i];
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+uint8_t ProfilerNexusMessage::getCDF()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_CORRELATION:
+		return correlation.cdf;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+uint8_t ProfilerNexusMessage::getEVCode()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_CORRELATION:
+		return correlation.evcode;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+		break;
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+uint32_t ProfilerNexusMessage::getData()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+		return dataAcquisition.data;
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+		return auxAccessWrite.data;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+uint32_t ProfilerNexusMessage::getAddr()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+		return auxAccessWrite.data;
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+uint32_t ProfilerNexusMessage::getIdTag()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+		return dataAcquisition.idTag;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
 
 uint32_t ProfilerNexusMessage::getProcess()
 {
 	switch (tcode) {
 	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-		return ownership.process;
+		return ownership.process;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+uint32_t ProfilerNexusMessage::getRCode()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+		return resourceFull.rCode;
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+uint64_t ProfilerNexusMessage::getRData()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+		switch (resourceFull.rCode) {
+		case 0:
+			return (uint64_t)resourceFull.i_cnt;
+		case 1:
+			return resourceFull.history;
+		case 8:
+			return (uint64_t)resourceFull.notTakenCount;
+		case 9:
+			return (uint64_t)resourceFull.takenCount;
+		default:
+			break;
+		}
+		return 0;
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+uint64_t ProfilerNexusMessage::getHistory()
+{
+	switch (tcode) {
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+		if (resourceFull.rCode == 1) {
+			return resourceFull.history;
+		}
+		break;
+	case TraceDqrProfiler::TCODE_CORRELATION:
+		return correlation.history;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+		return indirectHistory.history;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		return indirectHistoryWS.history;
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+	case TraceDqrProfiler::TCODE_ERROR:
+	case TraceDqrProfiler::TCODE_SYNC:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+bool ProfilerNexusMessage::processITCPrintData(ITCPrint* itcPrint)
+{
+	bool rc = false;
+
+	// need to only do this once per message! Return true if the message is an itc print or itc perf message
+	// and it has been consumed. Otherwise, false
+
+	if (itcPrint != nullptr) {
+		switch (tcode) {
+		case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+			rc = itcPrint->print(coreId, dataAcquisition.idTag, dataAcquisition.data, time);
+			break;
+		case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+			rc = itcPrint->print(coreId, auxAccessWrite.addr, auxAccessWrite.data, time);
+			break;
+		default:
+			break;
+		}
+	}
+
+	return rc;
+}
+
+std::string ProfilerNexusMessage::messageToString(int detailLevel)
+{
+	char dst[512];
+
+	messageToText(dst, sizeof dst, detailLevel);
+
+	return std::string(dst);
+}
+
+void  ProfilerNexusMessage::messageToText(char* dst, size_t dst_len, int level)
+{
+	if ((dst == nullptr) || (dst_len <= 0)) {
+		printf("Error: ProfilerNexusMessage::messageToText(): Bad dst pointer\n");
+		return;
+	}
+
+	const char* sr;
+	const char* bt;
+	int n;
+
+	// level = 0, itcprint (always process itc print info)
+	// level = 1, timestamp + target + itcprint
+	// level = 2, message info + timestamp + target + itcprint
+	// level = 3, message info + timestamp + target + itcprint + raw trace data
+
+	if (level <= 0) {
+		dst[0] = 0;
+		return;
+	}
+
+	n = snprintf(dst, dst_len, "Msg # %d, ", msgNum);
+
+	if (level >= 3) {
+		n += snprintf(dst + n, dst_len - n, "Offset %llu, ", (unsigned long long)offset);
+
+		int i = 0;
+
+		do {
+			if (i > 0) {
+				n += snprintf(dst + n, dst_len - n, ":%02x", rawData[i]);
+			}
+			else {
+				n += snprintf(dst + n, dst_len - n, "%02x", rawData[i]);
+			}
+			i += 1;
+		} while (((size_t)i < sizeof rawData / sizeof rawData[0]) && ((rawData[i - 1] & 0x3) != TraceDqrProfiler::MSEO_END));
+		n += snprintf(dst + n, dst_len - n, ", ");
+	}
+
+	if (haveTimestamp) {
+		if (ProfilerNexusMessage::targetFrequency != 0) {
+			n += snprintf(dst + n, dst_len - n, "time: %0.8f, ", ((double)time) / ProfilerNexusMessage::targetFrequency);
+		}
+		else {
+			n += snprintf(dst + n, dst_len - n, "Tics: %llu, ", time);
+		}
+	}
+
+	if ((tcode != TraceDqrProfiler::TCODE_INCIRCUITTRACE) && (tcode != TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS)) {
+		n += snprintf(dst + n, dst_len - n, "NxtAddr: %08llx, TCode: ", currentAddress);
+	}
+
+	switch (tcode) {
 	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+		snprintf(dst + n, dst_len - n, "DEBUG STATUS (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_DEVICE_ID:
+		snprintf(dst + n, dst_len - n, "DEVICE ID (%d)", tcode);
+		break;
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+		n += snprintf(dst + n, dst_len - n, "OWNERSHIP TRACE (%d)", tcode);
+
+		if (level >= 2) {
+			snprintf(dst + n, dst_len - n, " process: %d", ownership.process);
+		}
+		break;
 	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+		n += snprintf(dst + n, dst_len - n, "DIRECT BRANCH (%d)", tcode);
+		if (level >= 2) {
+			snprintf(dst + n, dst_len - n, " I-CNT: %d", directBranch.i_cnt);
+		}
+		break;
 	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+		n += snprintf(dst + n, dst_len - n, "INDIRECT BRANCH (%d)", tcode);
+
+		if (level >= 2) {
+			switch (indirectBranch.b_type) {
+			case TraceDqrProfiler::BTYPE_INDIRECT:
+				bt = "Indirect";
+				break;
+			case TraceDqrProfiler::BTYPE_EXCEPTION:
+				bt = "Exception";
+				break;
+			case TraceDqrProfiler::BTYPE_HARDWARE:
+				bt = "Hardware";
+				break;
+			case TraceDqrProfiler::BTYPE_UNDEFINED:
+				bt = "Undefined";
+				break;
+			default:
+				bt = "Bad Branch Type";
+				break;
+			}
+
+			snprintf(dst + n, dst_len - n, " Branch Type: %s (%d) I-CNT: %d U-ADDR: 0x%08llx ", bt, indirectBranch.b_type, indirectBranch.i_cnt, indirectBranch.u_addr);
+		}
+		break;
 	case TraceDqrProfiler::TCODE_DATA_WRITE:
+		snprintf(dst + n, dst_len - n, "DATA WRITE (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+		snprintf(dst + n, dst_len - n, "DATA READ (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_ERROR:
+		n += snprintf(dst + n, dst_len - n, "ERROR (%d)", tcode);
+		if (level >= 2) {
+			snprintf(dst + n, dst_len - n, " Error Type %d", error.etype);
+		}
+		break;
 	case TraceDqrProfiler::TCODE_SYNC:
+		n += snprintf(dst + n, dst_len - n, "SYNC (%d)", tcode);
+
+		if (level >= 2) {
+			switch (sync.sync) {
+			case TraceDqrProfiler::SYNC_EVTI:
+				sr = "EVTI";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_RESET:
+				sr = "Exit Reset";
+				break;
+			case TraceDqrProfiler::SYNC_T_CNT:
+				sr = "T Count";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_DEBUG:
+				sr = "Exit Debug";
+				break;
+			case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
+				sr = "I-Count Overflow";
+				break;
+			case TraceDqrProfiler::SYNC_TRACE_ENABLE:
+				sr = "TraceProfiler Enable";
+				break;
+			case TraceDqrProfiler::SYNC_WATCHPINT:
+				sr = "Watchpoint";
+				break;
+			case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
+				sr = "FIFO Overrun";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
+				sr = "Exit Powerdown";
+				break;
+			case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
+				sr = "Message Contention";
+				break;
+			case TraceDqrProfiler::SYNC_PC_SAMPLE:
+				sr = "PC Sample";
+				break;
+			case TraceDqrProfiler::SYNC_NONE:
+				sr = "None";
+				break;
+			default:
+				sr = "Bad Sync Reason";
+				break;
+			}
+
+			snprintf(dst + n, dst_len - n, " Reason: (%d) %s I-CNT: %d F-Addr: 0x%08llx", sync.sync, sr, sync.i_cnt, sync.f_addr);
+		}
+		break;
 	case TraceDqrProfiler::TCODE_CORRECTION:
+		snprintf(dst + n, dst_len - n, "Correction (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+		n += snprintf(dst + n, dst_len - n, "DIRECT BRANCH WS (%d)", tcode);
+
+		if (level >= 2) {
+			switch (directBranchWS.sync) {
+			case TraceDqrProfiler::SYNC_EVTI:
+				sr = "EVTI";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_RESET:
+				sr = "Exit Reset";
+				break;
+			case TraceDqrProfiler::SYNC_T_CNT:
+				sr = "T Count";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_DEBUG:
+				sr = "Exit Debug";
+				break;
+			case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
+				sr = "I-Count Overflow";
+				break;
+			case TraceDqrProfiler::SYNC_TRACE_ENABLE:
+				sr = "TraceProfiler Enable";
+				break;
+			case TraceDqrProfiler::SYNC_WATCHPINT:
+				sr = "Watchpoint";
+				break;
+			case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
+				sr = "FIFO Overrun";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
+				sr = "Exit Powerdown";
+				break;
+			case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
+				sr = "Message Contention";
+				break;
+			case TraceDqrProfiler::SYNC_PC_SAMPLE:
+				sr = "PC Sample";
+				break;
+			case TraceDqrProfiler::SYNC_NONE:
+				sr = "None";
+				break;
+			default:
+				sr = "Bad Sync Reason";
+				break;
+			}
+
+			snprintf(dst + n, dst_len - n, " Reason: (%d) %s I-CNT: %d F-Addr: 0x%08llx", directBranchWS.sync, sr, directBranchWS.i_cnt, directBranchWS.f_addr);
+		}
+		break;
 	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+		n += snprintf(dst + n, dst_len - n, "INDIRECT BRANCH WS (%d)", tcode);
+
+		if (level >= 2) {
+			switch (indirectBranchWS.sync) {
+			case TraceDqrProfiler::SYNC_EVTI:
+				sr = "EVTI";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_RESET:
+				sr = "Exit Reset";
+				break;
+			case TraceDqrProfiler::SYNC_T_CNT:
+				sr = "T Count";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_DEBUG:
+				sr = "Exit Debug";
+				break;
+			case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
+				sr = "I-Count Overflow";
+				break;
+			case TraceDqrProfiler::SYNC_TRACE_ENABLE:
+				sr = "TraceProfiler Enable";
+				break;
+			case TraceDqrProfiler::SYNC_WATCHPINT:
+				sr = "Watchpoint";
+				break;
+			case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
+				sr = "FIFO Overrun";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
+				sr = "Exit Powerdown";
+				break;
+			case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
+				sr = "Message Contention";
+				break;
+			case TraceDqrProfiler::SYNC_PC_SAMPLE:
+				sr = "PC Sample";
+				break;
+			case TraceDqrProfiler::SYNC_NONE:
+				sr = "None";
+				break;
+			default:
+				sr = "Bad Sync Reason";
+				break;
+			}
+
+			switch (indirectBranchWS.b_type) {
+			case TraceDqrProfiler::BTYPE_INDIRECT:
+				bt = "Indirect";
+				break;
+			case TraceDqrProfiler::BTYPE_EXCEPTION:
+				bt = "Exception";
+				break;
+			case TraceDqrProfiler::BTYPE_HARDWARE:
+				bt = "Hardware";
+				break;
+			case TraceDqrProfiler::BTYPE_UNDEFINED:
+				bt = "Undefined";
+				break;
+			default:
+				bt = "Bad Branch Type";
+				break;
+			}
+
+			snprintf(dst + n, dst_len - n, " Reason: (%d) %s Branch Type %s (%d) I-CNT: %d F-Addr: 0x%08llx", indirectBranchWS.sync, sr, bt, indirectBranchWS.b_type, indirectBranchWS.i_cnt, indirectBranchWS.f_addr);
+		}
+		break;
 	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+		snprintf(dst + n, dst_len - n, "DATA WRITE WS (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+		snprintf(dst + n, dst_len - n, "DATA READ WS (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_WATCHPOINT:
+		snprintf(dst + n, dst_len - n, "TCode: WATCHPOINT (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+		snprintf(dst + n, dst_len - n, "OUTPUT PORT REPLACEMENT (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+		snprintf(dst + n, dst_len - n, "INPUT PORT REPLACEMENT (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+		snprintf(dst + n, dst_len - n, "AUX ACCESS READ (%d)", tcode);
+		break;
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+		n += snprintf(dst + n, dst_len - n, "DATA ACQUISITION (%d)", tcode);
+
+		if (level >= 2) { // here, if addr not on word boudry, have a partial write!
+			switch (dataAcquisition.idTag & 0x03) {
+			case 0:
+			case 1:
+				snprintf(dst + n, dst_len - n, " idTag: 0x%08x Data: 0x%08x", dataAcquisition.idTag, dataAcquisition.data);
+				break;
+			case 2:
+				snprintf(dst + n, dst_len - n, " idTag: 0x%08x Data: 0x%04x", dataAcquisition.idTag, (uint16_t)dataAcquisition.data);
+				break;
+			case 3:
+				snprintf(dst + n, dst_len - n, " idTag: 0x%08x Data: 0x%02x", dataAcquisition.idTag, (uint8_t)dataAcquisition.data);
+				break;
+			}
+		}
+		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+		n += snprintf(dst + n, dst_len - n, "AUX ACCESS WRITE (%d)", tcode);
+
+		if (level >= 2) { // here, if addr not on word boudry, have a partial write!
+			switch (auxAccessWrite.addr & 0x03) {
+			case 0:
+			case 1:
+				snprintf(dst + n, dst_len - n, " Addr: 0x%08x Data: 0x%08x", auxAccessWrite.addr, auxAccessWrite.data);
+				break;
+			case 2:
+				snprintf(dst + n, dst_len - n, " Addr: 0x%08x Data: 0x%04x", auxAccessWrite.addr, (uint16_t)auxAccessWrite.data);
+				break;
+			case 3:
+				snprintf(dst + n, dst_len - n, " Addr: 0x%08x Data: 0x%02x", auxAccessWrite.addr, (uint8_t)auxAccessWrite.data);
+				break;
+			}
+		}
+		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+		snprintf(dst + n, dst_len - n, "AUX ACCESS READNEXT (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+		snprintf(dst + n, dst_len - n, "AUX ACCESS WRITENEXT (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+		snprintf(dst + n, dst_len - n, "AUXACCESS RESPOINSE (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+		n += snprintf(dst + n, dst_len - n, "RESOURCE FULL (%d)", tcode);
+
+		if (level >= 2) { // here, if addr not on word boudry, have a partial write!
+			n += snprintf(dst + n, dst_len - n, " RCode: %d", resourceFull.rCode);
+
+			switch (resourceFull.rCode) {
+			case 0:
+				snprintf(dst + n, dst_len - n, " I-CNT: %d", resourceFull.i_cnt);
+				break;
+			case 1:
+				snprintf(dst + n, dst_len - n, " History: 0x%08llx", resourceFull.history);
+				break;
+			case 8:
+				snprintf(dst + n, dst_len - n, " Not Taken Count: %u", resourceFull.notTakenCount);
+				break;
+			case 9:
+				snprintf(dst + n, dst_len - n, " Taken Count: %u", resourceFull.takenCount);
+				break;
+			default:
+				snprintf(dst + n, dst_len - n, " Invalid rCode");
+				break;
+			}
+		}
+		break;
 	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+		n += snprintf(dst + n, dst_len - n, "INDIRECT BRANCH HISTORY (%d)", tcode);
+
+		if (level >= 2) {
+			switch (indirectHistory.b_type) {
+			case TraceDqrProfiler::BTYPE_INDIRECT:
+				bt = "Indirect";
+				break;
+			case TraceDqrProfiler::BTYPE_EXCEPTION:
+				bt = "Exception";
+				break;
+			case TraceDqrProfiler::BTYPE_HARDWARE:
+				bt = "Hardware";
+				break;
+			case TraceDqrProfiler::BTYPE_UNDEFINED:
+				bt = "Undefined";
+				break;
+			default:
+				bt = "Bad Branch Type";
+				break;
+			}
+
+			snprintf(dst + n, dst_len - n, " Branch Type: %s (%d) I-CNT: %d U-ADDR: 0x%08llx History: 0x%08llx", bt, indirectHistory.b_type, indirectHistory.i_cnt, indirectHistory.u_addr, indirectHistory.history);
+		}
+		break;
 	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		n += snprintf(dst + n, dst_len - n, "INDIRECT BRANCH HISTORY WS (%d)", tcode);
+
+		if (level >= 2) {
+			switch (indirectHistoryWS.sync) {
+			case TraceDqrProfiler::SYNC_EVTI:
+				sr = "EVTI";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_RESET:
+				sr = "Exit Reset";
+				break;
+			case TraceDqrProfiler::SYNC_T_CNT:
+				sr = "T Count";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_DEBUG:
+				sr = "Exit Debug";
+				break;
+			case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
+				sr = "I-Count Overflow";
+				break;
+			case TraceDqrProfiler::SYNC_TRACE_ENABLE:
+				sr = "TraceProfiler Enable";
+				break;
+			case TraceDqrProfiler::SYNC_WATCHPINT:
+				sr = "Watchpoint";
+				break;
+			case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
+				sr = "FIFO Overrun";
+				break;
+			case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
+				sr = "Exit Powerdown";
+				break;
+			case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
+				sr = "Message Contention";
+				break;
+			case TraceDqrProfiler::SYNC_PC_SAMPLE:
+				sr = "PC Sample";
+				break;
+			case TraceDqrProfiler::SYNC_NONE:
+				sr = "None";
+				break;
+			default:
+				sr = "Bad Sync Reason";
+				break;
+			}
+
+			switch (indirectHistoryWS.b_type) {
+			case TraceDqrProfiler::BTYPE_INDIRECT:
+				bt = "Indirect";
+				break;
+			case TraceDqrProfiler::BTYPE_EXCEPTION:
+				bt = "Exception";
+				break;
+			case TraceDqrProfiler::BTYPE_HARDWARE:
+				bt = "Hardware";
+				break;
+			case TraceDqrProfiler::BTYPE_UNDEFINED:
+				bt = "Undefined";
+				break;
+			default:
+				bt = "Bad Branch Type";
+				break;
+			}
+
+			snprintf(dst + n, dst_len - n, " Reason: (%d) %s Branch Type %s (%d) I-CNT: %d F-Addr: 0x%08llx History: 0x%08llx", indirectHistoryWS.sync, sr, bt, indirectHistoryWS.b_type, indirectHistoryWS.i_cnt, indirectHistoryWS.f_addr, indirectHistoryWS.history);
+		}
+		break;
 	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+		snprintf(dst+n,dst_len-n,"REPEAT BRANCH (%d) Branch Repeat Count: %d",tcode, repeatBranch.b_cnt);
+		break;
 	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+		snprintf(dst + n, dst_len - n, "REPEAT INSTRUCTION (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+		snprintf(dst + n, dst_len - n, "REPEAT INSTRUCTIN WS (%d)", tcode);
+		break;
 	case TraceDqrProfiler::TCODE_CORRELATION:
+		n += snprintf(dst + n, dst_len - n, "CORRELATION (%d)", tcode);
+
+		if (level >= 2) {
+			n += snprintf(dst + n, dst_len - n, " EVCODE: %d CDF: %d I-CNT: %d", correlation.evcode, correlation.cdf, correlation.i_cnt);
+			if (correlation.cdf > 0) {
+				snprintf(dst + n, dst_len - n, " History: 0x%08llx", correlation.history);
+			}
+		}
+		break;
 	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+		if ((ict.cksrc == TraceDqrProfiler::ICT_CONTROL) && (ict.ckdf == 0)) {
+			n += snprintf(dst + n, dst_len - n, "TCode: INCIRCUITTRACE (%d)", tcode);
+		}
+		else {
+			n += snprintf(dst + n, dst_len - n, "Address: %08llx TCode: INCIRCUITTRACE (%d)", currentAddress, tcode);
+		}
+
+		if (level >= 2) {
+			switch (ict.cksrc) {
+			case TraceDqrProfiler::ICT_EXT_TRIG:
+				if (ict.ckdf == 0) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: External Trigger (%d) U-ADDR: 0x%08llx", ict.cksrc, ict.ckdata[0]);
+				}
+				else if (ict.ckdf == 1) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: External Trigger + ID (%d) Trigger ID %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
+				}
+				else {
+					printf("Error: messageToText(): ICT_EXTERNAL_TRIG: invalid ict.ckdf value: %d\n", ict.ckdf);
+					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_EXTERNAL_TRIG: invalid ict.ckdf value: %d", ict.ckdf);
+				}
+				break;
+			case TraceDqrProfiler::ICT_WATCHPOINT:
+				if (ict.ckdf == 0) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Watchpoint (%d) U-ADDR: 0x%08llx", ict.cksrc, ict.ckdata[0]);
+				}
+				else if (ict.ckdf == 1) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Watchpoint + ID (%d) Trigger ID %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
+				}
+				else {
+					printf("Error: messageToText(): ICT_WATCHPOINT: invalid ict.ckdf value: %d\n", ict.ckdf);
+					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_WATCHPOINT: invalid ict.ckdf value: %d", ict.ckdf);
+				}
+				break;
+			case TraceDqrProfiler::ICT_INFERABLECALL:
+				if (ict.ckdf == 0) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Inferable Call (%d) U-ADDR: 0x%08llx", ict.cksrc, ict.ckdata[0]);
+				}
+				else if (ict.ckdf == 1) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Call/Return (%d) U-ADDR: 0x%08llx PCdest 0x%08llx", ict.cksrc, ict.ckdata[0], currentAddress ^ (ict.ckdata[1] << 1));
+				}
+				else {
+					printf("Error: messageToText(): ICT_INFERABLECALL: invalid ict.ckdf value: %d\n", ict.ckdf);
+					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_INFERABLECALL: invalid ict.ckdf value: %d", ict.ckdf);
+				}
+				break;
+			case TraceDqrProfiler::ICT_EXCEPTION:
+				snprintf(dst + n, dst_len - n, " ICT Reason: Exception (%d) Cause %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
+				break;
+			case TraceDqrProfiler::ICT_INTERRUPT:
+				snprintf(dst + n, dst_len - n, " ICT Reason: Interrupt (%d) Cause %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
+				break;
+			case TraceDqrProfiler::ICT_CONTEXT:
+				snprintf(dst + n, dst_len - n, " ICT Reason: Context (%d) Context %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
+				break;
+			case TraceDqrProfiler::ICT_PC_SAMPLE:
+				snprintf(dst + n, dst_len - n, " ICT Reason: Periodic (%d) U-ADDR: 0x%08llx", ict.cksrc, ict.ckdata[0]);
+				break;
+			case TraceDqrProfiler::ICT_CONTROL:
+				if (ict.ckdf == 0) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Control (%d) Control %d", ict.cksrc, (int)ict.ckdata[0]);
+				}
+				else if (ict.ckdf == 1) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Control (%d) Control %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
+				}
+				else {
+					printf("Error: messageToText(): ICT_CONTROL: invalid ict.ckdf value: %d\n", ict.ckdf);
+					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_CONTROL: invalid ict.ckdf value: %d", ict.ckdf);
+				}
+				break;
+			default:
+				printf("Error: messageToText(): Invalid ICT Event: %d\n", ict.cksrc);
+				snprintf(dst + n, dst_len - n, " Error: messageToText(): Invalid ICT Event: %d", ict.cksrc);
+				break;
+			}
+		}
+		break;
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+		if ((ictWS.cksrc == TraceDqrProfiler::ICT_CONTROL) && (ictWS.ckdf == 0)) {
+			n += snprintf(dst + n, dst_len - n, "TCode: INCIRCUITTRACE WS (%d)", tcode);
+		}
+		else {
+			n += snprintf(dst + n, dst_len - n, "Address: %08llx TCode: INCIRCUITTRACE WS (%d)", currentAddress, tcode);
+		}
+
+		if (level >= 2) {
+			switch (ictWS.cksrc) {
+			case TraceDqrProfiler::ICT_EXT_TRIG:
+				if (ictWS.ckdf == 0) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: External Trigger (%d) F-ADDR: 0x%08llx", ictWS.cksrc, ictWS.ckdata[0]);
+				}
+				else if (ictWS.ckdf == 1) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: External Trigger + ID (%d) Trigger ID %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
+				}
+				else {
+					printf("Error: messageToText(): ICT_EXTERNAL_TRIG: invalid ictWS.ckdf value: %d\n", ictWS.ckdf);
+					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_EXTERNAL_TRIG: invalid ictWS.ckdf value: %d", ictWS.ckdf);
+				}
+				break;
+			case TraceDqrProfiler::ICT_WATCHPOINT:
+				if (ictWS.ckdf == 0) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Watchpoint (%d) U-ADDR: 0x%08llx", ictWS.cksrc, ictWS.ckdata[0]);
+				}
+				else if (ictWS.ckdf == 1) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Watchpoint + ID (%d) Trigger ID %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
+				}
+				else {
+					printf("Error: messageToText(): ICT_WATCHPOINT: invalid ictWS.ckdf value: %d\n", ictWS.ckdf);
+					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_WATCHPOINT: invalid ictWS.ckdf value: %d", ictWS.ckdf);
+				}
+				break;
+			case TraceDqrProfiler::ICT_INFERABLECALL:
+				if (ictWS.ckdf == 0) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Inferable Call (%d) F-ADDR: 0x%08llx", ictWS.cksrc, ictWS.ckdata[0]);
+				}
+				else if (ictWS.ckdf == 1) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Call/Return (%d) F-ADDR: 0x%08llx PCdest 0x%08llx", ictWS.cksrc, ictWS.ckdata[0], currentAddress ^ (ictWS.ckdata[1] << 1));
+				}
+				else {
+					printf("Error: messageToText(): ICT_INFERABLECALL: invalid ictWS.ckdf value: %d\n", ictWS.ckdf);
+					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_INFERABLECALL: invalid ictWS.ckdf value: %d", ictWS.ckdf);
+				}
+				break;
+			case TraceDqrProfiler::ICT_EXCEPTION:
+				snprintf(dst + n, dst_len - n, " ICT Reason: Exception (%d) Cause %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
+				break;
+			case TraceDqrProfiler::ICT_INTERRUPT:
+				snprintf(dst + n, dst_len - n, " ICT Reason: Interrupt (%d) Cause %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
+				break;
+			case TraceDqrProfiler::ICT_CONTEXT:
+				snprintf(dst + n, dst_len - n, " ICT Reason: Context (%d) Context %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
+				break;
+			case TraceDqrProfiler::ICT_PC_SAMPLE:
+				snprintf(dst + n, dst_len - n, " ICT Reason: Periodic (%d) F-ADDR: 0x%08llx", ictWS.cksrc, ictWS.ckdata[0]);
+				break;
+			case TraceDqrProfiler::ICT_CONTROL:
+				if (ictWS.ckdf == 0) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Control (%d) Control %d", ictWS.cksrc, (int)ictWS.ckdata[0]);
+				}
+				else if (ictWS.ckdf == 1) {
+					snprintf(dst + n, dst_len - n, " ICT Reason: Control (%d) Control %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
+				}
+				else {
+					printf("Error: messageToText(): ICT_CONTROL: invalid ictWS.ckdf value: %d\n", ictWS.ckdf);
+					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_CONTROL: invalid ictWS.ckdf value: %d", ictWS.ckdf);
+				}
+				break;
+			default:
+				printf("Error: messageToText(): Invalid ICT Event: %d\n", ictWS.cksrc);
+				snprintf(dst + n, dst_len - n, " Error: messageToText(): Invalid ICT Event: %d", ictWS.cksrc);
+				break;
+			}
+		}
+		break;
+	case TraceDqrProfiler::TCODE_TRAP_INFO:
+		snprintf(dst+n,dst_len-n,"TRAP INFO (%d) Trap Value: %d",tcode, trapInfo.trap_value);
+		break;
 	case TraceDqrProfiler::TCODE_UNDEFINED:
+		snprintf(dst + n, dst_len - n, "UNDEFINED (%d)", tcode);
 		break;
 	default:
+		snprintf(dst + n, dst_len - n, "BAD TCODE (%d)", tcode);
 		break;
 	}
+}
 
-	return 0;
+double ProfilerNexusMessage::seconds()
+{
+	if (haveTimestamp == false) {
+		return 0.0;
+	}
+
+	if (targetFrequency != 0) {
+		return ((double)time) / targetFrequency;
+	}
+
+	return (double)time;
 }
 
-uint32_t ProfilerNexusMessage::getRCode()
+void ProfilerNexusMessage::dumpRawMessage()
+{
+	int i;
+
+	printf("Raw Message # %d: ", msgNum);
+
+	for (i = 0; ((size_t)i < sizeof rawData / sizeof rawData[0]) && ((rawData[i] & 0x03) != TraceDqrProfiler::MSEO_END); i++) {
+		printf("%02x ", rawData[i]);
+	}
+
+	if ((size_t)i < sizeof rawData / sizeof rawData[0]) {
+		printf("%02x\n", rawData[i]);
+	}
+	else {
+		printf("no end of message\n");
+	}
+}
+
+void ProfilerNexusMessage::dump()
 {
 	switch (tcode) {
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-		return resourceFull.rCode;
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
 	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+		std::cout << "unsupported debug status trace message\n";
+		break;
 	case TraceDqrProfiler::TCODE_DEVICE_ID:
+		std::cout << "unsupported device id trace message\n";
+		break;
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Ownership, process=" << ownership.process << std::endl; // << ", TS=0x" << hex << timestamp << dec; // << endl;
+		break;
 	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+		//		cout << "(" << traceNum << ") ";
+		//		cout << "  | Direct Branch | TYPE=DBM, ICNT=" << i_cnt << ", TS=0x" << hex << timestamp << dec; // << endl;
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Direct Branch, ICNT=" << directBranch.i_cnt << std::endl; // << ", TS=0x" << hex << timestamp << dec; // << endl;
+		break;
 	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+		//		cout << "(" << traceNum << ") ";
+		//		cout << "  | Indirect Branch | TYPE=IBM, BTYPE=" << b_type << ", ICNT=" << i_cnt << ", UADDR=0x" << hex << u_addr << ", TS=0x" << timestamp << dec;// << endl;
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Indirect Branch, BTYPE=" << indirectBranch.b_type << ", ICNT=" << indirectBranch.i_cnt << ", UADDR=0x" << std::hex << indirectBranch.u_addr << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+		break;
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+		switch (resourceFull.rCode) {
+		case 0:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, rCode=" << resourceFull.rCode << ", ICNT=" << resourceFull.i_cnt << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+			break;
+		case 1:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, rCode=" << resourceFull.rCode << ", History=0x" << std::hex << resourceFull.history << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+			break;
+		case 8:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, rCode=" << resourceFull.rCode << ", Not taken=" << resourceFull.notTakenCount << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+			break;
+		case 9:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, rCode=" << resourceFull.rCode << ", Taken=" << resourceFull.takenCount << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+			break;
+		default:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, Invalid or unsupported rCode for reourceFull TCODE" << std::endl;
+			break;
+		}
+		break;
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+		std::cout << "  # Trace Message(" << msgNum << "): Repeat Branch, B-CNT=" << repeatBranch.b_cnt << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+		break;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Indirect Branch History, ICNT=" << indirectHistory.i_cnt << ", BTYPE=" << indirectHistory.b_type << ", UADDR=0x" << std::hex << indirectHistory.u_addr << std::dec << ", history=0x" << std::hex << indirectHistory.history << std::dec << std::endl;
+		break;
+		//	case TCODE_INDIRECTBRANCHHISTORY_WS:
+		//	case TCODE_CORRELATION:
+		//	case TCODE_INCIRCUITTRACE:
+		//	case TCODE_INCIRCUITTRACE_WS:
+		//		break;
 	case TraceDqrProfiler::TCODE_DATA_WRITE:
+		std::cout << "unsupported data write trace message\n";
+		break;
 	case TraceDqrProfiler::TCODE_DATA_READ:
+		std::cout << "unsupported data read trace message\n";
+		break;
 	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+		std::cout << "unsupported data acquisition trace message\n";
+		break;
 	case TraceDqrProfiler::TCODE_ERROR:
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Error, ETYPE=" << (uint32_t)error.etype << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+		break;
 	case TraceDqrProfiler::TCODE_SYNC:
+		//		cout << "(" << traceNum << "," << syncNum << ") ";
+		//		cout << "  | Sync | TYPE=SYNC, SYNC=" << sync << ", ICNT=" << i_cnt << ", FADDR=0x" << hex << f_addr << ", TS=0x" << timestamp << dec;// << endl;
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Sync, SYNCREASON=" << sync.sync << ", ICNT=" << sync.i_cnt << ", FADDR=0x" << std::hex << sync.f_addr << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+		break;
 	case TraceDqrProfiler::TCODE_CORRECTION:
+		std::cout << "unsupported correction trace message\n";
+		break;
 	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+		//		cout << "(" << traceNum << "," << syncNum << ") ";
+		//		cout << "  | Direct Branch With Sync | TYPE=DBWS, SYNC=" << sync << ", ICNT=" << i_cnt << ", FADDR=0x" << hex << f_addr << ", TS=0x" << timestamp << dec;// << endl;
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Direct Branch With Sync, SYNCTYPE=" << directBranchWS.sync << ", ICNT=" << directBranchWS.i_cnt << ", FADDR=0x" << std::hex << directBranchWS.f_addr << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+		break;
 	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+		//		cout << "(" << traceNum << "," << syncNum << ") ";
+		//		cout << "  | Indirect Branch With Sync | TYPE=IBWS, SYNC=" << sync << ", BTYPE=" << b_type << ", ICNT=" << i_cnt << ", FADDR=0x" << hex << f_addr << ", TS=0x" << timestamp << dec;// << endl;
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Indirect Branch With sync, SYNCTYPE=" << indirectBranchWS.sync << ", BTYPE=" << indirectBranchWS.b_type << ", ICNT=" << indirectBranchWS.i_cnt << ", FADDR=0x" << std::hex << indirectBranchWS.f_addr << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
+		break;
 	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+		std::cout << "unsupported data write with sync trace message\n";
+		break;
 	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+		std::cout << "unsupported data read with sync trace message\n";
+		break;
 	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+		std::cout << "unsupported watchpoint trace message\n";
+		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Auxillary Access Write, address=" << std::hex << auxAccessWrite.addr << std::dec << ", data=" << std::hex << auxAccessWrite.data << std::dec << std::endl; // << ", TS=0x" << hex << timestamp << dec; // << endl;
+		break;
 	case TraceDqrProfiler::TCODE_CORRELATION:
+		std::cout << "  # TraceProfiler Message(" << msgNum << "): Correlation, EVCODE=" << (uint32_t)correlation.evcode << ", CDF=" << (int)correlation.cdf << ", ICNT=" << correlation.i_cnt << "\n"; // << ", TS=0x" << timestamp << dec;// << endl;
+		break;
 	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
+		switch (ict.cksrc) {
+		case TraceDqrProfiler::ICT_EXT_TRIG:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler External Trigger, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec;
+			if (ict.ckdf > 0) {
+				std::cout << ", ID=" << ict.ckdata[1];
+			}
+			std::cout << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_CONTROL:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Control, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf;
+			if (ict.ckdf > 0) {
+				std::cout << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << ", Control=" << ict.ckdata[1] << std::endl;
+			}
+			else {
+				std::cout << ", Control=" << ict.ckdata[0] << std::endl;
+			}
+			break;
+		case TraceDqrProfiler::ICT_INFERABLECALL:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Call/Return, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec;
+			if (ict.ckdf > 0) {
+				std::cout << ", PCDest=0x" << std::hex << ict.ckdata[1] << std::dec;
+			}
+			std::cout << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_EXCEPTION:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Exception, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << ", Cause=" << ict.ckdata[1] << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_INTERRUPT:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Interrupt, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << ", Cause=" << ict.ckdata[1] << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_CONTEXT:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Context, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << ", Context=0x" << std::hex << ict.ckdata[1] << std::dec << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_WATCHPOINT:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Watchpoint, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec;
+			if (ict.ckdf > 0) {
+				std::cout << ", ID=" << ict.ckdata[1];
+			}
+			std::cout << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_PC_SAMPLE:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler PC Sample, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_NONE:
+			break;
+		}
 		break;
-	default:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+		switch (ictWS.cksrc) {
+		case TraceDqrProfiler::ICT_EXT_TRIG:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS External Trigger, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec;
+			if (ictWS.ckdf > 0) {
+				std::cout << ", ID=" << ictWS.ckdata[1];
+			}
+			std::cout << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_CONTROL:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Control, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf;
+			if (ictWS.ckdf > 0) {
+				std::cout << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << ", Control=" << ictWS.ckdata[1] << std::endl;
+			}
+			else {
+				std::cout << ", Control=" << ictWS.ckdata[0] << std::endl;
+			}
+			break;
+		case TraceDqrProfiler::ICT_INFERABLECALL:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Call/Return, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec;
+			if (ictWS.ckdf > 0) {
+				std::cout << ", PCDest=0x" << std::hex << ictWS.ckdata[1] << std::dec;
+			}
+			std::cout << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_EXCEPTION:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Exception, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << ", Cause=" << ictWS.ckdata[1] << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_INTERRUPT:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Interrupt, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << ", Cause=" << ictWS.ckdata[1] << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_CONTEXT:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Context, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << ", Context=0x" << std::hex << ictWS.ckdata[1] << std::dec << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_WATCHPOINT:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Watchpoint, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec;
+			if (ictWS.ckdf > 0) {
+				std::cout << ", ID=" << ictWS.ckdata[1];
+			}
+			std::cout << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_PC_SAMPLE:
+			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS PC Sample, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << std::endl;
+			break;
+		case TraceDqrProfiler::ICT_NONE:
+			break;
+		}
+		break;
+	case TraceDqrProfiler::TCODE_TRAP_INFO:
+		std::cout << "  # Trace Message(" << msgNum << "): Trap Info, TVAL=" << trapInfo.trap_value << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
 		break;
+	default:
+		std::cout << "Error: ProfilerNexusMessage::dump(): Unknown TCODE " << tcode << " (0x" << std::hex << tcode << std::dec << "), msgnum: " << msgNum << std::endl;
+	}
+}
+
+Count::Count()
+{
+	for (int i = 0; i < (int)(sizeof i_cnt / sizeof i_cnt[0]); i++) {
+		i_cnt[i] = 0;
+	}
+
+	for (int i = 0; i < (int)(sizeof history / sizeof history[0]); i++) {
+		history[i] = 0;
+	}
+
+	for (int i = 0; i < (int)(sizeof histBit / sizeof histBit[0]); i++) {
+		histBit[i] = -1;
+	}
+
+	for (int i = 0; i < (int)(sizeof takenCount / sizeof takenCount[0]); i++) {
+		takenCount[i] = 0;
+	}
+
+	for (int i = 0; i < (int)(sizeof notTakenCount / sizeof notTakenCount[0]); i++) {
+		notTakenCount[i] = 0;
 	}
+}
 
-	return 0;
+Count::~Count()
+{
+	// nothing to do here!
 }
 
-uint64_t ProfilerNexusMessage::getRData()
+void Count::resetCounts(int core)
 {
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-		switch (resourceFull.rCode) {
-		case 0:
-			return (uint64_t)resourceFull.i_cnt;
-		case 1:
-			return resourceFull.history;
-		case 8:
-			return (uint64_t)resourceFull.notTakenCount;
-		case 9:
-			return (uint64_t)resourceFull.takenCount;
-		default:
-			break;
-		}
-		return 0;
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
+	i_cnt[core] = 0;
+	histBit[core] = -1;
+	takenCount[core] = 0;
+	notTakenCount[core] = 0;
+}
+
+TraceDqrProfiler::CountType Count::getCurrentCountType(int core)
+{
+	// types are prioritized! Order is important
+
+	if (histBit[core] >= 0) {
+		return TraceDqrProfiler::COUNTTYPE_history;
 	}
 
-	return 0;
+	if (takenCount[core] > 0) {
+		return TraceDqrProfiler::COUNTTYPE_taken;
+	}
+
+	if (notTakenCount[core] > 0) {
+		return TraceDqrProfiler::COUNTTYPE_notTaken;
+	}
+
+	// i-cnt is the lowest priority
+
+	if (i_cnt[core] > 0) {
+		return TraceDqrProfiler::COUNTTYPE_i_cnt;
+	}
+
+	//	printf("count type: hist: %d taken:%d not taken:%d i_cnt: %d\n",histBit[core],takenCount[core],notTakenCount[core],i_cnt[core]);
+
+	return TraceDqrProfiler::COUNTTYPE_none;
 }
 
-uint64_t ProfilerNexusMessage::getHistory()
+TraceDqrProfiler::DQErr Count::setICnt(int core, int count)
 {
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-		if (resourceFull.rCode == 1) {
-			return resourceFull.history;
-		}
-		break;
-	case TraceDqrProfiler::TCODE_CORRELATION:
-		return correlation.history;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-		return indirectHistory.history;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-		return indirectHistoryWS.history;
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_SYNC:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		break;
-	default:
-		break;
-	}
+	i_cnt[core] += count;
 
-	return 0;
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-bool ProfilerNexusMessage::processITCPrintData(ITCPrint* itcPrint)
+TraceDqrProfiler::DQErr Count::setHistory(int core, uint64_t hist)
 {
-	bool rc = false;
+	TraceDqrProfiler::DQErr rc = TraceDqrProfiler::DQERR_OK;
 
-	// need to only do this once per message! Return true if the message is an itc print or itc perf message
-	// and it has been consumed. Otherwise, false
+	if (histBit[core] >= 0) {
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
+	else if (takenCount[core] != 0) {
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
+	else if (notTakenCount[core] != 0) {
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
+	else if (hist == 0) {
+		history[core] = 0;
+		histBit[core] = -1;
+	}
+	else {
+		history[core] = hist;
 
-	if (itcPrint != nullptr) {
-		switch (tcode) {
-		case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-			rc = itcPrint->print(coreId, dataAcquisition.idTag, dataAcquisition.data, time);
-			break;
-		case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-			rc = itcPrint->print(coreId, auxAccessWrite.addr, auxAccessWrite.data, time);
-			break;
-		default:
-			break;
+		int i;
+
+		for (i = sizeof hist * 8 - 1; i >= 0; i -= 1) {
+			if (hist & (((uint64_t)1) << i)) {
+				histBit[core] = i - 1;
+				break;
+			}
+		}
+
+		if (i < 0) {
+			histBit[core] = -1;
 		}
 	}
 
 	return rc;
 }
 
-std::string ProfilerNexusMessage::messageToString(int detailLevel)
+TraceDqrProfiler::DQErr Count::setHistory(int core, uint64_t hist, int count)
 {
-	char dst[512];
-
-	messageToText(dst, sizeof dst, detailLevel);
+	TraceDqrProfiler::DQErr rc;
 
-	return std::string(dst);
-}
+	rc = setICnt(core, count);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return rc;
+	}
 
-void  ProfilerNexusMessage::messageToText(char* dst, size_t dst_len, int level)
-{
-	if ((dst == nullptr) || (dst_len <= 0)) {
-		printf("Error: ProfilerNexusMessage::messageToText(): Bad dst pointer\n");
-		return;
+	rc = setHistory(core, hist);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return rc;
 	}
 
-	const char* sr;
-	const char* bt;
-	int n;
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-	// level = 0, itcprint (always process itc print info)
-	// level = 1, timestamp + target + itcprint
-	// level = 2, message info + timestamp + target + itcprint
-	// level = 3, message info + timestamp + target + itcprint + raw trace data
+TraceDqrProfiler::DQErr Count::setTakenCount(int core, int takenCnt)
+{
+	TraceDqrProfiler::DQErr rc;
 
-	if (level <= 0) {
-		dst[0] = 0;
-		return;
+	if (histBit[core] >= 0) {
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
+	else if (takenCount[core] != 0) {
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
+	else if (notTakenCount[core] != 0) {
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
+	else {
+		takenCount[core] = takenCnt;
+		rc = TraceDqrProfiler::DQERR_OK;
 	}
 
-	n = snprintf(dst, dst_len, "Msg # %d, ", msgNum);
-
-	if (level >= 3) {
-		n += snprintf(dst + n, dst_len - n, "Offset %d, ", offset);
+	return rc;
+}
 
-		int i = 0;
+TraceDqrProfiler::DQErr Count::setNotTakenCount(int core, int notTakenCnt)
+{
+	TraceDqrProfiler::DQErr rc;
 
-		do {
-			if (i > 0) {
-				n += snprintf(dst + n, dst_len - n, ":%02x", rawData[i]);
-			}
-			else {
-				n += snprintf(dst + n, dst_len - n, "%02x", rawData[i]);
-			}
-			i += 1;
-		} while (((size_t)i < sizeof rawData / sizeof rawData[0]) && ((rawData[i - 1] & 0x3) != TraceDqrProfiler::MSEO_END));
-		n += snprintf(dst + n, dst_len - n, ", ");
+	if (histBit[core] >= 0) {
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
+	else if (takenCount[core] != 0) {
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
+	else if (notTakenCount[core] != 0) {
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
+	else {
+		notTakenCount[core] = notTakenCnt;
+		rc = TraceDqrProfiler::DQERR_OK;
 	}
 
-	if (haveTimestamp) {
-		if (ProfilerNexusMessage::targetFrequency != 0) {
-			n += snprintf(dst + n, dst_len - n, "time: %0.8f, ", ((double)time) / ProfilerNexusMessage::targetFrequency);
-		}
-		else {
-			n += snprintf(dst + n, dst_len - n, "Tics: %llu, ", time);
-		}
-	}
+	return rc;
+}
 
-	if ((tcode != TraceDqrProfiler::TCODE_INCIRCUITTRACE) && (tcode != TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS)) {
-		n += snprintf(dst + n, dst_len - n, "NxtAddr: %08llx, TCode: ", currentAddress);
-	}
+TraceDqrProfiler::DQErr Count::setCounts(ProfilerNexusMessage* nm)
+{
+	TraceDqrProfiler::DQErr rc;
+	int tmp_i_cnt = 0;
+	uint64_t tmp_history = 0;
+	int tmp_taken = 0;
+	int tmp_notTaken = 0;
 
-	switch (tcode) {
+	switch (nm->tcode) {
 	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-		snprintf(dst + n, dst_len - n, "DEBUG STATUS (%d)", tcode);
-		break;
 	case TraceDqrProfiler::TCODE_DEVICE_ID:
-		snprintf(dst + n, dst_len - n, "DEVICE ID (%d)", tcode);
-		break;
 	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-		n += snprintf(dst + n, dst_len - n, "OWNERSHIP TRACE (%d)", tcode);
-
-		if (level >= 2) {
-			snprintf(dst + n, dst_len - n, " process: %d", ownership.process);
-		}
-		break;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-		n += snprintf(dst + n, dst_len - n, "DIRECT BRANCH (%d)", tcode);
-		if (level >= 2) {
-			snprintf(dst + n, dst_len - n, " I-CNT: %d", directBranch.i_cnt);
-		}
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-		n += snprintf(dst + n, dst_len - n, "INDIRECT BRANCH (%d)", tcode);
-
-		if (level >= 2) {
-			switch (indirectBranch.b_type) {
-			case TraceDqrProfiler::BTYPE_INDIRECT:
-				bt = "Indirect";
-				break;
-			case TraceDqrProfiler::BTYPE_EXCEPTION:
-				bt = "Exception";
-				break;
-			case TraceDqrProfiler::BTYPE_HARDWARE:
-				bt = "Hardware";
-				break;
-			case TraceDqrProfiler::BTYPE_UNDEFINED:
-				bt = "Undefined";
-				break;
-			default:
-				bt = "Bad Branch Type";
-				break;
-			}
-
-			snprintf(dst + n, dst_len - n, " Branch Type: %s (%d) I-CNT: %d U-ADDR: 0x%08llx ", bt, indirectBranch.b_type, indirectBranch.i_cnt, indirectBranch.u_addr);
-		}
-		break;
 	case TraceDqrProfiler::TCODE_DATA_WRITE:
-		snprintf(dst + n, dst_len - n, "DATA WRITE (%d)", tcode);
-		break;
 	case TraceDqrProfiler::TCODE_DATA_READ:
-		snprintf(dst + n, dst_len - n, "DATA READ (%d)", tcode);
-		break;
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
 	case TraceDqrProfiler::TCODE_ERROR:
-		n += snprintf(dst + n, dst_len - n, "ERROR (%d)", tcode);
-		if (level >= 2) {
-			snprintf(dst + n, dst_len - n, " Error Type %d", error.etype);
-		}
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+	case TraceDqrProfiler::TCODE_TRAP_INFO:
+		// no counts, do nothing
+		return TraceDqrProfiler::DQERR_OK;
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+		tmp_i_cnt = nm->directBranch.i_cnt;
 		break;
-	case TraceDqrProfiler::TCODE_SYNC:
-		n += snprintf(dst + n, dst_len - n, "SYNC (%d)", tcode);
-
-		if (level >= 2) {
-			switch (sync.sync) {
-			case TraceDqrProfiler::SYNC_EVTI:
-				sr = "EVTI";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_RESET:
-				sr = "Exit Reset";
-				break;
-			case TraceDqrProfiler::SYNC_T_CNT:
-				sr = "T Count";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_DEBUG:
-				sr = "Exit Debug";
-				break;
-			case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
-				sr = "I-Count Overflow";
-				break;
-			case TraceDqrProfiler::SYNC_TRACE_ENABLE:
-				sr = "TraceProfiler Enable";
-				break;
-			case TraceDqrProfiler::SYNC_WATCHPINT:
-				sr = "Watchpoint";
-				break;
-			case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
-				sr = "FIFO Overrun";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
-				sr = "Exit Powerdown";
-				break;
-			case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
-				sr = "Message Contention";
-				break;
-			case TraceDqrProfiler::SYNC_PC_SAMPLE:
-				sr = "PC Sample";
-				break;
-			case TraceDqrProfiler::SYNC_NONE:
-				sr = "None";
-				break;
-			default:
-				sr = "Bad Sync Reason";
-				break;
-			}
-
-			snprintf(dst + n, dst_len - n, " Reason: (%d) %s I-CNT: %d F-Addr: 0x%08llx", sync.sync, sr, sync.i_cnt, sync.f_addr);
-		}
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+		tmp_i_cnt = nm->indirectBranch.i_cnt;
 		break;
-	case TraceDqrProfiler::TCODE_CORRECTION:
-		snprintf(dst + n, dst_len - n, "Correction (%d)", tcode);
+	case TraceDqrProfiler::TCODE_SYNC:
+		tmp_i_cnt = nm->sync.i_cnt;
 		break;
 	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-		n += snprintf(dst + n, dst_len - n, "DIRECT BRANCH WS (%d)", tcode);
-
-		if (level >= 2) {
-			switch (directBranchWS.sync) {
-			case TraceDqrProfiler::SYNC_EVTI:
-				sr = "EVTI";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_RESET:
-				sr = "Exit Reset";
-				break;
-			case TraceDqrProfiler::SYNC_T_CNT:
-				sr = "T Count";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_DEBUG:
-				sr = "Exit Debug";
-				break;
-			case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
-				sr = "I-Count Overflow";
-				break;
-			case TraceDqrProfiler::SYNC_TRACE_ENABLE:
-				sr = "TraceProfiler Enable";
-				break;
-			case TraceDqrProfiler::SYNC_WATCHPINT:
-				sr = "Watchpoint";
-				break;
-			case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
-				sr = "FIFO Overrun";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
-				sr = "Exit Powerdown";
-				break;
-			case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
-				sr = "Message Contention";
-				break;
-			case TraceDqrProfiler::SYNC_PC_SAMPLE:
-				sr = "PC Sample";
-				break;
-			case TraceDqrProfiler::SYNC_NONE:
-				sr = "None";
-				break;
-			default:
-				sr = "Bad Sync Reason";
-				break;
-			}
-
-			snprintf(dst + n, dst_len - n, " Reason: (%d) %s I-CNT: %d F-Addr: 0x%08llx", directBranchWS.sync, sr, directBranchWS.i_cnt, directBranchWS.f_addr);
-		}
+		tmp_i_cnt = nm->directBranchWS.i_cnt;
 		break;
 	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-		n += snprintf(dst + n, dst_len - n, "INDIRECT BRANCH WS (%d)", tcode);
-
-		if (level >= 2) {
-			switch (indirectBranchWS.sync) {
-			case TraceDqrProfiler::SYNC_EVTI:
-				sr = "EVTI";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_RESET:
-				sr = "Exit Reset";
-				break;
-			case TraceDqrProfiler::SYNC_T_CNT:
-				sr = "T Count";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_DEBUG:
-				sr = "Exit Debug";
-				break;
-			case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
-				sr = "I-Count Overflow";
-				break;
-			case TraceDqrProfiler::SYNC_TRACE_ENABLE:
-				sr = "TraceProfiler Enable";
-				break;
-			case TraceDqrProfiler::SYNC_WATCHPINT:
-				sr = "Watchpoint";
-				break;
-			case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
-				sr = "FIFO Overrun";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
-				sr = "Exit Powerdown";
-				break;
-			case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
-				sr = "Message Contention";
-				break;
-			case TraceDqrProfiler::SYNC_PC_SAMPLE:
-				sr = "PC Sample";
-				break;
-			case TraceDqrProfiler::SYNC_NONE:
-				sr = "None";
-				break;
-			default:
-				sr = "Bad Sync Reason";
-				break;
-			}
-
-			switch (indirectBranchWS.b_type) {
-			case TraceDqrProfiler::BTYPE_INDIRECT:
-				bt = "Indirect";
-				break;
-			case TraceDqrProfiler::BTYPE_EXCEPTION:
-				bt = "Exception";
-				break;
-			case TraceDqrProfiler::BTYPE_HARDWARE:
-				bt = "Hardware";
-				break;
-			case TraceDqrProfiler::BTYPE_UNDEFINED:
-				bt = "Undefined";
-				break;
-			default:
-				bt = "Bad Branch Type";
-				break;
-			}
+		tmp_i_cnt = nm->indirectBranchWS.i_cnt;
+		break;
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+		//tmp_i_cnt = prev_i_cnt;
+		//tmp_history = prev_history;
+		//tmp_notTaken = prev_taken;
+		//tmp_taken = prev_notTaken;
+		break;
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+		switch (nm->resourceFull.rCode) {
+		case 0:
+			tmp_i_cnt = nm->resourceFull.i_cnt;
+			break;
+		case 1:
+			tmp_history = nm->resourceFull.history;
+			break;
+		case 8:
+			tmp_notTaken = nm->resourceFull.notTakenCount;
+			break;
+		case 9:
+			tmp_taken = nm->resourceFull.takenCount;
+			break;
+		default:
+			printf("Error: Count::setCount(): invalid or unsupported rCode for reourceFull TCODE\n");
 
-			snprintf(dst + n, dst_len - n, " Reason: (%d) %s Branch Type %s (%d) I-CNT: %d F-Addr: 0x%08llx", indirectBranchWS.sync, sr, bt, indirectBranchWS.b_type, indirectBranchWS.i_cnt, indirectBranchWS.f_addr);
+			return TraceDqrProfiler::DQERR_ERR;
 		}
 		break;
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-		snprintf(dst + n, dst_len - n, "DATA WRITE WS (%d)", tcode);
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+		tmp_i_cnt = nm->indirectHistory.i_cnt;
+		tmp_history = nm->indirectHistory.history;
 		break;
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-		snprintf(dst + n, dst_len - n, "DATA READ WS (%d)", tcode);
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		tmp_i_cnt = nm->indirectHistoryWS.i_cnt;
+		tmp_history = nm->indirectHistoryWS.history;
 		break;
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-		snprintf(dst + n, dst_len - n, "TCode: WATCHPOINT (%d)", tcode);
+	case TraceDqrProfiler::TCODE_CORRELATION:
+		tmp_i_cnt = nm->correlation.i_cnt;
+		if (nm->correlation.cdf == 1) {
+			tmp_history = nm->correlation.history;
+		}
 		break;
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
 	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-		snprintf(dst + n, dst_len - n, "OUTPUT PORT REPLACEMENT (%d)", tcode);
-		break;
 	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-		snprintf(dst + n, dst_len - n, "INPUT PORT REPLACEMENT (%d)", tcode);
-		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-		snprintf(dst + n, dst_len - n, "AUX ACCESS READ (%d)", tcode);
-		break;
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-		n += snprintf(dst + n, dst_len - n, "DATA ACQUISITION (%d)", tcode);
-
-		if (level >= 2) { // here, if addr not on word boudry, have a partial write!
-			switch (dataAcquisition.idTag & 0x03) {
-			case 0:
-			case 1:
-				snprintf(dst + n, dst_len - n, " idTag: 0x%08x Data: 0x%08x", dataAcquisition.idTag, dataAcquisition.data);
-				break;
-			case 2:
-				snprintf(dst + n, dst_len - n, " idTag: 0x%08x Data: 0x%04x", dataAcquisition.idTag, (uint16_t)dataAcquisition.data);
-				break;
-			case 3:
-				snprintf(dst + n, dst_len - n, " idTag: 0x%08x Data: 0x%02x", dataAcquisition.idTag, (uint8_t)dataAcquisition.data);
-				break;
-			}
-		}
-		break;
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-		n += snprintf(dst + n, dst_len - n, "AUX ACCESS WRITE (%d)", tcode);
-
-		if (level >= 2) { // here, if addr not on word boudry, have a partial write!
-			switch (auxAccessWrite.addr & 0x03) {
-			case 0:
-			case 1:
-				snprintf(dst + n, dst_len - n, " Addr: 0x%08x Data: 0x%08x", auxAccessWrite.addr, auxAccessWrite.data);
-				break;
-			case 2:
-				snprintf(dst + n, dst_len - n, " Addr: 0x%08x Data: 0x%04x", auxAccessWrite.addr, (uint16_t)auxAccessWrite.data);
-				break;
-			case 3:
-				snprintf(dst + n, dst_len - n, " Addr: 0x%08x Data: 0x%02x", auxAccessWrite.addr, (uint8_t)auxAccessWrite.data);
-				break;
-			}
-		}
-		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-		snprintf(dst + n, dst_len - n, "AUX ACCESS READNEXT (%d)", tcode);
-		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-		snprintf(dst + n, dst_len - n, "AUX ACCESS WRITENEXT (%d)", tcode);
-		break;
 	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-		snprintf(dst + n, dst_len - n, "AUXACCESS RESPOINSE (%d)", tcode);
-		break;
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-		n += snprintf(dst + n, dst_len - n, "RESOURCE FULL (%d)", tcode);
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+	default:
+		printf("Error: Count::setCount(): invalid or unsupported TCODE\n");
 
-		if (level >= 2) { // here, if addr not on word boudry, have a partial write!
-			n += snprintf(dst + n, dst_len - n, " RCode: %d", resourceFull.rCode);
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-			switch (resourceFull.rCode) {
-			case 0:
-				snprintf(dst + n, dst_len - n, " I-CNT: %d", resourceFull.i_cnt);
-				break;
-			case 1:
-				snprintf(dst + n, dst_len - n, " History: 0x%08llx", resourceFull.history);
-				break;
-			case 8:
-				snprintf(dst + n, dst_len - n, " Not Taken Count: %u", resourceFull.notTakenCount);
-				break;
-			case 9:
-				snprintf(dst + n, dst_len - n, " Taken Count: %u", resourceFull.takenCount);
-				break;
-			default:
-				snprintf(dst + n, dst_len - n, " Invalid rCode");
-				break;
-			}
+	if (tmp_i_cnt != 0) {
+		rc = setICnt(nm->coreId, tmp_i_cnt);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return rc;
 		}
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-		n += snprintf(dst + n, dst_len - n, "INDIRECT BRANCH HISTORY (%d)", tcode);
+	}
 
-		if (level >= 2) {
-			switch (indirectHistory.b_type) {
-			case TraceDqrProfiler::BTYPE_INDIRECT:
-				bt = "Indirect";
-				break;
-			case TraceDqrProfiler::BTYPE_EXCEPTION:
-				bt = "Exception";
-				break;
-			case TraceDqrProfiler::BTYPE_HARDWARE:
-				bt = "Hardware";
-				break;
-			case TraceDqrProfiler::BTYPE_UNDEFINED:
-				bt = "Undefined";
-				break;
-			default:
-				bt = "Bad Branch Type";
-				break;
-			}
+	if (tmp_history != 0) {
+		rc = setHistory(nm->coreId, tmp_history);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return rc;
+		}
+	}
 
-			snprintf(dst + n, dst_len - n, " Branch Type: %s (%d) I-CNT: %d U-ADDR: 0x%08llx History: 0x%08llx", bt, indirectHistory.b_type, indirectHistory.i_cnt, indirectHistory.u_addr, indirectHistory.history);
+	if (tmp_taken != 0) {
+		rc = setTakenCount(nm->coreId, tmp_taken);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return rc;
 		}
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-		n += snprintf(dst + n, dst_len - n, "INDIRECT BRANCH HISTORY WS (%d)", tcode);
+	}
 
-		if (level >= 2) {
-			switch (indirectHistoryWS.sync) {
-			case TraceDqrProfiler::SYNC_EVTI:
-				sr = "EVTI";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_RESET:
-				sr = "Exit Reset";
-				break;
-			case TraceDqrProfiler::SYNC_T_CNT:
-				sr = "T Count";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_DEBUG:
-				sr = "Exit Debug";
-				break;
-			case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
-				sr = "I-Count Overflow";
-				break;
-			case TraceDqrProfiler::SYNC_TRACE_ENABLE:
-				sr = "TraceProfiler Enable";
-				break;
-			case TraceDqrProfiler::SYNC_WATCHPINT:
-				sr = "Watchpoint";
-				break;
-			case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
-				sr = "FIFO Overrun";
-				break;
-			case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
-				sr = "Exit Powerdown";
-				break;
-			case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
-				sr = "Message Contention";
-				break;
-			case TraceDqrProfiler::SYNC_PC_SAMPLE:
-				sr = "PC Sample";
-				break;
-			case TraceDqrProfiler::SYNC_NONE:
-				sr = "None";
-				break;
-			default:
-				sr = "Bad Sync Reason";
-				break;
-			}
+	if (tmp_notTaken != 0) {
+		rc = setNotTakenCount(nm->coreId, tmp_notTaken);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return rc;
+		}
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+int Count::consumeICnt(int core, int numToConsume)
+{
+	i_cnt[core] -= numToConsume;
+
+	return i_cnt[core];
+}
+
+int Count::consumeHistory(int core, bool& taken)
+{
+	if (histBit[core] < 0) {
+		return 1;
+	}
+
+	taken = (history[core] & (1 << histBit[core])) != 0;
+
+	histBit[core] -= 1;
+
+	return 0;
+}
+
+int Count::consumeTakenCount(int core)
+{
+	if (takenCount[core] <= 0) {
+		return 1;
+	}
+
+	takenCount[core] -= 1;
+
+	return 0;
+}
+
+int Count::consumeNotTakenCount(int core)
+{
+	if (notTakenCount[core] <= 0) {
+		return 1;
+	}
+
+	notTakenCount[core] -= 1;
+
+	return 0;
+}
+
+void Count::dumpCounts(int core)
+{
+	printf("Count::dumpCounts(): core: %d, i_cnt: %d, history: 0x%08llx, histBit: %d, takenCount: %d, notTakenCount: %d\n", core, i_cnt[core], history[core], histBit[core], takenCount[core], notTakenCount[core]);
+}
+
+TraceRingBuffer::TraceRingBuffer(uint64_t size)
+{
+	head = 0;
+	tail = 0;
+	endOfData = false;
+	closed = false;
+	consumerWaiting = false;
+	producerWaiting = false;
+
+	// indexes are free running and masked into the buffer, so the size must be a power of 2
+
+	if ((size == 0) || ((size & (size - 1)) != 0)) {
+		printf("Error: TraceRingBuffer::TraceRingBuffer(): size %llu is not a power of 2\n", (unsigned long long)size);
+
+		buffer = nullptr;
+		bufferSize = 0;
+		bufferMask = 0;
+
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
+	}
 
-			switch (indirectHistoryWS.b_type) {
-			case TraceDqrProfiler::BTYPE_INDIRECT:
-				bt = "Indirect";
-				break;
-			case TraceDqrProfiler::BTYPE_EXCEPTION:
-				bt = "Exception";
-				break;
-			case TraceDqrProfiler::BTYPE_HARDWARE:
-				bt = "Hardware";
-				break;
-			case TraceDqrProfiler::BTYPE_UNDEFINED:
-				bt = "Undefined";
-				break;
-			default:
-				bt = "Bad Branch Type";
-				break;
-			}
+	// buffer is allocated by the first push so parsers that never get pushed data do not hold one
 
-			snprintf(dst + n, dst_len - n, " Reason: (%d) %s Branch Type %s (%d) I-CNT: %d F-Addr: 0x%08llx History: 0x%08llx", indirectHistoryWS.sync, sr, bt, indirectHistoryWS.b_type, indirectHistoryWS.i_cnt, indirectHistoryWS.f_addr, indirectHistoryWS.history);
-		}
-		break;
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-		snprintf(dst+n,dst_len-n,"REPEAT BRANCH (%d) Branch Repeat Count: %d",tcode, repeatBranch.b_cnt);
-		break;
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-		snprintf(dst + n, dst_len - n, "REPEAT INSTRUCTION (%d)", tcode);
-		break;
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-		snprintf(dst + n, dst_len - n, "REPEAT INSTRUCTIN WS (%d)", tcode);
-		break;
-	case TraceDqrProfiler::TCODE_CORRELATION:
-		n += snprintf(dst + n, dst_len - n, "CORRELATION (%d)", tcode);
+	buffer = nullptr;
+	bufferSize = size;
+	bufferMask = size - 1;
 
-		if (level >= 2) {
-			n += snprintf(dst + n, dst_len - n, " EVCODE: %d CDF: %d I-CNT: %d", correlation.evcode, correlation.cdf, correlation.i_cnt);
-			if (correlation.cdf > 0) {
-				snprintf(dst + n, dst_len - n, " History: 0x%08llx", correlation.history);
-			}
-		}
-		break;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		if ((ict.cksrc == TraceDqrProfiler::ICT_CONTROL) && (ict.ckdf == 0)) {
-			n += snprintf(dst + n, dst_len - n, "TCode: INCIRCUITTRACE (%d)", tcode);
+	status = TraceDqrProfiler::DQERR_OK;
+}
+
+TraceRingBuffer::~TraceRingBuffer()
+{
+	if (buffer != nullptr) {
+		delete[] buffer;
+		buffer = nullptr;
+	}
+}
+
+TraceDqrProfiler::DQErr TraceRingBuffer::push(const uint8_t* p_buff, uint64_t size)
+{
+	if ((p_buff == nullptr) || (bufferSize == 0)) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	if (buffer == nullptr) {
+		buffer = new (std::nothrow) uint8_t[bufferSize];
+		if (buffer == nullptr) {
+			printf("Error: TraceRingBuffer::push(): could not allocate %llu byte buffer\n", (unsigned long long)bufferSize);
+			return TraceDqrProfiler::DQERR_ERR;
 		}
-		else {
-			n += snprintf(dst + n, dst_len - n, "Address: %08llx TCode: INCIRCUITTRACE (%d)", currentAddress, tcode);
+	}
+
+	uint64_t h = head.load(std::memory_order_relaxed);
+
+	while (size > 0) {
+		if (closed.load(std::memory_order_acquire)) {
+			// consumer has stopped reading; nobody will ever see this data
+
+			return TraceDqrProfiler::DQERR_OK;
 		}
 
-		if (level >= 2) {
-			switch (ict.cksrc) {
-			case TraceDqrProfiler::ICT_EXT_TRIG:
-				if (ict.ckdf == 0) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: External Trigger (%d) U-ADDR: 0x%08llx", ict.cksrc, ict.ckdata[0]);
-				}
-				else if (ict.ckdf == 1) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: External Trigger + ID (%d) Trigger ID %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
-				}
-				else {
-					printf("Error: messageToText(): ICT_EXTERNAL_TRIG: invalid ict.ckdf value: %d\n", ict.ckdf);
-					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_EXTERNAL_TRIG: invalid ict.ckdf value: %d", ict.ckdf);
-				}
-				break;
-			case TraceDqrProfiler::ICT_WATCHPOINT:
-				if (ict.ckdf == 0) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Watchpoint (%d) U-ADDR: 0x%08llx", ict.cksrc, ict.ckdata[0]);
-				}
-				else if (ict.ckdf == 1) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Watchpoint + ID (%d) Trigger ID %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
-				}
-				else {
-					printf("Error: messageToText(): ICT_WATCHPOINT: invalid ict.ckdf value: %d\n", ict.ckdf);
-					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_WATCHPOINT: invalid ict.ckdf value: %d", ict.ckdf);
-				}
-				break;
-			case TraceDqrProfiler::ICT_INFERABLECALL:
-				if (ict.ckdf == 0) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Inferable Call (%d) U-ADDR: 0x%08llx", ict.cksrc, ict.ckdata[0]);
-				}
-				else if (ict.ckdf == 1) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Call/Return (%d) U-ADDR: 0x%08llx PCdest 0x%08llx", ict.cksrc, ict.ckdata[0], currentAddress ^ (ict.ckdata[1] << 1));
-				}
-				else {
-					printf("Error: messageToText(): ICT_INFERABLECALL: invalid ict.ckdf value: %d\n", ict.ckdf);
-					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_INFERABLECALL: invalid ict.ckdf value: %d", ict.ckdf);
-				}
-				break;
-			case TraceDqrProfiler::ICT_EXCEPTION:
-				snprintf(dst + n, dst_len - n, " ICT Reason: Exception (%d) Cause %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
-				break;
-			case TraceDqrProfiler::ICT_INTERRUPT:
-				snprintf(dst + n, dst_len - n, " ICT Reason: Interrupt (%d) Cause %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
-				break;
-			case TraceDqrProfiler::ICT_CONTEXT:
-				snprintf(dst + n, dst_len - n, " ICT Reason: Context (%d) Context %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
-				break;
-			case TraceDqrProfiler::ICT_PC_SAMPLE:
-				snprintf(dst + n, dst_len - n, " ICT Reason: Periodic (%d) U-ADDR: 0x%08llx", ict.cksrc, ict.ckdata[0]);
-				break;
-			case TraceDqrProfiler::ICT_CONTROL:
-				if (ict.ckdf == 0) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Control (%d) Control %d", ict.cksrc, (int)ict.ckdata[0]);
-				}
-				else if (ict.ckdf == 1) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Control (%d) Control %d U-ADDR: 0x%08llx", ict.cksrc, (int)ict.ckdata[1], ict.ckdata[0]);
-				}
-				else {
-					printf("Error: messageToText(): ICT_CONTROL: invalid ict.ckdf value: %d\n", ict.ckdf);
-					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_CONTROL: invalid ict.ckdf value: %d", ict.ckdf);
-				}
-				break;
-			default:
-				printf("Error: messageToText(): Invalid ICT Event: %d\n", ict.cksrc);
-				snprintf(dst + n, dst_len - n, " Error: messageToText(): Invalid ICT Event: %d", ict.cksrc);
-				break;
-			}
+		uint64_t space = bufferSize - (h - tail.load(std::memory_order_acquire));
+
+		if (space == 0) {
+			// ring is full, sleep until the consumer releases some of it
+
+			std::unique_lock<std::mutex> lock(waitMutex);
+
+			producerWaiting = true;
+			spaceAvailable.wait(lock, [this, h] { return closed || ((h - tail) < bufferSize); });
+			producerWaiting = false;
+
+			continue;
 		}
-		break;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-		if ((ictWS.cksrc == TraceDqrProfiler::ICT_CONTROL) && (ictWS.ckdf == 0)) {
-			n += snprintf(dst + n, dst_len - n, "TCode: INCIRCUITTRACE WS (%d)", tcode);
+
+		uint64_t idx = h & bufferMask;
+		uint64_t n = bufferSize - idx;
+
+		if (n > space) {
+			n = space;
 		}
-		else {
-			n += snprintf(dst + n, dst_len - n, "Address: %08llx TCode: INCIRCUITTRACE WS (%d)", currentAddress, tcode);
+
+		if (n > size) {
+			n = size;
 		}
 
-		if (level >= 2) {
-			switch (ictWS.cksrc) {
-			case TraceDqrProfiler::ICT_EXT_TRIG:
-				if (ictWS.ckdf == 0) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: External Trigger (%d) F-ADDR: 0x%08llx", ictWS.cksrc, ictWS.ckdata[0]);
-				}
-				else if (ictWS.ckdf == 1) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: External Trigger + ID (%d) Trigger ID %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
-				}
-				else {
-					printf("Error: messageToText(): ICT_EXTERNAL_TRIG: invalid ictWS.ckdf value: %d\n", ictWS.ckdf);
-					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_EXTERNAL_TRIG: invalid ictWS.ckdf value: %d", ictWS.ckdf);
-				}
-				break;
-			case TraceDqrProfiler::ICT_WATCHPOINT:
-				if (ictWS.ckdf == 0) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Watchpoint (%d) U-ADDR: 0x%08llx", ictWS.cksrc, ictWS.ckdata[0]);
-				}
-				else if (ictWS.ckdf == 1) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Watchpoint + ID (%d) Trigger ID %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
-				}
-				else {
-					printf("Error: messageToText(): ICT_WATCHPOINT: invalid ictWS.ckdf value: %d\n", ictWS.ckdf);
-					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_WATCHPOINT: invalid ictWS.ckdf value: %d", ictWS.ckdf);
-				}
-				break;
-			case TraceDqrProfiler::ICT_INFERABLECALL:
-				if (ictWS.ckdf == 0) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Inferable Call (%d) F-ADDR: 0x%08llx", ictWS.cksrc, ictWS.ckdata[0]);
-				}
-				else if (ictWS.ckdf == 1) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Call/Return (%d) F-ADDR: 0x%08llx PCdest 0x%08llx", ictWS.cksrc, ictWS.ckdata[0], currentAddress ^ (ictWS.ckdata[1] << 1));
-				}
-				else {
-					printf("Error: messageToText(): ICT_INFERABLECALL: invalid ictWS.ckdf value: %d\n", ictWS.ckdf);
-					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_INFERABLECALL: invalid ictWS.ckdf value: %d", ictWS.ckdf);
-				}
-				break;
-			case TraceDqrProfiler::ICT_EXCEPTION:
-				snprintf(dst + n, dst_len - n, " ICT Reason: Exception (%d) Cause %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
-				break;
-			case TraceDqrProfiler::ICT_INTERRUPT:
-				snprintf(dst + n, dst_len - n, " ICT Reason: Interrupt (%d) Cause %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
-				break;
-			case TraceDqrProfiler::ICT_CONTEXT:
-				snprintf(dst + n, dst_len - n, " ICT Reason: Context (%d) Context %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
-				break;
-			case TraceDqrProfiler::ICT_PC_SAMPLE:
-				snprintf(dst + n, dst_len - n, " ICT Reason: Periodic (%d) F-ADDR: 0x%08llx", ictWS.cksrc, ictWS.ckdata[0]);
-				break;
-			case TraceDqrProfiler::ICT_CONTROL:
-				if (ictWS.ckdf == 0) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Control (%d) Control %d", ictWS.cksrc, (int)ictWS.ckdata[0]);
-				}
-				else if (ictWS.ckdf == 1) {
-					snprintf(dst + n, dst_len - n, " ICT Reason: Control (%d) Control %d F-ADDR: 0x%08llx", ictWS.cksrc, (int)ictWS.ckdata[1], ictWS.ckdata[0]);
-				}
-				else {
-					printf("Error: messageToText(): ICT_CONTROL: invalid ictWS.ckdf value: %d\n", ictWS.ckdf);
-					snprintf(dst + n, dst_len - n, " Error: messageToText(): ICT_CONTROL: invalid ictWS.ckdf value: %d", ictWS.ckdf);
-				}
-				break;
-			default:
-				printf("Error: messageToText(): Invalid ICT Event: %d\n", ictWS.cksrc);
-				snprintf(dst + n, dst_len - n, " Error: messageToText(): Invalid ICT Event: %d", ictWS.cksrc);
-				break;
-			}
+		memcpy(&buffer[idx], p_buff, n);
+
+		h += n;
+		p_buff += n;
+		size -= n;
+
+		// publish the data. Both this store and the load of consumerWaiting are sequentially
+		// consistent so either we see the consumer waiting, or it sees the new head
+
+		head = h;
+
+		if (consumerWaiting) {
+			std::lock_guard<std::mutex> lock(waitMutex);
+			dataAvailable.notify_one();
 		}
-		break;
-	case TraceDqrProfiler::TCODE_TRAP_INFO:
-		snprintf(dst+n,dst_len-n,"TRAP INFO (%d) Trap Value: %d",tcode, trapInfo.trap_value);
-		break;
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-		snprintf(dst + n, dst_len - n, "UNDEFINED (%d)", tcode);
-		break;
-	default:
-		snprintf(dst + n, dst_len - n, "BAD TCODE (%d)", tcode);
-		break;
 	}
+
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-double ProfilerNexusMessage::seconds()
+void TraceRingBuffer::setEndOfData()
 {
-	if (haveTimestamp == false) {
-		return 0.0;
+	endOfData = true;
+
+	std::lock_guard<std::mutex> lock(waitMutex);
+	dataAvailable.notify_all();
+}
+
+void TraceRingBuffer::close()
+{
+	closed = true;
+
+	std::lock_guard<std::mutex> lock(waitMutex);
+	spaceAvailable.notify_all();
+}
+
+TraceDqrProfiler::DQErr TraceRingBuffer::getSpan(const uint8_t*& span, uint64_t& len)
+{
+	uint64_t t = tail.load(std::memory_order_relaxed);
+	uint64_t h = head.load(std::memory_order_acquire);
+
+	if (h == t) {
+		std::unique_lock<std::mutex> lock(waitMutex);
+
+		consumerWaiting = true;
+		dataAvailable.wait(lock, [this, t] { return (head != t) || endOfData; });
+		consumerWaiting = false;
+
+		// end of data is only set after the last push, so reload head before deciding we are done
+
+		h = head.load(std::memory_order_acquire);
+		if (h == t) {
+			return TraceDqrProfiler::DQERR_EOF;
+		}
 	}
 
-	if (targetFrequency != 0) {
-		return ((double)time) / targetFrequency;
+	uint64_t idx = t & bufferMask;
+
+	len = bufferSize - idx;
+	if (len > (h - t)) {
+		len = h - t;
+	}
+
+	span = &buffer[idx];
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+void TraceRingBuffer::release(uint64_t len)
+{
+	if (len == 0) {
+		return;
 	}
 
-	return (double)time;
+	tail = tail.load(std::memory_order_relaxed) + len;
+
+	if (producerWaiting) {
+		std::lock_guard<std::mutex> lock(waitMutex);
+		spaceAvailable.notify_one();
+	}
 }
 
-void ProfilerNexusMessage::dumpRawMessage()
+TraceMsgQueue::TraceMsgQueue(uint32_t size)
 {
-	int i;
+	head = 0;
+	tail = 0;
+	closed = false;
+	consumerWaiting = false;
+	producerWaiting = false;
 
-	printf("Raw Message # %d: ", msgNum);
+	slots = nullptr;
+	queueSize = 0;
+	queueMask = 0;
 
-	for (i = 0; ((size_t)i < sizeof rawData / sizeof rawData[0]) && ((rawData[i] & 0x03) != TraceDqrProfiler::MSEO_END); i++) {
-		printf("%02x ", rawData[i]);
-	}
+	if ((size == 0) || ((size & (size - 1)) != 0)) {
+		printf("Error: TraceMsgQueue::TraceMsgQueue(): size %u is not a power of 2\n", size);
 
-	if ((size_t)i < sizeof rawData / sizeof rawData[0]) {
-		printf("%02x\n", rawData[i]);
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
 	}
-	else {
-		printf("no end of message\n");
+
+	slots = new (std::nothrow) TraceMsgRecord[size];
+	if (slots == nullptr) {
+		printf("Error: TraceMsgQueue::TraceMsgQueue(): could not allocate message queue\n");
+
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
 	}
+
+	queueSize = size;
+	queueMask = size - 1;
+
+	status = TraceDqrProfiler::DQERR_OK;
 }
 
-void ProfilerNexusMessage::dump()
+TraceMsgQueue::~TraceMsgQueue()
 {
-	switch (tcode) {
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-		std::cout << "unsupported debug status trace message\n";
-		break;
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-		std::cout << "unsupported device id trace message\n";
-		break;
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Ownership, process=" << ownership.process << std::endl; // << ", TS=0x" << hex << timestamp << dec; // << endl;
-		break;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-		//		cout << "(" << traceNum << ") ";
-		//		cout << "  | Direct Branch | TYPE=DBM, ICNT=" << i_cnt << ", TS=0x" << hex << timestamp << dec; // << endl;
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Direct Branch, ICNT=" << directBranch.i_cnt << std::endl; // << ", TS=0x" << hex << timestamp << dec; // << endl;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-		//		cout << "(" << traceNum << ") ";
-		//		cout << "  | Indirect Branch | TYPE=IBM, BTYPE=" << b_type << ", ICNT=" << i_cnt << ", UADDR=0x" << hex << u_addr << ", TS=0x" << timestamp << dec;// << endl;
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Indirect Branch, BTYPE=" << indirectBranch.b_type << ", ICNT=" << indirectBranch.i_cnt << ", UADDR=0x" << std::hex << indirectBranch.u_addr << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-		break;
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-		switch (resourceFull.rCode) {
-		case 0:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, rCode=" << resourceFull.rCode << ", ICNT=" << resourceFull.i_cnt << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-			break;
-		case 1:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, rCode=" << resourceFull.rCode << ", History=0x" << std::hex << resourceFull.history << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-			break;
-		case 8:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, rCode=" << resourceFull.rCode << ", Not taken=" << resourceFull.notTakenCount << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-			break;
-		case 9:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, rCode=" << resourceFull.rCode << ", Taken=" << resourceFull.takenCount << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-			break;
-		default:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): Resource Full, Invalid or unsupported rCode for reourceFull TCODE" << std::endl;
-			break;
-		}
-		break;
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-		std::cout << "  # Trace Message(" << msgNum << "): Repeat Branch, B-CNT=" << repeatBranch.b_cnt << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Indirect Branch History, ICNT=" << indirectHistory.i_cnt << ", BTYPE=" << indirectHistory.b_type << ", UADDR=0x" << std::hex << indirectHistory.u_addr << std::dec << ", history=0x" << std::hex << indirectHistory.history << std::dec << std::endl;
-		break;
-		//	case TCODE_INDIRECTBRANCHHISTORY_WS:
-		//	case TCODE_CORRELATION:
-		//	case TCODE_INCIRCUITTRACE:
-		//	case TCODE_INCIRCUITTRACE_WS:
-		//		break;
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-		std::cout << "unsupported data write trace message\n";
-		break;
-	case TraceDqrProfiler::TCODE_DATA_READ:
-		std::cout << "unsupported data read trace message\n";
-		break;
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-		std::cout << "unsupported data acquisition trace message\n";
-		break;
-	case TraceDqrProfiler::TCODE_ERROR:
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Error, ETYPE=" << (uint32_t)error.etype << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-		break;
-	case TraceDqrProfiler::TCODE_SYNC:
-		//		cout << "(" << traceNum << "," << syncNum << ") ";
-		//		cout << "  | Sync | TYPE=SYNC, SYNC=" << sync << ", ICNT=" << i_cnt << ", FADDR=0x" << hex << f_addr << ", TS=0x" << timestamp << dec;// << endl;
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Sync, SYNCREASON=" << sync.sync << ", ICNT=" << sync.i_cnt << ", FADDR=0x" << std::hex << sync.f_addr << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-		break;
-	case TraceDqrProfiler::TCODE_CORRECTION:
-		std::cout << "unsupported correction trace message\n";
-		break;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-		//		cout << "(" << traceNum << "," << syncNum << ") ";
-		//		cout << "  | Direct Branch With Sync | TYPE=DBWS, SYNC=" << sync << ", ICNT=" << i_cnt << ", FADDR=0x" << hex << f_addr << ", TS=0x" << timestamp << dec;// << endl;
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Direct Branch With Sync, SYNCTYPE=" << directBranchWS.sync << ", ICNT=" << directBranchWS.i_cnt << ", FADDR=0x" << std::hex << directBranchWS.f_addr << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-		//		cout << "(" << traceNum << "," << syncNum << ") ";
-		//		cout << "  | Indirect Branch With Sync | TYPE=IBWS, SYNC=" << sync << ", BTYPE=" << b_type << ", ICNT=" << i_cnt << ", FADDR=0x" << hex << f_addr << ", TS=0x" << timestamp << dec;// << endl;
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Indirect Branch With sync, SYNCTYPE=" << indirectBranchWS.sync << ", BTYPE=" << indirectBranchWS.b_type << ", ICNT=" << indirectBranchWS.i_cnt << ", FADDR=0x" << std::hex << indirectBranchWS.f_addr << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-		break;
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-		std::cout << "unsupported data write with sync trace message\n";
-		break;
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-		std::cout << "unsupported data read with sync trace message\n";
-		break;
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-		std::cout << "unsupported watchpoint trace message\n";
-		break;
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Auxillary Access Write, address=" << std::hex << auxAccessWrite.addr << std::dec << ", data=" << std::hex << auxAccessWrite.data << std::dec << std::endl; // << ", TS=0x" << hex << timestamp << dec; // << endl;
-		break;
-	case TraceDqrProfiler::TCODE_CORRELATION:
-		std::cout << "  # TraceProfiler Message(" << msgNum << "): Correlation, EVCODE=" << (uint32_t)correlation.evcode << ", CDF=" << (int)correlation.cdf << ", ICNT=" << correlation.i_cnt << "\n"; // << ", TS=0x" << timestamp << dec;// << endl;
-		break;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		switch (ict.cksrc) {
-		case TraceDqrProfiler::ICT_EXT_TRIG:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler External Trigger, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec;
-			if (ict.ckdf > 0) {
-				std::cout << ", ID=" << ict.ckdata[1];
-			}
-			std::cout << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_CONTROL:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Control, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf;
-			if (ict.ckdf > 0) {
-				std::cout << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << ", Control=" << ict.ckdata[1] << std::endl;
-			}
-			else {
-				std::cout << ", Control=" << ict.ckdata[0] << std::endl;
-			}
-			break;
-		case TraceDqrProfiler::ICT_INFERABLECALL:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Call/Return, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec;
-			if (ict.ckdf > 0) {
-				std::cout << ", PCDest=0x" << std::hex << ict.ckdata[1] << std::dec;
-			}
-			std::cout << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_EXCEPTION:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Exception, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << ", Cause=" << ict.ckdata[1] << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_INTERRUPT:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Interrupt, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << ", Cause=" << ict.ckdata[1] << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_CONTEXT:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Context, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << ", Context=0x" << std::hex << ict.ckdata[1] << std::dec << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_WATCHPOINT:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler Watchpoint, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec;
-			if (ict.ckdf > 0) {
-				std::cout << ", ID=" << ict.ckdata[1];
-			}
-			std::cout << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_PC_SAMPLE:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler PC Sample, cksrc=" << ict.cksrc << ", ckdf=" << (int)ict.ckdf << ", PC=0x" << std::hex << ict.ckdata[0] << std::dec << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_NONE:
-			break;
-		}
-		break;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-		switch (ictWS.cksrc) {
-		case TraceDqrProfiler::ICT_EXT_TRIG:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS External Trigger, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec;
-			if (ictWS.ckdf > 0) {
-				std::cout << ", ID=" << ictWS.ckdata[1];
-			}
-			std::cout << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_CONTROL:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Control, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf;
-			if (ictWS.ckdf > 0) {
-				std::cout << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << ", Control=" << ictWS.ckdata[1] << std::endl;
-			}
-			else {
-				std::cout << ", Control=" << ictWS.ckdata[0] << std::endl;
-			}
-			break;
-		case TraceDqrProfiler::ICT_INFERABLECALL:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Call/Return, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec;
-			if (ictWS.ckdf > 0) {
-				std::cout << ", PCDest=0x" << std::hex << ictWS.ckdata[1] << std::dec;
-			}
-			std::cout << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_EXCEPTION:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Exception, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << ", Cause=" << ictWS.ckdata[1] << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_INTERRUPT:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Interrupt, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << ", Cause=" << ictWS.ckdata[1] << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_CONTEXT:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Context, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << ", Context=0x" << std::hex << ictWS.ckdata[1] << std::dec << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_WATCHPOINT:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS Watchpoint, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec;
-			if (ictWS.ckdf > 0) {
-				std::cout << ", ID=" << ictWS.ckdata[1];
-			}
-			std::cout << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_PC_SAMPLE:
-			std::cout << "  # TraceProfiler Message(" << msgNum << "): In Circuit TraceProfiler WS PC Sample, cksrc=" << ictWS.cksrc << ", ckdf=" << (int)ictWS.ckdf << ", PC=0x" << std::hex << ictWS.ckdata[0] << std::dec << std::endl;
-			break;
-		case TraceDqrProfiler::ICT_NONE:
-			break;
-		}
-		break;
-	case TraceDqrProfiler::TCODE_TRAP_INFO:
-		std::cout << "  # Trace Message(" << msgNum << "): Trap Info, TVAL=" << trapInfo.trap_value << std::dec << std::endl; // << ", TS=0x" << timestamp << dec;// << endl;
-		break;
-	default:
-		std::cout << "Error: ProfilerNexusMessage::dump(): Unknown TCODE " << tcode << " (0x" << std::hex << tcode << std::dec << "), msgnum: " << msgNum << std::endl;
+	if (slots != nullptr) {
+		delete[] slots;
+		slots = nullptr;
 	}
 }
 
-Count::Count()
+TraceMsgRecord* TraceMsgQueue::getWriteSlot()
 {
-	for (int i = 0; i < (int)(sizeof i_cnt / sizeof i_cnt[0]); i++) {
-		i_cnt[i] = 0;
-	}
+	uint64_t h = head.load(std::memory_order_relaxed);
 
-	for (int i = 0; i < (int)(sizeof history / sizeof history[0]); i++) {
-		history[i] = 0;
+	if ((h - tail.load(std::memory_order_acquire)) >= queueSize) {
+		std::unique_lock<std::mutex> lock(waitMutex);
+
+		producerWaiting = true;
+		slotAvailable.wait(lock, [this, h] { return closed || ((h - tail) < queueSize); });
+		producerWaiting = false;
 	}
 
-	for (int i = 0; i < (int)(sizeof histBit / sizeof histBit[0]); i++) {
-		histBit[i] = -1;
+	if (closed) {
+		return nullptr;
 	}
 
-	for (int i = 0; i < (int)(sizeof takenCount / sizeof takenCount[0]); i++) {
-		takenCount[i] = 0;
+	return &slots[h & queueMask];
+}
+
+void TraceMsgQueue::publish()
+{
+	// same ordering argument as TraceRingBuffer::push(): seq_cst store of head, then load of consumerWaiting
+
+	head = head.load(std::memory_order_relaxed) + 1;
+
+	if (consumerWaiting) {
+		std::lock_guard<std::mutex> lock(waitMutex);
+		msgAvailable.notify_one();
 	}
+}
 
-	for (int i = 0; i < (int)(sizeof notTakenCount / sizeof notTakenCount[0]); i++) {
-		notTakenCount[i] = 0;
+TraceMsgRecord* TraceMsgQueue::getReadSlot()
+{
+	uint64_t t = tail.load(std::memory_order_relaxed);
+
+	if (head.load(std::memory_order_acquire) == t) {
+		std::unique_lock<std::mutex> lock(waitMutex);
+
+		consumerWaiting = true;
+		msgAvailable.wait(lock, [this, t] { return closed || (head != t); });
+		consumerWaiting = false;
+
+		if (head == t) {
+			return nullptr;
+		}
 	}
+
+	return &slots[t & queueMask];
 }
 
-Count::~Count()
+void TraceMsgQueue::release()
 {
-	// nothing to do here!
+	tail = tail.load(std::memory_order_relaxed) + 1;
+
+	if (producerWaiting) {
+		std::lock_guard<std::mutex> lock(waitMutex);
+		slotAvailable.notify_one();
+	}
 }
 
-void Count::resetCounts(int core)
+void TraceMsgQueue::close()
 {
-	i_cnt[core] = 0;
-	histBit[core] = -1;
-	takenCount[core] = 0;
-	notTakenCount[core] = 0;
+	closed = true;
+
+	std::lock_guard<std::mutex> lock(waitMutex);
+	slotAvailable.notify_all();
+	msgAvailable.notify_all();
+}
+
+TraceChunk::TraceChunk(TraceChunkStore* owner, uint8_t* data, uint64_t size, uint64_t capacity)
+{
+	this->owner = owner;
+	this->data = data;
+	this->size = size;
+	this->capacity = capacity;
 }
 
-TraceDqrProfiler::CountType Count::getCurrentCountType(int core)
+TraceChunk::~TraceChunk()
 {
-	// types are prioritized! Order is important
+	// unlink the rest of the chain iteratively so dropping a long run of chunks at once can not
+	// recurse through every destructor
 
-	if (histBit[core] >= 0) {
-		return TraceDqrProfiler::COUNTTYPE_history;
-	}
+	std::shared_ptr<TraceChunk> n = std::move(next);
 
-	if (takenCount[core] > 0) {
-		return TraceDqrProfiler::COUNTTYPE_taken;
+	while ((n != nullptr) && (n.use_count() == 1)) {
+		std::shared_ptr<TraceChunk> nn = std::move(n->next);
+		n = std::move(nn);
 	}
 
-	if (notTakenCount[core] > 0) {
-		return TraceDqrProfiler::COUNTTYPE_notTaken;
+	if (data != nullptr) {
+		if (owner != nullptr) {
+			owner->recycle(data, capacity);
+		}
+		else {
+			delete[] data;
+		}
+		data = nullptr;
 	}
+}
 
-	// i-cnt is the lowest priority
-
-	if (i_cnt[core] > 0) {
-		return TraceDqrProfiler::COUNTTYPE_i_cnt;
-	}
+TraceChunkStore::TraceChunkStore(uint64_t highWater)
+{
+	freeBytes = 0;
+	liveBytes = 0;
+	this->highWater = highWater;
 
-	//	printf("count type: hist: %d taken:%d not taken:%d i_cnt: %d\n",histBit[core],takenCount[core],notTakenCount[core],i_cnt[core]);
+	// start with an empty chunk so cursors always have something to attach to
 
-	return TraceDqrProfiler::COUNTTYPE_none;
+	tail = std::make_shared<TraceChunk>(this, nullptr, 0, 0);
 }
 
-TraceDqrProfiler::DQErr Count::setICnt(int core, int count)
+TraceChunkStore::~TraceChunkStore()
 {
-	i_cnt[core] += count;
+	// the chunks hand their buffers back to the pool, so free them before the pool
 
-	return TraceDqrProfiler::DQERR_OK;
+	tail.reset();
+
+	for (size_t i = 0; i < freeBuffers.size(); i++) {
+		delete[] freeBuffers[i].first;
+	}
+
+	freeBuffers.clear();
 }
 
-TraceDqrProfiler::DQErr Count::setHistory(int core, uint64_t hist)
+void TraceChunkStore::recycle(uint8_t* data, uint64_t capacity)
 {
-	TraceDqrProfiler::DQErr rc = TraceDqrProfiler::DQERR_OK;
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
 
-	if (histBit[core] >= 0) {
-		rc = TraceDqrProfiler::DQERR_ERR;
+		liveBytes -= capacity;
+
+		if ((freeBuffers.size() < TRACE_CHUNK_STORE_FREE_BUFFERS) && (freeBytes + capacity <= highWater / 4)) {
+			freeBuffers.push_back(std::make_pair(data, capacity));
+			freeBytes += capacity;
+			data = nullptr;
+		}
 	}
-	else if (takenCount[core] != 0) {
-		rc = TraceDqrProfiler::DQERR_ERR;
+
+	spaceAvailable.notify_all();
+
+	if (data != nullptr) {
+		delete[] data;
 	}
-	else if (notTakenCount[core] != 0) {
-		rc = TraceDqrProfiler::DQERR_ERR;
+}
+
+TraceDqrProfiler::DQErr TraceChunkStore::append(const uint8_t* p_buff, uint64_t size)
+{
+	if (p_buff == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
 	}
-	else if (hist == 0) {
-		history[core] = 0;
-		histBit[core] = -1;
+
+	if (size == 0) {
+		return TraceDqrProfiler::DQERR_OK;
 	}
-	else {
-		history[core] = hist;
 
-		int i;
+	uint8_t* data = nullptr;
+	uint64_t capacity = size;
 
-		for (i = sizeof hist * 8 - 1; i >= 0; i -= 1) {
-			if (hist & (((uint64_t)1) << i)) {
-				histBit[core] = i - 1;
-				break;
+	{
+		std::unique_lock<std::mutex> lock(poolMutex);
+
+		// wait for the slowest cursor to free some chunks. The push that takes the store over the mark still
+		// goes in, so one push larger than the mark can not wait forever
+
+		spaceAvailable.wait(lock, [this] { return liveBytes < highWater; });
+
+		// reuse the smallest free buffer the push fits in
+
+		size_t best = freeBuffers.size();
+
+		for (size_t i = 0; i < freeBuffers.size(); i++) {
+			if ((freeBuffers[i].second >= size) && ((best == freeBuffers.size()) || (freeBuffers[i].second < freeBuffers[best].second))) {
+				best = i;
 			}
 		}
 
-		if (i < 0) {
-			histBit[core] = -1;
+		if (best < freeBuffers.size()) {
+			data = freeBuffers[best].first;
+			capacity = freeBuffers[best].second;
+			freeBytes -= capacity;
+			freeBuffers[best] = freeBuffers.back();
+			freeBuffers.pop_back();
 		}
+
+		liveBytes += capacity;
 	}
 
-	return rc;
-}
+	if (data == nullptr) {
+		data = new (std::nothrow) uint8_t[size];
+		if (data == nullptr) {
+			printf("Error: TraceChunkStore::append(): could not allocate %llu byte chunk\n", (unsigned long long)size);
 
-TraceDqrProfiler::DQErr Count::setHistory(int core, uint64_t hist, int count)
-{
-	TraceDqrProfiler::DQErr rc;
+			std::lock_guard<std::mutex> lock(poolMutex);
+			liveBytes -= capacity;
 
-	rc = setICnt(core, count);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		return rc;
+			return TraceDqrProfiler::DQERR_ERR;
+		}
 	}
 
-	rc = setHistory(core, hist);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		return rc;
+	memcpy(data, p_buff, size);
+
+	std::shared_ptr<TraceChunk> c = std::make_shared<TraceChunk>(this, data, size, capacity);
+
+	{
+		std::lock_guard<std::mutex> lock(storeMutex);
+
+		tail->next = c;
+		tail = c;
 	}
 
+	dataAvailable.notify_all();
+
 	return TraceDqrProfiler::DQERR_OK;
 }
 
-TraceDqrProfiler::DQErr Count::setTakenCount(int core, int takenCnt)
+TraceChunkCursor::TraceChunkCursor()
 {
-	TraceDqrProfiler::DQErr rc;
+	offset = 0;
+	endOfData = false;
+	closed = false;
+}
 
-	if (histBit[core] >= 0) {
-		rc = TraceDqrProfiler::DQERR_ERR;
-	}
-	else if (takenCount[core] != 0) {
-		rc = TraceDqrProfiler::DQERR_ERR;
-	}
-	else if (notTakenCount[core] != 0) {
-		rc = TraceDqrProfiler::DQERR_ERR;
-	}
-	else {
-		takenCount[core] = takenCnt;
-		rc = TraceDqrProfiler::DQERR_OK;
-	}
+void TraceChunkCursor::attach(std::shared_ptr<TraceChunkStore>& traceStore)
+{
+	std::shared_ptr<TraceChunk> old;
 
-	return rc;
+	store = traceStore;
+
+	// only data pushed after attaching is seen, same as pushing to a newly created parser
+
+	std::lock_guard<std::mutex> lock(store->storeMutex);
+
+	old = std::move(chunk);
+	chunk = store->tail;
+	offset = chunk->size;
+	endOfData = false;
+	closed = false;
 }
 
-TraceDqrProfiler::DQErr Count::setNotTakenCount(int core, int notTakenCnt)
+void TraceChunkCursor::setEndOfData()
 {
-	TraceDqrProfiler::DQErr rc;
-
-	if (histBit[core] >= 0) {
-		rc = TraceDqrProfiler::DQERR_ERR;
-	}
-	else if (takenCount[core] != 0) {
-		rc = TraceDqrProfiler::DQERR_ERR;
-	}
-	else if (notTakenCount[core] != 0) {
-		rc = TraceDqrProfiler::DQERR_ERR;
+	if (store == nullptr) {
+		return;
 	}
-	else {
-		notTakenCount[core] = notTakenCnt;
-		rc = TraceDqrProfiler::DQERR_OK;
+
+	{
+		std::lock_guard<std::mutex> lock(store->storeMutex);
+		endOfData = true;
 	}
 
-	return rc;
+	store->dataAvailable.notify_all();
 }
 
-TraceDqrProfiler::DQErr Count::setCounts(ProfilerNexusMessage* nm)
+void TraceChunkCursor::close()
 {
-	TraceDqrProfiler::DQErr rc;
-	int tmp_i_cnt = 0;
-	uint64_t tmp_history = 0;
-	int tmp_taken = 0;
-	int tmp_notTaken = 0;
-	static int prev_i_cnt = 0;
-	static uint64_t prev_history = 0;
-	static int prev_taken = 0;
-	static int prev_notTaken = 0;
+	if (store == nullptr) {
+		return;
+	}
 
-	switch (nm->tcode) {
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-	case TraceDqrProfiler::TCODE_ERROR:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-	case TraceDqrProfiler::TCODE_TRAP_INFO:
-		// no counts, do nothing
-		return TraceDqrProfiler::DQERR_OK;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-		tmp_i_cnt = nm->directBranch.i_cnt;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-		tmp_i_cnt = nm->indirectBranch.i_cnt;
-		break;
-	case TraceDqrProfiler::TCODE_SYNC:
-		tmp_i_cnt = nm->sync.i_cnt;
-		break;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-		tmp_i_cnt = nm->directBranchWS.i_cnt;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-		tmp_i_cnt = nm->indirectBranchWS.i_cnt;
-		break;
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-		//tmp_i_cnt = prev_i_cnt;
-		//tmp_history = prev_history;
-		//tmp_notTaken = prev_taken;
-		//tmp_taken = prev_notTaken;
-		break;
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-		switch (nm->resourceFull.rCode) {
-		case 0:
-			tmp_i_cnt = nm->resourceFull.i_cnt;
-			break;
-		case 1:
-			tmp_history = nm->resourceFull.history;
-			break;
-		case 8:
-			tmp_notTaken = nm->resourceFull.notTakenCount;
-			break;
-		case 9:
-			tmp_taken = nm->resourceFull.takenCount;
-			break;
-		default:
-			printf("Error: Count::setCount(): invalid or unsupported rCode for reourceFull TCODE\n");
+	// drop our place in the store so chunks we have not read yet can be freed. The chunks are released
+	// after the lock is dropped, since freeing a long chain of them can take a while
 
-			return TraceDqrProfiler::DQERR_ERR;
-		}
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-		tmp_i_cnt = nm->indirectHistory.i_cnt;
-		tmp_history = nm->indirectHistory.history;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-		tmp_i_cnt = nm->indirectHistoryWS.i_cnt;
-		tmp_history = nm->indirectHistoryWS.history;
-		break;
-	case TraceDqrProfiler::TCODE_CORRELATION:
-		tmp_i_cnt = nm->correlation.i_cnt;
-		if (nm->correlation.cdf == 1) {
-			tmp_history = nm->correlation.history;
-		}
-		break;
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-	default:
-		printf("Error: Count::setCount(): invalid or unsupported TCODE\n");
+	std::shared_ptr<TraceChunk> c;
 
-		return TraceDqrProfiler::DQERR_ERR;
+	{
+		std::lock_guard<std::mutex> lock(store->storeMutex);
+
+		closed = true;
+		c = std::move(chunk);
 	}
 
-	prev_i_cnt = tmp_i_cnt;
-	if (tmp_i_cnt != 0) {
-		rc = setICnt(nm->coreId, tmp_i_cnt);
-		if (rc != TraceDqrProfiler::DQERR_OK) {
-			return rc;
-		}
+	store->dataAvailable.notify_all();
+
+	offset = 0;
+}
+
+TraceDqrProfiler::DQErr TraceChunkCursor::getSpan(const uint8_t*& span, uint64_t& len)
+{
+	if (store == nullptr) {
+		return TraceDqrProfiler::DQERR_EOF;
 	}
 
-	prev_history = tmp_history;
-	if (tmp_history != 0) {
-		rc = setHistory(nm->coreId, tmp_history);
-		if (rc != TraceDqrProfiler::DQERR_OK) {
-			return rc;
-		}
+	std::shared_ptr<TraceChunk> prevChunk;
+	std::unique_lock<std::mutex> lock(store->storeMutex);
+
+	if (closed || (chunk == nullptr)) {
+		return TraceDqrProfiler::DQERR_EOF;
 	}
 
-	prev_taken = tmp_taken;
-	if (tmp_taken != 0) {
-		rc = setTakenCount(nm->coreId, tmp_taken);
-		if (rc != TraceDqrProfiler::DQERR_OK) {
-			return rc;
+	if (offset >= chunk->size) {
+		store->dataAvailable.wait(lock, [this] { return closed || (chunk->next != nullptr) || endOfData; });
+
+		if (closed || (chunk->next == nullptr)) {
+			return TraceDqrProfiler::DQERR_EOF;
 		}
+
+		// moving on releases the chunk we were on; it is freed once every cursor is past it, after the
+		// lock is dropped
+
+		prevChunk = std::move(chunk);
+		chunk = prevChunk->next;
+		offset = 0;
 	}
 
-	prev_notTaken = tmp_notTaken;
-	if (tmp_notTaken != 0) {
-		rc = setNotTakenCount(nm->coreId, tmp_notTaken);
-		if (rc != TraceDqrProfiler::DQERR_OK) {
-			return rc;
+	span = &chunk->data[offset];
+	len = chunk->size - offset;
+
+	lock.unlock();
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+// Bulk scan of a block of slices for message ends (slices with MSEO bits == MSEO_END). Stores pointers to
+// up to maxEnds ends and returns how many were found. scanned is set to the number of bytes examined,
+// which is less than len only if ends filled up
+
+static int scanMseoEndsScalar(const uint8_t* p, uint64_t len, const uint8_t** ends, int maxEnds, uint64_t& scanned)
+{
+	int n = 0;
+
+	for (uint64_t i = 0; i < len; i++) {
+		if ((p[i] & 0x03) == TraceDqrProfiler::MSEO_END) {
+			ends[n] = &p[i];
+			n += 1;
+
+			if (n >= maxEnds) {
+				scanned = i + 1;
+				return n;
+			}
 		}
 	}
 
-	return TraceDqrProfiler::DQERR_OK;
+	scanned = len;
+
+	return n;
 }
 
-int Count::consumeICnt(int core, int numToConsume)
+#ifdef MSEO_SCAN_SSE2
+static inline int mseoScanCtz(uint32_t bits)
 {
-	i_cnt[core] -= numToConsume;
+#ifdef _MSC_VER
+	unsigned long b;
 
-	return i_cnt[core];
+	_BitScanForward(&b, bits);
+
+	return (int)b;
+#else // _MSC_VER
+	return __builtin_ctz(bits);
+#endif // _MSC_VER
 }
 
-int Count::consumeHistory(int core, bool& taken)
+static int scanMseoEndsSSE2(const uint8_t* p, uint64_t len, const uint8_t** ends, int maxEnds, uint64_t& scanned)
 {
-	if (histBit[core] < 0) {
-		return 1;
-	}
+	const __m128i mseo = _mm_set1_epi8(TraceDqrProfiler::MSEO_END);
+	int n = 0;
+	uint64_t i;
 
-	taken = (history[core] & (1 << histBit[core])) != 0;
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)&p[i]);
+		uint32_t bits = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, mseo), mseo));
 
-	histBit[core] -= 1;
+		while (bits != 0) {
+			int b = mseoScanCtz(bits);
 
-	return 0;
-}
+			ends[n] = &p[i + b];
+			n += 1;
 
-int Count::consumeTakenCount(int core)
-{
-	if (takenCount[core] <= 0) {
-		return 1;
+			if (n >= maxEnds) {
+				scanned = i + b + 1;
+				return n;
+			}
+
+			bits &= bits - 1;
+		}
 	}
 
-	takenCount[core] -= 1;
+	uint64_t tail;
 
-	return 0;
+	n += scanMseoEndsScalar(&p[i], len - i, &ends[n], maxEnds - n, tail);
+	scanned = i + tail;
+
+	return n;
 }
+#endif // MSEO_SCAN_SSE2
 
-int Count::consumeNotTakenCount(int core)
+#ifdef MSEO_SCAN_AVX2
+__attribute__((target("avx2")))
+static int scanMseoEndsAVX2(const uint8_t* p, uint64_t len, const uint8_t** ends, int maxEnds, uint64_t& scanned)
 {
-	if (notTakenCount[core] <= 0) {
-		return 1;
+	const __m256i mseo = _mm256_set1_epi8(TraceDqrProfiler::MSEO_END);
+	int n = 0;
+	uint64_t i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)&p[i]);
+		uint32_t bits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(v, mseo), mseo));
+
+		while (bits != 0) {
+			int b = __builtin_ctz(bits);
+
+			ends[n] = &p[i + b];
+			n += 1;
+
+			if (n >= maxEnds) {
+				scanned = i + b + 1;
+				return n;
+			}
+
+			bits &= bits - 1;
+		}
 	}
 
-	notTakenCount[core] -= 1;
+	uint64_t tail;
 
-	return 0;
+	n += scanMseoEndsSSE2(&p[i], len - i, &ends[n], maxEnds - n, tail);
+	scanned = i + tail;
+
+	return n;
 }
+#endif // MSEO_SCAN_AVX2
 
-void Count::dumpCounts(int core)
+typedef int (*MseoScanFunc)(const uint8_t* p, uint64_t len, const uint8_t** ends, int maxEnds, uint64_t& scanned);
+
+static MseoScanFunc selectMseoScan()
 {
-	printf("Count::dumpCounts(): core: %d, i_cnt: %d, history: 0x%08llx, histBit: %d, takenCount: %d, notTakenCount: %d\n", core, i_cnt[core], history[core], histBit[core], takenCount[core], notTakenCount[core]);
+#ifdef MSEO_SCAN_AVX2
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		return scanMseoEndsAVX2;
+	}
+#endif // MSEO_SCAN_AVX2
+
+#ifdef MSEO_SCAN_SSE2
+	return scanMseoEndsSSE2;
+#else // MSEO_SCAN_SSE2
+	return scanMseoEndsScalar;
+#endif // MSEO_SCAN_SSE2
 }
 
-SliceFileParser::SliceFileParser(char* filename, int srcBits)
+static const MseoScanFunc scanMseoEnds = selectMseoScan();
+
+SliceFileParser::SliceFileParser(char* filename, int srcBits) : m_trace_ring(TRACE_RING_BUFFER_SIZE)
 {
 	//if (filename == nullptr) {
 	//	printf("Error: SliceFileParser::SliceFaileParser(): No filename specified\n");
@@ -8922,10 +12365,32 @@ SliceFileParser::SliceFileParser(char* filename, int srcBits)
 	bufferOutIndex = 0;
 
 	eom = false;
-    {
-        std::lock_guard<std::mutex> msg_eod_guard(m_end_of_data_mutex);
-        m_end_of_data = false;
-    }
+
+	m_span = nullptr;
+	m_span_len = 0;
+	m_span_idx = 0;
+
+	m_msg_ends_count = 0;
+	m_msg_ends_next = 0;
+	m_msg_scan_ptr = nullptr;
+
+	m_msg_packed = false;
+	m_field_end_slices = 0;
+	m_msg_end_slices = 0;
+
+	m_file_input = false;
+	m_map_base = nullptr;
+	m_map_size = 0;
+#ifdef WINDOWS
+	m_map_file = INVALID_HANDLE_VALUE;
+	m_map_handle = nullptr;
+#endif // WINDOWS
+
+	if (m_trace_ring.getErr() != TraceDqrProfiler::DQERR_OK) {
+		printf("Error: SliceFileParser::SliceFileParser(): could not create trace ring buffer\n");
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
+	}
 
 	int i;
 
@@ -9016,114 +12481,371 @@ SliceFileParser::SliceFileParser(char* filename, int srcBits)
 			close(SWTsock);
 #endif // WINDOWS
 
-			SWTsock = -1;
+			SWTsock = -1;
+
+			server = nullptr;
+
+			status = TraceDqrProfiler::DQERR_ERR;
+
+			return;
+		}
+
+		// put socket in non-blocking mode
+#ifdef WINDOWS
+		unsigned long on = 1L;
+		rc = ioctlsocket(SWTsock, FIONBIO, &on);
+		if (rc != NO_ERROR) {
+			printf("Error: SliceFileParser::SliceFileParser(): Failed to put socket into non-blocking mode\n");
+			status = TraceDqrProfiler::DQERR_ERR;
+			return;
+		}
+#else // WINDOWS
+//		long on = 1L;
+//		rc = ioctl(SWTsock,(int)FIONBIO,(char*)&on);
+//		if (rc < 0) {
+//			printf("Error: SliceFileParser::SliceFileParser(): Failed to put socket into non-blocking mode\n");
+//			status = TraceDqrProfiler::DQERR_ERR;
+//			return;
+//		}
+#endif // WINDOWS
+
+		tfSize = 0;
+#endif
+	}
+	else {
+		//tf.open(filename, std::ios::in | std::ios::binary);
+		//if (!tf) {
+		//	printf("Error: SliceFileParder(): could not open file %s for input\n", filename);
+		//	status = TraceDqrProfiler::DQERR_OPEN;
+		//	return;
+		//}
+		//else {
+		//	status = TraceDqrProfiler::DQERR_OK;
+		//}
+
+		//tf.seekg(0, tf.end);
+		//tfSize = tf.tellg();
+		//tf.seekg(0, tf.beg);
+
+		// the trace file is only mapped when mapTraceFile() asks for it; otherwise data is pushed as before
+
+		msgOffset = 0;
+
+		SWTsock = -1;
+	}
+
+	status = TraceDqrProfiler::DQERR_OK;
+}
+
+SliceFileParser::~SliceFileParser()
+{
+	if (tf.is_open()) {
+		tf.close();
+	}
+
+	unmapTraceFile();
+
+//	if (SWTsock >= 0) {
+//#ifdef WINDOWS
+//		closesocket(SWTsock);
+//		WSACleanup();
+//#else  // WINDOWS
+//		close(SWTsock);
+//#endif // WINDOWS
+//
+//		SWTsock = -1;
+//	}
+}
+
+TraceDqrProfiler::DQErr SliceFileParser::getNumBytesInSWTQ(int& numBytes)
+{
+	TraceDqrProfiler::DQErr rc;
+
+	//if (SWTsock < 0) {
+	//	return TraceDqrProfiler::DQERR_ERR;
+	//}
+
+	//rc = bufferSWT();
+	//if (rc != TraceDqrProfiler::DQERR_OK) {
+	//	return rc;
+	//}
+
+	//if (bufferInIndex == bufferOutIndex) {
+	//	numBytes = 0;
+	//}
+	//else if (bufferInIndex < bufferOutIndex) {
+	//	numBytes = (sizeof sockBuffer / sizeof sockBuffer[0]) - bufferOutIndex + bufferInIndex;
+	//}
+	//else { // bufferInIndex > bufferOutIndex
+	//	numBytes = bufferInIndex - bufferOutIndex;
+	//}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+TraceDqrProfiler::DQErr SliceFileParser::mapTraceFile(char* filename)
+{
+	if (filename == nullptr) {
+		printf("Error: SliceFileParser::mapTraceFile(): No trace file name specified\n");
+		return TraceDqrProfiler::DQERR_OPEN;
+	}
+
+	if (m_file_input || m_trace_cursor.isAttached()) {
+		printf("Error: SliceFileParser::mapTraceFile(): Trace input has already been set up\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	m_file_input = true;
+
+#ifdef WINDOWS
+	m_map_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_map_file == INVALID_HANDLE_VALUE) {
+		printf("Error: SliceFileParser::mapTraceFile(): could not open file %s for input\n", filename);
+		return TraceDqrProfiler::DQERR_OPEN;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (GetFileSizeEx(m_map_file, &fileSize) == 0) {
+		printf("Error: SliceFileParser::mapTraceFile(): could not get size of file %s\n", filename);
+		return TraceDqrProfiler::DQERR_OPEN;
+	}
+
+	m_map_size = (uint64_t)fileSize.QuadPart;
+
+	if (m_map_size > 0) {
+		m_map_handle = CreateFileMapping(m_map_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_map_handle == nullptr) {
+			printf("Error: SliceFileParser::mapTraceFile(): could not map file %s\n", filename);
+			return TraceDqrProfiler::DQERR_OPEN;
+		}
+
+		m_map_base = (uint8_t*)MapViewOfFile(m_map_handle, FILE_MAP_READ, 0, 0, 0);
+		if (m_map_base == nullptr) {
+			printf("Error: SliceFileParser::mapTraceFile(): could not map file %s\n", filename);
+			return TraceDqrProfiler::DQERR_OPEN;
+		}
+	}
+#else // WINDOWS
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		printf("Error: SliceFileParser::mapTraceFile(): could not open file %s for input\n", filename);
+		return TraceDqrProfiler::DQERR_OPEN;
+	}
+
+	struct stat sb;
+
+	if (fstat(fd, &sb) != 0) {
+		printf("Error: SliceFileParser::mapTraceFile(): could not get size of file %s\n", filename);
+		close(fd);
+		return TraceDqrProfiler::DQERR_OPEN;
+	}
+
+	m_map_size = (uint64_t)sb.st_size;
+
+	// an empty file can not be mapped, but is a valid (empty) trace
+
+	if (m_map_size > 0) {
+		void* p = mmap(nullptr, (size_t)m_map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			printf("Error: SliceFileParser::mapTraceFile(): could not map file %s\n", filename);
+			close(fd);
+			return TraceDqrProfiler::DQERR_OPEN;
+		}
+
+		m_map_base = (uint8_t*)p;
+
+		// the file is parsed front to back exactly once
+
+		madvise(p, (size_t)m_map_size, MADV_SEQUENTIAL);
+	}
+
+	// the mapping stays valid after the descriptor is closed
+
+	close(fd);
+#endif // WINDOWS
+
+	tfSize = m_map_size;
+
+	// the whole file is one span, so readQueuedByte() never has to wait or call out
+
+	m_span = m_map_base;
+	m_span_len = m_map_size;
+	m_span_idx = 0;
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+void SliceFileParser::unmapTraceFile()
+{
+#ifdef WINDOWS
+	if (m_map_base != nullptr) {
+		UnmapViewOfFile(m_map_base);
+	}
+
+	if (m_map_handle != nullptr) {
+		CloseHandle(m_map_handle);
+		m_map_handle = nullptr;
+	}
+
+	if (m_map_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_map_file);
+		m_map_file = INVALID_HANDLE_VALUE;
+	}
+#else // WINDOWS
+	if (m_map_base != nullptr) {
+		munmap(m_map_base, (size_t)m_map_size);
+	}
+#endif // WINDOWS
+
+	m_map_base = nullptr;
+	m_map_size = 0;
+
+	m_span = nullptr;
+	m_span_len = 0;
+	m_span_idx = 0;
+}
+
+TraceDqrProfiler::DQErr SliceFileParser::getFileOffset(uint64_t& size, uint64_t& offset)
+{
+	if (m_file_input) {
+		size = tfSize;
+		offset = prev_offset;
+
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
+	if (!tf.is_open()) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	size = tfSize;
+	offset = (uint64_t)tf.tellg();
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+TraceDqrProfiler::DQErr SliceFileParser::indexSyncPoints(std::vector<TraceSyncPoint>& syncPoints)
+{
+	// find message boundaries the same way readBinaryMsg() does, but only look at the tcode of each message
+
+	syncPoints.clear();
+
+	if (!m_file_input) {
+		printf("Error: SliceFileParser::indexSyncPoints(): trace is not a mapped file\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	const uint8_t* ends[MSEO_SCAN_MAX_ENDS];
+	int numEnds = 0;
+	int nextEnd = 0;
+
+	const uint8_t* fileEnd = &m_map_base[m_map_size];
+	const uint8_t* scanPtr = m_map_base;
+	const uint8_t* p = m_map_base;
+
+	while (p < fileEnd) {
+		// skip anything that can not start a message
+
+		const uint8_t* s = p;
+
+		while ((s < fileEnd) && ((*s == 0x00) || ((*s & 0x03) != TraceDqrProfiler::MSEO_NORMAL))) {
+			s += 1;
+		}
+
+		if (s >= fileEnd) {
+			break;
+		}
+
+		// find the first message end after the start slice
+
+		const uint8_t* e = nullptr;
+
+		while (e == nullptr) {
+			while ((nextEnd < numEnds) && (ends[nextEnd] <= s)) {
+				nextEnd += 1;
+			}
+
+			if (nextEnd < numEnds) {
+				e = ends[nextEnd];
+				break;
+			}
+
+			if (scanPtr <= s) {
+				scanPtr = s + 1;
+			}
+
+			if (scanPtr >= fileEnd) {
+				break;
+			}
 
-			server = nullptr;
+			uint64_t len = fileEnd - scanPtr;
+			uint64_t scanned;
 
-			status = TraceDqrProfiler::DQERR_ERR;
+			if (len > MSEO_SCAN_BLOCK_SIZE) {
+				len = MSEO_SCAN_BLOCK_SIZE;
+			}
 
-			return;
-		}
+			numEnds = scanMseoEnds(scanPtr, len, ends, MSEO_SCAN_MAX_ENDS, scanned);
+			nextEnd = 0;
 
-		// put socket in non-blocking mode
-#ifdef WINDOWS
-		unsigned long on = 1L;
-		rc = ioctlsocket(SWTsock, FIONBIO, &on);
-		if (rc != NO_ERROR) {
-			printf("Error: SliceFileParser::SliceFileParser(): Failed to put socket into non-blocking mode\n");
-			status = TraceDqrProfiler::DQERR_ERR;
-			return;
+			scanPtr += scanned;
 		}
-#else // WINDOWS
-//		long on = 1L;
-//		rc = ioctl(SWTsock,(int)FIONBIO,(char*)&on);
-//		if (rc < 0) {
-//			printf("Error: SliceFileParser::SliceFileParser(): Failed to put socket into non-blocking mode\n");
-//			status = TraceDqrProfiler::DQERR_ERR;
-//			return;
-//		}
-#endif // WINDOWS
 
-		tfSize = 0;
-#endif
-	}
-	else {
-		//tf.open(filename, std::ios::in | std::ios::binary);
-		//if (!tf) {
-		//	printf("Error: SliceFileParder(): could not open file %s for input\n", filename);
-		//	status = TraceDqrProfiler::DQERR_OPEN;
-		//	return;
-		//}
-		//else {
-		//	status = TraceDqrProfiler::DQERR_OK;
-		//}
+		if (e == nullptr) {
+			// last message is incomplete
 
-		//tf.seekg(0, tf.end);
-		//tfSize = tf.tellg();
-		//tf.seekg(0, tf.beg);
+			break;
+		}
 
-		msgOffset = 0;
+		switch (*s >> 2) {
+		case TraceDqrProfiler::TCODE_SYNC:
+		case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+		case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+		case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+			TraceSyncPoint sp;
 
-		SWTsock = -1;
-	}
+			sp.offset = p - m_map_base;
+			sp.endOffset = (e + 1) - m_map_base;
 
-	status = TraceDqrProfiler::DQERR_OK;
-}
+			syncPoints.push_back(sp);
+			break;
+		default:
+			break;
+		}
 
-SliceFileParser::~SliceFileParser()
-{
-	if (tf.is_open()) {
-		tf.close();
+		p = e + 1;
 	}
-	std::lock_guard<std::mutex> msg_queue_guard(m_msg_queue_mutex);
-	m_msg_queue.clear();
 
-//	if (SWTsock >= 0) {
-//#ifdef WINDOWS
-//		closesocket(SWTsock);
-//		WSACleanup();
-//#else  // WINDOWS
-//		close(SWTsock);
-//#endif // WINDOWS
-//
-//		SWTsock = -1;
-//	}
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-TraceDqrProfiler::DQErr SliceFileParser::getNumBytesInSWTQ(int& numBytes)
+TraceDqrProfiler::DQErr SliceFileParser::setInputWindow(uint64_t begin, uint64_t end)
 {
-	TraceDqrProfiler::DQErr rc;
+	// parse only [begin, end) of the mapped file. Offsets in messages are still file offsets
 
-	//if (SWTsock < 0) {
-	//	return TraceDqrProfiler::DQERR_ERR;
-	//}
+	if (!m_file_input || (begin > end) || (end > m_map_size)) {
+		printf("Error: SliceFileParser::setInputWindow(): invalid window\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-	//rc = bufferSWT();
-	//if (rc != TraceDqrProfiler::DQERR_OK) {
-	//	return rc;
-	//}
+	m_span = &m_map_base[begin];
+	m_span_len = end - begin;
+	m_span_idx = 0;
 
-	//if (bufferInIndex == bufferOutIndex) {
-	//	numBytes = 0;
-	//}
-	//else if (bufferInIndex < bufferOutIndex) {
-	//	numBytes = (sizeof sockBuffer / sizeof sockBuffer[0]) - bufferOutIndex + bufferInIndex;
-	//}
-	//else { // bufferInIndex > bufferOutIndex
-	//	numBytes = bufferInIndex - bufferOutIndex;
-	//}
+	prev_offset = begin;
 
-	return TraceDqrProfiler::DQERR_OK;
-}
+	m_msg_ends_count = 0;
+	m_msg_ends_next = 0;
+	m_msg_scan_ptr = nullptr;
 
-TraceDqrProfiler::DQErr SliceFileParser::getFileOffset(int& size, int& offset)
-{
-	if (!tf.is_open()) {
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+	pendingMsgIndex = 0;
+	msgSlices = 0;
+	bitIndex = 0;
+	eom = false;
+	m_msg_packed = false;
 
-	size = tfSize;
-	offset = tf.tellg();
+	status = TraceDqrProfiler::DQERR_OK;
 
 	return TraceDqrProfiler::DQERR_OK;
 }
@@ -10840,6 +14562,24 @@ TraceDqrProfiler::DQErr SliceFileParser::parseFixedField(int width, uint64_t* va
 		return TraceDqrProfiler::DQERR_EOM;
 	}
 
+	if (m_msg_packed && (width <= 64)) {
+		// pull the field out of the packed message bits. The eom check below looks at the slice the
+		// slice by slice code would end on: the last slice of the field, or the slice after it if a
+		// field that started mid slice ends on a slice boundary
+
+		*val = getMsgBits(bitIndex - width, width);
+
+		if (b + width > 6) {
+			i = bitIndex / 6;
+		}
+
+		if ((m_msg_end_slices >> i) & 1) {
+			eom = true;
+		}
+
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
 	if (b + width > 6) {
 		// fixed field crossed byte boundry - get the bits at msg[i]
 
@@ -10912,6 +14652,46 @@ TraceDqrProfiler::DQErr SliceFileParser::parseVarField(uint64_t* val, int* width
 		return TraceDqrProfiler::DQERR_EOM;
 	}
 
+	if (m_msg_packed) {
+		// the field ends at the first slice from i on whose MSEO bits are not MSEO_NORMAL
+
+		uint64_t ends = m_field_end_slices >> i;
+
+		if (ends == 0) {
+			// read past end of message
+
+			status = TraceDqrProfiler::DQERR_ERR;
+
+			return TraceDqrProfiler::DQERR_ERR;
+		}
+
+		int last = i;
+
+		while ((ends & 1) == 0) {
+			ends >>= 1;
+			last += 1;
+		}
+
+		w = (6 - b) + (last - i) * 6;
+
+		// fields wider than 64 bits need the overflow check below, so leave them to the slice loop
+
+		if (w <= 64) {
+			*val = getMsgBits(bitIndex, w);
+			*width = w;
+
+			if ((m_msg_end_slices >> last) & 1) {
+				eom = true;
+			}
+
+			bitIndex += w;
+
+			return TraceDqrProfiler::DQERR_OK;
+		}
+
+		w = 0;
+	}
+
 	uint64_t v;
 
 	// strip off upper and lower bits not part of field
@@ -11120,29 +14900,10 @@ TraceDqrProfiler::DQErr SliceFileParser::readBinaryMsg(bool& haveMsg)
 			}
 			else {
 
-                // If the queue is empty, wait till we receive new trace data
-                while (1)
-                {
-                    std::lock_guard<std::mutex> msg_queue_guard(m_msg_queue_mutex);
-                    {
-                        if (m_msg_queue.empty())
-                        {
-                            // If end of data flag is set, exit the loop
-                            std::lock_guard<std::mutex> end_of_data_guard(m_end_of_data_mutex);
-                            if (m_end_of_data == true)
-                                return TraceDqrProfiler::DQERR_EOF;
-                        }
-                        else
-                        {
-                            // We have some data in queue
-                            // Get the first byte
-                            msg[0] = m_msg_queue.front();
-                            m_msg_queue.pop_front();
-                            prev_offset++;
-                            break;
-                        }
-                    }
-                }
+                // Blocks until trace data is available or end of data is set
+                status = readQueuedByte(msg[0]);
+                if (status != TraceDqrProfiler::DQERR_OK)
+                    return status;
 
 
 				//tf.read((char*)&msg[0], sizeof msg[0]);
@@ -11195,98 +14956,263 @@ TraceDqrProfiler::DQErr SliceFileParser::readBinaryMsg(bool& haveMsg)
 				tf.close();
 			}
 
-			std::cout << "Error: SliceFileParser::readBinaryMsg(): msg buffer overflow" << std::endl;
+			std::cout << "Error: SliceFileParser::readBinaryMsg(): msg buffer overflow" << std::endl;
+
+			pendingMsgIndex = 0;
+
+			status = TraceDqrProfiler::DQERR_ERR;
+
+			return TraceDqrProfiler::DQERR_ERR;
+		}
+#endif
+		if (SWTsock >= 0) {
+			status = bufferSWT();
+
+			if (status != TraceDqrProfiler::DQERR_OK) {
+				return status;
+			}
+
+			if (bufferInIndex == bufferOutIndex) {
+				return status;
+			}
+
+			msg[pendingMsgIndex] = sockBuffer[bufferOutIndex];
+
+			bufferOutIndex += 1;
+			if ((size_t)bufferOutIndex >= sizeof sockBuffer) {
+				bufferOutIndex = 0;
+			}
+		}
+		else
+        {
+            // Normally the whole message is copied here using the bulk MSEO scan. Only a message that
+            // would not fit in msg[] or an empty span is read a byte at a time
+            if (copyQueuedMsgBytes(done))
+                continue;
+
+            status = readQueuedByte(msg[pendingMsgIndex]);
+            if (status != TraceDqrProfiler::DQERR_OK)
+                return status;
+
+			//tf.read((char*)&msg[pendingMsgIndex], sizeof msg[0]);
+			//if (!tf) {
+			//	if (tf.eof()) {
+			//		printf("Info: SliceFileParser::readBinaryMsg(): Last message in trace file is incomplete\n");
+			//		if (profiler_globalDebugFlag) {
+			//			printf("Debug: Raw msg:");
+			//			for (int i = 0; i < pendingMsgIndex; i++) {
+			//				printf(" %02x", msg[i]);
+			//			}
+			//			printf("\n");
+			//		}
+			//		status = TraceDqrProfiler::DQERR_EOF;
+			//	}
+			//	else {
+			//		status = TraceDqrProfiler::DQERR_ERR;
+
+			//		std::cout << "Error reading trace file\n";
+			//	}
+
+			//	tf.close();
+
+				//return status;
+			//}
+		}
+
+		if ((msg[pendingMsgIndex] & 0x03) == TraceDqrProfiler::MSEO_END) {
+			done = true;
+			msgSlices = pendingMsgIndex + 1;
+		}
+
+		pendingMsgIndex += 1;
+	}
+
+	eom = false;
+	bitIndex = 0;
+
+	haveMsg = true;
+	pendingMsgIndex = 0;
+
+	// strip the MSEO bits once so the field parsers can take whole fields at a time
+
+	packMsg();
+
+	// give the bytes of this message back to the producer
+
+	releaseQueuedBytes();
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+TraceDqrProfiler::DQErr SliceFileParser::fetchQueuedSpan()
+{
+	// a mapped trace file is a single span; when it is used up we are at the end of the file
+
+	if (m_file_input) {
+		return TraceDqrProfiler::DQERR_EOF;
+	}
+
+	// current span is used up. Release it and wait for the next contiguous run of trace data
+
+	if (m_trace_cursor.isAttached()) {
+		m_trace_cursor.release(m_span_idx);
+	}
+	else {
+		m_trace_ring.release(m_span_idx);
+	}
+
+	m_span = nullptr;
+	m_span_len = 0;
+	m_span_idx = 0;
+
+	// message ends found so far belong to the old span
+
+	m_msg_ends_count = 0;
+	m_msg_ends_next = 0;
+	m_msg_scan_ptr = nullptr;
+
+	if (m_trace_cursor.isAttached()) {
+		return m_trace_cursor.getSpan(m_span, m_span_len);
+	}
+
+	return m_trace_ring.getSpan(m_span, m_span_len);
+}
+
+void SliceFileParser::packMsg()
+{
+	m_msg_packed = false;
+
+	if ((msgSlices <= 0) || (msgSlices > 64)) {
+		return;
+	}
+
+	for (int i = 0; i < (int)(sizeof m_msg_bits / sizeof m_msg_bits[0]); i++) {
+		m_msg_bits[i] = 0;
+	}
+
+	m_field_end_slices = 0;
+	m_msg_end_slices = 0;
+
+	for (int i = 0; i < msgSlices; i++) {
+		uint64_t slice = msg[i] >> 2;
+		int pos = i * 6;
+		int sh = pos & 0x3f;
+
+		m_msg_bits[pos >> 6] |= slice << sh;
+		if (sh > 64 - 6) {
+			m_msg_bits[(pos >> 6) + 1] |= slice >> (64 - sh);
+		}
+
+		if ((msg[i] & 0x03) != TraceDqrProfiler::MSEO_NORMAL) {
+			m_field_end_slices |= ((uint64_t)1) << i;
+
+			if ((msg[i] & 0x03) == TraceDqrProfiler::MSEO_END) {
+				m_msg_end_slices |= ((uint64_t)1) << i;
+			}
+		}
+	}
+
+	m_msg_packed = true;
+}
+
+const uint8_t* SliceFileParser::findMsgEnd(const uint8_t* cur)
+{
+	// use ends left over from the last scan if there are any at or past cur
+
+	while (m_msg_ends_next < m_msg_ends_count) {
+		if (m_msg_ends[m_msg_ends_next] >= cur) {
+			return m_msg_ends[m_msg_ends_next];
+		}
+
+		m_msg_ends_next += 1;
+	}
+
+	// scan the rest of the span a block at a time. Bytes between cur and the end of the last scan
+	// are known to hold no message end
+
+	const uint8_t* spanEnd = &m_span[m_span_len];
+	const uint8_t* p = cur;
 
-			pendingMsgIndex = 0;
+	if ((m_msg_scan_ptr != nullptr) && (m_msg_scan_ptr > cur)) {
+		p = m_msg_scan_ptr;
+	}
 
-			status = TraceDqrProfiler::DQERR_ERR;
+	while (p < spanEnd) {
+		uint64_t len = spanEnd - p;
+		uint64_t scanned;
 
-			return TraceDqrProfiler::DQERR_ERR;
+		if (len > MSEO_SCAN_BLOCK_SIZE) {
+			len = MSEO_SCAN_BLOCK_SIZE;
 		}
-#endif
-		if (SWTsock >= 0) {
-			status = bufferSWT();
 
-			if (status != TraceDqrProfiler::DQERR_OK) {
-				return status;
-			}
-
-			if (bufferInIndex == bufferOutIndex) {
-				return status;
-			}
+		m_msg_ends_count = scanMseoEnds(p, len, m_msg_ends, MSEO_SCAN_MAX_ENDS, scanned);
+		m_msg_ends_next = 0;
 
-			msg[pendingMsgIndex] = sockBuffer[bufferOutIndex];
+		p += scanned;
+		m_msg_scan_ptr = p;
 
-			bufferOutIndex += 1;
-			if ((size_t)bufferOutIndex >= sizeof sockBuffer) {
-				bufferOutIndex = 0;
-			}
+		if (m_msg_ends_count > 0) {
+			return m_msg_ends[0];
 		}
-		else
-        {
-            while (1)
-            {
-                std::lock_guard<std::mutex> msg_queue_guard(m_msg_queue_mutex);
-                {
-                    if (m_msg_queue.empty())
-                    {
-                        // If end of data flag is set, exit the loop
-                        std::lock_guard<std::mutex> end_of_data_guard(m_end_of_data_mutex);
-                        if (m_end_of_data == true)
-                            return TraceDqrProfiler::DQERR_EOF;
-                    }
-                    else
-                    {
-                        // We have some data in queue
-                        // Get the first byte
-                        msg[pendingMsgIndex] = m_msg_queue.front();
-                        m_msg_queue.pop_front();
-                        prev_offset++;
-                        break;
-                    }
-                }
-            }
+	}
 
-			//tf.read((char*)&msg[pendingMsgIndex], sizeof msg[0]);
-			//if (!tf) {
-			//	if (tf.eof()) {
-			//		printf("Info: SliceFileParser::readBinaryMsg(): Last message in trace file is incomplete\n");
-			//		if (profiler_globalDebugFlag) {
-			//			printf("Debug: Raw msg:");
-			//			for (int i = 0; i < pendingMsgIndex; i++) {
-			//				printf(" %02x", msg[i]);
-			//			}
-			//			printf("\n");
-			//		}
-			//		status = TraceDqrProfiler::DQERR_EOF;
-			//	}
-			//	else {
-			//		status = TraceDqrProfiler::DQERR_ERR;
+	return nullptr;
+}
 
-			//		std::cout << "Error reading trace file\n";
-			//	}
+bool SliceFileParser::copyQueuedMsgBytes(bool& done)
+{
+	// copy the rest of the message (or the rest of the span if the message continues in the next
+	// one) in one go. Returns false if nothing was copied so the caller can go a byte at a time
 
-			//	tf.close();
+	if (m_span_idx >= m_span_len) {
+		return false;
+	}
 
-				//return status;
-			//}
-		}
+	const uint8_t* cur = &m_span[m_span_idx];
+	const uint8_t* end = findMsgEnd(cur);
+	uint64_t n;
 
-		if ((msg[pendingMsgIndex] & 0x03) == TraceDqrProfiler::MSEO_END) {
-			done = true;
-			msgSlices = pendingMsgIndex + 1;
-		}
+	if (end != nullptr) {
+		n = (end - cur) + 1;
+	}
+	else {
+		n = m_span_len - m_span_idx;
+	}
 
-		pendingMsgIndex += 1;
+	if ((pendingMsgIndex + n) > sizeof msg) {
+		return false;
 	}
 
-	eom = false;
-	bitIndex = 0;
+	memcpy(&msg[pendingMsgIndex], cur, n);
 
-	haveMsg = true;
-	pendingMsgIndex = 0;
+	m_span_idx += n;
+	prev_offset += n;
+	pendingMsgIndex += (int)n;
 
-	return TraceDqrProfiler::DQERR_OK;
+	if (end != nullptr) {
+		done = true;
+		msgSlices = pendingMsgIndex;
+	}
+
+	return true;
+}
+
+void SliceFileParser::releaseQueuedBytes()
+{
+	if (m_span_idx == 0) {
+		return;
+	}
+
+	if (m_trace_cursor.isAttached()) {
+		m_trace_cursor.release(m_span_idx);
+	}
+	else if (!m_file_input) {
+		m_trace_ring.release(m_span_idx);
+	}
+
+	m_span += m_span_idx;
+	m_span_len -= m_span_idx;
+	m_span_idx = 0;
 }
 
 TraceDqrProfiler::DQErr SliceFileParser::readNextByte(uint8_t* byte)
@@ -11636,7 +15562,7 @@ ProfilerObjFile::ProfilerObjFile(char* ef_name, const char* odExe)
 	int archSize;
 	archSize = elfReader->getArchSize();
 
-	disassembler = new (std::nothrow) Disassembler(symtab, sections, archSize);
+	disassembler = new (std::nothrow) Disassembler(symtab, sections, archSize, elfReader->getSectionIndex());
 
 	if (disassembler == nullptr) {
 		delete elfReader;
@@ -11718,245 +15644,696 @@ TraceDqrProfiler::DQErr ProfilerObjFile::subSrcPath(const char* cutPath, const c
 		int l = strlen(newRoot) + 1;
 		this->newRoot = new char[l];
 
-		strcpy(this->newRoot, newRoot);
+		strcpy(this->newRoot, newRoot);
+	}
+
+	if (disassembler != nullptr) {
+		TraceDqrProfiler::DQErr rc;
+
+		rc = disassembler->subSrcPath(cutPath, newRoot);
+
+		status = rc;
+		return rc;
+	}
+
+	return TraceDqrProfiler::DQERR_ERR;
+}
+
+TraceDqrProfiler::DQErr ProfilerObjFile::sourceInfo(TraceDqrProfiler::ADDRESS addr, ProfilerInstruction& instInfo, ProfilerSource& srcInfo)
+{
+	TraceDqrProfiler::DQErr s;
+
+	if (disassembler == nullptr) {
+		printf("Error: ProfilerObjFile::sourceInfo(): Disassembler object null\n");
+		status = TraceDqrProfiler::DQERR_ERR;
+		return status;
+	}
+
+	s = disassembler->disassemble(addr);
+	if (s != TraceDqrProfiler::DQERR_OK) {
+		status = s;
+		return s;
+	}
+
+	//	instructionInfo = disassembler->getInstructionInfo();
+	srcInfo = disassembler->getSourceInfo();
+	instInfo = disassembler->getInstructionInfo();
+
+	// this is asking for the text, so look it up
+
+	const char* instText;
+
+	s = disassembler->getInstructionText(addr, instText, instInfo.addressLabel, instInfo.addressLabelOffset);
+	if (s == TraceDqrProfiler::DQERR_OK) {
+		instInfo.instructionText = (char*)instText;
+
+		s = disassembler->getSourceInfo(addr, srcInfo);
+	}
+
+	if (s != TraceDqrProfiler::DQERR_OK) {
+		status = s;
+		return s;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+TraceDqrProfiler::DQErr ProfilerObjFile::setPathType(TraceDqrProfiler::pathType pt)
+{
+	if (disassembler != nullptr) {
+		disassembler->setPathType(pt);
+
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
+	return TraceDqrProfiler::DQERR_ERR;
+}
+
+TraceDqrProfiler::DQErr ProfilerObjFile::parseNLSStrings(TraceDqrProfiler::nlStrings(&nlsStrings)[32])
+{
+	if (elfReader == nullptr) {
+		status = TraceDqrProfiler::DQERR_ERR;
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	return elfReader->parseNLSStrings(nlsStrings);
+}
+
+TraceDqrProfiler::DQErr ProfilerObjFile::dumpSyms()
+{
+	if (elfReader == nullptr) {
+		printf("elfReader is null\n");
+
+		status = TraceDqrProfiler::DQERR_ERR;
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	return elfReader->dumpSyms();
+}
+
+Disassembler::Disassembler(Symtab* stp, Section* sp, int archsize, SectionIndex* sip)
+{
+	status = TraceDqrProfiler::DQERR_OK;
+
+	if (stp == nullptr) {
+		printf("Error: Disassembler::Disassembler(): stp argument is null\n");
+
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
+	}
+
+	if (sp == nullptr) {
+		printf("Error: Disassembler::Disassembler(): sp argument is null\n");
+
+		status = TraceDqrProfiler::DQERR_ERR;
+		return;
+	}
+
+	archSize = archsize;
+
+	pType = TraceDqrProfiler::PATH_TO_UNIX;
+
+	cachedAddr = 0;
+	cachedSecPtr = nullptr;
+	cachedIndex = -1;
+
+	symtab = stp;
+	sectionLst = sp;
+	sectionIndex = sip;
+
+	fileReader = new class fileReader();
+
+	status = TraceDqrProfiler::DQERR_OK;
+}
+
+Disassembler::~Disassembler()
+{
+	// the following three pointers point to objects owned by the elfReader object, and the
+	// elfReader object will delete.
+
+	sectionLst = nullptr;
+	sectionIndex = nullptr;
+	symtab = nullptr;
+	cachedSecPtr = nullptr;
+
+	if (fileReader != nullptr) {
+		delete fileReader;
+		fileReader = nullptr;
+	}
+}
+
+TraceDqrProfiler::DQErr Disassembler::setPathType(TraceDqrProfiler::pathType pt)
+{
+	TraceDqrProfiler::DQErr rc;
+	rc = TraceDqrProfiler::DQERR_OK;
+
+	switch (pt) {
+	case TraceDqrProfiler::PATH_TO_WINDOWS:
+		pType = TraceDqrProfiler::PATH_TO_WINDOWS;
+		break;
+	case TraceDqrProfiler::PATH_TO_UNIX:
+		pType = TraceDqrProfiler::PATH_TO_UNIX;
+		break;
+	case TraceDqrProfiler::PATH_RAW:
+		pType = TraceDqrProfiler::PATH_RAW;
+		break;
+	default:
+		pType = TraceDqrProfiler::PATH_TO_UNIX;
+		rc = TraceDqrProfiler::DQERR_ERR;
+		break;
+	}
+
+	// source files may now be found somewhere else
+
+	resolved.clear();
+
+	return rc;
+}
+
+TraceDqrProfiler::DQErr Disassembler::subSrcPath(const char* cutPath, const char* newRoot)
+{
+	resolved.clear();
+
+	if (fileReader != nullptr) {
+		TraceDqrProfiler::DQErr rc;
+
+		rc = fileReader->subSrcPath(cutPath, newRoot);
+
+		status = rc;
+		return rc;
+	}
+
+	return TraceDqrProfiler::DQERR_ERR;
+}
+
+TraceDqrProfiler::DQErr Disassembler::lookupInstructionByAddress(TraceDqrProfiler::ADDRESS addr, uint32_t& ins, int& insSize)
+{
+	uint32_t inst;
+	int size;
+	TraceDqrProfiler::DQErr rc;
+
+	// need to support multiple code sections and do some error checking on the address!
+
+	if (sectionLst == nullptr) {
+		status = TraceDqrProfiler::DQERR_ERR;
+
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	if (disassembler != nullptr) {
+	if (addr != cachedAddr) {
 		TraceDqrProfiler::DQErr rc;
 
-		rc = disassembler->subSrcPath(cutPath, newRoot);
-
-		status = rc;
-		return rc;
+		rc = cacheSrcInfo(addr);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return TraceDqrProfiler::DQERR_ERR;;
+		}
 	}
 
-	return TraceDqrProfiler::DQERR_ERR;
-}
-
-TraceDqrProfiler::DQErr ProfilerObjFile::sourceInfo(TraceDqrProfiler::ADDRESS addr, ProfilerInstruction& instInfo, ProfilerSource& srcInfo)
-{
-	TraceDqrProfiler::DQErr s;
 
-	if (disassembler == nullptr) {
-		printf("Error: ProfilerObjFile::sourceInfo(): Disassembler object null\n");
+	if (cachedSecPtr == nullptr) {
 		status = TraceDqrProfiler::DQERR_ERR;
-		return status;
+
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	s = disassembler->disassemble(addr);
-	if (s != TraceDqrProfiler::DQERR_OK) {
-		status = s;
-		return s;
+	inst = (uint32_t)cachedSecPtr->code[cachedIndex];
+
+	rc = decodeInstructionSize(inst, size);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = TraceDqrProfiler::DQERR_ERR;
+
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	//	instructionInfo = disassembler->getInstructionInfo();
-	srcInfo = disassembler->getSourceInfo();
-	instInfo = disassembler->getInstructionInfo();
+	insSize = size;
+
+	if (size == 16) {
+		ins = inst;
+	}
+	else {
+		ins = (((uint32_t)cachedSecPtr->code[cachedIndex + 1]) << 16) | inst;
+	}
 
 	return TraceDqrProfiler::DQERR_OK;
 }
 
-TraceDqrProfiler::DQErr ProfilerObjFile::setPathType(TraceDqrProfiler::pathType pt)
+TraceDqrProfiler::DQErr Disassembler::decodeInstructionSize(uint32_t inst, int& inst_size)
 {
-	if (disassembler != nullptr) {
-		disassembler->setPathType(pt);
+	switch (inst & 0x0003) {
+	case 0x0000:	// quadrant 0, compressed
+		inst_size = 16;
+		return TraceDqrProfiler::DQERR_OK;
+	case 0x0001:	// quadrant 1, compressed
+		inst_size = 16;
+		return TraceDqrProfiler::DQERR_OK;
+	case 0x0002:	// quadrant 2, compressed
+		inst_size = 16;
+		return TraceDqrProfiler::DQERR_OK;
+	case 0x0003:	// not compressed. Assume RV32 for now
+		if ((inst & 0x1f) == 0x1f) {
+			fprintf(stderr, "Error: decode_instruction(): cann't decode instructions longer than 32 bits\n");
+			return TraceDqrProfiler::DQERR_ERR;
+		}
 
+		inst_size = 32;
 		return TraceDqrProfiler::DQERR_OK;
 	}
 
+	// error return
+
 	return TraceDqrProfiler::DQERR_ERR;
 }
 
-TraceDqrProfiler::DQErr ProfilerObjFile::parseNLSStrings(TraceDqrProfiler::nlStrings(&nlsStrings)[32])
+#define MOVE_BIT(bits,s,d)	(((bits)&(1<<(s)))?(1<<(d)):0)
+
+int Disassembler::decodeRV32Q0Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
 {
-	if (elfReader == nullptr) {
-		status = TraceDqrProfiler::DQERR_ERR;
-		return TraceDqrProfiler::DQERR_ERR;
+	// no branch or jump instruction in quadrant 0
+
+	inst_size = 16;
+	is_branch = false;
+	immediate = 0;
+
+	if ((instruction & 0x0003) != 0x0000) {
+		return 1;
 	}
 
-	return elfReader->parseNLSStrings(nlsStrings);
+	// we only crare about rs1 and rd for branch instructions, so just set them to unknown for now
+	rs1 = TraceDqrProfiler::REG_unknown;
+	rd = TraceDqrProfiler::REG_unknown;
+
+	inst_type = TraceDqrProfiler::INST_UNKNOWN;
+
+	return 0;
 }
 
-TraceDqrProfiler::DQErr ProfilerObjFile::dumpSyms()
+int Disassembler::decodeRV32Q1Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
 {
-	if (elfReader == nullptr) {
-		printf("elfReader is null\n");
+	// Q1 compressed instruction
 
-		status = TraceDqrProfiler::DQERR_ERR;
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+	uint32_t t;
 
-	return elfReader->dumpSyms();
-}
+	inst_size = 16;
 
-Disassembler::Disassembler(Symtab* stp, Section* sp, int archsize)
-{
-	status = TraceDqrProfiler::DQERR_OK;
+	switch (instruction >> 13) {
+	case 0x1:
+		inst_type = TraceDqrProfiler::INST_C_JAL;
+		is_branch = true;
 
-	if (stp == nullptr) {
-		printf("Error: Disassembler::Disassembler(): stp argument is null\n");
+		t = MOVE_BIT(instruction, 3, 1);
+		t |= MOVE_BIT(instruction, 4, 2);
+		t |= MOVE_BIT(instruction, 5, 3);
+		t |= MOVE_BIT(instruction, 11, 4);
+		t |= MOVE_BIT(instruction, 2, 5);
+		t |= MOVE_BIT(instruction, 7, 6);
+		t |= MOVE_BIT(instruction, 6, 7);
+		t |= MOVE_BIT(instruction, 9, 8);
+		t |= MOVE_BIT(instruction, 10, 9);
+		t |= MOVE_BIT(instruction, 8, 10);
+		t |= MOVE_BIT(instruction, 12, 11);
 
-		status = TraceDqrProfiler::DQERR_ERR;
-		return;
-	}
+		if (t & (1 << 11)) { // sign extend offset
+			t |= 0xfffff000;
+		}
 
-	if (sp == nullptr) {
-		printf("Error: Disassembler::Disassembler(): sp argument is null\n");
+		immediate = t;
 
-		status = TraceDqrProfiler::DQERR_ERR;
-		return;
-	}
+		rs1 = TraceDqrProfiler::REG_unknown;
+		rd = TraceDqrProfiler::REG_1;
+		break;
+	case 0x5:
+		inst_type = TraceDqrProfiler::INST_C_J;
+		is_branch = true;
 
-	archSize = archsize;
+		t = MOVE_BIT(instruction, 3, 1);
+		t |= MOVE_BIT(instruction, 4, 2);
+		t |= MOVE_BIT(instruction, 5, 3);
+		t |= MOVE_BIT(instruction, 11, 4);
+		t |= MOVE_BIT(instruction, 2, 5);
+		t |= MOVE_BIT(instruction, 7, 6);
+		t |= MOVE_BIT(instruction, 6, 7);
+		t |= MOVE_BIT(instruction, 9, 8);
+		t |= MOVE_BIT(instruction, 10, 9);
+		t |= MOVE_BIT(instruction, 8, 10);
+		t |= MOVE_BIT(instruction, 12, 11);
 
-	pType = TraceDqrProfiler::PATH_TO_UNIX;
+		if (t & (1 << 11)) { // sign extend offset
+			t |= 0xfffff000;
+		}
 
-	cachedAddr = 0;
-	cachedSecPtr = nullptr;
-	cachedIndex = -1;
+		rs1 = TraceDqrProfiler::REG_unknown;
+		rd = TraceDqrProfiler::REG_0;
 
-	symtab = stp;
-	sectionLst = sp;
+		immediate = t;
+		break;
+	case 0x6:
+		inst_type = TraceDqrProfiler::INST_C_BEQZ;
+		is_branch = true;
 
-	fileReader = new class fileReader();
+		t = MOVE_BIT(instruction, 3, 1);
+		t |= MOVE_BIT(instruction, 4, 2);
+		t |= MOVE_BIT(instruction, 10, 3);
+		t |= MOVE_BIT(instruction, 11, 4);
+		t |= MOVE_BIT(instruction, 2, 5);
+		t |= MOVE_BIT(instruction, 5, 6);
+		t |= MOVE_BIT(instruction, 6, 7);
+		t |= MOVE_BIT(instruction, 12, 8);
 
-	status = TraceDqrProfiler::DQERR_OK;
-}
+		if (t & (1 << 8)) { // sign extend offset
+			t |= 0xfffffe00;
+		}
 
-Disassembler::~Disassembler()
-{
-	// the following three pointers point to objects owned by the elfReader object, and the
-	// elfReader object will delete.
+		rs1 = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x03);
+		rd = TraceDqrProfiler::REG_unknown;
 
-	sectionLst = nullptr;
-	symtab = nullptr;
-	cachedSecPtr = nullptr;
+		immediate = t;
+		break;
+	case 0x7:
+		inst_type = TraceDqrProfiler::INST_C_BNEZ;
+		is_branch = true;
 
-	if (fileReader != nullptr) {
-		delete fileReader;
-		fileReader = nullptr;
+		t = MOVE_BIT(instruction, 3, 1);
+		t |= MOVE_BIT(instruction, 4, 2);
+		t |= MOVE_BIT(instruction, 10, 3);
+		t |= MOVE_BIT(instruction, 11, 4);
+		t |= MOVE_BIT(instruction, 2, 5);
+		t |= MOVE_BIT(instruction, 5, 6);
+		t |= MOVE_BIT(instruction, 6, 7);
+		t |= MOVE_BIT(instruction, 12, 8);
+
+		if (t & (1 << 8)) { // sign extend offset
+			t |= 0xfffffe00;
+		}
+
+		rs1 = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x03);
+		rd = TraceDqrProfiler::REG_unknown;
+
+		immediate = t;
+		break;
+	default:
+		rs1 = TraceDqrProfiler::REG_unknown;
+		rd = TraceDqrProfiler::REG_unknown;
+		inst_type = TraceDqrProfiler::INST_UNKNOWN;
+		immediate = 0;
+		is_branch = 0;
+		break;
 	}
+
+	return 0;
 }
 
-TraceDqrProfiler::DQErr Disassembler::setPathType(TraceDqrProfiler::pathType pt)
+int Disassembler::decodeRV32Q2Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
 {
-	TraceDqrProfiler::DQErr rc;
-	rc = TraceDqrProfiler::DQERR_OK;
+	// Q1 compressed instruction
+
+	inst_size = 16;
+
+	inst_type = TraceDqrProfiler::INST_UNKNOWN;
+	is_branch = false;
+	rs1 = TraceDqrProfiler::REG_unknown;
+	rd = TraceDqrProfiler::REG_unknown;
+
+	switch (instruction >> 13) {
+	case 0x4:
+		if (instruction & (1 << 12)) {
+			if ((instruction & 0x007c) == 0x0000) {
+				if ((instruction & 0x0f80) != 0x0000) {
+					inst_type = TraceDqrProfiler::INST_C_JALR;
+					is_branch = true;
+
+					rs1 = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x1f);
+					rd = TraceDqrProfiler::REG_1;
+					immediate = 0;
+				}
+				else {
+					inst_type = TraceDqrProfiler::INST_C_EBREAK;
+					immediate = 0;
+					is_branch = true;
+				}
+			}
+		}
+		else {
+			if ((instruction & 0x007c) == 0x0000) {
+				if ((instruction & 0x0f80) != 0x0000) {
+					inst_type = TraceDqrProfiler::INST_C_JR;
+					is_branch = true;
 
-	switch (pt) {
-	case TraceDqrProfiler::PATH_TO_WINDOWS:
-		pType = TraceDqrProfiler::PATH_TO_WINDOWS;
-		break;
-	case TraceDqrProfiler::PATH_TO_UNIX:
-		pType = TraceDqrProfiler::PATH_TO_UNIX;
-		break;
-	case TraceDqrProfiler::PATH_RAW:
-		pType = TraceDqrProfiler::PATH_RAW;
+					rs1 = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x1f);
+					rd = TraceDqrProfiler::REG_0;
+					immediate = 0;
+				}
+			}
+		}
 		break;
 	default:
-		pType = TraceDqrProfiler::PATH_TO_UNIX;
-		rc = TraceDqrProfiler::DQERR_ERR;
 		break;
 	}
 
-	return rc;
+	return 0;
 }
 
-TraceDqrProfiler::DQErr Disassembler::subSrcPath(const char* cutPath, const char* newRoot)
+int Disassembler::decodeRV32Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
 {
-	if (fileReader != nullptr) {
-		TraceDqrProfiler::DQErr rc;
-
-		rc = fileReader->subSrcPath(cutPath, newRoot);
-
-		status = rc;
-		return rc;
+	if ((instruction & 0x1f) == 0x1f) {
+		fprintf(stderr, "Error: decodeBranch(): cann't decode instructions longer than 32 bits\n");
+		return 1;
 	}
 
-	return TraceDqrProfiler::DQERR_ERR;
-}
-
-TraceDqrProfiler::DQErr Disassembler::lookupInstructionByAddress(TraceDqrProfiler::ADDRESS addr, uint32_t& ins, int& insSize)
-{
-	uint32_t inst;
-	int size;
-	TraceDqrProfiler::DQErr rc;
-
-	// need to support multiple code sections and do some error checking on the address!
+	uint32_t t;
 
-	if (sectionLst == nullptr) {
-		status = TraceDqrProfiler::DQERR_ERR;
+	inst_size = 32;
 
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+	switch (instruction & 0x7f) {
+	case 0x6f:
+		inst_type = TraceDqrProfiler::INST_JAL;
+		is_branch = true;
 
-	if (addr != cachedAddr) {
-		TraceDqrProfiler::DQErr rc;
+		t = MOVE_BIT(instruction, 21, 1);
+		t |= MOVE_BIT(instruction, 22, 2);
+		t |= MOVE_BIT(instruction, 23, 3);
+		t |= MOVE_BIT(instruction, 24, 4);
+		t |= MOVE_BIT(instruction, 25, 5);
+		t |= MOVE_BIT(instruction, 26, 6);
+		t |= MOVE_BIT(instruction, 27, 7);
+		t |= MOVE_BIT(instruction, 28, 8);
+		t |= MOVE_BIT(instruction, 29, 9);
+		t |= MOVE_BIT(instruction, 30, 10);
+		t |= MOVE_BIT(instruction, 20, 11);
+		t |= MOVE_BIT(instruction, 12, 12);
+		t |= MOVE_BIT(instruction, 13, 13);
+		t |= MOVE_BIT(instruction, 14, 14);
+		t |= MOVE_BIT(instruction, 15, 15);
+		t |= MOVE_BIT(instruction, 16, 16);
+		t |= MOVE_BIT(instruction, 17, 17);
+		t |= MOVE_BIT(instruction, 18, 18);
+		t |= MOVE_BIT(instruction, 19, 19);
+		t |= MOVE_BIT(instruction, 31, 20);
 
-		rc = cacheSrcInfo(addr);
-		if (rc != TraceDqrProfiler::DQERR_OK) {
-			return TraceDqrProfiler::DQERR_ERR;;
+		if (t & (1 << 20)) { // sign extend offset
+			t |= 0xffe00000;
 		}
-	}
 
+		immediate = t;
+		rd = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x1f);
+		rs1 = TraceDqrProfiler::REG_unknown;
+		break;
+	case 0x67:
+		if ((instruction & 0x7000) == 0x000) {
+			inst_type = TraceDqrProfiler::INST_JALR;
+			is_branch = true;
 
-	if (cachedSecPtr == nullptr) {
-		status = TraceDqrProfiler::DQERR_ERR;
+			t = instruction >> 20;
 
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+			if (t & (1 << 11)) { // sign extend offset
+				t |= 0xfffff000;
+			}
 
-	inst = (uint32_t)cachedSecPtr->code[cachedIndex];
+			immediate = t;
+			rd = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x1f);
+			rs1 = (TraceDqrProfiler::Reg)((instruction >> 15) & 0x1f);
+		}
+		else {
+			inst_type = TraceDqrProfiler::INST_UNKNOWN;
+			immediate = 0;
+			rd = TraceDqrProfiler::REG_unknown;
+			rs1 = TraceDqrProfiler::REG_unknown;
+			is_branch = false;
+		}
+		break;
+	case 0x63:
+		switch ((instruction >> 12) & 0x7) {
+		case 0x0:
+			inst_type = TraceDqrProfiler::INST_BEQ;
+			break;
+		case 0x1:
+			inst_type = TraceDqrProfiler::INST_BNE;
+			break;
+		case 0x4:
+			inst_type = TraceDqrProfiler::INST_BLT;
+			break;
+		case 0x5:
+			inst_type = TraceDqrProfiler::INST_BGE;
+			break;
+		case 0x6:
+			inst_type = TraceDqrProfiler::INST_BLTU;
+			break;
+		case 0x7:
+			inst_type = TraceDqrProfiler::INST_BGEU;
+			break;
+		default:
+			inst_type = TraceDqrProfiler::INST_UNKNOWN;
+			immediate = 0;
+			rd = TraceDqrProfiler::REG_unknown;
+			rs1 = TraceDqrProfiler::REG_unknown;
+			is_branch = false;
+			return 0;
+		}
 
-	rc = decodeInstructionSize(inst, size);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		status = TraceDqrProfiler::DQERR_ERR;
+		is_branch = true;
 
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+		t = MOVE_BIT(instruction, 8, 1);
+		t |= MOVE_BIT(instruction, 9, 2);
+		t |= MOVE_BIT(instruction, 10, 3);
+		t |= MOVE_BIT(instruction, 11, 4);
+		t |= MOVE_BIT(instruction, 25, 5);
+		t |= MOVE_BIT(instruction, 26, 6);
+		t |= MOVE_BIT(instruction, 27, 7);
+		t |= MOVE_BIT(instruction, 28, 8);
+		t |= MOVE_BIT(instruction, 29, 9);
+		t |= MOVE_BIT(instruction, 30, 10);
+		t |= MOVE_BIT(instruction, 7, 11);
+		t |= MOVE_BIT(instruction, 31, 12);
 
-	insSize = size;
+		if (t & (1 << 12)) { // sign extend offset
+			t |= 0xffffe000;
+		}
 
-	if (size == 16) {
-		ins = inst;
-	}
-	else {
-		ins = (((uint32_t)cachedSecPtr->code[cachedIndex + 1]) << 16) | inst;
-	}
+		immediate = t;
+		rd = TraceDqrProfiler::REG_unknown;
+		rs1 = (TraceDqrProfiler::Reg)((instruction >> 15) & 0x1f);
+		break;
+	case 0x73:
+		if (instruction == 0x00200073) {
+			inst_type = TraceDqrProfiler::INST_URET;
+			is_branch = true;
+			immediate = 0;
+		}
+		else if (instruction == 0x10200073) {
+			inst_type = TraceDqrProfiler::INST_SRET;
+			is_branch = true;
+			immediate = 0;
+		}
+		else if (instruction == 0x30200073) {
+			inst_type = TraceDqrProfiler::INST_MRET;
+			is_branch = true;
+			immediate = 0;
+		}
+		else if (instruction == 0x00000073) {
+			inst_type = TraceDqrProfiler::INST_ECALL;
+			immediate = 0;
+			is_branch = true;
+		}
+		else if (instruction == 0x00100073) {
+			inst_type = TraceDqrProfiler::INST_EBREAK;
+			immediate = 0;
+			is_branch = true;
+		}
+		else {
+			inst_type = TraceDqrProfiler::INST_UNKNOWN;
+			immediate = 0;
+			rd = TraceDqrProfiler::REG_unknown;
+			rs1 = TraceDqrProfiler::REG_unknown;
+			is_branch = false;
+		}
+		break;
+	case 0x07: // vector load
+		// Need to check width encoding field to distinguish between vector and normal FP loads (bits 12-14)
+		switch ((instruction >> 12) & 0x07) {
+		case 0x00:
+		case 0x05:
+		case 0x06:
+		case 0x07:
+			inst_type = TraceDqrProfiler::INST_VECT_LOAD;
+			break;
+		default:
+			inst_type = TraceDqrProfiler::INST_UNKNOWN;
+			break;
+		}
 
-	return TraceDqrProfiler::DQERR_OK;
-}
+		is_branch = false;
+		immediate = 0;
+		rd = TraceDqrProfiler::REG_unknown;
+		rs1 = TraceDqrProfiler::REG_unknown;
+		break;
+	case 0x27: // vector store
+		// Need to check width encoding field to distinguish between vector and normal FP stores (bits 12-14)
+		switch ((instruction >> 12) & 0x07) {
+		case 0x00:
+		case 0x05:
+		case 0x06:
+		case 0x07:
+			inst_type = TraceDqrProfiler::INST_VECT_STORE;
+			break;
+		default:
+			inst_type = TraceDqrProfiler::INST_UNKNOWN;
+			break;
+		}
+
+		is_branch = false;
+		immediate = 0;
+		rd = TraceDqrProfiler::REG_unknown;
+		rs1 = TraceDqrProfiler::REG_unknown;
+		break;
+	case 0x2f: // vector AMO
+		// Need to check width encoding field to distinguish between vector and normal AMO (bits 26-28)
+		switch ((instruction >> 12) & 0x07) {
+		case 0x00:
+		case 0x05:
+		case 0x06:
+		case 0x07:
+			if ((instruction >> 26) & 0x01) {
+				inst_type = TraceDqrProfiler::INST_VECT_AMO_WW;
+			}
+			else {
+				inst_type = TraceDqrProfiler::INST_VECT_AMO;
+			}
+			break;
+		default:
+			inst_type = TraceDqrProfiler::INST_UNKNOWN;
+			break;
+		}
 
-TraceDqrProfiler::DQErr Disassembler::decodeInstructionSize(uint32_t inst, int& inst_size)
-{
-	switch (inst & 0x0003) {
-	case 0x0000:	// quadrant 0, compressed
-		inst_size = 16;
-		return TraceDqrProfiler::DQERR_OK;
-	case 0x0001:	// quadrant 1, compressed
-		inst_size = 16;
-		return TraceDqrProfiler::DQERR_OK;
-	case 0x0002:	// quadrant 2, compressed
-		inst_size = 16;
-		return TraceDqrProfiler::DQERR_OK;
-	case 0x0003:	// not compressed. Assume RV32 for now
-		if ((inst & 0x1f) == 0x1f) {
-			fprintf(stderr, "Error: decode_instruction(): cann't decode instructions longer than 32 bits\n");
-			return TraceDqrProfiler::DQERR_ERR;
+		is_branch = false;
+		immediate = 0;
+		rd = TraceDqrProfiler::REG_unknown;
+		rs1 = TraceDqrProfiler::REG_unknown;
+		break;
+	case 0x57: // vector arith or vector config
+		if (((instruction >> 12) & 0x7) <= 6) {
+			inst_type = TraceDqrProfiler::INST_VECT_ARITH;
+		}
+		else {
+			inst_type = TraceDqrProfiler::INST_VECT_CONFIG;
 		}
 
-		inst_size = 32;
-		return TraceDqrProfiler::DQERR_OK;
+		immediate = 0;
+		rd = TraceDqrProfiler::REG_unknown;
+		rs1 = TraceDqrProfiler::REG_unknown;
+		is_branch = false;
+		break;
+	default:
+		inst_type = TraceDqrProfiler::INST_UNKNOWN;
+		immediate = 0;
+		rd = TraceDqrProfiler::REG_unknown;
+		rs1 = TraceDqrProfiler::REG_unknown;
+		is_branch = false;
+		break;
 	}
 
-	// error return
-
-	return TraceDqrProfiler::DQERR_ERR;
+	return 0;
 }
 
-#define MOVE_BIT(bits,s,d)	(((bits)&(1<<(s)))?(1<<(d)):0)
-
-int Disassembler::decodeRV32Q0Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
+int Disassembler::decodeRV64Q0Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
 {
 	// no branch or jump instruction in quadrant 0
 
@@ -11977,7 +16354,7 @@ int Disassembler::decodeRV32Q0Instruction(uint32_t instruction, int& inst_size,
 	return 0;
 }
 
-int Disassembler::decodeRV32Q1Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
+int Disassembler::decodeRV64Q1Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
 {
 	// Q1 compressed instruction
 
@@ -11986,31 +16363,6 @@ int Disassembler::decodeRV32Q1Instruction(uint32_t instruction, int& inst_size,
 	inst_size = 16;
 
 	switch (instruction >> 13) {
-	case 0x1:
-		inst_type = TraceDqrProfiler::INST_C_JAL;
-		is_branch = true;
-
-		t = MOVE_BIT(instruction, 3, 1);
-		t |= MOVE_BIT(instruction, 4, 2);
-		t |= MOVE_BIT(instruction, 5, 3);
-		t |= MOVE_BIT(instruction, 11, 4);
-		t |= MOVE_BIT(instruction, 2, 5);
-		t |= MOVE_BIT(instruction, 7, 6);
-		t |= MOVE_BIT(instruction, 6, 7);
-		t |= MOVE_BIT(instruction, 9, 8);
-		t |= MOVE_BIT(instruction, 10, 9);
-		t |= MOVE_BIT(instruction, 8, 10);
-		t |= MOVE_BIT(instruction, 12, 11);
-
-		if (t & (1 << 11)) { // sign extend offset
-			t |= 0xfffff000;
-		}
-
-		immediate = t;
-
-		rs1 = TraceDqrProfiler::REG_unknown;
-		rd = TraceDqrProfiler::REG_1;
-		break;
 	case 0x5:
 		inst_type = TraceDqrProfiler::INST_C_J;
 		is_branch = true;
@@ -12092,9 +16444,9 @@ int Disassembler::decodeRV32Q1Instruction(uint32_t instruction, int& inst_size,
 	return 0;
 }
 
-int Disassembler::decodeRV32Q2Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
+int Disassembler::decodeRV64Q2Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
 {
-	// Q1 compressed instruction
+	// Q2 compressed instruction
 
 	inst_size = 16;
 
@@ -12116,7 +16468,7 @@ int Disassembler::decodeRV32Q2Instruction(uint32_t instruction, int& inst_size,
 					immediate = 0;
 				}
 				else {
-					inst_type = TraceDqrProfiler::INST_C_EBREAK;
+					inst_type = TraceDqrProfiler::INST_EBREAK;
 					immediate = 0;
 					is_branch = true;
 				}
@@ -12142,10 +16494,10 @@ int Disassembler::decodeRV32Q2Instruction(uint32_t instruction, int& inst_size,
 	return 0;
 }
 
-int Disassembler::decodeRV32Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
+int Disassembler::decodeRV64Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
 {
 	if ((instruction & 0x1f) == 0x1f) {
-		fprintf(stderr, "Error: decodeBranch(): cann't decode instructions longer than 32 bits\n");
+		fprintf(stderr, "Error: decodeRV64Instruction(): cann't decode instructions longer than 32 bits\n");
 		return 1;
 	}
 
@@ -12365,7 +16717,6 @@ int Disassembler::decodeRV32Instruction(uint32_t instruction, int& inst_size, Tr
 		else {
 			inst_type = TraceDqrProfiler::INST_VECT_CONFIG;
 		}
-
 		immediate = 0;
 		rd = TraceDqrProfiler::REG_unknown;
 		rs1 = TraceDqrProfiler::REG_unknown;
@@ -12380,810 +16731,1317 @@ int Disassembler::decodeRV32Instruction(uint32_t instruction, int& inst_size, Tr
 		break;
 	}
 
-	return 0;
+	return 0;
+}
+
+int Disassembler::decodeInstruction(uint32_t instruction, int archSize, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
+{
+	int rc;
+
+	switch (archSize) {
+	case 32:
+		switch (instruction & 0x0003) {
+		case 0x0000:	// quadrant 0, compressed
+			rc = decodeRV32Q0Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
+			break;
+		case 0x0001:	// quadrant 1, compressed
+			rc = decodeRV32Q1Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
+			break;
+		case 0x0002:	// quadrant 2, compressed
+			rc = decodeRV32Q2Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
+			break;
+		case 0x0003:	// not compressed. Assume RV32 for now
+			rc = decodeRV32Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
+			break;
+		}
+		break;
+	case 64:
+		switch (instruction & 0x0003) {
+		case 0x0000:	// quadrant 0, compressed
+			rc = decodeRV64Q0Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
+			break;
+		case 0x0001:	// quadrant 1, compressed
+			rc = decodeRV64Q1Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
+			break;
+		case 0x0002:	// quadrant 2, compressed
+			rc = decodeRV64Q2Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
+			break;
+		case 0x0003:	// not compressed. Assume RV32 for now
+			rc = decodeRV64Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
+			break;
+		}
+		break;
+	default:
+		printf("Error: (): Unknown arch size %d\n", archSize);
+
+		rc = 1;
+	}
+
+	return rc;
+}
+
+// make all path separators either '/' or '\'; also remove '/./' and /../. Remove weird double path
+// showing up on linux
+
+void sanePath(TraceDqrProfiler::pathType pt, const char* src, char* dst)
+{
+	char drive = 0;
+	int r = 0;
+	int w = 0;
+	char sep;
+
+	if (pt == TraceDqrProfiler::PATH_RAW) {
+		strcpy(dst, src);
+
+		return;
+	}
+
+	if (pt == TraceDqrProfiler::PATH_TO_WINDOWS) {
+		sep = '\\';
+	}
+	else {
+		sep = '/';
+	}
+
+	while (src[r] != 0) {
+		switch (src[r]) {
+		case ':':
+			if (w > 0) {
+				if (((dst[w - 1] >= 'a') && (dst[w - 1] <= 'z')) || ((dst[w - 1] >= 'A') && (dst[w - 1] <= 'Z'))) {
+					drive = dst[w - 1];
+					w = 0;
+					dst[w] = drive;
+					w += 1;
+				}
+			}
+
+			dst[w] = src[r];
+			w += 1;
+			r += 1;
+			break;
+		case '/':
+		case '\\':
+			if ((w > 0) && (dst[w - 1] == sep)) {
+				// skip; remove double /
+				r += 1;
+			}
+			else {
+				dst[w] = sep;
+				w += 1;
+				r += 1;
+			}
+			break;
+		case '.':
+			if ((w > 0) && (dst[w - 1] == sep)) {
+				if ((src[r + 1] == '/') || (src[r + 1] == '\\')) { // have \.\ or /./
+					r += 2;
+				}
+				else if ((src[r + 1] == '.') && ((src[r + 2] == '/') || (src[r + 2] == '\\'))) { // have \..\ or /../
+					// scan back in w until either sep or beginning of line is found
+					w -= 1;
+					while ((w > 0) && (dst[w - 1] != sep)) {
+						w -= 1;
+					}
+					r += 3;
+				}
+				else { // have a '.' in a name - just pass it on
+					dst[w] = '.';
+					w += 1;
+					r += 1;
+				}
+			}
+			else {	// might be at beginning of string. Could be a ./ or a ../; copy the . or .. if followed by a /
+				if ((w == 0) && ((src[r + 1] == '/') || (src[r + 1] == '\\'))) {
+					// have a ./ at the beginning - strip it off
+					r += 2;
+				}
+				else {
+					dst[w] = '.';
+					w += 1;
+					r += 1;
+				}
+			}
+			break;
+		default:
+			dst[w] = src[r];
+			w += 1;
+			r += 1;
+			break;
+		}
+	}
+
+	dst[w] = 0;
+}
+
+TraceDqrProfiler::DQErr Disassembler::getFunctionName(TraceDqrProfiler::ADDRESS addr, const char*& function, int& offset)
+{
+	TraceDqrProfiler::DQErr rc;
+	Sym* sym;
+
+	function = nullptr;
+	offset = 0;
+
+	rc = symtab->lookupSymbolByAddress(addr, sym);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	if (sym != nullptr) {
+		function = sym->name;
+		offset = addr - sym->address;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-int Disassembler::decodeRV64Q0Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
+TraceDqrProfiler::DQErr Disassembler::findNearestLine(TraceDqrProfiler::ADDRESS addr, const char*& file, int& line)
 {
-	// no branch or jump instruction in quadrant 0
+	if (addr == 0) {
+		file = nullptr;
+		line = 0;
 
-	inst_size = 16;
-	is_branch = false;
-	immediate = 0;
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-	if ((instruction & 0x0003) != 0x0000) {
-		return 1;
+	if (addr != cachedAddr) {
+		TraceDqrProfiler::DQErr rc;
+
+		rc = cacheSrcInfo(addr);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return TraceDqrProfiler::DQERR_ERR;
+		}
 	}
 
-	// we only crare about rs1 and rd for branch instructions, so just set them to unknown for now
-	rs1 = TraceDqrProfiler::REG_unknown;
-	rd = TraceDqrProfiler::REG_unknown;
+	const LineRange* lr = cachedSecPtr->getSrcLine(cachedIndex);
 
-	inst_type = TraceDqrProfiler::INST_UNKNOWN;
+	if (lr != nullptr) {
+		file = lr->file;
+		line = lr->line;
+	}
+	else {
+		file = nullptr;
+		line = 0;
+	}
 
-	return 0;
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-int Disassembler::decodeRV64Q1Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
+TraceDqrProfiler::DQErr Disassembler::getSrcLines(TraceDqrProfiler::ADDRESS addr, const char** filename, int* cutPathIndex, const char** functionname, unsigned int* linenumber, const char** lineptr)
 {
-	// Q1 compressed instruction
-
-	uint32_t t;
+	const char* file = nullptr;
+	const char* function = nullptr;
+	int line = 0;
+	int offset;
+	TraceDqrProfiler::DQErr rc;
 
-	inst_size = 16;
+	// need to loop through all sections with code below and try to find one that succeeds
 
-	switch (instruction >> 13) {
-	case 0x5:
-		inst_type = TraceDqrProfiler::INST_C_J;
-		is_branch = true;
+	*filename = nullptr;
+	*cutPathIndex = 0;
+	*functionname = nullptr;
+	*linenumber = 0;
+	*lineptr = nullptr;
 
-		t = MOVE_BIT(instruction, 3, 1);
-		t |= MOVE_BIT(instruction, 4, 2);
-		t |= MOVE_BIT(instruction, 5, 3);
-		t |= MOVE_BIT(instruction, 11, 4);
-		t |= MOVE_BIT(instruction, 2, 5);
-		t |= MOVE_BIT(instruction, 7, 6);
-		t |= MOVE_BIT(instruction, 6, 7);
-		t |= MOVE_BIT(instruction, 9, 8);
-		t |= MOVE_BIT(instruction, 10, 9);
-		t |= MOVE_BIT(instruction, 8, 10);
-		t |= MOVE_BIT(instruction, 12, 11);
+	rc = findNearestLine(addr, file, line);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		if (t & (1 << 11)) { // sign extend offset
-			t |= 0xfffff000;
-		}
+	if (file == nullptr) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-		rs1 = TraceDqrProfiler::REG_unknown;
-		rd = TraceDqrProfiler::REG_0;
+	*linenumber = line;
 
-		immediate = t;
-		break;
-	case 0x6:
-		inst_type = TraceDqrProfiler::INST_C_BEQZ;
-		is_branch = true;
+	rc = getFunctionName(addr, function, offset);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		t = MOVE_BIT(instruction, 3, 1);
-		t |= MOVE_BIT(instruction, 4, 2);
-		t |= MOVE_BIT(instruction, 10, 3);
-		t |= MOVE_BIT(instruction, 11, 4);
-		t |= MOVE_BIT(instruction, 2, 5);
-		t |= MOVE_BIT(instruction, 5, 6);
-		t |= MOVE_BIT(instruction, 6, 7);
-		t |= MOVE_BIT(instruction, 12, 8);
+	if (file == nullptr) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-		if (t & (1 << 8)) { // sign extend offset
-			t |= 0xfffffe00;
-		}
+	char fprime[2048];
+	char* sane;
 
-		rs1 = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x03);
-		rd = TraceDqrProfiler::REG_unknown;
+	if (strlen(file) > sizeof fprime) {
+		sane = new char[strlen(file) + 1];
+	}
+	else {
+		sane = fprime;
+	}
 
-		immediate = t;
-		break;
-	case 0x7:
-		inst_type = TraceDqrProfiler::INST_C_BNEZ;
-		is_branch = true;
+	sanePath(pType, file, sane);
 
-		t = MOVE_BIT(instruction, 3, 1);
-		t |= MOVE_BIT(instruction, 4, 2);
-		t |= MOVE_BIT(instruction, 10, 3);
-		t |= MOVE_BIT(instruction, 11, 4);
-		t |= MOVE_BIT(instruction, 2, 5);
-		t |= MOVE_BIT(instruction, 5, 6);
-		t |= MOVE_BIT(instruction, 6, 7);
-		t |= MOVE_BIT(instruction, 12, 8);
+	// the fl/filelist stuff is to get the source line text
 
-		if (t & (1 << 8)) { // sign extend offset
-			t |= 0xfffffe00;
-		}
+	struct fileReader::fileList* fl;
 
-		rs1 = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x03);
-		rd = TraceDqrProfiler::REG_unknown;
+	fl = fileReader->findFile(sane);
+	if (fl == nullptr) {
+		printf("Error: Disassembler::getSrcLines(): fileReader failed\n");
 
-		immediate = t;
-		break;
-	default:
-		rs1 = TraceDqrProfiler::REG_unknown;
-		rd = TraceDqrProfiler::REG_unknown;
-		inst_type = TraceDqrProfiler::INST_UNKNOWN;
-		immediate = 0;
-		is_branch = 0;
-		break;
+		status = TraceDqrProfiler::DQERR_ERR;
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	return 0;
-}
-
-int Disassembler::decodeRV64Q2Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
-{
-	// Q2 compressed instruction
+	*filename = fl->name;
+	*cutPathIndex = fl->cutPathIndex;
 
-	inst_size = 16;
+	// save function name and line src in function list struct so it will be saved for reuse, or later use throughout the
+	// life of the object. Won't be overwritten. This is not caching.
 
-	inst_type = TraceDqrProfiler::INST_UNKNOWN;
-	is_branch = false;
-	rs1 = TraceDqrProfiler::REG_unknown;
-	rd = TraceDqrProfiler::REG_unknown;
+	if (function != nullptr) {
+		// find the function name in fncList
 
-	switch (instruction >> 13) {
-	case 0x4:
-		if (instruction & (1 << 12)) {
-			if ((instruction & 0x007c) == 0x0000) {
-				if ((instruction & 0x0f80) != 0x0000) {
-					inst_type = TraceDqrProfiler::INST_C_JALR;
-					is_branch = true;
+		struct fileReader::funcList* funcLst;
 
-					rs1 = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x1f);
-					rd = TraceDqrProfiler::REG_1;
-					immediate = 0;
-				}
-				else {
-					inst_type = TraceDqrProfiler::INST_EBREAK;
-					immediate = 0;
-					is_branch = true;
-				}
-			}
+		for (funcLst = fl->funcs; (funcLst != nullptr) && (strcasecmp(funcLst->func, function) != 0); funcLst = funcLst->next) {
+			// empty
 		}
-		else {
-			if ((instruction & 0x007c) == 0x0000) {
-				if ((instruction & 0x0f80) != 0x0000) {
-					inst_type = TraceDqrProfiler::INST_C_JR;
-					is_branch = true;
 
-					rs1 = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x1f);
-					rd = TraceDqrProfiler::REG_0;
-					immediate = 0;
-				}
-			}
+		if (funcLst == nullptr) {
+			// add function to the list
+
+			int len = strlen(function) + 1;
+			char* fname = new char[len];
+			strcpy(fname, function);
+
+			funcLst = new fileReader::funcList;
+			funcLst->func = fname;
+			funcLst->next = fl->funcs;
+			fl->funcs = funcLst;
 		}
-		break;
-	default:
-		break;
+
+		// at this point funcLst should point to this function (if it was just added or not)
+
+		*functionname = funcLst->func;
 	}
 
-	return 0;
-}
+	*lineptr = fileReader->getLine(fl, line);
 
-int Disassembler::decodeRV64Instruction(uint32_t instruction, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
-{
-	if ((instruction & 0x1f) == 0x1f) {
-		fprintf(stderr, "Error: decodeRV64Instruction(): cann't decode instructions longer than 32 bits\n");
-		return 1;
+	if (sane != fprime) {
+		delete[] sane;
+		sane = nullptr;
 	}
 
-	uint32_t t;
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-	inst_size = 32;
+Section* Disassembler::findSection(TraceDqrProfiler::ADDRESS addr)
+{
+	if (sectionIndex != nullptr) {
+		return sectionIndex->getSectionByAddress(addr);
+	}
 
-	switch (instruction & 0x7f) {
-	case 0x6f:
-		inst_type = TraceDqrProfiler::INST_JAL;
-		is_branch = true;
+	return sectionLst->getSectionByAddress(addr);
+}
 
-		t = MOVE_BIT(instruction, 21, 1);
-		t |= MOVE_BIT(instruction, 22, 2);
-		t |= MOVE_BIT(instruction, 23, 3);
-		t |= MOVE_BIT(instruction, 24, 4);
-		t |= MOVE_BIT(instruction, 25, 5);
-		t |= MOVE_BIT(instruction, 26, 6);
-		t |= MOVE_BIT(instruction, 27, 7);
-		t |= MOVE_BIT(instruction, 28, 8);
-		t |= MOVE_BIT(instruction, 29, 9);
-		t |= MOVE_BIT(instruction, 30, 10);
-		t |= MOVE_BIT(instruction, 20, 11);
-		t |= MOVE_BIT(instruction, 12, 12);
-		t |= MOVE_BIT(instruction, 13, 13);
-		t |= MOVE_BIT(instruction, 14, 14);
-		t |= MOVE_BIT(instruction, 15, 15);
-		t |= MOVE_BIT(instruction, 16, 16);
-		t |= MOVE_BIT(instruction, 17, 17);
-		t |= MOVE_BIT(instruction, 18, 18);
-		t |= MOVE_BIT(instruction, 19, 19);
-		t |= MOVE_BIT(instruction, 31, 20);
+TraceDqrProfiler::DQErr Disassembler::getInstruction(TraceDqrProfiler::ADDRESS addr, ProfilerInstruction& instruction)
+{
+	if (sectionLst == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;;
+	}
 
-		if (t & (1 << 20)) { // sign extend offset
-			t |= 0xffe00000;
-		}
+	Section* sp = findSection(addr);
+	if (sp == nullptr || sp->code == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		immediate = t;
-		rd = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x1f);
-		rs1 = TraceDqrProfiler::REG_unknown;
-		break;
-	case 0x67:
-		if ((instruction & 0x7000) == 0x000) {
-			inst_type = TraceDqrProfiler::INST_JALR;
-			is_branch = true;
+	TraceDqrProfiler::DQErr rc;
+	int index;
 
-			t = instruction >> 20;
+	index = (addr - sp->startAddr) / 2;
 
-			if (t & (1 << 11)) { // sign extend offset
-				t |= 0xfffff000;
-			}
+	instruction.coreId = 0;
+	instruction.CRFlag = 0;
+	instruction.brFlags = 0;
+	instruction.address = addr;
 
-			immediate = t;
-			rd = (TraceDqrProfiler::Reg)((instruction >> 7) & 0x1f);
-			rs1 = (TraceDqrProfiler::Reg)((instruction >> 15) & 0x1f);
-		}
-		else {
-			inst_type = TraceDqrProfiler::INST_UNKNOWN;
-			immediate = 0;
-			rd = TraceDqrProfiler::REG_unknown;
-			rs1 = TraceDqrProfiler::REG_unknown;
-			is_branch = false;
-		}
-		break;
-	case 0x63:
-		switch ((instruction >> 12) & 0x7) {
-		case 0x0:
-			inst_type = TraceDqrProfiler::INST_BEQ;
-			break;
-		case 0x1:
-			inst_type = TraceDqrProfiler::INST_BNE;
-			break;
-		case 0x4:
-			inst_type = TraceDqrProfiler::INST_BLT;
-			break;
-		case 0x5:
-			inst_type = TraceDqrProfiler::INST_BGE;
-			break;
-		case 0x6:
-			inst_type = TraceDqrProfiler::INST_BLTU;
-			break;
-		case 0x7:
-			inst_type = TraceDqrProfiler::INST_BGEU;
-			break;
-		default:
-			inst_type = TraceDqrProfiler::INST_UNKNOWN;
-			immediate = 0;
-			rd = TraceDqrProfiler::REG_unknown;
-			rs1 = TraceDqrProfiler::REG_unknown;
-			is_branch = false;
-			return 0;
-		}
+	int size;
+	uint32_t inst = sp->code[index];
+	rc = decodeInstructionSize(inst, size);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = TraceDqrProfiler::DQERR_ERR;
 
-		is_branch = true;
+		return rc;
+	}
 
-		t = MOVE_BIT(instruction, 8, 1);
-		t |= MOVE_BIT(instruction, 9, 2);
-		t |= MOVE_BIT(instruction, 10, 3);
-		t |= MOVE_BIT(instruction, 11, 4);
-		t |= MOVE_BIT(instruction, 25, 5);
-		t |= MOVE_BIT(instruction, 26, 6);
-		t |= MOVE_BIT(instruction, 27, 7);
-		t |= MOVE_BIT(instruction, 28, 8);
-		t |= MOVE_BIT(instruction, 29, 9);
-		t |= MOVE_BIT(instruction, 30, 10);
-		t |= MOVE_BIT(instruction, 7, 11);
-		t |= MOVE_BIT(instruction, 31, 12);
+	instruction.instSize = size;
 
-		if (t & (1 << 12)) { // sign extend offset
-			t |= 0xffffe000;
-		}
+	if (size > 16) {
+		inst |= sp->code[index + 1] << 16;
+	}
 
-		immediate = t;
-		rd = TraceDqrProfiler::REG_unknown;
-		rs1 = (TraceDqrProfiler::Reg)((instruction >> 15) & 0x1f);
-		break;
-	case 0x73:
-		if (instruction == 0x00200073) {
-			inst_type = TraceDqrProfiler::INST_URET;
-			is_branch = true;
-			immediate = 0;
-		}
-		else if (instruction == 0x10200073) {
-			inst_type = TraceDqrProfiler::INST_SRET;
-			is_branch = true;
-			immediate = 0;
-		}
-		else if (instruction == 0x30200073) {
-			inst_type = TraceDqrProfiler::INST_MRET;
-			is_branch = true;
-			immediate = 0;
-		}
-		else if (instruction == 0x00000073) {
-			inst_type = TraceDqrProfiler::INST_ECALL;
-			immediate = 0;
-			is_branch = true;
-		}
-		else if (instruction == 0x00100073) {
-			inst_type = TraceDqrProfiler::INST_EBREAK;
-			immediate = 0;
-			is_branch = true;
-		}
-		else {
-			inst_type = TraceDqrProfiler::INST_UNKNOWN;
-			immediate = 0;
-			rd = TraceDqrProfiler::REG_unknown;
-			rs1 = TraceDqrProfiler::REG_unknown;
-			is_branch = false;
-		}
-		break;
-	case 0x07: // vector load
-		// Need to check width encoding field to distinguish between vector and normal FP loads (bits 12-14)
-		switch ((instruction >> 12) & 0x07) {
-		case 0x00:
-		case 0x05:
-		case 0x06:
-		case 0x07:
-			inst_type = TraceDqrProfiler::INST_VECT_LOAD;
-			break;
-		default:
-			inst_type = TraceDqrProfiler::INST_UNKNOWN;
-			break;
-		}
+	instruction.instruction = inst;
 
-		is_branch = false;
-		immediate = 0;
-		rd = TraceDqrProfiler::REG_unknown;
-		rs1 = TraceDqrProfiler::REG_unknown;
-		break;
-	case 0x27: // vector store
-		// Need to check width encoding field to distinguish between vector and normal FP stores (bits 12-14)
-		switch ((instruction >> 12) & 0x07) {
-		case 0x00:
-		case 0x05:
-		case 0x06:
-		case 0x07:
-			inst_type = TraceDqrProfiler::INST_VECT_STORE;
-			break;
-		default:
-			inst_type = TraceDqrProfiler::INST_UNKNOWN;
-			break;
-		}
+	// text and label are left for getInstructionText()
 
-		is_branch = false;
-		immediate = 0;
-		rd = TraceDqrProfiler::REG_unknown;
-		rs1 = TraceDqrProfiler::REG_unknown;
-		break;
-	case 0x2f: // vector AMO
-		// Need to check width encoding field to distinguish between vector and normal AMO (bits 26-28)
-		switch ((instruction >> 12) & 0x07) {
-		case 0x00:
-		case 0x05:
-		case 0x06:
-		case 0x07:
-			if ((instruction >> 26) & 0x01) {
-				inst_type = TraceDqrProfiler::INST_VECT_AMO_WW;
-			}
-			else {
-				inst_type = TraceDqrProfiler::INST_VECT_AMO;
-			}
-			break;
-		default:
-			inst_type = TraceDqrProfiler::INST_UNKNOWN;
-			break;
-		}
+	instruction.instructionText = nullptr;
+	instruction.addressLabel = nullptr;
+	instruction.addressLabelOffset = 0;
 
-		is_branch = false;
-		immediate = 0;
-		rd = TraceDqrProfiler::REG_unknown;
-		rs1 = TraceDqrProfiler::REG_unknown;
-		break;
-	case 0x57: // vector arith or vector config
-		if (((instruction >> 12) & 0x7) <= 6) {
-			inst_type = TraceDqrProfiler::INST_VECT_ARITH;
-		}
-		else {
-			inst_type = TraceDqrProfiler::INST_VECT_CONFIG;
-		}
-		immediate = 0;
-		rd = TraceDqrProfiler::REG_unknown;
-		rs1 = TraceDqrProfiler::REG_unknown;
-		is_branch = false;
-		break;
-	default:
-		inst_type = TraceDqrProfiler::INST_UNKNOWN;
-		immediate = 0;
-		rd = TraceDqrProfiler::REG_unknown;
-		rs1 = TraceDqrProfiler::REG_unknown;
-		is_branch = false;
-		break;
-	}
+	instruction.timestamp = 0;
 
-	return 0;
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-int Disassembler::decodeInstruction(uint32_t instruction, int archSize, int& inst_size, TraceDqrProfiler::InstType& inst_type, TraceDqrProfiler::Reg& rs1, TraceDqrProfiler::Reg& rd, int32_t& immediate, bool& is_branch)
+TraceDqrProfiler::DQErr Disassembler::disassemble(TraceDqrProfiler::ADDRESS addr)
 {
-	int rc;
+	if (sectionLst == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;;
+	}
 
-	switch (archSize) {
-	case 32:
-		switch (instruction & 0x0003) {
-		case 0x0000:	// quadrant 0, compressed
-			rc = decodeRV32Q0Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
-			break;
-		case 0x0001:	// quadrant 1, compressed
-			rc = decodeRV32Q1Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
-			break;
-		case 0x0002:	// quadrant 2, compressed
-			rc = decodeRV32Q2Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
-			break;
-		case 0x0003:	// not compressed. Assume RV32 for now
-			rc = decodeRV32Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
-			break;
-		}
-		break;
-	case 64:
-		switch (instruction & 0x0003) {
-		case 0x0000:	// quadrant 0, compressed
-			rc = decodeRV64Q0Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
-			break;
-		case 0x0001:	// quadrant 1, compressed
-			rc = decodeRV64Q1Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
-			break;
-		case 0x0002:	// quadrant 2, compressed
-			rc = decodeRV64Q2Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
-			break;
-		case 0x0003:	// not compressed. Assume RV32 for now
-			rc = decodeRV64Instruction(instruction, inst_size, inst_type, rs1, rd, immediate, is_branch);
-			break;
-		}
-		break;
-	default:
-		printf("Error: (): Unknown arch size %d\n", archSize);
+	TraceDqrProfiler::DQErr rc;
 
-		rc = 1;
+	rc = getInstruction(addr, instruction);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	return rc;
+	// source information is left for getSourceInfo()
+
+	source.sourceFile = nullptr;
+	source.cutPathIndex = 0;
+	source.sourceFunction = nullptr;
+	source.sourceLineNum = 0;
+	source.sourceLine = nullptr;
+
+	return TraceDqrProfiler::DQERR_OK;
 }
 
-// make all path separators either '/' or '\'; also remove '/./' and /../. Remove weird double path
-// showing up on linux
+Disassembler::ResolvedInfo& Disassembler::getResolved(TraceDqrProfiler::ADDRESS addr)
+{
+	std::unordered_map<TraceDqrProfiler::ADDRESS, ResolvedInfo>::iterator it = resolved.find(addr);
 
-void sanePath(TraceDqrProfiler::pathType pt, const char* src, char* dst)
+	if (it == resolved.end()) {
+		ResolvedInfo ri;
+
+		ri.haveInstText = false;
+		ri.haveSource = false;
+		ri.instructionText = nullptr;
+		ri.addressLabel = nullptr;
+		ri.addressLabelOffset = 0;
+		ri.sourceFile = nullptr;
+		ri.cutPathIndex = 0;
+		ri.sourceFunction = nullptr;
+		ri.sourceLine = nullptr;
+		ri.sourceLineNum = 0;
+
+		it = resolved.insert(std::make_pair(addr, ri)).first;
+	}
+
+	return it->second;
+}
+
+// Instruction text for elf images loaded without objdump (ElfLoader has no disassembly text). The text is
+// formatted the way GNU objdump prints RISC-V, with the same aliases, so output looks the same either way.
+// Covers RV32/RV64 I, M, A, F, D, Zicsr and C. Anything else is shown as .2byte/.4byte
+
+static const char* const rvRegName[32] = {
+	"zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+	"s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+	"a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+	"s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"
+};
+
+static const char* const rvFRegName[32] = {
+	"ft0", "ft1", "ft2", "ft3", "ft4", "ft5", "ft6", "ft7",
+	"fs0", "fs1", "fa0", "fa1", "fa2", "fa3", "fa4", "fa5",
+	"fa6", "fa7", "fs2", "fs3", "fs4", "fs5", "fs6", "fs7",
+	"fs8", "fs9", "fs10", "fs11", "ft8", "ft9", "ft10", "ft11"
+};
+
+static const char* const rvRoundingMode[8] = {
+	"rne", "rtz", "rdn", "rup", "rmm", nullptr, nullptr, nullptr
+};
+
+static const char* rvCsrName(uint32_t csr)
 {
-	char drive = 0;
-	int r = 0;
-	int w = 0;
-	char sep;
+	switch (csr) {
+	case 0x001: return "fflags";
+	case 0x002: return "frm";
+	case 0x003: return "fcsr";
+	case 0x100: return "sstatus";
+	case 0x104: return "sie";
+	case 0x105: return "stvec";
+	case 0x106: return "scounteren";
+	case 0x140: return "sscratch";
+	case 0x141: return "sepc";
+	case 0x142: return "scause";
+	case 0x143: return "stval";
+	case 0x144: return "sip";
+	case 0x180: return "satp";
+	case 0x300: return "mstatus";
+	case 0x301: return "misa";
+	case 0x302: return "medeleg";
+	case 0x303: return "mideleg";
+	case 0x304: return "mie";
+	case 0x305: return "mtvec";
+	case 0x306: return "mcounteren";
+	case 0x340: return "mscratch";
+	case 0x341: return "mepc";
+	case 0x342: return "mcause";
+	case 0x343: return "mtval";
+	case 0x344: return "mip";
+	case 0x7a0: return "tselect";
+	case 0x7a1: return "tdata1";
+	case 0x7a2: return "tdata2";
+	case 0x7b0: return "dcsr";
+	case 0x7b1: return "dpc";
+	case 0xb00: return "mcycle";
+	case 0xb02: return "minstret";
+	case 0xb80: return "mcycleh";
+	case 0xb82: return "minstreth";
+	case 0xc00: return "cycle";
+	case 0xc01: return "time";
+	case 0xc02: return "instret";
+	case 0xc80: return "cycleh";
+	case 0xc81: return "timeh";
+	case 0xc82: return "instreth";
+	case 0xf11: return "mvendorid";
+	case 0xf12: return "marchid";
+	case 0xf13: return "mimpid";
+	case 0xf14: return "mhartid";
+	}
 
-	if (pt == TraceDqrProfiler::PATH_RAW) {
-		strcpy(dst, src);
+	return nullptr;
+}
 
-		return;
+void Disassembler::formatTarget(TraceDqrProfiler::ADDRESS addr, int32_t offset, char* dst, size_t len)
+{
+	TraceDqrProfiler::ADDRESS target = addr + (int64_t)offset;
+
+	if (archSize == 32) {
+		target &= 0xffffffff;
 	}
 
-	if (pt == TraceDqrProfiler::PATH_TO_WINDOWS) {
-		sep = '\\';
+	Sym* sym = nullptr;
+
+	symtab->lookupSymbolByAddress(target, sym);
+
+	if (sym == nullptr) {
+		snprintf(dst, len, "%llx", target);
+	}
+	else if (target == sym->address) {
+		snprintf(dst, len, "%llx <%s>", target, sym->name);
 	}
 	else {
-		sep = '/';
+		snprintf(dst, len, "%llx <%s+0x%llx>", target, sym->name, target - sym->address);
 	}
+}
 
-	while (src[r] != 0) {
-		switch (src[r]) {
-		case ':':
-			if (w > 0) {
-				if (((dst[w - 1] >= 'a') && (dst[w - 1] <= 'z')) || ((dst[w - 1] >= 'A') && (dst[w - 1] <= 'Z'))) {
-					drive = dst[w - 1];
-					w = 0;
-					dst[w] = drive;
-					w += 1;
+void Disassembler::formatInstruction16(uint32_t inst, TraceDqrProfiler::ADDRESS addr, char* dst, size_t len)
+{
+	int op = inst & 0x3;
+	int funct3 = (inst >> 13) & 0x7;
+	int rd = (inst >> 7) & 0x1f;
+	int rs2 = (inst >> 2) & 0x1f;
+	int rdp = 8 + ((inst >> 2) & 0x7);	// rd' / rs2'
+	int rs1p = 8 + ((inst >> 7) & 0x7);	// rs1' / rd'
+	int32_t imm6 = ((int32_t)(((inst >> 12) & 0x1) << 31) >> 26) | ((inst >> 2) & 0x1f);
+	uint32_t shamt = (((inst >> 12) & 0x1) << 5) | ((inst >> 2) & 0x1f);
+	uint32_t uimmW = (((inst >> 10) & 0x7) << 3) | (((inst >> 6) & 0x1) << 2) | (((inst >> 5) & 0x1) << 6);
+	uint32_t uimmD = (((inst >> 10) & 0x7) << 3) | (((inst >> 5) & 0x3) << 6);
+	char target[128];
+
+	dst[0] = 0;
+
+	switch (op) {
+	case 0:
+		switch (funct3) {
+		case 0:
+			if ((inst & 0x1fe0) != 0) {
+				uint32_t nzuimm = (((inst >> 11) & 0x3) << 4) | (((inst >> 7) & 0xf) << 6) | (((inst >> 6) & 0x1) << 2) | (((inst >> 5) & 0x1) << 3);
+				snprintf(dst, len, "addi\t%s,sp,%u", rvRegName[rdp], nzuimm);
+			}
+			break;
+		case 1:
+			snprintf(dst, len, "fld\t%s,%u(%s)", rvFRegName[rdp], uimmD, rvRegName[rs1p]);
+			break;
+		case 2:
+			snprintf(dst, len, "lw\t%s,%u(%s)", rvRegName[rdp], uimmW, rvRegName[rs1p]);
+			break;
+		case 3:
+			if (archSize == 32) {
+				snprintf(dst, len, "flw\t%s,%u(%s)", rvFRegName[rdp], uimmW, rvRegName[rs1p]);
+			}
+			else {
+				snprintf(dst, len, "ld\t%s,%u(%s)", rvRegName[rdp], uimmD, rvRegName[rs1p]);
+			}
+			break;
+		case 5:
+			snprintf(dst, len, "fsd\t%s,%u(%s)", rvFRegName[rdp], uimmD, rvRegName[rs1p]);
+			break;
+		case 6:
+			snprintf(dst, len, "sw\t%s,%u(%s)", rvRegName[rdp], uimmW, rvRegName[rs1p]);
+			break;
+		case 7:
+			if (archSize == 32) {
+				snprintf(dst, len, "fsw\t%s,%u(%s)", rvFRegName[rdp], uimmW, rvRegName[rs1p]);
+			}
+			else {
+				snprintf(dst, len, "sd\t%s,%u(%s)", rvRegName[rdp], uimmD, rvRegName[rs1p]);
+			}
+			break;
+		}
+		break;
+	case 1:
+		switch (funct3) {
+		case 0:
+			if (rd == 0) {
+				snprintf(dst, len, "nop");
+			}
+			else {
+				snprintf(dst, len, "addi\t%s,%s,%d", rvRegName[rd], rvRegName[rd], imm6);
+			}
+			break;
+		case 1:
+			if (archSize == 32) {
+				int32_t imm = ((int32_t)(((inst >> 12) & 0x1) << 31) >> 20) | (((inst >> 11) & 0x1) << 4) | (((inst >> 9) & 0x3) << 8) | (((inst >> 8) & 0x1) << 10) | (((inst >> 7) & 0x1) << 6) | (((inst >> 6) & 0x1) << 7) | (((inst >> 3) & 0x7) << 1) | (((inst >> 2) & 0x1) << 5);
+				formatTarget(addr, imm, target, sizeof target);
+				snprintf(dst, len, "jal\t%s", target);
+			}
+			else if (rd != 0) {
+				if (imm6 == 0) {
+					snprintf(dst, len, "sext.w\t%s,%s", rvRegName[rd], rvRegName[rd]);
+				}
+				else {
+					snprintf(dst, len, "addiw\t%s,%s,%d", rvRegName[rd], rvRegName[rd], imm6);
+				}
+			}
+			break;
+		case 2:
+			snprintf(dst, len, "li\t%s,%d", rvRegName[rd], imm6);
+			break;
+		case 3:
+			if (rd == 2) {
+				int32_t nzimm = ((int32_t)(((inst >> 12) & 0x1) << 31) >> 22) | (((inst >> 6) & 0x1) << 4) | (((inst >> 5) & 0x1) << 6) | (((inst >> 3) & 0x3) << 7) | (((inst >> 2) & 0x1) << 5);
+				if (nzimm != 0) {
+					snprintf(dst, len, "addi\tsp,sp,%d", nzimm);
 				}
 			}
+			else if (imm6 != 0) {
+				snprintf(dst, len, "lui\t%s,0x%x", rvRegName[rd], (uint32_t)imm6 & 0xfffff);
+			}
+			break;
+		case 4:
+			switch ((inst >> 10) & 0x3) {
+			case 0:
+				snprintf(dst, len, "srli\t%s,%s,0x%x", rvRegName[rs1p], rvRegName[rs1p], shamt);
+				break;
+			case 1:
+				snprintf(dst, len, "srai\t%s,%s,0x%x", rvRegName[rs1p], rvRegName[rs1p], shamt);
+				break;
+			case 2:
+				snprintf(dst, len, "andi\t%s,%s,%d", rvRegName[rs1p], rvRegName[rs1p], imm6);
+				break;
+			case 3:
+				{
+					static const char* const arith[8] = { "sub", "xor", "or", "and", "subw", "addw", nullptr, nullptr };
+					const char* name = arith[(((inst >> 12) & 0x1) << 2) | ((inst >> 5) & 0x3)];
 
-			dst[w] = src[r];
-			w += 1;
-			r += 1;
+					if ((name != nullptr) && ((archSize == 64) || (((inst >> 12) & 0x1) == 0))) {
+						snprintf(dst, len, "%s\t%s,%s,%s", name, rvRegName[rs1p], rvRegName[rs1p], rvRegName[rdp]);
+					}
+				}
+				break;
+			}
 			break;
-		case '/':
-		case '\\':
-			if ((w > 0) && (dst[w - 1] == sep)) {
-				// skip; remove double /
-				r += 1;
+		case 5:
+			{
+				int32_t imm = ((int32_t)(((inst >> 12) & 0x1) << 31) >> 20) | (((inst >> 11) & 0x1) << 4) | (((inst >> 9) & 0x3) << 8) | (((inst >> 8) & 0x1) << 10) | (((inst >> 7) & 0x1) << 6) | (((inst >> 6) & 0x1) << 7) | (((inst >> 3) & 0x7) << 1) | (((inst >> 2) & 0x1) << 5);
+				formatTarget(addr, imm, target, sizeof target);
+				snprintf(dst, len, "j\t%s", target);
 			}
-			else {
-				dst[w] = sep;
-				w += 1;
-				r += 1;
+			break;
+		case 6:
+		case 7:
+			{
+				int32_t imm = ((int32_t)(((inst >> 12) & 0x1) << 31) >> 23) | (((inst >> 10) & 0x3) << 3) | (((inst >> 5) & 0x3) << 6) | (((inst >> 3) & 0x3) << 1) | (((inst >> 2) & 0x1) << 5);
+				formatTarget(addr, imm, target, sizeof target);
+				snprintf(dst, len, "%s\t%s,%s", (funct3 == 6) ? "beqz" : "bnez", rvRegName[rs1p], target);
 			}
 			break;
-		case '.':
-			if ((w > 0) && (dst[w - 1] == sep)) {
-				if ((src[r + 1] == '/') || (src[r + 1] == '\\')) { // have \.\ or /./
-					r += 2;
+		}
+		break;
+	case 2:
+		{
+			uint32_t lwsp = (((inst >> 12) & 0x1) << 5) | (((inst >> 4) & 0x7) << 2) | (((inst >> 2) & 0x3) << 6);
+			uint32_t ldsp = (((inst >> 12) & 0x1) << 5) | (((inst >> 5) & 0x3) << 3) | (((inst >> 2) & 0x7) << 6);
+			uint32_t swsp = (((inst >> 9) & 0xf) << 2) | (((inst >> 7) & 0x3) << 6);
+			uint32_t sdsp = (((inst >> 10) & 0x7) << 3) | (((inst >> 7) & 0x7) << 6);
+
+			switch (funct3) {
+			case 0:
+				if (rd != 0) {
+					snprintf(dst, len, "slli\t%s,%s,0x%x", rvRegName[rd], rvRegName[rd], shamt);
 				}
-				else if ((src[r + 1] == '.') && ((src[r + 2] == '/') || (src[r + 2] == '\\'))) { // have \..\ or /../
-					// scan back in w until either sep or beginning of line is found
-					w -= 1;
-					while ((w > 0) && (dst[w - 1] != sep)) {
-						w -= 1;
+				break;
+			case 1:
+				snprintf(dst, len, "fld\t%s,%u(sp)", rvFRegName[rd], ldsp);
+				break;
+			case 2:
+				if (rd != 0) {
+					snprintf(dst, len, "lw\t%s,%u(sp)", rvRegName[rd], lwsp);
+				}
+				break;
+			case 3:
+				if (archSize == 32) {
+					snprintf(dst, len, "flw\t%s,%u(sp)", rvFRegName[rd], lwsp);
+				}
+				else if (rd != 0) {
+					snprintf(dst, len, "ld\t%s,%u(sp)", rvRegName[rd], ldsp);
+				}
+				break;
+			case 4:
+				if (((inst >> 12) & 0x1) == 0) {
+					if (rs2 != 0) {
+						snprintf(dst, len, "mv\t%s,%s", rvRegName[rd], rvRegName[rs2]);
+					}
+					else if (rd == 1) {
+						snprintf(dst, len, "ret");
+					}
+					else if (rd != 0) {
+						snprintf(dst, len, "jr\t%s", rvRegName[rd]);
 					}
-					r += 3;
 				}
-				else { // have a '.' in a name - just pass it on
-					dst[w] = '.';
-					w += 1;
-					r += 1;
+				else if (rs2 != 0) {
+					snprintf(dst, len, "add\t%s,%s,%s", rvRegName[rd], rvRegName[rd], rvRegName[rs2]);
 				}
-			}
-			else {	// might be at beginning of string. Could be a ./ or a ../; copy the . or .. if followed by a /
-				if ((w == 0) && ((src[r + 1] == '/') || (src[r + 1] == '\\'))) {
-					// have a ./ at the beginning - strip it off
-					r += 2;
+				else if (rd == 0) {
+					snprintf(dst, len, "ebreak");
 				}
 				else {
-					dst[w] = '.';
-					w += 1;
-					r += 1;
+					snprintf(dst, len, "jalr\t%s", rvRegName[rd]);
+				}
+				break;
+			case 5:
+				snprintf(dst, len, "fsd\t%s,%u(sp)", rvFRegName[rs2], sdsp);
+				break;
+			case 6:
+				snprintf(dst, len, "sw\t%s,%u(sp)", rvRegName[rs2], swsp);
+				break;
+			case 7:
+				if (archSize == 32) {
+					snprintf(dst, len, "fsw\t%s,%u(sp)", rvFRegName[rs2], swsp);
+				}
+				else {
+					snprintf(dst, len, "sd\t%s,%u(sp)", rvRegName[rs2], sdsp);
 				}
+				break;
 			}
-			break;
-		default:
-			dst[w] = src[r];
-			w += 1;
-			r += 1;
-			break;
 		}
+		break;
 	}
 
-	dst[w] = 0;
-}
-
-TraceDqrProfiler::DQErr Disassembler::getFunctionName(TraceDqrProfiler::ADDRESS addr, const char*& function, int& offset)
-{
-	TraceDqrProfiler::DQErr rc;
-	Sym* sym;
-
-	function = nullptr;
-	offset = 0;
-
-	rc = symtab->lookupSymbolByAddress(addr, sym);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		return TraceDqrProfiler::DQERR_ERR;
-	}
-
-	if (sym != nullptr) {
-		function = sym->name;
-		offset = addr - sym->address;
+	if (dst[0] == 0) {
+		snprintf(dst, len, ".2byte\t0x%x", inst & 0xffff);
 	}
-
-	return TraceDqrProfiler::DQERR_OK;
 }
 
-TraceDqrProfiler::DQErr Disassembler::findNearestLine(TraceDqrProfiler::ADDRESS addr, const char*& file, int& line)
+void Disassembler::formatInstruction32(uint32_t inst, TraceDqrProfiler::ADDRESS addr, char* dst, size_t len)
 {
-	if (addr == 0) {
-		file = nullptr;
-		line = 0;
+	int opcode = inst & 0x7f;
+	int rd = (inst >> 7) & 0x1f;
+	int funct3 = (inst >> 12) & 0x7;
+	int rs1 = (inst >> 15) & 0x1f;
+	int rs2 = (inst >> 20) & 0x1f;
+	int funct7 = (inst >> 25) & 0x7f;
+	int32_t immI = (int32_t)inst >> 20;
+	int32_t immS = ((int32_t)(inst & 0xfe000000) >> 20) | ((inst >> 7) & 0x1f);
+	uint32_t shamt = (inst >> 20) & ((archSize == 64) ? 0x3f : 0x1f);
+	const char* rm = rvRoundingMode[funct3];
+	char target[128];
 
-		return TraceDqrProfiler::DQERR_OK;
-	}
+	dst[0] = 0;
 
-	if (addr != cachedAddr) {
-		TraceDqrProfiler::DQErr rc;
+	switch (opcode) {
+	case 0x03:	// loads
+		{
+			static const char* const name[8] = { "lb", "lh", "lw", "ld", "lbu", "lhu", "lwu", nullptr };
 
-		rc = cacheSrcInfo(addr);
-		if (rc != TraceDqrProfiler::DQERR_OK) {
-			return TraceDqrProfiler::DQERR_ERR;
+			if (name[funct3] != nullptr) {
+				snprintf(dst, len, "%s\t%s,%d(%s)", name[funct3], rvRegName[rd], immI, rvRegName[rs1]);
+			}
 		}
-	}
+		break;
+	case 0x07:	// fp loads
+		if ((funct3 == 2) || (funct3 == 3)) {
+			snprintf(dst, len, "%s\t%s,%d(%s)", (funct3 == 2) ? "flw" : "fld", rvFRegName[rd], immI, rvRegName[rs1]);
+		}
+		break;
+	case 0x0f:
+		if (funct3 == 1) {
+			snprintf(dst, len, "fence.i");
+		}
+		else if (funct3 == 0) {
+			uint32_t pred = (inst >> 24) & 0xf;
+			uint32_t succ = (inst >> 20) & 0xf;
 
-	file = cachedSecPtr->fName[cachedIndex];
-	line = cachedSecPtr->line[cachedIndex];
+			if ((pred == 0xf) && (succ == 0xf)) {
+				snprintf(dst, len, "fence");
+			}
+			else {
+				char p[5];
+				char s[5];
+				int pn = 0;
+				int sn = 0;
 
-	return TraceDqrProfiler::DQERR_OK;
-}
+				for (int i = 0; i < 4; i++) {
+					if (pred & (8 >> i)) {
+						p[pn++] = "iorw"[i];
+					}
+					if (succ & (8 >> i)) {
+						s[sn++] = "iorw"[i];
+					}
+				}
 
-TraceDqrProfiler::DQErr Disassembler::getSrcLines(TraceDqrProfiler::ADDRESS addr, const char** filename, int* cutPathIndex, const char** functionname, unsigned int* linenumber, const char** lineptr)
-{
-	const char* file = nullptr;
-	const char* function = nullptr;
-	int line = 0;
-	int offset;
-	TraceDqrProfiler::DQErr rc;
+				p[pn] = 0;
+				s[sn] = 0;
+
+				snprintf(dst, len, "fence\t%s,%s", p, s);
+			}
+		}
+		break;
+	case 0x13:	// op-imm
+		switch (funct3) {
+		case 0:
+			if ((rd == 0) && (rs1 == 0) && (immI == 0)) {
+				snprintf(dst, len, "nop");
+			}
+			else if (rs1 == 0) {
+				snprintf(dst, len, "li\t%s,%d", rvRegName[rd], immI);
+			}
+			else if (immI == 0) {
+				snprintf(dst, len, "mv\t%s,%s", rvRegName[rd], rvRegName[rs1]);
+			}
+			else {
+				snprintf(dst, len, "addi\t%s,%s,%d", rvRegName[rd], rvRegName[rs1], immI);
+			}
+			break;
+		case 1:
+			if ((inst >> 26) == 0) {
+				snprintf(dst, len, "slli\t%s,%s,0x%x", rvRegName[rd], rvRegName[rs1], shamt);
+			}
+			break;
+		case 2:
+			snprintf(dst, len, "slti\t%s,%s,%d", rvRegName[rd], rvRegName[rs1], immI);
+			break;
+		case 3:
+			if (immI == 1) {
+				snprintf(dst, len, "seqz\t%s,%s", rvRegName[rd], rvRegName[rs1]);
+			}
+			else {
+				snprintf(dst, len, "sltiu\t%s,%s,%d", rvRegName[rd], rvRegName[rs1], immI);
+			}
+			break;
+		case 4:
+			if (immI == -1) {
+				snprintf(dst, len, "not\t%s,%s", rvRegName[rd], rvRegName[rs1]);
+			}
+			else {
+				snprintf(dst, len, "xori\t%s,%s,%d", rvRegName[rd], rvRegName[rs1], immI);
+			}
+			break;
+		case 5:
+			if ((inst >> 26) == 0) {
+				snprintf(dst, len, "srli\t%s,%s,0x%x", rvRegName[rd], rvRegName[rs1], shamt);
+			}
+			else if ((inst >> 26) == 0x10) {
+				snprintf(dst, len, "srai\t%s,%s,0x%x", rvRegName[rd], rvRegName[rs1], shamt);
+			}
+			break;
+		case 6:
+			snprintf(dst, len, "ori\t%s,%s,%d", rvRegName[rd], rvRegName[rs1], immI);
+			break;
+		case 7:
+			snprintf(dst, len, "andi\t%s,%s,%d", rvRegName[rd], rvRegName[rs1], immI);
+			break;
+		}
+		break;
+	case 0x17:
+		snprintf(dst, len, "auipc\t%s,0x%x", rvRegName[rd], inst >> 12);
+		break;
+	case 0x1b:	// op-imm-32
+		if (archSize == 64) {
+			if (funct3 == 0) {
+				if (immI == 0) {
+					snprintf(dst, len, "sext.w\t%s,%s", rvRegName[rd], rvRegName[rs1]);
+				}
+				else {
+					snprintf(dst, len, "addiw\t%s,%s,%d", rvRegName[rd], rvRegName[rs1], immI);
+				}
+			}
+			else if ((funct3 == 1) && (funct7 == 0)) {
+				snprintf(dst, len, "slliw\t%s,%s,0x%x", rvRegName[rd], rvRegName[rs1], rs2);
+			}
+			else if ((funct3 == 5) && ((funct7 == 0) || (funct7 == 0x20))) {
+				snprintf(dst, len, "%s\t%s,%s,0x%x", (funct7 == 0) ? "srliw" : "sraiw", rvRegName[rd], rvRegName[rs1], rs2);
+			}
+		}
+		break;
+	case 0x23:	// stores
+		if (funct3 <= 3) {
+			static const char* const name[4] = { "sb", "sh", "sw", "sd" };
 
-	// need to loop through all sections with code below and try to find one that succeeds
+			snprintf(dst, len, "%s\t%s,%d(%s)", name[funct3], rvRegName[rs2], immS, rvRegName[rs1]);
+		}
+		break;
+	case 0x27:	// fp stores
+		if ((funct3 == 2) || (funct3 == 3)) {
+			snprintf(dst, len, "%s\t%s,%d(%s)", (funct3 == 2) ? "fsw" : "fsd", rvFRegName[rs2], immS, rvRegName[rs1]);
+		}
+		break;
+	case 0x2f:	// atomics
+		if ((funct3 == 2) || (funct3 == 3)) {
+			const char* name = nullptr;
+			const char* order[4] = { "", ".rl", ".aq", ".aqrl" };
+			char w = (funct3 == 2) ? 'w' : 'd';
+
+			switch (inst >> 27) {
+			case 0x00: name = "amoadd";  break;
+			case 0x01: name = "amoswap"; break;
+			case 0x02: name = "lr";      break;
+			case 0x03: name = "sc";      break;
+			case 0x04: name = "amoxor";  break;
+			case 0x08: name = "amoor";   break;
+			case 0x0c: name = "amoand";  break;
+			case 0x10: name = "amomin";  break;
+			case 0x14: name = "amomax";  break;
+			case 0x18: name = "amominu"; break;
+			case 0x1c: name = "amomaxu"; break;
+			}
+
+			if (name == nullptr) {
+				break;
+			}
 
-	*filename = nullptr;
-	*cutPathIndex = 0;
-	*functionname = nullptr;
-	*linenumber = 0;
-	*lineptr = nullptr;
+			if ((inst >> 27) == 0x02) {
+				if (rs2 == 0) {
+					snprintf(dst, len, "%s.%c%s\t%s,(%s)", name, w, order[(inst >> 25) & 0x3], rvRegName[rd], rvRegName[rs1]);
+				}
+			}
+			else {
+				snprintf(dst, len, "%s.%c%s\t%s,%s,(%s)", name, w, order[(inst >> 25) & 0x3], rvRegName[rd], rvRegName[rs2], rvRegName[rs1]);
+			}
+		}
+		break;
+	case 0x33:	// op
+	case 0x3b:	// op-32
+		{
+			static const char* const base[8] = { "add", "sll", "slt", "sltu", "xor", "srl", "or", "and" };
+			static const char* const muldiv[8] = { "mul", "mulh", "mulhsu", "mulhu", "div", "divu", "rem", "remu" };
+			const char* name = nullptr;
+			bool word = (opcode == 0x3b);
 
-	rc = findNearestLine(addr, file, line);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+			if (funct7 == 0) {
+				name = base[funct3];
+			}
+			else if (funct7 == 1) {
+				name = muldiv[funct3];
+			}
+			else if ((funct7 == 0x20) && (funct3 == 0)) {
+				name = "sub";
+			}
+			else if ((funct7 == 0x20) && (funct3 == 5)) {
+				name = "sra";
+			}
 
-	if (file == nullptr) {
-		return TraceDqrProfiler::DQERR_OK;
-	}
+			if (word) {
+				// only add, sub, sll, srl, sra, mul, div, divu, rem and remu have word forms
 
-	*linenumber = line;
+				bool valid;
 
-	rc = getFunctionName(addr, function, offset);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+				if (funct7 == 1) {
+					valid = (funct3 == 0) || (funct3 >= 4);
+				}
+				else {
+					valid = (funct3 == 0) || (funct3 == 5) || ((funct3 == 1) && (funct7 == 0));
+				}
 
-	if (file == nullptr) {
-		return TraceDqrProfiler::DQERR_OK;
-	}
+				if ((archSize != 64) || (valid == false)) {
+					name = nullptr;
+				}
+			}
 
-	char fprime[2048];
-	char* sane;
+			if (name == nullptr) {
+				break;
+			}
 
-	if (strlen(file) > sizeof fprime) {
-		sane = new char[strlen(file) + 1];
-	}
-	else {
-		sane = fprime;
-	}
+			if ((funct7 == 0x20) && (funct3 == 0) && (rs1 == 0)) {
+				snprintf(dst, len, "%s\t%s,%s", word ? "negw" : "neg", rvRegName[rd], rvRegName[rs2]);
+			}
+			else if (!word && (funct7 == 0) && (funct3 == 3) && (rs1 == 0)) {
+				snprintf(dst, len, "snez\t%s,%s", rvRegName[rd], rvRegName[rs2]);
+			}
+			else if (!word && (funct7 == 0) && (funct3 == 2) && (rs2 == 0)) {
+				snprintf(dst, len, "sltz\t%s,%s", rvRegName[rd], rvRegName[rs1]);
+			}
+			else if (!word && (funct7 == 0) && (funct3 == 2) && (rs1 == 0)) {
+				snprintf(dst, len, "sgtz\t%s,%s", rvRegName[rd], rvRegName[rs2]);
+			}
+			else {
+				snprintf(dst, len, "%s%s\t%s,%s,%s", name, word ? "w" : "", rvRegName[rd], rvRegName[rs1], rvRegName[rs2]);
+			}
+		}
+		break;
+	case 0x37:
+		snprintf(dst, len, "lui\t%s,0x%x", rvRegName[rd], inst >> 12);
+		break;
+	case 0x43:	// fused multiply add
+	case 0x47:
+	case 0x4b:
+	case 0x4f:
+		if ((funct7 & 0x3) <= 1) {
+			static const char* const name[4] = { "fmadd", "fmsub", "fnmsub", "fnmadd" };
+			int n;
 
-	sanePath(pType, file, sane);
+			n = snprintf(dst, len, "%s.%c\t%s,%s,%s,%s", name[(opcode >> 2) & 0x3], (funct7 & 0x1) ? 'd' : 's', rvFRegName[rd], rvFRegName[rs1], rvFRegName[rs2], rvFRegName[inst >> 27]);
+			if ((funct3 != 7) && (rm != nullptr) && (n > 0) && ((size_t)n < len)) {
+				snprintf(dst + n, len - n, ",%s", rm);
+			}
+		}
+		break;
+	case 0x53:	// op-fp
+		if ((funct7 & 0x3) <= 1) {
+			char fmt = (funct7 & 0x1) ? 'd' : 's';
+			const char* name = nullptr;
+			int n = 0;
 
-	// the fl/filelist stuff is to get the source line text
+			switch (funct7 >> 2) {
+			case 0x00: name = "fadd"; break;
+			case 0x01: name = "fsub"; break;
+			case 0x02: name = "fmul"; break;
+			case 0x03: name = "fdiv"; break;
+			}
 
-	struct fileReader::fileList* fl;
+			if (name != nullptr) {
+				n = snprintf(dst, len, "%s.%c\t%s,%s,%s", name, fmt, rvFRegName[rd], rvFRegName[rs1], rvFRegName[rs2]);
+			}
+			else {
+				switch (funct7 >> 2) {
+				case 0x0b:
+					if (rs2 == 0) {
+						n = snprintf(dst, len, "fsqrt.%c\t%s,%s", fmt, rvFRegName[rd], rvFRegName[rs1]);
+					}
+					break;
+				case 0x04:
+					if (funct3 <= 2) {
+						static const char* const sgnj[3] = { "fsgnj", "fsgnjn", "fsgnjx" };
+						static const char* const alias[3] = { "fmv", "fneg", "fabs" };
 
-	fl = fileReader->findFile(sane);
-	if (fl == nullptr) {
-		printf("Error: Disassembler::getSrcLines(): fileReader failed\n");
+						if (rs1 == rs2) {
+							snprintf(dst, len, "%s.%c\t%s,%s", alias[funct3], fmt, rvFRegName[rd], rvFRegName[rs1]);
+						}
+						else {
+							snprintf(dst, len, "%s.%c\t%s,%s,%s", sgnj[funct3], fmt, rvFRegName[rd], rvFRegName[rs1], rvFRegName[rs2]);
+						}
+					}
+					break;
+				case 0x05:
+					if (funct3 <= 1) {
+						snprintf(dst, len, "%s.%c\t%s,%s,%s", (funct3 == 0) ? "fmin" : "fmax", fmt, rvFRegName[rd], rvFRegName[rs1], rvFRegName[rs2]);
+					}
+					break;
+				case 0x08:
+					if ((rs2 == 0) && (fmt == 'd')) {
+						snprintf(dst, len, "fcvt.d.s\t%s,%s", rvFRegName[rd], rvFRegName[rs1]);
+					}
+					else if ((rs2 == 1) && (fmt == 's')) {
+						n = snprintf(dst, len, "fcvt.s.d\t%s,%s", rvFRegName[rd], rvFRegName[rs1]);
+					}
+					break;
+				case 0x14:
+					if (funct3 <= 2) {
+						static const char* const cmp[3] = { "fle", "flt", "feq" };
 
-		status = TraceDqrProfiler::DQERR_ERR;
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+						snprintf(dst, len, "%s.%c\t%s,%s,%s", cmp[funct3], fmt, rvRegName[rd], rvFRegName[rs1], rvFRegName[rs2]);
+					}
+					break;
+				case 0x18:
+				case 0x1a:
+					if ((rs2 <= 1) || ((archSize == 64) && (rs2 <= 3))) {
+						static const char* const itype[4] = { "w", "wu", "l", "lu" };
 
-	*filename = fl->name;
-	*cutPathIndex = fl->cutPathIndex;
+						if ((funct7 >> 2) == 0x18) {
+							n = snprintf(dst, len, "fcvt.%s.%c\t%s,%s", itype[rs2], fmt, rvRegName[rd], rvFRegName[rs1]);
+						}
+						else if ((fmt == 'd') && (rs2 <= 1)) {
+							// exact, so no rounding mode
+							snprintf(dst, len, "fcvt.d.%s\t%s,%s", itype[rs2], rvFRegName[rd], rvRegName[rs1]);
+						}
+						else {
+							n = snprintf(dst, len, "fcvt.%c.%s\t%s,%s", fmt, itype[rs2], rvFRegName[rd], rvRegName[rs1]);
+						}
+					}
+					break;
+				case 0x1c:
+					if ((rs2 == 0) && (funct3 == 0) && ((fmt == 's') || (archSize == 64))) {
+						snprintf(dst, len, "fmv.x.%c\t%s,%s", (fmt == 's') ? 'w' : 'd', rvRegName[rd], rvFRegName[rs1]);
+					}
+					else if ((rs2 == 0) && (funct3 == 1)) {
+						snprintf(dst, len, "fclass.%c\t%s,%s", fmt, rvRegName[rd], rvFRegName[rs1]);
+					}
+					break;
+				case 0x1e:
+					if ((rs2 == 0) && (funct3 == 0) && ((fmt == 's') || (archSize == 64))) {
+						snprintf(dst, len, "fmv.%c.x\t%s,%s", (fmt == 's') ? 'w' : 'd', rvFRegName[rd], rvRegName[rs1]);
+					}
+					break;
+				}
+			}
 
-	// save function name and line src in function list struct so it will be saved for reuse, or later use throughout the
-	// life of the object. Won't be overwritten. This is not caching.
+			// rounding mode is only shown when it is not dynamic
 
-	if (function != nullptr) {
-		// find the function name in fncList
+			if ((n > 0) && ((size_t)n < len) && (funct3 != 7) && (rm != nullptr)) {
+				snprintf(dst + n, len - n, ",%s", rm);
+			}
+		}
+		break;
+	case 0x63:	// branches
+		if ((funct3 != 2) && (funct3 != 3)) {
+			static const char* const name[8] = { "beq", "bne", nullptr, nullptr, "blt", "bge", "bltu", "bgeu" };
+			int32_t immB = ((int32_t)(inst & 0x80000000) >> 19) | ((inst & 0x80) << 4) | ((inst >> 20) & 0x7e0) | ((inst >> 7) & 0x1e);
 
-		struct fileReader::funcList* funcLst;
+			formatTarget(addr, immB, target, sizeof target);
 
-		for (funcLst = fl->funcs; (funcLst != nullptr) && (strcasecmp(funcLst->func, function) != 0); funcLst = funcLst->next) {
-			// empty
+			if ((rs2 == 0) && (funct3 <= 1)) {
+				snprintf(dst, len, "%s\t%s,%s", (funct3 == 0) ? "beqz" : "bnez", rvRegName[rs1], target);
+			}
+			else if ((rs2 == 0) && (funct3 == 4)) {
+				snprintf(dst, len, "bltz\t%s,%s", rvRegName[rs1], target);
+			}
+			else if ((rs2 == 0) && (funct3 == 5)) {
+				snprintf(dst, len, "bgez\t%s,%s", rvRegName[rs1], target);
+			}
+			else if ((rs1 == 0) && (funct3 == 4)) {
+				snprintf(dst, len, "bgtz\t%s,%s", rvRegName[rs2], target);
+			}
+			else if ((rs1 == 0) && (funct3 == 5)) {
+				snprintf(dst, len, "blez\t%s,%s", rvRegName[rs2], target);
+			}
+			else {
+				snprintf(dst, len, "%s\t%s,%s,%s", name[funct3], rvRegName[rs1], rvRegName[rs2], target);
+			}
 		}
+		break;
+	case 0x67:	// jalr
+		if (funct3 == 0) {
+			if ((rd == 0) && (rs1 == 1) && (immI == 0)) {
+				snprintf(dst, len, "ret");
+			}
+			else if ((rd == 0) && (immI == 0)) {
+				snprintf(dst, len, "jr\t%s", rvRegName[rs1]);
+			}
+			else if ((rd == 1) && (immI == 0)) {
+				snprintf(dst, len, "jalr\t%s", rvRegName[rs1]);
+			}
+			else if (rd == 0) {
+				snprintf(dst, len, "jr\t%d(%s)", immI, rvRegName[rs1]);
+			}
+			else {
+				snprintf(dst, len, "jalr\t%s,%d(%s)", rvRegName[rd], immI, rvRegName[rs1]);
+			}
+		}
+		break;
+	case 0x6f:	// jal
+		{
+			int32_t immJ = ((int32_t)(inst & 0x80000000) >> 11) | (inst & 0xff000) | ((inst >> 9) & 0x800) | ((inst >> 20) & 0x7fe);
 
-		if (funcLst == nullptr) {
-			// add function to the list
-
-			int len = strlen(function) + 1;
-			char* fname = new char[len];
-			strcpy(fname, function);
+			formatTarget(addr, immJ, target, sizeof target);
 
-			funcLst = new fileReader::funcList;
-			funcLst->func = fname;
-			funcLst->next = fl->funcs;
-			fl->funcs = funcLst;
+			if (rd == 0) {
+				snprintf(dst, len, "j\t%s", target);
+			}
+			else if (rd == 1) {
+				snprintf(dst, len, "jal\t%s", target);
+			}
+			else {
+				snprintf(dst, len, "jal\t%s,%s", rvRegName[rd], target);
+			}
 		}
+		break;
+	case 0x73:	// system
+		if (funct3 == 0) {
+			switch (inst) {
+			case 0x00000073: snprintf(dst, len, "ecall");  break;
+			case 0x00100073: snprintf(dst, len, "ebreak"); break;
+			case 0x00200073: snprintf(dst, len, "uret");   break;
+			case 0x10200073: snprintf(dst, len, "sret");   break;
+			case 0x30200073: snprintf(dst, len, "mret");   break;
+			case 0x7b200073: snprintf(dst, len, "dret");   break;
+			case 0x10500073: snprintf(dst, len, "wfi");    break;
+			default:
+				if ((funct7 == 0x09) && (rd == 0)) {
+					if (rs2 != 0) {
+						snprintf(dst, len, "sfence.vma\t%s,%s", rvRegName[rs1], rvRegName[rs2]);
+					}
+					else if (rs1 != 0) {
+						snprintf(dst, len, "sfence.vma\t%s", rvRegName[rs1]);
+					}
+					else {
+						snprintf(dst, len, "sfence.vma");
+					}
+				}
+				break;
+			}
+		}
+		else if (funct3 != 4) {
+			static const char* const name[8] = { nullptr, "csrrw", "csrrs", "csrrc", nullptr, "csrrwi", "csrrsi", "csrrci" };
+			static const char* const shortName[8] = { nullptr, "csrw", "csrs", "csrc", nullptr, "csrwi", "csrsi", "csrci" };
+			uint32_t csr = inst >> 20;
+			const char* csrName = rvCsrName(csr);
+			char csrBuf[16];
 
-		// at this point funcLst should point to this function (if it was just added or not)
-
-		*functionname = funcLst->func;
-	}
+			if (csrName == nullptr) {
+				snprintf(csrBuf, sizeof csrBuf, "0x%x", csr);
+				csrName = csrBuf;
+			}
 
-	// line numbers start at 1
+			// rs1 is a register for csrrw/s/c and a 5 bit immediate for the i forms
 
-	if ((line >= 1) && (line <= (int)fl->lineCount)) {
-		*lineptr = fl->lines[line - 1];
+			if ((funct3 == 2) && (rs1 == 0)) {
+				if ((csr == 0xc00) || (csr == 0xc01) || (csr == 0xc02) || (csr == 0xc80) || (csr == 0xc81) || (csr == 0xc82)) {
+					snprintf(dst, len, "rd%s\t%s", csrName, rvRegName[rd]);
+				}
+				else if (csr == 0x003) {
+					snprintf(dst, len, "frcsr\t%s", rvRegName[rd]);
+				}
+				else if (csr == 0x002) {
+					snprintf(dst, len, "frrm\t%s", rvRegName[rd]);
+				}
+				else if (csr == 0x001) {
+					snprintf(dst, len, "frflags\t%s", rvRegName[rd]);
+				}
+				else {
+					snprintf(dst, len, "csrr\t%s,%s", rvRegName[rd], csrName);
+				}
+			}
+			else if (rd == 0) {
+				if (funct3 < 4) {
+					snprintf(dst, len, "%s\t%s,%s", shortName[funct3], csrName, rvRegName[rs1]);
+				}
+				else {
+					snprintf(dst, len, "%s\t%s,%d", shortName[funct3], csrName, rs1);
+				}
+			}
+			else if (funct3 < 4) {
+				snprintf(dst, len, "%s\t%s,%s,%s", name[funct3], rvRegName[rd], csrName, rvRegName[rs1]);
+			}
+			else {
+				snprintf(dst, len, "%s\t%s,%s,%d", name[funct3], rvRegName[rd], csrName, rs1);
+			}
+		}
+		break;
 	}
 
-	if (sane != fprime) {
-		delete[] sane;
-		sane = nullptr;
+	if (dst[0] == 0) {
+		snprintf(dst, len, ".4byte\t0x%x", inst);
 	}
-
-	return TraceDqrProfiler::DQERR_OK;
 }
 
-TraceDqrProfiler::DQErr Disassembler::getInstruction(TraceDqrProfiler::ADDRESS addr, ProfilerInstruction& instruction)
+TraceDqrProfiler::DQErr Disassembler::getDissasembly(TraceDqrProfiler::ADDRESS addr, char*& dissText)
 {
-	if (sectionLst == nullptr) {
-		return TraceDqrProfiler::DQERR_ERR;;
-	}
+	dissText = nullptr;
 
-	Section* sp = sectionLst->getSectionByAddress(addr);
-	if (sp == nullptr || sp->code == nullptr) {
+	Section* sp = findSection(addr);
+	if ((sp == nullptr) || (sp->code == nullptr)) {
 		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	TraceDqrProfiler::DQErr rc;
-	int index;
-
-	index = (addr - sp->startAddr) / 2;
-
-	instruction.coreId = 0;
-	instruction.CRFlag = 0;
-	instruction.brFlags = 0;
-	instruction.address = addr;
-
-	int size;
+	uint32_t index = (addr - sp->startAddr) / 2;
 	uint32_t inst = sp->code[index];
-	rc = decodeInstructionSize(inst, size);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		status = TraceDqrProfiler::DQERR_ERR;
-
-		return rc;
-	}
-
-	instruction.instSize = size;
+	int size;
 
-	if (size > 16) {
-		inst |= sp->code[index + 1] << 16;
+	if (decodeInstructionSize(inst, size) != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	instruction.instruction = inst;
-	instruction.instructionText = sp->diss[index];
-
-	Sym* sym;
+	char text[128];
 
-	rc = symtab->lookupSymbolByAddress(addr, sym);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		return TraceDqrProfiler::DQERR_ERR;
+	if (size == 16) {
+		formatInstruction16(inst, addr, text, sizeof text);
 	}
+	else if (addr + 4 <= sp->endAddr + 1) {
+		inst |= ((uint32_t)sp->code[index + 1]) << 16;
 
-	if (sym != nullptr) {
-		instruction.addressLabel = sym->name;
-		instruction.addressLabelOffset = addr - sym->address;
+		formatInstruction32(inst, addr, text, sizeof text);
 	}
 	else {
-		instruction.addressLabel = nullptr;
-		instruction.addressLabelOffset = 0;
+		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	instruction.timestamp = 0;
+	dissText = textPool.intern(text);
 
 	return TraceDqrProfiler::DQERR_OK;
 }
 
-TraceDqrProfiler::DQErr Disassembler::disassemble(TraceDqrProfiler::ADDRESS addr)
+TraceDqrProfiler::DQErr Disassembler::getInstructionText(TraceDqrProfiler::ADDRESS addr, const char*& instText, const char*& addressLabel, int& addressLabelOffset)
 {
-	if (sectionLst == nullptr) {
-		return TraceDqrProfiler::DQERR_ERR;;
-	}
+	ResolvedInfo& ri = getResolved(addr);
 
-	Section* sp = sectionLst->getSectionByAddress(addr);
-	if (sp == nullptr) {
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+	if (ri.haveInstText == false) {
+		Section* sp = findSection(addr);
 
-	TraceDqrProfiler::DQErr rc;
-	cachedInstInfo* cii;
+		if ((sp != nullptr) && (sp->code != nullptr)) {
+			ri.instructionText = sp->getDiss((addr - sp->startAddr) / 2);
+		}
 
-	cii = sp->getCachedInfo(addr);
-	if (cii != nullptr) {
-		printf("have cached info\n");
+		// no objdump text for this image, so make our own
 
-		source.sourceFile = cii->filename;
-		source.cutPathIndex = cii->cutPathIndex;
-		source.sourceFunction = cii->functionname;
-		source.sourceLineNum = cii->linenumber;
-		source.sourceLine = cii->lineptr;
+		if (ri.instructionText == nullptr) {
+			char* text;
 
-		instruction.address = addr;
-		instruction.instruction = cii->instruction;
-		instruction.instSize = cii->instsize;
-		instruction.instructionText = cii->instructionText;
+			if (getDissasembly(addr, text) == TraceDqrProfiler::DQERR_OK) {
+				ri.instructionText = text;
+			}
+		}
 
-		instruction.addressLabel = cii->addressLabel;
-		instruction.addressLabelOffset = cii->addressLabelOffset;
+		Sym* sym;
+		TraceDqrProfiler::DQErr rc;
 
-		// instruction.timestamp = 0;
-		// instruction.cycles = 0;
+		rc = symtab->lookupSymbolByAddress(addr, sym);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return TraceDqrProfiler::DQERR_ERR;
+		}
 
-		return TraceDqrProfiler::DQERR_OK;
-	}
+		if (sym != nullptr) {
+			ri.addressLabel = sym->name;
+			ri.addressLabelOffset = addr - sym->address;
+		}
 
-	rc = getInstruction(addr, instruction);
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		return TraceDqrProfiler::DQERR_ERR;
+		ri.haveInstText = true;
 	}
 
-	//rc = getSrcLines(addr, &source.sourceFile, &source.cutPathIndex, &source.sourceFunction, &source.sourceLineNum, &source.sourceLine);
-	//if (rc != TraceDqrProfiler::DQERR_OK) {
-	//	return TraceDqrProfiler::DQERR_ERR;
-	//}
+	instText = ri.instructionText;
+	addressLabel = ri.addressLabel;
+	addressLabelOffset = ri.addressLabelOffset;
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+TraceDqrProfiler::DQErr Disassembler::getSourceInfo(TraceDqrProfiler::ADDRESS addr, ProfilerSource& src)
+{
+	ResolvedInfo& ri = getResolved(addr);
+
+	if (ri.haveSource == false) {
+		TraceDqrProfiler::DQErr rc;
+
+		rc = getSrcLines(addr, &ri.sourceFile, &ri.cutPathIndex, &ri.sourceFunction, &ri.sourceLineNum, &ri.sourceLine);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return TraceDqrProfiler::DQERR_ERR;
+		}
+
+		ri.haveSource = true;
+	}
 
-	sp->setCachedInfo(addr, source.sourceFile, source.cutPathIndex, source.sourceFunction, source.sourceLineNum, source.sourceLine, instruction.instructionText, instruction.instruction, instruction.instSize, instruction.addressLabel, instruction.addressLabelOffset);
+	src.sourceFile = ri.sourceFile;
+	src.cutPathIndex = ri.cutPathIndex;
+	src.sourceFunction = ri.sourceFunction;
+	src.sourceLineNum = ri.sourceLineNum;
+	src.sourceLine = ri.sourceLine;
 
 	return TraceDqrProfiler::DQERR_OK;
 }
@@ -13194,7 +18052,7 @@ TraceDqrProfiler::DQErr Disassembler::cacheSrcInfo(TraceDqrProfiler::ADDRESS add
 		return TraceDqrProfiler::DQERR_ERR;
 	}
 
-	Section* sp = sectionLst->getSectionByAddress(addr);
+	Section* sp = findSection(addr);
 	if (sp == nullptr) {
 		return TraceDqrProfiler::DQERR_ERR;
 	}
@@ -19,6 +19,7 @@
 #endif
 #include "SocketIntf.h"
 #include "dqr_profiler_interface.h"
+#include "dqr_trace_profiler.h"
 #include "PacketFormat.h"
 #include "logger.h"
 
@@ -85,7 +86,7 @@ TySifiveTraceProfileError SifiveProfilerInterface::StartProfilingThread(uint32_t
         m_abort_profiling = false;
     }
 
-    m_profiling_trace = new (std::nothrow) TraceProfiler(tf_name, ef_name, numAddrBits, addrDispFlags, srcbits, od_name, freq);
+    m_profiling_trace = new (std::nothrow) TraceProfiler(tf_name, ef_name, numAddrBits, addrDispFlags, srcbits, od_name, freq, m_elf_image);
     if (m_profiling_trace == nullptr)
     {
         LOG_ERR("Could not create Trace Profiler instance");
@@ -103,6 +104,43 @@ TySifiveTraceProfileError SifiveProfilerInterface::StartProfilingThread(uint32_t
     m_profiling_trace->setTraceType(traceType);
     m_profiling_trace->setTSSize(tssize);
     m_profiling_trace->setPathType(pt);
+    if (m_enable_trace_file_input)
+    {
+        if (m_profiling_trace->MapTraceFile() != TraceDqrProfiler::DQERR_OK)
+        {
+            LOG_ERR("Could not map trace file");
+            CleanUpProfiling();
+            return SIFIVE_TRACE_PROFILER_CANNOT_OPEN_FILE;
+        }
+    }
+    else
+    {
+        m_profiling_trace->AttachTraceStore(m_trace_store);
+    }
+
+    // An offline trace file can be split at sync messages and decoded on several threads, and the cores of a
+    // multi-core trace can be decoded on threads of their own. Each falls back to the serial decoder for traces
+    // it can not handle, and only the first one that applies is used
+    if (m_enable_trace_file_input && (m_parallel_decode_workers > 1) && (m_profiling_trace->StartParallelDecode(m_parallel_decode_workers) != TraceDqrProfiler::DQERR_OK))
+    {
+        LOG_ERR("Could not start parallel decode");
+        CleanUpProfiling();
+        return SIFIVE_TRACE_PROFILER_ERR;
+    }
+
+    if (m_enable_per_core_decode && (m_profiling_trace->StartCoreDecode() != TraceDqrProfiler::DQERR_OK))
+    {
+        LOG_ERR("Could not start per-core decode");
+        CleanUpProfiling();
+        return SIFIVE_TRACE_PROFILER_ERR;
+    }
+
+    if (m_enable_decode_pipeline && (m_profiling_trace->StartMessagePipeline() != TraceDqrProfiler::DQERR_OK))
+    {
+        LOG_ERR("Could not start message pipeline");
+        CleanUpProfiling();
+        return SIFIVE_TRACE_PROFILER_ERR;
+    }
 
     m_thread_idx = thread_idx;
 
@@ -146,7 +184,9 @@ TySifiveTraceProfileError SifiveProfilerInterface::StartProfilingThread(uint32_t
     try
     { 
         LOG_DEBUG("Creating Profiling Thread [%u]", m_thread_idx);
-        m_profiling_thread = std::thread(&SifiveProfilerInterface::ProfilingThread, this);
+        // Close the trace input when the thread exits so that PushTraceData() can
+        // not block forever on a full ring that nobody is reading any more
+        m_profiling_thread = std::thread([this]() { ProfilingThread(); m_profiling_trace->CloseTraceInput(); });
     }
     catch (...)
     {
@@ -215,13 +255,116 @@ void SifiveProfilerInterface::SetEndOfDataHistGenerator()
   Date         Initials    Description
   26-Apr-2024  AS          Initial
 ****************************************************************************/
-void SifiveProfilerInterface::SetHistogramCallback(std::function<void(uint32_t src_id, std::unordered_map<uint64_t, uint64_t>& hist_map, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
+void SifiveProfilerInterface::SetHistogramCallback(std::function<void(uint32_t src_id, const ProfilerHistogram& hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
 {
     m_fp_hist_callback = fp_callback;
     if (m_hist_trace != NULL)
         m_hist_trace->SetHistogramCallback(fp_callback);
 }
 
+/****************************************************************************
+     Function: SetHistogramDeltaCallback
+     Engineer: agent
+        Input: fp_callback - Function pointer to the callback
+       Output: None
+       return: None
+  Description: Sets the incremental histogram callback. Each call carries only
+               the (address, count increment) pairs since the previous call;
+               the last call also carries the complete histogram
+  Date         Initials    Description
+  16-Oct-2026  agent       Initial
+****************************************************************************/
+void SifiveProfilerInterface::SetHistogramDeltaCallback(std::function<void(uint32_t src_id, const ProfilerHistogram::Entry* delta, size_t delta_count, const ProfilerHistogram* hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
+{
+    m_fp_hist_delta_callback = fp_callback;
+    if (m_hist_trace != NULL)
+        m_hist_trace->SetHistogramDeltaCallback(fp_callback);
+}
+
+/****************************************************************************
+     Function: SetHistogramSummaryCallback
+     Engineer: agent
+        Input: levels - ProfilerHistogramSummary::sumFunction, sumLine and/or
+                        sumBlock
+               fp_callback - Function pointer to the callback
+       Output: None
+       return: None
+  Description: Sets the callback that gets the histogram added up by
+               function, source line and/or basic block
+  Date         Initials    Description
+  16-Oct-2026  agent       Initial
+****************************************************************************/
+void SifiveProfilerInterface::SetHistogramSummaryCallback(uint32_t levels, std::function<void(uint32_t src_id, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
+{
+    m_hist_summary_levels = levels;
+    m_fp_hist_summary_callback = fp_callback;
+    if (m_hist_trace != NULL)
+        m_hist_trace->SetHistogramSummaryCallback(levels, fp_callback);
+}
+
+/****************************************************************************
+     Function: SetCallGraphCallback
+     Engineer: agent
+        Input: fp_callback - Function pointer to the callback
+       Output: None
+       return: None
+  Description: Sets the callback that gets the call graph (caller to callee
+               edges with inclusive and exclusive counts) built while the
+               histogram is generated
+  Date         Initials    Description
+  16-Oct-2026  agent       Initial
+****************************************************************************/
+void SifiveProfilerInterface::SetCallGraphCallback(std::function<void(uint32_t src_id, const ProfilerCallGraph& graph, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
+{
+    m_fp_call_graph_callback = fp_callback;
+    if (m_hist_trace != NULL)
+        m_hist_trace->SetCallGraphCallback(fp_callback);
+}
+
+/****************************************************************************
+     Function: SetTimeProfileCallback
+     Engineer: agent
+        Input: levels - ProfilerHistogramSummary::sumFunction, sumLine and/or
+                        sumBlock, or sumNone for per address ticks only
+               fp_callback - Function pointer to the callback
+       Output: None
+       return: None
+  Description: Sets the callback that gets timestamp ticks per address (and
+               added up at levels), shared out over the instructions retired
+               between consecutive timestamps
+  Date         Initials    Description
+  16-Oct-2026  agent       Initial
+****************************************************************************/
+void SifiveProfilerInterface::SetTimeProfileCallback(uint32_t levels, std::function<void(uint32_t src_id, const ProfilerHistogram& ticks, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret)> fp_callback)
+{
+    m_time_summary_levels = levels;
+    m_fp_time_profile_callback = fp_callback;
+    if (m_hist_trace != NULL)
+        m_hist_trace->SetTimeProfileCallback(levels, fp_callback);
+}
+
+/****************************************************************************
+     Function: SetProfileOutput
+     Engineer: agent
+        Input: pprof_filepath - File for a gzip'd pprof profile, or nullptr
+               perf_script_filepath - File for 'perf script' text, or nullptr
+       Output: None
+       return: None
+  Description: Sets the files the histogram and call graph are written to
+               when the next histogram thread finishes. The writers keep a
+               total per address until then, so their memory and the files
+               grow with how much of the program the trace reaches, not
+               with the number of histogram updates. The pprof file is not
+               compressed
+  Date         Initials    Description
+  16-Oct-2026  agent       Initial
+****************************************************************************/
+void SifiveProfilerInterface::SetProfileOutput(const char* pprof_filepath, const char* perf_script_filepath)
+{
+    m_pprof_filepath = pprof_filepath;
+    m_perf_script_filepath = perf_script_filepath;
+}
+
 /****************************************************************************
      Function: ClearHistogram
      Engineer: Arjun Suresh
@@ -251,35 +394,15 @@ void SifiveProfilerInterface::ClearHistogram()
 ****************************************************************************/
 TySifiveTraceProfileError SifiveProfilerInterface::PushTraceData(uint8_t *p_buff, const uint64_t& size)
 {
-    TySifiveTraceProfileError ret = SIFIVE_TRACE_PROFILER_OK;
-    if (m_profiling_trace != NULL)
+    // Nothing to do if there is no decoder to consume the data
+    if ((m_profiling_trace == NULL) && (m_addr_search_trace == NULL) && (m_ts_search_trace == NULL))
     {
-        ret = (m_profiling_trace->PushTraceData(p_buff, size) == TraceDqrProfiler::DQERR_OK) ? SIFIVE_TRACE_PROFILER_OK : SIFIVE_TRACE_PROFILER_ERR;
-        if (ret != SIFIVE_TRACE_PROFILER_OK)
-        {
-            return ret;
-        }
+        return SIFIVE_TRACE_PROFILER_OK;
     }
 
-    if (m_addr_search_trace != NULL)
-    {
-        ret = (m_addr_search_trace->PushTraceData(p_buff, size) == TraceDqrProfiler::DQERR_OK) ? SIFIVE_TRACE_PROFILER_OK : SIFIVE_TRACE_PROFILER_ERR;
-        if (ret != SIFIVE_TRACE_PROFILER_OK)
-        {
-            return ret;
-        }
-    }
-
-    if (m_ts_search_trace != NULL)
-    {
-        ret = (m_ts_search_trace->PushTraceData(p_buff, size) == TraceDqrProfiler::DQERR_OK) ? SIFIVE_TRACE_PROFILER_OK : SIFIVE_TRACE_PROFILER_ERR;
-        if (ret != SIFIVE_TRACE_PROFILER_OK)
-        {
-            return ret;
-        }
-    }
-
-    return ret;
+    // The data is copied once into the shared store. Each decoder reads it through
+    // its own cursor and a chunk is freed once all of them have moved past it
+    return (m_trace_store->append(p_buff, size) == TraceDqrProfiler::DQERR_OK) ? SIFIVE_TRACE_PROFILER_OK : SIFIVE_TRACE_PROFILER_ERR;
 }
 
 /****************************************************************************
@@ -753,6 +876,24 @@ TySifiveTraceProfileError SifiveProfilerInterface::Configure(const TProfilerConf
     m_port_no = config.portno;
     m_ui_file_split_size_bytes = config.ui_file_split_size_bytes;
     m_src_id = config.src_id;
+    m_enable_trace_file_input = config.enable_trace_file_input;
+    m_enable_decode_pipeline = config.enable_decode_pipeline;
+    m_parallel_decode_workers = config.parallel_decode_workers;
+    m_enable_per_core_decode = config.enable_per_core_decode;
+    m_pprof_filepath = config.pprof_filepath;
+    m_perf_script_filepath = config.perf_script_filepath;
+
+    // Load the ELF file once; every decoder started from this interface shares it. If it can't be loaded here,
+    // each decoder tries again and reports the error itself
+    m_elf_image.reset();
+    if (ef_name != nullptr)
+    {
+        std::shared_ptr<ElfReader> elf_image(new (std::nothrow) ElfReader(ef_name, od_name, config.elf_cache_dir));
+        if ((elf_image != nullptr) && (elf_image->getStatus() == TraceDqrProfiler::DQERR_OK))
+        {
+            m_elf_image = elf_image;
+        }
+    }
 
 	return SIFIVE_TRACE_PROFILER_OK;
 }
@@ -878,7 +1019,7 @@ TySifiveTraceProfileError SifiveProfilerInterface::StartAddrSearchThread(const T
 {
     m_abort_search = false;
 
-    m_addr_search_trace = new (std::nothrow) TraceProfiler(tf_name, ef_name, numAddrBits, addrDispFlags, srcbits, od_name, freq);
+    m_addr_search_trace = new (std::nothrow) TraceProfiler(tf_name, ef_name, numAddrBits, addrDispFlags, srcbits, od_name, freq, m_elf_image);
     if (m_addr_search_trace == nullptr)
     {
         printf("Error: Could not create TraceProfiler object\n");
@@ -896,10 +1037,46 @@ TySifiveTraceProfileError SifiveProfilerInterface::StartAddrSearchThread(const T
     m_addr_search_trace->setTraceType(traceType);
     m_addr_search_trace->setTSSize(tssize);
     m_addr_search_trace->setPathType(pt);
+    if (m_enable_trace_file_input)
+    {
+        if (m_addr_search_trace->MapTraceFile() != TraceDqrProfiler::DQERR_OK)
+        {
+            printf("Error: Could not map trace file %s\n", tf_name);
+            CleanUpAddrSearch();
+            return SIFIVE_TRACE_PROFILER_CANNOT_OPEN_FILE;
+        }
+    }
+    else
+    {
+        m_addr_search_trace->AttachTraceStore(m_trace_store);
+    }
+
+    // The search only needs the message offset and address of each instruction, which is all the parallel and
+    // per-core decoders give back, so it can use them the same way ProfilingThread does
+    if (m_enable_trace_file_input && (m_parallel_decode_workers > 1) && (m_addr_search_trace->StartParallelDecode(m_parallel_decode_workers) != TraceDqrProfiler::DQERR_OK))
+    {
+        printf("Error: Could not start parallel decode\n");
+        CleanUpAddrSearch();
+        return SIFIVE_TRACE_PROFILER_ERR;
+    }
+
+    if (m_enable_per_core_decode && (m_addr_search_trace->StartCoreDecode() != TraceDqrProfiler::DQERR_OK))
+    {
+        printf("Error: Could not start per-core decode\n");
+        CleanUpAddrSearch();
+        return SIFIVE_TRACE_PROFILER_ERR;
+    }
+
+    if (m_enable_decode_pipeline && (m_addr_search_trace->StartMessagePipeline() != TraceDqrProfiler::DQERR_OK))
+    {
+        printf("Error: Could not start message pipeline\n");
+        CleanUpAddrSearch();
+        return SIFIVE_TRACE_PROFILER_ERR;
+    }
 
     try
     {
-        m_addr_search_thread = std::thread(&SifiveProfilerInterface::AddrSearchThread, this, search_params, dir);
+        m_addr_search_thread = std::thread([this, search_params, dir]() { AddrSearchThread(search_params, dir); m_addr_search_trace->CloseTraceInput(); });
     }
     catch (...)
     {
@@ -1108,7 +1285,7 @@ void SifiveProfilerInterface::WaitForAddrSearchCompletion()
 ****************************************************************************/
 TySifiveTraceProfileError SifiveProfilerInterface::StartHistogramThread()
 {
-    m_hist_trace = new (std::nothrow) TraceProfiler(tf_name, ef_name, numAddrBits, addrDispFlags, srcbits, od_name, freq);
+    m_hist_trace = new (std::nothrow) TraceProfiler(tf_name, ef_name, numAddrBits, addrDispFlags, srcbits, od_name, freq, m_elf_image);
     if (m_hist_trace == nullptr)
     {
         LOG_ERR("Could not create Trace Profiler instance");
@@ -1126,11 +1303,41 @@ TySifiveTraceProfileError SifiveProfilerInterface::StartHistogramThread()
     m_hist_trace->setTraceType(traceType);
     m_hist_trace->setTSSize(tssize);
     m_hist_trace->setPathType(pt);
+    if (m_enable_trace_file_input && (m_hist_trace->MapTraceFile() != TraceDqrProfiler::DQERR_OK))
+    {
+        LOG_ERR("Could not map trace file");
+        CleanUpHistogram();
+        return SIFIVE_TRACE_PROFILER_CANNOT_OPEN_FILE;
+    }
     m_hist_trace->SetSrcID(m_src_id);
+    if (m_fp_hist_callback)
+        m_hist_trace->SetHistogramCallback(m_fp_hist_callback);
+    if (m_fp_hist_delta_callback)
+        m_hist_trace->SetHistogramDeltaCallback(m_fp_hist_delta_callback);
+    if (m_fp_hist_summary_callback)
+        m_hist_trace->SetHistogramSummaryCallback(m_hist_summary_levels, m_fp_hist_summary_callback);
+    if (m_fp_call_graph_callback)
+        m_hist_trace->SetCallGraphCallback(m_fp_call_graph_callback);
+    if (m_fp_time_profile_callback)
+        m_hist_trace->SetTimeProfileCallback(m_time_summary_levels, m_fp_time_profile_callback);
+    if (((m_pprof_filepath != nullptr) && (m_hist_trace->SetProfileOutput(TraceProfiler::PROFILE_PPROF, m_pprof_filepath) != TraceDqrProfiler::DQERR_OK))
+        || ((m_perf_script_filepath != nullptr) && (m_hist_trace->SetProfileOutput(TraceProfiler::PROFILE_PERF_SCRIPT, m_perf_script_filepath) != TraceDqrProfiler::DQERR_OK)))
+    {
+        LOG_ERR("Could not open profile output file");
+        CleanUpHistogram();
+        return SIFIVE_TRACE_PROFILER_CANNOT_OPEN_FILE;
+    }
+
+    if (m_enable_decode_pipeline && (m_hist_trace->StartMessagePipeline() != TraceDqrProfiler::DQERR_OK))
+    {
+        LOG_ERR("Could not start message pipeline");
+        CleanUpHistogram();
+        return SIFIVE_TRACE_PROFILER_ERR;
+    }
 
     try
     {
-        m_hist_thread = std::thread(&SifiveProfilerInterface::HistogramThread, this);
+        m_hist_thread = std::thread([this]() { HistogramThread(); m_hist_trace->CloseTraceInput(); });
     }
     catch (...)
     {
@@ -1186,6 +1393,21 @@ void SifiveProfilerInterface::WaitForHistogramCompletion()
     CleanUpHistogram();
 }
 
+/****************************************************************************
+     Function: SifiveProfilerInterface
+     Engineer: agent
+        Input: None
+       Output: None
+       return: None
+  Description: Constructor
+  Date         Initials    Description
+  16-Oct-2026  agent       Initial
+****************************************************************************/
+SifiveProfilerInterface::SifiveProfilerInterface()
+{
+    m_trace_store = std::make_shared<TraceChunkStore>();
+}
+
 /****************************************************************************
      Function: ~SifiveProfilerInterface
      Engineer: Arjun Suresh
@@ -1273,7 +1495,7 @@ void SifiveProfilerInterface::AbortSearch()
 TySifiveTraceProfileError SifiveProfilerInterface::StartTsSearchThread(TProfTsSearchParams& search_params)
 {
     m_abort_search = false;
-    m_ts_search_trace = new (std::nothrow) TraceProfiler(tf_name, ef_name, numAddrBits, addrDispFlags, srcbits, od_name, freq);
+    m_ts_search_trace = new (std::nothrow) TraceProfiler(tf_name, ef_name, numAddrBits, addrDispFlags, srcbits, od_name, freq, m_elf_image);
     if (m_ts_search_trace == nullptr)
     {
         LOG_ERR("Could not create Trace Profiler instance");
@@ -1291,11 +1513,31 @@ TySifiveTraceProfileError SifiveProfilerInterface::StartTsSearchThread(TProfTsSe
     m_ts_search_trace->setTraceType(traceType);
     m_ts_search_trace->setTSSize(tssize);
     m_ts_search_trace->setPathType(pt);
+    if (m_enable_trace_file_input)
+    {
+        if (m_ts_search_trace->MapTraceFile() != TraceDqrProfiler::DQERR_OK)
+        {
+            LOG_ERR("Could not map trace file");
+            CleanUpTsSearch();
+            return SIFIVE_TRACE_PROFILER_CANNOT_OPEN_FILE;
+        }
+    }
+    else
+    {
+        m_ts_search_trace->AttachTraceStore(m_trace_store);
+    }
+
+    if (m_enable_decode_pipeline && (m_ts_search_trace->StartMessagePipeline() != TraceDqrProfiler::DQERR_OK))
+    {
+        LOG_ERR("Could not start message pipeline");
+        CleanUpTsSearch();
+        return SIFIVE_TRACE_PROFILER_ERR;
+    }
     m_ts_search_trace->SetSrcID(m_src_id);
 
     try
     {
-        m_ts_search_thread = std::thread(&SifiveProfilerInterface::TsSearchThread, this, std::ref(search_params));
+        m_ts_search_thread = std::thread([this, &search_params]() { TsSearchThread(search_params); m_ts_search_trace->CloseTraceInput(); });
     }
     catch (...)
     {
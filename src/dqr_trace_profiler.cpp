@@ -2392,6 +2392,7 @@ TraceProfiler::TraceProfiler(char* mf_name)
 	sfp = nullptr;
 	elfReader = nullptr;
 	disassembler = nullptr;
+	lazyInstText = false;
 	caTrace = nullptr;
 	counts = nullptr;//delete this line if compile error
 	efName = nullptr;
@@ -2453,7 +2454,7 @@ TraceProfiler::TraceProfiler(char* mf_name)
 	status = TraceDqrProfiler::DQERR_OK;
 }
 
-TraceProfiler::TraceProfiler(char* tf_name, char* ef_name, int numAddrBits, uint32_t addrDispFlags, int srcBits, const char* odExe, uint32_t freq)
+TraceProfiler::TraceProfiler(char* tf_name, char* ef_name, int numAddrBits, uint32_t addrDispFlags, int srcBits, const char* odExe, uint32_t freq, std::shared_ptr<ElfReader> elfImage)
 {
 	TraceDqrProfiler::DQErr rc;
 	TraceSettings ts;
@@ -2461,6 +2462,7 @@ TraceProfiler::TraceProfiler(char* tf_name, char* ef_name, int numAddrBits, uint
 	sfp = nullptr;
 	elfReader = nullptr;
 	disassembler = nullptr;
+	lazyInstText = false;
 	caTrace = nullptr;
 	counts = nullptr;//delete this line if compile error
 	efName = nullptr;
@@ -2479,6 +2481,7 @@ TraceProfiler::TraceProfiler(char* tf_name, char* ef_name, int numAddrBits, uint
 	ts.propertyToEFName(ef_name);
 	ts.propertyToObjdumpName(odExe);
 	ts.numAddrBits = numAddrBits;
+	ts.elfImage = elfImage;
 
 	ts.addrDispFlags = addrDispFlags;
 	ts.srcBits = srcBits;
@@ -2562,8 +2565,12 @@ TraceDqrProfiler::DQErr TraceProfiler::configure(TraceSettings& settings)
 
 	analytics.setSrcBits(srcbits);
 
-	//rtdName = new char[strlen(settings.tfName) + 1];
-	//strcpy(rtdName, settings.tfName);
+	// keep the trace file name so parallel decode workers can map the same file
+
+	if (settings.tfName != nullptr) {
+		rtdName = new char[strlen(settings.tfName) + 1];
+		strcpy(rtdName, settings.tfName);
+	}
 
 	sfp = new (std::nothrow) SliceFileParser(settings.tfName, srcbits);
 
@@ -2591,9 +2598,18 @@ TraceDqrProfiler::DQErr TraceProfiler::configure(TraceSettings& settings)
 		efName = new char[l];
 		strcpy(efName, settings.efName);
 
-		// create elf object - this also forks off objdump and parses the elf file
+		if (settings.elfImage != nullptr) {
+			// already loaded, and shared with other decoders
+
+			m_elf_image = settings.elfImage;
+		}
+		else {
+			// create elf object - this also reads the elf file
+
+			m_elf_image = std::shared_ptr<ElfReader>(new (std::nothrow) ElfReader(settings.efName, objdump));
+		}
 
-		elfReader = new (std::nothrow) ElfReader(settings.efName, objdump);
+		elfReader = m_elf_image.get();
 
 		if (elfReader == nullptr) {
 			printf("Error: TraceProfiler::Configure(): Could not create ElfReader object\n");
@@ -2627,7 +2643,7 @@ TraceDqrProfiler::DQErr TraceProfiler::configure(TraceSettings& settings)
 
 		// create disassembler object
 
-		disassembler = new (std::nothrow) Disassembler(symtab, sections, elfReader->getArchSize());
+		disassembler = new (std::nothrow) Disassembler(symtab, sections, elfReader->getArchSize(), elfReader->getSectionIndex());
 		if (disassembler == nullptr) {
 			printf("Error: TraceProfiler::Configure(): Could not creat disassembler object\n");
 
@@ -2815,16 +2831,42 @@ void TraceProfiler::cleanUp()
 		state[i] = TRACE_STATE_DONE;
 	}
 
+	// the parser thread uses sfp, so it has to be stopped first
+
+	StopMessagePipeline();
+	StopParallelDecode();
+	StopCoreDecode();
+
 	if (sfp != nullptr) {
 		delete sfp;
 		sfp = nullptr;
 	}
 
-	if (elfReader != nullptr) {
-		delete elfReader;
-		elfReader = nullptr;
+	// a writer queued by SetProfileOutput() that the decode loop never picked up still has to be closed
+
+	applyPendingSettings();
+	closeProfileWriters();
+
+	if (m_hist_summarizer != nullptr) {
+		delete m_hist_summarizer;
+		m_hist_summarizer = nullptr;
+	}
+
+	if (m_time_summarizer != nullptr) {
+		delete m_time_summarizer;
+		m_time_summarizer = nullptr;
+	}
+
+	if (m_call_graph != nullptr) {
+		delete m_call_graph;
+		m_call_graph = nullptr;
 	}
 
+	// the elf file is only freed once no other decoder is using it
+
+	m_elf_image.reset();
+	elfReader = nullptr;
+
 	if (cutPath != nullptr) {
 		delete[] cutPath;
 		cutPath = nullptr;
@@ -3118,7 +3160,7 @@ TraceDqrProfiler::DQErr TraceProfiler::getNumBytesInSWTQ(int& numBytes)
 	return sfp->getNumBytesInSWTQ(numBytes);
 }
 
-TraceDqrProfiler::DQErr TraceProfiler::getTraceFileOffset(int& size, int& offset)
+TraceDqrProfiler::DQErr TraceProfiler::getTraceFileOffset(uint64_t& size, uint64_t& offset)
 {
 	return sfp->getFileOffset(size, offset);
 }
@@ -3228,6 +3270,46 @@ TraceDqrProfiler::DQErr TraceProfiler::Disassemble(TraceDqrProfiler::ADDRESS add
 	return TraceDqrProfiler::DQERR_OK;
 }
 
+TraceDqrProfiler::DQErr TraceProfiler::resolveInstructionText(ProfilerInstruction* instInfo)
+{
+	if (instInfo == nullptr) {
+		printf("Error: TraceProfiler::resolveInstructionText(): Argument instInfo is null\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	if (disassembler == nullptr) {
+		printf("Error: TraceProfiler::resolveInstructionText(): No disassembler object\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	const char* instText;
+	TraceDqrProfiler::DQErr rc;
+
+	rc = disassembler->getInstructionText(instInfo->address, instText, instInfo->addressLabel, instInfo->addressLabelOffset);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	instInfo->instructionText = (char*)instText;
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::resolveSourceInfo(TraceDqrProfiler::ADDRESS addr, ProfilerSource* srcInfo)
+{
+	if (srcInfo == nullptr) {
+		printf("Error: TraceProfiler::resolveSourceInfo(): Argument srcInfo is null\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	if (disassembler == nullptr) {
+		printf("Error: TraceProfiler::resolveSourceInfo(): No disassembler object\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	return disassembler->getSourceInfo(addr, *srcInfo);
+}
+
 //const char *TraceProfiler::getSymbolByAddress(TraceDqrProfiler::ADDRESS addr)
 //{
 //	return symtab->getSymbolByAddress(addr);
@@ -3503,8 +3585,10 @@ TraceDqrProfiler::DQErr TraceProfiler::nextAddr(TraceDqrProfiler::ADDRESS addr,
 	bool isBranch;
 	TraceDqrProfiler::Reg rs1;
 	TraceDqrProfiler::Reg rd;
+	int plainRun;
+	const DecodedInst* decoded;
 
-	ec = elfReader->getInstructionByAddress(addr, inst);
+	ec = elfReader->getInstructionByAddress(addr, inst, plainRun, decoded);
 	if (ec != TraceDqrProfiler::DQERR_OK) {
 		printf("Error: nextAddr() failed\n");
 
@@ -3517,7 +3601,19 @@ TraceDqrProfiler::DQErr TraceProfiler::nextAddr(TraceDqrProfiler::ADDRESS addr,
 	crFlag = TraceDqrProfiler::isNone;
 	nextAddr = 0;
 
-	rc = decodeInstruction(inst, inst_size, inst_type, rs1, rd, immediate, isBranch);
+	if (decoded != nullptr) {
+		inst_size = decoded->instSize;
+		inst_type = (TraceDqrProfiler::InstType)decoded->instType;
+		rs1 = (TraceDqrProfiler::Reg)decoded->rs1;
+		rd = (TraceDqrProfiler::Reg)decoded->rd;
+		immediate = decoded->immediate;
+		isBranch = decoded->isBranch;
+		rc = 0;
+	}
+	else {
+		rc = decodeInstruction(inst, inst_size, inst_type, rs1, rd, immediate, isBranch);
+	}
+
 	if (rc != 0) {
 		printf("Error: Cann't decode size of instruction %04x\n", inst);
 
@@ -3590,6 +3686,7 @@ TraceDqrProfiler::DQErr TraceProfiler::nextAddr(TraceDqrProfiler::ADDRESS addr,
 		// disassemble and display instruction
 
 		Disassemble(addr);
+		resolveInstructionText(&instructionInfo);
 
 		char dst[256];
 		instructionInfo.addressToText(dst, sizeof dst, 0);
@@ -3631,8 +3728,10 @@ TraceDqrProfiler::DQErr TraceProfiler::nextAddr(int core, TraceDqrProfiler::ADDR
 	TraceDqrProfiler::Reg rs1;
 	TraceDqrProfiler::Reg rd;
 	bool isTaken;
+	int plainRun;
+	const DecodedInst* decoded;
 
-	status = elfReader->getInstructionByAddress(addr, inst);
+	status = elfReader->getInstructionByAddress(addr, inst, plainRun, decoded);
 	if (status != TraceDqrProfiler::DQERR_OK) {
 		printf("Error: nextAddr(): getInstructionByAddress() failed\n");
 
@@ -3642,10 +3741,33 @@ TraceDqrProfiler::DQErr TraceProfiler::nextAddr(int core, TraceDqrProfiler::ADDR
 	crFlag = TraceDqrProfiler::isNone;
 	brFlag = TraceDqrProfiler::BRFLAG_none;
 
+	// straight line code only moves the pc on and uses up i-cnt, so there is no need to decode it
+
+	if (plainRun > 0) {
+		inst_size = ((inst & 0x0003) == 0x0003) ? 32 : 16;
+
+		pc = addr + inst_size / 8;
+		counts->consumeICnt(core, inst_size / 16);
+
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
 	// figure out how big the instruction is
 	// Note: immediate will already be adjusted - don't need to mult by 2 before adding to address
 
-	rc = decodeInstruction(inst, inst_size, inst_type, rs1, rd, immediate, isBranch);
+	if (decoded != nullptr) {
+		inst_size = decoded->instSize;
+		inst_type = (TraceDqrProfiler::InstType)decoded->instType;
+		rs1 = (TraceDqrProfiler::Reg)decoded->rs1;
+		rd = (TraceDqrProfiler::Reg)decoded->rd;
+		immediate = decoded->immediate;
+		isBranch = decoded->isBranch;
+		rc = 0;
+	}
+	else {
+		rc = decodeInstruction(inst, inst_size, inst_type, rs1, rd, immediate, isBranch);
+	}
+
 	if (rc != 0) {
 		printf("Error: nextAddr(): Cannot decode instruction %04x\n", inst);
 
@@ -4142,624 +4264,2842 @@ void TraceProfiler::SetEndOfData()
        sfp->SetEndOfData();
 }
 
-TraceDqrProfiler::DQErr TraceProfiler::processTraceMessage(ProfilerNexusMessage& nm, TraceDqrProfiler::ADDRESS& pc, TraceDqrProfiler::ADDRESS& faddr, TraceDqrProfiler::TIMESTAMP& ts, bool& consumed)
+void TraceProfiler::CloseTraceInput()
 {
-	consumed = false;
+   // the parser thread may still be waiting on the trace input, so it has to be stopped before the input goes
+   StopMessagePipeline();
 
-	switch (nm.tcode) {
-	case TraceDqrProfiler::TCODE_ERROR:
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
-		}
+   if(sfp)
+       sfp->CloseTraceInput();
+}
 
-		// set addrs to 0 because we have dropped some messages and don't know what is going on
+void TraceProfiler::AttachTraceStore(std::shared_ptr<TraceChunkStore>& store)
+{
+   if(sfp)
+       sfp->AttachTraceStore(store);
+}
 
-		faddr = 0;
-		pc = 0;
-		break;
-	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
-		}
+TraceDqrProfiler::DQErr TraceProfiler::MapTraceFile()
+{
+	if (sfp == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		if (perfConverter != nullptr) { // or should this be a general itc process thing?? could we process all itc messages here?
-			TraceDqrProfiler::DQErr rc;
-			//rc = perfConverter->processITCPerf(nm.coreId, ts, nm.dataAcquisition.idTag, nm.dataAcquisition.data, consumed);
-			//if (rc != TraceDqrProfiler::DQERR_OK) {
-			//	return rc;
-			//}
-		}
-		break;
-	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-	case TraceDqrProfiler::TCODE_RESOURCEFULL:
-	case TraceDqrProfiler::TCODE_CORRELATION:
-	case TraceDqrProfiler::TCODE_REPEATBRANCH:
-	case TraceDqrProfiler::TCODE_TRAP_INFO:	
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
-		}
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
-		}
-		faddr = faddr ^ (nm.indirectBranch.u_addr << 1);
-		pc = faddr;
-		break;
-	case TraceDqrProfiler::TCODE_SYNC:
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
-		}
-		faddr = nm.sync.f_addr << 1;
-		pc = faddr;
-		counts->resetStack(nm.coreId);
-		counts->resetCounts(nm.coreId);
-		break;
-	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
-		}
-		faddr = nm.directBranchWS.f_addr << 1;
-		pc = faddr;
-		counts->resetStack(nm.coreId);
-		counts->resetCounts(nm.coreId);
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
-		}
-		faddr = nm.indirectBranchWS.f_addr << 1;
-		pc = faddr;
-		counts->resetStack(nm.coreId);
-		counts->resetCounts(nm.coreId);
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
-		}
-		faddr = faddr ^ (nm.indirectHistory.u_addr << 1);
-		pc = faddr;
-		break;
-	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
-		}
-		faddr = nm.indirectHistoryWS.f_addr << 1;
-		pc = faddr;
-		counts->resetStack(nm.coreId);
-		counts->resetCounts(nm.coreId);
-		break;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-		// for 8, 0; 14, 0 do not update pc, only faddr. 0, 0 has no address, so it never updates
-		// this is because those message types all appear in instruction traces (non-event) and
-		// do not want to update the current address because they have no icnt to say when to do it
+	return sfp->mapTraceFile(rtdName);
+}
 
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
-		}
+TraceDqrProfiler::DQErr TraceProfiler::StartMessagePipeline()
+{
+	if (sfp == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-		switch (nm.ict.cksrc) {
-		case TraceDqrProfiler::ICT_EXT_TRIG:
-			if (nm.ict.ckdf == 0) {
-				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
-				// don't update pc
+	// nothing to do if messages are already parsed on another thread, or by the parallel decode workers
 
-				//if (eventConverter != nullptr) {
-				//	eventConverter->emitExtTrigEvent(nm.coreId, ts, nm.ict.ckdf, faddr, 0);
-				//}
-			}
-			else if (nm.ict.ckdf == 1) {
-				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
-				pc = faddr;
+	if ((m_msg_queue != nullptr) || (m_parallel_decoder != nullptr) || (m_core_decoder != nullptr)) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-				//if (eventConverter != nullptr) {
-				//	eventConverter->emitExtTrigEvent(nm.coreId, ts, nm.ict.ckdf, faddr, nm.ict.ckdata[1]);
-				//}
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
-			break;
-		case TraceDqrProfiler::ICT_WATCHPOINT:
-			if (nm.ict.ckdf == 0) {
-				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
-				// don't update pc
+	m_msg_queue = new (std::nothrow) TraceMsgQueue(TRACE_MSG_QUEUE_SIZE);
+	if (m_msg_queue == nullptr) {
+		printf("Error: TraceProfiler::StartMessagePipeline(): Could not create message queue\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-				//if (eventConverter != nullptr) {
-				//	eventConverter->emitWatchpoint(nm.coreId, ts, nm.ict.ckdf, faddr, 0);
-				//}
-			}
-			else if (nm.ict.ckdf == 1) {
-				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
-				pc = faddr;
+	if (m_msg_queue->getErr() != TraceDqrProfiler::DQERR_OK) {
+		delete m_msg_queue;
+		m_msg_queue = nullptr;
 
-				//if (eventConverter != nullptr) {
-				//	eventConverter->emitWatchpoint(nm.coreId, ts, nm.ict.ckdf, faddr, nm.ict.ckdata[1]);
-				//}
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
-			break;
-		case TraceDqrProfiler::ICT_INFERABLECALL:
-			if (nm.ict.ckdf == 0) {
-				pc = faddr ^ (nm.ict.ckdata[0] << 1);
-				faddr = pc;
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-				TraceDqrProfiler::DQErr rc;
-				TraceDqrProfiler::ADDRESS nextPC;
-				int crFlags;
+	try {
+		m_msg_parser_thread = std::thread(&TraceProfiler::MessageParserThread, this);
+	}
+	catch (...) {
+		printf("Error: TraceProfiler::StartMessagePipeline(): Could not create parser thread\n");
 
-				rc = nextAddr(pc, nextPC, crFlags);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: processTraceMessage(): Could not compute next address for PROFILER_CTF conversion\n");
-					return TraceDqrProfiler::DQERR_ERR;
-				}
+		delete m_msg_queue;
+		m_msg_queue = nullptr;
 
-				// we will store the target address back in ckdata[1] in case it is needed later
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-				nm.ict.ckdata[1] = nextPC;
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-				if (ctf != nullptr) {
-					//ctf->addCall(nm.coreId, pc, nextPC, ts);
-				}
+void TraceProfiler::MessageParserThread()
+{
+	// parse into a message of our own so the decoder is free to change its copy
 
-				//if (eventConverter != nullptr) {
-				//	eventConverter->emitCallRet(nm.coreId, ts, nm.ict.ckdf, pc, nm.ict.ckdata[1], TraceDqrProfiler::isCall);
-				//}
-			}
-			else if (nm.ict.ckdf == 1) {
-				pc = faddr ^ (nm.ict.ckdata[0] << 1);
-				faddr = pc ^ (nm.ict.ckdata[1] << 1);
+	ProfilerNexusMessage msg;
 
-				if ((ctf != nullptr) || (eventConverter != nullptr)) {
-					TraceDqrProfiler::DQErr rc;
-					TraceDqrProfiler::ADDRESS nextPC;
-					int crFlags;
+	for (;;) {
+		TraceMsgRecord* r = m_msg_queue->getWriteSlot();
+		if (r == nullptr) {
+			// decoder is being torn down
+			return;
+		}
+
+		TraceDqrProfiler::DQErr rc = sfp->readNextTraceMsg(msg, analytics, r->haveMsg);
+
+		r->nm = msg;
+		r->rc = rc;
+		r->batch = nullptr;
+
+		m_msg_queue->publish();
+
+		// once readNextTraceMsg() fails it keeps returning the same error, so the record just
+		// published is the last one
+
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return;
+		}
+	}
+}
+
+void TraceProfiler::StopMessagePipeline()
+{
+	if (m_msg_queue == nullptr) {
+		return;
+	}
+
+	// wake the parser thread whether it is waiting for a free slot or for more trace data
+
+	m_msg_queue->close();
+
+	if (sfp != nullptr) {
+		sfp->SetEndOfData();
+	}
+
+	if (m_msg_parser_thread.joinable()) {
+		m_msg_parser_thread.join();
+	}
+
+	delete m_msg_queue;
+	m_msg_queue = nullptr;
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::readNextTraceMsg(ProfilerNexusMessage& msg, bool& haveMsg)
+{
+	if (m_msg_queue == nullptr) {
+		return sfp->readNextTraceMsg(msg, analytics, haveMsg);
+	}
+
+	// a per-core worker is done with its current message once it asks for the next one
+
+	if (m_core_batch != nullptr) {
+		m_core_source->batchDone(m_core_batch);
+		m_core_batch = nullptr;
+	}
+
+	TraceMsgRecord* r = m_msg_queue->getReadSlot();
+	if (r == nullptr) {
+		// queue was closed while waiting. The decoder is being torn down
+
+		haveMsg = false;
+		return TraceDqrProfiler::DQERR_EOF;
+	}
+
+	msg = r->nm;
+	haveMsg = r->haveMsg;
+	m_core_batch = r->batch;
+
+	TraceDqrProfiler::DQErr rc = r->rc;
+
+	// leave the final record in the queue so later calls return the same error, as the parser would
+
+	if (rc == TraceDqrProfiler::DQERR_OK) {
+		m_msg_queue->release();
+	}
+
+	return rc;
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::StartParallelDecode(uint32_t numWorkers, uint64_t segmentSize)
+{
+	if ((sfp == nullptr) || (rtdName == nullptr) || !sfp->isFileInput()) {
+		printf("Error: TraceProfiler::StartParallelDecode(): Parallel decode needs a trace file\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	if ((m_parallel_decoder != nullptr) || (m_msg_queue != nullptr)) {
+		printf("Error: TraceProfiler::StartParallelDecode(): Decoding has already been set up\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	// a segment can only be decoded on its own if nothing carries over from earlier in the trace. Multi-core
+	// traces interleave cores between sync points, and a BTM trace may switch to HTM part way through. Those
+	// are left to the serial decoder
+
+	if ((numWorkers < 2) || (srcbits != 0) || (traceType != TraceDqrProfiler::TRACETYPE_HTM) || (caTrace != nullptr)) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
+	std::vector<TraceSyncPoint> syncPoints;
+
+	TraceDqrProfiler::DQErr rc = sfp->indexSyncPoints(syncPoints);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return rc;
+	}
+
+	if (syncPoints.empty()) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
+	std::vector<TraceProfiler*> decoders;
+
+	for (uint32_t i = 0; i < numWorkers; i++) {
+		TraceProfiler* worker = new (std::nothrow) TraceProfiler(rtdName, efName, instructionInfo.addrSize, instructionInfo.addrDispFlags, srcbits, objdump, freq, m_elf_image);
+		if ((worker == nullptr) || (worker->getStatus() != TraceDqrProfiler::DQERR_OK)) {
+			printf("Error: TraceProfiler::StartParallelDecode(): Could not create worker decoder\n");
+
+			if (worker != nullptr) {
+				delete worker;
+			}
+
+			for (TraceProfiler* d : decoders) {
+				delete d;
+			}
+
+			return TraceDqrProfiler::DQERR_ERR;
+		}
+
+		worker->setTraceType(traceType);
+		worker->setTSSize(tsSize);
+		worker->setPathType(pathType);
+
+		decoders.push_back(worker);
+
+		if (worker->MapTraceFile() != TraceDqrProfiler::DQERR_OK) {
+			for (TraceProfiler* d : decoders) {
+				delete d;
+			}
+
+			return TraceDqrProfiler::DQERR_ERR;
+		}
+	}
+
+	m_parallel_decoder = new (std::nothrow) ParallelTraceDecoder();
+	if (m_parallel_decoder == nullptr) {
+		printf("Error: TraceProfiler::StartParallelDecode(): Could not create parallel decoder\n");
+
+		for (TraceProfiler* d : decoders) {
+			delete d;
+		}
+
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	if (segmentSize == 0) {
+		segmentSize = PARALLEL_DECODE_SEGMENT_SIZE;
+	}
+
+	rc = m_parallel_decoder->start(decoders, syncPoints, sfp->getFileSize(), segmentSize);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		delete m_parallel_decoder;
+		m_parallel_decoder = nullptr;
+
+		return rc;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+void TraceProfiler::StopParallelDecode()
+{
+	if (m_parallel_decoder == nullptr) {
+		return;
+	}
+
+	m_parallel_decoder->stop();
+
+	delete m_parallel_decoder;
+	m_parallel_decoder = nullptr;
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::resetDecoder(uint64_t begin, uint64_t end)
+{
+	// put the decoder back in the state it is in after configure(), reading only [begin, end) of the trace.
+	// Segments start at a sync type message, and processTraceMessage() resets the return stack and counts at
+	// every one of those, so a worker starting on an empty stack is where the serial decoder is at that point
+
+	TraceDqrProfiler::DQErr rc;
+
+	rc = sfp->setInputWindow(begin, end);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return rc;
+	}
+
+	for (int i = 0; i < DQR_PROFILER_MAXCORES; i++) {
+		state[i] = TRACE_STATE_GETFIRSTSYNCMSG;
+		currentAddress[i] = 0;
+		lastFaddr[i] = 0;
+		lastTime[i] = 0;
+		enterISR[i] = TraceDqrProfiler::isNone;
+
+		counts->resetCounts(i);
+		counts->resetStack(i);
+	}
+
+	readNewTraceMessage = true;
+	currentCore = 0;
+
+	status = TraceDqrProfiler::DQERR_OK;
+
+	return status;
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::DecodeSegment(TraceDecodeSegment& segment)
+{
+	TraceDqrProfiler::DQErr rc;
+
+	segment.offsets.clear();
+	segment.addresses.clear();
+	segment.lostSync = false;
+
+	rc = resetDecoder(segment.begin, segment.end);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		segment.rc = rc;
+		return rc;
+	}
+
+	ProfilerInstruction* instInfo = nullptr;
+	ProfilerNexusMessage* msgInfo = nullptr;
+	uint64_t addr = 0;
+	bool skip = segment.skipFirst;
+	enum state lastState = TRACE_STATE_GETFIRSTSYNCMSG;
+
+	for (;;) {
+		m_address_out_set = false;
+
+		rc = NextInstruction(&instInfo, &msgInfo, addr);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			break;
+		}
+
+		lastState = state[currentCore];
+
+		if (skip) {
+			skip = false;
+			continue;
+		}
+
+		if (m_address_out_set) {
+			segment.offsets.push_back(msgInfo->offset | ((uint64_t)1 << 63));
+			segment.addresses.push_back(addr);
+		}
+		else {
+			segment.offsets.push_back(msgInfo->offset);
+		}
+	}
+
+	// the sync message ending the window was read last. If the decoder went back to looking for a sync
+	// it never used that message, and the serial decoder would not start over there either
+
+	segment.lostSync = (rc == TraceDqrProfiler::DQERR_EOF) && (lastState == TRACE_STATE_GETFIRSTSYNCMSG);
+	segment.rc = rc;
+
+	return rc;
+}
+
+ParallelTraceDecoder::ParallelTraceDecoder()
+{
+	nextSegment = 0;
+	readSegment = 0;
+	readIndex = 0;
+	readAddress = 0;
+	stopping = false;
+}
+
+ParallelTraceDecoder::~ParallelTraceDecoder()
+{
+	stop();
+
+	for (TraceProfiler* worker : workers) {
+		delete worker;
+	}
+
+	workers.clear();
+}
+
+TraceDqrProfiler::DQErr ParallelTraceDecoder::start(std::vector<TraceProfiler*>& decoders, std::vector<TraceSyncPoint>& syncPoints, uint64_t traceSize, uint64_t segmentSize)
+{
+	workers = decoders;
+	decoders.clear();
+
+	// each segment starts at a sync message and runs to the end of the sync message starting the next one
+
+	TraceDecodeSegment segment;
+
+	segment.begin = 0;
+	segment.skipFirst = false;
+	segment.rc = TraceDqrProfiler::DQERR_OK;
+	segment.lostSync = false;
+	segment.ready = false;
+
+	for (size_t i = 0; i < syncPoints.size(); i++) {
+		if (syncPoints[i].offset < segment.begin + segmentSize) {
+			continue;
+		}
+
+		segment.end = syncPoints[i].endOffset;
+		segments.push_back(segment);
+
+		segment.begin = syncPoints[i].offset;
+		segment.skipFirst = true;
+	}
+
+	segment.end = traceSize;
+	segments.push_back(segment);
+
+	try {
+		for (TraceProfiler* worker : workers) {
+			workerThreads.push_back(std::thread(&ParallelTraceDecoder::workerThread, this, worker));
+		}
+	}
+	catch (...) {
+		printf("Error: ParallelTraceDecoder::start(): Could not create worker thread\n");
+
+		stop();
+
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+void ParallelTraceDecoder::workerThread(TraceProfiler* worker)
+{
+	uint32_t maxAhead = (uint32_t)workers.size() * PARALLEL_DECODE_SEGMENTS_AHEAD;
+
+	for (;;) {
+		uint32_t seg;
+
+		{
+			std::unique_lock<std::mutex> lock(segmentMutex);
+
+			// stay a bounded number of segments ahead of the reader so decoded results do not pile up
+
+			workAvailable.wait(lock, [this, maxAhead] {
+				return stopping || !redoSegments.empty() || ((nextSegment < segments.size()) && (nextSegment < readSegment + maxAhead));
+			});
+
+			if (stopping) {
+				return;
+			}
+
+			if (!redoSegments.empty()) {
+				seg = redoSegments.front();
+				redoSegments.pop_front();
+			}
+			else {
+				seg = nextSegment;
+				nextSegment += 1;
+			}
+		}
+
+		// segments[seg] is only touched by this thread until it is marked ready
+
+		worker->DecodeSegment(segments[seg]);
+
+		{
+			std::lock_guard<std::mutex> lock(segmentMutex);
+			segments[seg].ready = true;
+		}
+
+		segmentDone.notify_all();
+	}
+}
+
+TraceDqrProfiler::DQErr ParallelTraceDecoder::next(uint64_t& offset, uint64_t& address, bool& haveAddress)
+{
+	for (;;) {
+		if (readSegment >= segments.size()) {
+			return TraceDqrProfiler::DQERR_EOF;
+		}
+
+		TraceDecodeSegment& segment = segments[readSegment];
+
+		{
+			std::unique_lock<std::mutex> lock(segmentMutex);
+			segmentDone.wait(lock, [&segment] { return segment.ready; });
+		}
+
+		if (readIndex < segment.offsets.size()) {
+			uint64_t v = segment.offsets[readIndex];
+
+			offset = v & ~((uint64_t)1 << 63);
+			haveAddress = (v >> 63) != 0;
+			if (haveAddress) {
+				address = segment.addresses[readAddress];
+				readAddress += 1;
+			}
+
+			readIndex += 1;
+
+			return TraceDqrProfiler::DQERR_OK;
+		}
+
+		// results of this segment are used up. Either stop where the serial decoder would have stopped, or go on
+
+		if (segment.rc != TraceDqrProfiler::DQERR_EOF) {
+			return segment.rc;
+		}
+
+		bool lostSync = segment.lostSync;
+		uint64_t end = segment.end;
+
+		std::vector<uint64_t>().swap(segment.offsets);
+		std::vector<uint64_t>().swap(segment.addresses);
+
+		{
+			std::lock_guard<std::mutex> lock(segmentMutex);
+
+			readSegment += 1;
+			readIndex = 0;
+			readAddress = 0;
+		}
+
+		workAvailable.notify_all();
+
+		if (lostSync && (readSegment < segments.size())) {
+			// the serial decoder dropped the sync message the next segment starts with and went looking for
+			// another one. Throw away that segment and decode it again starting just past the dropped message
+
+			TraceDecodeSegment& redo = segments[readSegment];
+
+			{
+				std::unique_lock<std::mutex> lock(segmentMutex);
+				segmentDone.wait(lock, [&redo] { return redo.ready; });
+
+				redo.begin = end;
+				redo.skipFirst = false;
+				redo.ready = false;
+
+				redoSegments.push_back(readSegment);
+			}
+
+			workAvailable.notify_all();
+		}
+	}
+}
+
+void ParallelTraceDecoder::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(segmentMutex);
+		stopping = true;
+	}
+
+	workAvailable.notify_all();
+
+	for (std::thread& t : workerThreads) {
+		if (t.joinable()) {
+			t.join();
+		}
+	}
+
+	workerThreads.clear();
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::StartCoreDecode()
+{
+	if (sfp == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	if ((m_parallel_decoder != nullptr) || (m_core_decoder != nullptr)) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
+	if (m_msg_queue != nullptr) {
+		printf("Error: TraceProfiler::StartCoreDecode(): Decoding has already been set up\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	// cores only share state in the decoder when a BTM trace switches to HTM, or through the cycle accurate
+	// trace. Those, and single core traces, are left to the serial decoder
+
+	if ((srcbits == 0) || (traceType != TraceDqrProfiler::TRACETYPE_HTM) || (caTrace != nullptr)) {
+		return TraceDqrProfiler::DQERR_OK;
+	}
+
+	int numCores = 1 << srcbits;
+	if (numCores > DQR_PROFILER_MAXCORES) {
+		numCores = DQR_PROFILER_MAXCORES;
+	}
+
+	std::vector<TraceProfiler*> decoders;
+	bool failed = false;
+
+	for (int i = 0; (i < numCores) && !failed; i++) {
+		// workers only get trace messages through their queue, so they do not need a trace file
+
+		TraceProfiler* worker = new (std::nothrow) TraceProfiler(nullptr, efName, instructionInfo.addrSize, instructionInfo.addrDispFlags, srcbits, objdump, freq, m_elf_image);
+		if ((worker == nullptr) || (worker->getStatus() != TraceDqrProfiler::DQERR_OK)) {
+			printf("Error: TraceProfiler::StartCoreDecode(): Could not create worker decoder\n");
+
+			if (worker != nullptr) {
+				delete worker;
+			}
+
+			failed = true;
+			break;
+		}
+
+		worker->setTraceType(traceType);
+		worker->setTSSize(tsSize);
+		worker->setPathType(pathType);
+
+		decoders.push_back(worker);
+
+		worker->m_msg_queue = new (std::nothrow) TraceMsgQueue(TRACE_MSG_QUEUE_SIZE);
+		if ((worker->m_msg_queue == nullptr) || (worker->m_msg_queue->getErr() != TraceDqrProfiler::DQERR_OK)) {
+			printf("Error: TraceProfiler::StartCoreDecode(): Could not create message queue\n");
+
+			failed = true;
+		}
+	}
+
+	if (!failed) {
+		m_core_decoder = new (std::nothrow) CoreTraceDecoder();
+		if (m_core_decoder == nullptr) {
+			printf("Error: TraceProfiler::StartCoreDecode(): Could not create per-core decoder\n");
+
+			failed = true;
+		}
+	}
+
+	if (failed) {
+		for (TraceProfiler* d : decoders) {
+			delete d;
+		}
+
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	TraceDqrProfiler::DQErr rc = m_core_decoder->start(this, decoders);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		delete m_core_decoder;
+		m_core_decoder = nullptr;
+
+		return rc;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+void TraceProfiler::StopCoreDecode()
+{
+	if (m_core_decoder == nullptr) {
+		return;
+	}
+
+	m_core_decoder->stop();
+
+	delete m_core_decoder;
+	m_core_decoder = nullptr;
+}
+
+CoreTraceDecoder::CoreTraceDecoder()
+{
+	source = nullptr;
+	batches = nullptr;
+	batchMask = 0;
+	head = 0;
+	tail = 0;
+	readIndex = 0;
+	readAddress = 0;
+	stopping = false;
+}
+
+CoreTraceDecoder::~CoreTraceDecoder()
+{
+	stop();
+
+	// workers own their message queues and delete them in cleanUp()
+
+	for (TraceProfiler* worker : workers) {
+		delete worker;
+	}
+
+	workers.clear();
+
+	if (batches != nullptr) {
+		delete[] batches;
+		batches = nullptr;
+	}
+}
+
+TraceDqrProfiler::DQErr CoreTraceDecoder::start(TraceProfiler* source, std::vector<TraceProfiler*>& decoders)
+{
+	this->source = source;
+
+	workers = decoders;
+	decoders.clear();
+
+	batches = new (std::nothrow) TraceCoreBatch[CORE_DECODE_QUEUE_SIZE];
+	if (batches == nullptr) {
+		printf("Error: CoreTraceDecoder::start(): Could not allocate batches\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	batchMask = CORE_DECODE_QUEUE_SIZE - 1;
+
+	for (TraceProfiler* worker : workers) {
+		worker->m_core_source = this;
+	}
+
+	try {
+		for (TraceProfiler* worker : workers) {
+			workerThreads.push_back(std::thread(&CoreTraceDecoder::workerThread, this, worker));
+		}
+
+		demuxThread = std::thread(&CoreTraceDecoder::demultiplexThread, this);
+	}
+	catch (...) {
+		printf("Error: CoreTraceDecoder::start(): Could not create decode thread\n");
+
+		stop();
+
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+void CoreTraceDecoder::demultiplexThread()
+{
+	ProfilerNexusMessage msg;
+	int core = 0;
+
+	for (;;) {
+		TraceCoreBatch* batch;
+
+		{
+			std::unique_lock<std::mutex> lock(batchMutex);
+
+			batchFree.wait(lock, [this] { return stopping || ((head - tail) <= batchMask); });
+
+			if (stopping) {
+				return;
+			}
+
+			batch = &batches[head & batchMask];
+		}
+
+		// batch is not visible to next() until head moves past it
+
+		bool haveMsg;
+		TraceDqrProfiler::DQErr rc = source->sfp->readNextTraceMsg(msg, source->analytics, haveMsg);
+
+		batch->offset = msg.offset;
+		batch->rc = TraceDqrProfiler::DQERR_OK;
+		batch->done = false;
+		batch->haveAddress.clear();
+		batch->addresses.clear();
+
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			// every worker gets the final parser result so it stops reading. The batch is only there to
+			// hand the result to next()
+
+			for (TraceProfiler* worker : workers) {
+				TraceMsgRecord* r = worker->m_msg_queue->getWriteSlot();
+				if (r == nullptr) {
+					return;
+				}
+
+				r->nm = msg;
+				r->rc = rc;
+				r->haveMsg = false;
+				r->batch = nullptr;
+
+				worker->m_msg_queue->publish();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(batchMutex);
+
+				batch->rc = rc;
+				batch->done = true;
+				head += 1;
+			}
+
+			batchReady.notify_all();
+
+			return;
+		}
+
+		// a gap in the trace (no message) resets the core of the previous message, as in the serial decoder
+
+		if (haveMsg) {
+			core = msg.coreId;
+		}
+
+		if (core >= (int)workers.size()) {
+			core = 0;
+		}
+
+		TraceMsgRecord* r = workers[core]->m_msg_queue->getWriteSlot();
+		if (r == nullptr) {
+			return;
+		}
+
+		r->nm = msg;
+		r->rc = rc;
+		r->haveMsg = haveMsg;
+		r->batch = batch;
+
+		workers[core]->m_msg_queue->publish();
+
+		{
+			std::lock_guard<std::mutex> lock(batchMutex);
+			head += 1;
+		}
+
+		batchReady.notify_all();
+	}
+}
+
+void CoreTraceDecoder::workerThread(TraceProfiler* worker)
+{
+	ProfilerInstruction* instInfo = nullptr;
+	ProfilerNexusMessage* msgInfo = nullptr;
+	uint64_t addr = 0;
+	TraceDqrProfiler::DQErr rc;
+
+	for (;;) {
+		worker->m_address_out_set = false;
+
+		rc = worker->NextInstruction(&instInfo, &msgInfo, addr);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			break;
+		}
+
+		TraceCoreBatch* batch = worker->m_core_batch;
+		if (batch == nullptr) {
+			continue;
+		}
+
+		if (worker->m_address_out_set) {
+			batch->haveAddress.push_back(1);
+			batch->addresses.push_back(addr);
+		}
+		else {
+			batch->haveAddress.push_back(0);
+		}
+	}
+
+	// at the end of the trace the batch was already handed back when the final result was read. Otherwise
+	// the decoder stopped on its current message, and next() stops there too
+
+	if (worker->m_core_batch != nullptr) {
+		worker->m_core_batch->rc = rc;
+
+		batchDone(worker->m_core_batch);
+		worker->m_core_batch = nullptr;
+	}
+}
+
+void CoreTraceDecoder::batchDone(TraceCoreBatch* batch)
+{
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		batch->done = true;
+	}
+
+	batchReady.notify_all();
+}
+
+TraceDqrProfiler::DQErr CoreTraceDecoder::next(uint64_t& offset, uint64_t& address, bool& haveAddress)
+{
+	for (;;) {
+		TraceCoreBatch* batch = &batches[tail & batchMask];
+
+		{
+			std::unique_lock<std::mutex> lock(batchMutex);
+			batchReady.wait(lock, [this, batch] { return (head != tail) && batch->done; });
+		}
+
+		if (readIndex < batch->haveAddress.size()) {
+			offset = batch->offset;
+			haveAddress = batch->haveAddress[readIndex] != 0;
+			if (haveAddress) {
+				address = batch->addresses[readAddress];
+				readAddress += 1;
+			}
+
+			readIndex += 1;
+
+			return TraceDqrProfiler::DQERR_OK;
+		}
+
+		// keep returning the result decoding stopped with, as the serial decoder does
+
+		if (batch->rc != TraceDqrProfiler::DQERR_OK) {
+			return batch->rc;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(batchMutex);
+
+			tail += 1;
+			readIndex = 0;
+			readAddress = 0;
+		}
+
+		batchFree.notify_all();
+	}
+}
+
+void CoreTraceDecoder::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		stopping = true;
+	}
+
+	batchFree.notify_all();
+
+	// wake the demultiplexer whether it is waiting for room in a queue or for more trace data, and any worker
+	// waiting for a message
+
+	for (TraceProfiler* worker : workers) {
+		if (worker->m_msg_queue != nullptr) {
+			worker->m_msg_queue->close();
+		}
+	}
+
+	if ((source != nullptr) && (source->sfp != nullptr)) {
+		source->sfp->SetEndOfData();
+	}
+
+	if (demuxThread.joinable()) {
+		demuxThread.join();
+	}
+
+	for (std::thread& t : workerThreads) {
+		if (t.joinable()) {
+			t.join();
+		}
+	}
+
+	workerThreads.clear();
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::processTraceMessage(ProfilerNexusMessage& nm, TraceDqrProfiler::ADDRESS& pc, TraceDqrProfiler::ADDRESS& faddr, TraceDqrProfiler::TIMESTAMP& ts, bool& consumed)
+{
+	consumed = false;
+
+	switch (nm.tcode) {
+	case TraceDqrProfiler::TCODE_ERROR:
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
+		}
+
+		// set addrs to 0 because we have dropped some messages and don't know what is going on
+
+		faddr = 0;
+		pc = 0;
+		break;
+	case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
+		}
+
+		if (perfConverter != nullptr) { // or should this be a general itc process thing?? could we process all itc messages here?
+			TraceDqrProfiler::DQErr rc;
+			//rc = perfConverter->processITCPerf(nm.coreId, ts, nm.dataAcquisition.idTag, nm.dataAcquisition.data, consumed);
+			//if (rc != TraceDqrProfiler::DQERR_OK) {
+			//	return rc;
+			//}
+		}
+		break;
+	case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+	case TraceDqrProfiler::TCODE_RESOURCEFULL:
+	case TraceDqrProfiler::TCODE_CORRELATION:
+	case TraceDqrProfiler::TCODE_REPEATBRANCH:
+	case TraceDqrProfiler::TCODE_TRAP_INFO:	
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
+		}
+		break;
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
+		}
+		faddr = faddr ^ (nm.indirectBranch.u_addr << 1);
+		pc = faddr;
+		break;
+	case TraceDqrProfiler::TCODE_SYNC:
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
+		}
+		faddr = nm.sync.f_addr << 1;
+		pc = faddr;
+		counts->resetStack(nm.coreId);
+		counts->resetCounts(nm.coreId);
+		break;
+	case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
+		}
+		faddr = nm.directBranchWS.f_addr << 1;
+		pc = faddr;
+		counts->resetStack(nm.coreId);
+		counts->resetCounts(nm.coreId);
+		break;
+	case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
+		}
+		faddr = nm.indirectBranchWS.f_addr << 1;
+		pc = faddr;
+		counts->resetStack(nm.coreId);
+		counts->resetCounts(nm.coreId);
+		break;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
+		}
+		faddr = faddr ^ (nm.indirectHistory.u_addr << 1);
+		pc = faddr;
+		break;
+	case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
+		}
+		faddr = nm.indirectHistoryWS.f_addr << 1;
+		pc = faddr;
+		counts->resetStack(nm.coreId);
+		counts->resetCounts(nm.coreId);
+		break;
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+		// for 8, 0; 14, 0 do not update pc, only faddr. 0, 0 has no address, so it never updates
+		// this is because those message types all appear in instruction traces (non-event) and
+		// do not want to update the current address because they have no icnt to say when to do it
+
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_rel, ts, nm.timestamp);
+		}
+
+		switch (nm.ict.cksrc) {
+		case TraceDqrProfiler::ICT_EXT_TRIG:
+			if (nm.ict.ckdf == 0) {
+				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
+				// don't update pc
+
+				//if (eventConverter != nullptr) {
+				//	eventConverter->emitExtTrigEvent(nm.coreId, ts, nm.ict.ckdf, faddr, 0);
+				//}
+			}
+			else if (nm.ict.ckdf == 1) {
+				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
+				pc = faddr;
+
+				//if (eventConverter != nullptr) {
+				//	eventConverter->emitExtTrigEvent(nm.coreId, ts, nm.ict.ckdf, faddr, nm.ict.ckdata[1]);
+				//}
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+			break;
+		case TraceDqrProfiler::ICT_WATCHPOINT:
+			if (nm.ict.ckdf == 0) {
+				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
+				// don't update pc
+
+				//if (eventConverter != nullptr) {
+				//	eventConverter->emitWatchpoint(nm.coreId, ts, nm.ict.ckdf, faddr, 0);
+				//}
+			}
+			else if (nm.ict.ckdf == 1) {
+				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
+				pc = faddr;
+
+				//if (eventConverter != nullptr) {
+				//	eventConverter->emitWatchpoint(nm.coreId, ts, nm.ict.ckdf, faddr, nm.ict.ckdata[1]);
+				//}
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+			break;
+		case TraceDqrProfiler::ICT_INFERABLECALL:
+			if (nm.ict.ckdf == 0) {
+				pc = faddr ^ (nm.ict.ckdata[0] << 1);
+				faddr = pc;
+
+				TraceDqrProfiler::DQErr rc;
+				TraceDqrProfiler::ADDRESS nextPC;
+				int crFlags;
+
+				rc = nextAddr(pc, nextPC, crFlags);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: processTraceMessage(): Could not compute next address for PROFILER_CTF conversion\n");
+					return TraceDqrProfiler::DQERR_ERR;
+				}
+
+				// we will store the target address back in ckdata[1] in case it is needed later
+
+				nm.ict.ckdata[1] = nextPC;
+
+				if (ctf != nullptr) {
+					//ctf->addCall(nm.coreId, pc, nextPC, ts);
+				}
+
+				//if (eventConverter != nullptr) {
+				//	eventConverter->emitCallRet(nm.coreId, ts, nm.ict.ckdf, pc, nm.ict.ckdata[1], TraceDqrProfiler::isCall);
+				//}
+			}
+			else if (nm.ict.ckdf == 1) {
+				pc = faddr ^ (nm.ict.ckdata[0] << 1);
+				faddr = pc ^ (nm.ict.ckdata[1] << 1);
+
+				if ((ctf != nullptr) || (eventConverter != nullptr)) {
+					TraceDqrProfiler::DQErr rc;
+					TraceDqrProfiler::ADDRESS nextPC;
+					int crFlags;
+
+					rc = nextAddr(pc, nextPC, crFlags);
+					if (rc != TraceDqrProfiler::DQERR_OK) {
+						printf("Error: processTraceMessage(): Could not compute next address for PROFILER_CTF conversion\n");
+						return TraceDqrProfiler::DQERR_ERR;
+					}
+
+					if (ctf != nullptr) {
+						if (crFlags & TraceDqrProfiler::isCall) {
+							//ctf->addCall(nm.coreId, pc, faddr, ts);
+						}
+						else if ((crFlags & TraceDqrProfiler::isReturn) || (crFlags & TraceDqrProfiler::isExceptionReturn)) {
+							//ctf->addRet(nm.coreId, pc, faddr, ts);
+						}
+						else {
+							printf("Error: processTraceMEssage(): Unsupported crFlags in PROFILER_CTF conversion\n");
+							return TraceDqrProfiler::DQERR_ERR;
+						}
+					}
+
+					//if (eventConverter != nullptr) {
+					//	eventConverter->emitCallRet(nm.coreId, ts, nm.ict.ckdf, pc, faddr, crFlags);
+					//}
+				}
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+			break;
+		case TraceDqrProfiler::ICT_EXCEPTION:
+			if (nm.ict.ckdf == 1) {
+				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
+				pc = faddr;
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+
+			if (eventConverter != nullptr) {
+				//eventConverter->emitException(nm.coreId, ts, nm.ict.ckdf, pc, nm.ict.ckdata[1]);
+			}
+			break;
+		case TraceDqrProfiler::ICT_INTERRUPT:
+			if (nm.ict.ckdf == 1) {
+				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
+				pc = faddr;
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+
+			if (eventConverter != nullptr) {
+				//eventConverter->emitInterrupt(nm.coreId, ts, nm.ict.ckdf, pc, nm.ict.ckdata[1]);
+			}
+			break;
+		case TraceDqrProfiler::ICT_CONTEXT:
+			if (nm.ict.ckdf == 1) {
+				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
+				pc = faddr;
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+
+			if (eventConverter != nullptr) {
+				//eventConverter->emitContext(nm.coreId, ts, nm.ict.ckdf, pc, nm.ict.ckdata[1]);
+			}
+			break;
+		case TraceDqrProfiler::ICT_PC_SAMPLE:
+			if (nm.ict.ckdf == 0) {
+				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
+				pc = faddr;
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+
+			if (eventConverter != nullptr) {
+				//eventConverter->emitPeriodic(nm.coreId, ts, nm.ict.ckdf, pc);
+			}
+			break;
+		case TraceDqrProfiler::ICT_CONTROL:
+			if (nm.ict.ckdf == 0) {
+				// nothing to do - no address
+				// does not update faddr or pc!
+
+				if (eventConverter != nullptr) {
+					//eventConverter->emitControl(nm.coreId, ts, nm.ict.ckdf, nm.ict.ckdata[0], 0);
+				}
+			}
+			else if (nm.ict.ckdf == 1) {
+				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
+				pc = faddr;
+
+				if (eventConverter != nullptr) {
+					//eventConverter->emitControl(nm.coreId, ts, nm.ict.ckdf, nm.ict.ckdata[1], pc);
+				}
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+			break;
+		default:
+			printf("Error: processTraceMessage(): Invalid ICT Event: %d\n", nm.ict.cksrc);
+			return TraceDqrProfiler::DQERR_ERR;
+		}
+		break;
+	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+		// for 8, 0; 14, 0 do not update pc, only faddr. 0, 0 has no address, so it never updates
+		// this is because those message types all apprear in instruction traces (non-event) and
+		// do not want to update the current address because they have no icnt to say when to do it
+
+		if (nm.haveTimestamp) {
+			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
+		}
+
+		switch (nm.ictWS.cksrc) {
+		case TraceDqrProfiler::ICT_EXT_TRIG:
+			if (nm.ictWS.ckdf == 0) {
+				faddr = nm.ictWS.ckdata[0] << 1;
+				// don't update pc
+
+				if (eventConverter != nullptr) {
+					//eventConverter->emitExtTrigEvent(nm.coreId, ts, nm.ictWS.ckdf, faddr, 0);
+				}
+			}
+			else if (nm.ictWS.ckdf == 1) {
+				faddr = nm.ictWS.ckdata[0] << 1;
+				pc = faddr;
+
+				if (eventConverter != nullptr) {
+					//eventConverter->emitExtTrigEvent(nm.coreId, ts, nm.ictWS.ckdf, faddr, nm.ictWS.ckdata[1]);
+				}
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+			break;
+		case TraceDqrProfiler::ICT_WATCHPOINT:
+			if (nm.ictWS.ckdf == 0) {
+				faddr = nm.ictWS.ckdata[0] << 1;
+				// don'tupdate pc
+
+				if (eventConverter != nullptr) {
+					//eventConverter->emitWatchpoint(nm.coreId, ts, nm.ictWS.ckdf, faddr, 0);
+				}
+			}
+			else if (nm.ictWS.ckdf <= 1) {
+				faddr = nm.ictWS.ckdata[0] << 1;
+				pc = faddr;
+
+				if (eventConverter != nullptr) {
+					//eventConverter->emitWatchpoint(nm.coreId, ts, nm.ictWS.ckdf, faddr, nm.ictWS.ckdata[1]);
+				}
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+			break;
+		case TraceDqrProfiler::ICT_INFERABLECALL:
+			if (nm.ictWS.ckdf == 0) {
+				pc = nm.ictWS.ckdata[0] << 1;
+				faddr = pc;
+
+				TraceDqrProfiler::DQErr rc;
+				TraceDqrProfiler::ADDRESS nextPC;
+				int crFlags;
+
+				rc = nextAddr(pc, nextPC, crFlags);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: processTraceMessage(): Could not compute next address for PROFILER_CTF conversion\n");
+					return TraceDqrProfiler::DQERR_ERR;
+				}
+
+				// we will store the target address back in ckdata[1] in case it is needed later
+
+				nm.ict.ckdata[1] = nextPC;
+
+				if (ctf != nullptr) {
+					//ctf->addCall(nm.coreId, pc, nextPC, ts);
+				}
+
+				if (eventConverter != nullptr) {
+					//eventConverter->emitCallRet(nm.coreId, ts, nm.ictWS.ckdf, pc, faddr, TraceDqrProfiler::isCall);
+				}
+			}
+			else if (nm.ictWS.ckdf == 1) {
+				pc = nm.ictWS.ckdata[0] << 1;
+				faddr = pc ^ (nm.ictWS.ckdata[1] << 1);
+
+				if ((ctf != nullptr) || (eventConverter != nullptr)) {
+					TraceDqrProfiler::DQErr rc;
+					TraceDqrProfiler::ADDRESS nextPC;
+					int crFlags;
 
 					rc = nextAddr(pc, nextPC, crFlags);
 					if (rc != TraceDqrProfiler::DQERR_OK) {
-						printf("Error: processTraceMessage(): Could not compute next address for PROFILER_CTF conversion\n");
-						return TraceDqrProfiler::DQERR_ERR;
+						printf("Error: processTraceMessage(): Could not compute next address for PROFILER_CTF conversion\n");
+						return TraceDqrProfiler::DQERR_ERR;
+					}
+
+					if (ctf != nullptr) {
+						if (crFlags & TraceDqrProfiler::isCall) {
+							//ctf->addCall(nm.coreId, pc, faddr, ts);
+						}
+						else if ((crFlags & TraceDqrProfiler::isReturn) || (crFlags & TraceDqrProfiler::isExceptionReturn)) {
+							//ctf->addRet(nm.coreId, pc, faddr, ts);
+						}
+						else {
+							printf("Error: processTraceMEssage(): Unsupported crFlags in PROFILER_CTF conversion\n");
+							return TraceDqrProfiler::DQERR_ERR;
+						}
+					}
+
+					if (eventConverter != nullptr) {
+						//eventConverter->emitCallRet(nm.coreId, ts, nm.ictWS.ckdf, pc, faddr, crFlags);
+					}
+				}
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+			break;
+		case TraceDqrProfiler::ICT_EXCEPTION:
+			if (nm.ictWS.ckdf == 1) {
+				faddr = nm.ictWS.ckdata[0] << 1;
+				pc = faddr;
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+
+			if (eventConverter != nullptr) {
+				//eventConverter->emitException(nm.coreId, ts, nm.ictWS.ckdf, pc, nm.ictWS.ckdata[1]);
+			}
+			break;
+		case TraceDqrProfiler::ICT_INTERRUPT:
+			if (nm.ictWS.ckdf == 1) {
+				faddr = nm.ictWS.ckdata[0] << 1;
+				pc = faddr;
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+
+			if (eventConverter != nullptr) {
+				//eventConverter->emitInterrupt(nm.coreId, ts, nm.ictWS.ckdf, pc, nm.ictWS.ckdata[1]);
+			}
+			break;
+		case TraceDqrProfiler::ICT_CONTEXT:
+			if (nm.ictWS.ckdf == 1) {
+				faddr = nm.ictWS.ckdata[0] << 1;
+				pc = faddr;
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+
+			if (eventConverter != nullptr) {
+				//eventConverter->emitContext(nm.coreId, ts, nm.ictWS.ckdf, pc, nm.ictWS.ckdata[1]);
+			}
+			break;
+		case TraceDqrProfiler::ICT_PC_SAMPLE:
+			if (nm.ictWS.ckdf == 0) {
+				faddr = nm.ictWS.ckdata[0] << 1;
+				pc = faddr;
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+
+			if (eventConverter != nullptr) {
+				//eventConverter->emitPeriodic(nm.coreId, ts, nm.ictWS.ckdf, pc);
+			}
+			break;
+		case TraceDqrProfiler::ICT_CONTROL:
+			if (nm.ictWS.ckdf == 0) {
+				// nothing to do
+				// does not update faddr or pc!
+
+				if (eventConverter != nullptr) {
+					//eventConverter->emitControl(nm.coreId, ts, nm.ictWS.ckdf, nm.ictWS.ckdata[0], 0);
+				}
+			}
+			else if (nm.ictWS.ckdf == 1) {
+				faddr = nm.ictWS.ckdata[0] << 1;
+				pc = faddr;
+
+				if (eventConverter != nullptr) {
+					//eventConverter->emitControl(nm.coreId, ts, nm.ictWS.ckdf, nm.ictWS.ckdata[1], pc);
+				}
+			}
+			else {
+				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
+				return TraceDqrProfiler::DQERR_ERR;
+			}
+			break;
+		default:
+			printf("Error: processTraceMessage(): Invalid ICT Event: %d\n", nm.ictWS.cksrc);
+			return TraceDqrProfiler::DQERR_ERR;
+		}
+		break;
+	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+	case TraceDqrProfiler::TCODE_DEVICE_ID:
+	case TraceDqrProfiler::TCODE_DATA_WRITE:
+	case TraceDqrProfiler::TCODE_DATA_READ:
+	case TraceDqrProfiler::TCODE_CORRECTION:
+	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+	case TraceDqrProfiler::TCODE_DATA_READ_WS:
+	case TraceDqrProfiler::TCODE_WATCHPOINT:
+	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+	case TraceDqrProfiler::TCODE_UNDEFINED:
+	default:
+		printf("Error: TraceProfiler::processTraceMessage(): Unsupported TCODE\n");
+
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::getInstructionByAddress(TraceDqrProfiler::ADDRESS addr, ProfilerInstruction* instInfo, ProfilerSource* srcInfo, int* flags)
+{
+	TraceDqrProfiler::DQErr rc;
+
+	rc = Disassemble(addr); // should error check disassembl() call!
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
+
+	*flags = 0;
+
+	if (instInfo != nullptr) {
+		instructionInfo.qDepth = 0;
+		instructionInfo.arithInProcess = 0;
+		instructionInfo.loadInProcess = 0;
+		instructionInfo.storeInProcess = 0;
+
+		instructionInfo.coreId = 0;
+		*instInfo = instructionInfo;
+		instInfo->CRFlag = TraceDqrProfiler::isNone;
+		instInfo->brFlags = TraceDqrProfiler::BRFLAG_none;
+
+		instInfo->timestamp = lastTime[currentCore];
+
+		rc = resolveInstructionText(instInfo);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return TraceDqrProfiler::DQERR_ERR;
+		}
+
+		*flags |= TraceDqrProfiler::TRACE_HAVE_INSTINFO;
+	}
+
+	if (srcInfo != nullptr) {
+		sourceInfo.coreId = 0;
+		*srcInfo = sourceInfo;
+
+		rc = resolveSourceInfo(addr, srcInfo);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return TraceDqrProfiler::DQERR_ERR;
+		}
+
+		*flags |= TraceDqrProfiler::TRACE_HAVE_SRCINFO;
+	}
+
+	return TraceDqrProfiler::DQERR_OK;
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction* instInfo, ProfilerNexusMessage* msgInfo, ProfilerSource* srcInfo, int* flags)
+{
+	TraceDqrProfiler::DQErr ec;
+
+	ProfilerInstruction* instInfop = nullptr;
+	ProfilerNexusMessage* msgInfop = nullptr;
+	ProfilerSource* srcInfop = nullptr;
+
+	ProfilerInstruction** instInfopp = nullptr;
+	ProfilerNexusMessage** msgInfopp = nullptr;
+	ProfilerSource** srcInfopp = nullptr;
+
+	if (instInfo != nullptr) {
+		instInfopp = &instInfop;
+	}
+
+	if (msgInfo != nullptr) {
+		msgInfopp = &msgInfop;
+	}
+
+	if (srcInfo != nullptr) {
+		srcInfopp = &srcInfop;
+	}
+
+	ec = NextInstruction(instInfopp, msgInfopp, srcInfopp);
+
+	*flags = 0;
+
+	if (ec == TraceDqrProfiler::DQERR_OK) {
+		if (instInfo != nullptr) {
+			if (instInfop != nullptr) {
+				*instInfo = *instInfop;
+				*flags |= TraceDqrProfiler::TRACE_HAVE_INSTINFO;
+			}
+		}
+
+		if (msgInfo != nullptr) {
+			if (msgInfop != nullptr) {
+				*msgInfo = *msgInfop;
+				*flags |= TraceDqrProfiler::TRACE_HAVE_MSGINFO;
+			}
+		}
+
+		if (srcInfo != nullptr) {
+			if (srcInfop != nullptr) {
+				*srcInfo = *srcInfop;
+				*flags |= TraceDqrProfiler::TRACE_HAVE_SRCINFO;
+			}
+		}
+
+		if (itcPrint != nullptr) {
+			if (itcPrint->haveITCPrintMsgs() != false) {
+				*flags |= TraceDqrProfiler::TRACE_HAVE_ITCPRINTINFO;
+			}
+		}
+	}
+
+	return ec;
+}
+TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** instInfo, ProfilerNexusMessage **nm_out, uint64_t& address_out)
+{
+	if (status != TraceDqrProfiler::DQERR_OK) 
+	{
+		return status;
+	}
+
+	if ((m_parallel_decoder != nullptr) || (m_core_decoder != nullptr)) {
+		// replay what the workers recorded. Only the message offset and the address are available
+
+		uint64_t offset;
+		uint64_t addr;
+		bool haveAddr;
+
+		if (m_parallel_decoder != nullptr) {
+			status = m_parallel_decoder->next(offset, addr, haveAddr);
+		}
+		else {
+			status = m_core_decoder->next(offset, addr, haveAddr);
+		}
+		if (status != TraceDqrProfiler::DQERR_OK) {
+			state[currentCore] = (status == TraceDqrProfiler::DQERR_EOF) ? TRACE_STATE_DONE : TRACE_STATE_ERROR;
+			return status;
+		}
+
+		nm.offset = offset;
+		*nm_out = &nm;
+
+		if (haveAddr) {
+			address_out = addr;
+		}
+
+		return status;
+	}
+
+	TraceDqrProfiler::DQErr rc;
+	TraceDqrProfiler::ADDRESS addr;
+	int crFlag;
+	TraceDqrProfiler::BranchFlags brFlags;
+	uint32_t caFlags = 0;
+	uint32_t pipeCycles = 0;
+	uint32_t viStartCycles = 0;
+	uint32_t viFinishCycles = 0;
+
+	uint8_t qDepth = 0;
+	uint8_t arithInProcess = 0;
+	uint8_t loadInProcess = 0;
+	uint8_t storeInProcess = 0;
+
+	bool consumed = false;
+
+	ProfilerInstruction** savedInstPtr = nullptr;
+	ProfilerNexusMessage** savedMsgPtr = nullptr;
+	ProfilerSource** savedSrcPtr = nullptr;
+
+	//if (instInfo != nullptr) 
+	//{
+	//	*instInfo = nullptr;
+	//}
+
+	for (;;) {
+		//		need to set readNewTraceMessage where it is needed! That includes
+		//		staying in the same state that expects to get another message!!
+
+		bool haveMsg;
+
+		if (savedInstPtr != nullptr) {
+			instInfo = savedInstPtr;
+			savedInstPtr = nullptr;
+		}
+
+		if (readNewTraceMessage != false) 
+		{
+			do 
+			{
+				rc = readNextTraceMsg(nm, haveMsg);
+
+				if (rc != TraceDqrProfiler::DQERR_OK) 
+				{
+					// have an error. either EOF, or error
+
+					status = rc;
+
+					if (status == TraceDqrProfiler::DQERR_EOF) {
+						state[currentCore] = TRACE_STATE_DONE;
+					}
+					else {
+						printf("Error: TraceProfiler file does not contain any trace messages, or is unreadable\n");
+
+						state[currentCore] = TRACE_STATE_ERROR;
+					}
+
+					return status;
+				}
+
+				if (haveMsg == false) 
+				{
+					lastTime[currentCore] = 0;
+					currentAddress[currentCore] = 0;
+					lastFaddr[currentCore] = 0;
+
+					state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+				}
+			} while (haveMsg == false);
+
+			readNewTraceMessage = false;
+			currentCore = nm.coreId;
+            *nm_out = &nm;
+
+			// if set see if HTM trace message, switch to HTM mode
+
+			if (traceType != TraceDqrProfiler::TRACETYPE_HTM) {
+				switch (nm.tcode) {
+				case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+				case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+				case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+				case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+				case TraceDqrProfiler::TCODE_ERROR:
+				case TraceDqrProfiler::TCODE_SYNC:
+				case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+				case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+				case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+				case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+				case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+				case TraceDqrProfiler::TCODE_REPEATBRANCH:
+				case TraceDqrProfiler::TCODE_TRAP_INFO:				
+					break;
+				case TraceDqrProfiler::TCODE_CORRELATION:
+					if (nm.correlation.cdf == 1) {
+						traceType = TraceDqrProfiler::TRACETYPE_HTM;
+						if (profiler_globalDebugFlag) printf("TCODE_CORRELATION, cdf == 1: switching to HTM mode\n");
+					}
+					break;
+				case TraceDqrProfiler::TCODE_RESOURCEFULL:
+				case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+				case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+					traceType = TraceDqrProfiler::TRACETYPE_HTM;
+					if (profiler_globalDebugFlag) printf("History/taken/not taken count TCODE: switching to HTM mode\n");
+					break;
+				case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+				case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+				case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+				case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+				case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+				case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+				case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+				case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+				case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+				case TraceDqrProfiler::TCODE_DATA_READ_WS:
+				case TraceDqrProfiler::TCODE_WATCHPOINT:
+				case TraceDqrProfiler::TCODE_CORRECTION:
+				case TraceDqrProfiler::TCODE_DATA_WRITE:
+				case TraceDqrProfiler::TCODE_DATA_READ:
+				case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+				case TraceDqrProfiler::TCODE_DEVICE_ID:
+					printf("Error: NextInstruction(): Unsupported tcode type (%d)\n", nm.tcode);
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				case TraceDqrProfiler::TCODE_UNDEFINED:
+					printf("Error: NextInstruction(): Undefined tcode type (%d)\n", nm.tcode);
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+			}
+
+			// Check if this is a ICT Control message and if we are filtering them out
+#if 0
+			switch (nm.tcode) {
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+				if ((nm.getCKSRC() == TraceDqrProfiler::ICT_CONTROL) && (eventFilterMask & (1 << PROFILER_CTF::et_controlIndex))) {
+					savedInstPtr = instInfo;
+					instInfo = nullptr;
+				}
+				break;
+			default:
+				break;
+			}
+#endif
+		}
+
+		switch (state[currentCore]) 
+		{
+		case TRACE_STATE_SYNCCATE:	// Looking for a CA trace sync
+			// printf("TRACE_STATE_SYNCCATE\n");
+
+			if (caTrace == nullptr) {
+				// have an error! Should never have TRACE_STATE_SYNC without a caTrace ptr
+				printf("Error: caTrace is null\n");
+				status = TraceDqrProfiler::DQERR_ERR;
+				state[currentCore] = TRACE_STATE_ERROR;
+				return status;
+			}
+
+			// loop through trace messages until we find a sync of some kind. First sync should do it
+			// sync reason must be correct (exit debug or start tracing) or we stay in this state
+
+			TraceDqrProfiler::ADDRESS teAddr;
+
+			switch (nm.tcode) 
+			{
+			case TraceDqrProfiler::TCODE_ERROR:
+				// reset time. Messages have been missed. Address may not still be 0 if we have seen a sync
+				// message without an exit debug or start trace sync reason, so reset address
+
+				lastTime[currentCore] = 0;
+				currentAddress[currentCore] = 0;
+				lastFaddr[currentCore] = 0;
+
+
+				readNewTraceMessage = true;
+
+				status = TraceDqrProfiler::DQERR_OK;
+
+				return status;
+			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+			case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+			case TraceDqrProfiler::TCODE_CORRELATION:
+			case TraceDqrProfiler::TCODE_RESOURCEFULL:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+			//case TraceDqrProfiler::TCODE_REPEATBRANCH:
+			case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
+			case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
+			case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
+			case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
+			case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
+			case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
+			case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
+			case TraceDqrProfiler::TCODE_AUXACCESS_READ:
+				// here we return the trace messages before we have actually started tracing
+				// this could be at the start of a trace, or after leaving a trace because of
+				// a correlation message
+
+						// we may have a valid address and time already if we saw a sync without an exit debug				        // or start trace sync reason. So call processTraceMessage()
+
+				if (lastFaddr[currentCore] != 0) {
+					rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+					if (rc != TraceDqrProfiler::DQERR_OK) {
+						printf("Error: NextInstruction(): state TRACE_STATE_SYNCCATE: processTraceMessage()\n");
+
+						status = TraceDqrProfiler::DQERR_ERR;
+						state[currentCore] = TRACE_STATE_ERROR;
+
+						return status;
+					}
+				}
+
+				readNewTraceMessage = true;
+
+				status = TraceDqrProfiler::DQERR_OK;
+
+				return status;
+			case TraceDqrProfiler::TCODE_SYNC:
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+				// sync reason should be either EXIT_DEBUG or TRACE_ENABLE. Otherwise, keep looking
+
+				TraceDqrProfiler::SyncReason sr;
+
+				sr = nm.getSyncReason();
+				switch (sr) {
+				case TraceDqrProfiler::SYNC_EXIT_DEBUG:
+				case TraceDqrProfiler::SYNC_TRACE_ENABLE:
+					// only exit debug or trace enable allow proceeding. All others stay in this state and return
+
+					teAddr = nm.getF_Addr() << 1;
+					break;
+				case TraceDqrProfiler::SYNC_EVTI:
+				case TraceDqrProfiler::SYNC_EXIT_RESET:
+				case TraceDqrProfiler::SYNC_T_CNT:
+				case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
+				case TraceDqrProfiler::SYNC_WATCHPINT:
+				case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
+				case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
+				case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
+				case TraceDqrProfiler::SYNC_PC_SAMPLE:
+					// here we return the trace messages before we have actually started tracing
+					// this could be at the start of a trace, or after leaving a trace because of
+					// a correlation message
+					// probably should never get here when doing a CA trace.
+
+					rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+					if (rc != TraceDqrProfiler::DQERR_OK) {
+						printf("Error: NextInstruction(): state TRACE_STATE_SYNCCATE: processTraceMessage()\n");
+
+						status = TraceDqrProfiler::DQERR_ERR;
+						state[currentCore] = TRACE_STATE_ERROR;
+
+						return status;
+					}
+
+
+
+					readNewTraceMessage = true;
+
+					status = TraceDqrProfiler::DQERR_OK;
+
+					return status;
+				case TraceDqrProfiler::SYNC_NONE:
+				default:
+					printf("Error: invalid sync reason\n");
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+				break;
+#if 0
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+				// INCIRCUTTRACE_WS messages do not have a sync reason, but control(0,1) has
+				// the same info!
+
+				TraceDqrProfiler::ICTReason itcr;
+
+				itcr = nm.getCKSRC();
+
+				switch (itcr) {
+				case TraceDqrProfiler::ICT_INFERABLECALL:
+				case TraceDqrProfiler::ICT_EXT_TRIG:
+				case TraceDqrProfiler::ICT_EXCEPTION:
+				case TraceDqrProfiler::ICT_INTERRUPT:
+				case TraceDqrProfiler::ICT_CONTEXT:
+				case TraceDqrProfiler::ICT_WATCHPOINT:
+				case TraceDqrProfiler::ICT_PC_SAMPLE:
+					rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+					if (rc != TraceDqrProfiler::DQERR_OK) {
+						printf("Error: NextInstruction(): state TRACE_STATE_SYNCCATE: processTraceMessage()\n");
+
+						status = TraceDqrProfiler::DQERR_ERR;
+						state[currentCore] = TRACE_STATE_ERROR;
+
+						return status;
+					}
+
+
+					readNewTraceMessage = true;
+
+					status = TraceDqrProfiler::DQERR_OK;
+
+					return status;
+				case TraceDqrProfiler::ICT_CONTROL:
+					bool returnFlag;
+					returnFlag = true;
+
+					if (nm.ictWS.ckdf == 1) {
+						switch (nm.ictWS.ckdata[1]) {
+						case TraceDqrProfiler::ICT_CONTROL_TRACE_ON:
+						case TraceDqrProfiler::ICT_CONTROL_EXIT_DEBUG:
+							// only exit debug or trace enable allow proceeding. All others stay in this state and return
+
+							teAddr = nm.getF_Addr() << 1;
+							returnFlag = false;
+							break;
+						default:
+							break;
+						}
+					}
+
+					if (returnFlag) {
+						rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+						if (rc != TraceDqrProfiler::DQERR_OK) {
+							printf("Error: NextInstruction(): state TRACE_STATE_SYNCCATE: processTraceMessage()\n");
+
+							status = TraceDqrProfiler::DQERR_ERR;
+							state[currentCore] = TRACE_STATE_ERROR;
+
+							return status;
+						}
+
+	
+
+						readNewTraceMessage = true;
+
+						status = TraceDqrProfiler::DQERR_OK;
+
+						return status;
+					}
+					break;
+				case TraceDqrProfiler::ICT_NONE:
+				default:
+					printf("Error: invalid ICT reason\n");
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+				break;
+#endif
+			case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+			case TraceDqrProfiler::TCODE_DEVICE_ID:
+			case TraceDqrProfiler::TCODE_DATA_WRITE:
+			case TraceDqrProfiler::TCODE_DATA_READ:
+			case TraceDqrProfiler::TCODE_CORRECTION:
+			case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+			case TraceDqrProfiler::TCODE_DATA_READ_WS:
+			case TraceDqrProfiler::TCODE_WATCHPOINT:
+			case TraceDqrProfiler::TCODE_UNDEFINED:
+			default:
+				printf("Error: nextInstruction(): state TRACE_STATE_SYNCCATE: unsupported or invalid TCODE\n");
+
+				state[currentCore] = TRACE_STATE_ERROR;
+				status = TraceDqrProfiler::DQERR_ERR;
+
+				return status;
+			}
+
+			// run ca code until we get to the te trace address. only do 6 instructions a the most
+#if 0
+			caSyncAddr = caTrace->getCATraceStartAddr();
+
+			//			printf("caSyncAddr: %08x, teAddr: %08x\n",caSyncAddr,teAddr);
+
+			//			caTrace->dumpCurrentCARecord(1);
+
+			TraceDqrProfiler::ADDRESS savedAddr;
+			savedAddr = -1;
+
+			bool fail;
+			fail = false;
+
+			for (int i = 0; (fail == false) && (teAddr != caSyncAddr) && (i < 30); i++) {
+				rc = nextCAAddr(caSyncAddr, savedAddr);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					fail = true;
+				}
+				else {
+					//					printf("caSyncAddr: %08x, teAddr: %08x\n",caSyncAddr,teAddr);
+
+					rc = caTrace->consume(caFlags, TraceDqrProfiler::INST_SCALER, pipeCycles, viStartCycles, viFinishCycles, qDepth, arithInProcess, loadInProcess, storeInProcess);
+					if (rc == TraceDqrProfiler::DQERR_EOF) {
+						state[currentCore] = TRACE_STATE_DONE;
+
+						status = rc;
+						return rc;
+					}
+
+					if (rc != TraceDqrProfiler::DQERR_OK) {
+						state[currentCore] = TRACE_STATE_ERROR;
+
+						status = rc;
+						return status;
+					}
+				}
+			}
+
+			//			if (teAddr == caSyncAddr) {
+			//				printf("ca sync found at address %08x, cycles: %d\n",caSyncAddr,cycles);
+			//			}
+
+			if (teAddr != caSyncAddr) {
+				// unable to sync by fast-forwarding the CA trace to match the instruction trace
+				// so we will try to run the normal trace for a few instructions with the hope it
+				// will sync up with the ca trace! We set the max number of instructions to run
+				// the normal trace below, and turn tracing loose!
+
+				syncCount = 16;
+				caTrace->rewind();
+				caSyncAddr = caTrace->getCATraceStartAddr();
+
+				//				printf("starting normal trace to sync up; caSyncAddr: %08x\n",caSyncAddr);
+			}
+
+			// readnextmessage should be false. So, we want to process the message like a normal message here
+			// if the addresses of the trace and the start of the ca trace sync later, it is handled in
+			// the other states
+#endif
+			state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+			break;
+		case TRACE_STATE_GETFIRSTSYNCMSG:
+			// start here for normal traces
+
+			// read trace messages until a sync is found. Should be the first message normally
+			// unless the wrapped buffer
+
+			// only exit this state when sync type message is found or EOF or error
+			// Event messages will cause state to change to TRACE_STATE_EVENT
+
+			switch (nm.tcode) {
+			case TraceDqrProfiler::TCODE_SYNC:
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_GETFIRSTSYNCMSG: processTraceMessage()\n");
+
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+
+
+				state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
+				break;
+#if 0
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+				// this may set the timestamp, and and may set the address
+				// all set the address except control(0,0) which is used just to set the timestamp at most
+
+				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_GETFIRSTSYNCMSG: processTraceMessage()\n");
+
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+
+				if (currentAddress[currentCore] == 0) {
+					// for the get first sync state, we want currentAddress to be set
+					// most incircuttrace_ws types will set it, but not 8,0; 14,0; 0,0
+
+					currentAddress[currentCore] = lastFaddr[currentCore];
+				}
+
+				if ((nm.ictWS.cksrc == TraceDqrProfiler::ICT_CONTROL) && (nm.ictWS.ckdf == 0)) {
+					// ICT_WS Control(0,0) only updates TS (if present). Does not change state or anything else
+					// because it is the only incircuittrace message type with no address
+				}
+				else {
+					if ((nm.getCKSRC() == TraceDqrProfiler::ICT_EXT_TRIG) && (nm.getCKDF() == 0)) {
+						// no dasm or src for ext trigger in HTM instruction traces
+					}
+					else if ((nm.getCKSRC() == TraceDqrProfiler::ICT_WATCHPOINT) && (nm.getCKDF() == 0)) {
+						// no dasm or src for ext trigger in HTM instruction traces
+					}
+					else if ((instInfo != nullptr)) {
+						Disassemble(currentAddress[currentCore]);
+
+						if (instInfo != nullptr) {
+							instructionInfo.qDepth = 0;
+							instructionInfo.arithInProcess = 0;
+							instructionInfo.loadInProcess = 0;
+							instructionInfo.storeInProcess = 0;
+
+							instructionInfo.coreId = currentCore;
+							*instInfo = &instructionInfo;
+							//							(*instInfo)->CRFlag = TraceDqrProfiler::isNone;
+							//							(*instInfo)->brFlags = TraceDqrProfiler::BRFLAG_none;
+							getCRBRFlags(nm.getCKSRC(), currentAddress[currentCore], (*instInfo)->CRFlag, (*instInfo)->brFlags);
+
+							(*instInfo)->timestamp = lastTime[currentCore];
+						}
+
+					}
+					state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
+				}
+				break;
+#endif
+			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_GETFIRSTSYNCMSG: processTraceMessage()\n");
+
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+				break;
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+			case TraceDqrProfiler::TCODE_RESOURCEFULL:
+			case TraceDqrProfiler::TCODE_CORRELATION:
+				if (nm.timestamp) {
+					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
+				}
+				break;
+			case TraceDqrProfiler::TCODE_TRAP_INFO:
+			case TraceDqrProfiler::TCODE_REPEATBRANCH:
+				rc = processTraceMessage(nm,currentAddress[currentCore],lastFaddr[currentCore],lastTime[currentCore],consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_GETFIRSTSYNCMSG: processTraceMessage()\n");
+
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+				break;
+			case TraceDqrProfiler::TCODE_ERROR:
+				// reset time. Messages have been missed.
+				lastTime[currentCore] = 0;
+				break;
+			case TraceDqrProfiler::TCODE_DEBUG_STATUS:
+			case TraceDqrProfiler::TCODE_DEVICE_ID:
+			case TraceDqrProfiler::TCODE_DATA_WRITE:
+			case TraceDqrProfiler::TCODE_DATA_READ:
+			case TraceDqrProfiler::TCODE_CORRECTION:
+			case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
+			case TraceDqrProfiler::TCODE_DATA_READ_WS:
+			case TraceDqrProfiler::TCODE_WATCHPOINT:
+			default:
+				printf("Error: nextInstructin(): state TRACE_STATE_GETFIRSTSYNCMSG: unsupported or invalid TCODE\n");
+
+				state[currentCore] = TRACE_STATE_ERROR;
+				status = TraceDqrProfiler::DQERR_ERR;
+
+				return status;
+			}
+
+			// INCIRCUITTRACE or INCIRCUITTRACE_WS will have set state to TRACE_STATE_EVENT
+
+			readNewTraceMessage = true;
+
+			// here we return the trace messages before we have actually started tracing
+			// this could be at the start of a trace, or after leaving a trace because of
+			// a correlation message
+
+			status = TraceDqrProfiler::DQERR_OK;
+			return status;
+		case TRACE_STATE_GETMSGWITHCOUNT:
+
+			switch (nm.tcode) {
+			case TraceDqrProfiler::TCODE_SYNC:
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_CORRELATION:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+			case TraceDqrProfiler::TCODE_RESOURCEFULL:
+				// don't update timestamp until messages are retired!
+
+				// reset all counts before setting them. We have no valid counts before the second message.
+				// first message is a sync-type message. Counts are for up to that message, nothing after.
+
+				counts->resetCounts(currentCore);
+
+				rc = counts->setCounts(&nm);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					state[currentCore] = TRACE_STATE_ERROR;
+					status = rc;
+
+					return status;
+				}
+
+				// only these TCODEs have counts and release from this state
+
+				state[currentCore] = TRACE_STATE_GETNEXTINSTRUCTION;
+				break;
+#if 0
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+				// these message have no counts so they will be retired immediately
+
+				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_GETMSGWITHCOUNT: processTraceMessage()\n");
+
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+
+				if ((nm.getCKSRC() == TraceDqrProfiler::ICT_CONTROL) && (nm.getCKDF() == 0)) {
+					// ICT_WS Control(0,0) only updates TS (if present). Does not change state or anything else
+					addr = currentAddress[currentCore];
+				}
+				else {
+					if ((nm.getCKSRC() == TraceDqrProfiler::ICT_EXT_TRIG) && (nm.getCKDF() == 0)) {
+						// no dasm or src for ext trigger in HTM instruction traces
+						addr = lastFaddr[currentCore];
+					}
+					else if ((nm.getCKSRC() == TraceDqrProfiler::ICT_WATCHPOINT) && (nm.getCKDF() == 0)) {
+						// no dasm or src for ext trigger in HTM instruction tracaes
+						addr = lastFaddr[currentCore];
+					}
+					else if ((instInfo != nullptr)) {
+						addr = currentAddress[currentCore];
+
+						Disassemble(addr);
+
+						if (instInfo != nullptr) {
+							instructionInfo.qDepth = 0;
+							instructionInfo.arithInProcess = 0;
+							instructionInfo.loadInProcess = 0;
+							instructionInfo.storeInProcess = 0;
+
+							instructionInfo.coreId = currentCore;
+							*instInfo = &instructionInfo;
+							//							(*instInfo)->CRFlag = TraceDqrProfiler::isNone;
+							//							(*instInfo)->brFlags = TraceDqrProfiler::BRFLAG_none;
+							getCRBRFlags(nm.getCKSRC(), currentAddress[currentCore], (*instInfo)->CRFlag, (*instInfo)->brFlags);
+							(*instInfo)->timestamp = lastTime[currentCore];
+						}
+
+					}
+					state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
+				}
+
+
+
+				readNewTraceMessage = true;
+
+				return status;
+#endif
+			case TraceDqrProfiler::TCODE_ERROR:
+				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+
+				nm.timestamp = 0;	// clear time because we have lost time
+				lastTime[currentCore] = 0;
+				currentAddress[currentCore] = 0;
+				lastFaddr[currentCore] = 0;
+
+				readNewTraceMessage = true;
+
+				return status;
+			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_GETMSGWITHCOUNT: processTraceMessage()\n");
+
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+
+
+
+				readNewTraceMessage = true;
+
+				return status;
+			case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+				// these message have no address or count info, so we still need to get
+				// another message.
+
+				// might want to keep track of process, but will add that later
+
+				// for now, return message;
+
+				if (nm.haveTimestamp) {
+					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
+				}
+
+
+				readNewTraceMessage = true;
+
+				return status;
+			default:
+				printf("Error: bad tcode type in state TRACE_STATE_GETMSGWITHCOUNT. TCODE (%d)\n", nm.tcode);
+
+				state[currentCore] = TRACE_STATE_ERROR;
+				status = TraceDqrProfiler::DQERR_ERR;
+
+				return status;
+			}
+			break;
+		case TRACE_STATE_RETIREMESSAGE:
+			switch (nm.tcode) {
+				// sync type messages say where to set pc to
+			case TraceDqrProfiler::TCODE_SYNC:
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+			case TraceDqrProfiler::TCODE_RESOURCEFULL:
+				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_RETIREMESSAGE: processTraceMessage()\n");
+
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+
+				// I don't think the b_type code below actaully does anything??? Remove??
+
+				TraceDqrProfiler::BType b_type;
+				b_type = TraceDqrProfiler::BTYPE_UNDEFINED;
+
+				switch (nm.tcode) {
+				case TraceDqrProfiler::TCODE_SYNC:
+				case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+					break;
+				case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+					if ((nm.ictWS.cksrc == TraceDqrProfiler::ICT_EXCEPTION) || (nm.ictWS.cksrc == TraceDqrProfiler::ICT_INTERRUPT)) {
+						b_type = TraceDqrProfiler::BTYPE_EXCEPTION;
+					}
+					break;
+				case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+					if ((nm.ict.cksrc == TraceDqrProfiler::ICT_EXCEPTION) || (nm.ict.cksrc == TraceDqrProfiler::ICT_INTERRUPT)) {
+						b_type = TraceDqrProfiler::BTYPE_EXCEPTION;
+					}
+					break;
+				case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+					b_type = nm.indirectBranchWS.b_type;
+					break;
+				case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+					b_type = nm.indirectBranch.b_type;
+					break;
+				case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+					b_type = nm.indirectHistory.b_type;
+					break;
+				case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+					b_type = nm.indirectHistoryWS.b_type;
+					break;
+				case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+				case TraceDqrProfiler::TCODE_RESOURCEFULL:
+					// fall through
+				default:
+					break;
+				}
+
+				if (b_type == TraceDqrProfiler::BTYPE_EXCEPTION) {
+					enterISR[currentCore] = TraceDqrProfiler::isInterrupt;
+				}
+
+				readNewTraceMessage = true;
+				state[currentCore] = TRACE_STATE_GETNEXTMSG;
+				break;
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+				// these messages should have been retired immediately
+
+				printf("Error: unexpected tcode of INCIRCUTTRACE or INCIRCUTTRACE_WS in state TRACE_STATE_RETIREMESSAGE\n");
+				state[currentCore] = TRACE_STATE_ERROR;
+
+				status = TraceDqrProfiler::DQERR_ERR;
+				return status;
+			case TraceDqrProfiler::TCODE_CORRELATION:
+				// correlation has i_cnt, but no address info
+
+				if (nm.haveTimestamp) {
+					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
+				}
+
+
+
+				readNewTraceMessage = true;
+
+				// leaving trace mode - need to get next sync
+
+				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+				break;
+			case TraceDqrProfiler::TCODE_ERROR:
+				printf("Error: Unexpected tcode TCODE_ERROR in state TRACE_STATE_RETIREMESSAGE\n");
+
+				state[currentCore] = TRACE_STATE_ERROR;
+				status = TraceDqrProfiler::DQERR_ERR;
+
+				return status;
+			case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+				// these messages have no address or i-cnt info and should have been
+				// instantly retired when they were read.
+
+				state[currentCore] = TRACE_STATE_ERROR;
+				status = TraceDqrProfiler::DQERR_ERR;
+
+				return status;
+			default:
+				printf("Error: bad tcode type in state TRACE_STATE_RETIREMESSAGE\n");
+
+				state[currentCore] = TRACE_STATE_ERROR;
+				status = TraceDqrProfiler::DQERR_ERR;
+
+				return status;
+			}
+
+			status = TraceDqrProfiler::DQERR_OK;
+			return status;
+		case TRACE_STATE_GETNEXTMSG:
+			//			printf("TRACE_STATE_GETNEXTMSG\n");
+
+						// exit this state when message with i-cnt, history, taken, or not-taken is read
+
+			switch (nm.tcode) {
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+			case TraceDqrProfiler::TCODE_SYNC:
+			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+			case TraceDqrProfiler::TCODE_CORRELATION:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+			case TraceDqrProfiler::TCODE_RESOURCEFULL:
+				rc = counts->setCounts(&nm);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: nextInstruction: state TRACE_STATE_GETNEXTMESSAGE Count::seteCounts()\n");
+
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					status = rc;
+
+					return status;
+				}
+
+				state[currentCore] = TRACE_STATE_GETNEXTINSTRUCTION;
+				break;
+#if 0
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
+			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
+				// these message have no counts so they will be retired immeadiately
+
+				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_GETMSGWITHCOUNT: processTraceMessage()\n");
+
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+
+				if ((nm.getCKSRC() == TraceDqrProfiler::ICT_CONTROL) && (nm.getCKDF() == 0)) {
+					// ICT_WS Control(0,0) only updates TS (if present). Does not change state or anything else
+					addr = currentAddress[currentCore];
+				}
+				else {
+					if ((nm.getCKSRC() == TraceDqrProfiler::ICT_EXT_TRIG) && (nm.getCKDF() == 0)) {
+						// no dasm or src for ext trigger in HTM instruction traces
+						addr = lastFaddr[currentCore];
+					}
+					else if ((nm.getCKSRC() == TraceDqrProfiler::ICT_WATCHPOINT) && (nm.getCKDF() == 0)) {
+						// no dasm or src for ext trigger in HTM instruction tracaes
+						addr = lastFaddr[currentCore];
 					}
+					else if ((instInfo != nullptr)) {
+						addr = currentAddress[currentCore];
+
+						Disassemble(addr);
+
+						if (instInfo != nullptr) {
+							instructionInfo.qDepth = 0;
+							instructionInfo.arithInProcess = 0;
+							instructionInfo.loadInProcess = 0;
+							instructionInfo.storeInProcess = 0;
 
-					if (ctf != nullptr) {
-						if (crFlags & TraceDqrProfiler::isCall) {
-							//ctf->addCall(nm.coreId, pc, faddr, ts);
-						}
-						else if ((crFlags & TraceDqrProfiler::isReturn) || (crFlags & TraceDqrProfiler::isExceptionReturn)) {
-							//ctf->addRet(nm.coreId, pc, faddr, ts);
-						}
-						else {
-							printf("Error: processTraceMEssage(): Unsupported crFlags in PROFILER_CTF conversion\n");
-							return TraceDqrProfiler::DQERR_ERR;
+							instructionInfo.coreId = currentCore;
+							*instInfo = &instructionInfo;
+							//							(*instInfo)->CRFlag = TraceDqrProfiler::isNone;
+							//							(*instInfo)->brFlags = TraceDqrProfiler::BRFLAG_none;
+							getCRBRFlags(nm.getCKSRC(), currentAddress[currentCore], (*instInfo)->CRFlag, (*instInfo)->brFlags);
+
+							(*instInfo)->timestamp = lastTime[currentCore];
 						}
-					}
 
-					//if (eventConverter != nullptr) {
-					//	eventConverter->emitCallRet(nm.coreId, ts, nm.ict.ckdf, pc, faddr, crFlags);
-					//}
+
+					}
 				}
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
-			break;
-		case TraceDqrProfiler::ICT_EXCEPTION:
-			if (nm.ict.ckdf == 1) {
-				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
-				pc = faddr;
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
 
-			if (eventConverter != nullptr) {
-				//eventConverter->emitException(nm.coreId, ts, nm.ict.ckdf, pc, nm.ict.ckdata[1]);
-			}
-			break;
-		case TraceDqrProfiler::ICT_INTERRUPT:
-			if (nm.ict.ckdf == 1) {
-				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
-				pc = faddr;
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
 
-			if (eventConverter != nullptr) {
-				//eventConverter->emitInterrupt(nm.coreId, ts, nm.ict.ckdf, pc, nm.ict.ckdata[1]);
-			}
-			break;
-		case TraceDqrProfiler::ICT_CONTEXT:
-			if (nm.ict.ckdf == 1) {
-				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
-				pc = faddr;
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
+				readNewTraceMessage = true;
 
-			if (eventConverter != nullptr) {
-				//eventConverter->emitContext(nm.coreId, ts, nm.ict.ckdf, pc, nm.ict.ckdata[1]);
-			}
-			break;
-		case TraceDqrProfiler::ICT_PC_SAMPLE:
-			if (nm.ict.ckdf == 0) {
-				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
-				pc = faddr;
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
+				return status;
+#endif
+			case TraceDqrProfiler::TCODE_ERROR:
+				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
 
-			if (eventConverter != nullptr) {
-				//eventConverter->emitPeriodic(nm.coreId, ts, nm.ict.ckdf, pc);
-			}
-			break;
-		case TraceDqrProfiler::ICT_CONTROL:
-			if (nm.ict.ckdf == 0) {
-				// nothing to do - no address
-				// does not update faddr or pc!
+				nm.timestamp = 0;	// clear time because we have lost time
+				currentAddress[currentCore] = 0;
+				lastFaddr[currentCore] = 0;
+				lastTime[currentCore] = 0;
 
-				if (eventConverter != nullptr) {
-					//eventConverter->emitControl(nm.coreId, ts, nm.ict.ckdf, nm.ict.ckdata[0], 0);
-				}
-			}
-			else if (nm.ict.ckdf == 1) {
-				faddr = faddr ^ (nm.ict.ckdata[0] << 1);
-				pc = faddr;
 
-				if (eventConverter != nullptr) {
-					//eventConverter->emitControl(nm.coreId, ts, nm.ict.ckdf, nm.ict.ckdata[1], pc);
-				}
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ict.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
-			break;
-		default:
-			printf("Error: processTraceMessage(): Invalid ICT Event: %d\n", nm.ict.cksrc);
-			return TraceDqrProfiler::DQERR_ERR;
-		}
-		break;
-	case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-		// for 8, 0; 14, 0 do not update pc, only faddr. 0, 0 has no address, so it never updates
-		// this is because those message types all apprear in instruction traces (non-event) and
-		// do not want to update the current address because they have no icnt to say when to do it
+				readNewTraceMessage = true;
 
-		if (nm.haveTimestamp) {
-			ts = processTS(TraceDqrProfiler::TS_full, ts, nm.timestamp);
-		}
+				return status;
+			case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
+			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_GETNXTMSG: processTraceMessage()\n");
 
-		switch (nm.ictWS.cksrc) {
-		case TraceDqrProfiler::ICT_EXT_TRIG:
-			if (nm.ictWS.ckdf == 0) {
-				faddr = nm.ictWS.ckdata[0] << 1;
-				// don't update pc
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
 
-				if (eventConverter != nullptr) {
-					//eventConverter->emitExtTrigEvent(nm.coreId, ts, nm.ictWS.ckdf, faddr, 0);
+					return status;
 				}
-			}
-			else if (nm.ictWS.ckdf == 1) {
-				faddr = nm.ictWS.ckdata[0] << 1;
-				pc = faddr;
 
-				if (eventConverter != nullptr) {
-					//eventConverter->emitExtTrigEvent(nm.coreId, ts, nm.ictWS.ckdf, faddr, nm.ictWS.ckdata[1]);
+
+				readNewTraceMessage = true;
+
+				return status;
+			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
+				// retire these instantly by returning them through msgInfo
+
+				if (nm.haveTimestamp) {
+					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
 				}
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
+
+
+				// leave state along. Need to get another message with an i-cnt!
+
+				readNewTraceMessage = true;
+
+				return status;
+			default:
+				state[currentCore] = TRACE_STATE_ERROR;
+				status = TraceDqrProfiler::DQERR_ERR;
+
+				return status;
 			}
 			break;
-		case TraceDqrProfiler::ICT_WATCHPOINT:
-			if (nm.ictWS.ckdf == 0) {
-				faddr = nm.ictWS.ckdata[0] << 1;
-				// don'tupdate pc
-
-				if (eventConverter != nullptr) {
-					//eventConverter->emitWatchpoint(nm.coreId, ts, nm.ictWS.ckdf, faddr, 0);
+		case TRACE_STATE_GETNEXTINSTRUCTION:
+			if (counts->getCurrentCountType(currentCore) == TraceDqrProfiler::COUNTTYPE_none) {
+				if (profiler_globalDebugFlag) {
+					printf("NextInstruction(): counts are exhausted\n");
 				}
-			}
-			else if (nm.ictWS.ckdf <= 1) {
-				faddr = nm.ictWS.ckdata[0] << 1;
-				pc = faddr;
 
-				if (eventConverter != nullptr) {
-					//eventConverter->emitWatchpoint(nm.coreId, ts, nm.ictWS.ckdf, faddr, nm.ictWS.ckdata[1]);
-				}
+				state[currentCore] = TRACE_STATE_RETIREMESSAGE;
+				break;
 			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
+
+			addr = currentAddress[currentCore];
+			address_out = addr;
+			m_address_out_set = true;
+			uint32_t inst;
+			int inst_size;
+			TraceDqrProfiler::InstType inst_type;
+			int32_t immediate;
+			bool isBranch;
+			int rc;
+			TraceDqrProfiler::Reg rs1;
+			TraceDqrProfiler::Reg rd;
+
+			// getInstrucitonByAddress() should cache last instrucioton/address because I thjink
+			// it gets called a couple times for each address/insruction in a row
+#if 0
+			status = elfReader->getInstructionByAddress(addr, inst);
+			if (status != TraceDqrProfiler::DQERR_OK) {
+				printf("Error: getInstructionByAddress failed - looking for next sync message\n");
+
+				lastTime[currentCore] = 0;
+				currentAddress[currentCore] = 0;
+				lastFaddr[currentCore] = 0;
+
+				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+
+				// the evil break below exits the switch statement - not the if statement!
+
+				break;
+
+				//				state[currentCore] = TRACE_STATE_ERROR;
+				//
+				//				return status;
 			}
-			break;
-		case TraceDqrProfiler::ICT_INFERABLECALL:
-			if (nm.ictWS.ckdf == 0) {
-				pc = nm.ictWS.ckdata[0] << 1;
-				faddr = pc;
 
-				TraceDqrProfiler::DQErr rc;
-				TraceDqrProfiler::ADDRESS nextPC;
-				int crFlags;
+			// figure out how big the instruction is
 
-				rc = nextAddr(pc, nextPC, crFlags);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: processTraceMessage(): Could not compute next address for PROFILER_CTF conversion\n");
-					return TraceDqrProfiler::DQERR_ERR;
-				}
+//			decode instruction/decode instruction size should cache their results (at least last one)
+//			because it gets called a few times here!
+
+			rc = decodeInstruction(inst, inst_size, inst_type, rs1, rd, immediate, isBranch);
+			if (rc != 0) {
+				printf("Error: Cann't decode size of instruction %04x\n", inst);
+
+				state[currentCore] = TRACE_STATE_ERROR;
+				status = TraceDqrProfiler::DQERR_ERR;
+
+				return status;
+			}
+#endif
+#if 0
+			Disassemble(addr);
+#endif
+			// compute next address (retire this instruction)
 
-				// we will store the target address back in ckdata[1] in case it is needed later
+			// nextAddr() will also update counts
+			//
+			// nextAddr() computes next address if possible, consumes counts
 
-				nm.ict.ckdata[1] = nextPC;
+			// nextAddr can usually compute the next address, but not always. If it can't, it returns
+			// -1 as the next address.  This should never happen for conditional branches because we
+			// should always have enough informatioon. But it can happen for indirect branches. For indirect
+			// branches, retiring the current trace message (should be an indirect branch or indirect
+			// brnach with sync) will set the next address correclty.
 
-				if (ctf != nullptr) {
-					//ctf->addCall(nm.coreId, pc, nextPC, ts);
-				}
+			status = nextAddr(currentCore, currentAddress[currentCore], addr, nm.tcode, crFlag, brFlags);
+			if (status != TraceDqrProfiler::DQERR_OK) {
+				printf("Error: nextAddr() failed\n");
 
-				if (eventConverter != nullptr) {
-					//eventConverter->emitCallRet(nm.coreId, ts, nm.ictWS.ckdf, pc, faddr, TraceDqrProfiler::isCall);
-				}
+				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+
+				status = TraceDqrProfiler::DQERR_OK;
+				return status;
 			}
-			else if (nm.ictWS.ckdf == 1) {
-				pc = nm.ictWS.ckdata[0] << 1;
-				faddr = pc ^ (nm.ictWS.ckdata[1] << 1);
 
-				if ((ctf != nullptr) || (eventConverter != nullptr)) {
-					TraceDqrProfiler::DQErr rc;
-					TraceDqrProfiler::ADDRESS nextPC;
-					int crFlags;
+			// if addr == -1 and brFlags == BRFLAG_unknown, we need to read another trace message
+			// which hopefully with have history bits. Do not return the instruciton yet - we will
+			// retry it after getting another trace message
 
-					rc = nextAddr(pc, nextPC, crFlags);
-					if (rc != TraceDqrProfiler::DQERR_OK) {
-						printf("Error: processTraceMessage(): Could not compute next address for PROFILER_CTF conversion\n");
-						return TraceDqrProfiler::DQERR_ERR;
-					}
+			// if addr == -1 and brflags != BRFLAG_unknown, and current counts type != none, we have an
+			// error.
 
-					if (ctf != nullptr) {
-						if (crFlags & TraceDqrProfiler::isCall) {
-							//ctf->addCall(nm.coreId, pc, faddr, ts);
-						}
-						else if ((crFlags & TraceDqrProfiler::isReturn) || (crFlags & TraceDqrProfiler::isExceptionReturn)) {
-							//ctf->addRet(nm.coreId, pc, faddr, ts);
-						}
-						else {
-							printf("Error: processTraceMEssage(): Unsupported crFlags in PROFILER_CTF conversion\n");
-							return TraceDqrProfiler::DQERR_ERR;
-						}
-					}
+			// if addr == -1 and brflags != BRFLAG_unkonw and current count type == none, all should
+			// be good. We will return the instruction and read another message
 
-					if (eventConverter != nullptr) {
-						//eventConverter->emitCallRet(nm.coreId, ts, nm.ictWS.ckdf, pc, faddr, crFlags);
-					}
+			if (addr == (TraceDqrProfiler::ADDRESS)-1) {
+				if (brFlags == TraceDqrProfiler::BRFLAG_unknown) {
+					// read another trace message and retry
+
+					state[currentCore] = TRACE_STATE_RETIREMESSAGE;
+					break; // this break exits trace_state_getnextinstruction!
 				}
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
-			break;
-		case TraceDqrProfiler::ICT_EXCEPTION:
-			if (nm.ictWS.ckdf == 1) {
-				faddr = nm.ictWS.ckdata[0] << 1;
-				pc = faddr;
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
+				else if (counts->getCurrentCountType(currentCore) != TraceDqrProfiler::COUNTTYPE_none) {
+					// error
+					// must have a JR/JALR or exception/exception return to get here, and the CR stack is empty
 
-			if (eventConverter != nullptr) {
-				//eventConverter->emitException(nm.coreId, ts, nm.ictWS.ckdf, pc, nm.ictWS.ckdata[1]);
-			}
-			break;
-		case TraceDqrProfiler::ICT_INTERRUPT:
-			if (nm.ictWS.ckdf == 1) {
-				faddr = nm.ictWS.ckdata[0] << 1;
-				pc = faddr;
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
+					//printf("Error: getCurrentCountType(core:%d) still has counts; have countType: %d\n", currentCore, counts->getCurrentCountType(currentCore));
+					//char d[64];
 
-			if (eventConverter != nullptr) {
-				//eventConverter->emitInterrupt(nm.coreId, ts, nm.ictWS.ckdf, pc, nm.ictWS.ckdata[1]);
-			}
-			break;
-		case TraceDqrProfiler::ICT_CONTEXT:
-			if (nm.ictWS.ckdf == 1) {
-				faddr = nm.ictWS.ckdata[0] << 1;
-				pc = faddr;
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
+					//instructionInfo.instructionToText(d, sizeof d, 2);
+					//printf("%08llx:    %s\n", currentAddress[currentCore], d);
 
-			if (eventConverter != nullptr) {
-				//eventConverter->emitContext(nm.coreId, ts, nm.ictWS.ckdf, pc, nm.ictWS.ckdata[1]);
-			}
-			break;
-		case TraceDqrProfiler::ICT_PC_SAMPLE:
-			if (nm.ictWS.ckdf == 0) {
-				faddr = nm.ictWS.ckdata[0] << 1;
-				pc = faddr;
-			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
+					//state[currentCore] = TRACE_STATE_ERROR;
 
-			if (eventConverter != nullptr) {
-				//eventConverter->emitPeriodic(nm.coreId, ts, nm.ictWS.ckdf, pc);
-			}
-			break;
-		case TraceDqrProfiler::ICT_CONTROL:
-			if (nm.ictWS.ckdf == 0) {
-				// nothing to do
-				// does not update faddr or pc!
+					//status = TraceDqrProfiler::DQERR_ERR;
+					//return status;
 
-				if (eventConverter != nullptr) {
-					//eventConverter->emitControl(nm.coreId, ts, nm.ictWS.ckdf, nm.ictWS.ckdata[0], 0);
-				}
-			}
-			else if (nm.ictWS.ckdf == 1) {
-				faddr = nm.ictWS.ckdata[0] << 1;
-				pc = faddr;
+					// Profiling will return error in case there is an issue with a trace record.
+					// This will lead to loss of data. In case the profiler is not able to continue,
+					// we can reset the state to TRACE_STATE_GETFIRSTSYNCMSG which will restart
+					// profiling at the next sync packet.
+					state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
 
-				if (eventConverter != nullptr) {
-					//eventConverter->emitControl(nm.coreId, ts, nm.ictWS.ckdf, nm.ictWS.ckdata[1], pc);
+					status = TraceDqrProfiler::DQERR_OK;
+					return status;
 				}
 			}
-			else {
-				printf("Error: processTraceMessage(): Invalid ckdf field: %d\n", nm.ictWS.ckdf);
-				return TraceDqrProfiler::DQERR_ERR;
-			}
-			break;
-		default:
-			printf("Error: processTraceMessage(): Invalid ICT Event: %d\n", nm.ictWS.cksrc);
-			return TraceDqrProfiler::DQERR_ERR;
-		}
-		break;
-	case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-	case TraceDqrProfiler::TCODE_DEVICE_ID:
-	case TraceDqrProfiler::TCODE_DATA_WRITE:
-	case TraceDqrProfiler::TCODE_DATA_READ:
-	case TraceDqrProfiler::TCODE_CORRECTION:
-	case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-	case TraceDqrProfiler::TCODE_DATA_READ_WS:
-	case TraceDqrProfiler::TCODE_WATCHPOINT:
-	case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-	case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-	case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-	case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-	case TraceDqrProfiler::TCODE_UNDEFINED:
-	default:
-		printf("Error: TraceProfiler::processTraceMessage(): Unsupported TCODE\n");
 
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+			currentAddress[currentCore] = addr;
 
-	return TraceDqrProfiler::DQERR_OK;
-}
+			uint32_t prevCycle;
+			prevCycle = 0;
+#if 0
+			if (caTrace != nullptr) {
+				if (syncCount > 0) {
+					if (caSyncAddr == instructionInfo.address) {
+						//						printf("ca sync successful at addr %08x\n",caSyncAddr);
 
-TraceDqrProfiler::DQErr TraceProfiler::getInstructionByAddress(TraceDqrProfiler::ADDRESS addr, ProfilerInstruction* instInfo, ProfilerSource* srcInfo, int* flags)
-{
-	TraceDqrProfiler::DQErr rc;
+						syncCount = 0;
+					}
+					else {
+						syncCount -= 1;
+						if (syncCount == 0) {
+							printf("Error: unable to sync CA trace and instruction trace\n");
+							state[currentCore] = TRACE_STATE_ERROR;
+							status = TraceDqrProfiler::DQERR_ERR;
+							return status;
+						}
+					}
+				}
 
-	rc = Disassemble(addr); // should error check disassembl() call!
-	if (rc != TraceDqrProfiler::DQERR_OK) {
-		return TraceDqrProfiler::DQERR_ERR;
-	}
+				if (syncCount == 0) {
+					status = caTrace->consume(caFlags, inst_type, pipeCycles, viStartCycles, viFinishCycles, qDepth, arithInProcess, loadInProcess, storeInProcess);
+					if (status == TraceDqrProfiler::DQERR_EOF) {
+						state[currentCore] = TRACE_STATE_DONE;
+						return status;
+					}
 
-	*flags = 0;
+					if (status != TraceDqrProfiler::DQERR_OK) {
+						state[currentCore] = TRACE_STATE_ERROR;
+						return status;
+					}
 
-	if (instInfo != nullptr) {
-		instructionInfo.qDepth = 0;
-		instructionInfo.arithInProcess = 0;
-		instructionInfo.loadInProcess = 0;
-		instructionInfo.storeInProcess = 0;
+					prevCycle = lastCycle[currentCore];
 
-		instructionInfo.coreId = 0;
-		*instInfo = instructionInfo;
-		instInfo->CRFlag = TraceDqrProfiler::isNone;
-		instInfo->brFlags = TraceDqrProfiler::BRFLAG_none;
+					eCycleCount[currentCore] = pipeCycles - prevCycle;
 
-		instInfo->timestamp = lastTime[currentCore];
+					lastCycle[currentCore] = pipeCycles;
+				}
+			}
+#endif
 
-		*flags |= TraceDqrProfiler::TRACE_HAVE_INSTINFO;
-	}
+			if (instInfo != nullptr) 
+			{
+				instructionInfo.qDepth = qDepth;
+				instructionInfo.arithInProcess = arithInProcess;
+				instructionInfo.loadInProcess = loadInProcess;
+				instructionInfo.storeInProcess = storeInProcess;
 
-	if (srcInfo != nullptr) {
-		sourceInfo.coreId = 0;
-		*srcInfo = sourceInfo;
-		*flags |= TraceDqrProfiler::TRACE_HAVE_SRCINFO;
-	}
+				qDepth = 0;
+				arithInProcess = 0;
+				loadInProcess = 0;
+				storeInProcess = 0;
 
-	return TraceDqrProfiler::DQERR_OK;
-}
+				instructionInfo.coreId = currentCore;
+				*instInfo = &instructionInfo;
+				(*instInfo)->CRFlag = (crFlag | enterISR[currentCore]);
+				enterISR[currentCore] = TraceDqrProfiler::isNone;
+				(*instInfo)->brFlags = brFlags;
 
-TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction* instInfo, ProfilerNexusMessage* msgInfo, ProfilerSource* srcInfo, int* flags)
-{
-	TraceDqrProfiler::DQErr ec;
+				if ((caTrace != nullptr) && (syncCount == 0)) {
+					// note: start signal is one cycle after execution begins. End signal is two cycles after end
 
-	ProfilerInstruction* instInfop = nullptr;
-	ProfilerNexusMessage* msgInfop = nullptr;
-	ProfilerSource* srcInfop = nullptr;
+					(*instInfo)->timestamp = pipeCycles;
+					(*instInfo)->pipeCycles = eCycleCount[currentCore];
 
-	ProfilerInstruction** instInfopp = nullptr;
-	ProfilerNexusMessage** msgInfopp = nullptr;
-	ProfilerSource** srcInfopp = nullptr;
+					(*instInfo)->VIStartCycles = viStartCycles - prevCycle;
+					(*instInfo)->VIFinishCycles = viFinishCycles - prevCycle - 1;
 
-	if (instInfo != nullptr) {
-		instInfopp = &instInfop;
-	}
+					(*instInfo)->caFlags = caFlags;
+				}
+				else {
+					(*instInfo)->timestamp = lastTime[currentCore];
+				}
+			}
 
-	if (msgInfo != nullptr) {
-		msgInfopp = &msgInfop;
-	}
+			//			lastCycle[currentCore] = cycles;
 
-	if (srcInfo != nullptr) {
-		srcInfopp = &srcInfop;
-	}
+#if 0
+			status = analytics.updateInstructionInfo(currentCore, inst, inst_size, crFlag, brFlags);
+			if (status != TraceDqrProfiler::DQERR_OK) {
+				state[currentCore] = TRACE_STATE_ERROR;
 
-	ec = NextInstruction(instInfopp, msgInfopp, srcInfopp);
+				printf("Error: updateInstructionInfo() failed\n");
+				return status;
+			}
+#endif
 
-	*flags = 0;
+			if (counts->getCurrentCountType(currentCore) != TraceDqrProfiler::COUNTTYPE_none) {
+				// still have valid counts. Keep running nextInstruction!
 
-	if (ec == TraceDqrProfiler::DQERR_OK) {
-		if (instInfo != nullptr) {
-			if (instInfop != nullptr) {
-				*instInfo = *instInfop;
-				*flags |= TraceDqrProfiler::TRACE_HAVE_INSTINFO;
+				return status;
 			}
-		}
 
-		if (msgInfo != nullptr) {
-			if (msgInfop != nullptr) {
-				*msgInfo = *msgInfop;
-				*flags |= TraceDqrProfiler::TRACE_HAVE_MSGINFO;
-			}
-		}
+			// counts have expired. Retire this message and read next trace message and update. This should cause the
+			// current process instruction (above) to be returned along with the retired trace message
 
-		if (srcInfo != nullptr) {
-			if (srcInfop != nullptr) {
-				*srcInfo = *srcInfop;
-				*flags |= TraceDqrProfiler::TRACE_HAVE_SRCINFO;
-			}
-		}
+			// if the instruction processed above in an indirect branch, counts should be zero and
+			// retiring this trace message should set the next address (message should be an indirect
+			// brnach type message)
 
-		if (itcPrint != nullptr) {
-			if (itcPrint->haveITCPrintMsgs() != false) {
-				*flags |= TraceDqrProfiler::TRACE_HAVE_ITCPRINTINFO;
-			}
+			state[currentCore] = TRACE_STATE_RETIREMESSAGE;
+			break;
+		case TRACE_STATE_DONE:
+			status = TraceDqrProfiler::DQERR_DONE;
+			return status;
+		case TRACE_STATE_ERROR:
+			status = TraceDqrProfiler::DQERR_ERR;
+			return status;
+		default:
+			printf("Error: TraceProfiler::NextInstruction():unknown\n");
+
+			state[currentCore] = TRACE_STATE_ERROR;
+			status = TraceDqrProfiler::DQERR_ERR;
+			return status;
 		}
 	}
 
-	return ec;
+	status = TraceDqrProfiler::DQERR_OK;
+	return TraceDqrProfiler::DQERR_OK;
 }
-TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** instInfo, ProfilerNexusMessage **nm_out, uint64_t& address_out)
+//NextInstruction() want to return address, instruction, trace message if any, label+offset for instruction, target of instruciton
+//		source code for instruction (file, function, line)
+//
+//		return instruction object (include label informatioon)
+//		return message object
+//		return source code object//
+//
+//				if instruction object ptr is null, don't return any instruction info
+//				if message object ptr is null, don't return any message info
+//				if source code object is null, don't return source code info
+
+TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** instInfo, ProfilerNexusMessage** msgInfo, ProfilerSource** srcInfo)
 {
-	if (status != TraceDqrProfiler::DQERR_OK) 
-	{
+	if (sfp == nullptr) {
+		printf("Error: TraceProfiler::NextInstructin(): Null sfp object\n");
+
+		status = TraceDqrProfiler::DQERR_ERR;
+		return status;
+	}
+
+	if (status != TraceDqrProfiler::DQERR_OK) {
 		return status;
 	}
 
@@ -4783,10 +7123,17 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 	ProfilerNexusMessage** savedMsgPtr = nullptr;
 	ProfilerSource** savedSrcPtr = nullptr;
 
-	//if (instInfo != nullptr) 
-	//{
-	//	*instInfo = nullptr;
-	//}
+	if (instInfo != nullptr) {
+		*instInfo = nullptr;
+	}
+
+	if (msgInfo != nullptr) {
+		*msgInfo = nullptr;
+	}
+
+	if (srcInfo != nullptr) {
+		*srcInfo = nullptr;
+	}
 
 	for (;;) {
 		//		need to set readNewTraceMessage where it is needed! That includes
@@ -4799,14 +7146,21 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 			savedInstPtr = nullptr;
 		}
 
-		if (readNewTraceMessage != false) 
-		{
-			do 
-			{
-				rc = sfp->readNextTraceMsg(nm, analytics, haveMsg);
+		if (savedMsgPtr != nullptr) {
+			msgInfo = savedMsgPtr;
+			savedMsgPtr = nullptr;
+		}
 
-				if (rc != TraceDqrProfiler::DQERR_OK) 
-				{
+		if (savedSrcPtr != nullptr) {
+			srcInfo = savedSrcPtr;
+			savedSrcPtr = nullptr;
+		}
+
+		if (readNewTraceMessage != false) {
+			do {
+				rc = readNextTraceMsg(nm, haveMsg);
+
+				if (rc != TraceDqrProfiler::DQERR_OK) {
 					// have an error. either EOF, or error
 
 					status = rc;
@@ -4823,8 +7177,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					return status;
 				}
 
-				if (haveMsg == false) 
-				{
+				if (haveMsg == false) {
 					lastTime[currentCore] = 0;
 					currentAddress[currentCore] = 0;
 					lastFaddr[currentCore] = 0;
@@ -4835,7 +7188,6 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 
 			readNewTraceMessage = false;
 			currentCore = nm.coreId;
-            *nm_out = &nm;
 
 			// if set see if HTM trace message, switch to HTM mode
 
@@ -4852,8 +7204,6 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 				case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
 				case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
 				case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-				case TraceDqrProfiler::TCODE_REPEATBRANCH:
-				case TraceDqrProfiler::TCODE_TRAP_INFO:				
 					break;
 				case TraceDqrProfiler::TCODE_CORRELATION:
 					if (nm.correlation.cdf == 1) {
@@ -4867,6 +7217,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					traceType = TraceDqrProfiler::TRACETYPE_HTM;
 					if (profiler_globalDebugFlag) printf("History/taken/not taken count TCODE: switching to HTM mode\n");
 					break;
+				case TraceDqrProfiler::TCODE_REPEATBRANCH:
 				case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
 				case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
 				case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
@@ -4898,23 +7249,25 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 			}
 
 			// Check if this is a ICT Control message and if we are filtering them out
-#if 0
+
 			switch (nm.tcode) {
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
 				if ((nm.getCKSRC() == TraceDqrProfiler::ICT_CONTROL) && (eventFilterMask & (1 << PROFILER_CTF::et_controlIndex))) {
 					savedInstPtr = instInfo;
 					instInfo = nullptr;
+					savedMsgPtr = msgInfo;
+					msgInfo = nullptr;
+					savedSrcPtr = srcInfo;
+					srcInfo = nullptr;
 				}
 				break;
 			default:
 				break;
 			}
-#endif
 		}
 
-		switch (state[currentCore]) 
-		{
+		switch (state[currentCore]) {
 		case TRACE_STATE_SYNCCATE:	// Looking for a CA trace sync
 			// printf("TRACE_STATE_SYNCCATE\n");
 
@@ -4931,8 +7284,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 
 			TraceDqrProfiler::ADDRESS teAddr;
 
-			switch (nm.tcode) 
-			{
+			switch (nm.tcode) {
 			case TraceDqrProfiler::TCODE_ERROR:
 				// reset time. Messages have been missed. Address may not still be 0 if we have seen a sync
 				// message without an exit debug or start trace sync reason, so reset address
@@ -4941,6 +7293,18 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 				currentAddress[currentCore] = 0;
 				lastFaddr[currentCore] = 0;
 
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+
+					// currentAddresss should be 0 until we get a sync message. TS has been set to 0
+
+					messageInfo.currentAddress = currentAddress[currentCore];
+					messageInfo.time = lastTime[currentCore];
+
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
 
 				readNewTraceMessage = true;
 
@@ -4956,7 +7320,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 			case TraceDqrProfiler::TCODE_CORRELATION:
 			case TraceDqrProfiler::TCODE_RESOURCEFULL:
 			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-			//case TraceDqrProfiler::TCODE_REPEATBRANCH:
+			case TraceDqrProfiler::TCODE_REPEATBRANCH:
 			case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
 			case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
 			case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
@@ -4983,6 +7347,20 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					}
 				}
 
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+
+					// currentAddresss should be 0 until we get a sync message. TS may
+					// have been set by a ICT control WS message
+
+					messageInfo.currentAddress = currentAddress[currentCore];
+					messageInfo.time = lastTime[currentCore];
+
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
+
 				readNewTraceMessage = true;
 
 				status = TraceDqrProfiler::DQERR_OK;
@@ -5028,7 +7406,18 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 						return status;
 					}
 
+					if (msgInfo != nullptr) {
+						messageInfo = nm;
+
+						// if doing pc-sampling and msg type is INCIRCUITTRACE_WS, we want to use faddr
+						// and not currentAddress
+
+						messageInfo.currentAddress = nm.getF_Addr() << 1;
 
+						if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+							*msgInfo = &messageInfo;
+						}
+					}
 
 					readNewTraceMessage = true;
 
@@ -5044,7 +7433,6 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					return status;
 				}
 				break;
-#if 0
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
 				// INCIRCUTTRACE_WS messages do not have a sync reason, but control(0,1) has
 				// the same info!
@@ -5071,6 +7459,18 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 						return status;
 					}
 
+					if (msgInfo != nullptr) {
+						messageInfo = nm;
+
+						// if doing pc-sampling and msg type is INCIRCUITTRACE_WS, we want to use faddr
+						// and not currentAddress
+
+						messageInfo.currentAddress = nm.getF_Addr() << 1;
+
+						if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+							*msgInfo = &messageInfo;
+						}
+					}
 
 					readNewTraceMessage = true;
 
@@ -5106,7 +7506,18 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 							return status;
 						}
 
-	
+						if (msgInfo != nullptr) {
+							messageInfo = nm;
+
+							// if doing pc-sampling and msg type is INCIRCUITTRACE_WS, we want to use faddr
+							// and not currentAddress
+
+							messageInfo.currentAddress = nm.getF_Addr() << 1;
+
+							if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+								*msgInfo = &messageInfo;
+							}
+						}
 
 						readNewTraceMessage = true;
 
@@ -5124,7 +7535,6 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					return status;
 				}
 				break;
-#endif
 			case TraceDqrProfiler::TCODE_DEBUG_STATUS:
 			case TraceDqrProfiler::TCODE_DEVICE_ID:
 			case TraceDqrProfiler::TCODE_DATA_WRITE:
@@ -5144,7 +7554,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 			}
 
 			// run ca code until we get to the te trace address. only do 6 instructions a the most
-#if 0
+
 			caSyncAddr = caTrace->getCATraceStartAddr();
 
 			//			printf("caSyncAddr: %08x, teAddr: %08x\n",caSyncAddr,teAddr);
@@ -5202,7 +7612,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 			// readnextmessage should be false. So, we want to process the message like a normal message here
 			// if the addresses of the trace and the start of the ca trace sync later, it is handled in
 			// the other states
-#endif
+
 			state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
 			break;
 		case TRACE_STATE_GETFIRSTSYNCMSG:
@@ -5229,10 +7639,15 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					return status;
 				}
 
+				if (srcInfo != nullptr) {
+					Disassemble(currentAddress[currentCore]);
+
+					sourceInfo.coreId = currentCore;
+					*srcInfo = &sourceInfo;
+				}
 
 				state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
 				break;
-#if 0
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
 				// this may set the timestamp, and and may set the address
 				// all set the address except control(0,0) which is used just to set the timestamp at most
@@ -5265,7 +7680,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					else if ((nm.getCKSRC() == TraceDqrProfiler::ICT_WATCHPOINT) && (nm.getCKDF() == 0)) {
 						// no dasm or src for ext trigger in HTM instruction traces
 					}
-					else if ((instInfo != nullptr)) {
+					else if ((instInfo != nullptr) || (srcInfo != nullptr)) {
 						Disassemble(currentAddress[currentCore]);
 
 						if (instInfo != nullptr) {
@@ -5282,12 +7697,15 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 
 							(*instInfo)->timestamp = lastTime[currentCore];
 						}
-
+
+						if (srcInfo != nullptr) {
+							sourceInfo.coreId = currentCore;
+							*srcInfo = &sourceInfo;
+						}
 					}
 					state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
 				}
 				break;
-#endif
 			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
 				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
 				if (rc != TraceDqrProfiler::DQERR_OK) {
@@ -5310,18 +7728,6 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
 				}
 				break;
-			case TraceDqrProfiler::TCODE_TRAP_INFO:
-			case TraceDqrProfiler::TCODE_REPEATBRANCH:
-				rc = processTraceMessage(nm,currentAddress[currentCore],lastFaddr[currentCore],lastTime[currentCore],consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_GETFIRSTSYNCMSG: processTraceMessage()\n");
-
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
-
-					return status;
-				}
-				break;
 			case TraceDqrProfiler::TCODE_ERROR:
 				// reset time. Messages have been missed.
 				lastTime[currentCore] = 0;
@@ -5351,10 +7757,31 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 			// this could be at the start of a trace, or after leaving a trace because of
 			// a correlation message
 
+			if (msgInfo != nullptr) {
+				messageInfo = nm;
+
+				messageInfo.currentAddress = currentAddress[currentCore];
+
+				messageInfo.time = lastTime[currentCore];
+
+				if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+					*msgInfo = &messageInfo;
+				}
+			}
+
 			status = TraceDqrProfiler::DQERR_OK;
 			return status;
 		case TRACE_STATE_GETMSGWITHCOUNT:
 
+			// think GETMSGWITHCOUNT and GETNEXTMSG state are the same!! If so, combine them!
+
+//			printf("TRACE_STATE_GETMSGWITHCOUNT %08x\n",lastFaddr[currentCore]);
+			// only message with i-cnt/hist/taken/notTaken will release from this state
+
+			// return any message without a count (i-cnt or hist, taken/not taken)
+
+			// do not return message with i-cnt/hist/taken/not taken; process them when counts expires
+
 			switch (nm.tcode) {
 			case TraceDqrProfiler::TCODE_SYNC:
 			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
@@ -5384,7 +7811,6 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 
 				state[currentCore] = TRACE_STATE_GETNEXTINSTRUCTION;
 				break;
-#if 0
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
 				// these message have no counts so they will be retired immediately
@@ -5412,7 +7838,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 						// no dasm or src for ext trigger in HTM instruction tracaes
 						addr = lastFaddr[currentCore];
 					}
-					else if ((instInfo != nullptr)) {
+					else if ((instInfo != nullptr) || (srcInfo != nullptr)) {
 						addr = currentAddress[currentCore];
 
 						Disassemble(addr);
@@ -5431,28 +7857,57 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 							(*instInfo)->timestamp = lastTime[currentCore];
 						}
 
+						if (srcInfo != nullptr) {
+							sourceInfo.coreId = currentCore;
+							*srcInfo = &sourceInfo;
+						}
 					}
 					state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
 				}
 
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+					messageInfo.currentAddress = addr;
 
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
 
 				readNewTraceMessage = true;
 
 				return status;
-#endif
 			case TraceDqrProfiler::TCODE_ERROR:
 				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
 
+				// don't update timestamp because we have missed some
+				//
+				// if (nm.haveTimestamp) {
+				//	lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel,lastTime[currentCore],nm.timestamp);
+				// }
+
 				nm.timestamp = 0;	// clear time because we have lost time
 				lastTime[currentCore] = 0;
 				currentAddress[currentCore] = 0;
 				lastFaddr[currentCore] = 0;
 
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+					messageInfo.currentAddress = currentAddress[currentCore];
+
+					if (messageInfo.processITCPrintData(itcPrint) == false) {
+						*msgInfo = &messageInfo;
+					}
+				}
+
 				readNewTraceMessage = true;
 
 				return status;
 			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+			case TraceDqrProfiler::TCODE_TRAP_INFO:
+			case TraceDqrProfiler::TCODE_REPEATBRANCH:			
 				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
 				if (rc != TraceDqrProfiler::DQERR_OK) {
 					printf("Error: NextInstruction(): state TRACE_STATE_GETMSGWITHCOUNT: processTraceMessage()\n");
@@ -5463,7 +7918,17 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					return status;
 				}
 
+				// for now, return message;
+
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+					messageInfo.currentAddress = currentAddress[currentCore];
 
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
 
 				readNewTraceMessage = true;
 
@@ -5481,6 +7946,15 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
 				}
 
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+					messageInfo.currentAddress = currentAddress[currentCore];
+
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
 
 				readNewTraceMessage = true;
 
@@ -5495,6 +7969,18 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 			}
 			break;
 		case TRACE_STATE_RETIREMESSAGE:
+			//			printf("TRACE_STATE_RETIREMESSAGE\n");
+
+						// Process message being retired (currently in nm) i_cnt/taken/not taken/history has gone to 0
+						// compute next address
+
+			//			set lastFaddr,currentAddress,lastTime.
+			//			readNewTraceMessage = true;
+			//			state = Trace_State_GetNextMsg;
+			//			return messageInfo.
+
+						// retire message should be run anytime any count expires - i-cnt, history, taken, not taken
+
 			switch (nm.tcode) {
 				// sync type messages say where to set pc to
 			case TraceDqrProfiler::TCODE_SYNC:
@@ -5515,6 +8001,25 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					return status;
 				}
 
+				if (msgInfo != nullptr) {
+					previousNM = nm;
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+
+					messageInfo.currentAddress = currentAddress[currentCore];
+
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
+
+				if ((srcInfo != nullptr) && (*srcInfo == nullptr)) {
+					Disassemble(currentAddress[currentCore]);
+
+					sourceInfo.coreId = currentCore;
+					*srcInfo = &sourceInfo;
+				}
+
 				// I don't think the b_type code below actaully does anything??? Remove??
 
 				TraceDqrProfiler::BType b_type;
@@ -5560,6 +8065,20 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 				readNewTraceMessage = true;
 				state[currentCore] = TRACE_STATE_GETNEXTMSG;
 				break;
+			case TraceDqrProfiler::TCODE_TRAP_INFO:
+			case TraceDqrProfiler::TCODE_REPEATBRANCH:
+				rc = processTraceMessage(nm,currentAddress[currentCore],lastFaddr[currentCore],lastTime[currentCore],consumed);
+				if (rc != TraceDqrProfiler::DQERR_OK) {
+					printf("Error: NextInstruction(): state TRACE_STATE_RETIREMESSAGE: processTraceMessage()\n");
+
+					status = TraceDqrProfiler::DQERR_ERR;
+					state[currentCore] = TRACE_STATE_ERROR;
+
+					return status;
+				}
+
+				readNewTraceMessage = true;
+				break;
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
 				// these messages should have been retired immediately
@@ -5576,7 +8095,18 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
 				}
 
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+
+					// leaving trace mode - currentAddress should be last faddr + i_cnt *2
+
+					messageInfo.currentAddress = lastFaddr[currentCore] + nm.correlation.i_cnt * 2;
 
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
 
 				readNewTraceMessage = true;
 
@@ -5639,7 +8169,6 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 
 				state[currentCore] = TRACE_STATE_GETNEXTINSTRUCTION;
 				break;
-#if 0
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
 			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
 				// these message have no counts so they will be retired immeadiately
@@ -5667,7 +8196,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 						// no dasm or src for ext trigger in HTM instruction tracaes
 						addr = lastFaddr[currentCore];
 					}
-					else if ((instInfo != nullptr)) {
+					else if ((instInfo != nullptr) || (srcInfo != nullptr)) {
 						addr = currentAddress[currentCore];
 
 						Disassemble(addr);
@@ -5687,15 +8216,26 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 							(*instInfo)->timestamp = lastTime[currentCore];
 						}
 
-
+						if (srcInfo != nullptr) {
+							sourceInfo.coreId = currentCore;
+							*srcInfo = &sourceInfo;
+						}
 					}
 				}
 
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+					messageInfo.currentAddress = addr;
+
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
 
 				readNewTraceMessage = true;
 
 				return status;
-#endif
 			case TraceDqrProfiler::TCODE_ERROR:
 				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
 
@@ -5704,12 +8244,23 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 				lastFaddr[currentCore] = 0;
 				lastTime[currentCore] = 0;
 
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+					messageInfo.currentAddress = currentAddress[currentCore];
+
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
 
 				readNewTraceMessage = true;
 
 				return status;
 			case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
 			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
+			case TraceDqrProfiler::TCODE_TRAP_INFO:
+			case TraceDqrProfiler::TCODE_REPEATBRANCH:			
 				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
 				if (rc != TraceDqrProfiler::DQERR_OK) {
 					printf("Error: NextInstruction(): state TRACE_STATE_GETNXTMSG: processTraceMessage()\n");
@@ -5720,6 +8271,17 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					return status;
 				}
 
+				// for now, return message;
+
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+					messageInfo.currentAddress = currentAddress[currentCore];
+
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
 
 				readNewTraceMessage = true;
 
@@ -5731,6 +8293,15 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
 				}
 
+				if (msgInfo != nullptr) {
+					messageInfo = nm;
+					messageInfo.time = lastTime[currentCore];
+					messageInfo.currentAddress = currentAddress[currentCore];
+
+					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
+						*msgInfo = &messageInfo;
+					}
+				}
 
 				// leave state along. Need to get another message with an i-cnt!
 
@@ -5754,8 +8325,14 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 				break;
 			}
 
+			//			printf("state TRACE_STATE_GETNEXTINSTRUCTION\n");
+
+						// Should first process addr, and then compute next addr!!! If can't compute next addr, it is an error.
+						// Should always be able to process instruction at addr and compute next addr when we get here.
+						// After processing next addr, if there are no more counts, retire trace message and get another
+
 			addr = currentAddress[currentCore];
-			address_out = addr;
+
 			uint32_t inst;
 			int inst_size;
 			TraceDqrProfiler::InstType inst_type;
@@ -5767,7 +8344,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 
 			// getInstrucitonByAddress() should cache last instrucioton/address because I thjink
 			// it gets called a couple times for each address/insruction in a row
-#if 0
+
 			status = elfReader->getInstructionByAddress(addr, inst);
 			if (status != TraceDqrProfiler::DQERR_OK) {
 				printf("Error: getInstructionByAddress failed - looking for next sync message\n");
@@ -5801,10 +8378,9 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 
 				return status;
 			}
-#endif
-#if 0
+
 			Disassemble(addr);
-#endif
+
 			// compute next address (retire this instruction)
 
 			// nextAddr() will also update counts
@@ -5821,9 +8397,8 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 			if (status != TraceDqrProfiler::DQERR_OK) {
 				printf("Error: nextAddr() failed\n");
 
-				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+				state[currentCore] = TRACE_STATE_ERROR;
 
-				status = TraceDqrProfiler::DQERR_OK;
 				return status;
 			}
 
@@ -5848,24 +8423,28 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					// error
 					// must have a JR/JALR or exception/exception return to get here, and the CR stack is empty
 
-					//printf("Error: getCurrentCountType(core:%d) still has counts; have countType: %d\n", currentCore, counts->getCurrentCountType(currentCore));
-					//char d[64];
+					printf("Error: getCurrentCountType(core:%d) still has counts; have countType: %d\n", currentCore, counts->getCurrentCountType(currentCore));
+					char d[64];
 
-					//instructionInfo.instructionToText(d, sizeof d, 2);
-					//printf("%08llx:    %s\n", currentAddress[currentCore], d);
+					instructionInfo.instructionToText(d, sizeof d, 2);
+					printf("%08llx:    %s\n", currentAddress[currentCore], d);
 
-					//state[currentCore] = TRACE_STATE_ERROR;
+					state[currentCore] = TRACE_STATE_ERROR;
 
-					//status = TraceDqrProfiler::DQERR_ERR;
-					//return status;
+					status = TraceDqrProfiler::DQERR_ERR;
 
-					// Profiling will return error in case there is an issue with a trace record.
-					// This will lead to loss of data. In case the profiler is not able to continue,
-					// we can reset the state to TRACE_STATE_GETFIRSTSYNCMSG which will restart
-					// profiling at the next sync packet.
-					state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+					//					nm.dumpRawMessage();
+					//					nm.dump();
+					//
+					//					rc = sfp->readNextTraceMsg(nm,analytics,haveMsg);
+					//
+					//					if (rc != TraceDqrProfiler::DQERR_OK) {
+					//						printf("Error: TraceProfiler file does not contain any trace messages, or is unreadable\n");
+					//					} else if (haveMsg != false) {
+					//						nm.dumpRawMessage();
+					//						nm.dump();
+					//					}
 
-					status = TraceDqrProfiler::DQERR_OK;
 					return status;
 				}
 			}
@@ -5874,7 +8453,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 
 			uint32_t prevCycle;
 			prevCycle = 0;
-#if 0
+
 			if (caTrace != nullptr) {
 				if (syncCount > 0) {
 					if (caSyncAddr == instructionInfo.address) {
@@ -5912,10 +8491,8 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 					lastCycle[currentCore] = pipeCycles;
 				}
 			}
-#endif
 
-			if (instInfo != nullptr) 
-			{
+			if (instInfo != nullptr) {
 				instructionInfo.qDepth = qDepth;
 				instructionInfo.arithInProcess = arithInProcess;
 				instructionInfo.loadInProcess = loadInProcess;
@@ -5946,11 +8523,23 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 				else {
 					(*instInfo)->timestamp = lastTime[currentCore];
 				}
+
+				if (lazyInstText == false) {
+					resolveInstructionText(*instInfo);
+				}
+			}
+
+			//			lastCycle[currentCore] = cycles;
+
+			if (srcInfo != nullptr) {
+				sourceInfo.coreId = currentCore;
+				*srcInfo = &sourceInfo;
+
+				if (lazyInstText == false) {
+					resolveSourceInfo(instructionInfo.address, &sourceInfo);
+				}
 			}
 
-			//			lastCycle[currentCore] = cycles;
-
-#if 0
 			status = analytics.updateInstructionInfo(currentCore, inst, inst_size, crFlag, brFlags);
 			if (status != TraceDqrProfiler::DQERR_OK) {
 				state[currentCore] = TRACE_STATE_ERROR;
@@ -5958,7 +8547,7 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 				printf("Error: updateInstructionInfo() failed\n");
 				return status;
 			}
-#endif
+
 
 			if (counts->getCurrentCountType(currentCore) != TraceDqrProfiler::COUNTTYPE_none) {
 				// still have valid counts. Keep running nextInstruction!
@@ -5993,1500 +8582,1789 @@ TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** ins
 	status = TraceDqrProfiler::DQERR_OK;
 	return TraceDqrProfiler::DQERR_OK;
 }
-//NextInstruction() want to return address, instruction, trace message if any, label+offset for instruction, target of instruciton
-//		source code for instruction (file, function, line)
-//
-//		return instruction object (include label informatioon)
-//		return message object
-//		return source code object//
-//
-//				if instruction object ptr is null, don't return any instruction info
-//				if message object ptr is null, don't return any message info
-//				if source code object is null, don't return source code info
 
-TraceDqrProfiler::DQErr TraceProfiler::NextInstruction(ProfilerInstruction** instInfo, ProfilerNexusMessage** msgInfo, ProfilerSource** srcInfo)
+ProfilerHistogram::const_iterator::const_iterator(const ProfilerHistogram* hist, size_t region, size_t slot)
 {
-	if (sfp == nullptr) {
-		printf("Error: TraceProfiler::NextInstructin(): Null sfp object\n");
+	this->hist = hist;
+	this->region = region;
+	this->slot = slot;
 
-		status = TraceDqrProfiler::DQERR_ERR;
-		return status;
+	skipEmpty();
+}
+
+ProfilerHistogram::Entry ProfilerHistogram::const_iterator::operator*() const
+{
+	if (region < hist->regions.size()) {
+		const Region& r = hist->regions[region];
+		return Entry(r.startAddr + ((uint64_t)slot << 1), r.counts[slot]);
 	}
 
-	if (status != TraceDqrProfiler::DQERR_OK) {
-		return status;
+	return Entry(hist->outlierAddrs[slot], hist->outlierCounts[slot]);
+}
+
+ProfilerHistogram::const_iterator& ProfilerHistogram::const_iterator::operator++()
+{
+	slot += 1;
+	skipEmpty();
+
+	return *this;
+}
+
+void ProfilerHistogram::const_iterator::skipEmpty()
+{
+	while (region < hist->regions.size()) {
+		const std::vector<uint64_t>& counts = hist->regions[region].counts;
+
+		while ((slot < counts.size()) && (counts[slot] == 0)) {
+			slot += 1;
+		}
+
+		if (slot < counts.size()) {
+			return;
+		}
+
+		region += 1;
+		slot = 0;
 	}
 
-	TraceDqrProfiler::DQErr rc;
-	TraceDqrProfiler::ADDRESS addr;
-	int crFlag;
-	TraceDqrProfiler::BranchFlags brFlags;
-	uint32_t caFlags = 0;
-	uint32_t pipeCycles = 0;
-	uint32_t viStartCycles = 0;
-	uint32_t viFinishCycles = 0;
+	while ((slot < hist->outlierCounts.size()) && (hist->outlierCounts[slot] == 0)) {
+		slot += 1;
+	}
+}
 
-	uint8_t qDepth = 0;
-	uint8_t arithInProcess = 0;
-	uint8_t loadInProcess = 0;
-	uint8_t storeInProcess = 0;
+ProfilerHistogram::ProfilerHistogram()
+{
+	lastRegion = 0;
+	outlierUsed = 0;
+	numAddrs = 0;
+	tracking = false;
+}
 
-	bool consumed = false;
+void ProfilerHistogram::addRegion(uint64_t startAddr, uint64_t endAddr)
+{
+	if (endAddr < startAddr) {
+		return;
+	}
 
-	ProfilerInstruction** savedInstPtr = nullptr;
-	ProfilerNexusMessage** savedMsgPtr = nullptr;
-	ProfilerSource** savedSrcPtr = nullptr;
+	// regions must not overlap, or an address could be counted in two places
 
-	if (instInfo != nullptr) {
-		*instInfo = nullptr;
+	size_t i;
+
+	for (i = 0; (i < regions.size()) && (regions[i].startAddr < startAddr); i++) {
+		// empty
 	}
 
-	if (msgInfo != nullptr) {
-		*msgInfo = nullptr;
+	if ((i > 0) && (regions[i - 1].endAddr >= startAddr)) {
+		return;
 	}
 
-	if (srcInfo != nullptr) {
-		*srcInfo = nullptr;
+	if ((i < regions.size()) && (regions[i].startAddr <= endAddr)) {
+		return;
 	}
 
-	for (;;) {
-		//		need to set readNewTraceMessage where it is needed! That includes
-		//		staying in the same state that expects to get another message!!
+	Region r;
 
-		bool haveMsg;
+	r.startAddr = startAddr;
+	r.endAddr = endAddr;
 
-		if (savedInstPtr != nullptr) {
-			instInfo = savedInstPtr;
-			savedInstPtr = nullptr;
+	regions.insert(regions.begin() + i, r);
+}
+
+size_t ProfilerHistogram::findRegion(uint64_t addr) const
+{
+	size_t lo = 0;
+	size_t hi = regions.size();
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+
+		if (regions[mid].endAddr < addr) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
 		}
+	}
 
-		if (savedMsgPtr != nullptr) {
-			msgInfo = savedMsgPtr;
-			savedMsgPtr = nullptr;
+	if ((lo < regions.size()) && (regions[lo].startAddr <= addr)) {
+		return lo;
+	}
+
+	return regions.size();
+}
+
+size_t ProfilerHistogram::outlierSlot(uint64_t addr) const
+{
+	// table size is a power of two and never full, so this always finds addr or an empty slot
+
+	size_t mask = outlierAddrs.size() - 1;
+	size_t i = (size_t)((addr * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+
+	while ((outlierCounts[i] != 0) && (outlierAddrs[i] != addr)) {
+		i = (i + 1) & mask;
+	}
+
+	return i;
+}
+
+void ProfilerHistogram::growOutliers()
+{
+	std::vector<uint64_t> oldAddrs;
+	std::vector<uint64_t> oldCounts;
+	std::vector<uint8_t> oldChanged;
+
+	oldAddrs.swap(outlierAddrs);
+	oldCounts.swap(outlierCounts);
+	oldChanged.swap(outlierChanged);
+
+	size_t newSize = (oldAddrs.size() == 0) ? 64 : oldAddrs.size() * 2;
+
+	outlierAddrs.assign(newSize, 0);
+	outlierCounts.assign(newSize, 0);
+
+	if (tracking) {
+		outlierChanged.assign(newSize, 0);
+	}
+
+	for (size_t i = 0; i < oldCounts.size(); i++) {
+		if (oldCounts[i] != 0) {
+			size_t j = outlierSlot(oldAddrs[i]);
+
+			outlierAddrs[j] = oldAddrs[i];
+			outlierCounts[j] = oldCounts[i];
+
+			if (tracking) {
+				outlierChanged[j] = oldChanged[i];
+			}
 		}
+	}
+}
 
-		if (savedSrcPtr != nullptr) {
-			srcInfo = savedSrcPtr;
-			savedSrcPtr = nullptr;
+void ProfilerHistogram::allocRegion(Region& r)
+{
+	size_t slots = (size_t)((r.endAddr - r.startAddr) >> 1) + 1;
+
+	r.counts.assign(slots, 0);
+
+	if (tracking) {
+		r.changed.assign((slots + 63) / 64, 0);
+	}
+}
+
+void ProfilerHistogram::addSlow(uint64_t addr, uint64_t n)
+{
+	size_t ri = findRegion(addr);
+
+	if ((ri < regions.size()) && (((addr - regions[ri].startAddr) & 1) == 0)) {
+		Region& r = regions[ri];
+
+		if (r.counts.empty()) {
+			allocRegion(r);
 		}
 
-		if (readNewTraceMessage != false) {
-			do {
-				rc = sfp->readNextTraceMsg(nm, analytics, haveMsg);
+		lastRegion = ri;
 
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					// have an error. either EOF, or error
+		size_t slot = (size_t)((addr - r.startAddr) >> 1);
+		uint64_t& c = r.counts[slot];
+		if (tracking && ((r.changed[slot >> 6] & (1ULL << (slot & 0x3f))) == 0)) {
+			r.changed[slot >> 6] |= 1ULL << (slot & 0x3f);
+			changes.push_back(Entry(addr, c));
+		}
+		if (c == 0) {
+			numAddrs += 1;
+		}
+		c += n;
 
-					status = rc;
+		return;
+	}
 
-					if (status == TraceDqrProfiler::DQERR_EOF) {
-						state[currentCore] = TRACE_STATE_DONE;
-					}
-					else {
-						printf("Error: TraceProfiler file does not contain any trace messages, or is unreadable\n");
+	// keep the table at most half full
 
-						state[currentCore] = TRACE_STATE_ERROR;
-					}
+	if ((outlierUsed + 1) * 2 > outlierAddrs.size()) {
+		growOutliers();
+	}
 
-					return status;
+	size_t i = outlierSlot(addr);
+
+	if (outlierCounts[i] == 0) {
+		outlierAddrs[i] = addr;
+		outlierUsed += 1;
+		numAddrs += 1;
+	}
+
+	if (tracking && (outlierChanged[i] == 0)) {
+		outlierChanged[i] = 1;
+		changes.push_back(Entry(addr, outlierCounts[i]));
+	}
+
+	outlierCounts[i] += n;
+}
+
+uint64_t ProfilerHistogram::getCount(uint64_t addr) const
+{
+	size_t ri = findRegion(addr);
+
+	if ((ri < regions.size()) && (((addr - regions[ri].startAddr) & 1) == 0)) {
+		const Region& r = regions[ri];
+
+		if (r.counts.empty()) {
+			return 0;
+		}
+
+		return r.counts[(addr - r.startAddr) >> 1];
+	}
+
+	if (outlierUsed == 0) {
+		return 0;
+	}
+
+	return outlierCounts[outlierSlot(addr)];
+}
+
+void ProfilerHistogram::clear()
+{
+	for (size_t i = 0; i < regions.size(); i++) {
+		std::vector<uint64_t>().swap(regions[i].counts);
+		std::vector<uint64_t>().swap(regions[i].changed);
+	}
+
+	std::vector<uint64_t>().swap(outlierAddrs);
+	std::vector<uint64_t>().swap(outlierCounts);
+	std::vector<uint8_t>().swap(outlierChanged);
+	std::vector<Entry>().swap(changes);
+
+	lastRegion = 0;
+	outlierUsed = 0;
+	numAddrs = 0;
+}
+
+void ProfilerHistogram::trackChanges(bool enable)
+{
+	if (enable == tracking) {
+		return;
+	}
+
+	tracking = enable;
+
+	// counts from before tracking was turned on are not reported as changes
+
+	for (size_t i = 0; i < regions.size(); i++) {
+		if (enable && !regions[i].counts.empty()) {
+			regions[i].changed.assign((regions[i].counts.size() + 63) / 64, 0);
+		}
+		else {
+			std::vector<uint64_t>().swap(regions[i].changed);
+		}
+	}
+
+	if (enable) {
+		outlierChanged.assign(outlierAddrs.size(), 0);
+	}
+	else {
+		std::vector<uint8_t>().swap(outlierChanged);
+	}
+
+	std::vector<Entry>().swap(changes);
+}
+
+void ProfilerHistogram::takeChanges(std::vector<Entry>& deltas)
+{
+	deltas.clear();
+
+	if (tracking == false) {
+		return;
+	}
+
+	deltas.reserve(changes.size());
+
+	for (size_t i = 0; i < changes.size(); i++) {
+		uint64_t addr = changes[i].first;
+		size_t ri = findRegion(addr);
+
+		if ((ri < regions.size()) && (((addr - regions[ri].startAddr) & 1) == 0)) {
+			Region& r = regions[ri];
+			size_t slot = (size_t)((addr - r.startAddr) >> 1);
+
+			r.changed[slot >> 6] &= ~(1ULL << (slot & 0x3f));
+			deltas.push_back(Entry(addr, r.counts[slot] - changes[i].second));
+		}
+		else {
+			size_t slot = outlierSlot(addr);
+
+			outlierChanged[slot] = 0;
+			deltas.push_back(Entry(addr, outlierCounts[slot] - changes[i].second));
+		}
+	}
+
+	changes.clear();
+}
+
+void ProfilerHistogram::toMap(std::unordered_map<uint64_t, uint64_t>& map) const
+{
+	map.clear();
+	map.reserve(numAddrs);
+
+	for (const_iterator it = begin(); it != end(); ++it) {
+		Entry e = *it;
+		map[e.first] = e.second;
+	}
+}
+
+HistogramSummarizer::HistogramSummarizer(ElfReader* elfReader, uint32_t levels)
+{
+	this->elfReader = elfReader;
+	this->levels = levels;
+	symtab = (elfReader != nullptr) ? elfReader->getSymtab() : nullptr;
+	numBlocks = 0;
+	outsideCode = 0;
+
+	lastSection = nullptr;
+	lastSectionInfo = nullptr;
+	lastSym = nullptr;
+	lastFuncKey = 0;
+
+	// key 0 is where counts without a function or line go
+
+	ProfilerHistogramSummary::FuncCount fc;
+
+	fc.function = nullptr;
+	fc.address = 0;
+	fc.count = 0;
+	funcCounts.push_back(fc);
+
+	ProfilerHistogramSummary::LineCount lc;
+
+	lc.file = nullptr;
+	lc.line = 0;
+	lc.count = 0;
+	lineCounts.push_back(lc);
+}
+
+static bool isDirectJump(TraceDqrProfiler::InstType instType)
+{
+	switch (instType) {
+	case TraceDqrProfiler::INST_JAL:
+	case TraceDqrProfiler::INST_C_J:
+	case TraceDqrProfiler::INST_C_JAL:
+	case TraceDqrProfiler::INST_BEQ:
+	case TraceDqrProfiler::INST_BNE:
+	case TraceDqrProfiler::INST_BLT:
+	case TraceDqrProfiler::INST_BGE:
+	case TraceDqrProfiler::INST_BLTU:
+	case TraceDqrProfiler::INST_BGEU:
+	case TraceDqrProfiler::INST_C_BEQZ:
+	case TraceDqrProfiler::INST_C_BNEZ:
+		return true;
+	default:
+		break;
+	}
+
+	return false;
+}
+
+void HistogramSummarizer::findBlocks(Section* sp, SectionInfo& si)
+{
+	si.haveBlocks = true;
+	si.firstBlock = numBlocks;
+	si.blockStarts.clear();
+
+	if ((sp->code == nullptr) || (sp->plainRun == nullptr)) {
+		return;
+	}
+
+	// mark the block starts in one pass over the instructions, then collect them. plainRun is 0 for control flow
+	// instructions and for anything that does not decode; either ends a block. A branch target may be before
+	// the branch, so the starts cannot be collected in the same pass
+
+	uint32_t numSlots = sp->size / 2;
+	std::vector<bool> leader(numSlots, false);
+	const Sym* prevSym = nullptr;
+
+	if (numSlots > 0) {
+		leader[0] = true;
+	}
+
+	for (uint32_t index = 0; index < numSlots;) {
+		uint32_t next = index + (((sp->code[index] & 0x0003) == 0x0003) ? 2 : 1);
+		TraceDqrProfiler::ADDRESS addr = sp->startAddr + ((TraceDqrProfiler::ADDRESS)index << 1);
+
+		if (symtab != nullptr) {
+			Sym* sym = nullptr;
+
+			symtab->lookupSymbolByAddress(addr, sym);
+			if ((sym != nullptr) && (sym != prevSym) && (sym->address == addr)) {
+				leader[index] = true;
+			}
+			prevSym = sym;
+		}
+
+		if (sp->plainRun[index] == 0) {
+			if (next < numSlots) {
+				leader[next] = true;
+			}
+
+			if ((sp->decoded != nullptr) && sp->decoded[index].valid && isDirectJump((TraceDqrProfiler::InstType)sp->decoded[index].instType)) {
+				TraceDqrProfiler::ADDRESS target = addr + sp->decoded[index].immediate;
+
+				if ((target >= sp->startAddr) && (target <= sp->endAddr)) {
+					leader[(target - sp->startAddr) >> 1] = true;
 				}
+			}
+		}
+
+		index = next;
+	}
+
+	for (uint32_t index = 0; index < numSlots; index++) {
+		if (leader[index]) {
+			si.blockStarts.push_back(index);
+		}
+	}
 
-				if (haveMsg == false) {
-					lastTime[currentCore] = 0;
-					currentAddress[currentCore] = 0;
-					lastFaddr[currentCore] = 0;
+	numBlocks += (uint32_t)si.blockStarts.size();
 
-					state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
-				}
-			} while (haveMsg == false);
+	for (size_t i = 0; i < si.blockStarts.size(); i++) {
+		ProfilerHistogramSummary::BlockCount bc;
 
-			readNewTraceMessage = false;
-			currentCore = nm.coreId;
+		bc.startAddr = sp->startAddr + ((TraceDqrProfiler::ADDRESS)si.blockStarts[i] << 1);
+		if (i + 1 < si.blockStarts.size()) {
+			bc.endAddr = sp->startAddr + ((TraceDqrProfiler::ADDRESS)si.blockStarts[i + 1] << 1) - 1;
+		}
+		else {
+			bc.endAddr = sp->endAddr;
+		}
+		bc.count = 0;
+		bc.entries = 0;
 
-			// if set see if HTM trace message, switch to HTM mode
+		blockCounts.push_back(bc);
+	}
+}
 
-			if (traceType != TraceDqrProfiler::TRACETYPE_HTM) {
-				switch (nm.tcode) {
-				case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-				case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-				case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-				case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-				case TraceDqrProfiler::TCODE_ERROR:
-				case TraceDqrProfiler::TCODE_SYNC:
-				case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-				case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-				case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-				case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-				case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-					break;
-				case TraceDqrProfiler::TCODE_CORRELATION:
-					if (nm.correlation.cdf == 1) {
-						traceType = TraceDqrProfiler::TRACETYPE_HTM;
-						if (profiler_globalDebugFlag) printf("TCODE_CORRELATION, cdf == 1: switching to HTM mode\n");
-					}
-					break;
-				case TraceDqrProfiler::TCODE_RESOURCEFULL:
-				case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-				case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-					traceType = TraceDqrProfiler::TRACETYPE_HTM;
-					if (profiler_globalDebugFlag) printf("History/taken/not taken count TCODE: switching to HTM mode\n");
-					break;
-				case TraceDqrProfiler::TCODE_REPEATBRANCH:
-				case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-				case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-				case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-				case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-				case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-				case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-				case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-				case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-				case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-				case TraceDqrProfiler::TCODE_DATA_READ_WS:
-				case TraceDqrProfiler::TCODE_WATCHPOINT:
-				case TraceDqrProfiler::TCODE_CORRECTION:
-				case TraceDqrProfiler::TCODE_DATA_WRITE:
-				case TraceDqrProfiler::TCODE_DATA_READ:
-				case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-				case TraceDqrProfiler::TCODE_DEVICE_ID:
-					printf("Error: NextInstruction(): Unsupported tcode type (%d)\n", nm.tcode);
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+void HistogramSummarizer::findLineKeys(Section* sp, SectionInfo& si)
+{
+	si.haveLineKeys = true;
+	si.lineKeys.resize(sp->lines.size());
 
-					return status;
-				case TraceDqrProfiler::TCODE_UNDEFINED:
-					printf("Error: NextInstruction(): Undefined tcode type (%d)\n", nm.tcode);
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	for (size_t i = 0; i < sp->lines.size(); i++) {
+		const LineRange& lr = sp->lines[i];
 
-					return status;
-				}
-			}
+		if (lr.file == nullptr) {
+			si.lineKeys[i] = 0;
+			continue;
+		}
 
-			// Check if this is a ICT Control message and if we are filtering them out
+		std::pair<const char*, uint32_t> fileLine(lr.file, lr.line);
+		std::map<std::pair<const char*, uint32_t>, uint32_t>::iterator it = lineKeyMap.find(fileLine);
 
-			switch (nm.tcode) {
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-				if ((nm.getCKSRC() == TraceDqrProfiler::ICT_CONTROL) && (eventFilterMask & (1 << PROFILER_CTF::et_controlIndex))) {
-					savedInstPtr = instInfo;
-					instInfo = nullptr;
-					savedMsgPtr = msgInfo;
-					msgInfo = nullptr;
-					savedSrcPtr = srcInfo;
-					srcInfo = nullptr;
-				}
-				break;
-			default:
-				break;
-			}
+		if (it != lineKeyMap.end()) {
+			si.lineKeys[i] = it->second;
+			continue;
 		}
 
-		switch (state[currentCore]) {
-		case TRACE_STATE_SYNCCATE:	// Looking for a CA trace sync
-			// printf("TRACE_STATE_SYNCCATE\n");
+		ProfilerHistogramSummary::LineCount lc;
 
-			if (caTrace == nullptr) {
-				// have an error! Should never have TRACE_STATE_SYNC without a caTrace ptr
-				printf("Error: caTrace is null\n");
-				status = TraceDqrProfiler::DQERR_ERR;
-				state[currentCore] = TRACE_STATE_ERROR;
-				return status;
-			}
+		lc.file = lr.file;
+		lc.line = lr.line;
+		lc.count = 0;
 
-			// loop through trace messages until we find a sync of some kind. First sync should do it
-			// sync reason must be correct (exit debug or start tracing) or we stay in this state
+		si.lineKeys[i] = (uint32_t)lineCounts.size();
+		lineKeyMap[fileLine] = si.lineKeys[i];
+		lineCounts.push_back(lc);
+	}
+}
 
-			TraceDqrProfiler::ADDRESS teAddr;
+HistogramSummarizer::SectionInfo& HistogramSummarizer::getSectionInfo(Section* sp)
+{
+	SectionInfo& si = sections[sp];
 
-			switch (nm.tcode) {
-			case TraceDqrProfiler::TCODE_ERROR:
-				// reset time. Messages have been missed. Address may not still be 0 if we have seen a sync
-				// message without an exit debug or start trace sync reason, so reset address
+	if ((levels & ProfilerHistogramSummary::sumBlock) && !si.haveBlocks) {
+		findBlocks(sp, si);
+	}
 
-				lastTime[currentCore] = 0;
-				currentAddress[currentCore] = 0;
-				lastFaddr[currentCore] = 0;
+	if ((levels & ProfilerHistogramSummary::sumLine) && !si.haveLineKeys) {
+		findLineKeys(sp, si);
+	}
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
+	return si;
+}
 
-					// currentAddresss should be 0 until we get a sync message. TS has been set to 0
+void HistogramSummarizer::addCount(TraceDqrProfiler::ADDRESS addr, uint64_t n)
+{
+	Section* sp = lastSection;
+	SectionInfo* si = lastSectionInfo;
 
-					messageInfo.currentAddress = currentAddress[currentCore];
-					messageInfo.time = lastTime[currentCore];
+	if ((sp == nullptr) || (addr < sp->startAddr) || (addr > sp->endAddr)) {
+		sp = (elfReader != nullptr) ? elfReader->getSectionByAddress(addr) : nullptr;
+		si = (sp != nullptr) ? &getSectionInfo(sp) : nullptr;
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+		// an address outside every section is looked up again next time; they are rare
 
-				readNewTraceMessage = true;
+		if (sp != nullptr) {
+			lastSection = sp;
+			lastSectionInfo = si;
+		}
+	}
 
-				status = TraceDqrProfiler::DQERR_OK;
+	uint32_t index = (sp != nullptr) ? (uint32_t)((addr - sp->startAddr) >> 1) : 0;
 
-				return status;
-			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-			case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-			case TraceDqrProfiler::TCODE_CORRELATION:
-			case TraceDqrProfiler::TCODE_RESOURCEFULL:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-			case TraceDqrProfiler::TCODE_REPEATBRANCH:
-			case TraceDqrProfiler::TCODE_REPEATINSTRUCTION:
-			case TraceDqrProfiler::TCODE_REPEATINSTRUCTION_WS:
-			case TraceDqrProfiler::TCODE_AUXACCESS_READNEXT:
-			case TraceDqrProfiler::TCODE_AUXACCESS_WRITENEXT:
-			case TraceDqrProfiler::TCODE_AUXACCESS_RESPONSE:
-			case TraceDqrProfiler::TCODE_OUTPUT_PORTREPLACEMENT:
-			case TraceDqrProfiler::TCODE_INPUT_PORTREPLACEMENT:
-			case TraceDqrProfiler::TCODE_AUXACCESS_READ:
-				// here we return the trace messages before we have actually started tracing
-				// this could be at the start of a trace, or after leaving a trace because of
-				// a correlation message
+	if (levels & ProfilerHistogramSummary::sumFunction) {
+		Sym* sym = nullptr;
 
-						// we may have a valid address and time already if we saw a sync without an exit debug				        // or start trace sync reason. So call processTraceMessage()
+		if (symtab != nullptr) {
+			symtab->lookupSymbolByAddress(addr, sym);
+		}
 
-				if (lastFaddr[currentCore] != 0) {
-					rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-					if (rc != TraceDqrProfiler::DQERR_OK) {
-						printf("Error: NextInstruction(): state TRACE_STATE_SYNCCATE: processTraceMessage()\n");
+		if (sym != lastSym) {
+			lastSym = sym;
 
-						status = TraceDqrProfiler::DQERR_ERR;
-						state[currentCore] = TRACE_STATE_ERROR;
+			if (sym == nullptr) {
+				lastFuncKey = 0;
+			}
+			else {
+				std::unordered_map<const Sym*, uint32_t>::iterator fk = funcKeys.find(sym);
 
-						return status;
-					}
+				if (fk != funcKeys.end()) {
+					lastFuncKey = fk->second;
 				}
+				else {
+					ProfilerHistogramSummary::FuncCount fc;
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
+					fc.function = sym->name;
+					fc.address = sym->address;
+					fc.count = 0;
 
-					// currentAddresss should be 0 until we get a sync message. TS may
-					// have been set by a ICT control WS message
+					lastFuncKey = (uint32_t)funcCounts.size();
+					funcKeys[sym] = lastFuncKey;
+					funcCounts.push_back(fc);
+				}
+			}
+		}
 
-					messageInfo.currentAddress = currentAddress[currentCore];
-					messageInfo.time = lastTime[currentCore];
+		if (funcCounts[lastFuncKey].count == 0) {
+			usedFuncs.push_back(lastFuncKey);
+		}
+		funcCounts[lastFuncKey].count += n;
+	}
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+	if (levels & ProfilerHistogramSummary::sumLine) {
+		uint32_t lineKey = 0;
 
-				readNewTraceMessage = true;
+		if (sp != nullptr) {
+			const LineRange* lr = sp->getSrcLine(index);
 
-				status = TraceDqrProfiler::DQERR_OK;
+			if (lr != nullptr) {
+				lineKey = si->lineKeys[lr - sp->lines.data()];
+			}
+		}
 
-				return status;
-			case TraceDqrProfiler::TCODE_SYNC:
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-				// sync reason should be either EXIT_DEBUG or TRACE_ENABLE. Otherwise, keep looking
+		if (lineCounts[lineKey].count == 0) {
+			usedLines.push_back(lineKey);
+		}
+		lineCounts[lineKey].count += n;
+	}
 
-				TraceDqrProfiler::SyncReason sr;
+	if (levels & ProfilerHistogramSummary::sumBlock) {
+		std::vector<uint32_t>::const_iterator bs;
 
-				sr = nm.getSyncReason();
-				switch (sr) {
-				case TraceDqrProfiler::SYNC_EXIT_DEBUG:
-				case TraceDqrProfiler::SYNC_TRACE_ENABLE:
-					// only exit debug or trace enable allow proceeding. All others stay in this state and return
+		if (sp != nullptr) {
+			bs = std::upper_bound(si->blockStarts.begin(), si->blockStarts.end(), index);
+		}
 
-					teAddr = nm.getF_Addr() << 1;
-					break;
-				case TraceDqrProfiler::SYNC_EVTI:
-				case TraceDqrProfiler::SYNC_EXIT_RESET:
-				case TraceDqrProfiler::SYNC_T_CNT:
-				case TraceDqrProfiler::SYNC_I_CNT_OVERFLOW:
-				case TraceDqrProfiler::SYNC_WATCHPINT:
-				case TraceDqrProfiler::SYNC_FIFO_OVERRUN:
-				case TraceDqrProfiler::SYNC_EXIT_POWERDOWN:
-				case TraceDqrProfiler::SYNC_MESSAGE_CONTENTION:
-				case TraceDqrProfiler::SYNC_PC_SAMPLE:
-					// here we return the trace messages before we have actually started tracing
-					// this could be at the start of a trace, or after leaving a trace because of
-					// a correlation message
-					// probably should never get here when doing a CA trace.
+		if ((sp == nullptr) || (bs == si->blockStarts.begin())) {
+			outsideCode += n;
+		}
+		else {
+			uint32_t blockKey = si->firstBlock + (uint32_t)(bs - si->blockStarts.begin()) - 1;
+			ProfilerHistogramSummary::BlockCount& bc = blockCounts[blockKey];
 
-					rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-					if (rc != TraceDqrProfiler::DQERR_OK) {
-						printf("Error: NextInstruction(): state TRACE_STATE_SYNCCATE: processTraceMessage()\n");
+			if (bc.count == 0) {
+				usedBlocks.push_back(blockKey);
+			}
+			bc.count += n;
+			if (bc.startAddr == addr) {
+				bc.entries += n;
+			}
+		}
+	}
+}
 
-						status = TraceDqrProfiler::DQERR_ERR;
-						state[currentCore] = TRACE_STATE_ERROR;
+void HistogramSummarizer::add(const ProfilerHistogram::Entry* delta, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (delta[i].second != 0) {
+			addCount(delta[i].first, delta[i].second);
+		}
+	}
+}
 
-						return status;
-					}
+void HistogramSummarizer::add(const ProfilerHistogram& hist)
+{
+	for (ProfilerHistogram::const_iterator it = hist.begin(); it != hist.end(); ++it) {
+		ProfilerHistogram::Entry e = *it;
 
-					if (msgInfo != nullptr) {
-						messageInfo = nm;
+		addCount(e.first, e.second);
+	}
+}
 
-						// if doing pc-sampling and msg type is INCIRCUITTRACE_WS, we want to use faddr
-						// and not currentAddress
+void HistogramSummarizer::clear()
+{
+	for (size_t i = 0; i < usedFuncs.size(); i++) {
+		funcCounts[usedFuncs[i]].count = 0;
+	}
 
-						messageInfo.currentAddress = nm.getF_Addr() << 1;
+	for (size_t i = 0; i < usedLines.size(); i++) {
+		lineCounts[usedLines[i]].count = 0;
+	}
 
-						if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-							*msgInfo = &messageInfo;
-						}
-					}
+	for (size_t i = 0; i < usedBlocks.size(); i++) {
+		blockCounts[usedBlocks[i]].count = 0;
+		blockCounts[usedBlocks[i]].entries = 0;
+	}
 
-					readNewTraceMessage = true;
+	usedFuncs.clear();
+	usedLines.clear();
+	usedBlocks.clear();
+	outsideCode = 0;
+}
 
-					status = TraceDqrProfiler::DQERR_OK;
+static bool blockCountCompare(const ProfilerHistogramSummary::BlockCount& a, const ProfilerHistogramSummary::BlockCount& b)
+{
+	return a.startAddr < b.startAddr;
+}
+
+void HistogramSummarizer::getSummary(ProfilerHistogramSummary& summary)
+{
+	summary.clear();
+
+	summary.functions.reserve(usedFuncs.size());
+	for (size_t i = 0; i < usedFuncs.size(); i++) {
+		summary.functions.push_back(funcCounts[usedFuncs[i]]);
+	}
 
-					return status;
-				case TraceDqrProfiler::SYNC_NONE:
-				default:
-					printf("Error: invalid sync reason\n");
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	summary.lines.reserve(usedLines.size());
+	for (size_t i = 0; i < usedLines.size(); i++) {
+		summary.lines.push_back(lineCounts[usedLines[i]]);
+	}
 
-					return status;
-				}
-				break;
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-				// INCIRCUTTRACE_WS messages do not have a sync reason, but control(0,1) has
-				// the same info!
+	summary.blocks.reserve(usedBlocks.size());
+	for (size_t i = 0; i < usedBlocks.size(); i++) {
+		summary.blocks.push_back(blockCounts[usedBlocks[i]]);
+	}
 
-				TraceDqrProfiler::ICTReason itcr;
+	std::sort(summary.blocks.begin(), summary.blocks.end(), blockCountCompare);
 
-				itcr = nm.getCKSRC();
+	summary.outsideCode = outsideCode;
+}
 
-				switch (itcr) {
-				case TraceDqrProfiler::ICT_INFERABLECALL:
-				case TraceDqrProfiler::ICT_EXT_TRIG:
-				case TraceDqrProfiler::ICT_EXCEPTION:
-				case TraceDqrProfiler::ICT_INTERRUPT:
-				case TraceDqrProfiler::ICT_CONTEXT:
-				case TraceDqrProfiler::ICT_WATCHPOINT:
-				case TraceDqrProfiler::ICT_PC_SAMPLE:
-					rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-					if (rc != TraceDqrProfiler::DQERR_OK) {
-						printf("Error: NextInstruction(): state TRACE_STATE_SYNCCATE: processTraceMessage()\n");
+CallGraphBuilder::CallGraphBuilder(ElfReader* elfReader)
+{
+	symtab = (elfReader != nullptr) ? elfReader->getSymtab() : nullptr;
+	haveTime = false;
 
-						status = TraceDqrProfiler::DQERR_ERR;
-						state[currentCore] = TRACE_STATE_ERROR;
+	for (int core = 0; core < DQR_PROFILER_MAXCORES; core++) {
+		cores[core].insts = 0;
+		resetCore(core);
+	}
+}
 
-						return status;
-					}
+TraceDqrProfiler::ADDRESS CallGraphBuilder::functionOf(TraceDqrProfiler::ADDRESS addr, const char*& name)
+{
+	Sym* sym = nullptr;
 
-					if (msgInfo != nullptr) {
-						messageInfo = nm;
+	if (symtab != nullptr) {
+		symtab->lookupSymbolByAddress(addr, sym);
+	}
 
-						// if doing pc-sampling and msg type is INCIRCUITTRACE_WS, we want to use faddr
-						// and not currentAddress
+	if (sym == nullptr) {
+		name = nullptr;
+		return addr;
+	}
 
-						messageInfo.currentAddress = nm.getF_Addr() << 1;
+	name = sym->name;
+	return sym->address;
+}
 
-						if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-							*msgInfo = &messageInfo;
-						}
-					}
+void CallGraphBuilder::push(CoreStack& cs, TraceDqrProfiler::ADDRESS caller)
+{
+	if (cs.frames.size() >= maxDepth) {
+		cs.overflow += 1;
+		return;
+	}
 
-					readNewTraceMessage = true;
+	Frame f;
 
-					status = TraceDqrProfiler::DQERR_OK;
+	f.caller = caller;
+	f.edge = -1;
+	f.outermost = false;
+	f.startInsts = cs.insts;
+	f.startTime = cs.lastTime;
 
-					return status;
-				case TraceDqrProfiler::ICT_CONTROL:
-					bool returnFlag;
-					returnFlag = true;
+	cs.frames.push_back(f);
+}
 
-					if (nm.ictWS.ckdf == 1) {
-						switch (nm.ictWS.ckdata[1]) {
-						case TraceDqrProfiler::ICT_CONTROL_TRACE_ON:
-						case TraceDqrProfiler::ICT_CONTROL_EXIT_DEBUG:
-							// only exit debug or trace enable allow proceeding. All others stay in this state and return
+void CallGraphBuilder::pop(CoreStack& cs)
+{
+	if (cs.overflow > 0) {
+		cs.overflow -= 1;
+		return;
+	}
 
-							teAddr = nm.getF_Addr() << 1;
-							returnFlag = false;
-							break;
-						default:
-							break;
-						}
-					}
+	if (cs.frames.empty()) {
+		return;
+	}
 
-					if (returnFlag) {
-						rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-						if (rc != TraceDqrProfiler::DQERR_OK) {
-							printf("Error: NextInstruction(): state TRACE_STATE_SYNCCATE: processTraceMessage()\n");
+	Frame& f = cs.frames.back();
 
-							status = TraceDqrProfiler::DQERR_ERR;
-							state[currentCore] = TRACE_STATE_ERROR;
+	if (f.edge >= 0) {
+		cs.active[f.edge] -= 1;
 
-							return status;
-						}
+		if (f.outermost) {
+			ProfilerCallGraph::Edge& e = edges[f.edge];
 
-						if (msgInfo != nullptr) {
-							messageInfo = nm;
+			e.inclusiveInsts += cs.insts - f.startInsts;
+			if ((f.startTime != 0) && (cs.lastTime > f.startTime)) {
+				e.inclusiveTime += cs.lastTime - f.startTime;
+			}
+		}
+	}
 
-							// if doing pc-sampling and msg type is INCIRCUITTRACE_WS, we want to use faddr
-							// and not currentAddress
+	cs.frames.pop_back();
+}
 
-							messageInfo.currentAddress = nm.getF_Addr() << 1;
+void CallGraphBuilder::enter(CoreStack& cs, TraceDqrProfiler::ADDRESS addr)
+{
+	// the first instruction run after a call says who was called
 
-							if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-								*msgInfo = &messageInfo;
-							}
-						}
+	Frame& f = cs.frames.back();
 
-						readNewTraceMessage = true;
+	if (f.edge >= 0) {
+		return;
+	}
 
-						status = TraceDqrProfiler::DQERR_OK;
+	const char* calleeName;
+	TraceDqrProfiler::ADDRESS callee = functionOf(addr, calleeName);
+	std::pair<TraceDqrProfiler::ADDRESS, TraceDqrProfiler::ADDRESS> key(f.caller, callee);
+	std::map<std::pair<TraceDqrProfiler::ADDRESS, TraceDqrProfiler::ADDRESS>, int>::iterator it = edgeMap.find(key);
 
-						return status;
-					}
-					break;
-				case TraceDqrProfiler::ICT_NONE:
-				default:
-					printf("Error: invalid ICT reason\n");
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	if (it != edgeMap.end()) {
+		f.edge = it->second;
+	}
+	else {
+		ProfilerCallGraph::Edge e;
 
-					return status;
-				}
-				break;
-			case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-			case TraceDqrProfiler::TCODE_DEVICE_ID:
-			case TraceDqrProfiler::TCODE_DATA_WRITE:
-			case TraceDqrProfiler::TCODE_DATA_READ:
-			case TraceDqrProfiler::TCODE_CORRECTION:
-			case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-			case TraceDqrProfiler::TCODE_DATA_READ_WS:
-			case TraceDqrProfiler::TCODE_WATCHPOINT:
-			case TraceDqrProfiler::TCODE_UNDEFINED:
-			default:
-				printf("Error: nextInstruction(): state TRACE_STATE_SYNCCATE: unsupported or invalid TCODE\n");
+		e.caller = f.caller;
+		e.callee = callee;
+		e.callerName = nullptr;
+		if (f.caller != 0) {
+			functionOf(f.caller, e.callerName);
+		}
+		e.calleeName = calleeName;
+		e.calls = 0;
+		e.inclusiveInsts = 0;
+		e.exclusiveInsts = 0;
+		e.inclusiveTime = 0;
+		e.exclusiveTime = 0;
 
-				state[currentCore] = TRACE_STATE_ERROR;
-				status = TraceDqrProfiler::DQERR_ERR;
+		f.edge = (int)edges.size();
+		edgeMap[key] = f.edge;
+		edges.push_back(e);
+	}
 
-				return status;
-			}
+	edges[f.edge].calls += 1;
 
-			// run ca code until we get to the te trace address. only do 6 instructions a the most
+	uint32_t& n = cs.active[f.edge];
 
-			caSyncAddr = caTrace->getCATraceStartAddr();
+	f.outermost = (n == 0);
+	n += 1;
+}
 
-			//			printf("caSyncAddr: %08x, teAddr: %08x\n",caSyncAddr,teAddr);
+void CallGraphBuilder::advance(CoreStack& cs, uint64_t n, TraceDqrProfiler::TIMESTAMP ts)
+{
+	ProfilerCallGraph::Edge& e = edges[cs.frames.back().edge];
 
-			//			caTrace->dumpCurrentCARecord(1);
+	e.exclusiveInsts += n;
+	cs.insts += n;
 
-			TraceDqrProfiler::ADDRESS savedAddr;
-			savedAddr = -1;
+	// time since the last timestamp is charged to whatever is running when the next one turns up
 
-			bool fail;
-			fail = false;
+	if (ts != 0) {
+		if ((cs.lastTime != 0) && (ts > cs.lastTime)) {
+			e.exclusiveTime += ts - cs.lastTime;
+			haveTime = true;
+		}
 
-			for (int i = 0; (fail == false) && (teAddr != caSyncAddr) && (i < 30); i++) {
-				rc = nextCAAddr(caSyncAddr, savedAddr);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					fail = true;
-				}
-				else {
-					//					printf("caSyncAddr: %08x, teAddr: %08x\n",caSyncAddr,teAddr);
+		cs.lastTime = ts;
+	}
+}
 
-					rc = caTrace->consume(caFlags, TraceDqrProfiler::INST_SCALER, pipeCycles, viStartCycles, viFinishCycles, qDepth, arithInProcess, loadInProcess, storeInProcess);
-					if (rc == TraceDqrProfiler::DQERR_EOF) {
-						state[currentCore] = TRACE_STATE_DONE;
+void CallGraphBuilder::instructions(int core, TraceDqrProfiler::ADDRESS addr, uint64_t n, TraceDqrProfiler::TIMESTAMP ts)
+{
+	if ((core < 0) || (core >= DQR_PROFILER_MAXCORES) || (n == 0)) {
+		return;
+	}
 
-						status = rc;
-						return rc;
-					}
+	CoreStack& cs = cores[core];
 
-					if (rc != TraceDqrProfiler::DQERR_OK) {
-						state[currentCore] = TRACE_STATE_ERROR;
+	enter(cs, addr);
+	advance(cs, n, ts);
+}
 
-						status = rc;
-						return status;
-					}
-				}
-			}
+void CallGraphBuilder::retire(int core, TraceDqrProfiler::ADDRESS addr, int crFlag, TraceDqrProfiler::TIMESTAMP ts)
+{
+	if ((core < 0) || (core >= DQR_PROFILER_MAXCORES)) {
+		return;
+	}
 
-			//			if (teAddr == caSyncAddr) {
-			//				printf("ca sync found at address %08x, cycles: %d\n",caSyncAddr,cycles);
-			//			}
+	CoreStack& cs = cores[core];
 
-			if (teAddr != caSyncAddr) {
-				// unable to sync by fast-forwarding the CA trace to match the instruction trace
-				// so we will try to run the normal trace for a few instructions with the hope it
-				// will sync up with the ca trace! We set the max number of instructions to run
-				// the normal trace below, and turn tracing loose!
+	enter(cs, addr);
+	advance(cs, 1, ts);
 
-				syncCount = 16;
-				caTrace->rewind();
-				caSyncAddr = caTrace->getCATraceStartAddr();
+	// a swap returns and calls in one instruction
 
-				//				printf("starting normal trace to sync up; caSyncAddr: %08x\n",caSyncAddr);
-			}
+	if (crFlag & (TraceDqrProfiler::isReturn | TraceDqrProfiler::isExceptionReturn | TraceDqrProfiler::isSwap)) {
+		pop(cs);
 
-			// readnextmessage should be false. So, we want to process the message like a normal message here
-			// if the addresses of the trace and the start of the ca trace sync later, it is handled in
-			// the other states
+		if (cs.frames.empty()) {
+			push(cs, 0);
+		}
+	}
 
-			state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
-			break;
-		case TRACE_STATE_GETFIRSTSYNCMSG:
-			// start here for normal traces
+	if (crFlag & (TraceDqrProfiler::isCall | TraceDqrProfiler::isSwap | TraceDqrProfiler::isException | TraceDqrProfiler::isInterrupt)) {
+		const char* name;
 
-			// read trace messages until a sync is found. Should be the first message normally
-			// unless the wrapped buffer
+		push(cs, functionOf(addr, name));
+	}
+}
 
-			// only exit this state when sync type message is found or EOF or error
-			// Event messages will cause state to change to TRACE_STATE_EVENT
+void CallGraphBuilder::interrupt(int core)
+{
+	if ((core < 0) || (core >= DQR_PROFILER_MAXCORES)) {
+		return;
+	}
 
-			switch (nm.tcode) {
-			case TraceDqrProfiler::TCODE_SYNC:
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_GETFIRSTSYNCMSG: processTraceMessage()\n");
+	CoreStack& cs = cores[core];
 
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	// the handler is called from the function that was running. Its first instruction says which handler
 
-					return status;
-				}
+	const Frame& f = cs.frames.back();
 
-				if (srcInfo != nullptr) {
-					Disassemble(currentAddress[currentCore]);
+	push(cs, (f.edge >= 0) ? edges[f.edge].callee : f.caller);
+}
 
-					sourceInfo.coreId = currentCore;
-					*srcInfo = &sourceInfo;
-				}
+void CallGraphBuilder::resetCore(int core)
+{
+	if ((core < 0) || (core >= DQR_PROFILER_MAXCORES)) {
+		return;
+	}
 
-				state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
-				break;
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-				// this may set the timestamp, and and may set the address
-				// all set the address except control(0,0) which is used just to set the timestamp at most
+	CoreStack& cs = cores[core];
 
-				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_GETFIRSTSYNCMSG: processTraceMessage()\n");
+	// close the calls that were open so their inclusive counts are kept
 
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	cs.overflow = 0;
 
-					return status;
-				}
+	while (!cs.frames.empty()) {
+		pop(cs);
+	}
 
-				if (currentAddress[currentCore] == 0) {
-					// for the get first sync state, we want currentAddress to be set
-					// most incircuttrace_ws types will set it, but not 8,0; 14,0; 0,0
+	cs.active.clear();
+	cs.lastTime = 0;
 
-					currentAddress[currentCore] = lastFaddr[currentCore];
-				}
+	push(cs, 0);
+}
 
-				if ((nm.ictWS.cksrc == TraceDqrProfiler::ICT_CONTROL) && (nm.ictWS.ckdf == 0)) {
-					// ICT_WS Control(0,0) only updates TS (if present). Does not change state or anything else
-					// because it is the only incircuittrace message type with no address
-				}
-				else {
-					if ((nm.getCKSRC() == TraceDqrProfiler::ICT_EXT_TRIG) && (nm.getCKDF() == 0)) {
-						// no dasm or src for ext trigger in HTM instruction traces
-					}
-					else if ((nm.getCKSRC() == TraceDqrProfiler::ICT_WATCHPOINT) && (nm.getCKDF() == 0)) {
-						// no dasm or src for ext trigger in HTM instruction traces
-					}
-					else if ((instInfo != nullptr) || (srcInfo != nullptr)) {
-						Disassemble(currentAddress[currentCore]);
+void CallGraphBuilder::snapshot(ProfilerCallGraph& graph)
+{
+	graph.edges = edges;
+	graph.haveTime = haveTime;
 
-						if (instInfo != nullptr) {
-							instructionInfo.qDepth = 0;
-							instructionInfo.arithInProcess = 0;
-							instructionInfo.loadInProcess = 0;
-							instructionInfo.storeInProcess = 0;
+	for (int core = 0; core < DQR_PROFILER_MAXCORES; core++) {
+		CoreStack& cs = cores[core];
 
-							instructionInfo.coreId = currentCore;
-							*instInfo = &instructionInfo;
-							//							(*instInfo)->CRFlag = TraceDqrProfiler::isNone;
-							//							(*instInfo)->brFlags = TraceDqrProfiler::BRFLAG_none;
-							getCRBRFlags(nm.getCKSRC(), currentAddress[currentCore], (*instInfo)->CRFlag, (*instInfo)->brFlags);
+		for (size_t i = 0; i < cs.frames.size(); i++) {
+			const Frame& f = cs.frames[i];
 
-							(*instInfo)->timestamp = lastTime[currentCore];
-						}
+			if ((f.edge >= 0) && f.outermost) {
+				ProfilerCallGraph::Edge& e = graph.edges[f.edge];
 
-						if (srcInfo != nullptr) {
-							sourceInfo.coreId = currentCore;
-							*srcInfo = &sourceInfo;
-						}
-					}
-					state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
+				e.inclusiveInsts += cs.insts - f.startInsts;
+				if ((f.startTime != 0) && (cs.lastTime > f.startTime)) {
+					e.inclusiveTime += cs.lastTime - f.startTime;
 				}
-				break;
-			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_GETFIRSTSYNCMSG: processTraceMessage()\n");
+			}
+		}
+	}
+}
 
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+GzipFile::GzipFile()
+{
+	fp = nullptr;
+	crc = 0xffffffff;
+	totalLen = 0;
 
-					return status;
-				}
-				break;
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-			case TraceDqrProfiler::TCODE_RESOURCEFULL:
-			case TraceDqrProfiler::TCODE_CORRELATION:
-				if (nm.timestamp) {
-					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
-				}
-				break;
-			case TraceDqrProfiler::TCODE_ERROR:
-				// reset time. Messages have been missed.
-				lastTime[currentCore] = 0;
-				break;
-			case TraceDqrProfiler::TCODE_DEBUG_STATUS:
-			case TraceDqrProfiler::TCODE_DEVICE_ID:
-			case TraceDqrProfiler::TCODE_DATA_WRITE:
-			case TraceDqrProfiler::TCODE_DATA_READ:
-			case TraceDqrProfiler::TCODE_CORRECTION:
-			case TraceDqrProfiler::TCODE_DATA_WRITE_WS:
-			case TraceDqrProfiler::TCODE_DATA_READ_WS:
-			case TraceDqrProfiler::TCODE_WATCHPOINT:
-			default:
-				printf("Error: nextInstructin(): state TRACE_STATE_GETFIRSTSYNCMSG: unsupported or invalid TCODE\n");
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t c = n;
 
-				state[currentCore] = TRACE_STATE_ERROR;
-				status = TraceDqrProfiler::DQERR_ERR;
+		for (int k = 0; k < 8; k++) {
+			c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+		}
 
-				return status;
-			}
+		crcTable[n] = c;
+	}
+}
 
-			// INCIRCUITTRACE or INCIRCUITTRACE_WS will have set state to TRACE_STATE_EVENT
+GzipFile::~GzipFile()
+{
+	if (fp != nullptr) {
+		close();
+	}
+}
 
-			readNewTraceMessage = true;
+TraceDqrProfiler::DQErr GzipFile::open(const char* path)
+{
+	if (fp != nullptr) {
+		printf("Error: GzipFile::open(): File already open\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-			// here we return the trace messages before we have actually started tracing
-			// this could be at the start of a trace, or after leaving a trace because of
-			// a correlation message
+	fp = fopen(path, "wb");
+	if (fp == nullptr) {
+		printf("Error: GzipFile::open(): Could not open %s for writing\n", path);
+		return TraceDqrProfiler::DQERR_OPEN;
+	}
 
-			if (msgInfo != nullptr) {
-				messageInfo = nm;
+	crc = 0xffffffff;
+	totalLen = 0;
+	block.clear();
+	block.reserve(blockSize);
 
-				messageInfo.currentAddress = currentAddress[currentCore];
+	// magic, deflate, no flags, no mtime, no extra flags, unknown os
 
-				messageInfo.time = lastTime[currentCore];
+	static const uint8_t header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
 
-				if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-					*msgInfo = &messageInfo;
-				}
-			}
+	if (fwrite(header, 1, sizeof header, fp) != sizeof header) {
+		printf("Error: GzipFile::open(): Could not write %s\n", path);
+		fclose(fp);
+		fp = nullptr;
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-			status = TraceDqrProfiler::DQERR_OK;
-			return status;
-		case TRACE_STATE_GETMSGWITHCOUNT:
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-			// think GETMSGWITHCOUNT and GETNEXTMSG state are the same!! If so, combine them!
+TraceDqrProfiler::DQErr GzipFile::write(const void* data, size_t len)
+{
+	if (fp == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-//			printf("TRACE_STATE_GETMSGWITHCOUNT %08x\n",lastFaddr[currentCore]);
-			// only message with i-cnt/hist/taken/notTaken will release from this state
+	const uint8_t* p = (const uint8_t*)data;
 
-			// return any message without a count (i-cnt or hist, taken/not taken)
+	for (size_t i = 0; i < len; i++) {
+		crc = crcTable[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+	}
 
-			// do not return message with i-cnt/hist/taken/not taken; process them when counts expires
+	totalLen += (uint32_t)len;
 
-			switch (nm.tcode) {
-			case TraceDqrProfiler::TCODE_SYNC:
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_CORRELATION:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-			case TraceDqrProfiler::TCODE_RESOURCEFULL:
-				// don't update timestamp until messages are retired!
+	while (len > 0) {
+		size_t n = blockSize - block.size();
 
-				// reset all counts before setting them. We have no valid counts before the second message.
-				// first message is a sync-type message. Counts are for up to that message, nothing after.
+		if (n > len) {
+			n = len;
+		}
 
-				counts->resetCounts(currentCore);
+		block.insert(block.end(), p, p + n);
+		p += n;
+		len -= n;
 
-				rc = counts->setCounts(&nm);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					state[currentCore] = TRACE_STATE_ERROR;
-					status = rc;
+		if (block.size() == blockSize) {
+			TraceDqrProfiler::DQErr rc = writeBlock(false);
+			if (rc != TraceDqrProfiler::DQERR_OK) {
+				return rc;
+			}
+		}
+	}
 
-					return status;
-				}
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-				// only these TCODEs have counts and release from this state
+TraceDqrProfiler::DQErr GzipFile::writeBlock(bool last)
+{
+	// a stored block is the block header bits padded out to a byte, then the length and its complement
 
-				state[currentCore] = TRACE_STATE_GETNEXTINSTRUCTION;
-				break;
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-				// these message have no counts so they will be retired immediately
+	uint16_t len = (uint16_t)block.size();
+	uint8_t header[5];
 
-				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_GETMSGWITHCOUNT: processTraceMessage()\n");
+	header[0] = last ? 1 : 0;
+	header[1] = (uint8_t)len;
+	header[2] = (uint8_t)(len >> 8);
+	header[3] = (uint8_t)~len;
+	header[4] = (uint8_t)(~len >> 8);
 
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	if ((fwrite(header, 1, sizeof header, fp) != sizeof header) || (fwrite(block.data(), 1, block.size(), fp) != block.size())) {
+		printf("Error: GzipFile::writeBlock(): Write failed\n");
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-					return status;
-				}
+	block.clear();
 
-				if ((nm.getCKSRC() == TraceDqrProfiler::ICT_CONTROL) && (nm.getCKDF() == 0)) {
-					// ICT_WS Control(0,0) only updates TS (if present). Does not change state or anything else
-					addr = currentAddress[currentCore];
-				}
-				else {
-					if ((nm.getCKSRC() == TraceDqrProfiler::ICT_EXT_TRIG) && (nm.getCKDF() == 0)) {
-						// no dasm or src for ext trigger in HTM instruction traces
-						addr = lastFaddr[currentCore];
-					}
-					else if ((nm.getCKSRC() == TraceDqrProfiler::ICT_WATCHPOINT) && (nm.getCKDF() == 0)) {
-						// no dasm or src for ext trigger in HTM instruction tracaes
-						addr = lastFaddr[currentCore];
-					}
-					else if ((instInfo != nullptr) || (srcInfo != nullptr)) {
-						addr = currentAddress[currentCore];
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-						Disassemble(addr);
+TraceDqrProfiler::DQErr GzipFile::close()
+{
+	if (fp == nullptr) {
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-						if (instInfo != nullptr) {
-							instructionInfo.qDepth = 0;
-							instructionInfo.arithInProcess = 0;
-							instructionInfo.loadInProcess = 0;
-							instructionInfo.storeInProcess = 0;
+	TraceDqrProfiler::DQErr rc = writeBlock(true);
 
-							instructionInfo.coreId = currentCore;
-							*instInfo = &instructionInfo;
-							//							(*instInfo)->CRFlag = TraceDqrProfiler::isNone;
-							//							(*instInfo)->brFlags = TraceDqrProfiler::BRFLAG_none;
-							getCRBRFlags(nm.getCKSRC(), currentAddress[currentCore], (*instInfo)->CRFlag, (*instInfo)->brFlags);
-							(*instInfo)->timestamp = lastTime[currentCore];
-						}
+	uint32_t sum = ~crc;
+	uint8_t trailer[8];
 
-						if (srcInfo != nullptr) {
-							sourceInfo.coreId = currentCore;
-							*srcInfo = &sourceInfo;
-						}
-					}
-					state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
-				}
+	for (int i = 0; i < 4; i++) {
+		trailer[i] = (uint8_t)(sum >> (i * 8));
+		trailer[i + 4] = (uint8_t)(totalLen >> (i * 8));
+	}
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
-					messageInfo.currentAddress = addr;
+	if ((rc == TraceDqrProfiler::DQERR_OK) && (fwrite(trailer, 1, sizeof trailer, fp) != sizeof trailer)) {
+		printf("Error: GzipFile::close(): Write failed\n");
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+	if ((fclose(fp) != 0) && (rc == TraceDqrProfiler::DQERR_OK)) {
+		printf("Error: GzipFile::close(): Close failed\n");
+		rc = TraceDqrProfiler::DQERR_ERR;
+	}
 
-				readNewTraceMessage = true;
+	fp = nullptr;
+	std::vector<uint8_t>().swap(block);
 
-				return status;
-			case TraceDqrProfiler::TCODE_ERROR:
-				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+	return rc;
+}
 
-				// don't update timestamp because we have missed some
-				//
-				// if (nm.haveTimestamp) {
-				//	lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel,lastTime[currentCore],nm.timestamp);
-				// }
+ProfileWriter::ProfileWriter(ElfReader* elfReader)
+{
+	status = TraceDqrProfiler::DQERR_OK;
+	this->elfReader = elfReader;
+	symtab = (elfReader != nullptr) ? elfReader->getSymtab() : nullptr;
+	elfName = (elfReader != nullptr) ? elfReader->getElfName() : nullptr;
+}
 
-				nm.timestamp = 0;	// clear time because we have lost time
-				lastTime[currentCore] = 0;
-				currentAddress[currentCore] = 0;
-				lastFaddr[currentCore] = 0;
+void ProfileWriter::addCounts(const ProfilerHistogram::Entry* delta, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (delta[i].second != 0) {
+			totals[delta[i].first] += delta[i].second;
+		}
+	}
+}
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
-					messageInfo.currentAddress = currentAddress[currentCore];
+const Sym* ProfileWriter::lookupFunction(TraceDqrProfiler::ADDRESS addr)
+{
+	Sym* sym = nullptr;
 
-					if (messageInfo.processITCPrintData(itcPrint) == false) {
-						*msgInfo = &messageInfo;
-					}
-				}
+	if (symtab != nullptr) {
+		symtab->lookupSymbolByAddress(addr, sym);
+	}
 
-				readNewTraceMessage = true;
+	return sym;
+}
 
-				return status;
-			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-			case TraceDqrProfiler::TCODE_TRAP_INFO:
-			case TraceDqrProfiler::TCODE_REPEATBRANCH:			
-				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_GETMSGWITHCOUNT: processTraceMessage()\n");
+const LineRange* ProfileWriter::lookupLine(TraceDqrProfiler::ADDRESS addr)
+{
+	Section* sp = (elfReader != nullptr) ? elfReader->getSectionByAddress(addr) : nullptr;
 
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	if (sp == nullptr) {
+		return nullptr;
+	}
 
-					return status;
-				}
+	return sp->getSrcLine((uint32_t)((addr - sp->startAddr) >> 1));
+}
 
-				// for now, return message;
+PprofWriter::PprofWriter(ElfReader* elfReader) : ProfileWriter(elfReader)
+{
+	opened = false;
+	haveMapping = false;
+	numStrings = 0;
+}
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
-					messageInfo.currentAddress = currentAddress[currentCore];
+PprofWriter::~PprofWriter()
+{
+	if (opened) {
+		finish();
+	}
+}
+
+void PprofWriter::putVarint(std::string& buf, uint64_t v)
+{
+	while (v >= 0x80) {
+		buf.push_back((char)((v & 0x7f) | 0x80));
+		v >>= 7;
+	}
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+	buf.push_back((char)v);
+}
 
-				readNewTraceMessage = true;
+void PprofWriter::putUint(std::string& buf, int field, uint64_t v)
+{
+	// zero is the default, so it is left out
 
-				return status;
-			case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-				// these message have no address or count info, so we still need to get
-				// another message.
+	if (v != 0) {
+		putVarint(buf, (uint64_t)field << 3);
+		putVarint(buf, v);
+	}
+}
 
-				// might want to keep track of process, but will add that later
+void PprofWriter::putBytes(std::string& buf, int field, const void* data, size_t len)
+{
+	putVarint(buf, ((uint64_t)field << 3) | 2);
+	putVarint(buf, len);
+	buf.append((const char*)data, len);
+}
 
-				// for now, return message;
+TraceDqrProfiler::DQErr PprofWriter::writeMessage(int field, const std::string& m)
+{
+	std::string head;
 
-				if (nm.haveTimestamp) {
-					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
-				}
+	putVarint(head, ((uint64_t)field << 3) | 2);
+	putVarint(head, m.size());
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
-					messageInfo.currentAddress = currentAddress[currentCore];
+	TraceDqrProfiler::DQErr rc = out.write(head.data(), head.size());
+	if (rc == TraceDqrProfiler::DQERR_OK) {
+		rc = out.write(m.data(), m.size());
+	}
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = rc;
+	}
 
-				readNewTraceMessage = true;
+	return rc;
+}
 
-				return status;
-			default:
-				printf("Error: bad tcode type in state TRACE_STATE_GETMSGWITHCOUNT. TCODE (%d)\n", nm.tcode);
+TraceDqrProfiler::DQErr PprofWriter::getString(const char* str, uint64_t& index)
+{
+	std::unordered_map<const char*, uint64_t>::iterator it = strings.find(str);
 
-				state[currentCore] = TRACE_STATE_ERROR;
-				status = TraceDqrProfiler::DQERR_ERR;
+	if (it != strings.end()) {
+		index = it->second;
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-				return status;
-			}
-			break;
-		case TRACE_STATE_RETIREMESSAGE:
-			//			printf("TRACE_STATE_RETIREMESSAGE\n");
+	TraceDqrProfiler::DQErr rc = writeMessage(profStringTable, std::string(str));
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return rc;
+	}
 
-						// Process message being retired (currently in nm) i_cnt/taken/not taken/history has gone to 0
-						// compute next address
+	index = numStrings;
+	strings[str] = numStrings;
+	numStrings += 1;
 
-			//			set lastFaddr,currentAddress,lastTime.
-			//			readNewTraceMessage = true;
-			//			state = Trace_State_GetNextMsg;
-			//			return messageInfo.
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-						// retire message should be run anytime any count expires - i-cnt, history, taken, not taken
+TraceDqrProfiler::DQErr PprofWriter::getFunction(const Sym* sym, const char* file, uint64_t& id)
+{
+	std::pair<const Sym*, const char*> key(sym, file);
+	std::map<std::pair<const Sym*, const char*>, uint64_t>::iterator it = functions.find(key);
 
-			switch (nm.tcode) {
-				// sync type messages say where to set pc to
-			case TraceDqrProfiler::TCODE_SYNC:
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-			case TraceDqrProfiler::TCODE_RESOURCEFULL:
-				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_RETIREMESSAGE: processTraceMessage()\n");
+	if (it != functions.end()) {
+		id = it->second;
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	TraceDqrProfiler::DQErr rc;
+	uint64_t name;
+	uint64_t fileName = 0;
 
-					return status;
-				}
+	rc = getString(sym->name, name);
+	if ((rc == TraceDqrProfiler::DQERR_OK) && (file != nullptr)) {
+		rc = getString(file, fileName);
+	}
 
-				if (msgInfo != nullptr) {
-					previousNM = nm;
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return rc;
+	}
 
-					messageInfo.currentAddress = currentAddress[currentCore];
+	id = functions.size() + 1;
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+	sub.clear();
+	putUint(sub, 1, id);
+	putUint(sub, 2, name);
+	putUint(sub, 3, name);
+	putUint(sub, 4, fileName);
 
-				if ((srcInfo != nullptr) && (*srcInfo == nullptr)) {
-					Disassemble(currentAddress[currentCore]);
+	rc = writeMessage(profFunction, sub);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return rc;
+	}
 
-					sourceInfo.coreId = currentCore;
-					*srcInfo = &sourceInfo;
-				}
+	functions[key] = id;
 
-				// I don't think the b_type code below actaully does anything??? Remove??
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-				TraceDqrProfiler::BType b_type;
-				b_type = TraceDqrProfiler::BTYPE_UNDEFINED;
+TraceDqrProfiler::DQErr PprofWriter::getLocation(TraceDqrProfiler::ADDRESS addr, uint64_t& id)
+{
+	std::unordered_map<TraceDqrProfiler::ADDRESS, uint64_t>::iterator it = locations.find(addr);
 
-				switch (nm.tcode) {
-				case TraceDqrProfiler::TCODE_SYNC:
-				case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-					break;
-				case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-					if ((nm.ictWS.cksrc == TraceDqrProfiler::ICT_EXCEPTION) || (nm.ictWS.cksrc == TraceDqrProfiler::ICT_INTERRUPT)) {
-						b_type = TraceDqrProfiler::BTYPE_EXCEPTION;
-					}
-					break;
-				case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-					if ((nm.ict.cksrc == TraceDqrProfiler::ICT_EXCEPTION) || (nm.ict.cksrc == TraceDqrProfiler::ICT_INTERRUPT)) {
-						b_type = TraceDqrProfiler::BTYPE_EXCEPTION;
-					}
-					break;
-				case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-					b_type = nm.indirectBranchWS.b_type;
-					break;
-				case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-					b_type = nm.indirectBranch.b_type;
-					break;
-				case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-					b_type = nm.indirectHistory.b_type;
-					break;
-				case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-					b_type = nm.indirectHistoryWS.b_type;
-					break;
-				case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-				case TraceDqrProfiler::TCODE_RESOURCEFULL:
-					// fall through
-				default:
-					break;
-				}
+	if (it != locations.end()) {
+		id = it->second;
+		return TraceDqrProfiler::DQERR_OK;
+	}
 
-				if (b_type == TraceDqrProfiler::BTYPE_EXCEPTION) {
-					enterISR[currentCore] = TraceDqrProfiler::isInterrupt;
-				}
+	const Sym* sym = lookupFunction(addr);
+	const LineRange* lr = lookupLine(addr);
+	uint64_t function = 0;
 
-				readNewTraceMessage = true;
-				state[currentCore] = TRACE_STATE_GETNEXTMSG;
-				break;
-			case TraceDqrProfiler::TCODE_TRAP_INFO:
-			case TraceDqrProfiler::TCODE_REPEATBRANCH:
-				rc = processTraceMessage(nm,currentAddress[currentCore],lastFaddr[currentCore],lastTime[currentCore],consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_RETIREMESSAGE: processTraceMessage()\n");
+	if (sym != nullptr) {
+		TraceDqrProfiler::DQErr rc = getFunction(sym, (lr != nullptr) ? lr->file : nullptr, function);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			return rc;
+		}
+	}
 
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	id = locations.size() + 1;
 
-					return status;
-				}
+	sub.clear();
+	putUint(sub, 1, id);
+	if (haveMapping && (elfReader->getSectionByAddress(addr) != nullptr)) {
+		putUint(sub, 2, 1);
+	}
+	putUint(sub, 3, addr);
 
-				readNewTraceMessage = true;
-				break;
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-				// these messages should have been retired immediately
+	if (function != 0) {
+		msg.clear();
+		putUint(msg, 1, function);
+		putUint(msg, 2, (lr != nullptr) ? lr->line : 0);
+		putBytes(sub, 4, msg.data(), msg.size());
+	}
 
-				printf("Error: unexpected tcode of INCIRCUTTRACE or INCIRCUTTRACE_WS in state TRACE_STATE_RETIREMESSAGE\n");
-				state[currentCore] = TRACE_STATE_ERROR;
+	TraceDqrProfiler::DQErr rc = writeMessage(profLocation, sub);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		return rc;
+	}
 
-				status = TraceDqrProfiler::DQERR_ERR;
-				return status;
-			case TraceDqrProfiler::TCODE_CORRELATION:
-				// correlation has i_cnt, but no address info
+	locations[addr] = id;
 
-				if (nm.haveTimestamp) {
-					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
-				}
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
+TraceDqrProfiler::DQErr PprofWriter::writeSample(const uint64_t* locs, int numLocs, uint64_t insts, uint64_t calls)
+{
+	sub.clear();
 
-					// leaving trace mode - currentAddress should be last faddr + i_cnt *2
+	// location ids and values are packed repeated fields
 
-					messageInfo.currentAddress = lastFaddr[currentCore] + nm.correlation.i_cnt * 2;
+	msg.clear();
+	for (int i = 0; i < numLocs; i++) {
+		putVarint(msg, locs[i]);
+	}
+	putBytes(sub, 1, msg.data(), msg.size());
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+	msg.clear();
+	putVarint(msg, insts);
+	putVarint(msg, calls);
+	putBytes(sub, 2, msg.data(), msg.size());
 
-				readNewTraceMessage = true;
+	return writeMessage(profSample, sub);
+}
 
-				// leaving trace mode - need to get next sync
+TraceDqrProfiler::DQErr PprofWriter::open(const char* path)
+{
+	TraceDqrProfiler::DQErr rc;
 
-				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
-				break;
-			case TraceDqrProfiler::TCODE_ERROR:
-				printf("Error: Unexpected tcode TCODE_ERROR in state TRACE_STATE_RETIREMESSAGE\n");
+	rc = out.open(path);
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = rc;
+		return rc;
+	}
 
-				state[currentCore] = TRACE_STATE_ERROR;
-				status = TraceDqrProfiler::DQERR_ERR;
+	opened = true;
 
-				return status;
-			case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-				// these messages have no address or i-cnt info and should have been
-				// instantly retired when they were read.
+	// string 0 has to be the empty string
 
-				state[currentCore] = TRACE_STATE_ERROR;
-				status = TraceDqrProfiler::DQERR_ERR;
+	uint64_t empty;
+	uint64_t instructions;
+	uint64_t calls;
+	uint64_t count;
 
-				return status;
-			default:
-				printf("Error: bad tcode type in state TRACE_STATE_RETIREMESSAGE\n");
+	rc = getString("", empty);
+	if (rc == TraceDqrProfiler::DQERR_OK) {
+		rc = getString("instructions", instructions);
+	}
+	if (rc == TraceDqrProfiler::DQERR_OK) {
+		rc = getString("calls", calls);
+	}
+	if (rc == TraceDqrProfiler::DQERR_OK) {
+		rc = getString("count", count);
+	}
 
-				state[currentCore] = TRACE_STATE_ERROR;
-				status = TraceDqrProfiler::DQERR_ERR;
+	if (rc == TraceDqrProfiler::DQERR_OK) {
+		sub.clear();
+		putUint(sub, 1, instructions);
+		putUint(sub, 2, count);
+		rc = writeMessage(profSampleType, sub);
+	}
 
-				return status;
-			}
+	if (rc == TraceDqrProfiler::DQERR_OK) {
+		sub.clear();
+		putUint(sub, 1, calls);
+		putUint(sub, 2, count);
+		rc = writeMessage(profSampleType, sub);
+	}
 
-			status = TraceDqrProfiler::DQERR_OK;
-			return status;
-		case TRACE_STATE_GETNEXTMSG:
-			//			printf("TRACE_STATE_GETNEXTMSG\n");
+	if (rc == TraceDqrProfiler::DQERR_OK) {
+		msg.clear();
+		putUint(msg, profDefaultSampleType, instructions);
+		rc = out.write(msg.data(), msg.size());
+	}
 
-						// exit this state when message with i-cnt, history, taken, or not-taken is read
+	// one mapping for the code sections of the elf file, so pprof knows which binary the addresses are in
 
-			switch (nm.tcode) {
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
-			case TraceDqrProfiler::TCODE_SYNC:
-			case TraceDqrProfiler::TCODE_DIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
-			case TraceDqrProfiler::TCODE_CORRELATION:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
-			case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
-			case TraceDqrProfiler::TCODE_RESOURCEFULL:
-				rc = counts->setCounts(&nm);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: nextInstruction: state TRACE_STATE_GETNEXTMESSAGE Count::seteCounts()\n");
+	TraceDqrProfiler::ADDRESS lo = 0;
+	TraceDqrProfiler::ADDRESS hi = 0;
+	bool haveCode = false;
+	bool haveLines = false;
 
-					state[currentCore] = TRACE_STATE_ERROR;
+	for (Section* sp = (elfReader != nullptr) ? elfReader->getCodeSections() : nullptr; sp != nullptr; sp = ElfReader::nextCodeSection(sp->next)) {
+		if (!haveCode || (sp->startAddr < lo)) {
+			lo = sp->startAddr;
+		}
+		if (!haveCode || (sp->endAddr > hi)) {
+			hi = sp->endAddr;
+		}
+		if (!sp->lines.empty()) {
+			haveLines = true;
+		}
+		haveCode = true;
+	}
 
-					status = rc;
+	if ((rc == TraceDqrProfiler::DQERR_OK) && haveCode) {
+		uint64_t fileName = 0;
+
+		if (elfName != nullptr) {
+			rc = getString(elfName, fileName);
+		}
 
-					return status;
-				}
+		if (rc == TraceDqrProfiler::DQERR_OK) {
+			sub.clear();
+			putUint(sub, 1, 1);
+			putUint(sub, 2, lo);
+			putUint(sub, 3, hi + 1);
+			putUint(sub, 5, fileName);
+			putUint(sub, 7, symtab != nullptr);
+			putUint(sub, 8, haveLines);
+			putUint(sub, 9, haveLines);
+			rc = writeMessage(profMapping, sub);
+		}
 
-				state[currentCore] = TRACE_STATE_GETNEXTINSTRUCTION;
-				break;
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE:
-			case TraceDqrProfiler::TCODE_INCIRCUITTRACE_WS:
-				// these message have no counts so they will be retired immeadiately
+		haveMapping = true;
+	}
 
-				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_GETMSGWITHCOUNT: processTraceMessage()\n");
+	if (rc != TraceDqrProfiler::DQERR_OK) {
+		status = rc;
+	}
 
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+	return rc;
+}
 
-					return status;
-				}
+TraceDqrProfiler::DQErr PprofWriter::finish()
+{
+	if (opened == false) {
+		return status;
+	}
 
-				if ((nm.getCKSRC() == TraceDqrProfiler::ICT_CONTROL) && (nm.getCKDF() == 0)) {
-					// ICT_WS Control(0,0) only updates TS (if present). Does not change state or anything else
-					addr = currentAddress[currentCore];
-				}
-				else {
-					if ((nm.getCKSRC() == TraceDqrProfiler::ICT_EXT_TRIG) && (nm.getCKDF() == 0)) {
-						// no dasm or src for ext trigger in HTM instruction traces
-						addr = lastFaddr[currentCore];
-					}
-					else if ((nm.getCKSRC() == TraceDqrProfiler::ICT_WATCHPOINT) && (nm.getCKDF() == 0)) {
-						// no dasm or src for ext trigger in HTM instruction tracaes
-						addr = lastFaddr[currentCore];
-					}
-					else if ((instInfo != nullptr) || (srcInfo != nullptr)) {
-						addr = currentAddress[currentCore];
+	opened = false;
 
-						Disassemble(addr);
+	for (std::map<TraceDqrProfiler::ADDRESS, uint64_t>::iterator it = totals.begin(); (it != totals.end()) && (status == TraceDqrProfiler::DQERR_OK); ++it) {
+		uint64_t loc;
 
-						if (instInfo != nullptr) {
-							instructionInfo.qDepth = 0;
-							instructionInfo.arithInProcess = 0;
-							instructionInfo.loadInProcess = 0;
-							instructionInfo.storeInProcess = 0;
+		if (getLocation(it->first, loc) == TraceDqrProfiler::DQERR_OK) {
+			writeSample(&loc, 1, it->second, 0);
+		}
+	}
 
-							instructionInfo.coreId = currentCore;
-							*instInfo = &instructionInfo;
-							//							(*instInfo)->CRFlag = TraceDqrProfiler::isNone;
-							//							(*instInfo)->brFlags = TraceDqrProfiler::BRFLAG_none;
-							getCRBRFlags(nm.getCKSRC(), currentAddress[currentCore], (*instInfo)->CRFlag, (*instInfo)->brFlags);
+	for (size_t i = 0; (i < edges.size()) && (status == TraceDqrProfiler::DQERR_OK); i++) {
+		const ProfilerCallGraph::Edge& e = edges[i];
 
-							(*instInfo)->timestamp = lastTime[currentCore];
-						}
+		if (e.calls == 0) {
+			continue;
+		}
 
-						if (srcInfo != nullptr) {
-							sourceInfo.coreId = currentCore;
-							*srcInfo = &sourceInfo;
-						}
-					}
-				}
+		// leaf first, as pprof wants it
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
-					messageInfo.currentAddress = addr;
+		uint64_t locs[2];
+		int numLocs = 1;
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+		TraceDqrProfiler::DQErr rc = getLocation(e.callee, locs[0]);
+		if ((rc == TraceDqrProfiler::DQERR_OK) && (e.caller != 0)) {
+			rc = getLocation(e.caller, locs[1]);
+			numLocs = 2;
+		}
+		if (rc == TraceDqrProfiler::DQERR_OK) {
+			writeSample(locs, numLocs, 0, e.calls);
+		}
+	}
 
-				readNewTraceMessage = true;
+	TraceDqrProfiler::DQErr rc = out.close();
+	if ((rc != TraceDqrProfiler::DQERR_OK) && (status == TraceDqrProfiler::DQERR_OK)) {
+		status = rc;
+	}
 
-				return status;
-			case TraceDqrProfiler::TCODE_ERROR:
-				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+	strings.clear();
+	functions.clear();
+	locations.clear();
+	totals.clear();
+	edges.clear();
 
-				nm.timestamp = 0;	// clear time because we have lost time
-				currentAddress[currentCore] = 0;
-				lastFaddr[currentCore] = 0;
-				lastTime[currentCore] = 0;
+	return status;
+}
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
-					messageInfo.currentAddress = currentAddress[currentCore];
+PerfScriptWriter::PerfScriptWriter(ElfReader* elfReader) : ProfileWriter(elfReader)
+{
+	fp = nullptr;
+}
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+PerfScriptWriter::~PerfScriptWriter()
+{
+	if (fp != nullptr) {
+		finish();
+	}
+}
 
-				readNewTraceMessage = true;
+TraceDqrProfiler::DQErr PerfScriptWriter::open(const char* path)
+{
+	fp = fopen(path, "w");
+	if (fp == nullptr) {
+		printf("Error: PerfScriptWriter::open(): Could not open %s for writing\n", path);
+		status = TraceDqrProfiler::DQERR_OPEN;
+		return status;
+	}
 
-				return status;
-			case TraceDqrProfiler::TCODE_AUXACCESS_WRITE:
-			case TraceDqrProfiler::TCODE_DATA_ACQUISITION:
-			case TraceDqrProfiler::TCODE_TRAP_INFO:
-			case TraceDqrProfiler::TCODE_REPEATBRANCH:			
-				rc = processTraceMessage(nm, currentAddress[currentCore], lastFaddr[currentCore], lastTime[currentCore], consumed);
-				if (rc != TraceDqrProfiler::DQERR_OK) {
-					printf("Error: NextInstruction(): state TRACE_STATE_GETNXTMSG: processTraceMessage()\n");
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-					status = TraceDqrProfiler::DQERR_ERR;
-					state[currentCore] = TRACE_STATE_ERROR;
+void PerfScriptWriter::writeFrame(TraceDqrProfiler::ADDRESS addr)
+{
+	const Sym* sym = lookupFunction(addr);
+	const char* dso = (elfName != nullptr) ? elfName : "[unknown]";
 
-					return status;
-				}
+	if (sym != nullptr) {
+		fprintf(fp, "\t%16llx %s+0x%llx (%s)\n", (unsigned long long)addr, sym->name, (unsigned long long)(addr - sym->address), dso);
+	}
+	else {
+		fprintf(fp, "\t%16llx [unknown] (%s)\n", (unsigned long long)addr, dso);
+	}
+}
 
-				// for now, return message;
+TraceDqrProfiler::DQErr PerfScriptWriter::writeEvent(const char* event, uint64_t period, TraceDqrProfiler::ADDRESS addr, TraceDqrProfiler::ADDRESS caller, bool haveCaller)
+{
+	// there is no process, cpu or time for the counts, so those fields are always 0
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
-					messageInfo.currentAddress = currentAddress[currentCore];
+	fprintf(fp, "trace     0 [000]     0.000000: %10llu %s: \n", (unsigned long long)period, event);
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+	writeFrame(addr);
+	if (haveCaller) {
+		writeFrame(caller);
+	}
 
-				readNewTraceMessage = true;
+	if (fputc('\n', fp) == EOF) {
+		printf("Error: PerfScriptWriter::writeEvent(): Write failed\n");
+		status = TraceDqrProfiler::DQERR_ERR;
+	}
 
-				return status;
-			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
-				// retire these instantly by returning them through msgInfo
+	return status;
+}
 
-				if (nm.haveTimestamp) {
-					lastTime[currentCore] = processTS(TraceDqrProfiler::TS_rel, lastTime[currentCore], nm.timestamp);
-				}
+TraceDqrProfiler::DQErr PerfScriptWriter::finish()
+{
+	if (fp == nullptr) {
+		return status;
+	}
 
-				if (msgInfo != nullptr) {
-					messageInfo = nm;
-					messageInfo.time = lastTime[currentCore];
-					messageInfo.currentAddress = currentAddress[currentCore];
+	for (std::map<TraceDqrProfiler::ADDRESS, uint64_t>::iterator it = totals.begin(); (it != totals.end()) && (status == TraceDqrProfiler::DQERR_OK); ++it) {
+		writeEvent("instructions", it->second, it->first, 0, false);
+	}
 
-					if ((consumed == false) && (messageInfo.processITCPrintData(itcPrint) == false)) {
-						*msgInfo = &messageInfo;
-					}
-				}
+	for (size_t i = 0; (i < edges.size()) && (status == TraceDqrProfiler::DQERR_OK); i++) {
+		const ProfilerCallGraph::Edge& e = edges[i];
 
-				// leave state along. Need to get another message with an i-cnt!
+		if (e.calls != 0) {
+			writeEvent("calls", e.calls, e.callee, e.caller, e.caller != 0);
+		}
+	}
 
-				readNewTraceMessage = true;
+	if ((fclose(fp) != 0) && (status == TraceDqrProfiler::DQERR_OK)) {
+		printf("Error: PerfScriptWriter::finish(): Close failed\n");
+		status = TraceDqrProfiler::DQERR_ERR;
+	}
 
-				return status;
-			default:
-				state[currentCore] = TRACE_STATE_ERROR;
-				status = TraceDqrProfiler::DQERR_ERR;
+	fp = nullptr;
+	totals.clear();
+	edges.clear();
 
-				return status;
-			}
-			break;
-		case TRACE_STATE_GETNEXTINSTRUCTION:
-			if (counts->getCurrentCountType(currentCore) == TraceDqrProfiler::COUNTTYPE_none) {
-				if (profiler_globalDebugFlag) {
-					printf("NextInstruction(): counts are exhausted\n");
-				}
+	return status;
+}
 
-				state[currentCore] = TRACE_STATE_RETIREMESSAGE;
-				break;
-			}
+void TraceProfiler::chargeTime(int core)
+{
+	// share the ticks since the core's last timestamp over the instructions it retired since then, in
+	// proportion to how many times each address ran. The shares always add up to the ticks
 
-			//			printf("state TRACE_STATE_GETNEXTINSTRUCTION\n");
+	TraceDqrProfiler::TIMESTAMP now = lastTime[core];
+	TraceDqrProfiler::TIMESTAMP start = m_time_last[core];
 
-						// Should first process addr, and then compute next addr!!! If can't compute next addr, it is an error.
-						// Should always be able to process instruction at addr and compute next addr when we get here.
-						// After processing next addr, if there are no more counts, retire trace message and get another
+	if (now == start) {
+		return;
+	}
 
-			addr = currentAddress[currentCore];
+	m_time_last[core] = now;
+	m_time_window[core].takeChanges(m_time_delta);
 
-			uint32_t inst;
-			int inst_size;
-			TraceDqrProfiler::InstType inst_type;
-			int32_t immediate;
-			bool isBranch;
-			int rc;
-			TraceDqrProfiler::Reg rs1;
-			TraceDqrProfiler::Reg rd;
+	// with no start time (first timestamp, or time was lost) the instructions cannot be timed
 
-			// getInstrucitonByAddress() should cache last instrucioton/address because I thjink
-			// it gets called a couple times for each address/insruction in a row
+	if ((start == 0) || (now == 0) || (now < start)) {
+		return;
+	}
 
-			status = elfReader->getInstructionByAddress(addr, inst);
-			if (status != TraceDqrProfiler::DQERR_OK) {
-				printf("Error: getInstructionByAddress failed - looking for next sync message\n");
+	uint64_t total = 0;
 
-				lastTime[currentCore] = 0;
-				currentAddress[currentCore] = 0;
-				lastFaddr[currentCore] = 0;
+	for (size_t i = 0; i < m_time_delta.size(); i++) {
+		total += m_time_delta[i].second;
+	}
 
-				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
+	if (total == 0) {
+		return;
+	}
 
-				// the evil break below exits the switch statement - not the if statement!
+	uint64_t ticks = now - start;
+	uint64_t q = ticks / total;
+	uint64_t r = ticks % total;
+	uint64_t cum = 0;
 
-				break;
+	for (size_t i = 0; i < m_time_delta.size(); i++) {
+		uint64_t before = (cum * r) / total;
 
-				//				state[currentCore] = TRACE_STATE_ERROR;
-				//
-				//				return status;
-			}
+		cum += m_time_delta[i].second;
 
-			// figure out how big the instruction is
+		uint64_t share = m_time_delta[i].second * q + (cum * r) / total - before;
 
-//			decode instruction/decode instruction size should cache their results (at least last one)
-//			because it gets called a few times here!
+		if (share != 0) {
+			m_time_hist.add(m_time_delta[i].first, share);
+		}
+	}
+}
 
-			rc = decodeInstruction(inst, inst_size, inst_type, rs1, rd, immediate, isBranch);
-			if (rc != 0) {
-				printf("Error: Cann't decode size of instruction %04x\n", inst);
+void TraceProfiler::reportHistogram(uint64_t total_ins, bool final)
+{
+	uint64_t total_bytes = nm.offset + nm.size_message;
 
-				state[currentCore] = TRACE_STATE_ERROR;
-				status = TraceDqrProfiler::DQERR_ERR;
+	// time is charged when a core starts on its next message, so the instructions before each core's last
+	// timestamp are still waiting in its window
 
-				return status;
-			}
+	if (final) {
+		for (int core = 0; core < (int)m_time_window.size(); core++) {
+			chargeTime(core);
+		}
+	}
 
-			Disassemble(addr);
+	if (m_fp_hist_callback) {
+		m_fp_hist_callback(m_src_id, m_hist, total_bytes, total_ins, (int32_t)status);
+	}
 
-			// compute next address (retire this instruction)
+	bool writing = haveProfileWriters();
 
-			// nextAddr() will also update counts
-			//
-			// nextAddr() computes next address if possible, consumes counts
+	if (m_fp_hist_delta_callback || writing || m_fp_hist_summary_callback) {
+		m_hist.takeChanges(m_hist_delta);
+	}
 
-			// nextAddr can usually compute the next address, but not always. If it can't, it returns
-			// -1 as the next address.  This should never happen for conditional branches because we
-			// should always have enough informatioon. But it can happen for indirect branches. For indirect
-			// branches, retiring the current trace message (should be an indirect branch or indirect
-			// brnach with sync) will set the next address correclty.
+	if (m_fp_hist_delta_callback) {
+		m_fp_hist_delta_callback(m_src_id, m_hist_delta.data(), m_hist_delta.size(), final ? &m_hist : nullptr, total_bytes, total_ins, (int32_t)status);
+	}
 
-			status = nextAddr(currentCore, currentAddress[currentCore], addr, nm.tcode, crFlag, brFlags);
-			if (status != TraceDqrProfiler::DQERR_OK) {
-				printf("Error: nextAddr() failed\n");
+	if (m_fp_hist_summary_callback) {
 
-				state[currentCore] = TRACE_STATE_ERROR;
+		// a new summarizer starts from the whole histogram; after that only the changes are added
 
-				return status;
-			}
+		if (m_hist_summarizer == nullptr) {
+			m_hist_summarizer = new HistogramSummarizer(elfReader, m_hist_summary_levels);
+			m_hist_summarizer->add(m_hist);
+		}
+		else {
+			m_hist_summarizer->add(m_hist_delta.data(), m_hist_delta.size());
+		}
 
-			// if addr == -1 and brFlags == BRFLAG_unknown, we need to read another trace message
-			// which hopefully with have history bits. Do not return the instruciton yet - we will
-			// retry it after getting another trace message
+		m_hist_summarizer->getSummary(m_hist_summary);
+		m_fp_hist_summary_callback(m_src_id, m_hist_summary, total_bytes, total_ins, (int32_t)status);
+	}
 
-			// if addr == -1 and brflags != BRFLAG_unknown, and current counts type != none, we have an
-			// error.
+	if (m_fp_time_profile_callback) {
+		m_time_summary.clear();
 
-			// if addr == -1 and brflags != BRFLAG_unkonw and current count type == none, all should
-			// be good. We will return the instruction and read another message
+		if (m_time_summary_levels != ProfilerHistogramSummary::sumNone) {
+			m_time_hist.takeChanges(m_time_hist_delta);
 
-			if (addr == (TraceDqrProfiler::ADDRESS)-1) {
-				if (brFlags == TraceDqrProfiler::BRFLAG_unknown) {
-					// read another trace message and retry
+			if (m_time_summarizer == nullptr) {
+				m_time_summarizer = new HistogramSummarizer(elfReader, m_time_summary_levels);
+				m_time_summarizer->add(m_time_hist);
+			}
+			else {
+				m_time_summarizer->add(m_time_hist_delta.data(), m_time_hist_delta.size());
+			}
 
-					state[currentCore] = TRACE_STATE_RETIREMESSAGE;
-					break; // this break exits trace_state_getnextinstruction!
-				}
-				else if (counts->getCurrentCountType(currentCore) != TraceDqrProfiler::COUNTTYPE_none) {
-					// error
-					// must have a JR/JALR or exception/exception return to get here, and the CR stack is empty
+			m_time_summarizer->getSummary(m_time_summary);
+		}
 
-					printf("Error: getCurrentCountType(core:%d) still has counts; have countType: %d\n", currentCore, counts->getCurrentCountType(currentCore));
-					char d[64];
+		m_fp_time_profile_callback(m_src_id, m_time_hist, m_time_summary, total_bytes, total_ins, (int32_t)status);
+	}
 
-					instructionInfo.instructionToText(d, sizeof d, 2);
-					printf("%08llx:    %s\n", currentAddress[currentCore], d);
+	if ((m_fp_call_graph_callback || (final && writing)) && (m_call_graph != nullptr)) {
+		m_call_graph->snapshot(m_call_graph_out);
 
-					state[currentCore] = TRACE_STATE_ERROR;
+		if (m_fp_call_graph_callback) {
+			m_fp_call_graph_callback(m_src_id, m_call_graph_out, total_bytes, total_ins, (int32_t)status);
+		}
+	}
 
-					status = TraceDqrProfiler::DQERR_ERR;
+	if (writing) {
+		for (int i = 0; i < PROFILE_NUM_FORMATS; i++) {
+			ProfileWriter* pw = m_profile_writers[i];
 
-					//					nm.dumpRawMessage();
-					//					nm.dump();
-					//
-					//					rc = sfp->readNextTraceMsg(nm,analytics,haveMsg);
-					//
-					//					if (rc != TraceDqrProfiler::DQERR_OK) {
-					//						printf("Error: TraceProfiler file does not contain any trace messages, or is unreadable\n");
-					//					} else if (haveMsg != false) {
-					//						nm.dumpRawMessage();
-					//						nm.dump();
-					//					}
+			if (pw != nullptr) {
+				pw->addCounts(m_hist_delta.data(), m_hist_delta.size());
 
-					return status;
+				if (final && (m_call_graph != nullptr)) {
+					pw->addCallGraph(m_call_graph_out);
 				}
 			}
+		}
 
-			currentAddress[currentCore] = addr;
+		// the files are complete once GenerateHistogram() returns
 
-			uint32_t prevCycle;
-			prevCycle = 0;
+		if (final) {
+			closeProfileWriters();
+		}
+	}
+}
 
-			if (caTrace != nullptr) {
-				if (syncCount > 0) {
-					if (caSyncAddr == instructionInfo.address) {
-						//						printf("ca sync successful at addr %08x\n",caSyncAddr);
+TraceDqrProfiler::DQErr TraceProfiler::SetProfileOutput(ProfileFormat format, const char* path)
+{
+	if ((format < 0) || (format >= PROFILE_NUM_FORMATS)) {
+		printf("Error: TraceProfiler::SetProfileOutput(): Invalid format %d\n", (int)format);
+		return TraceDqrProfiler::DQERR_ERR;
+	}
 
-						syncCount = 0;
-					}
-					else {
-						syncCount -= 1;
-						if (syncCount == 0) {
-							printf("Error: unable to sync CA trace and instruction trace\n");
-							state[currentCore] = TRACE_STATE_ERROR;
-							status = TraceDqrProfiler::DQERR_ERR;
-							return status;
-						}
-					}
-				}
+	// the file is opened here, so an error can be returned. Only swapping it in is left to applySetting()
 
-				if (syncCount == 0) {
-					status = caTrace->consume(caFlags, inst_type, pipeCycles, viStartCycles, viFinishCycles, qDepth, arithInProcess, loadInProcess, storeInProcess);
-					if (status == TraceDqrProfiler::DQERR_EOF) {
-						state[currentCore] = TRACE_STATE_DONE;
-						return status;
-					}
+	ProfileWriter* pw = nullptr;
 
-					if (status != TraceDqrProfiler::DQERR_OK) {
-						state[currentCore] = TRACE_STATE_ERROR;
-						return status;
-					}
+	if (path != nullptr) {
+		if (format == PROFILE_PPROF) {
+			pw = new PprofWriter(elfReader);
+		}
+		else {
+			pw = new PerfScriptWriter(elfReader);
+		}
 
-					prevCycle = lastCycle[currentCore];
+		TraceDqrProfiler::DQErr rc = pw->open(path);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			delete pw;
+			return rc;
+		}
+	}
 
-					eCycleCount[currentCore] = pipeCycles - prevCycle;
+	applySetting([this, format, pw]() {
+		if (m_profile_writers[format] != nullptr) {
+			m_profile_writers[format]->finish();
+			delete m_profile_writers[format];
+		}
 
-					lastCycle[currentCore] = pipeCycles;
-				}
-			}
+		m_profile_writers[format] = pw;
 
-			if (instInfo != nullptr) {
-				instructionInfo.qDepth = qDepth;
-				instructionInfo.arithInProcess = arithInProcess;
-				instructionInfo.loadInProcess = loadInProcess;
-				instructionInfo.storeInProcess = storeInProcess;
+		updateTracking();
+	});
 
-				qDepth = 0;
-				arithInProcess = 0;
-				loadInProcess = 0;
-				storeInProcess = 0;
+	return TraceDqrProfiler::DQERR_OK;
+}
 
-				instructionInfo.coreId = currentCore;
-				*instInfo = &instructionInfo;
-				(*instInfo)->CRFlag = (crFlag | enterISR[currentCore]);
-				enterISR[currentCore] = TraceDqrProfiler::isNone;
-				(*instInfo)->brFlags = brFlags;
+void TraceProfiler::applySetting(std::function<void()> apply)
+{
+	std::lock_guard<std::mutex> m_abort_profiling_mutex_guard(m_abort_histogram_mutex);
 
-				if ((caTrace != nullptr) && (syncCount == 0)) {
-					// note: start signal is one cycle after execution begins. End signal is two cycles after end
+	if (m_histogram_running) {
+		m_pending_settings.push_back(apply);
+	}
+	else {
+		apply();
+	}
+}
 
-					(*instInfo)->timestamp = pipeCycles;
-					(*instInfo)->pipeCycles = eCycleCount[currentCore];
+void TraceProfiler::applyPendingSettings()
+{
+	std::vector<std::function<void()>> pending;
 
-					(*instInfo)->VIStartCycles = viStartCycles - prevCycle;
-					(*instInfo)->VIFinishCycles = viFinishCycles - prevCycle - 1;
+	{
+		std::lock_guard<std::mutex> m_abort_profiling_mutex_guard(m_abort_histogram_mutex);
+		pending.swap(m_pending_settings);
+	}
 
-					(*instInfo)->caFlags = caFlags;
-				}
-				else {
-					(*instInfo)->timestamp = lastTime[currentCore];
-				}
-			}
+	for (size_t i = 0; i < pending.size(); i++) {
+		pending[i]();
+	}
+}
 
-			//			lastCycle[currentCore] = cycles;
+void TraceProfiler::closeProfileWriters()
+{
+	for (int i = 0; i < PROFILE_NUM_FORMATS; i++) {
+		if (m_profile_writers[i] != nullptr) {
+			m_profile_writers[i]->finish();
+			delete m_profile_writers[i];
+			m_profile_writers[i] = nullptr;
+		}
+	}
 
-			if (srcInfo != nullptr) {
-				sourceInfo.coreId = currentCore;
-				*srcInfo = &sourceInfo;
-			}
+	updateTracking();
+}
 
-			status = analytics.updateInstructionInfo(currentCore, inst, inst_size, crFlag, brFlags);
-			if (status != TraceDqrProfiler::DQERR_OK) {
-				state[currentCore] = TRACE_STATE_ERROR;
+void TraceProfiler::updateTracking()
+{
+	// the summary totals are kept up to date from the changes, so they are only right while changes are tracked
+	// for as long as the summarizer exists. A summarizer no longer wanted, or for other levels, is dropped and
+	// the next one starts again from the whole histogram
 
-				printf("Error: updateInstructionInfo() failed\n");
-				return status;
-			}
+	if ((m_hist_summarizer != nullptr) && ((m_fp_hist_summary_callback == nullptr) || (m_hist_summarizer->getLevels() != m_hist_summary_levels))) {
+		delete m_hist_summarizer;
+		m_hist_summarizer = nullptr;
+	}
 
+	m_hist.trackChanges((m_fp_hist_delta_callback != nullptr) || haveProfileWriters() || (m_fp_hist_summary_callback != nullptr));
 
-			if (counts->getCurrentCountType(currentCore) != TraceDqrProfiler::COUNTTYPE_none) {
-				// still have valid counts. Keep running nextInstruction!
+	bool timeSummary = (m_fp_time_profile_callback != nullptr) && (m_time_summary_levels != ProfilerHistogramSummary::sumNone);
 
-				return status;
-			}
+	if ((m_time_summarizer != nullptr) && (!timeSummary || (m_time_summarizer->getLevels() != m_time_summary_levels))) {
+		delete m_time_summarizer;
+		m_time_summarizer = nullptr;
+	}
 
-			// counts have expired. Retire this message and read next trace message and update. This should cause the
-			// current process instruction (above) to be returned along with the retired trace message
+	m_time_hist.trackChanges(timeSummary);
+}
 
-			// if the instruction processed above in an indirect branch, counts should be zero and
-			// retiring this trace message should set the next address (message should be an indirect
-			// brnach type message)
+void TraceProfiler::ClearHistogram()
+{
+	// the histograms and their pending changes are emptied, so the summarizers go back to zero to match
 
-			state[currentCore] = TRACE_STATE_RETIREMESSAGE;
-			break;
-		case TRACE_STATE_DONE:
-			status = TraceDqrProfiler::DQERR_DONE;
-			return status;
-		case TRACE_STATE_ERROR:
-			status = TraceDqrProfiler::DQERR_ERR;
-			return status;
-		default:
-			printf("Error: TraceProfiler::NextInstruction():unknown\n");
+	m_hist.clear();
+	m_time_hist.clear();
 
-			state[currentCore] = TRACE_STATE_ERROR;
-			status = TraceDqrProfiler::DQERR_ERR;
-			return status;
-		}
+	if (m_hist_summarizer != nullptr) {
+		m_hist_summarizer->clear();
 	}
 
-	status = TraceDqrProfiler::DQERR_OK;
-	return TraceDqrProfiler::DQERR_OK;
+	if (m_time_summarizer != nullptr) {
+		m_time_summarizer->clear();
+	}
 }
 
 TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
@@ -7494,18 +10372,64 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 	{
 		std::lock_guard<std::mutex> m_abort_profiling_mutex_guard(m_abort_histogram_mutex);
 		m_abort_histogram = false;
+		m_histogram_running = true;
+	}
+
+	TraceDqrProfiler::DQErr rc;
+
+	rc = runHistogram();
+
+	{
+		std::lock_guard<std::mutex> m_abort_profiling_mutex_guard(m_abort_histogram_mutex);
+		m_histogram_running = false;
+	}
+
+	// anything set after the decode loop last looked
+
+	applyPendingSettings();
+
+	return rc;
+}
+
+TraceDqrProfiler::DQErr TraceProfiler::runHistogram()
+{
+	// count addresses in the elf file's code sections densely
+
+	if ((m_hist.getNumRegions() == 0) && (elfReader != nullptr)) {
+		for (Section* sp = elfReader->getCodeSections(); sp != nullptr; sp = ElfReader::nextCodeSection(sp->next)) {
+			m_hist.addRegion(sp->startAddr, sp->endAddr);
+		}
+	}
+
+	if ((m_fp_call_graph_callback || haveProfileWriters()) && (m_call_graph == nullptr)) {
+		m_call_graph = new CallGraphBuilder(elfReader);
+	}
+
+	if (m_fp_time_profile_callback && m_time_window.empty()) {
+		ProfilerHistogram window;
+
+		for (Section* sp = (elfReader != nullptr) ? elfReader->getCodeSections() : nullptr; sp != nullptr; sp = ElfReader::nextCodeSection(sp->next)) {
+			window.addRegion(sp->startAddr, sp->endAddr);
+			m_time_hist.addRegion(sp->startAddr, sp->endAddr);
+		}
+
+		window.trackChanges(true);
+
+		m_time_window.assign(DQR_PROFILER_MAXCORES, window);
+		m_time_last.assign(DQR_PROFILER_MAXCORES, 0);
 	}
 
+	bool timing = !m_time_window.empty();
+
 	if (status != TraceDqrProfiler::DQERR_OK)
 	{
-		if (m_fp_hist_callback)
-			m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), 0, (int32_t)status);
+		reportHistogram(0, true);
 		return status;
 	}
 
 	TraceDqrProfiler::DQErr rc;
 	TraceDqrProfiler::ADDRESS addr;
-	int crFlag;
+	int crFlag = TraceDqrProfiler::isNone;
 	TraceDqrProfiler::BranchFlags brFlags;
 	bool consumed = false;
 	uint64_t prev_address = 0;
@@ -7513,6 +10437,8 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 	uint64_t next_offset = update_offset;
 	bool complete = false;
 	uint64_t n_ins_cnt = 0;
+	Section* runSection = nullptr;
+	bool haveSettings;
 	for (;;)
 	{
 		bool haveMsg;
@@ -7522,16 +10448,14 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 			{
 				if (n_ins_cnt > next_offset)
 				{
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, false);
 					next_offset += update_offset;
 				}
 				if ((nm.offset + nm.size_message) >= m_flush_data_offset)
 				{
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, false);
 				}
-				rc = sfp->readNextTraceMsg(nm, analytics, haveMsg);
+				rc = readNextTraceMsg(nm, haveMsg);
 				if (rc != TraceDqrProfiler::DQERR_OK)
 				{
 					// have an error. either EOF, or error
@@ -7548,13 +10472,16 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 
 					complete = true;
 					m_flush_data_offset = 0xFFFFFFFFFFFFFFFF;
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, true);
 					return status;
 				}
 				complete = false;
 				if (haveMsg == false)
 				{
+					if (m_call_graph != nullptr) {
+						m_call_graph->resetCore(currentCore);
+					}
+
 					lastTime[currentCore] = 0;
 					currentAddress[currentCore] = 0;
 					lastFaddr[currentCore] = 0;
@@ -7574,6 +10501,11 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 				status = TraceDqrProfiler::DQERR_EOF;
 				return status;
 			}
+			haveSettings = !m_pending_settings.empty();
+		}
+
+		if (haveSettings) {
+			applyPendingSettings();
 		}
 
 		switch (state[currentCore])
@@ -7589,8 +10521,7 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 				if (rc != TraceDqrProfiler::DQERR_OK) {
 					status = TraceDqrProfiler::DQERR_ERR;
 					state[currentCore] = TRACE_STATE_ERROR;
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, true);
 					return status;
 				}
 				state[currentCore] = TRACE_STATE_GETMSGWITHCOUNT;
@@ -7615,8 +10546,7 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 			default:
 				state[currentCore] = TRACE_STATE_ERROR;
 				status = TraceDqrProfiler::DQERR_ERR;
-				if (m_fp_hist_callback)
-					m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+				reportHistogram(n_ins_cnt, true);
 				return status;
 			}
 			readNewTraceMessage = true;
@@ -7638,8 +10568,7 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 				if (rc != TraceDqrProfiler::DQERR_OK) {
 					state[currentCore] = TRACE_STATE_ERROR;
 					status = rc;
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, true);
 					return status;
 				}
 				state[currentCore] = TRACE_STATE_GETNEXTINSTRUCTION;
@@ -7647,6 +10576,10 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 			case TraceDqrProfiler::TCODE_ERROR:
 				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
 
+				if (m_call_graph != nullptr) {
+					m_call_graph->resetCore(currentCore);
+				}
+
 				nm.timestamp = 0;	// clear time because we have lost time
 				lastTime[currentCore] = 0;
 				currentAddress[currentCore] = 0;
@@ -7662,8 +10595,7 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 
 					status = TraceDqrProfiler::DQERR_ERR;
 					state[currentCore] = TRACE_STATE_ERROR;
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, true);
 					return status;
 				}
 				readNewTraceMessage = true;
@@ -7677,8 +10609,7 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 
 				state[currentCore] = TRACE_STATE_ERROR;
 				status = TraceDqrProfiler::DQERR_ERR;
-				if (m_fp_hist_callback)
-					m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+				reportHistogram(n_ins_cnt, true);
 				return status;
 			}
 			break;
@@ -7698,10 +10629,38 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 					printf("Error: NextInstruction(): state TRACE_STATE_RETIREMESSAGE: processTraceMessage()\n");
 					status = TraceDqrProfiler::DQERR_ERR;
 					state[currentCore] = TRACE_STATE_ERROR;
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, true);
 					return status;
 				}
+
+				// an exception the last instruction did not raise itself (as ecall does) is an interrupt, so the
+				// handler the message goes to is called from whatever was running
+
+				if (m_call_graph != nullptr) {
+					TraceDqrProfiler::BType b_type = TraceDqrProfiler::BTYPE_UNDEFINED;
+
+					switch (nm.tcode) {
+					case TraceDqrProfiler::TCODE_INDIRECT_BRANCH:
+						b_type = nm.indirectBranch.b_type;
+						break;
+					case TraceDqrProfiler::TCODE_INDIRECT_BRANCH_WS:
+						b_type = nm.indirectBranchWS.b_type;
+						break;
+					case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY:
+						b_type = nm.indirectHistory.b_type;
+						break;
+					case TraceDqrProfiler::TCODE_INDIRECTBRANCHHISTORY_WS:
+						b_type = nm.indirectHistoryWS.b_type;
+						break;
+					default:
+						break;
+					}
+
+					if ((b_type == TraceDqrProfiler::BTYPE_EXCEPTION) && ((crFlag & TraceDqrProfiler::isException) == 0)) {
+						m_call_graph->interrupt(currentCore);
+					}
+				}
+
 				readNewTraceMessage = true;
 				state[currentCore] = TRACE_STATE_GETNEXTMSG;
 				continue;
@@ -7718,8 +10677,7 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 				printf("Error: bad tcode type in state TRACE_STATE_RETIREMESSAGE\n");
 				state[currentCore] = TRACE_STATE_ERROR;
 				status = TraceDqrProfiler::DQERR_ERR;
-				if (m_fp_hist_callback)
-					m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+				reportHistogram(n_ins_cnt, true);
 				return status;
 			}
 
@@ -7741,8 +10699,7 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 					printf("Error: nextInstruction: state TRACE_STATE_GETNEXTMESSAGE Count::seteCounts()\n");
 					state[currentCore] = TRACE_STATE_ERROR;
 					status = rc;
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, true);
 					return status;
 				}
 				state[currentCore] = TRACE_STATE_GETNEXTINSTRUCTION;
@@ -7750,6 +10707,10 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 			case TraceDqrProfiler::TCODE_ERROR:
 				state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
 
+				if (m_call_graph != nullptr) {
+					m_call_graph->resetCore(currentCore);
+				}
+
 				nm.timestamp = 0;	// clear time because we have lost time
 				currentAddress[currentCore] = 0;
 				lastFaddr[currentCore] = 0;
@@ -7763,13 +10724,11 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 				if (rc != TraceDqrProfiler::DQERR_OK) {
 					status = TraceDqrProfiler::DQERR_ERR;
 					state[currentCore] = TRACE_STATE_ERROR;
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, true);
 					return status;
 				}
 				readNewTraceMessage = true;
-				if (m_fp_hist_callback)
-					m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+				reportHistogram(n_ins_cnt, true);
 				return status;
 			case TraceDqrProfiler::TCODE_OWNERSHIP_TRACE:
 				readNewTraceMessage = true;
@@ -7777,8 +10736,7 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 			default:
 				state[currentCore] = TRACE_STATE_ERROR;
 				status = TraceDqrProfiler::DQERR_ERR;
-				if (m_fp_hist_callback)
-					m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+				reportHistogram(n_ins_cnt, true);
 				return status;
 			}
 			break;
@@ -7792,15 +10750,78 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 				state[currentCore] = TRACE_STATE_RETIREMESSAGE;
 				continue;
 			}
+			if (timing) {
+				chargeTime(currentCore);
+			}
+
 			while (1)
 			{
 				addr = currentAddress[currentCore];
+
+				// straight line code only moves the pc on and uses up i-cnt. Step over the whole run in one
+				// go, stopping where nextAddr() would have run out of counts
+
+				if ((runSection == nullptr) || (addr < runSection->startAddr) || (addr > runSection->endAddr)) {
+					runSection = elfReader->getSectionByAddress(addr);
+				}
+
+				if ((runSection != nullptr) && (runSection->plainRun != nullptr) && (runSection->plainRun[(addr - runSection->startAddr) >> 1] != 0)) {
+					int run = runSection->plainRun[(addr - runSection->startAddr) >> 1];
+					bool iCntOnly = counts->getCurrentCountType(currentCore) == TraceDqrProfiler::COUNTTYPE_i_cnt;
+					int iCnt = counts->consumeICnt(currentCore, 0);
+					int used = 0;
+					TraceDqrProfiler::ADDRESS runStart = addr;
+					uint64_t runInsts = 0;
+
+					while (used < run) {
+						if (prev_address != addr)
+						{
+							m_hist.add(addr);
+							n_ins_cnt++;
+
+							if (timing) {
+								m_time_window[currentCore].add(addr);
+							}
+						}
+						prev_address = addr;
+
+						int n = ((runSection->code[(addr - runSection->startAddr) >> 1] & 0x0003) == 0x0003) ? 2 : 1;
+
+						addr += n * 2;
+						used += n;
+						runInsts += 1;
+
+						if (iCntOnly && (used >= iCnt)) {
+							break;
+						}
+					}
+
+					if (m_call_graph != nullptr) {
+						m_call_graph->instructions(currentCore, runStart, runInsts, lastTime[currentCore]);
+					}
+
+					crFlag = TraceDqrProfiler::isNone;
+					counts->consumeICnt(currentCore, used);
+					currentAddress[currentCore] = addr;
+
+					if (counts->getCurrentCountType(currentCore) == TraceDqrProfiler::COUNTTYPE_none)
+					{
+						break;
+					}
+
+					continue;
+				}
+
 				uint64_t address_out = (addr);
 
 				if (prev_address != address_out)
 				{
-					m_hist_map[address_out] += 1;
+					m_hist.add(address_out);
 					n_ins_cnt++;
+
+					if (timing) {
+						m_time_window[currentCore].add(address_out);
+					}
 				}
 				prev_address = address_out;
 
@@ -7817,8 +10838,7 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 				if (status != TraceDqrProfiler::DQERR_OK)
 				{
 					state[currentCore] = TRACE_STATE_ERROR;
-					if (m_fp_hist_callback)
-						m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+					reportHistogram(n_ins_cnt, true);
 					return status;
 				}
 
@@ -7831,12 +10851,21 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 					}
 					else if (counts->getCurrentCountType(currentCore) != TraceDqrProfiler::COUNTTYPE_none)
 					{
+						if (m_call_graph != nullptr) {
+							m_call_graph->resetCore(currentCore);
+						}
+
 						state[currentCore] = TRACE_STATE_GETFIRSTSYNCMSG;
 						status = TraceDqrProfiler::DQERR_OK;
 						break;
 					}
 				}
 
+				// a call or return retires here; a branch waiting on history above is tried again
+
+				if (m_call_graph != nullptr) {
+					m_call_graph->retire(currentCore, address_out, crFlag, lastTime[currentCore]);
+				}
 
 				currentAddress[currentCore] = addr;
 
@@ -7852,25 +10881,21 @@ TraceDqrProfiler::DQErr TraceProfiler::GenerateHistogram()
 			break;
 		case TRACE_STATE_DONE:
 			status = TraceDqrProfiler::DQERR_DONE;
-			if (m_fp_hist_callback)
-				m_fp_hist_callback(m_src_id,m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+			reportHistogram(n_ins_cnt, true);
 			return status;
 		case TRACE_STATE_ERROR:
 			status = TraceDqrProfiler::DQERR_ERR;
-			if (m_fp_hist_callback)
-				m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+			reportHistogram(n_ins_cnt, true);
 			return status;
 		default:
 			state[currentCore] = TRACE_STATE_ERROR;
 			status = TraceDqrProfiler::DQERR_ERR;
-			if (m_fp_hist_callback)
-				m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+			reportHistogram(n_ins_cnt, true);
 			return status;
 		}
 	}
 
 	status = TraceDqrProfiler::DQERR_OK;
-	if (m_fp_hist_callback)
-		m_fp_hist_callback(m_src_id, m_hist_map, (nm.offset + nm.size_message), n_ins_cnt, (int32_t)status);
+	reportHistogram(n_ins_cnt, true);
 	return TraceDqrProfiler::DQERR_OK;
 }
@@ -0,0 +1,83 @@
+# Program traced by the regression test, written the way the disassembler shows it. tests/tools/mkfixtures.py
+# assembles, links and runs it to make the trace. t0 and ra link, so the final jump uses t1 to stay a plain jump.
+# isr is never called; the run takes one interrupt part way through, which goes there
+
+	.text
+	.option norelax
+
+	.globl	_start
+	.type	_start,@function
+_start:
+	lui	sp, 0x80010
+	li	s0, 24
+outer:
+	mv	a0, s0
+	jal	sum_to
+	andi	t0, s0, 1
+	beqz	t0, even
+	lla	t1, square
+	mv	a0, s0
+	jalr	t1
+	j	next
+even:
+	mv	a0, s0
+	jal	fib
+next:
+	addi	s0, s0, -1
+	bnez	s0, outer
+	lla	t1, done
+	jr	t1
+done:
+	j	done
+	.size	_start, .-_start
+
+	.type	sum_to,@function
+sum_to:
+	li	a1, 0
+3:	add	a1, a1, a0
+	addi	a0, a0, -1
+	bnez	a0, 3b
+	mv	a0, a1
+	ret
+	.size	sum_to, .-sum_to
+
+	.type	square,@function
+square:
+	mul	a0, a0, a0
+	ret
+	.size	square, .-square
+
+	.type	fib,@function
+fib:
+	addi	sp, sp, -16
+	sd	ra, 8(sp)
+	li	a1, 0
+	li	a2, 1
+	mv	a3, a0
+4:	blez	a3, 5f
+	add	a4, a1, a2
+	mv	a1, a2
+	mv	a2, a4
+	mv	a0, a3
+	jal	leaf
+	addi	a3, a3, -1
+	j	4b
+5:	mv	a0, a1
+	ld	ra, 8(sp)
+	addi	sp, sp, 16
+	ret
+	.size	fib, .-fib
+
+	.type	leaf,@function
+leaf:
+	slli	a0, a0, 0x1
+	bgez	a0, 6f
+	neg	a0, a0
+6:	ret
+	.size	leaf, .-leaf
+
+	.type	isr,@function
+isr:
+	addi	gp, gp, 1
+	mret
+	.size	isr, .-isr
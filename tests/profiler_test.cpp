@@ -0,0 +1,942 @@
+/******************************************************************************
+	   Module: profiler_test.cpp
+  Description: Regression test. Runs the trace ring buffer with a producer
+               and a consumer thread, then checks the disassembly of the elf
+               file in tests/data against the source it was assembled from,
+               and the trace against the counts tests/tools/mkfixtures.py
+               expects it to decode to and against golden summary, call
+               graph and profile files. Output that does not match is left in the
+               current directory. With an objdump for RISC-V, the elf file
+               is also read with that instead of natively
+        Usage: profiler_test <tests/data directory> [objdump]
+******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+
+#include "dqr_profiler.h"
+#include "dqr_trace_profiler.h"
+
+typedef std::map<uint64_t, uint64_t> Counts;
+
+// the test runs in the data directory, so the elf file name in the output is always prog.elf. Output goes to the
+// directory the test was started in
+
+static std::string outDir;
+
+static std::string outPath(const char* name)
+{
+	return outDir + "/" + name;
+}
+
+// byte n of the data pushed through the ring. 251 is prime, so the pattern does not line up with the ring size
+
+static uint8_t ringByte(uint64_t n)
+{
+	return (uint8_t)(n % 251);
+}
+
+// pushes a counting pattern through a small ring on another thread, in pieces from 1 byte to several times the
+// ring size, while this thread reads it back and releases part of each span at a time. The data wraps around the
+// ring thousands of times. Before reading anything, the consumer waits long enough for the producer to fill the
+// ring, and checks that the producer is then blocked rather than overwriting data that was not read
+
+static bool testRingBuffer()
+{
+	const uint64_t ringSize = 256;
+	const uint64_t total = 1000000;
+
+	TraceRingBuffer ring(ringSize);
+
+	if (ring.getErr() != TraceDqrProfiler::DQERR_OK) {
+		return false;
+	}
+
+	std::atomic<uint64_t> pushed(0);
+	std::atomic<bool> pushFailed(false);
+
+	std::thread producer([&ring, &pushed, &pushFailed, total]() {
+		uint8_t buff[1024];
+		uint64_t n = 0;
+		uint64_t piece = 1;
+
+		while (n < total) {
+			uint64_t len = std::min(piece, total - n);
+
+			for (uint64_t i = 0; i < len; i++) {
+				buff[i] = ringByte(n + i);
+			}
+
+			if (ring.push(buff, len) != TraceDqrProfiler::DQERR_OK) {
+				pushFailed = true;
+				break;
+			}
+
+			n += len;
+			pushed = n;
+
+			piece = (piece * 7 + 3) % 1021 + 1;
+		}
+
+		ring.setEndOfData();
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	bool ok = true;
+
+	if (pushed > ringSize) {
+		printf("  ring: %llu bytes pushed into a %llu byte ring nobody read\n", (unsigned long long)pushed.load(), (unsigned long long)ringSize);
+		ok = false;
+	}
+
+	uint64_t n = 0;
+	uint64_t spans = 0;
+	TraceDqrProfiler::DQErr rc;
+
+	for (;;) {
+		const uint8_t* span;
+		uint64_t len;
+
+		rc = ring.getSpan(span, len);
+		if (rc != TraceDqrProfiler::DQERR_OK) {
+			break;
+		}
+
+		if ((len == 0) || (len > ringSize)) {
+			printf("  ring: span of %llu bytes\n", (unsigned long long)len);
+			ok = false;
+			break;
+		}
+
+		// release half of the longer spans, so the next span starts part way into this one
+
+		uint64_t used = (len > 16) ? len / 2 : len;
+
+		for (uint64_t i = 0; i < used; i++) {
+			if (span[i] != ringByte(n + i)) {
+				printf("  ring: byte %llu is %u, expected %u\n", (unsigned long long)(n + i), span[i], ringByte(n + i));
+				ok = false;
+				break;
+			}
+		}
+
+		if (!ok) {
+			break;
+		}
+
+		ring.release(used);
+
+		n += used;
+		spans += 1;
+	}
+
+	if (!ok) {
+		// let a blocked producer finish
+
+		ring.close();
+	}
+	else if (rc != TraceDqrProfiler::DQERR_EOF) {
+		printf("  ring: getSpan() returned %d\n", rc);
+		ok = false;
+	}
+
+	producer.join();
+
+	if (pushFailed) {
+		printf("  ring: push() failed\n");
+		ok = false;
+	}
+
+	if (ok && (n != total)) {
+		printf("  ring: read %llu bytes, expected %llu\n", (unsigned long long)n, (unsigned long long)total);
+		ok = false;
+	}
+
+	if (ok && (spans < total / ringSize)) {
+		printf("  ring: only %llu spans\n", (unsigned long long)spans);
+		ok = false;
+	}
+
+	return ok;
+}
+
+// reads "address count" lines, address in hex
+
+static bool readCounts(const char* name, Counts& counts)
+{
+	FILE* fp = fopen(name, "r");
+	if (fp == nullptr) {
+		printf("Error: cannot open %s\n", name);
+		return false;
+	}
+
+	unsigned long long addr;
+	unsigned long long count;
+
+	while (fscanf(fp, "%llx %llu", &addr, &count) == 2) {
+		counts[addr] = count;
+	}
+
+	fclose(fp);
+
+	return true;
+}
+
+static bool compareCounts(const char* what, const Counts& expected, const Counts& got)
+{
+	bool same = true;
+
+	for (Counts::const_iterator it = expected.begin(); it != expected.end(); ++it) {
+		Counts::const_iterator g = got.find(it->first);
+		uint64_t count = (g != got.end()) ? g->second : 0;
+
+		if (count != it->second) {
+			printf("  %s: address 0x%llx: expected %llu, got %llu\n", what, (unsigned long long)it->first, (unsigned long long)it->second, (unsigned long long)count);
+			same = false;
+		}
+	}
+
+	for (Counts::const_iterator it = got.begin(); it != got.end(); ++it) {
+		if ((it->second != 0) && (expected.find(it->first) == expected.end())) {
+			printf("  %s: address 0x%llx: not expected, got %llu\n", what, (unsigned long long)it->first, (unsigned long long)it->second);
+			same = false;
+		}
+	}
+
+	return same;
+}
+
+// one line of prog.s: the labels defined on it and the instruction, if there is one
+
+static bool readFile(const std::string& name, std::string& data)
+{
+	FILE* fp = fopen(name.c_str(), "rb");
+	if (fp == nullptr) {
+		printf("Error: cannot open %s\n", name.c_str());
+		return false;
+	}
+
+	char buf[4096];
+	size_t n;
+
+	data.clear();
+
+	while ((n = fread(buf, 1, sizeof buf, fp)) > 0) {
+		data.append(buf, n);
+	}
+
+	fclose(fp);
+
+	return true;
+}
+
+// compares output with the golden file of the same name. Output that does not match is written to outDir
+
+static bool compareGolden(const char* name, const std::string& output)
+{
+	std::string golden;
+
+	if (readFile(name, golden) && (output == golden)) {
+		return true;
+	}
+
+	printf("  %s: output does not match, see %s\n", name, outPath(name).c_str());
+
+	FILE* fp = fopen(outPath(name).c_str(), "wb");
+	if (fp != nullptr) {
+		fwrite(output.data(), 1, output.size(), fp);
+		fclose(fp);
+	}
+
+	return false;
+}
+
+static bool compareGoldenFile(const char* name)
+{
+	std::string output;
+
+	return readFile(outPath(name), output) && compareGolden(name, output);
+}
+
+class AsmLine {
+public:
+	std::vector<std::string> labels;
+	std::string mnemonic;
+	std::vector<std::string> operands;
+	int lineNum;
+	uint64_t address;
+};
+
+static std::string trim(const std::string& s)
+{
+	size_t b = s.find_first_not_of(" \t");
+	size_t e = s.find_last_not_of(" \t\r\n");
+
+	return (b == std::string::npos) ? std::string() : s.substr(b, e - b + 1);
+}
+
+// reads the labels and instructions of an assembler file. Comments and directives are skipped, except that the
+// names given @function type are returned in functions
+
+static bool readAsm(const char* name, std::vector<AsmLine>& lines, std::vector<std::string>& functions)
+{
+	FILE* fp = fopen(name, "r");
+	if (fp == nullptr) {
+		printf("Error: cannot open %s\n", name);
+		return false;
+	}
+
+	char buf[512];
+	int lineNum = 0;
+
+	while (fgets(buf, sizeof buf, fp) != nullptr) {
+		std::string text = buf;
+
+		lineNum += 1;
+
+		size_t hash = text.find('#');
+		if (hash != std::string::npos) {
+			text.erase(hash);
+		}
+
+		text = trim(text);
+
+		AsmLine line;
+
+		line.lineNum = lineNum;
+		line.address = 0;
+
+		// labels have no white space before the colon
+
+		for (;;) {
+			size_t colon = text.find(':');
+			if ((colon == std::string::npos) || (text.find_first_of(" \t") < colon)) {
+				break;
+			}
+
+			line.labels.push_back(text.substr(0, colon));
+			text = trim(text.substr(colon + 1));
+		}
+
+		if (!text.empty() && (text[0] == '.')) {
+			if (text.compare(0, 5, ".type") == 0) {
+				size_t comma = text.find(',');
+
+				if ((comma != std::string::npos) && (text.find("@function") != std::string::npos)) {
+					functions.push_back(trim(text.substr(5, comma - 5)));
+				}
+			}
+
+			text.clear();
+		}
+
+		if (!text.empty()) {
+			size_t space = text.find_first_of(" \t");
+
+			line.mnemonic = text.substr(0, space);
+
+			if (space != std::string::npos) {
+				std::string ops = text.substr(space);
+				size_t start = 0;
+
+				for (;;) {
+					size_t comma = ops.find(',', start);
+
+					line.operands.push_back(trim(ops.substr(start, comma - start)));
+
+					if (comma == std::string::npos) {
+						break;
+					}
+
+					start = comma + 1;
+				}
+			}
+		}
+
+		if (!line.labels.empty() || !line.mnemonic.empty()) {
+			lines.push_back(line);
+		}
+	}
+
+	fclose(fp);
+
+	return true;
+}
+
+// the text the disassembler shows for a branch target: the address, and the function it is in
+
+static std::string targetText(uint64_t target, const std::map<uint64_t, std::string>& functions)
+{
+	std::map<uint64_t, std::string>::const_iterator f = functions.upper_bound(target);
+	char buf[256];
+
+	if (f == functions.begin()) {
+		snprintf(buf, sizeof buf, "%llx", (unsigned long long)target);
+	}
+	else {
+		--f;
+
+		if (f->first == target) {
+			snprintf(buf, sizeof buf, "%llx <%s>", (unsigned long long)target, f->second.c_str());
+		}
+		else {
+			snprintf(buf, sizeof buf, "%llx <%s+0x%llx>", (unsigned long long)target, f->second.c_str(), (unsigned long long)(target - f->first));
+		}
+	}
+
+	return buf;
+}
+
+// resolves a label used as an operand on line i: a name, or a numeric local label with b or f for the nearest
+// one before or after the line
+
+static bool labelAddress(const std::vector<AsmLine>& lines, size_t i, const std::string& label, uint64_t& address)
+{
+	bool numeric = (label.size() > 1) && isdigit((unsigned char)label[0]) && ((label[label.size() - 1] == 'b') || (label[label.size() - 1] == 'f'));
+	std::string name = numeric ? label.substr(0, label.size() - 1) : label;
+	bool forward = numeric && (label[label.size() - 1] == 'f');
+	bool found = false;
+
+	for (size_t j = 0; j < lines.size(); j++) {
+		if (std::find(lines[j].labels.begin(), lines[j].labels.end(), name) == lines[j].labels.end()) {
+			continue;
+		}
+
+		if (!numeric || (forward && (j > i))) {
+			address = lines[j].address;
+			return true;
+		}
+
+		if (!forward && (j <= i)) {
+			address = lines[j].address;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+// disassembles each instruction in the .text section of prog.elf and checks the text is what prog.s says, with
+// branch targets as the disassembler shows them (address <function+offset>). lla is the one instruction in prog.s
+// that assembles to two, auipc and addi. objdump adds the address those make as a comment, which is ignored
+
+static bool testDisassembly(const char* objdump)
+{
+	std::vector<AsmLine> lines;
+	std::vector<std::string> functionNames;
+
+	if (!readAsm("prog.s", lines, functionNames)) {
+		return false;
+	}
+
+	ElfReader elfReader("prog.elf", objdump, nullptr, objdump != nullptr);
+
+	if (elfReader.getStatus() != TraceDqrProfiler::DQERR_OK) {
+		printf("  cannot read prog.elf\n");
+		return false;
+	}
+
+	Section* text = elfReader.getSections()->getSectionByName((char*)".text");
+	if (text == nullptr) {
+		printf("  prog.elf has no .text section\n");
+		return false;
+	}
+
+	Disassembler disassembler(elfReader.getSymtab(), elfReader.getSections(), elfReader.getArchSize());
+	std::vector<std::string> got;
+	std::vector<uint64_t> addresses;
+	uint64_t addr = text->startAddr;
+
+	while (addr <= text->endAddr) {
+		if (disassembler.disassemble(addr) != TraceDqrProfiler::DQERR_OK) {
+			printf("  cannot disassemble 0x%llx\n", (unsigned long long)addr);
+			return false;
+		}
+
+		ProfilerInstruction inst = disassembler.getInstructionInfo();
+		const char* instText;
+		const char* label;
+		int offset;
+
+		if (disassembler.getInstructionText(addr, instText, label, offset) != TraceDqrProfiler::DQERR_OK) {
+			printf("  no text for 0x%llx\n", (unsigned long long)addr);
+			return false;
+		}
+
+		std::string s = (instText != nullptr) ? instText : "";
+		size_t comment = s.find(" #");
+
+		if (comment != std::string::npos) {
+			s.erase(comment);
+		}
+
+		got.push_back(s);
+		addresses.push_back(addr);
+
+		addr += inst.instSize / 8;
+	}
+
+	// give each line the address of its instruction
+
+	size_t n = 0;
+
+	for (size_t i = 0; i < lines.size(); i++) {
+		lines[i].address = (n < addresses.size()) ? addresses[n] : addr;
+
+		if (!lines[i].mnemonic.empty()) {
+			n += (lines[i].mnemonic == "lla") ? 2 : 1;
+		}
+	}
+
+	if (n != got.size()) {
+		printf("  prog.s has %u instructions, prog.elf %u\n", (unsigned)n, (unsigned)got.size());
+		return false;
+	}
+
+	std::map<uint64_t, std::string> functions;
+
+	for (size_t i = 0; i < lines.size(); i++) {
+		for (size_t j = 0; j < lines[i].labels.size(); j++) {
+			if (std::find(functionNames.begin(), functionNames.end(), lines[i].labels[j]) != functionNames.end()) {
+				functions[lines[i].address] = lines[i].labels[j];
+			}
+		}
+	}
+
+	bool ok = true;
+
+	n = 0;
+
+	for (size_t i = 0; i < lines.size(); i++) {
+		const AsmLine& line = lines[i];
+
+		if (line.mnemonic.empty()) {
+			continue;
+		}
+
+		std::vector<std::string> expected;
+		uint64_t target;
+		char buf[256];
+
+		if (line.mnemonic == "lla") {
+			if ((line.operands.size() != 2) || !labelAddress(lines, i, line.operands[1], target)) {
+				printf("  prog.s:%d: cannot resolve lla\n", line.lineNum);
+				return false;
+			}
+
+			int64_t offset = (int64_t)(target - line.address);
+			int64_t hi = (offset + 0x800) >> 12;
+
+			snprintf(buf, sizeof buf, "auipc\t%s,0x%llx", line.operands[0].c_str(), (unsigned long long)(hi & 0xfffff));
+			expected.push_back(buf);
+			snprintf(buf, sizeof buf, "addi\t%s,%s,%lld", line.operands[0].c_str(), line.operands[0].c_str(), (long long)(offset - (hi << 12)));
+			expected.push_back(buf);
+		}
+		else {
+			std::string s = line.mnemonic;
+
+			for (size_t j = 0; j < line.operands.size(); j++) {
+				s += (j == 0) ? "\t" : ",";
+
+				if (labelAddress(lines, i, line.operands[j], target)) {
+					s += targetText(target, functions);
+				}
+				else {
+					s += line.operands[j];
+				}
+			}
+
+			expected.push_back(s);
+		}
+
+		for (size_t j = 0; j < expected.size(); j++, n++) {
+			if (got[n] != expected[j]) {
+				printf("  prog.s:%d: 0x%llx: expected '%s', got '%s'\n", line.lineNum, (unsigned long long)addresses[n], expected[j].c_str(), got[n].c_str());
+				ok = false;
+			}
+		}
+	}
+
+	return ok;
+}
+
+static TraceProfiler* newProfiler(const char* trace = "prog.rtd", int srcBits = 0)
+{
+	TraceProfiler* tp = new TraceProfiler((char*)trace, (char*)"prog.elf", 0, 0, srcBits, nullptr, 0);
+	if (tp->getStatus() != TraceDqrProfiler::DQERR_OK) {
+		printf("Error: cannot open %s or prog.elf\n", trace);
+		delete tp;
+		return nullptr;
+	}
+
+	tp->setTraceType(TraceDqrProfiler::TRACETYPE_HTM);
+	tp->setTSSize(40);
+
+	return tp;
+}
+
+// counts the addresses NextInstruction() returns, on numWorkers parallel decode workers if numWorkers > 1. The
+// segment size of 1 splits the trace at every sync message
+
+static bool countInstructions(uint32_t numWorkers, Counts& counts)
+{
+	TraceProfiler* tp = newProfiler();
+	if (tp == nullptr) {
+		return false;
+	}
+
+	bool ok = tp->MapTraceFile() == TraceDqrProfiler::DQERR_OK;
+
+	if (ok && (numWorkers > 1)) {
+		ok = tp->StartParallelDecode(numWorkers, 1) == TraceDqrProfiler::DQERR_OK;
+	}
+
+	TraceDqrProfiler::DQErr rc = TraceDqrProfiler::DQERR_OK;
+
+	while (ok && (rc == TraceDqrProfiler::DQERR_OK)) {
+		ProfilerInstruction* instInfo = nullptr;
+		ProfilerNexusMessage* msgInfo = nullptr;
+		uint64_t addr = 0;
+
+		rc = tp->NextInstruction(&instInfo, &msgInfo, addr);
+		if ((rc == TraceDqrProfiler::DQERR_OK) && (addr != 0)) {
+			counts[addr] += 1;
+		}
+	}
+
+	delete tp;
+
+	return ok && (rc == TraceDqrProfiler::DQERR_EOF);
+}
+
+static bool testDecode(const Counts& expected)
+{
+	Counts counts;
+
+	return countInstructions(1, counts) && compareCounts("decode", expected, counts);
+}
+
+static bool testParallelDecode()
+{
+	Counts serial;
+	Counts parallel;
+
+	if (!countInstructions(1, serial) || !countInstructions(3, parallel)) {
+		return false;
+	}
+
+	return compareCounts("parallel", serial, parallel);
+}
+
+// the message offset and address of each instruction NextInstruction() returns for cores.rtd, decoded serially or
+// with a worker per core
+
+typedef std::vector<std::pair<uint64_t, uint64_t> > Decoded;
+
+static bool decodeCores(bool perCore, Decoded& decoded)
+{
+	TraceProfiler* tp = newProfiler("cores.rtd", 1);
+	if (tp == nullptr) {
+		return false;
+	}
+
+	bool ok = tp->MapTraceFile() == TraceDqrProfiler::DQERR_OK;
+
+	if (ok && perCore) {
+		ok = tp->StartCoreDecode() == TraceDqrProfiler::DQERR_OK;
+	}
+
+	// the message is only passed back when it changes, as the address search expects
+
+	TraceDqrProfiler::DQErr rc = TraceDqrProfiler::DQERR_OK;
+	ProfilerNexusMessage* msgInfo = nullptr;
+
+	while (ok && (rc == TraceDqrProfiler::DQERR_OK)) {
+		ProfilerInstruction* instInfo = nullptr;
+		uint64_t addr = 0;
+
+		rc = tp->NextInstruction(&instInfo, &msgInfo, addr);
+		if ((rc == TraceDqrProfiler::DQERR_OK) && (addr != 0)) {
+			decoded.push_back(std::make_pair((msgInfo != nullptr) ? msgInfo->offset : 0, addr));
+		}
+	}
+
+	delete tp;
+
+	return ok && (rc == TraceDqrProfiler::DQERR_EOF);
+}
+
+// core 1 stops part way through cores.rtd while core 0 keeps going. Decoding a worker per core must give the
+// instructions in the same order, and from the same messages, as the serial decoder
+
+static bool testCoreDecode(const Counts& expected)
+{
+	Decoded serial;
+	Decoded perCore;
+
+	if (!decodeCores(false, serial) || !decodeCores(true, perCore)) {
+		return false;
+	}
+
+	Counts counts;
+
+	for (size_t i = 0; i < serial.size(); i++) {
+		counts[serial[i].second] += 1;
+	}
+
+	bool ok = compareCounts("cores", expected, counts);
+
+	for (size_t i = 0; i < std::min(serial.size(), perCore.size()); i++) {
+		if (serial[i] != perCore[i]) {
+			printf("  per-core: instruction %llu: expected offset %llu address 0x%llx, got offset %llu address 0x%llx\n", (unsigned long long)i, (unsigned long long)serial[i].first, (unsigned long long)serial[i].second, (unsigned long long)perCore[i].first, (unsigned long long)perCore[i].second);
+			return false;
+		}
+	}
+
+	if (serial.size() != perCore.size()) {
+		printf("  per-core: expected %llu instructions, got %llu\n", (unsigned long long)serial.size(), (unsigned long long)perCore.size());
+		return false;
+	}
+
+	return ok;
+}
+
+static bool funcCompare(const ProfilerHistogramSummary::FuncCount& a, const ProfilerHistogramSummary::FuncCount& b)
+{
+	return a.address < b.address;
+}
+
+static bool lineCompare(const ProfilerHistogramSummary::LineCount& a, const ProfilerHistogramSummary::LineCount& b)
+{
+	int c = strcmp((a.file != nullptr) ? a.file : "", (b.file != nullptr) ? b.file : "");
+
+	return (c < 0) || ((c == 0) && (a.line < b.line));
+}
+
+// the summary as text. Functions and lines are in the order they were first counted, so they are sorted here
+
+static std::string summaryText(const ProfilerHistogramSummary& summary)
+{
+	std::vector<ProfilerHistogramSummary::FuncCount> functions = summary.functions;
+	std::vector<ProfilerHistogramSummary::LineCount> lines = summary.lines;
+	std::string text;
+	char buf[512];
+
+	std::sort(functions.begin(), functions.end(), funcCompare);
+	std::sort(lines.begin(), lines.end(), lineCompare);
+
+	for (size_t i = 0; i < functions.size(); i++) {
+		snprintf(buf, sizeof buf, "function %llx %s %llu\n", (unsigned long long)functions[i].address, (functions[i].function != nullptr) ? functions[i].function : "-", (unsigned long long)functions[i].count);
+		text += buf;
+	}
+
+	for (size_t i = 0; i < lines.size(); i++) {
+		snprintf(buf, sizeof buf, "line %s:%u %llu\n", (lines[i].file != nullptr) ? lines[i].file : "-", lines[i].line, (unsigned long long)lines[i].count);
+		text += buf;
+	}
+
+	for (size_t i = 0; i < summary.blocks.size(); i++) {
+		const ProfilerHistogramSummary::BlockCount& b = summary.blocks[i];
+
+		snprintf(buf, sizeof buf, "block %llx-%llx %llu %llu\n", (unsigned long long)b.startAddr, (unsigned long long)b.endAddr, (unsigned long long)b.count, (unsigned long long)b.entries);
+		text += buf;
+	}
+
+	snprintf(buf, sizeof buf, "outside %llu\n", (unsigned long long)summary.outsideCode);
+	text += buf;
+
+	return text;
+}
+
+static bool edgeCompare(const ProfilerCallGraph::Edge& a, const ProfilerCallGraph::Edge& b)
+{
+	return (a.caller < b.caller) || ((a.caller == b.caller) && (a.callee < b.callee));
+}
+
+// the call graph as text, edges sorted by caller then callee
+
+static std::string callGraphText(const ProfilerCallGraph& graph)
+{
+	std::vector<ProfilerCallGraph::Edge> edges = graph.edges;
+	std::string text;
+	char buf[512];
+
+	std::sort(edges.begin(), edges.end(), edgeCompare);
+
+	for (size_t i = 0; i < edges.size(); i++) {
+		const ProfilerCallGraph::Edge& e = edges[i];
+
+		snprintf(buf, sizeof buf, "call %s -> %s %llu %llu %llu %llu %llu\n", (e.callerName != nullptr) ? e.callerName : "-", (e.calleeName != nullptr) ? e.calleeName : "-", (unsigned long long)e.calls, (unsigned long long)e.inclusiveInsts, (unsigned long long)e.exclusiveInsts, (unsigned long long)e.inclusiveTime, (unsigned long long)e.exclusiveTime);
+		text += buf;
+	}
+
+	return text;
+}
+
+class HistogramRun {
+public:
+	Counts hist;
+	Counts ticks;
+	std::string summary;
+	std::string calls;
+	int32_t ret;
+};
+
+// runs GenerateHistogram() on the trace file, or on the trace pushed in small pieces. Pushed data is reported on at
+// every message so the summary is built up from many deltas. The pprof and perf script output is written to outDir
+
+static bool generateHistogram(bool fileInput, HistogramRun& run)
+{
+	TraceProfiler* tp = newProfiler();
+	if (tp == nullptr) {
+		return false;
+	}
+
+	bool ok = true;
+
+	if (fileInput) {
+		ok = tp->MapTraceFile() == TraceDqrProfiler::DQERR_OK;
+	}
+	else {
+		std::string trace;
+
+		ok = readFile("prog.rtd", trace);
+
+		for (size_t i = 0; ok && (i < trace.size()); i += 37) {
+			ok = tp->PushTraceData((uint8_t*)&trace[i], std::min(trace.size() - i, (size_t)37)) == TraceDqrProfiler::DQERR_OK;
+		}
+
+		tp->SetEndOfData();
+		tp->AddFlushDataOffset(0);
+	}
+
+	run.ret = TraceDqrProfiler::DQERR_ERR;
+
+	tp->SetHistogramCallback([&run](uint32_t src_id, const ProfilerHistogram& hist, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret) {
+		run.hist.clear();
+		for (ProfilerHistogram::const_iterator it = hist.begin(); it != hist.end(); ++it) {
+			run.hist[(*it).first] = (*it).second;
+		}
+		run.ret = ret;
+	});
+
+	tp->SetTimeProfileCallback(ProfilerHistogramSummary::sumNone, [&run](uint32_t src_id, const ProfilerHistogram& ticks, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret) {
+		run.ticks.clear();
+		for (ProfilerHistogram::const_iterator it = ticks.begin(); it != ticks.end(); ++it) {
+			run.ticks[(*it).first] = (*it).second;
+		}
+	});
+
+	tp->SetHistogramSummaryCallback(ProfilerHistogramSummary::sumFunction | ProfilerHistogramSummary::sumLine | ProfilerHistogramSummary::sumBlock, [&run](uint32_t src_id, const ProfilerHistogramSummary& summary, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret) {
+		run.summary = summaryText(summary);
+	});
+
+	tp->SetCallGraphCallback([&run](uint32_t src_id, const ProfilerCallGraph& graph, uint64_t total_bytes_processed, uint64_t total_ins, int32_t ret) {
+		run.calls = callGraphText(graph);
+	});
+
+	if (ok) {
+		ok = (tp->SetProfileOutput(TraceProfiler::PROFILE_PPROF, outPath("prog.pb.gz").c_str()) == TraceDqrProfiler::DQERR_OK) &&
+		     (tp->SetProfileOutput(TraceProfiler::PROFILE_PERF_SCRIPT, outPath("prog.perf").c_str()) == TraceDqrProfiler::DQERR_OK);
+	}
+
+	if (ok) {
+		ok = tp->GenerateHistogram() == TraceDqrProfiler::DQERR_EOF;
+	}
+
+	delete tp;
+
+	return ok && (run.ret == TraceDqrProfiler::DQERR_EOF);
+}
+
+static bool checkHistogram(const HistogramRun& run, const Counts& hist, const Counts& ticks)
+{
+	bool ok = compareCounts("histogram", hist, run.hist);
+
+	ok = compareCounts("ticks", ticks, run.ticks) && ok;
+
+	ok = compareGolden("prog.calls", run.calls) && ok;
+
+	return compareGolden("prog.summary", run.summary) && ok;
+}
+
+// the profile files only get the totals, so they are the same however often the histogram was reported on
+
+static bool testInput(bool fileInput, const Counts& hist, const Counts& ticks)
+{
+	HistogramRun run;
+
+	if (!generateHistogram(fileInput, run)) {
+		return false;
+	}
+
+	bool ok = checkHistogram(run, hist, ticks);
+
+	ok = compareGoldenFile("prog.pb.gz") && ok;
+
+	return compareGoldenFile("prog.perf") && ok;
+}
+
+static int failed = 0;
+
+static void report(const char* name, bool passed)
+{
+	printf("%s: %s\n", passed ? "PASS" : "FAIL", name);
+
+	if (!passed) {
+		failed += 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if ((argc != 2) && (argc != 3)) {
+		printf("usage: profiler_test <tests/data directory> [objdump]\n");
+		return 2;
+	}
+
+	report("ring buffer", testRingBuffer());
+
+	char cwd[4096];
+
+	if ((getcwd(cwd, sizeof cwd) == nullptr) || (chdir(argv[1]) != 0)) {
+		printf("Error: cannot change to %s\n", argv[1]);
+		return 2;
+	}
+
+	outDir = cwd;
+
+	Counts hist;
+	Counts ticks;
+	Counts coreHist;
+
+	if (!readCounts("prog.hist", hist) || !readCounts("prog.ticks", ticks) || !readCounts("cores.hist", coreHist)) {
+		return 1;
+	}
+
+	report("disassembly", testDisassembly(nullptr));
+	report("decode", testDecode(hist));
+	report("parallel decode", testParallelDecode());
+	report("per-core decode", testCoreDecode(coreHist));
+	report("file input", testInput(true, hist, ticks));
+	report("streaming input", testInput(false, hist, ticks));
+
+	if (argc == 3) {
+		report("objdump disassembly", testDisassembly(argv[2]));
+	}
+	else {
+		printf("SKIP: objdump disassembly (no objdump given)\n");
+	}
+
+	return (failed == 0) ? 0 : 1;
+}
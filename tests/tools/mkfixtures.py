@@ -0,0 +1,451 @@
+#!/usr/bin/env python3
+#
+# Makes the regression test's elf file and trace from tests/data/prog.s:
+#
+#   prog.elf   prog.s assembled with llvm-mc and linked at LOAD_ADDR (there is no RISC-V linker needed; the
+#              one object file is relocated here)
+#   prog.rtd   HTM trace of prog.elf running from _start until it jumps to done, with timestamps
+#   prog.hist  "address count" for every instruction the run retired, the histogram the decoder must produce
+#   prog.ticks "address ticks" the timestamps charge to each address, for the time profile
+#   cores.rtd  the same run on two cores, with a one bit src field. Core 1 starts CORE1_DELAY cycles later, takes
+#              no interrupt and stops after CORE1_INDIRECT indirect branches while core 0 runs on to the end
+#   cores.hist "address count" over both cores
+#
+# The trace is made the way the encoder would: conditional branches go in the history, direct jumps and calls
+# are inferred, returns are implicit while the return stack has the address, and everything else gets an
+# indirect branch history message. Every SYNC_EVERY indirect branch is sent with sync instead, so the trace can
+# be split for parallel decode. Timestamps count cycles; most instructions take one, MUL and loads take more.
+# One interrupt is taken after the first plain instruction from INTERRUPT_AT on: the handler, isr, is entered with
+# an exception type indirect branch and left with mret.
+#
+# prog.summary, prog.calls, prog.pb.gz and prog.perf are golden output of the profiler itself, not made here. After
+# changing the fixtures, run 'make test' in project/linux, check the output it leaves in Release and copy it to
+# tests/data.
+#
+# usage: mkfixtures.py [llvm bin dir]      (run from anywhere; writes into tests/data)
+
+import os
+import re
+import struct
+import subprocess
+import sys
+
+LOAD_ADDR = 0x80000000
+SYNC_EVERY = 3
+MAX_HISTORY = 30	# history bits per message. The decoder keeps history in an int
+START_TIME = 0x1000
+CYCLES = {"mul": 12, "ld": 4, "c.ldsp": 4}
+INTERRUPT_AT = 1000	# instructions retired
+CORE1_DELAY = 100
+CORE1_INDIRECT = 6
+
+TCODE_SYNC = 9
+TCODE_RESOURCEFULL = 27
+TCODE_INDIRECTBRANCHHISTORY = 28
+TCODE_INDIRECTBRANCHHISTORY_WS = 29
+BTYPE_INDIRECT = 0
+BTYPE_EXCEPTION = 1
+SYNC_TRACE_ENABLE = 5
+SYNC_PERIODIC = 2	# SYNC_T_CNT
+
+DATA_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "data")
+
+
+def tool(name):
+	if len(sys.argv) > 1:
+		return os.path.join(sys.argv[1], name)
+	return name
+
+
+# ---- linking
+
+def link(obj, out):
+	elf = bytearray(open(obj, "rb").read())
+
+	if (elf[4] != 2) or (elf[5] != 1) or (struct.unpack_from("<H", elf, 0x12)[0] != 243):
+		raise SystemExit("mkfixtures: %s is not a 64 bit little endian RISC-V object" % obj)
+
+	shoff = struct.unpack_from("<Q", elf, 0x28)[0]
+	shnum, shstrndx = struct.unpack_from("<HH", elf, 0x3c)
+
+	sections = []
+	for i in range(shnum):
+		name, stype, flags, addr, offset, size, slink, info, align, entsize = struct.unpack_from("<IIQQQQIIQQ", elf, shoff + i * 64)
+		sections.append({"name": name, "type": stype, "flags": flags, "offset": offset, "size": size, "link": slink, "info": info})
+
+	strtab = sections[shstrndx]
+	for s in sections:
+		end = elf.index(b"\0", strtab["offset"] + s["name"])
+		s["name"] = elf[strtab["offset"] + s["name"]:end].decode()
+
+	text = [i for i, s in enumerate(sections) if s["name"] == ".text"][0]
+	symtab = [s for s in sections if s["type"] == 2][0]
+
+	# move everything defined in .text to LOAD_ADDR
+
+	struct.pack_into("<Q", elf, shoff + text * 64 + 0x10, LOAD_ADDR)
+
+	symbols = []
+	entry = None
+	symnames = sections[symtab["link"]]
+
+	for off in range(symtab["offset"], symtab["offset"] + symtab["size"], 24):
+		name, info, other, shndx, value, size = struct.unpack_from("<IBBHQQ", elf, off)
+		if shndx == text:
+			value += LOAD_ADDR
+			struct.pack_into("<Q", elf, off + 8, value)
+		end = elf.index(b"\0", symnames["offset"] + name)
+		if elf[symnames["offset"] + name:end] == b"_start":
+			entry = value
+		symbols.append(value)
+
+	# resolve the relocations in the debug sections. Code needs none, as prog.s is assembled without relaxation
+
+	removed = []
+
+	for s in sections:
+		if s["type"] != 4:	# SHT_RELA
+			continue
+
+		target = sections[s["info"]]
+		if target["flags"] & 2:	# SHF_ALLOC
+			raise SystemExit("mkfixtures: unexpected relocations for %s" % target["name"])
+
+		for off in range(s["offset"], s["offset"] + s["size"], 24):
+			where, info, addend = struct.unpack_from("<QQq", elf, off)
+			value = symbols[info >> 32] + addend
+			rtype = info & 0xffffffff
+			at = target["offset"] + where
+
+			if rtype == 1:	# R_RISCV_32
+				struct.pack_into("<I", elf, at, value & 0xffffffff)
+			elif rtype == 2:	# R_RISCV_64
+				struct.pack_into("<Q", elf, at, value & 0xffffffffffffffff)
+			elif 33 <= rtype <= 40:	# R_RISCV_ADD8 .. R_RISCV_SUB64
+				fmt = ["<B", "<H", "<I", "<Q"][(rtype - 33) % 4]
+				mask = (1 << (8 * struct.calcsize(fmt))) - 1
+				old = struct.unpack_from(fmt, elf, at)[0]
+				new = old + value if rtype <= 36 else old - value
+				struct.pack_into(fmt, elf, at, new & mask)
+			else:
+				raise SystemExit("mkfixtures: unsupported relocation type %d" % rtype)
+
+		removed.append(s["name"])
+
+	struct.pack_into("<H", elf, 0x10, 2)	# ET_EXEC
+	struct.pack_into("<Q", elf, 0x18, entry)
+
+	tmp = out + ".tmp"
+	open(tmp, "wb").write(elf)
+
+	args = [tool("llvm-objcopy")]
+	for name in removed:
+		args.append("--remove-section=" + name)
+	subprocess.check_call(args + [tmp, out])
+	os.remove(tmp)
+
+
+# ---- running
+
+REGS = {"zero": 0, "ra": 1, "sp": 2, "gp": 3, "tp": 4, "t0": 5, "t1": 6, "t2": 7, "s0": 8, "s1": 9}
+for i in range(8):
+	REGS["a%d" % i] = 10 + i
+for i in range(2, 12):
+	REGS["s%d" % i] = 16 + i
+for i in range(3, 7):
+	REGS["t%d" % i] = 25 + i
+
+
+def disassemble(elf):
+	out = subprocess.check_output([tool("llvm-objdump"), "-d", "-M", "no-aliases", "--mattr=+m,+c", elf]).decode()
+	insts = {}
+
+	for line in out.splitlines():
+		m = re.match(r"^\s*([0-9a-f]+):\s+((?:[0-9a-f]{2} )+)\s*\t(\S+)(?:\t(.*))?$", line)
+		if m is None:
+			continue
+		ops = (m.group(4) or "").split("<")[0].replace(" ", "").split(",")
+		insts[int(m.group(1), 16)] = (len(m.group(2).split()), m.group(3), [o for o in ops if o != ""])
+
+	return insts
+
+
+def symbol(elf, name):
+	for line in subprocess.check_output([tool("llvm-nm"), elf]).decode().splitlines():
+		fields = line.split()
+		if fields[-1] == name:
+			return int(fields[0], 16)
+
+	raise SystemExit("mkfixtures: no symbol %s in %s" % (name, elf))
+
+
+def sext(v, bits):
+	v &= (1 << bits) - 1
+	return v - (1 << bits) if v & (1 << (bits - 1)) else v
+
+
+class Slices:
+	def __init__(self, src_bits=0, src=0):
+		self.src_bits = src_bits
+		self.src = src
+		self.messages = []	# (time, slices) so the messages of several cores can be merged in time order
+
+	def data(self):
+		return bytearray(b"".join(m[1] for m in self.messages))
+
+	def message(self, tcode, fixed, var, ts, time):
+		# fixed fields are packed into slices from the lsb, each variable field starts where the last field
+		# ended and runs to the end of a slice
+
+		bits = []
+		data = bytearray()
+
+		def put(value, width):
+			for i in range(width):
+				bits.append((value >> i) & 1)
+
+		put(tcode, 6)
+		put(self.src, self.src_bits)
+		for value, width in fixed:
+			put(value, width)
+
+		fields = list(var)
+		if ts is not None:
+			fields.append(ts)
+
+		slices = []
+		for n, value in enumerate(fields):
+			width = max(value.bit_length(), 1)
+			put(value, width)
+			while len(bits) % 6:
+				bits.append(0)
+			while len(slices) * 6 < len(bits):
+				slices.append(0)
+			slices[-1] = 3 if n == len(fields) - 1 else 1
+
+		for i, mseo in enumerate(slices):
+			v = 0
+			for b in range(6):
+				v |= bits[i * 6 + b] << b
+			data.append((v << 2) | mseo)
+
+		self.messages.append((time, bytes(data)))
+
+
+# runs the program from _start to done, or until stop_indirect indirect branches have been sent
+
+def run(insts, isr, trace, start_time=START_TIME, interrupt_at=INTERRUPT_AT, stop_indirect=None):
+	x = [0] * 32
+	mem = {}
+	pc = [a for a in insts][0]
+	hist = {}
+	ticks = {}
+
+	time = start_time
+	last_time = time
+	faddr = pc
+	i_cnt = 0
+	history = 1
+	stack = []
+	indirect = 0
+	retired = 0
+	mepc = None
+
+	trace.message(TCODE_SYNC, [(SYNC_TRACE_ENABLE, 4)], [0, pc >> 1], time, time)
+
+	# ticks between two timestamps are shared over the instructions in between the way the decoder does it,
+	# in proportion to how often each address ran
+
+	window = {}
+
+	def stamp():
+		nonlocal last_time
+		ts = time ^ last_time
+		total = sum(window.values())
+		if total:
+			q, r = divmod(time - last_time, total)
+			cum = 0
+			for addr in window:
+				before = (cum * r) // total
+				cum += window[addr]
+				share = window[addr] * q + (cum * r) // total - before
+				if share:
+					ticks[addr] = ticks.get(addr, 0) + share
+		window.clear()
+		last_time = time
+		return ts
+
+	def full_stamp():
+		stamp()
+		return time
+
+	while True:
+		size, op, ops = insts[pc]
+		nextpc = pc + size
+		target = None
+		branch = None
+
+		def r(i):
+			return x[REGS[ops[i]]]
+
+		def w(i, v):
+			if REGS[ops[i]] != 0:
+				x[REGS[ops[i]]] = v & 0xffffffffffffffff
+
+		def imm(i):
+			return int(ops[i], 0)
+
+		def mem_addr(i):
+			off, base = ops[i][:-1].split("(")
+			return (x[REGS[base]] + int(off, 0)) & 0xffffffffffffffff
+
+		o = op[2:] if op.startswith("c.") else op
+
+		if o == "lui":
+			w(0, sext(imm(1) << 12, 32))
+		elif o == "auipc":
+			w(0, pc + sext(imm(1) << 12, 32))
+		elif o == "li":
+			w(0, imm(1))
+		elif o == "mv":
+			w(0, r(1))
+		elif o in ("addi", "addi16sp", "addiw"):
+			w(0, r(len(ops) - 2) + imm(len(ops) - 1) if len(ops) == 3 else r(0) + imm(1))
+		elif o == "andi":
+			w(0, r(1) & imm(2))
+		elif o == "slli":
+			w(0, (r(1) << imm(2)) if len(ops) == 3 else (r(0) << imm(1)))
+		elif o == "add":
+			w(0, r(1) + r(2) if len(ops) == 3 else r(0) + r(1))
+		elif o == "sub":
+			w(0, r(1) - r(2) if len(ops) == 3 else r(0) - r(1))
+		elif o == "mul":
+			w(0, r(1) * r(2))
+		elif o in ("sd", "sdsp"):
+			mem[mem_addr(1)] = r(0)
+		elif o in ("ld", "ldsp"):
+			w(0, mem.get(mem_addr(1), 0))
+		elif o in ("beq", "bne", "blt", "bge", "beqz", "bnez"):
+			a = sext(r(0), 64)
+			b = 0 if o in ("beqz", "bnez") else sext(r(1), 64)
+			taken = {"beq": a == b, "beqz": a == b, "bne": a != b, "bnez": a != b, "blt": a < b, "bge": a >= b}[o]
+			branch = taken
+			if taken:
+				nextpc = int(ops[-1], 16)
+		elif o == "jal":
+			if (len(ops) == 2) and (ops[0] in ("ra", "t0")):
+				stack.append(nextpc)
+			if len(ops) == 2:
+				w(0, nextpc)
+			nextpc = int(ops[-1], 16)
+		elif o == "j":
+			nextpc = int(ops[0], 16)
+		elif o in ("jr", "jalr"):
+			if op.startswith("c."):
+				rd, rs1, off = ("ra" if o == "jalr" else "zero"), ops[0], 0
+			else:
+				rd = ops[0]
+				off, rs1 = ops[1][:-1].split("(")
+				off = int(off, 0)
+			dest = (x[REGS[rs1]] + off) & ~1
+			link = (rd in ("ra", "t0"))
+			if link:
+				x[REGS[rd]] = nextpc
+				stack.append(nextpc)
+			if (not link) and (rs1 in ("ra", "t0")) and stack and (stack[-1] == dest):
+				stack.pop()	# implicit return
+			else:
+				target = dest
+			nextpc = dest
+		elif o == "mret":
+			target = mepc
+			nextpc = mepc
+		else:
+			raise SystemExit("mkfixtures: cannot run %s at %x" % (op, pc))
+
+		btype = BTYPE_INDIRECT
+		retired += 1
+		if (interrupt_at is not None) and (retired >= interrupt_at) and (mepc is None) and (branch is None) and (nextpc == pc + size):
+			mepc = nextpc
+			target = isr
+			nextpc = isr
+			btype = BTYPE_EXCEPTION
+
+		hist[pc] = hist.get(pc, 0) + 1
+		window[pc] = window.get(pc, 0) + 1
+		i_cnt += size // 2
+		time += CYCLES.get(op, 1)
+
+		if branch is not None:
+			history = (history << 1) | (1 if branch else 0)
+			if history >= (1 << MAX_HISTORY):
+				trace.message(TCODE_RESOURCEFULL, [(1, 4)], [history], stamp(), time)
+				history = 1
+
+		if target is not None:
+			indirect += 1
+			if (indirect % SYNC_EVERY) == 0:
+				trace.message(TCODE_INDIRECTBRANCHHISTORY_WS, [(SYNC_PERIODIC, 4), (btype, 2)], [i_cnt, target >> 1, history], full_stamp(), time)
+				stack = []
+			else:
+				trace.message(TCODE_INDIRECTBRANCHHISTORY, [(btype, 2)], [i_cnt, (target ^ faddr) >> 1, history], stamp(), time)
+			faddr = target
+			i_cnt = 0
+			history = 1
+
+			if insts[target][1] == "c.j" and int(insts[target][2][0], 16) == target:
+				break	# reached done
+			if indirect == stop_indirect:
+				break
+
+		pc = nextpc
+
+	return hist, ticks
+
+
+def write_counts(name, counts):
+	with open(name, "w") as f:
+		for addr in sorted(counts):
+			f.write("%x %d\n" % (addr, counts[addr]))
+
+
+def main():
+	os.chdir(DATA_DIR)
+
+	subprocess.check_call([tool("llvm-mc"), "-triple=riscv64", "-mattr=+m,+c,-relax", "-filetype=obj", "-g",
+		"--fdebug-compilation-dir=.", "prog.s", "-o", "prog.o"])
+	link("prog.o", "prog.elf")
+	os.remove("prog.o")
+
+	insts = disassemble("prog.elf")
+	isr = symbol("prog.elf", "isr")
+
+	trace = Slices()
+	hist, ticks = run(insts, isr, trace)
+
+	open("prog.rtd", "wb").write(trace.data())
+	write_counts("prog.hist", hist)
+	write_counts("prog.ticks", ticks)
+
+	print("prog.rtd: %d bytes, %d instructions" % (len(trace.data()), sum(hist.values())))
+
+	core0 = Slices(1, 0)
+	core1 = Slices(1, 1)
+	hist, ticks = run(insts, isr, core0)
+	hist1, ticks = run(insts, isr, core1, START_TIME + CORE1_DELAY, None, CORE1_INDIRECT)
+
+	for addr in hist1:
+		hist[addr] = hist.get(addr, 0) + hist1[addr]
+
+	# sorted() is stable, so core 0 goes first when both send a message at the same time
+
+	cores = Slices()
+	cores.messages = sorted(core0.messages + core1.messages, key=lambda m: m[0])
+
+	open("cores.rtd", "wb").write(cores.data())
+	write_counts("cores.hist", hist)
+
+	print("cores.rtd: %d bytes, %d instructions" % (len(cores.data()), sum(hist.values())))
+
+
+main()